@@ -19,6 +19,7 @@ mts_data_origin_t = UInt64
 
 mts_create_array_callback_t = Ptr{Cvoid}  # TODO: actual type
 mts_realloc_buffer_t = Ptr{Cvoid}         # TODO: actual type
+mts_create_mmap_array_callback_t = Ptr{Cvoid}  # TODO: actual type
 
 # ====== Enf of manual definitions ====== #
 
@@ -30,6 +31,17 @@ MTS_IO_ERROR = 2
 MTS_SERIALIZATION_ERROR = 3
 MTS_BUFFER_SIZE_ERROR = 254
 MTS_INTERNAL_ERROR = 255
+MTS_DTYPE_UNKNOWN = 0
+MTS_DTYPE_FLOAT64 = 1
+MTS_DTYPE_FLOAT32 = 2
+MTS_DTYPE_FLOAT16 = 3
+MTS_DTYPE_INT32 = 4
+MTS_DTYPE_INT64 = 5
+MTS_COMPRESSION_NONE = 0
+MTS_COMPRESSION_DEFLATE = 1
+MTS_STORAGE_FLOAT64 = 0
+MTS_STORAGE_FLOAT32 = 1
+MTS_STORAGE_FLOAT16 = 2
 
 
 # ===== Enum definitions
@@ -42,6 +54,15 @@ end
 struct mts_tensormap_t
 end
 
+struct mts_mmap_t
+end
+
+struct mts_tensormap_reader_t
+end
+
+struct mts_tensormap_writer_t
+end
+
 struct mts_labels_t
     internal_ptr_ :: Ptr{Cvoid}
     names :: Ptr{Ptr{Cchar}}
@@ -66,6 +87,24 @@ struct mts_array_t
     copy :: Ptr{Cvoid} #= (Ptr{Cvoid}, Ptr{mts_array_t}) -> mts_status_t =#
     destroy :: Ptr{Cvoid} #= (Ptr{Cvoid}) -> Cvoid =#
     move_samples_from :: Ptr{Cvoid} #= (Ptr{Cvoid}, Ptr{Cvoid}, Ptr{mts_sample_mapping_t}, UIntptr, UIntptr, UIntptr) -> mts_status_t =#
+    dtype :: Ptr{Cvoid} #= (Ptr{Cvoid}, Ptr{Int32}) -> mts_status_t =#
+    typed_data :: Ptr{Cvoid} #= (Ptr{Cvoid}, Int32, Ptr{Ptr{Cvoid}}) -> mts_status_t =#
+end
+
+struct mts_save_options_t
+    compression :: Int32
+    storage_type :: Int32
+end
+
+struct mts_load_options_t
+    threads :: UIntptr
+end
+
+struct mts_profiling_entry_t
+    name :: Ptr{Cchar}
+    calls :: UInt64
+    time_ns :: UInt64
+    bytes :: UInt64
 end
 
 
@@ -88,6 +127,38 @@ function mts_version()
     )
 end
 
+function mts_set_num_threads(threads::UIntptr)
+    ccall((:mts_set_num_threads, libmetatensor), 
+        Cvoid,
+        (UIntptr,),
+        threads
+    )
+end
+
+function mts_get_num_threads()
+    ccall((:mts_get_num_threads, libmetatensor), 
+        UIntptr,
+        (),
+        
+    )
+end
+
+function mts_profiling_get(entries::Ptr{mts_profiling_entry_t}, count::Ptr{UIntptr})
+    ccall((:mts_profiling_get, libmetatensor), 
+        mts_status_t,
+        (Ptr{mts_profiling_entry_t}, Ptr{UIntptr},),
+        entries, count
+    )
+end
+
+function mts_profiling_reset()
+    ccall((:mts_profiling_reset, libmetatensor), 
+        Cvoid,
+        (),
+        
+    )
+end
+
 function mts_last_error()
     ccall((:mts_last_error, libmetatensor), 
         Ptr{Cchar},
@@ -104,6 +175,22 @@ function mts_labels_position(labels::mts_labels_t, values::Ptr{Int32}, values_co
     )
 end
 
+function mts_labels_positions(labels::mts_labels_t, values::Ptr{Int32}, count::UIntptr, size::UIntptr, result::Ptr{Int64})
+    ccall((:mts_labels_positions, libmetatensor), 
+        mts_status_t,
+        (mts_labels_t, Ptr{Int32}, UIntptr, UIntptr, Ptr{Int64},),
+        labels, values, count, size, result
+    )
+end
+
+function mts_labels_range_of(labels::mts_labels_t, prefix::Ptr{Int32}, prefix_count::UIntptr, start::Ptr{UIntptr}, _end::Ptr{UIntptr})
+    ccall((:mts_labels_range_of, libmetatensor), 
+        mts_status_t,
+        (mts_labels_t, Ptr{Int32}, UIntptr, Ptr{UIntptr}, Ptr{UIntptr},),
+        labels, prefix, prefix_count, start, _end
+    )
+end
+
 function mts_labels_create(labels::Ptr{mts_labels_t})
     ccall((:mts_labels_create, libmetatensor), 
         mts_status_t,
@@ -112,6 +199,22 @@ function mts_labels_create(labels::Ptr{mts_labels_t})
     )
 end
 
+function mts_labels_create_assume_unique(labels::Ptr{mts_labels_t})
+    ccall((:mts_labels_create_assume_unique, libmetatensor), 
+        mts_status_t,
+        (Ptr{mts_labels_t},),
+        labels
+    )
+end
+
+function mts_labels_create_borrowed(labels::Ptr{mts_labels_t}, assume_unique::Cbool, values_owner::Ptr{Cvoid}, values_owner_delete::Ptr{Cvoid} #= (Ptr{Cvoid}) -> Cvoid =#)
+    ccall((:mts_labels_create_borrowed, libmetatensor), 
+        mts_status_t,
+        (Ptr{mts_labels_t}, Cbool, Ptr{Cvoid}, Ptr{Cvoid} #= (Ptr{Cvoid}) -> Cvoid =#,),
+        labels, assume_unique, values_owner, values_owner_delete
+    )
+end
+
 function mts_labels_set_user_data(labels::mts_labels_t, user_data::Ptr{Cvoid}, user_data_delete::Ptr{Cvoid} #= (Ptr{Cvoid}) -> Cvoid =#)
     ccall((:mts_labels_set_user_data, libmetatensor), 
         mts_status_t,
@@ -320,6 +423,22 @@ function mts_tensormap_keys_to_samples(tensor::Ptr{mts_tensormap_t}, keys_to_mov
     )
 end
 
+function mts_tensormap_split_samples(tensor::Ptr{mts_tensormap_t}, dimension::Ptr{Cchar}, shards::Ptr{UIntptr}, shards_count::UIntptr, output::Ptr{Ptr{mts_tensormap_t}}, output_count::UIntptr)
+    ccall((:mts_tensormap_split_samples, libmetatensor), 
+        mts_status_t,
+        (Ptr{mts_tensormap_t}, Ptr{Cchar}, Ptr{UIntptr}, UIntptr, Ptr{Ptr{mts_tensormap_t}}, UIntptr,),
+        tensor, dimension, shards, shards_count, output, output_count
+    )
+end
+
+function mts_tensormap_merge_samples(tensors::Ptr{Ptr{mts_tensormap_t}}, tensors_count::UIntptr)
+    ccall((:mts_tensormap_merge_samples, libmetatensor), 
+        Ptr{mts_tensormap_t},
+        (Ptr{Ptr{mts_tensormap_t}}, UIntptr,),
+        tensors, tensors_count
+    )
+end
+
 function mts_labels_load(path::Ptr{Cchar}, labels::Ptr{mts_labels_t})
     ccall((:mts_labels_load, libmetatensor), 
         mts_status_t,
@@ -352,6 +471,22 @@ function mts_labels_save_buffer(buffer::Ptr{Ptr{UInt8}}, buffer_count::Ptr{UIntp
     )
 end
 
+function mts_labels_serialized_size(labels::mts_labels_t, size::Ptr{UIntptr})
+    ccall((:mts_labels_serialized_size, libmetatensor), 
+        mts_status_t,
+        (mts_labels_t, Ptr{UIntptr},),
+        labels, size
+    )
+end
+
+function mts_labels_save_into_buffer(buffer::Ptr{UInt8}, buffer_count::UIntptr, written::Ptr{UIntptr}, labels::mts_labels_t)
+    ccall((:mts_labels_save_into_buffer, libmetatensor), 
+        mts_status_t,
+        (Ptr{UInt8}, UIntptr, Ptr{UIntptr}, mts_labels_t,),
+        buffer, buffer_count, written, labels
+    )
+end
+
 function mts_block_load(path::Ptr{Cchar}, create_array::mts_create_array_callback_t)
     ccall((:mts_block_load, libmetatensor), 
         Ptr{mts_block_t},
@@ -368,6 +503,14 @@ function mts_block_load_buffer(buffer::Ptr{UInt8}, buffer_count::UIntptr, create
     )
 end
 
+function mts_block_load_mmap(path::Ptr{Cchar}, create_array::mts_create_mmap_array_callback_t)
+    ccall((:mts_block_load_mmap, libmetatensor), 
+        Ptr{mts_block_t},
+        (Ptr{Cchar}, mts_create_mmap_array_callback_t,),
+        path, create_array
+    )
+end
+
 function mts_block_save(path::Ptr{Cchar}, block::Ptr{mts_block_t})
     ccall((:mts_block_save, libmetatensor), 
         mts_status_t,
@@ -376,6 +519,14 @@ function mts_block_save(path::Ptr{Cchar}, block::Ptr{mts_block_t})
     )
 end
 
+function mts_block_save_with_options(path::Ptr{Cchar}, block::Ptr{mts_block_t}, options::mts_save_options_t)
+    ccall((:mts_block_save_with_options, libmetatensor), 
+        mts_status_t,
+        (Ptr{Cchar}, Ptr{mts_block_t}, mts_save_options_t,),
+        path, block, options
+    )
+end
+
 function mts_block_save_buffer(buffer::Ptr{Ptr{UInt8}}, buffer_count::Ptr{UIntptr}, realloc_user_data::Ptr{Cvoid}, realloc::mts_realloc_buffer_t, block::Ptr{mts_block_t})
     ccall((:mts_block_save_buffer, libmetatensor), 
         mts_status_t,
@@ -384,6 +535,30 @@ function mts_block_save_buffer(buffer::Ptr{Ptr{UInt8}}, buffer_count::Ptr{UIntpt
     )
 end
 
+function mts_block_save_buffer_with_options(buffer::Ptr{Ptr{UInt8}}, buffer_count::Ptr{UIntptr}, realloc_user_data::Ptr{Cvoid}, realloc::mts_realloc_buffer_t, block::Ptr{mts_block_t}, options::mts_save_options_t)
+    ccall((:mts_block_save_buffer_with_options, libmetatensor), 
+        mts_status_t,
+        (Ptr{Ptr{UInt8}}, Ptr{UIntptr}, Ptr{Cvoid}, mts_realloc_buffer_t, Ptr{mts_block_t}, mts_save_options_t,),
+        buffer, buffer_count, realloc_user_data, realloc, block, options
+    )
+end
+
+function mts_block_serialized_size(block::Ptr{mts_block_t}, options::mts_save_options_t, size::Ptr{UIntptr})
+    ccall((:mts_block_serialized_size, libmetatensor), 
+        mts_status_t,
+        (Ptr{mts_block_t}, mts_save_options_t, Ptr{UIntptr},),
+        block, options, size
+    )
+end
+
+function mts_block_save_into_buffer(buffer::Ptr{UInt8}, buffer_count::UIntptr, written::Ptr{UIntptr}, block::Ptr{mts_block_t}, options::mts_save_options_t)
+    ccall((:mts_block_save_into_buffer, libmetatensor), 
+        mts_status_t,
+        (Ptr{UInt8}, UIntptr, Ptr{UIntptr}, Ptr{mts_block_t}, mts_save_options_t,),
+        buffer, buffer_count, written, block, options
+    )
+end
+
 function mts_tensormap_load(path::Ptr{Cchar}, create_array::mts_create_array_callback_t)
     ccall((:mts_tensormap_load, libmetatensor), 
         Ptr{mts_tensormap_t},
@@ -392,6 +567,14 @@ function mts_tensormap_load(path::Ptr{Cchar}, create_array::mts_create_array_cal
     )
 end
 
+function mts_tensormap_load_with_options(path::Ptr{Cchar}, create_array::mts_create_array_callback_t, options::mts_load_options_t)
+    ccall((:mts_tensormap_load_with_options, libmetatensor), 
+        Ptr{mts_tensormap_t},
+        (Ptr{Cchar}, mts_create_array_callback_t, mts_load_options_t,),
+        path, create_array, options
+    )
+end
+
 function mts_tensormap_load_buffer(buffer::Ptr{UInt8}, buffer_count::UIntptr, create_array::mts_create_array_callback_t)
     ccall((:mts_tensormap_load_buffer, libmetatensor), 
         Ptr{mts_tensormap_t},
@@ -400,6 +583,22 @@ function mts_tensormap_load_buffer(buffer::Ptr{UInt8}, buffer_count::UIntptr, cr
     )
 end
 
+function mts_tensormap_load_buffer_with_options(buffer::Ptr{UInt8}, buffer_count::UIntptr, create_array::mts_create_array_callback_t, options::mts_load_options_t)
+    ccall((:mts_tensormap_load_buffer_with_options, libmetatensor), 
+        Ptr{mts_tensormap_t},
+        (Ptr{UInt8}, UIntptr, mts_create_array_callback_t, mts_load_options_t,),
+        buffer, buffer_count, create_array, options
+    )
+end
+
+function mts_tensormap_load_mmap(path::Ptr{Cchar}, create_array::mts_create_mmap_array_callback_t)
+    ccall((:mts_tensormap_load_mmap, libmetatensor), 
+        Ptr{mts_tensormap_t},
+        (Ptr{Cchar}, mts_create_mmap_array_callback_t,),
+        path, create_array
+    )
+end
+
 function mts_tensormap_save(path::Ptr{Cchar}, tensor::Ptr{mts_tensormap_t})
     ccall((:mts_tensormap_save, libmetatensor), 
         mts_status_t,
@@ -408,6 +607,14 @@ function mts_tensormap_save(path::Ptr{Cchar}, tensor::Ptr{mts_tensormap_t})
     )
 end
 
+function mts_tensormap_save_with_options(path::Ptr{Cchar}, tensor::Ptr{mts_tensormap_t}, options::mts_save_options_t)
+    ccall((:mts_tensormap_save_with_options, libmetatensor), 
+        mts_status_t,
+        (Ptr{Cchar}, Ptr{mts_tensormap_t}, mts_save_options_t,),
+        path, tensor, options
+    )
+end
+
 function mts_tensormap_save_buffer(buffer::Ptr{Ptr{UInt8}}, buffer_count::Ptr{UIntptr}, realloc_user_data::Ptr{Cvoid}, realloc::mts_realloc_buffer_t, tensor::Ptr{mts_tensormap_t})
     ccall((:mts_tensormap_save_buffer, libmetatensor), 
         mts_status_t,
@@ -415,3 +622,107 @@ function mts_tensormap_save_buffer(buffer::Ptr{Ptr{UInt8}}, buffer_count::Ptr{UI
         buffer, buffer_count, realloc_user_data, realloc, tensor
     )
 end
+
+function mts_tensormap_save_buffer_with_options(buffer::Ptr{Ptr{UInt8}}, buffer_count::Ptr{UIntptr}, realloc_user_data::Ptr{Cvoid}, realloc::mts_realloc_buffer_t, tensor::Ptr{mts_tensormap_t}, options::mts_save_options_t)
+    ccall((:mts_tensormap_save_buffer_with_options, libmetatensor), 
+        mts_status_t,
+        (Ptr{Ptr{UInt8}}, Ptr{UIntptr}, Ptr{Cvoid}, mts_realloc_buffer_t, Ptr{mts_tensormap_t}, mts_save_options_t,),
+        buffer, buffer_count, realloc_user_data, realloc, tensor, options
+    )
+end
+
+function mts_tensormap_serialized_size(tensor::Ptr{mts_tensormap_t}, options::mts_save_options_t, size::Ptr{UIntptr})
+    ccall((:mts_tensormap_serialized_size, libmetatensor), 
+        mts_status_t,
+        (Ptr{mts_tensormap_t}, mts_save_options_t, Ptr{UIntptr},),
+        tensor, options, size
+    )
+end
+
+function mts_tensormap_save_into_buffer(buffer::Ptr{UInt8}, buffer_count::UIntptr, written::Ptr{UIntptr}, tensor::Ptr{mts_tensormap_t}, options::mts_save_options_t)
+    ccall((:mts_tensormap_save_into_buffer, libmetatensor), 
+        mts_status_t,
+        (Ptr{UInt8}, UIntptr, Ptr{UIntptr}, Ptr{mts_tensormap_t}, mts_save_options_t,),
+        buffer, buffer_count, written, tensor, options
+    )
+end
+
+function mts_mmap_free(mmap::Ptr{mts_mmap_t})
+    ccall((:mts_mmap_free, libmetatensor), 
+        mts_status_t,
+        (Ptr{mts_mmap_t},),
+        mmap
+    )
+end
+
+function mts_tensormap_reader_open(path::Ptr{Cchar})
+    ccall((:mts_tensormap_reader_open, libmetatensor), 
+        Ptr{mts_tensormap_reader_t},
+        (Ptr{Cchar},),
+        path
+    )
+end
+
+function mts_tensormap_reader_free(reader::Ptr{mts_tensormap_reader_t})
+    ccall((:mts_tensormap_reader_free, libmetatensor), 
+        mts_status_t,
+        (Ptr{mts_tensormap_reader_t},),
+        reader
+    )
+end
+
+function mts_tensormap_reader_keys(reader::Ptr{mts_tensormap_reader_t}, keys::Ptr{mts_labels_t})
+    ccall((:mts_tensormap_reader_keys, libmetatensor), 
+        mts_status_t,
+        (Ptr{mts_tensormap_reader_t}, Ptr{mts_labels_t},),
+        reader, keys
+    )
+end
+
+function mts_tensormap_reader_blocks_matching(reader::Ptr{mts_tensormap_reader_t}, block_indexes::Ptr{UIntptr}, count::Ptr{UIntptr}, selection::mts_labels_t)
+    ccall((:mts_tensormap_reader_blocks_matching, libmetatensor), 
+        mts_status_t,
+        (Ptr{mts_tensormap_reader_t}, Ptr{UIntptr}, Ptr{UIntptr}, mts_labels_t,),
+        reader, block_indexes, count, selection
+    )
+end
+
+function mts_tensormap_reader_block(reader::Ptr{mts_tensormap_reader_t}, index::UIntptr, create_array::mts_create_array_callback_t)
+    ccall((:mts_tensormap_reader_block, libmetatensor), 
+        Ptr{mts_block_t},
+        (Ptr{mts_tensormap_reader_t}, UIntptr, mts_create_array_callback_t,),
+        reader, index, create_array
+    )
+end
+
+function mts_tensormap_writer_open(path::Ptr{Cchar}, key_names::Ptr{Ptr{Cchar}}, key_names_count::UIntptr, options::mts_save_options_t)
+    ccall((:mts_tensormap_writer_open, libmetatensor), 
+        Ptr{mts_tensormap_writer_t},
+        (Ptr{Cchar}, Ptr{Ptr{Cchar}}, UIntptr, mts_save_options_t,),
+        path, key_names, key_names_count, options
+    )
+end
+
+function mts_tensormap_writer_free(writer::Ptr{mts_tensormap_writer_t})
+    ccall((:mts_tensormap_writer_free, libmetatensor), 
+        mts_status_t,
+        (Ptr{mts_tensormap_writer_t},),
+        writer
+    )
+end
+
+function mts_tensormap_writer_append(writer::Ptr{mts_tensormap_writer_t}, key::Ptr{Int32}, key_count::UIntptr, block::Ptr{mts_block_t})
+    ccall((:mts_tensormap_writer_append, libmetatensor), 
+        mts_status_t,
+        (Ptr{mts_tensormap_writer_t}, Ptr{Int32}, UIntptr, Ptr{mts_block_t},),
+        writer, key, key_count, block
+    )
+end
+
+function mts_tensormap_writer_finish(writer::Ptr{mts_tensormap_writer_t})
+    ccall((:mts_tensormap_writer_finish, libmetatensor), 
+        mts_status_t,
+        (Ptr{mts_tensormap_writer_t},),
+        writer
+    )
+end
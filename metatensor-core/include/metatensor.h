@@ -45,6 +45,64 @@
  */
 #define MTS_INTERNAL_ERROR 255
 
+/**
+ * The type of the elements in an array is not known, or not one of the
+ * other `MTS_DTYPE_*` values
+ */
+#define MTS_DTYPE_UNKNOWN 0
+
+/**
+ * The array contains 64-bit floating point numbers
+ */
+#define MTS_DTYPE_FLOAT64 1
+
+/**
+ * The array contains 32-bit floating point numbers
+ */
+#define MTS_DTYPE_FLOAT32 2
+
+/**
+ * The array contains 16-bit (IEEE 754 half precision) floating point numbers
+ */
+#define MTS_DTYPE_FLOAT16 3
+
+/**
+ * The array contains 32-bit signed integers
+ */
+#define MTS_DTYPE_INT32 4
+
+/**
+ * The array contains 64-bit signed integers
+ */
+#define MTS_DTYPE_INT64 5
+
+/**
+ * Store the data without compression when saving, allowing memory-mapped
+ * loading to use the data in-place
+ */
+#define MTS_COMPRESSION_NONE 0
+
+/**
+ * Compress the data using the DEFLATE algorithm when saving
+ */
+#define MTS_COMPRESSION_DEFLATE 1
+
+/**
+ * Store values and gradients as 64-bit floating point numbers when saving
+ */
+#define MTS_STORAGE_FLOAT64 0
+
+/**
+ * Store values and gradients as 32-bit floating point numbers when saving
+ */
+#define MTS_STORAGE_FLOAT32 1
+
+/**
+ * Store values and gradients as 16-bit (IEEE 754 half precision) floating
+ * point numbers when saving
+ */
+#define MTS_STORAGE_FLOAT16 2
+
 /**
  * Basic building block for tensor map. A single block contains a n-dimensional
  * `mts_array_t`, and n sets of `mts_labels_t` (one for each dimension).
@@ -60,6 +118,38 @@ typedef struct mts_block_t mts_block_t;
  */
 typedef struct mts_tensormap_t mts_tensormap_t;
 
+/**
+ * Opaque type representing a file mapped in memory by
+ * `mts_tensormap_load_mmap` or `mts_block_load_mmap`.
+ *
+ * Each `mts_mmap_t` is a reference to the mapping, which stays valid until
+ * all references have been released with `mts_mmap_free`.
+ */
+typedef struct mts_mmap_t mts_mmap_t;
+
+/**
+ * Opaque type representing a lazy reader for a serialized tensor map, created
+ * with `mts_tensormap_reader_open`.
+ *
+ * Opening a reader only reads the keys of the tensor map and the list of files
+ * in the archive. Blocks are only read from the file and decoded when
+ * requested with `mts_tensormap_reader_block`. A reader can be used from
+ * multiple threads at the same time, but reading blocks is serialized.
+ */
+typedef struct mts_tensormap_reader_t mts_tensormap_reader_t;
+
+/**
+ * Opaque type representing an incremental writer for a tensor map, created
+ * with `mts_tensormap_writer_open`.
+ *
+ * Blocks are written to the file one at a time with
+ * `mts_tensormap_writer_append`, and the file is completed with
+ * `mts_tensormap_writer_finish`. This allows to save tensor maps that do not
+ * fit in memory, the writer only keeps the blocks appended for the current key
+ * in memory, until a block with a different key is appended.
+ */
+typedef struct mts_tensormap_writer_t mts_tensormap_writer_t;
+
 /**
  * Status type returned by all functions in the C API.
  *
@@ -224,8 +314,95 @@ typedef struct mts_array_t {
                                     uintptr_t samples_count,
                                     uintptr_t property_start,
                                     uintptr_t property_end);
+  /**
+   * Get the type of the elements in this array in `dtype`, as one of the
+   * `MTS_DTYPE_*` constants.
+   *
+   * This function can be set to `NULL`, in which case the array is assumed
+   * to contain 64-bit floating point values.
+   */
+  mts_status_t (*dtype)(const void *array, int32_t *dtype);
+  /**
+   * Get a pointer to the underlying data storage in `data`, checking that
+   * the elements in the array have the given `dtype` (one of the
+   * `MTS_DTYPE_*` constants).
+   *
+   * This function should fail if `dtype` is not the type of the elements
+   * in this array, or if the data is not accessible in RAM or not stored as
+   * a C-contiguous array. It can be set to `NULL`, in which case only
+   * `mts_array_t::data` is used to access the data.
+   */
+  mts_status_t (*typed_data)(void *array, int32_t dtype, void **data);
 } mts_array_t;
 
+/**
+ * Options controlling how data is saved by the `*_save_with_options` and
+ * `*_save_buffer_with_options` functions, and by `mts_tensormap_writer_open`.
+ *
+ * A zero-initialized `mts_save_options_t` corresponds to the options used by
+ * `mts_tensormap_save` and `mts_block_save`: no compression, and 64-bit
+ * floating point data. Data saved with any options can be loaded with the
+ * usual loading functions, and is always loaded as 64-bit floating point
+ * numbers.
+ */
+typedef struct mts_save_options_t {
+  /**
+   * Compression method for all the files in the archive, this should be one
+   * of the `MTS_COMPRESSION_XXX` constants
+   */
+  int32_t compression;
+  /**
+   * Floating point type used to store values and gradients, this should be
+   * one of the `MTS_STORAGE_XXX` constants
+   */
+  int32_t storage_type;
+} mts_save_options_t;
+
+/**
+ * Options controlling how data is loaded by
+ * `mts_tensormap_load_with_options` and
+ * `mts_tensormap_load_buffer_with_options`.
+ *
+ * A zero-initialized `mts_load_options_t` corresponds to the options used by
+ * `mts_tensormap_load` and `mts_tensormap_load_buffer`.
+ */
+typedef struct mts_load_options_t {
+  /**
+   * Number of threads to use when decoding the blocks. With 0 or 1, all
+   * blocks are decoded sequentially on the calling thread. Otherwise, the
+   * blocks are distributed over up to `threads` worker threads, and the
+   * `mts_create_array_callback_t` must be thread-safe.
+   */
+  uintptr_t threads;
+} mts_load_options_t;
+
+/**
+ * Counters collected for a single operation in metatensor, see
+ * `mts_profiling_get`.
+ */
+typedef struct mts_profiling_entry_t {
+  /**
+   * name of the operation, as a NULL-terminated string. This points to
+   * static memory, and is valid until the end of the program.
+   */
+  const char *name;
+  /**
+   * number of calls to this operation
+   */
+  uint64_t calls;
+  /**
+   * cumulative wall-clock time spent in this operation, in nanoseconds
+   */
+  uint64_t time_ns;
+  /**
+   * cumulative number of bytes moved by this operation. This is the size of
+   * the labels values for `labels_create`, and the size of the serialized
+   * data for the `*_load` and `*_save` operations; and zero for all other
+   * operations.
+   */
+  uint64_t bytes;
+} mts_profiling_entry_t;
+
 /**
  * Function pointer to grow in-memory buffers for `mts_tensormap_save_buffer`
  * and `mts_labels_save_buffer`.
@@ -250,11 +427,44 @@ typedef uint8_t *(*mts_realloc_buffer_t)(void *user_data, uint8_t *ptr, uintptr_
  * The newly created array should contains 64-bit floating points (`double`)
  * data, and live on CPU, since metatensor will use `mts_array_t.data` to get
  * the data pointer and write to it.
+ *
+ * When loading data with `mts_load_options_t.threads` larger than 1, this
+ * function can be called concurrently from multiple threads, and must be
+ * thread-safe. Each array is filled with data (using `mts_array_t.data`) on
+ * the thread that created it, and then given back to the thread that called
+ * the loading function.
  */
 typedef mts_status_t (*mts_create_array_callback_t)(const uintptr_t *shape,
                                                     uintptr_t shape_count,
                                                     struct mts_array_t *array);
 
+/**
+ * Function pointer to create a new `mts_array_t` when loading tensor maps
+ * from memory-mapped files.
+ *
+ * This function gets the `shape` of the array (the `shape` contains
+ * `shape_count` elements) and should fill `array` with a new valid
+ * `mts_array_t` or return non-zero `mts_status_t`.
+ *
+ * If `data` is not `NULL`, it points to the 64-bit floating points data for
+ * this array (in row-major order) inside of the memory-mapped file, and the
+ * new array should directly use this memory instead of allocating new memory.
+ * The mapping is private: writing to `data` does not modify the file. In this
+ * case, `mmap` is a new reference to the mapped file, which must be released
+ * with `mts_mmap_free` once the array no longer uses `data`. This function
+ * always takes ownership of `mmap`, even if it returns an error.
+ *
+ * If `data` is `NULL`, the data can not be used in-place and `mmap` is also
+ * `NULL`. The function should then create a new array, exactly like
+ * `mts_create_array_callback_t` does, and metatensor will write the data to
+ * this array.
+ */
+typedef mts_status_t (*mts_create_mmap_array_callback_t)(const uintptr_t *shape,
+                                                         uintptr_t shape_count,
+                                                         double *data,
+                                                         struct mts_mmap_t *mmap,
+                                                         struct mts_array_t *array);
+
 #ifdef __cplusplus
 extern "C" {
 #endif // __cplusplus
@@ -276,6 +486,60 @@ void mts_disable_panic_printing(void);
  */
 const char *mts_version(void);
 
+/**
+ * Set the number of threads used by metatensor for operations on multiple
+ * blocks, such as `mts_tensormap_keys_to_properties` and
+ * `mts_tensormap_keys_to_samples`.
+ *
+ * With more than one thread, the blocks of the output are created in
+ * parallel, and the `mts_array_t` functions of the input arrays (`create`,
+ * `move_samples_from`, ...) can be called concurrently from multiple
+ * threads, each call acting on a different array. The results do not depend
+ * on the number of threads. The default is to use a single thread. Using `0`
+ * sets the number of threads to the number of CPU cores available to the
+ * current process.
+ *
+ * @param threads number of threads to use
+ */
+void mts_set_num_threads(uintptr_t threads);
+
+/**
+ * Get the number of threads used by metatensor for operations on multiple
+ * blocks, as set by `mts_set_num_threads`.
+ */
+uintptr_t mts_get_num_threads(void);
+
+/**
+ * Get the profiling counters for the main operations in metatensor: how
+ * many times they were called, the cumulative time spent in them and the
+ * number of bytes they moved.
+ *
+ * The counters are only collected if metatensor was compiled with profiling
+ * enabled (using the `profiling` cargo feature, or the
+ * `METATENSOR_ENABLE_PROFILING` CMake option). Otherwise, there are no
+ * entries and `count` is always set to 0.
+ *
+ * If `entries` is `NULL`, this function only sets `count` to the number of
+ * available entries. Otherwise, `count` should contain the number of
+ * entries that fit in `entries`, and this function will set it to the
+ * number of entries written. Operations called from inside other operations
+ * (for example from the `mts_array_t` callbacks) are counted for both.
+ *
+ * @param entries array of entries to fill, or `NULL`
+ * @param count pointer to the size of `entries` on input, set to the number
+ *              of entries on output
+ *
+ * @returns The status code of this operation. If the status is not
+ *          `MTS_SUCCESS`, you can use `mts_last_error()` to get the full
+ *          error message.
+ */
+mts_status_t mts_profiling_get(struct mts_profiling_entry_t *entries, uintptr_t *count);
+
+/**
+ * Reset all the profiling counters to zero.
+ */
+void mts_profiling_reset(void);
+
 /**
  * Get the last error message that was created on the current thread.
  *
@@ -303,6 +567,63 @@ mts_status_t mts_labels_position(struct mts_labels_t labels,
                                  uintptr_t values_count,
                                  int64_t *result);
 
+/**
+ * Get the positions of multiple entries in the given set of `labels`, in a
+ * single call. This operation is only available if the labels correspond to a
+ * set of Rust Labels (i.e. `labels.internal_ptr_` is not NULL).
+ *
+ * `values` should point to a 2D row-major array of shape `(count, size)`,
+ * where `size` must match the size of `labels`. On output, `result` (which
+ * must contain space for `count` elements) contains the position of each entry
+ * in the labels, or -1 for entries which are not part of the labels.
+ *
+ * @param labels set of labels with an associated Rust data structure
+ * @param values array containing the entries to lookup
+ * @param count number of entries to lookup
+ * @param size size of each entry, this should be the same as `labels.size`
+ * @param result positions of the entries in the labels or -1 if the
+ *               corresponding entry was not found
+ *
+ * @returns The status code of this operation. If the status is not
+ *          `MTS_SUCCESS`, you can use `mts_last_error()` to get the full
+ *          error message.
+ */
+mts_status_t mts_labels_positions(struct mts_labels_t labels,
+                                  const int32_t *values,
+                                  uintptr_t count,
+                                  uintptr_t size,
+                                  int64_t *result);
+
+/**
+ * Get the range of rows `[start, end)` in the given set of `labels` containing
+ * all the entries starting with the values in `prefix`, i.e. all the entries
+ * where the first `prefix_count` dimensions match `prefix`. This operation is
+ * only available if the labels correspond to a set of Rust Labels (i.e.
+ * `labels.internal_ptr_` is not NULL).
+ *
+ * If the labels are sorted in lexicographic order, this uses a binary search
+ * and an empty range (`start == end`) indicates where entries with this
+ * prefix would be inserted. Otherwise, all the entries are checked, and this
+ * function returns an error if the matching entries are not contiguous. An
+ * empty range with `start == end == 0` is returned if no entry matches.
+ *
+ * @param labels set of labels with an associated Rust data structure
+ * @param prefix array containing the values of the first dimensions to match
+ * @param prefix_count size of the `prefix` array, this should be smaller or
+ *                     equal to `labels.size`
+ * @param start on output, the index of the first matching entry
+ * @param end on output, one past the index of the last matching entry
+ *
+ * @returns The status code of this operation. If the status is not
+ *          `MTS_SUCCESS`, you can use `mts_last_error()` to get the full
+ *          error message.
+ */
+mts_status_t mts_labels_range_of(struct mts_labels_t labels,
+                                 const int32_t *prefix,
+                                 uintptr_t prefix_count,
+                                 uintptr_t *start,
+                                 uintptr_t *end);
+
 /**
  * Finish the creation of `mts_labels_t` by associating it to Rust-owned
  * labels.
@@ -321,6 +642,61 @@ mts_status_t mts_labels_position(struct mts_labels_t labels,
  */
 mts_status_t mts_labels_create(struct mts_labels_t *labels);
 
+/**
+ * Finish the creation of `mts_labels_t` by associating it to Rust-owned
+ * labels, assuming that all the entries in `labels` are already unique.
+ *
+ * This is identical to `mts_labels_create`, but does not check that the
+ * entries are unique (this check is still done when metatensor is built in
+ * debug mode). This is faster when the labels are known to be unique by
+ * construction. Creating labels with duplicated entries with this function
+ * will result in unspecified behavior in other functions using these labels.
+ *
+ * This function allocates memory which must be released `mts_labels_free` when
+ * you don't need it anymore.
+ *
+ * @param labels new set of labels containing pointers to user-managed memory
+ *        on input, and pointers to Rust-managed memory on output.
+ * @returns The status code of this operation. If the status is not
+ *          `MTS_SUCCESS`, you can use `mts_last_error()` to get the full
+ *          error message.
+ */
+mts_status_t mts_labels_create_assume_unique(struct mts_labels_t *labels);
+
+/**
+ * Finish the creation of `mts_labels_t` by associating it to Rust-owned
+ * labels, without copying the values.
+ *
+ * This is identical to `mts_labels_create` (or to
+ * `mts_labels_create_assume_unique` if `assume_unique` is true), except that
+ * the Rust labels directly use the memory pointed to by `labels->values`
+ * instead of a copy. This memory must stay alive and must not be modified
+ * until `values_owner_delete` is called with `values_owner`, which happens
+ * when the last reference to the Rust labels is released.
+ *
+ * If this function fails, `values_owner_delete` is not called and the caller
+ * is still responsible for releasing `values_owner`.
+ *
+ * This function allocates memory which must be released `mts_labels_free` when
+ * you don't need it anymore.
+ *
+ * @param labels new set of labels containing pointers to user-managed memory
+ *        on input, and pointers to Rust-managed memory on output (with
+ *        `labels->values` unchanged).
+ * @param assume_unique should we skip the check that all entries are unique?
+ * @param values_owner pointer to the data owning the memory of
+ *        `labels->values`
+ * @param values_owner_delete function pointer that will be used (if not NULL)
+ *        to release `values_owner` when the labels are freed.
+ * @returns The status code of this operation. If the status is not
+ *          `MTS_SUCCESS`, you can use `mts_last_error()` to get the full
+ *          error message.
+ */
+mts_status_t mts_labels_create_borrowed(struct mts_labels_t *labels,
+                                        bool assume_unique,
+                                        void *values_owner,
+                                        void (*values_owner_delete)(void*));
+
 /**
  * Update the registered user data in `labels`
  *
@@ -870,6 +1246,69 @@ struct mts_tensormap_t *mts_tensormap_keys_to_samples(const struct mts_tensormap
                                                       struct mts_labels_t keys_to_move,
                                                       bool sort_samples);
 
+/**
+ * Split the samples of all the blocks in a tensor map into `output_count`
+ * new tensor maps, in a single pass over the data.
+ *
+ * The shard of each sample is determined by the value `v` of the `dimension`
+ * samples dimension: the sample goes to the tensor map `output[shards[v]]`.
+ * All the values of this dimension must be between 0 (included) and
+ * `shards_count` (excluded), and all the entries in `shards` must be smaller
+ * than `output_count`.
+ *
+ * All the new tensor maps have the same keys as `tensor`, and blocks with the
+ * same components and properties. Blocks without any sample in a given shard
+ * are kept as empty blocks. The samples are kept in the same order as in the
+ * original blocks, and gradients are split along with their samples.
+ * Gradients of gradients are not supported.
+ *
+ * The tensor maps stored in `output` must be freed with `mts_tensormap_free`
+ * when they are no longer needed. They can be merged back together with
+ * `mts_tensormap_merge_samples`.
+ *
+ * @param tensor pointer to an existing tensor map
+ * @param dimension name of the samples dimension used to find the shard of
+ *                  each sample, as a NULL-terminated UTF-8 string
+ * @param shards shard for each value of `dimension`
+ * @param shards_count number of entries in the `shards` array
+ * @param output array of `output_count` pointers, which will be set to the
+ *               newly allocated tensor maps
+ * @param output_count number of shards to create
+ *
+ * @returns The status code of this operation. If the status is not
+ *          `MTS_SUCCESS`, you can use `mts_last_error()` to get the full
+ *          error message.
+ */
+mts_status_t mts_tensormap_split_samples(const struct mts_tensormap_t *tensor,
+                                         const char *dimension,
+                                         const uintptr_t *shards,
+                                         uintptr_t shards_count,
+                                         struct mts_tensormap_t **output,
+                                         uintptr_t output_count);
+
+/**
+ * Merge tensor maps created by `mts_tensormap_split_samples` back into a
+ * single tensor map.
+ *
+ * All the `tensors` must have the same keys, and the blocks with the same key
+ * must have the same samples names, components, properties and gradients.
+ * The samples of the merged blocks contain all the samples from the first
+ * tensor map, followed by all the samples from the second tensor map, etc.
+ * The samples must all be different from one another.
+ *
+ * The memory allocated by this function should be released using
+ * `mts_tensormap_free`.
+ *
+ * @param tensors array of pointers to the tensor maps to merge
+ * @param tensors_count number of entries in the `tensors` array
+ *
+ * @returns A pointer to the newly allocated tensor map, or a `NULL` pointer
+ *          in case of error. In case of error, you can use `mts_last_error()`
+ *          to get the error message.
+ */
+struct mts_tensormap_t *mts_tensormap_merge_samples(const struct mts_tensormap_t *const *tensors,
+                                                    uintptr_t tensors_count);
+
 /**
  * Load labels from the file at the given path.
  *
@@ -951,6 +1390,48 @@ mts_status_t mts_labels_save_buffer(uint8_t **buffer,
                                     mts_realloc_buffer_t realloc,
                                     struct mts_labels_t labels);
 
+/**
+ * Get the exact number of bytes needed to save these labels, i.e. the size of
+ * the buffer for `mts_labels_save_into_buffer` or the number of bytes written
+ * by `mts_labels_save_buffer`.
+ *
+ * This goes through all the serialization steps without storing the data, so
+ * it costs about as much as saving the labels itself.
+ *
+ * @param labels labels that will be saved
+ * @param size on output, will contain the size of the serialized data in
+ *             bytes
+ *
+ * @returns The status code of this operation. If the status is not
+ *          `MTS_SUCCESS`, you can use `mts_last_error()` to get the full error
+ *          message.
+ */
+mts_status_t mts_labels_serialized_size(struct mts_labels_t labels,
+                                        uintptr_t *size);
+
+/**
+ * Save these labels to an existing in-memory buffer, without any
+ * reallocation.
+ *
+ * The buffer must be large enough to contain the whole serialized data, which
+ * size can be obtained with `mts_labels_serialized_size`. The data written to
+ * the buffer is the same as the one produced by `mts_labels_save_buffer`.
+ *
+ * @param buffer pointer to the start of the buffer
+ * @param buffer_count size of the buffer, in bytes
+ * @param written on output, will contain the number of bytes written to the
+ *                buffer
+ * @param labels labels that will be saved to the buffer
+ *
+ * @returns The status code of this operation. If the status is not
+ *          `MTS_SUCCESS`, you can use `mts_last_error()` to get the full error
+ *          message.
+ */
+mts_status_t mts_labels_save_into_buffer(uint8_t *buffer,
+                                         uintptr_t buffer_count,
+                                         uintptr_t *written,
+                                         struct mts_labels_t labels);
+
 /**
  * Load a tensor block from the file at the given path.
  *
@@ -997,6 +1478,35 @@ struct mts_block_t *mts_block_load_buffer(const uint8_t *buffer,
                                           uintptr_t buffer_count,
                                           mts_create_array_callback_t create_array);
 
+/**
+ * Load a tensor block from the file at the given path, using a memory map to
+ * access the file content.
+ *
+ * Whenever possible, the arrays will directly use the memory of the mapped
+ * file, without copying the data. See `mts_tensormap_load_mmap` for more
+ * information.
+ *
+ * Arrays for the values and gradient data will be created with the given
+ * `create_array` callback, see `mts_create_mmap_array_callback_t` for more
+ * information.
+ *
+ * The memory allocated by this function should be released using
+ * `mts_block_free`.
+ *
+ * See `mts_tensormap_load` for more information about the format used to
+ * serialize the data.
+ *
+ * @param path path to the file as a NULL-terminated UTF-8 string
+ * @param create_array callback function that will be used to create data
+ *                     arrays inside each block
+ *
+ * @returns A pointer to the newly allocated tensor block, or a `NULL` pointer in
+ *          case of error. In case of error, you can use `mts_last_error()`
+ *          to get the error message.
+ */
+struct mts_block_t *mts_block_load_mmap(const char *path,
+                                        mts_create_mmap_array_callback_t create_array);
+
 /**
  * Save a tensor block to the file at the given path.
  *
@@ -1011,6 +1521,27 @@ struct mts_block_t *mts_block_load_buffer(const uint8_t *buffer,
  */
 mts_status_t mts_block_save(const char *path, const struct mts_block_t *block);
 
+/**
+ * Save a tensor block to the file at the given path.
+ *
+ * This is the same as `mts_block_save`, using the given `options` to control
+ * the compression of the file and the floating point type used to store data.
+ *
+ * If the file already exists, it is overwritten.
+ *
+ * @param path path to the file as a NULL-terminated UTF-8 string
+ * @param block tensor block to save to the file
+ * @param options options controlling the compression and floating point
+ *                type used to store the data
+ *
+ * @returns The status code of this operation. If the status is not
+ *          `MTS_SUCCESS`, you can use `mts_last_error()` to get the full
+ *          error message.
+ */
+mts_status_t mts_block_save_with_options(const char *path,
+                                         const struct mts_block_t *block,
+                                         struct mts_save_options_t options);
+
 /**
  * Save a tensor block to an in-memory buffer.
  *
@@ -1043,6 +1574,95 @@ mts_status_t mts_block_save_buffer(uint8_t **buffer,
                                    mts_realloc_buffer_t realloc,
                                    const struct mts_block_t *block);
 
+/**
+ * Save a tensor block to an in-memory buffer.
+ *
+ * This is the same as `mts_block_save_buffer`, using the given `options` to
+ * control the compression of the data and the floating point type used to
+ * store it.
+ *
+ * On input, `*buffer` should contain the address of a starting buffer (which
+ * can be NULL) and `*buffer_count` should contain the size of the allocation.
+ *
+ * On output, `*buffer` will contain the serialized data, and `*buffer_count`
+ * the total number of written bytes (which might be less than the allocation
+ * size).
+ *
+ * Users of this function are responsible for freeing the `*buffer` when they
+ * are done with it, using the function matching the `realloc` callback.
+ *
+ * @param buffer pointer to the buffer the block will be stored to, which can
+ *        change due to reallocations.
+ * @param buffer_count pointer to the buffer size on input, number of written
+ *        bytes on output
+ * @param realloc_user_data custom data for the `realloc` callback. This will
+ *        be passed as the first argument to `realloc` as-is.
+ * @param realloc function that allows to grow the buffer allocation
+ * @param block tensor block that will saved to the buffer
+ * @param options options controlling the compression and floating point
+ *                type used to store the data
+ *
+ * @returns The status code of this operation. If the status is not
+ *          `MTS_SUCCESS`, you can use `mts_last_error()` to get the full error
+ *          message.
+ */
+mts_status_t mts_block_save_buffer_with_options(uint8_t **buffer,
+                                                uintptr_t *buffer_count,
+                                                void *realloc_user_data,
+                                                mts_realloc_buffer_t realloc,
+                                                const struct mts_block_t *block,
+                                                struct mts_save_options_t options);
+
+/**
+ * Get the exact number of bytes needed to save this tensor block with the
+ * given `options`, i.e. the size of the buffer for
+ * `mts_block_save_into_buffer` or the number of bytes written by
+ * `mts_block_save_buffer_with_options`.
+ *
+ * This goes through all the serialization steps without storing the data, so
+ * it costs about as much as saving the tensor block itself.
+ *
+ * @param block tensor block that will be saved
+ * @param options options controlling the compression and floating point
+ *                type used to store the data
+ * @param size on output, will contain the size of the serialized data in
+ *             bytes
+ *
+ * @returns The status code of this operation. If the status is not
+ *          `MTS_SUCCESS`, you can use `mts_last_error()` to get the full error
+ *          message.
+ */
+mts_status_t mts_block_serialized_size(const struct mts_block_t *block,
+                                       struct mts_save_options_t options,
+                                       uintptr_t *size);
+
+/**
+ * Save this tensor block to an existing in-memory buffer with the given
+ * `options`, without any reallocation.
+ *
+ * The buffer must be large enough to contain the whole serialized data, which
+ * size can be obtained with `mts_block_serialized_size`. The data written to
+ * the buffer is the same as the one produced by
+ * `mts_block_save_buffer_with_options`.
+ *
+ * @param buffer pointer to the start of the buffer
+ * @param buffer_count size of the buffer, in bytes
+ * @param written on output, will contain the number of bytes written to the
+ *                buffer
+ * @param block tensor block that will be saved to the buffer
+ * @param options options controlling the compression and floating point
+ *                type used to store the data
+ *
+ * @returns The status code of this operation. If the status is not
+ *          `MTS_SUCCESS`, you can use `mts_last_error()` to get the full error
+ *          message.
+ */
+mts_status_t mts_block_save_into_buffer(uint8_t *buffer,
+                                        uintptr_t buffer_count,
+                                        uintptr_t *written,
+                                        const struct mts_block_t *block,
+                                        struct mts_save_options_t options);
+
 /**
  * Load a tensor map from the file at the given path.
  *
@@ -1096,6 +1716,31 @@ mts_status_t mts_block_save_buffer(uint8_t **buffer,
 struct mts_tensormap_t *mts_tensormap_load(const char *path,
                                            mts_create_array_callback_t create_array);
 
+/**
+ * Load a tensor map from the file at the given path.
+ *
+ * This is the same as `mts_tensormap_load`, using the given `options` to
+ * control how the data is loaded. In particular, `options.threads` can be
+ * used to decode the blocks in parallel, in which case `create_array` will be
+ * called concurrently from multiple threads (see
+ * `mts_create_array_callback_t` for more information).
+ *
+ * The memory allocated by this function should be released using
+ * `mts_tensormap_free`.
+ *
+ * @param path path to the file as a NULL-terminated UTF-8 string
+ * @param create_array callback function that will be used to create data
+ *                     arrays inside each block
+ * @param options options controlling how the data is loaded
+ *
+ * @returns A pointer to the newly allocated tensor map, or a `NULL` pointer in
+ *          case of error. In case of error, you can use `mts_last_error()`
+ *          to get the error message.
+ */
+struct mts_tensormap_t *mts_tensormap_load_with_options(const char *path,
+                                                        mts_create_array_callback_t create_array,
+                                                        struct mts_load_options_t options);
+
 /**
  * Load a tensor map from the given in-memory buffer.
  *
@@ -1119,6 +1764,66 @@ struct mts_tensormap_t *mts_tensormap_load_buffer(const uint8_t *buffer,
                                                   uintptr_t buffer_count,
                                                   mts_create_array_callback_t create_array);
 
+/**
+ * Load a tensor map from the given in-memory buffer.
+ *
+ * This is the same as `mts_tensormap_load_buffer`, using the given `options`
+ * to control how the data is loaded. In particular, `options.threads` can be
+ * used to decode the blocks in parallel, in which case `create_array` will be
+ * called concurrently from multiple threads (see
+ * `mts_create_array_callback_t` for more information).
+ *
+ * The memory allocated by this function should be released using
+ * `mts_tensormap_free`.
+ *
+ * @param buffer buffer containing a previously serialized `mts_tensormap_t`
+ * @param buffer_count number of elements in the buffer
+ * @param create_array callback function that will be used to create data
+ *                     arrays inside each block
+ * @param options options controlling how the data is loaded
+ *
+ * @returns A pointer to the newly allocated tensor map, or a `NULL` pointer in
+ *          case of error. In case of error, you can use `mts_last_error()`
+ *          to get the error message.
+ */
+struct mts_tensormap_t *mts_tensormap_load_buffer_with_options(const uint8_t *buffer,
+                                                               uintptr_t buffer_count,
+                                                               mts_create_array_callback_t create_array,
+                                                               struct mts_load_options_t options);
+
+/**
+ * Load a tensor map from the file at the given path, using a memory map to
+ * access the file content.
+ *
+ * Whenever possible, the arrays will directly use the memory of the mapped
+ * file, without copying the data. This requires the data to be stored without
+ * compression, with the native endianness, and properly aligned in the file;
+ * which is the case for files created by `mts_tensormap_save` and
+ * `mts_tensormap_save_buffer`. Otherwise the data is copied to newly created
+ * arrays. When loading the same file from multiple processes, the memory
+ * pages containing the data are shared between all of them.
+ *
+ * Arrays for the values and gradient data will be created with the given
+ * `create_array` callback, see `mts_create_mmap_array_callback_t` for more
+ * information.
+ *
+ * The memory allocated by this function should be released using
+ * `mts_tensormap_free`.
+ *
+ * See `mts_tensormap_load` for more information about the format used to
+ * serialize the data.
+ *
+ * @param path path to the file as a NULL-terminated UTF-8 string
+ * @param create_array callback function that will be used to create data
+ *                     arrays inside each block
+ *
+ * @returns A pointer to the newly allocated tensor map, or a `NULL` pointer in
+ *          case of error. In case of error, you can use `mts_last_error()`
+ *          to get the error message.
+ */
+struct mts_tensormap_t *mts_tensormap_load_mmap(const char *path,
+                                                mts_create_mmap_array_callback_t create_array);
+
 /**
  * Save a tensor map to the file at the given path.
  *
@@ -1133,6 +1838,28 @@ struct mts_tensormap_t *mts_tensormap_load_buffer(const uint8_t *buffer,
  */
 mts_status_t mts_tensormap_save(const char *path, const struct mts_tensormap_t *tensor);
 
+/**
+ * Save a tensor map to the file at the given path.
+ *
+ * This is the same as `mts_tensormap_save`, using the given `options` to
+ * control the compression of the file and the floating point type used to
+ * store data.
+ *
+ * If the file already exists, it is overwritten.
+ *
+ * @param path path to the file as a NULL-terminated UTF-8 string
+ * @param tensor tensor map to save to the file
+ * @param options options controlling the compression and floating point
+ *                type used to store the data
+ *
+ * @returns The status code of this operation. If the status is not
+ *          `MTS_SUCCESS`, you can use `mts_last_error()` to get the full
+ *          error message.
+ */
+mts_status_t mts_tensormap_save_with_options(const char *path,
+                                             const struct mts_tensormap_t *tensor,
+                                             struct mts_save_options_t options);
+
 /**
  * Save a tensor map to an in-memory buffer.
  *
@@ -1165,6 +1892,301 @@ mts_status_t mts_tensormap_save_buffer(uint8_t **buffer,
                                        mts_realloc_buffer_t realloc,
                                        const struct mts_tensormap_t *tensor);
 
+/**
+ * Save a tensor map to an in-memory buffer.
+ *
+ * This is the same as `mts_tensormap_save_buffer`, using the given `options`
+ * to control the compression of the data and the floating point type used to
+ * store it.
+ *
+ * On input, `*buffer` should contain the address of a starting buffer (which
+ * can be NULL) and `*buffer_count` should contain the size of the allocation.
+ *
+ * On output, `*buffer` will contain the serialized data, and `*buffer_count`
+ * the total number of written bytes (which might be less than the allocation
+ * size).
+ *
+ * Users of this function are responsible for freeing the `*buffer` when they
+ * are done with it, using the function matching the `realloc` callback.
+ *
+ * @param buffer pointer to the buffer the tensor will be stored to, which can
+ *        change due to reallocations.
+ * @param buffer_count pointer to the buffer size on input, number of written
+ *        bytes on output
+ * @param realloc_user_data custom data for the `realloc` callback. This will
+ *        be passed as the first argument to `realloc` as-is.
+ * @param realloc function that allows to grow the buffer allocation
+ * @param tensor tensor map that will saved to the buffer
+ * @param options options controlling the compression and floating point
+ *                type used to store the data
+ *
+ * @returns The status code of this operation. If the status is not
+ *          `MTS_SUCCESS`, you can use `mts_last_error()` to get the full error
+ *          message.
+ */
+mts_status_t mts_tensormap_save_buffer_with_options(uint8_t **buffer,
+                                                    uintptr_t *buffer_count,
+                                                    void *realloc_user_data,
+                                                    mts_realloc_buffer_t realloc,
+                                                    const struct mts_tensormap_t *tensor,
+                                                    struct mts_save_options_t options);
+
+/**
+ * Get the exact number of bytes needed to save this tensor map with the given
+ * `options`, i.e. the size of the buffer for `mts_tensormap_save_into_buffer`
+ * or the number of bytes written by `mts_tensormap_save_buffer_with_options`.
+ *
+ * This goes through all the serialization steps without storing the data, so
+ * it costs about as much as saving the tensor map itself.
+ *
+ * @param tensor tensor map that will be saved
+ * @param options options controlling the compression and floating point
+ *                type used to store the data
+ * @param size on output, will contain the size of the serialized data in
+ *             bytes
+ *
+ * @returns The status code of this operation. If the status is not
+ *          `MTS_SUCCESS`, you can use `mts_last_error()` to get the full error
+ *          message.
+ */
+mts_status_t mts_tensormap_serialized_size(const struct mts_tensormap_t *tensor,
+                                           struct mts_save_options_t options,
+                                           uintptr_t *size);
+
+/**
+ * Save this tensor map to an existing in-memory buffer with the given
+ * `options`, without any reallocation.
+ *
+ * The buffer must be large enough to contain the whole serialized data, which
+ * size can be obtained with `mts_tensormap_serialized_size`. The data written
+ * to the buffer is the same as the one produced by
+ * `mts_tensormap_save_buffer_with_options`.
+ *
+ * @param buffer pointer to the start of the buffer
+ * @param buffer_count size of the buffer, in bytes
+ * @param written on output, will contain the number of bytes written to the
+ *                buffer
+ * @param tensor tensor map that will be saved to the buffer
+ * @param options options controlling the compression and floating point
+ *                type used to store the data
+ *
+ * @returns The status code of this operation. If the status is not
+ *          `MTS_SUCCESS`, you can use `mts_last_error()` to get the full error
+ *          message.
+ */
+mts_status_t mts_tensormap_save_into_buffer(uint8_t *buffer,
+                                            uintptr_t buffer_count,
+                                            uintptr_t *written,
+                                            const struct mts_tensormap_t *tensor,
+                                            struct mts_save_options_t options);
+
+/**
+ * Release a reference to a memory-mapped file, obtained in a
+ * `mts_create_mmap_array_callback_t`. The file is unmapped once all references
+ * have been released.
+ *
+ * If `mmap` is `NULL`, this function does nothing.
+ *
+ * @param mmap pointer to an existing memory-mapped file, or `NULL`
+ *
+ * @returns The status code of this operation. If the status is not
+ *          `MTS_SUCCESS`, you can use `mts_last_error()` to get the full
+ *          error message.
+ */
+mts_status_t mts_mmap_free(struct mts_mmap_t *mmap);
+
+/**
+ * Open the file at the given path for lazy reading of a serialized tensor map.
+ *
+ * This only reads the keys of the tensor map and the ZIP central directory,
+ * the blocks themselves can then be loaded individually with
+ * `mts_tensormap_reader_block`. See `mts_tensormap_load` for more
+ * information about the format used to serialize the data.
+ *
+ * The memory allocated by this function should be released using
+ * `mts_tensormap_reader_free`. The file stays open until then.
+ *
+ * @param path path to the file as a NULL-terminated UTF-8 string
+ *
+ * @returns A pointer to the newly allocated reader, or a `NULL` pointer in
+ *          case of error. In case of error, you can use `mts_last_error()`
+ *          to get the error message.
+ */
+struct mts_tensormap_reader_t *mts_tensormap_reader_open(const char *path);
+
+/**
+ * Free the memory associated with a `reader` previously created with
+ * `mts_tensormap_reader_open`, and close the corresponding file.
+ *
+ * Blocks previously loaded with `mts_tensormap_reader_block` stay valid.
+ *
+ * If `reader` is `NULL`, this function does nothing.
+ *
+ * @param reader pointer to an existing tensor map reader, or `NULL`
+ *
+ * @returns The status code of this operation. If the status is not
+ *          `MTS_SUCCESS`, you can use `mts_last_error()` to get the full
+ *          error message.
+ */
+mts_status_t mts_tensormap_reader_free(struct mts_tensormap_reader_t *reader);
+
+/**
+ * Get the keys of the tensor map being read by this `reader`.
+ *
+ * This function allocates memory for `keys` which must be released
+ * `mts_labels_free` when you don't need it anymore.
+ *
+ * @param reader pointer to an existing tensor map reader
+ * @param keys pointer to be filled with the keys of the tensor map
+ *
+ * @returns The status code of this operation. If the status is not
+ *          `MTS_SUCCESS`, you can use `mts_last_error()` to get the full
+ *          error message.
+ */
+mts_status_t mts_tensormap_reader_keys(const struct mts_tensormap_reader_t *reader,
+                                       struct mts_labels_t *keys);
+
+/**
+ * Get indices of the blocks corresponding to the given `selection` in the
+ * tensor map being read by this `reader`, without loading any block. This
+ * follows the same rules as `mts_tensormap_blocks_matching`.
+ *
+ * When calling this function, `*count` should contain the number of entries in
+ * `block_indexes`, which must be the number of keys. When the function returns
+ * successfully, `*count` will contain the number of blocks matching the
+ * selection, i.e. how many values were written to `block_indexes`.
+ *
+ * @param reader pointer to an existing tensor map reader
+ * @param block_indexes array to be filled with indexes of blocks in the tensor
+ *                      map matching the `selection`
+ * @param count number of entries in `block_indexes`
+ * @param selection labels with a single entry describing which blocks are requested
+ *
+ * @returns The status code of this operation. If the status is not
+ *          `MTS_SUCCESS`, you can use `mts_last_error()` to get the full
+ *          error message.
+ */
+mts_status_t mts_tensormap_reader_blocks_matching(const struct mts_tensormap_reader_t *reader,
+                                                  uintptr_t *block_indexes,
+                                                  uintptr_t *count,
+                                                  struct mts_labels_t selection);
+
+/**
+ * Read and decode the `index`-th block of the tensor map being read by this
+ * `reader`.
+ *
+ * Arrays for the values and gradient data will be created with the given
+ * `create_array` callback, and filled by this function with the corresponding
+ * data.
+ *
+ * The returned block is independent from the `reader`, and the memory
+ * allocated by this function should be released using `mts_block_free`.
+ *
+ * @param reader pointer to an existing tensor map reader
+ * @param index index of the block to load
+ * @param create_array callback function that will be used to create data
+ *                     arrays inside the block
+ *
+ * @returns A pointer to the newly allocated block, or a `NULL` pointer in
+ *          case of error. In case of error, you can use `mts_last_error()`
+ *          to get the error message.
+ */
+struct mts_block_t *mts_tensormap_reader_block(const struct mts_tensormap_reader_t *reader,
+                                               uintptr_t index,
+                                               mts_create_array_callback_t create_array);
+
+/**
+ * Create a new incremental writer for a tensor map with keys containing the
+ * given `key_names` dimensions, writing to the file at the given `path`.
+ *
+ * The file is created if it does not exist, and overwritten otherwise. The
+ * data is written with the same format as `mts_tensormap_save`, and can be
+ * loaded with `mts_tensormap_load` once `mts_tensormap_writer_finish` has been
+ * called.
+ *
+ * `key_names` must be an array of `key_names_count` NULL-terminated strings,
+ * encoded as UTF-8. The `options` control the compression of the file and the
+ * floating point type used to store the data, see `mts_save_options_t`.
+ *
+ * The memory allocated by this function should be released using
+ * `mts_tensormap_writer_free`.
+ *
+ * @param path path to the file as a NULL-terminated UTF-8 string
+ * @param key_names names of the dimensions of the keys
+ * @param key_names_count number of entries in the `key_names` array
+ * @param options options controlling the compression and floating point
+ *                type used to store the data
+ *
+ * @returns A pointer to the newly allocated writer, or a `NULL` pointer in
+ *          case of error. In case of error, you can use `mts_last_error()`
+ *          to get the error message.
+ */
+struct mts_tensormap_writer_t *mts_tensormap_writer_open(const char *path,
+                                                         const char *const *key_names,
+                                                         uintptr_t key_names_count,
+                                                         struct mts_save_options_t options);
+
+/**
+ * Free the memory associated with a `writer` previously created with
+ * `mts_tensormap_writer_open`, and close the corresponding file.
+ *
+ * If `mts_tensormap_writer_finish` was not called on this writer before, the
+ * file will be incomplete and can not be loaded.
+ *
+ * If `writer` is `NULL`, this function does nothing.
+ *
+ * @param writer pointer to an existing tensor map writer, or `NULL`
+ *
+ * @returns The status code of this operation. If the status is not
+ *          `MTS_SUCCESS`, you can use `mts_last_error()` to get the full
+ *          error message.
+ */
+mts_status_t mts_tensormap_writer_free(struct mts_tensormap_writer_t *writer);
+
+/**
+ * Append a `block` with the given `key` to the tensor map being written by
+ * this `writer`.
+ *
+ * If `key` is the same as the key of the previously appended block, the
+ * samples of `block` are added to the samples of this previous block
+ * instead, and the components, properties and gradients of both blocks must
+ * match. Otherwise, `key` must not have been used before: all the samples
+ * for a given key must be appended one after the other.
+ *
+ * The writer takes ownership of the block, which should not be released
+ * separately, even if this function returns an error.
+ *
+ * @param writer pointer to an existing tensor map writer
+ * @param key values of the key associated with the block
+ * @param key_count number of entries in `key`, this must match the number of
+ *                  names given to `mts_tensormap_writer_open`
+ * @param block block to write to the file
+ *
+ * @returns The status code of this operation. If the status is not
+ *          `MTS_SUCCESS`, you can use `mts_last_error()` to get the full
+ *          error message.
+ */
+mts_status_t mts_tensormap_writer_append(struct mts_tensormap_writer_t *writer,
+                                         const int32_t *key,
+                                         uintptr_t key_count,
+                                         struct mts_block_t *block);
+
+/**
+ * Finish writing the tensor map, writing the last block, the keys of the
+ * tensor map and the ZIP central directory to the file, and flushing all data
+ * to disk.
+ *
+ * After this function returns, no more blocks can be appended to the writer,
+ * which must still be released with `mts_tensormap_writer_free`.
+ *
+ * @param writer pointer to an existing tensor map writer
+ *
+ * @returns The status code of this operation. If the status is not
+ *          `MTS_SUCCESS`, you can use `mts_last_error()` to get the full
+ *          error message.
+ */
+mts_status_t mts_tensormap_writer_finish(struct mts_tensormap_writer_t *writer);
+
 #ifdef __cplusplus
 }  // extern "C"
 #endif  // __cplusplus
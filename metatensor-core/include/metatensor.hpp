@@ -2,9 +2,12 @@
 #define METATENSOR_HPP
 
 #include <array>
+#include <mutex>
 #include <vector>
 #include <string>
 #include <memory>
+#include <utility>
+#include <algorithm>
 #include <stdexcept>
 #include <exception>
 #include <functional>
@@ -35,6 +38,8 @@ namespace metatensor {
 class Labels;
 class TensorMap;
 class TensorBlock;
+class TensorMapReader;
+class TensorMapWriter;
 
 /// Exception class used for all errors in metatensor
 class Error: public std::runtime_error {
@@ -43,6 +48,25 @@ public:
     Error(const std::string& message): std::runtime_error(message) {}
 };
 
+/// Set the number of threads used by metatensor for operations on multiple
+/// blocks, such as `TensorMap::keys_to_properties` and
+/// `TensorMap::keys_to_samples`. Using `0` sets the number of threads to the
+/// number of CPU cores available to the current process.
+///
+/// With more than one thread, the arrays of different blocks can be created
+/// and filled concurrently, so the corresponding `DataArrayBase`
+/// implementation must support being used from multiple threads. The results
+/// do not depend on the number of threads.
+inline void set_num_threads(size_t threads) {
+    mts_set_num_threads(threads);
+}
+
+/// Get the number of threads used by metatensor for operations on multiple
+/// blocks, as set by `set_num_threads`.
+inline size_t get_num_threads() {
+    return mts_get_num_threads();
+}
+
 namespace details {
     /// Singleton class storing the last exception throw by a C++ callback.
     ///
@@ -126,18 +150,57 @@ namespace details {
         return result;
     }
 
+    /// Get the N-dimensional index corresponding to the given linear `index`
+    /// and array `shape[ndim]` in row-major order, writing it to
+    /// `result[ndim]`. This function does not allocate.
+    inline void cartesian_index(const size_t* shape, size_t ndim, size_t index, size_t* result) {
+        for (size_t i=ndim; i>0; i--) {
+            result[i - 1] = index % shape[i - 1];
+            index = index / shape[i - 1];
+        }
+        assert(index == 0);
+    }
+
     /// Get the N-dimensional index corresponding to the given linear `index`
     /// and array `shape`
     inline std::vector<size_t> cartesian_index(const std::vector<size_t>& shape, size_t index) {
         auto result = std::vector<size_t>(shape.size(), 0);
-        for (size_t i=0; i<shape.size(); i++) {
-            result[i] = index % shape[i];
-            index = index / shape[i];
-        }
-        assert(index == 0);
+        cartesian_index(shape.data(), shape.size(), index, result.data());
+        return result;
+    }
+
+    /// Get the N-dimensional index corresponding to the given linear `index`
+    /// and fixed-rank array `shape`, without allocating
+    template<size_t N>
+    std::array<size_t, N> cartesian_index(const std::array<size_t, N>& shape, size_t index) {
+        auto result = std::array<size_t, N>();
+        cartesian_index(shape.data(), N, index, result.data());
         return result;
     }
 
+    /// Get the row-major stride of the first dimension of an array with the
+    /// given `shape[ndim]`, i.e. the product of all the dimensions after the
+    /// first one.
+    constexpr size_t row_major_stride(const size_t* shape, size_t ndim) {
+        return ndim <= 1 ? 1 : shape[1] * row_major_stride(shape + 1, ndim - 1);
+    }
+
+    /// Get the linear index corresponding to an empty index, this is the end
+    /// of the recursion for the variadic `fixed_linear_index`.
+    constexpr size_t fixed_linear_index(const size_t*, const size_t*) {
+        return 0;
+    }
+
+    /// Get the linear index corresponding to the N-dimensional index
+    /// `(first, rest...)`, according to the given array `shape` and `strides`.
+    /// The number of indexes is known at compile time, so this recursion is
+    /// fully unrolled.
+    template<typename ...Args>
+    constexpr size_t fixed_linear_index(const size_t* shape, const size_t* strides, size_t first, Args... rest) {
+        return assert(first < shape[0] && "out of bounds"),
+            first * strides[0] + fixed_linear_index(shape + 1, strides + 1, static_cast<size_t>(rest)...);
+    }
+
     /// Get the linear index corresponding to the N-dimensional
     /// `index[index_size]`, according to the given array `shape`
     inline size_t linear_index(const std::vector<size_t>& shape, const size_t* index, size_t index_size) {
@@ -169,7 +232,52 @@ namespace details {
         return linear_index(shape, index.data(), index.size());
     }
 
-    Labels labels_from_cxx(const std::vector<std::string>& names, const int32_t* values, size_t count);
+    Labels labels_from_cxx(const std::vector<std::string>& names, const int32_t* values, size_t count, bool assume_unique);
+}
+
+namespace profiling {
+    /// Counters collected for a single operation in metatensor
+    struct Entry {
+        /// name of the operation
+        std::string name;
+        /// number of calls to this operation
+        uint64_t calls;
+        /// cumulative wall-clock time spent in this operation, in nanoseconds
+        uint64_t time_ns;
+        /// cumulative number of bytes moved by this operation, see
+        /// `mts_profiling_entry_t`
+        uint64_t bytes;
+    };
+
+    /// Get the profiling counters for the main operations in metatensor.
+    ///
+    /// This is empty unless metatensor was compiled with profiling enabled,
+    /// see `mts_profiling_get` for more information.
+    inline std::vector<Entry> get() {
+        uintptr_t count = 0;
+        details::check_status(mts_profiling_get(nullptr, &count));
+
+        auto entries = std::vector<mts_profiling_entry_t>(count);
+        details::check_status(mts_profiling_get(entries.data(), &count));
+
+        auto result = std::vector<Entry>();
+        result.reserve(count);
+        for (size_t i=0; i<count; i++) {
+            result.push_back(Entry{
+                entries[i].name,
+                entries[i].calls,
+                entries[i].time_ns,
+                entries[i].bytes,
+            });
+        }
+
+        return result;
+    }
+
+    /// Reset all the profiling counters to zero
+    inline void reset() {
+        mts_profiling_reset();
+    }
 }
 
 /******************************************************************************/
@@ -185,6 +293,11 @@ namespace details {
 /******************************************************************************/
 
 
+/// N-dimensional array, with a number of dimensions known at runtime (if `N`
+/// is 0, the default) or at compile time (for other values of `N`).
+template<typename T, size_t N = 0>
+class NDArray;
+
 /// Simple N-dimensional array interface
 ///
 /// This class can either be a non-owning view inside some existing memory (for
@@ -196,7 +309,7 @@ namespace details {
 /// simple as possible. Feel free to wrap the corresponding data inside types
 /// with richer API such as Eigen, Boost, etc.
 template<typename T>
-class NDArray {
+class NDArray<T, 0> {
 public:
     /// Create a new empty `NDArray`, with shape `[0, 0]`.
     NDArray(): NDArray(nullptr, {0, 0}, true) {}
@@ -350,7 +463,51 @@ public:
         return false;
     }
 
+    /// Get a fixed-rank view inside this array, with `N` dimensions. This
+    /// throws an exception if this array does not have exactly `N` dimensions.
+    ///
+    /// The view is only valid for as long as this array is, and does not
+    /// allocate any memory. Indexing in the view is cheaper than indexing in
+    /// the array, and can be used in inner loops.
+    ///
+    /// ```
+    /// auto values = block.values();
+    /// auto view = values.view<3>();
+    /// for (size_t i=0; i<view.shape()[0]; i++) {
+    ///     sum += view(i, 0, 1);
+    /// }
+    /// ```
+    template<size_t N>
+    NDArray<T, N> view() const & {
+        return NDArray<T, N>(data_, this->fixed_shape<N>(), /*is_const*/ true);
+    }
+
+    /// Get a fixed-rank view inside this array, with `N` dimensions. The view
+    /// gives non-`const` access to the data if this array does.
+    template<size_t N>
+    NDArray<T, N> view() & {
+        return NDArray<T, N>(data_, this->fixed_shape<N>(), is_const_);
+    }
+
+    template<size_t N>
+    NDArray<T, N> view() && = delete;
+
 private:
+    template<size_t N>
+    std::array<size_t, N> fixed_shape() const {
+        if (shape_.size() != N) {
+            throw Error(
+                "can not create a view with " + std::to_string(N) +
+                " dimensions of an NDArray with " + std::to_string(shape_.size()) +
+                " dimensions"
+            );
+        }
+
+        auto shape = std::array<size_t, N>();
+        std::copy(shape_.begin(), shape_.end(), shape.begin());
+        return shape;
+    }
+
     /// Create an `NDArray` from a pointer to the (row-major) data & shape.
     ///
     /// The `is_const` parameter controls whether this class should allow
@@ -400,6 +557,8 @@ private:
         validate();
     }
 
+    template<typename U, size_t M>
+    friend class NDArray;
     friend class Labels;
 
     void validate() const {
@@ -454,6 +613,209 @@ bool operator!=(const NDArray<T>& lhs, const NDArray<T>& rhs) {
     return !(lhs == rhs);
 }
 
+/// Non-owning view inside an N-dimensional array, where the number of
+/// dimensions `N` is known at compile time.
+///
+/// Contrary to the dynamic `NDArray<T>`, this class does not allocate any
+/// memory, and the strides of the array are pre-computed when creating the
+/// view. Indexing into it is only a few multiplications and additions, making
+/// it usable inside inner loops. The number of indexes is checked at compile
+/// time, while out of bounds accesses are only checked (with `assert`) in debug
+/// mode.
+///
+/// Views can be created directly from a pointer and shape, or from an existing
+/// dynamic array with `NDArray<T>::view<N>()`. Accessing a view is only valid
+/// for as long as the corresponding memory is kept alive.
+template<typename T, size_t N>
+class NDArray {
+public:
+    static_assert(
+        std::is_arithmetic<T>::value,
+        "NDArray only works with integers and floating points"
+    );
+
+    /// Create a new fixed-rank view in `const` memory with the given `shape`.
+    ///
+    /// `data` must point to contiguous memory containing the right number of
+    /// elements as described by the `shape`, which will be interpreted as an
+    /// N-dimensional array in row-major order.
+    NDArray(const T* data, std::array<size_t, N> shape):
+        NDArray(data, shape, /*is_const*/ true) {}
+
+    /// Create a new fixed-rank view in non-`const` memory with the given
+    /// `shape`.
+    ///
+    /// `data` must point to contiguous memory containing the right number of
+    /// elements as described by the `shape`, which will be interpreted as an
+    /// N-dimensional array in row-major order.
+    NDArray(T* data, std::array<size_t, N> shape):
+        NDArray(data, shape, /*is_const*/ false) {}
+
+    /// Get the value inside this view at the given index
+    ///
+    /// ```
+    /// auto view = array.view<3>();
+    ///
+    /// double value = view(2, 3, 1);
+    /// ```
+    template<typename ...Args>
+    T operator()(Args... args) const {
+        static_assert(sizeof...(Args) == N, "wrong number of indexes in NDArray::operator()");
+        return data_[details::fixed_linear_index(shape_.data(), strides_.data(), static_cast<size_t>(args)...)];
+    }
+
+    /// Get a reference to the value inside this view at the given index
+    ///
+    /// ```
+    /// auto view = array.view<3>();
+    ///
+    /// view(2, 3, 1) = 5.2;
+    /// ```
+    template<typename ...Args>
+    T& operator()(Args... args) {
+        static_assert(sizeof...(Args) == N, "wrong number of indexes in NDArray::operator()");
+        if (is_const_) {
+            throw Error("This NDArray is const, can not get non const access to it");
+        }
+        return data_[details::fixed_linear_index(shape_.data(), strides_.data(), static_cast<size_t>(args)...)];
+    }
+
+    /// Get the value inside this view at the given `index`
+    T operator()(const std::array<size_t, N>& index) const {
+        return data_[this->linear_index(index)];
+    }
+
+    /// Get a reference to the value inside this view at the given `index`
+    T& operator()(const std::array<size_t, N>& index) {
+        if (is_const_) {
+            throw Error("This NDArray is const, can not get non const access to it");
+        }
+        return data_[this->linear_index(index)];
+    }
+
+    /// Get the data pointer for this view, i.e. the pointer to the first
+    /// element.
+    const T* data() const {
+        return data_;
+    }
+
+    /// Get the data pointer for this view, i.e. the pointer to the first
+    /// element.
+    T* data() {
+        if (is_const_) {
+            throw Error("This NDArray is const, can not get non const access to it");
+        }
+        return data_;
+    }
+
+    /// Get the shape of this view
+    const std::array<size_t, N>& shape() const {
+        return shape_;
+    }
+
+    /// Get the row-major strides of this view, i.e. how many elements to skip
+    /// in memory to go to the next index along each dimension.
+    const std::array<size_t, N>& strides() const {
+        return strides_;
+    }
+
+    /// Get the total number of elements in this view
+    size_t size() const {
+        return shape_[0] * strides_[0];
+    }
+
+    /// Check if this view is empty, i.e. if at least one of the shape element
+    /// is 0.
+    bool is_empty() const {
+        return this->size() == 0;
+    }
+
+private:
+    NDArray(const T* data, std::array<size_t, N> shape, bool is_const):
+        data_(const_cast<T*>(data)),
+        shape_(shape),
+        strides_(),
+        is_const_(is_const)
+    {
+        for (size_t i=0; i<N; i++) {
+            strides_[i] = details::row_major_stride(shape_.data() + i, N - i);
+        }
+
+        if (this->size() != 0 && data_ == nullptr) {
+            throw Error("invalid parameters to NDArray, got null data pointer and non zero size");
+        }
+    }
+
+    size_t linear_index(const std::array<size_t, N>& index) const {
+        size_t result = 0;
+        for (size_t i=0; i<N; i++) {
+            assert(index[i] < shape_[i] && "out of bounds");
+            result += index[i] * strides_[i];
+        }
+        return result;
+    }
+
+    template<typename U, size_t M>
+    friend class NDArray;
+    friend class Labels;
+
+    /// Pointer to the data used by this view
+    T* data_ = nullptr;
+    /// Shape of this view
+    std::array<size_t, N> shape_;
+    /// Row-major strides of this view
+    std::array<size_t, N> strides_;
+    /// Is this view const? This will dynamically prevent calling non-const
+    /// function on it.
+    bool is_const_ = true;
+};
+
+
+namespace details {
+    /// Get the `MTS_DTYPE_*` constant corresponding to the C++ type `T`. This
+    /// is specialized for all types supported by `TensorBlock::values<T>()`.
+    template <typename T>
+    struct DType {
+        static_assert(sizeof(T) == 0, "unsupported type for typed data access");
+    };
+
+    template <> struct DType<double> {
+        static int32_t value() { return MTS_DTYPE_FLOAT64; }
+    };
+
+    template <> struct DType<float> {
+        static int32_t value() { return MTS_DTYPE_FLOAT32; }
+    };
+
+    template <> struct DType<int32_t> {
+        static int32_t value() { return MTS_DTYPE_INT32; }
+    };
+
+    template <> struct DType<int64_t> {
+        static int32_t value() { return MTS_DTYPE_INT64; }
+    };
+
+    /// Get a pointer to the data of `array`, checking that it contains
+    /// elements of the type `T`
+    template <typename T>
+    T* mts_array_typed_data(mts_array_t array) {
+        auto dtype = DType<T>::value();
+        if (array.typed_data == nullptr) {
+            // this array only supports access to 64-bit floating point data
+            if (dtype != MTS_DTYPE_FLOAT64) {
+                throw Error("this array only supports access to its data as double");
+            }
+
+            double* data = nullptr;
+            details::check_status(array.data(array.ptr, &data));
+            return reinterpret_cast<T*>(data);
+        }
+
+        void* data = nullptr;
+        details::check_status(array.typed_data(array.ptr, dtype, &data));
+        return static_cast<T*>(data);
+    }
+}
 
 /// `DataArrayBase` manages n-dimensional arrays used as data in a block or
 /// tensor map. The array itself if opaque to this library and can come from
@@ -536,6 +898,22 @@ public:
             }, array, data);
         };
 
+        array.dtype = [](const void* array, int32_t* dtype) {
+            return details::catch_exceptions([](const void* array, int32_t* dtype){
+                const auto* cxx_array = static_cast<const DataArrayBase*>(array);
+                *dtype = cxx_array->dtype();
+                return MTS_SUCCESS;
+            }, array, dtype);
+        };
+
+        array.typed_data = [](void* array, int32_t dtype, void** data) {
+            return details::catch_exceptions([](void* array, int32_t dtype, void** data){
+                auto* cxx_array = static_cast<DataArrayBase*>(array);
+                *data = cxx_array->typed_data(dtype);
+                return MTS_SUCCESS;
+            }, array, dtype, data);
+        };
+
         array.shape = [](const void* array, const uintptr_t** shape, uintptr_t* shape_count) {
             return details::catch_exceptions([](const void* array, const uintptr_t** shape, uintptr_t* shape_count){
                 const auto* cxx_array = static_cast<const DataArrayBase*>(array);
@@ -618,15 +996,53 @@ public:
 
     double* data() && = delete;
 
+    /// Get the type of the elements in this array, as one of the
+    /// `MTS_DTYPE_*` constants. The default implementation returns
+    /// `MTS_DTYPE_FLOAT64`.
+    virtual int32_t dtype() const {
+        return MTS_DTYPE_FLOAT64;
+    }
+
+    /// Get a pointer to the underlying data storage, which should contain
+    /// elements with the given `dtype` (one of the `MTS_DTYPE_*` constants).
+    ///
+    /// This function should throw an exception if `dtype` does not match the
+    /// type of the elements in the array. The default implementation calls
+    /// `data()` for `MTS_DTYPE_FLOAT64`, and throws for any other `dtype`.
+    virtual void* typed_data(int32_t dtype) & {
+        if (dtype != MTS_DTYPE_FLOAT64) {
+            throw Error("this array only contains 64-bit floating point data");
+        }
+        return this->data();
+    }
+
+    void* typed_data(int32_t dtype) && = delete;
+
     /// Get the shape of this array
     virtual const std::vector<uintptr_t>& shape() const & = 0;
 
     const std::vector<uintptr_t>& shape() && = delete;
 
-    /// Set the shape of this array to the given `shape`
+    /// Check if the data in this array is stored as a C-contiguous array.
+    ///
+    /// Implementations can keep non-contiguous (strided) views of the data
+    /// after `reshape()` or `swap_axes()`. Code calling `data()` or
+    /// `typed_data()` on such arrays should first create a contiguous copy
+    /// of the array. The default implementation returns `true`.
+    virtual bool is_contiguous() const {
+        return true;
+    }
+
+    /// Set the shape of this array to the given `shape`.
+    ///
+    /// This does not need to make the data contiguous in memory, see
+    /// `is_contiguous()`.
     virtual void reshape(std::vector<uintptr_t> shape) = 0;
 
     /// Swap the axes `axis_1` and `axis_2` in this `array`.
+    ///
+    /// This does not need to make the data contiguous in memory, see
+    /// `is_contiguous()`.
     virtual void swap_axes(uintptr_t axis_1, uintptr_t axis_2) = 0;
 
     /// Set entries in the current array taking data from the `input` array.
@@ -649,6 +1065,109 @@ public:
 };
 
 
+/// Pool of memory buffers, used to re-use the memory of `SimpleDataArray`
+/// instead of allocating new memory for each array.
+///
+/// Arrays created with a pool take their memory from it, and give it back
+/// when they are destroyed. Arrays created by metatensor operations (such as
+/// `TensorMap::keys_to_properties` or `TensorMap::keys_to_samples`) from a
+/// pooled array also use the same pool, so running the same operations
+/// repeatedly on data with the same size only allocates memory during the
+/// first run.
+///
+/// This class is thread-safe, and can be shared between multiple arrays with
+/// `std::shared_ptr`. The `acquire` and `release` functions are virtual, and
+/// can be overridden to plug in other allocation strategies.
+///
+/// ```
+/// auto pool = std::make_shared<metatensor::ArrayPool>();
+/// auto array = std::unique_ptr<SimpleDataArray>(new SimpleDataArray({3, 4}, pool));
+/// ```
+class ArrayPool {
+public:
+    /// Create a new pool, keeping at most `max_buffers` unused buffers
+    /// around. Additional buffers given back to the pool are freed.
+    explicit ArrayPool(size_t max_buffers = 64): max_buffers_(max_buffers) {}
+
+    virtual ~ArrayPool() = default;
+
+    /// ArrayPool is not copy-constructible
+    ArrayPool(const ArrayPool&) = delete;
+    /// ArrayPool can not be copy-assigned
+    ArrayPool& operator=(const ArrayPool&) = delete;
+    /// ArrayPool is not move-constructible
+    ArrayPool(ArrayPool&&) = delete;
+    /// ArrayPool can not be move-assigned
+    ArrayPool& operator=(ArrayPool&&) = delete;
+
+    /// Get a buffer containing `size` elements, re-using the memory of a
+    /// previously released buffer if possible.
+    ///
+    /// If `zero_initialize` is `true`, all the elements are set to zero.
+    /// Otherwise the elements of a re-used buffer are left with whatever
+    /// value they had before, and the caller is expected to overwrite all of
+    /// them.
+    virtual std::vector<double> acquire(size_t size, bool zero_initialize = true) {
+        auto buffer = std::vector<double>();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            // find the smallest buffer which is large enough
+            auto best = buffers_.end();
+            for (auto it = buffers_.begin(); it != buffers_.end(); it++) {
+                if (it->capacity() >= size && (best == buffers_.end() || it->capacity() < best->capacity())) {
+                    best = it;
+                }
+            }
+
+            if (best != buffers_.end()) {
+                buffer = std::move(*best);
+                buffers_.erase(best);
+            }
+        }
+
+        if (zero_initialize) {
+            buffer.assign(size, 0.0);
+        } else {
+            // this only initializes elements past the previous size of the
+            // buffer, re-used elements are kept as-is
+            buffer.resize(size);
+        }
+
+        return buffer;
+    }
+
+    /// Give a `buffer` back to this pool, to be re-used by later calls to
+    /// `acquire`.
+    virtual void release(std::vector<double> buffer) {
+        if (buffer.capacity() == 0) {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (buffers_.size() < max_buffers_) {
+            buffers_.emplace_back(std::move(buffer));
+        }
+    }
+
+    /// Get the number of unused buffers currently stored in this pool
+    size_t available() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return buffers_.size();
+    }
+
+    /// Free all the unused buffers currently stored in this pool
+    void clear() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        buffers_.clear();
+    }
+
+private:
+    size_t max_buffers_;
+    mutable std::mutex mutex_;
+    std::vector<std::vector<double>> buffers_;
+};
+
+
 /// Very basic implementation of DataArrayBase in C++.
 ///
 /// This is included as an example implementation of DataArrayBase, and to make
@@ -674,16 +1193,71 @@ public:
         }
     }
 
-    ~SimpleDataArray() override = default;
+    /// Create a SimpleDataArray with the given `shape`, taking its memory from
+    /// the given `pool`, and giving it back to the `pool` when the array is
+    /// destroyed. Arrays created from this one with `copy()` or `create()`
+    /// use the same pool.
+    ///
+    /// If `zero_initialize` is `false` and the memory is re-used from a
+    /// previous array, the elements are left uninitialized, and the caller
+    /// should overwrite all of them.
+    SimpleDataArray(std::vector<uintptr_t> shape, std::shared_ptr<ArrayPool> pool, bool zero_initialize = true):
+        shape_(std::move(shape)),
+        data_(),
+        pool_(std::move(pool))
+    {
+        if (pool_ == nullptr) {
+            data_ = std::vector<double>(details::product(shape_), 0.0);
+        } else {
+            data_ = pool_->acquire(details::product(shape_), zero_initialize);
+        }
+    }
+
+    ~SimpleDataArray() override {
+        this->release_data();
+    }
 
     /// SimpleDataArray can be copy-constructed
-    SimpleDataArray(const SimpleDataArray&) = default;
+    SimpleDataArray(const SimpleDataArray& other):
+        shape_(other.shape_),
+        data_(),
+        pool_(other.pool_)
+    {
+        if (pool_ == nullptr) {
+            data_ = other.data_;
+        } else {
+            data_ = pool_->acquire(other.data_.size(), /*zero_initialize*/ false);
+            std::copy(other.data_.begin(), other.data_.end(), data_.begin());
+        }
+    }
+
     /// SimpleDataArray can be copy-assigned
-    SimpleDataArray& operator=(const SimpleDataArray&) = default;
+    SimpleDataArray& operator=(const SimpleDataArray& other) {
+        if (this != &other) {
+            shape_ = other.shape_;
+            data_ = other.data_;
+        }
+        return *this;
+    }
+
     /// SimpleDataArray can be move-constructed
     SimpleDataArray(SimpleDataArray&&) noexcept = default;
+
     /// SimpleDataArray can be move-assigned
-    SimpleDataArray& operator=(SimpleDataArray&&) noexcept = default;
+    SimpleDataArray& operator=(SimpleDataArray&& other) noexcept {
+        if (this != &other) {
+            this->release_data();
+            shape_ = std::move(other.shape_);
+            data_ = std::move(other.data_);
+            pool_ = std::move(other.pool_);
+        }
+        return *this;
+    }
+
+    /// Get the pool used by this array, or `nullptr` if it does not use one
+    const std::shared_ptr<ArrayPool>& pool() const {
+        return pool_;
+    }
 
     mts_data_origin_t origin() const override {
         mts_data_origin_t origin = 0;
@@ -707,19 +1281,30 @@ public:
     }
 
     void swap_axes(uintptr_t axis_1, uintptr_t axis_2) override {
-        auto new_data = std::vector<double>(details::product(shape_), 0.0);
+        auto new_data = std::vector<double>();
+        if (pool_ == nullptr) {
+            new_data = std::vector<double>(details::product(shape_), 0.0);
+        } else {
+            // all the elements are overwritten below
+            new_data = pool_->acquire(details::product(shape_), /*zero_initialize*/ false);
+        }
+
         auto new_shape = shape_;
         std::swap(new_shape[axis_1], new_shape[axis_2]);
 
+        auto index = std::vector<size_t>(shape_.size(), 0);
         for (size_t i=0; i<details::product(shape_); i++) {
-            auto index = details::cartesian_index(shape_, i);
+            details::cartesian_index(shape_.data(), shape_.size(), i, index.data());
             std::swap(index[axis_1], index[axis_2]);
 
             new_data[details::linear_index(new_shape, index)] = data_[i];
         }
 
         shape_ = std::move(new_shape);
-        data_ = std::move(new_data);
+        std::swap(data_, new_data);
+        if (pool_ != nullptr) {
+            pool_->release(std::move(new_data));
+        }
     }
 
     std::unique_ptr<DataArrayBase> copy() const override {
@@ -727,7 +1312,7 @@ public:
     }
 
     std::unique_ptr<DataArrayBase> create(std::vector<uintptr_t> shape) const override {
-        return std::unique_ptr<DataArrayBase>(new SimpleDataArray(std::move(shape)));
+        return std::unique_ptr<DataArrayBase>(new SimpleDataArray(std::move(shape), pool_));
     }
 
     void move_samples_from(
@@ -848,8 +1433,21 @@ public:
     }
 
 private:
+    /// Give the memory of this array back to the pool, if there is one
+    void release_data() noexcept {
+        if (pool_ != nullptr) {
+            try {
+                pool_->release(std::move(data_));
+            } catch (...) {
+                // if the pool can not take the memory back, it is freed with
+                // the vector
+            }
+        }
+    }
+
     std::vector<uintptr_t> shape_;
     std::vector<double> data_;
+    std::shared_ptr<ArrayPool> pool_;
 
     friend bool operator==(const SimpleDataArray& lhs, const SimpleDataArray& rhs);
 };
@@ -960,42 +1558,112 @@ namespace details {
 /******************************************************************************/
 
 namespace io {
+    /// Compression method used for the files inside the archive when saving
+    enum class Compression: int32_t {
+        /// Store the data without compression. This allows `load_mmap` to use
+        /// the data in-place.
+        None = MTS_COMPRESSION_NONE,
+        /// Compress the data using the DEFLATE algorithm
+        Deflate = MTS_COMPRESSION_DEFLATE,
+    };
+
+    /// Floating point type used to store values and gradients when saving
+    enum class StorageType: int32_t {
+        /// 64-bit floating point numbers, without loss of precision
+        Float64 = MTS_STORAGE_FLOAT64,
+        /// 32-bit floating point numbers
+        Float32 = MTS_STORAGE_FLOAT32,
+        /// 16-bit (IEEE 754 half precision) floating point numbers
+        Float16 = MTS_STORAGE_FLOAT16,
+    };
+
+    /// Options controlling how `TensorMap` and `TensorBlock` are saved.
+    ///
+    /// Files saved with any options can be loaded with the usual loading
+    /// functions, and the data is always loaded as 64-bit floating points.
+    struct SaveOptions {
+        /// Compression method for all files in the archive
+        Compression compression = Compression::None;
+        /// Floating point type used to store the values and gradients. Using
+        /// a smaller type reduces the size of the file, but loses precision.
+        StorageType storage_type = StorageType::Float64;
+    };
+
+    /// Options controlling how `TensorMap` are loaded.
+    struct LoadOptions {
+        /// Number of threads to use when decoding the blocks. With 0 or 1, all
+        /// blocks are decoded sequentially on the calling thread. Otherwise,
+        /// the blocks are distributed over up to `threads` worker threads, and
+        /// the `create_array` callback can be called concurrently from all of
+        /// them.
+        size_t threads = 1;
+    };
+
     /// Save a `TensorMap` to the file at `path`.
     ///
     /// If the file exists, it will be overwritten.
     ///
     /// `TensorMap` are serialized using numpy's `.npz` format, i.e. a ZIP file
-    /// without compression (storage method is `STORED`), where each file is
-    /// stored as a `.npy` array. See the C API documentation for more
-    /// information on the format.
-    void save(const std::string& path, const TensorMap& tensor);
+    /// where each file is stored as a `.npy` array. By default, the data is
+    /// stored without compression (storage method is `STORED`) as 64-bit
+    /// floating points, this can be changed with `options`. See the C API
+    /// documentation for more information on the format.
+    void save(const std::string& path, const TensorMap& tensor, SaveOptions options = SaveOptions());
 
-    /// Save a `TensorMap` to an in-memory buffer.
+    /// Save a `TensorMap` to an in-memory buffer, using the given `options`.
     ///
     /// The `Buffer` template parameter can be set to any type that can be
     /// constructed from a pair of iterator over `std::vector<uint8_t>`.
     template <typename Buffer = std::vector<uint8_t>>
-    Buffer save_buffer(const TensorMap& tensor);
+    Buffer save_buffer(const TensorMap& tensor, SaveOptions options = SaveOptions());
 
     template<>
-    std::vector<uint8_t> save_buffer<std::vector<uint8_t>>(const TensorMap& tensor);
+    std::vector<uint8_t> save_buffer<std::vector<uint8_t>>(const TensorMap& tensor, SaveOptions options);
+
+    /// Get the exact number of bytes needed to save a `TensorMap`, using the given `options`.
+    ///
+    /// This is the size of the data produced by `save_buffer`, and the minimal
+    /// size of the buffer given to `save_into_buffer`.
+    size_t serialized_size(const TensorMap& tensor, SaveOptions options = SaveOptions());
+
+    /// Save a `TensorMap` to the existing buffer starting at `buffer`, containing
+    /// `buffer_count` bytes, using the given `options`, without any reallocation.
+    ///
+    /// This returns the number of bytes written to the buffer, and throws an
+    /// exception if the buffer is too small. `serialized_size` gives the
+    /// required size of the buffer.
+    size_t save_into_buffer(const TensorMap& tensor, uint8_t* buffer, size_t buffer_count, SaveOptions options = SaveOptions());
 
     /**************************************************************************/
 
-    /// Save a `TensorBlock` to the file at `path`.
+    /// Save a `TensorBlock` to the file at `path`, using the given `options`.
     ///
     /// If the file exists, it will be overwritten.
-    void save(const std::string& path, const TensorBlock& block);
+    void save(const std::string& path, const TensorBlock& block, SaveOptions options = SaveOptions());
 
-    /// Save a `TensorBlock` to an in-memory buffer.
+    /// Save a `TensorBlock` to an in-memory buffer, using the given `options`.
     ///
     /// The `Buffer` template parameter can be set to any type that can be
     /// constructed from a pair of iterator over `std::vector<uint8_t>`.
     template <typename Buffer = std::vector<uint8_t>>
-    Buffer save_buffer(const TensorBlock& block);
+    Buffer save_buffer(const TensorBlock& block, SaveOptions options = SaveOptions());
 
     template<>
-    std::vector<uint8_t> save_buffer<std::vector<uint8_t>>(const TensorBlock& block);
+    std::vector<uint8_t> save_buffer<std::vector<uint8_t>>(const TensorBlock& block, SaveOptions options);
+
+    /// Get the exact number of bytes needed to save a `TensorBlock`, using the given `options`.
+    ///
+    /// This is the size of the data produced by `save_buffer`, and the minimal
+    /// size of the buffer given to `save_into_buffer`.
+    size_t serialized_size(const TensorBlock& block, SaveOptions options = SaveOptions());
+
+    /// Save a `TensorBlock` to the existing buffer starting at `buffer`, containing
+    /// `buffer_count` bytes, using the given `options`, without any reallocation.
+    ///
+    /// This returns the number of bytes written to the buffer, and throws an
+    /// exception if the buffer is too small. `serialized_size` gives the
+    /// required size of the buffer.
+    size_t save_into_buffer(const TensorBlock& block, uint8_t* buffer, size_t buffer_count, SaveOptions options = SaveOptions());
 
     /**************************************************************************/
 
@@ -1014,6 +1682,20 @@ namespace io {
     template<>
     std::vector<uint8_t> save_buffer<std::vector<uint8_t>>(const Labels& labels);
 
+    /// Get the exact number of bytes needed to save `Labels`.
+    ///
+    /// This is the size of the data produced by `save_buffer`, and the minimal
+    /// size of the buffer given to `save_into_buffer`.
+    size_t serialized_size(const Labels& labels);
+
+    /// Save `Labels` to the existing buffer starting at `buffer`, containing
+    /// `buffer_count` bytes, without any reallocation.
+    ///
+    /// This returns the number of bytes written to the buffer, and throws an
+    /// exception if the buffer is too small. `serialized_size` gives the
+    /// required size of the buffer.
+    size_t save_into_buffer(const Labels& labels, uint8_t* buffer, size_t buffer_count);
+
     /**************************************************************************/
     /**************************************************************************/
 
@@ -1036,7 +1718,8 @@ namespace io {
      */
     TensorMap load(
         const std::string& path,
-        mts_create_array_callback_t create_array = details::default_create_array
+        mts_create_array_callback_t create_array = details::default_create_array,
+        LoadOptions options = LoadOptions()
     );
 
     /*!
@@ -1055,7 +1738,8 @@ namespace io {
     TensorMap load_buffer(
         const uint8_t* buffer,
         size_t buffer_count,
-        mts_create_array_callback_t create_array = details::default_create_array
+        mts_create_array_callback_t create_array = details::default_create_array,
+        LoadOptions options = LoadOptions()
     );
 
 
@@ -1068,7 +1752,26 @@ namespace io {
     template <typename Buffer>
     TensorMap load_buffer(
         const Buffer& buffer,
-        mts_create_array_callback_t create_array = details::default_create_array
+        mts_create_array_callback_t create_array = details::default_create_array,
+        LoadOptions options = LoadOptions()
+    );
+
+    /*!
+     * Load a previously saved `TensorMap` from the given path, accessing the
+     * file through a memory map.
+     *
+     * \verbatim embed:rst:leading-asterisk
+     *
+     * ``create_array`` will be used to create new arrays when constructing the
+     * blocks and gradients, and can make these arrays directly use the memory
+     * of the mapped file. See :c:func:`mts_create_mmap_array_callback_t` and
+     * :c:func:`mts_tensormap_load_mmap` for more information.
+     *
+     * \endverbatim
+     */
+    TensorMap load_mmap(
+        const std::string& path,
+        mts_create_mmap_array_callback_t create_array
     );
 
     /**************************************************************************/
@@ -1123,6 +1826,24 @@ namespace io {
         mts_create_array_callback_t create_array = details::default_create_array
     );
 
+    /*!
+     * Load a previously saved `TensorBlock` from the given path, accessing the
+     * file through a memory map.
+     *
+     * \verbatim embed:rst:leading-asterisk
+     *
+     * ``create_array`` will be used to create new arrays when constructing the
+     * blocks and gradients, and can make these arrays directly use the memory
+     * of the mapped file. See :c:func:`mts_create_mmap_array_callback_t` and
+     * :c:func:`mts_block_load_mmap` for more information.
+     *
+     * \endverbatim
+     */
+    TensorBlock load_block_mmap(
+        const std::string& path,
+        mts_create_mmap_array_callback_t create_array
+    );
+
     /**************************************************************************/
 
     /// Load previously saved `Labels` from the given path.
@@ -1142,6 +1863,23 @@ namespace io {
     Labels load_labels_buffer(const Buffer& buffer);
 }
 
+namespace details {
+    /// Convert C++ `io::SaveOptions` to the corresponding C struct
+    inline mts_save_options_t mts_save_options(io::SaveOptions options) {
+        mts_save_options_t c_options;
+        c_options.compression = static_cast<int32_t>(options.compression);
+        c_options.storage_type = static_cast<int32_t>(options.storage_type);
+        return c_options;
+    }
+
+    /// Convert C++ `io::LoadOptions` to the corresponding C struct
+    inline mts_load_options_t mts_load_options(io::LoadOptions options) {
+        mts_load_options_t c_options;
+        c_options.threads = options.threads;
+        return c_options;
+    }
+}
+
 
 /******************************************************************************/
 /******************************************************************************/
@@ -1205,6 +1943,10 @@ private:
 };
 
 
+/// Marker type used to create `Labels` without checking that all the entries
+/// are unique, when they are already known to be unique by construction.
+struct assume_unique {};
+
 /// A set of labels used to carry metadata associated with a tensor map.
 ///
 /// This is similar to an array of named tuples, but stored as a 2D array
@@ -1230,14 +1972,79 @@ public:
         const std::vector<std::initializer_list<int32_t>>& values
     ): Labels(names, NDArray<int32_t>(values, names.size()), InternalConstructor{}) {}
 
-    /// Create an empty set of Labels with the given names
-    explicit Labels(const std::vector<std::string>& names):
-        Labels(names, static_cast<const int32_t*>(nullptr), 0) {}
+    /// Create an empty set of Labels with the given names
+    explicit Labels(const std::vector<std::string>& names):
+        Labels(names, static_cast<const int32_t*>(nullptr), 0) {}
+
+    /// Create labels with the given `names` and `values`. `values` must be an
+    /// array with `count x names.size()` elements.
+    Labels(const std::vector<std::string>& names, const int32_t* values, size_t count):
+        Labels(details::labels_from_cxx(names, values, count, false)) {}
+
+    /// Create a new set of Labels from the given `names` and `values`, assuming
+    /// that all the entries in `values` are unique.
+    ///
+    /// This skips the check for uniqueness of the entries (this check is still
+    /// done when metatensor-core is built in debug mode), and should only be
+    /// used when the entries are known to be unique by construction.
+    ///
+    /// ```
+    /// auto labels = Labels({"first", "second"}, {
+    ///    {0, 1},
+    ///    {1, 4},
+    /// }, metatensor::assume_unique{});
+    /// ```
+    Labels(
+        const std::vector<std::string>& names,
+        const std::vector<std::initializer_list<int32_t>>& values,
+        assume_unique
+    ): Labels(names, NDArray<int32_t>(values, names.size()), assume_unique{}, InternalConstructor{}) {}
+
+    /// Create labels with the given `names` and `values`, assuming that all the
+    /// entries in `values` are unique. `values` must be an array with `count x
+    /// names.size()` elements.
+    ///
+    /// This skips the check for uniqueness of the entries (this check is still
+    /// done when metatensor-core is built in debug mode), and should only be
+    /// used when the entries are known to be unique by construction.
+    Labels(const std::vector<std::string>& names, const int32_t* values, size_t count, assume_unique):
+        Labels(details::labels_from_cxx(names, values, count, true)) {}
+
+    /// Create labels with the given `names` and `values`, without copying
+    /// `values`. `values` must be an array with `count x names.size()`
+    /// elements.
+    ///
+    /// The memory in `values` must stay alive and must not be modified until
+    /// `values_owner_delete` is called with `values_owner`, which happens when
+    /// the last copy of these `Labels` is destroyed. If this function throws,
+    /// `values_owner_delete` is not called.
+    static Labels borrowed(
+        const std::vector<std::string>& names,
+        const int32_t* values,
+        size_t count,
+        void* values_owner,
+        void (*values_owner_delete)(void*),
+        bool assume_unique = false
+    ) {
+        mts_labels_t labels;
+        std::memset(&labels, 0, sizeof(labels));
+
+        auto c_names = std::vector<const char*>();
+        for (const auto& name: names) {
+            c_names.push_back(name.c_str());
+        }
+
+        labels.names = c_names.data();
+        labels.size = c_names.size();
+        labels.count = count;
+        labels.values = values;
+
+        details::check_status(mts_labels_create_borrowed(
+            &labels, assume_unique, values_owner, values_owner_delete
+        ));
 
-    /// Create labels with the given `names` and `values`. `values` must be an
-    /// array with `count x names.size()` elements.
-    Labels(const std::vector<std::string>& names, const int32_t* values, size_t count):
-        Labels(details::labels_from_cxx(names, values, count)) {}
+        return Labels(labels);
+    }
 
     ~Labels() {
         mts_labels_free(&labels_);
@@ -1357,6 +2164,13 @@ public:
         return this->position(entry.data(), entry.size());
     }
 
+    /// Variant of `Labels::position` taking a fixed-rank view as input. This
+    /// can be used with `Labels::entry()` to find entries from another set of
+    /// Labels without allocating memory.
+    int64_t position(const NDArray<int32_t, 1>& entry) const {
+        return this->position(entry.data(), entry.shape()[0]);
+    }
+
     /// Variant of `Labels::position` taking a pointer and length as input
     int64_t position(const int32_t* entry, size_t length) const {
         assert(labels_.internal_ptr_ != nullptr);
@@ -1366,6 +2180,69 @@ public:
         return result;
     }
 
+    /// Get the positions of multiple entries in this set of Labels in a single
+    /// call, with -1 for entries which are not part of these Labels.
+    ///
+    /// `entries` must be a 2-dimensional array, with one entry per row, and the
+    /// same number of columns as the size of these Labels. This can be used
+    /// directly with the `values()` of another set of Labels.
+    std::vector<int64_t> positions(const NDArray<int32_t>& entries) const {
+        if (entries.shape().size() != 2) {
+            throw Error("entries in Labels::positions must be a 2-dimensional array");
+        }
+
+        return this->positions(entries.data(), entries.shape()[0], entries.shape()[1]);
+    }
+
+    /// Variant of `Labels::positions` taking a pointer to a row-major array
+    /// containing `count` entries of `size` values each
+    std::vector<int64_t> positions(const int32_t* entries, size_t count, size_t size) const {
+        assert(labels_.internal_ptr_ != nullptr);
+
+        auto result = std::vector<int64_t>(count, -1);
+        details::check_status(mts_labels_positions(labels_, entries, count, size, result.data()));
+        return result;
+    }
+
+    /// Get the range `[start, end)` of rows in these Labels containing all the
+    /// entries starting with `prefix`, i.e. where the first `prefix.size()`
+    /// dimensions match `prefix`.
+    ///
+    /// For sorted Labels, this uses a binary search instead of checking all
+    /// the entries, and can be used to get a view of all the rows matching
+    /// the prefix. For unsorted Labels, this throws an exception if the
+    /// matching entries are not contiguous.
+    ///
+    /// ```
+    /// auto labels = Labels({"system", "atom"}, {{0, 0}, {0, 1}, {1, 0}, {1, 1}, {1, 2}});
+    /// auto range = labels.range_of({1});
+    /// // range.first == 2, range.second == 5
+    /// ```
+    std::pair<size_t, size_t> range_of(std::initializer_list<int32_t> prefix) const {
+        return this->range_of(prefix.begin(), prefix.size());
+    }
+
+    /// Variant of `Labels::range_of` taking a fixed-size array as prefix
+    template <size_t N>
+    std::pair<size_t, size_t> range_of(const std::array<int32_t, N>& prefix) const {
+        return this->range_of(prefix.data(), prefix.size());
+    }
+
+    /// Variant of `Labels::range_of` taking a vector as prefix
+    std::pair<size_t, size_t> range_of(const std::vector<int32_t>& prefix) const {
+        return this->range_of(prefix.data(), prefix.size());
+    }
+
+    /// Variant of `Labels::range_of` taking a pointer and length as prefix
+    std::pair<size_t, size_t> range_of(const int32_t* prefix, size_t length) const {
+        assert(labels_.internal_ptr_ != nullptr);
+
+        uintptr_t start = 0;
+        uintptr_t end = 0;
+        details::check_status(mts_labels_range_of(labels_, prefix, length, &start, &end));
+        return {static_cast<size_t>(start), static_cast<size_t>(end)};
+    }
+
     /// Get the array of values for these Labels
     const NDArray<int32_t>& values() const & {
         return values_;
@@ -1373,6 +2250,28 @@ public:
 
     const NDArray<int32_t>& values() && = delete;
 
+    /// Get a view of the entry at index `i` in these Labels, containing one
+    /// value for each dimension. This does not allocate memory, and the view is
+    /// only valid for as long as these Labels are alive.
+    ///
+    /// ```
+    /// auto labels = Labels({"system", "atom"}, {{0, 0}, {0, 1}, {1, 0}});
+    /// auto entry = labels.entry(2);
+    /// // entry(0) == 1, entry(1) == 0
+    /// ```
+    NDArray<int32_t, 1> entry(size_t i) const & {
+        if (i >= this->count()) {
+            throw Error(
+                "out of bounds entry in Labels::entry: the index is " +
+                std::to_string(i) + " but there are " + std::to_string(this->count()) +
+                " entries"
+            );
+        }
+        return NDArray<int32_t, 1>(values_.data() + i * this->size(), {this->size()});
+    }
+
+    NDArray<int32_t, 1> entry(size_t i) && = delete;
+
     /// Take the union of these `Labels` with `other`.
     ///
     /// If requested, this function can also give the positions in the union
@@ -1699,11 +2598,15 @@ private:
     Labels(const std::vector<std::string>& names, const NDArray<int32_t>& values, InternalConstructor):
         Labels(names, values.data(), values.shape()[0]) {}
 
-    friend Labels details::labels_from_cxx(const std::vector<std::string>& names, const int32_t* values, size_t count);
+    Labels(const std::vector<std::string>& names, const NDArray<int32_t>& values, assume_unique, InternalConstructor):
+        Labels(names, values.data(), values.shape()[0], assume_unique{}) {}
+
+    friend Labels details::labels_from_cxx(const std::vector<std::string>& names, const int32_t* values, size_t count, bool assume_unique);
     friend Labels io::load_labels(const std::string &path);
     friend Labels io::load_labels_buffer(const uint8_t* buffer, size_t buffer_count);
     friend class TensorMap;
     friend class TensorBlock;
+    friend class TensorMapReader;
 
     friend class metatensor_torch::LabelsHolder;
 
@@ -1718,7 +2621,8 @@ namespace details {
     inline metatensor::Labels labels_from_cxx(
         const std::vector<std::string>& names,
         const int32_t* values,
-        size_t count
+        size_t count,
+        bool assume_unique
     ) {
         mts_labels_t labels;
         std::memset(&labels, 0, sizeof(labels));
@@ -1733,7 +2637,11 @@ namespace details {
         labels.count = count;
         labels.values = values;
 
-        details::check_status(mts_labels_create(&labels));
+        if (assume_unique) {
+            details::check_status(mts_labels_create_assume_unique(&labels));
+        } else {
+            details::check_status(mts_labels_create(&labels));
+        }
 
         return metatensor::Labels(labels);
     }
@@ -1889,6 +2797,22 @@ public:
 
     NDArray<double> values() && = delete;
 
+    /*!
+     * Get a view in the values in this block, with elements of type `T`.
+     *
+     * This does not convert the data, and throws an exception if the array
+     * does not contain elements of type `T`. `T` can be `double`, `float`,
+     * `int32_t` or `int64_t`.
+     */
+    template <typename T>
+    NDArray<T> values() & {
+        auto* data = details::mts_array_typed_data<T>(this->mts_array());
+        return NDArray<T>(data, this->values_shape());
+    }
+
+    template <typename T>
+    NDArray<T> values() && = delete;
+
     /// Access the sample `Labels` for this block.
     ///
     /// The entries in these labels describe the first dimension of the
@@ -2107,6 +3031,24 @@ public:
         return metatensor::io::load_block_buffer<Buffer>(buffer, create_array);
     }
 
+    /*!
+     * \verbatim embed:rst:leading-asterisk
+     *
+     * Load a previously saved ``TensorBlock`` from the given path, using a
+     * memory map to access the file.
+     *
+     * This is identical to :cpp:func:`metatensor::io::load_block_mmap`, and
+     * provided as a convenience API.
+     *
+     * \endverbatim
+     */
+    static TensorBlock load_mmap(
+        const std::string& path,
+        mts_create_mmap_array_callback_t create_array
+    ) {
+        return metatensor::io::load_block_mmap(path, create_array);
+    }
+
     /*!
      * \verbatim embed:rst:leading-asterisk
      *
@@ -2117,8 +3059,8 @@ public:
      *
      * \endverbatim
      */
-    void save(const std::string& path) const {
-        return metatensor::io::save(path, *this);
+    void save(const std::string& path, io::SaveOptions options = io::SaveOptions()) const {
+        return metatensor::io::save(path, *this, options);
     }
 
     /*!
@@ -2131,8 +3073,8 @@ public:
      *
      * \endverbatim
      */
-    std::vector<uint8_t> save_buffer() const {
-        return metatensor::io::save_buffer(*this);
+    std::vector<uint8_t> save_buffer(io::SaveOptions options = io::SaveOptions()) const {
+        return metatensor::io::save_buffer(*this, options);
     }
 
     /*!
@@ -2146,8 +3088,8 @@ public:
      * \endverbatim
      */
     template <typename Buffer>
-    Buffer save_buffer() const {
-        return metatensor::io::save_buffer<Buffer>(*this);
+    Buffer save_buffer(io::SaveOptions options = io::SaveOptions()) const {
+        return metatensor::io::save_buffer<Buffer>(*this, options);
     }
 
 private:
@@ -2189,6 +3131,7 @@ private:
     }
 
     friend class TensorMap;
+    friend class TensorMapWriter;
     friend class metatensor_torch::TensorBlockHolder;
     friend TensorBlock metatensor::io::load_block(
         const std::string& path,
@@ -2199,6 +3142,10 @@ private:
         size_t buffer_count,
         mts_create_array_callback_t create_array
     );
+    friend TensorBlock metatensor::io::load_block_mmap(
+        const std::string& path,
+        mts_create_mmap_array_callback_t create_array
+    );
 
     mts_block_t* block_;
     bool is_view_;
@@ -2467,6 +3414,56 @@ public:
         return TensorMap(ptr);
     }
 
+    /// Split the samples of all blocks in this `TensorMap` into `n_shards`
+    /// new `TensorMap`, in a single pass over the data.
+    ///
+    /// A sample with value `v` for the `dimension` samples dimension goes to
+    /// the shard `shards[v]`. All the shards have the same keys as this
+    /// `TensorMap`, with empty blocks where there is no sample in a shard. The
+    /// gradients are split together with the corresponding samples.
+    ///
+    /// @param dimension name of the samples dimension used to find the shard
+    ///                  of each sample
+    /// @param shards shard of each value of `dimension`
+    /// @param n_shards number of shards to create
+    std::vector<TensorMap> split_samples(
+        const std::string& dimension,
+        const std::vector<uintptr_t>& shards,
+        uintptr_t n_shards
+    ) const {
+        auto ptrs = std::vector<mts_tensormap_t*>(n_shards, nullptr);
+        details::check_status(mts_tensormap_split_samples(
+            tensor_,
+            dimension.c_str(),
+            shards.data(),
+            shards.size(),
+            ptrs.data(),
+            ptrs.size()
+        ));
+
+        auto result = std::vector<TensorMap>();
+        result.reserve(ptrs.size());
+        for (auto* ptr: ptrs) {
+            result.emplace_back(TensorMap(ptr));
+        }
+        return result;
+    }
+
+    /// Merge `TensorMap` created by `split_samples` back into a single
+    /// `TensorMap`. The samples of the merged blocks are the samples of the
+    /// first `TensorMap`, followed by the ones of the second `TensorMap`, etc.
+    static TensorMap merge_samples(const std::vector<TensorMap>& tensors) {
+        auto ptrs = std::vector<const mts_tensormap_t*>();
+        ptrs.reserve(tensors.size());
+        for (const auto& tensor: tensors) {
+            ptrs.push_back(tensor.as_mts_tensormap_t());
+        }
+
+        auto* ptr = mts_tensormap_merge_samples(ptrs.data(), ptrs.size());
+        details::check_pointer(ptr);
+        return TensorMap(ptr);
+    }
+
     /*!
      * \verbatim embed:rst:leading-asterisk
      *
@@ -2479,9 +3476,10 @@ public:
      */
     static TensorMap load(
         const std::string& path,
-        mts_create_array_callback_t create_array = details::default_create_array
+        mts_create_array_callback_t create_array = details::default_create_array,
+        io::LoadOptions options = io::LoadOptions()
     ) {
-        return metatensor::io::load(path, create_array);
+        return metatensor::io::load(path, create_array, options);
     }
 
     /*!
@@ -2497,9 +3495,10 @@ public:
     static TensorMap load_buffer(
         const uint8_t* buffer,
         size_t buffer_count,
-        mts_create_array_callback_t create_array = details::default_create_array
+        mts_create_array_callback_t create_array = details::default_create_array,
+        io::LoadOptions options = io::LoadOptions()
     ) {
-        return metatensor::io::load_buffer(buffer, buffer_count, create_array);
+        return metatensor::io::load_buffer(buffer, buffer_count, create_array, options);
     }
 
     /*!
@@ -2515,9 +3514,28 @@ public:
     template <typename Buffer>
     static TensorMap load_buffer(
         const Buffer& buffer,
-        mts_create_array_callback_t create_array = details::default_create_array
+        mts_create_array_callback_t create_array = details::default_create_array,
+        io::LoadOptions options = io::LoadOptions()
+    ) {
+        return metatensor::io::load_buffer<Buffer>(buffer, create_array, options);
+    }
+
+    /*!
+     * \verbatim embed:rst:leading-asterisk
+     *
+     * Load a previously saved ``TensorMap`` from the given path, using a
+     * memory map to access the file.
+     *
+     * This is identical to :cpp:func:`metatensor::io::load_mmap`, and provided
+     * as a convenience API.
+     *
+     * \endverbatim
+     */
+    static TensorMap load_mmap(
+        const std::string& path,
+        mts_create_mmap_array_callback_t create_array
     ) {
-        return metatensor::io::load_buffer<Buffer>(buffer, create_array);
+        return metatensor::io::load_mmap(path, create_array);
     }
 
     /*!
@@ -2530,8 +3548,8 @@ public:
      *
      * \endverbatim
      */
-    void save(const std::string& path) const {
-        return metatensor::io::save(path, *this);
+    void save(const std::string& path, io::SaveOptions options = io::SaveOptions()) const {
+        return metatensor::io::save(path, *this, options);
     }
 
     /*!
@@ -2544,8 +3562,8 @@ public:
      *
      * \endverbatim
      */
-    std::vector<uint8_t> save_buffer() const {
-        return metatensor::io::save_buffer(*this);
+    std::vector<uint8_t> save_buffer(io::SaveOptions options = io::SaveOptions()) const {
+        return metatensor::io::save_buffer(*this, options);
     }
 
     /*!
@@ -2559,8 +3577,8 @@ public:
      * \endverbatim
      */
     template <typename Buffer>
-    Buffer save_buffer() const {
-        return metatensor::io::save_buffer<Buffer>(*this);
+    Buffer save_buffer(io::SaveOptions options = io::SaveOptions()) const {
+        return metatensor::io::save_buffer<Buffer>(*this, options);
     }
 
     /// Get the `mts_tensormap_t` pointer corresponding to this `TensorMap`.
@@ -2588,6 +3606,235 @@ private:
 };
 
 
+/******************************************************************************/
+/******************************************************************************/
+/*                                                                            */
+/*                            TensorMapReader                                 */
+/*                                                                            */
+/******************************************************************************/
+/******************************************************************************/
+
+/// Lazy reader for a `TensorMap` serialized to a file, giving random access to
+/// the blocks.
+///
+/// Opening a reader only reads the keys of the tensor map and the list of files
+/// in the archive. The blocks are only read and decoded when requested with
+/// `block()`, which makes it cheap to load a few blocks out of a large file.
+class TensorMapReader final {
+public:
+    /// Open the file at `path` for lazy reading. Arrays for the values and
+    /// gradient data of the blocks will be created with the given
+    /// `create_array` callback.
+    explicit TensorMapReader(
+        const std::string& path,
+        mts_create_array_callback_t create_array = details::default_create_array
+    ):
+        reader_(mts_tensormap_reader_open(path.c_str())),
+        create_array_(create_array)
+    {
+        details::check_pointer(reader_);
+    }
+
+    ~TensorMapReader() {
+        mts_tensormap_reader_free(reader_);
+    }
+
+    /// TensorMapReader can NOT be copy constructed
+    TensorMapReader(const TensorMapReader&) = delete;
+    /// TensorMapReader can NOT be copy assigned
+    TensorMapReader& operator=(const TensorMapReader&) = delete;
+
+    /// TensorMapReader can be move constructed
+    TensorMapReader(TensorMapReader&& other) noexcept:
+        reader_(other.reader_),
+        create_array_(other.create_array_)
+    {
+        other.reader_ = nullptr;
+    }
+
+    /// TensorMapReader can be move assigned
+    TensorMapReader& operator=(TensorMapReader&& other) noexcept {
+        mts_tensormap_reader_free(reader_);
+
+        this->reader_ = other.reader_;
+        this->create_array_ = other.create_array_;
+        other.reader_ = nullptr;
+
+        return *this;
+    }
+
+    /// Get the keys of the tensor map in the file
+    Labels keys() const {
+        mts_labels_t keys;
+        std::memset(&keys, 0, sizeof(keys));
+
+        details::check_status(mts_tensormap_reader_keys(reader_, &keys));
+        return Labels(keys);
+    }
+
+    /// Get a (possibly empty) list of block indexes matching the `selection`,
+    /// without loading any block
+    std::vector<uintptr_t> blocks_matching(const Labels& selection) const {
+        auto matching = std::vector<uintptr_t>(this->keys().count());
+        uintptr_t count = matching.size();
+
+        details::check_status(mts_tensormap_reader_blocks_matching(
+            reader_,
+            matching.data(),
+            &count,
+            selection.as_mts_labels_t()
+        ));
+
+        assert(count <= matching.size());
+        matching.resize(count);
+        return matching;
+    }
+
+    /// Load the block at the given `index` from the file. The returned block
+    /// owns its data and is independent from this reader.
+    TensorBlock block(uintptr_t index) const {
+        auto* block = mts_tensormap_reader_block(reader_, index, create_array_);
+        details::check_pointer(block);
+        return TensorBlock::unsafe_from_ptr(block);
+    }
+
+    /// Load the single block matching the `selection` from the file. This
+    /// throws an error if no block or more than one block match the selection.
+    TensorBlock block(const Labels& selection) const {
+        auto matching = this->blocks_matching(selection);
+        if (matching.size() != 1) {
+            throw Error(
+                "expected a single block matching the selection, got " +
+                std::to_string(matching.size())
+            );
+        }
+        return this->block(matching[0]);
+    }
+
+    /// Load all the blocks matching the `selection` from the file, and
+    /// assemble them in a new `TensorMap`.
+    TensorMap load(const Labels& selection) const {
+        auto matching = this->blocks_matching(selection);
+        auto all_keys = this->keys();
+        const auto& all_values = all_keys.values();
+
+        auto values = std::vector<int32_t>();
+        values.reserve(matching.size() * all_keys.size());
+        auto blocks = std::vector<TensorBlock>();
+        blocks.reserve(matching.size());
+        for (auto i: matching) {
+            for (size_t j=0; j<all_keys.size(); j++) {
+                values.push_back(all_values(i, j));
+            }
+            blocks.emplace_back(this->block(i));
+        }
+
+        auto names = std::vector<std::string>(
+            all_keys.names().begin(),
+            all_keys.names().end()
+        );
+        auto keys = Labels(names, values.data(), matching.size());
+
+        return TensorMap(std::move(keys), std::move(blocks));
+    }
+
+private:
+    mts_tensormap_reader_t* reader_;
+    mts_create_array_callback_t create_array_;
+};
+
+
+/******************************************************************************/
+/******************************************************************************/
+/*                                                                            */
+/*                            TensorMapWriter                                 */
+/*                                                                            */
+/******************************************************************************/
+/******************************************************************************/
+
+/// Incremental writer for a `TensorMap`, writing blocks to a file one at a
+/// time instead of requiring the whole `TensorMap` to be in memory.
+///
+/// Blocks are added with `append()`, and the file is completed with
+/// `finish()`. The resulting file uses the same format as `io::save()`, and can
+/// be loaded with `TensorMap::load()` or `TensorMapReader`. If the writer is
+/// destroyed before `finish()` is called, the file will be incomplete.
+class TensorMapWriter final {
+public:
+    /// Create a new writer for a tensor map with keys containing the dimensions
+    /// in `key_names`, writing to the file at `path`. The data is saved
+    /// according to the given `options`.
+    TensorMapWriter(
+        const std::string& path,
+        const std::vector<std::string>& key_names,
+        io::SaveOptions options = io::SaveOptions()
+    ): writer_(nullptr) {
+        auto c_names = std::vector<const char*>();
+        c_names.reserve(key_names.size());
+        for (const auto& name: key_names) {
+            c_names.push_back(name.c_str());
+        }
+
+        writer_ = mts_tensormap_writer_open(
+            path.c_str(),
+            c_names.data(),
+            c_names.size(),
+            details::mts_save_options(options)
+        );
+        details::check_pointer(writer_);
+    }
+
+    ~TensorMapWriter() {
+        mts_tensormap_writer_free(writer_);
+    }
+
+    /// TensorMapWriter can NOT be copy constructed
+    TensorMapWriter(const TensorMapWriter&) = delete;
+    /// TensorMapWriter can NOT be copy assigned
+    TensorMapWriter& operator=(const TensorMapWriter&) = delete;
+
+    /// TensorMapWriter can be move constructed
+    TensorMapWriter(TensorMapWriter&& other) noexcept: writer_(other.writer_) {
+        other.writer_ = nullptr;
+    }
+
+    /// TensorMapWriter can be move assigned
+    TensorMapWriter& operator=(TensorMapWriter&& other) noexcept {
+        mts_tensormap_writer_free(writer_);
+
+        this->writer_ = other.writer_;
+        other.writer_ = nullptr;
+
+        return *this;
+    }
+
+    /// Append a `block` with the given `key` to the file.
+    ///
+    /// If `key` is the same as the key of the previously appended block, the
+    /// samples of `block` are added to this previous block instead. Otherwise,
+    /// `key` must not have been used before: all the samples for a given key
+    /// must be appended one after the other. The previous block is written to
+    /// the file as soon as a block with a different key is appended.
+    void append(const std::vector<int32_t>& key, TensorBlock block) {
+        details::check_status(mts_tensormap_writer_append(
+            writer_,
+            key.data(),
+            key.size(),
+            block.release()
+        ));
+    }
+
+    /// Write the keys and remaining data to the file. No more blocks can be
+    /// appended after calling this function.
+    void finish() {
+        details::check_status(mts_tensormap_writer_finish(writer_));
+    }
+
+private:
+    mts_tensormap_writer_t* writer_;
+};
+
+
 /******************************************************************************/
 /******************************************************************************/
 /*                                                                            */
@@ -2598,18 +3845,22 @@ private:
 
 
 namespace io {
-    inline void save(const std::string& path, const TensorMap& tensor) {
-        details::check_status(mts_tensormap_save(path.c_str(), tensor.as_mts_tensormap_t()));
+    inline void save(const std::string& path, const TensorMap& tensor, SaveOptions options) {
+        details::check_status(mts_tensormap_save_with_options(
+            path.c_str(),
+            tensor.as_mts_tensormap_t(),
+            details::mts_save_options(options)
+        ));
     }
 
     template <typename Buffer>
-    Buffer save_buffer(const TensorMap& tensor) {
-        auto buffer = metatensor::io::save_buffer<std::vector<uint8_t>>(tensor);
+    Buffer save_buffer(const TensorMap& tensor, SaveOptions options) {
+        auto buffer = metatensor::io::save_buffer<std::vector<uint8_t>>(tensor, options);
         return Buffer(buffer.begin(), buffer.end());
     }
 
     template<>
-    inline std::vector<uint8_t> save_buffer<std::vector<uint8_t>>(const TensorMap& tensor) {
+    inline std::vector<uint8_t> save_buffer<std::vector<uint8_t>>(const TensorMap& tensor, SaveOptions options) {
         std::vector<uint8_t> buffer;
 
         auto* ptr = buffer.data();
@@ -2621,12 +3872,13 @@ namespace io {
             return buffer->data();
         };
 
-        details::check_status(mts_tensormap_save_buffer(
+        details::check_status(mts_tensormap_save_buffer_with_options(
             &ptr,
             &size,
             &buffer,
             realloc,
-            tensor.as_mts_tensormap_t()
+            tensor.as_mts_tensormap_t(),
+            details::mts_save_options(options)
         ));
 
         buffer.resize(size, '\0');
@@ -2634,20 +3886,46 @@ namespace io {
         return buffer;
     }
 
+    inline size_t serialized_size(const TensorMap& tensor, SaveOptions options) {
+        uintptr_t size = 0;
+        details::check_status(mts_tensormap_serialized_size(
+            tensor.as_mts_tensormap_t(),
+            details::mts_save_options(options),
+            &size
+        ));
+        return static_cast<size_t>(size);
+    }
+
+    inline size_t save_into_buffer(const TensorMap& tensor, uint8_t* buffer, size_t buffer_count, SaveOptions options) {
+        uintptr_t written = 0;
+        details::check_status(mts_tensormap_save_into_buffer(
+            buffer,
+            static_cast<uintptr_t>(buffer_count),
+            &written,
+            tensor.as_mts_tensormap_t(),
+            details::mts_save_options(options)
+        ));
+        return static_cast<size_t>(written);
+    }
+
     /**************************************************************************/
 
-    inline void save(const std::string& path, const TensorBlock& block) {
-        details::check_status(mts_block_save(path.c_str(), block.as_mts_block_t()));
+    inline void save(const std::string& path, const TensorBlock& block, SaveOptions options) {
+        details::check_status(mts_block_save_with_options(
+            path.c_str(),
+            block.as_mts_block_t(),
+            details::mts_save_options(options)
+        ));
     }
 
     template <typename Buffer>
-    Buffer save_buffer(const TensorBlock& block) {
-        auto buffer = metatensor::io::save_buffer<std::vector<uint8_t>>(block);
+    Buffer save_buffer(const TensorBlock& block, SaveOptions options) {
+        auto buffer = metatensor::io::save_buffer<std::vector<uint8_t>>(block, options);
         return Buffer(buffer.begin(), buffer.end());
     }
 
     template<>
-    inline std::vector<uint8_t> save_buffer<std::vector<uint8_t>>(const TensorBlock& block) {
+    inline std::vector<uint8_t> save_buffer<std::vector<uint8_t>>(const TensorBlock& block, SaveOptions options) {
         std::vector<uint8_t> buffer;
 
         auto* ptr = buffer.data();
@@ -2659,12 +3937,13 @@ namespace io {
             return buffer->data();
         };
 
-        details::check_status(mts_block_save_buffer(
+        details::check_status(mts_block_save_buffer_with_options(
             &ptr,
             &size,
             &buffer,
             realloc,
-            block.as_mts_block_t()
+            block.as_mts_block_t(),
+            details::mts_save_options(options)
         ));
 
         buffer.resize(size, '\0');
@@ -2672,6 +3951,28 @@ namespace io {
         return buffer;
     }
 
+    inline size_t serialized_size(const TensorBlock& block, SaveOptions options) {
+        uintptr_t size = 0;
+        details::check_status(mts_block_serialized_size(
+            block.as_mts_block_t(),
+            details::mts_save_options(options),
+            &size
+        ));
+        return static_cast<size_t>(size);
+    }
+
+    inline size_t save_into_buffer(const TensorBlock& block, uint8_t* buffer, size_t buffer_count, SaveOptions options) {
+        uintptr_t written = 0;
+        details::check_status(mts_block_save_into_buffer(
+            buffer,
+            static_cast<uintptr_t>(buffer_count),
+            &written,
+            block.as_mts_block_t(),
+            details::mts_save_options(options)
+        ));
+        return static_cast<size_t>(written);
+    }
+
     /**************************************************************************/
 
     inline void save(const std::string& path, const Labels& labels) {
@@ -2710,14 +4011,39 @@ namespace io {
         return buffer;
     }
 
+    inline size_t serialized_size(const Labels& labels) {
+        uintptr_t size = 0;
+        details::check_status(mts_labels_serialized_size(
+            labels.as_mts_labels_t(),
+            &size
+        ));
+        return static_cast<size_t>(size);
+    }
+
+    inline size_t save_into_buffer(const Labels& labels, uint8_t* buffer, size_t buffer_count) {
+        uintptr_t written = 0;
+        details::check_status(mts_labels_save_into_buffer(
+            buffer,
+            static_cast<uintptr_t>(buffer_count),
+            &written,
+            labels.as_mts_labels_t()
+        ));
+        return static_cast<size_t>(written);
+    }
+
     /**************************************************************************/
     /**************************************************************************/
 
     inline TensorMap load(
         const std::string& path,
-        mts_create_array_callback_t create_array
+        mts_create_array_callback_t create_array,
+        LoadOptions options
     ) {
-        auto* ptr = mts_tensormap_load(path.c_str(), create_array);
+        auto* ptr = mts_tensormap_load_with_options(
+            path.c_str(),
+            create_array,
+            details::mts_load_options(options)
+        );
         details::check_pointer(ptr);
         return TensorMap(ptr);
     }
@@ -2725,9 +4051,15 @@ namespace io {
     inline TensorMap load_buffer(
         const uint8_t* buffer,
         size_t buffer_count,
-        mts_create_array_callback_t create_array
+        mts_create_array_callback_t create_array,
+        LoadOptions options
     ) {
-        auto* ptr = mts_tensormap_load_buffer(buffer, buffer_count, create_array);
+        auto* ptr = mts_tensormap_load_buffer_with_options(
+            buffer,
+            buffer_count,
+            create_array,
+            details::mts_load_options(options)
+        );
         details::check_pointer(ptr);
         return TensorMap(ptr);
     }
@@ -2735,7 +4067,8 @@ namespace io {
     template <typename Buffer>
     TensorMap load_buffer(
         const Buffer& buffer,
-        mts_create_array_callback_t create_array
+        mts_create_array_callback_t create_array,
+        LoadOptions options
     ) {
         static_assert(
             sizeof(typename Buffer::value_type) == sizeof(uint8_t),
@@ -2745,10 +4078,20 @@ namespace io {
         return metatensor::io::load_buffer(
             reinterpret_cast<const uint8_t*>(buffer.data()),
             buffer.size(),
-            create_array
+            create_array,
+            options
         );
     }
 
+    inline TensorMap load_mmap(
+        const std::string& path,
+        mts_create_mmap_array_callback_t create_array
+    ) {
+        auto* ptr = mts_tensormap_load_mmap(path.c_str(), create_array);
+        details::check_pointer(ptr);
+        return TensorMap(ptr);
+    }
+
     /**************************************************************************/
 
     inline TensorBlock load_block(
@@ -2787,6 +4130,15 @@ namespace io {
         );
     }
 
+    inline TensorBlock load_block_mmap(
+        const std::string& path,
+        mts_create_mmap_array_callback_t create_array
+    ) {
+        auto* ptr = mts_block_load_mmap(path.c_str(), create_array);
+        details::check_pointer(ptr);
+        return TensorBlock(ptr);
+    }
+
     /**************************************************************************/
 
     inline Labels load_labels(const std::string& path) {
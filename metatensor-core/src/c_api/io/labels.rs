@@ -3,11 +3,12 @@ use std::os::raw::{c_char, c_void};
 use std::sync::Arc;
 use std::ffi::CStr;
 use std::fs::File;
-use std::io::{BufReader, BufWriter};
+use std::io::{BufReader, BufWriter, Write};
 
 use crate::Error;
+use crate::profiling::Operation;
 
-use super::{ExternalBuffer, mts_realloc_buffer_t};
+use super::{ExternalBuffer, FixedBuffer, SizeCounter, mts_realloc_buffer_t};
 
 use super::super::status::{mts_status_t, catch_unwind};
 use super::super::labels::{mts_labels_t, rust_to_mts_labels, mts_labels_to_rust};
@@ -31,6 +32,7 @@ pub unsafe extern fn mts_labels_load(
     labels: *mut mts_labels_t,
 ) -> mts_status_t {
     catch_unwind(move || {
+        let _profiling = crate::profiling::scope(Operation::LabelsLoad);
         check_pointers_non_null!(path, labels);
         if (*labels).is_rust() {
             return Err(Error::InvalidParameter(
@@ -63,6 +65,8 @@ pub unsafe extern fn mts_labels_load(
 
         *labels = rust_to_mts_labels(Arc::new(rust_labels));
 
+        crate::profiling::add_file_bytes(Operation::LabelsLoad, path);
+
         Ok(())
     })
 }
@@ -85,6 +89,7 @@ pub unsafe extern fn mts_labels_load_buffer(
     labels: *mut mts_labels_t,
 ) -> mts_status_t {
     catch_unwind(move || {
+        let _profiling = crate::profiling::scope(Operation::LabelsLoad);
         check_pointers_non_null!(buffer, labels);
         if (*labels).is_rust() {
             return Err(Error::InvalidParameter(
@@ -122,6 +127,8 @@ pub unsafe extern fn mts_labels_load_buffer(
 
         *labels = rust_to_mts_labels(Arc::new(rust_labels));
 
+        crate::profiling::add_bytes(Operation::LabelsLoad, buffer_count);
+
         Ok(())
     })
 }
@@ -142,6 +149,7 @@ pub unsafe extern fn mts_labels_save(
     labels: mts_labels_t,
 ) -> mts_status_t {
     catch_unwind(move || {
+        let _profiling = crate::profiling::scope(Operation::LabelsSave);
         check_pointers_non_null!(path);
         if !labels.is_rust() {
             return Err(Error::InvalidParameter(
@@ -155,6 +163,9 @@ pub unsafe extern fn mts_labels_save(
 
         let labels = mts_labels_to_rust(&labels)?;
         crate::io::save_labels(&mut file, &labels)?;
+        file.flush()?;
+
+        crate::profiling::add_file_bytes(Operation::LabelsSave, path);
 
         Ok(())
     })
@@ -196,6 +207,7 @@ pub unsafe extern fn mts_labels_save_buffer(
     labels: mts_labels_t,
 ) -> mts_status_t {
     catch_unwind(move || {
+        let _profiling = crate::profiling::scope(Operation::LabelsSave);
         if !labels.is_rust() {
             return Err(Error::InvalidParameter(
                 "these labels do not support calling mts_labels_save_buffer, \
@@ -226,6 +238,98 @@ pub unsafe extern fn mts_labels_save_buffer(
 
         *buffer_count = external_buffer.current as usize;
 
+        crate::profiling::add_bytes(Operation::LabelsSave, *buffer_count);
+
+        Ok(())
+    })
+}
+
+
+/// Get the exact number of bytes needed to save these labels, i.e. the size of
+/// the buffer for `mts_labels_save_into_buffer` or the number of bytes written
+/// by `mts_labels_save_buffer`.
+///
+/// This goes through all the serialization steps without storing the data, so
+/// it costs about as much as saving the labels itself.
+///
+/// @param labels labels that will be saved
+/// @param size on output, will contain the size of the serialized data in
+///             bytes
+///
+/// @returns The status code of this operation. If the status is not
+///          `MTS_SUCCESS`, you can use `mts_last_error()` to get the full error
+///          message.
+#[no_mangle]
+#[allow(clippy::cast_possible_truncation)]
+pub unsafe extern fn mts_labels_serialized_size(
+    labels: mts_labels_t,
+    size: *mut usize,
+) -> mts_status_t {
+    catch_unwind(move || {
+        if !labels.is_rust() {
+            return Err(Error::InvalidParameter(
+                "these labels do not support calling mts_labels_serialized_size, \
+                call mts_labels_create first".into()
+            ));
+        }
+        check_pointers_non_null!(size);
+
+        let labels = mts_labels_to_rust(&labels)?;
+        let mut counter = SizeCounter::default();
+        crate::io::save_labels(&mut counter, &labels)?;
+        *size = counter.end as usize;
+
+        Ok(())
+    })
+}
+
+
+/// Save these labels to an existing in-memory buffer, without any
+/// reallocation.
+///
+/// The buffer must be large enough to contain the whole serialized data, which
+/// size can be obtained with `mts_labels_serialized_size`. The data written to
+/// the buffer is the same as the one produced by `mts_labels_save_buffer`.
+///
+/// @param buffer pointer to the start of the buffer
+/// @param buffer_count size of the buffer, in bytes
+/// @param written on output, will contain the number of bytes written to the
+///                buffer
+/// @param labels labels that will be saved to the buffer
+///
+/// @returns The status code of this operation. If the status is not
+///          `MTS_SUCCESS`, you can use `mts_last_error()` to get the full error
+///          message.
+#[no_mangle]
+#[allow(clippy::cast_possible_truncation)]
+pub unsafe extern fn mts_labels_save_into_buffer(
+    buffer: *mut u8,
+    buffer_count: usize,
+    written: *mut usize,
+    labels: mts_labels_t,
+) -> mts_status_t {
+    catch_unwind(move || {
+        let _profiling = crate::profiling::scope(Operation::LabelsSave);
+        if !labels.is_rust() {
+            return Err(Error::InvalidParameter(
+                "these labels do not support calling mts_labels_save_into_buffer, \
+                call mts_labels_create first".into()
+            ));
+        }
+        check_pointers_non_null!(buffer, written);
+
+        let labels = mts_labels_to_rust(&labels)?;
+        let mut fixed = FixedBuffer::new(buffer, buffer_count);
+        let result = crate::io::save_labels(&mut fixed, &labels);
+        if fixed.overflow {
+            return Err(fixed.overflow_error("labels"));
+        }
+        result?;
+
+        *written = fixed.end as usize;
+
+        crate::profiling::add_bytes(Operation::LabelsSave, *written);
+
         Ok(())
     })
 }
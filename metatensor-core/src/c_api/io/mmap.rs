@@ -0,0 +1,99 @@
+use std::sync::Arc;
+
+use crate::Error;
+use crate::data::mts_array_t;
+use crate::io::{MmapFile, MappedData};
+
+use super::super::status::{mts_status_t, catch_unwind};
+
+/// Opaque type representing a file mapped in memory by
+/// `mts_tensormap_load_mmap` or `mts_block_load_mmap`.
+///
+/// Each `mts_mmap_t` is a reference to the mapping, which stays valid until
+/// all references have been released with `mts_mmap_free`.
+#[allow(non_camel_case_types)]
+pub struct mts_mmap_t(Arc<MmapFile>);
+
+/// Function pointer to create a new `mts_array_t` when loading tensor maps
+/// from memory-mapped files.
+///
+/// This function gets the `shape` of the array (the `shape` contains
+/// `shape_count` elements) and should fill `array` with a new valid
+/// `mts_array_t` or return non-zero `mts_status_t`.
+///
+/// If `data` is not `NULL`, it points to the 64-bit floating points data for
+/// this array (in row-major order) inside of the memory-mapped file, and the
+/// new array should directly use this memory instead of allocating new memory.
+/// The mapping is private: writing to `data` does not modify the file. In this
+/// case, `mmap` is a new reference to the mapped file, which must be released
+/// with `mts_mmap_free` once the array no longer uses `data`. This function
+/// always takes ownership of `mmap`, even if it returns an error.
+///
+/// If `data` is `NULL`, the data can not be used in-place and `mmap` is also
+/// `NULL`. The function should then create a new array, exactly like
+/// `mts_create_array_callback_t` does, and metatensor will write the data to
+/// this array.
+#[allow(non_camel_case_types)]
+pub(super) type mts_create_mmap_array_callback_t = unsafe extern fn(
+    shape: *const usize,
+    shape_count: usize,
+    data: *mut f64,
+    mmap: *mut mts_mmap_t,
+    array: *mut mts_array_t,
+) -> mts_status_t;
+
+pub(super) fn wrap_create_mmap_array(
+    create_array: &mts_create_mmap_array_callback_t
+) -> impl Fn(Vec<usize>, Option<MappedData>) -> Result<mts_array_t, Error> + '_ {
+    |shape: Vec<usize>, mapped: Option<MappedData>| {
+        let (data, mmap) = match mapped {
+            Some(mapped) => {
+                let mmap = Box::into_raw(Box::new(mts_mmap_t(mapped.mmap)));
+                (mapped.data, mmap)
+            }
+            None => (std::ptr::null_mut(), std::ptr::null_mut()),
+        };
+
+        let mut array = mts_array_t::null();
+        let status = unsafe {
+            create_array(
+                shape.as_ptr(),
+                shape.len(),
+                data,
+                mmap,
+                &mut array
+            )
+        };
+
+        if status.is_success() {
+            return Ok(array);
+        } else {
+            return Err(Error::External {
+                status: status,
+                context: "failed to create a new array in mts_tensormap_load_mmap".into()
+            });
+        }
+    }
+}
+
+/// Release a reference to a memory-mapped file, obtained in a
+/// `mts_create_mmap_array_callback_t`. The file is unmapped once all references
+/// have been released.
+///
+/// If `mmap` is `NULL`, this function does nothing.
+///
+/// @param mmap pointer to an existing memory-mapped file, or `NULL`
+///
+/// @returns The status code of this operation. If the status is not
+///          `MTS_SUCCESS`, you can use `mts_last_error()` to get the full
+///          error message.
+#[no_mangle]
+pub unsafe extern fn mts_mmap_free(mmap: *mut mts_mmap_t) -> mts_status_t {
+    catch_unwind(|| {
+        if !mmap.is_null() {
+            std::mem::drop(Box::from_raw(mmap));
+        }
+
+        Ok(())
+    })
+}
@@ -1,11 +1,96 @@
 use std::os::raw::c_void;
 
+use crate::Error;
 use crate::data::mts_array_t;
+use crate::io::{SaveOptions, Compression, StorageType, LoadOptions};
 use super::status::mts_status_t;
 
 mod labels;
 mod block;
 mod tensor;
+mod mmap;
+mod reader;
+mod writer;
+
+/// Store the data without compression when saving, allowing memory-mapped
+/// loading to use the data in-place
+pub const MTS_COMPRESSION_NONE: i32 = 0;
+/// Compress the data using the DEFLATE algorithm when saving
+pub const MTS_COMPRESSION_DEFLATE: i32 = 1;
+
+/// Store values and gradients as 64-bit floating point numbers when saving
+pub const MTS_STORAGE_FLOAT64: i32 = 0;
+/// Store values and gradients as 32-bit floating point numbers when saving
+pub const MTS_STORAGE_FLOAT32: i32 = 1;
+/// Store values and gradients as 16-bit (IEEE 754 half precision) floating
+/// point numbers when saving
+pub const MTS_STORAGE_FLOAT16: i32 = 2;
+
+/// Options controlling how data is saved by the `*_save_with_options` and
+/// `*_save_buffer_with_options` functions, and by `mts_tensormap_writer_open`.
+///
+/// A zero-initialized `mts_save_options_t` corresponds to the options used by
+/// `mts_tensormap_save` and `mts_block_save`: no compression, and 64-bit
+/// floating point data. Data saved with any options can be loaded with the
+/// usual loading functions, and is always loaded as 64-bit floating point
+/// numbers.
+#[repr(C)]
+#[derive(Debug, Clone, Copy, Default)]
+#[allow(non_camel_case_types)]
+pub struct mts_save_options_t {
+    /// Compression method for all the files in the archive, this should be one
+    /// of the `MTS_COMPRESSION_XXX` constants
+    pub compression: i32,
+    /// Floating point type used to store values and gradients, this should be
+    /// one of the `MTS_STORAGE_XXX` constants
+    pub storage_type: i32,
+}
+
+impl mts_save_options_t {
+    fn to_rust(self) -> Result<SaveOptions, Error> {
+        let compression = match self.compression {
+            MTS_COMPRESSION_NONE => Compression::None,
+            MTS_COMPRESSION_DEFLATE => Compression::Deflate,
+            other => return Err(Error::InvalidParameter(format!(
+                "invalid compression in mts_save_options_t: {}", other
+            ))),
+        };
+
+        let storage_type = match self.storage_type {
+            MTS_STORAGE_FLOAT64 => StorageType::Float64,
+            MTS_STORAGE_FLOAT32 => StorageType::Float32,
+            MTS_STORAGE_FLOAT16 => StorageType::Float16,
+            other => return Err(Error::InvalidParameter(format!(
+                "invalid storage type in mts_save_options_t: {}", other
+            ))),
+        };
+
+        return Ok(SaveOptions { compression, storage_type });
+    }
+}
+
+/// Options controlling how data is loaded by
+/// `mts_tensormap_load_with_options` and
+/// `mts_tensormap_load_buffer_with_options`.
+///
+/// A zero-initialized `mts_load_options_t` corresponds to the options used by
+/// `mts_tensormap_load` and `mts_tensormap_load_buffer`.
+#[repr(C)]
+#[derive(Debug, Clone, Copy, Default)]
+#[allow(non_camel_case_types)]
+pub struct mts_load_options_t {
+    /// Number of threads to use when decoding the blocks. With 0 or 1, all
+    /// blocks are decoded sequentially on the calling thread. Otherwise, the
+    /// blocks are distributed over up to `threads` worker threads, and the
+    /// `mts_create_array_callback_t` must be thread-safe.
+    pub threads: usize,
+}
+
+impl mts_load_options_t {
+    fn to_rust(self) -> LoadOptions {
+        return LoadOptions { threads: self.threads };
+    }
+}
 
 /// Function pointer to create a new `mts_array_t` when de-serializing tensor
 /// maps.
@@ -17,6 +102,12 @@ mod tensor;
 /// The newly created array should contains 64-bit floating points (`double`)
 /// data, and live on CPU, since metatensor will use `mts_array_t.data` to get
 /// the data pointer and write to it.
+///
+/// When loading data with `mts_load_options_t.threads` larger than 1, this
+/// function can be called concurrently from multiple threads, and must be
+/// thread-safe. Each array is filled with data (using `mts_array_t.data`) on
+/// the thread that created it, and then given back to the thread that called
+/// the loading function.
 #[allow(non_camel_case_types)]
 type mts_create_array_callback_t = unsafe extern fn(
     shape: *const usize,
@@ -163,3 +254,134 @@ impl std::io::Seek for ExternalBuffer {
         return Ok(self.current);
      }
 }
+
+
+/// Writer counting the number of bytes needed to serialize some data, without
+/// storing the data anywhere. This is used to get the exact size of the
+/// serialized data before saving it in a buffer with `FixedBuffer`.
+#[derive(Default)]
+struct SizeCounter {
+    current: u64,
+    end: u64,
+}
+
+impl std::io::Write for SizeCounter {
+    fn write(&mut self, buf: &[u8]) -> std::io::Result<usize> {
+        self.current += buf.len() as u64;
+        self.end = self.end.max(self.current);
+        return Ok(buf.len());
+    }
+
+    fn flush(&mut self) -> std::io::Result<()> {
+        return Ok(());
+    }
+}
+
+#[allow(clippy::cast_sign_loss, clippy::cast_possible_wrap)]
+impl std::io::Seek for SizeCounter {
+    fn seek(&mut self, pos: std::io::SeekFrom) -> std::io::Result<u64> {
+        let result = match pos {
+            std::io::SeekFrom::Start(offset) => offset as i64,
+            std::io::SeekFrom::End(offset) => self.end as i64 + offset,
+            std::io::SeekFrom::Current(offset) => self.current as i64 + offset,
+        };
+
+        if result < 0 {
+            return Err(std::io::Error::new(
+                std::io::ErrorKind::UnexpectedEof, "tried to seek past the beginning of the buffer")
+            );
+        }
+
+        self.current = result as u64;
+        return Ok(self.current);
+    }
+
+    fn stream_position(&mut self) -> std::io::Result<u64> {
+        return Ok(self.current);
+    }
+}
+
+
+/// Wrapper for an externally managed buffer with a fixed size, which can not
+/// be grown. Writing more data than fits in the buffer is an error, and sets
+/// `overflow` to `true`.
+struct FixedBuffer {
+    data: *mut u8,
+    len: usize,
+
+    current: u64,
+    end: u64,
+    overflow: bool,
+}
+
+impl FixedBuffer {
+    fn new(data: *mut u8, len: usize) -> FixedBuffer {
+        FixedBuffer { data, len, current: 0, end: 0, overflow: false }
+    }
+
+    /// Get the error to return when some data did not fit in this buffer
+    fn overflow_error(&self, what: &str) -> Error {
+        Error::BufferSize(format!(
+            "the buffer of {} bytes is too small to contain the serialized {}, \
+            use the corresponding `*_serialized_size` function to get the \
+            required size", self.len, what
+        ))
+    }
+}
+
+impl std::io::Write for FixedBuffer {
+    #[allow(clippy::cast_possible_truncation, clippy::cast_possible_wrap)]
+    fn write(&mut self, buf: &[u8]) -> std::io::Result<usize> {
+        let current = self.current as usize;
+        if buf.len() > self.len - current {
+            self.overflow = true;
+            return Err(std::io::Error::new(
+                std::io::ErrorKind::WriteZero,
+                "the data does not fit in the pre-allocated buffer"
+            ));
+        }
+
+        unsafe {
+            std::ptr::copy_nonoverlapping(buf.as_ptr(), self.data.add(current), buf.len());
+        }
+
+        self.current += buf.len() as u64;
+        self.end = self.end.max(self.current);
+        return Ok(buf.len());
+    }
+
+    fn flush(&mut self) -> std::io::Result<()> {
+        return Ok(());
+    }
+}
+
+#[allow(clippy::cast_sign_loss, clippy::cast_possible_wrap)]
+impl std::io::Seek for FixedBuffer {
+    fn seek(&mut self, pos: std::io::SeekFrom) -> std::io::Result<u64> {
+        let result = match pos {
+            std::io::SeekFrom::Start(offset) => offset as i64,
+            std::io::SeekFrom::End(offset) => self.end as i64 + offset,
+            std::io::SeekFrom::Current(offset) => self.current as i64 + offset,
+        };
+
+        if result < 0 {
+            return Err(std::io::Error::new(
+                std::io::ErrorKind::UnexpectedEof, "tried to seek past the beginning of the buffer")
+            );
+        }
+
+        if result > self.len as i64 {
+            self.overflow = true;
+            return Err(std::io::Error::new(
+                std::io::ErrorKind::UnexpectedEof, "tried to seek past the end of the buffer")
+            );
+        }
+
+        self.current = result as u64;
+        return Ok(self.current);
+    }
+
+    fn stream_position(&mut self) -> std::io::Result<u64> {
+        return Ok(self.current);
+    }
+}
@@ -0,0 +1,247 @@
+use std::os::raw::c_char;
+use std::ffi::CStr;
+use std::fs::File;
+use std::io::BufReader;
+use std::sync::Arc;
+
+use crate::Error;
+use crate::io::TensorMapReader;
+use crate::data::mts_array_t;
+
+use super::super::status::{mts_status_t, catch_unwind};
+use super::super::blocks::mts_block_t;
+use super::super::labels::{mts_labels_t, rust_to_mts_labels, mts_labels_to_rust};
+use super::mts_create_array_callback_t;
+
+/// Opaque type representing a lazy reader for a serialized tensor map, created
+/// with `mts_tensormap_reader_open`.
+///
+/// Opening a reader only reads the keys of the tensor map and the list of files
+/// in the archive. Blocks are only read from the file and decoded when
+/// requested with `mts_tensormap_reader_block`. A reader can be used from
+/// multiple threads at the same time, but reading blocks is serialized.
+#[allow(non_camel_case_types)]
+pub struct mts_tensormap_reader_t(TensorMapReader<BufReader<File>>);
+
+/// Open the file at the given path for lazy reading of a serialized tensor map.
+///
+/// This only reads the keys of the tensor map and the ZIP central directory,
+/// the blocks themselves can then be loaded individually with
+/// `mts_tensormap_reader_block`. See `mts_tensormap_load` for more
+/// information about the format used to serialize the data.
+///
+/// The memory allocated by this function should be released using
+/// `mts_tensormap_reader_free`. The file stays open until then.
+///
+/// @param path path to the file as a NULL-terminated UTF-8 string
+///
+/// @returns A pointer to the newly allocated reader, or a `NULL` pointer in
+///          case of error. In case of error, you can use `mts_last_error()`
+///          to get the error message.
+#[no_mangle]
+pub unsafe extern fn mts_tensormap_reader_open(
+    path: *const c_char,
+) -> *mut mts_tensormap_reader_t {
+    let mut result = std::ptr::null_mut();
+    let unwind_wrapper = std::panic::AssertUnwindSafe(&mut result);
+    let status = catch_unwind(move || {
+        check_pointers_non_null!(path);
+
+        let path = CStr::from_ptr(path).to_str().expect("use UTF-8 for path");
+        let file = BufReader::new(File::open(path)?);
+        let reader = TensorMapReader::new(file)
+            .map_err(|err| match err {
+                Error::Serialization(message) => Error::Serialization(format!(
+                    "unable to read a TensorMap from '{}': {}", path, message
+                )),
+                err => return err,
+            })?;
+
+        // force the closure to capture the full unwind_wrapper, not just
+        // unwind_wrapper.0
+        let _ = &unwind_wrapper;
+        *(unwind_wrapper.0) = Box::into_raw(Box::new(mts_tensormap_reader_t(reader)));
+        Ok(())
+    });
+
+    if !status.is_success() {
+        return std::ptr::null_mut();
+    }
+
+    return result;
+}
+
+/// Free the memory associated with a `reader` previously created with
+/// `mts_tensormap_reader_open`, and close the corresponding file.
+///
+/// Blocks previously loaded with `mts_tensormap_reader_block` stay valid.
+///
+/// If `reader` is `NULL`, this function does nothing.
+///
+/// @param reader pointer to an existing tensor map reader, or `NULL`
+///
+/// @returns The status code of this operation. If the status is not
+///          `MTS_SUCCESS`, you can use `mts_last_error()` to get the full
+///          error message.
+#[no_mangle]
+pub unsafe extern fn mts_tensormap_reader_free(reader: *mut mts_tensormap_reader_t) -> mts_status_t {
+    catch_unwind(|| {
+        if !reader.is_null() {
+            std::mem::drop(Box::from_raw(reader));
+        }
+
+        Ok(())
+    })
+}
+
+/// Get the keys of the tensor map being read by this `reader`.
+///
+/// This function allocates memory for `keys` which must be released
+/// `mts_labels_free` when you don't need it anymore.
+///
+/// @param reader pointer to an existing tensor map reader
+/// @param keys pointer to be filled with the keys of the tensor map
+///
+/// @returns The status code of this operation. If the status is not
+///          `MTS_SUCCESS`, you can use `mts_last_error()` to get the full
+///          error message.
+#[no_mangle]
+pub unsafe extern fn mts_tensormap_reader_keys(
+    reader: *const mts_tensormap_reader_t,
+    keys: *mut mts_labels_t,
+) -> mts_status_t {
+    catch_unwind(|| {
+        check_pointers_non_null!(reader, keys);
+
+        if (*keys).is_rust() {
+            return Err(Error::InvalidParameter(
+                "these labels are already allocated, call mts_labels_free first".into()
+            ));
+        }
+
+        *keys = rust_to_mts_labels(Arc::clone((*reader).0.keys()));
+        Ok(())
+    })
+}
+
+/// Get indices of the blocks corresponding to the given `selection` in the
+/// tensor map being read by this `reader`, without loading any block. This
+/// follows the same rules as `mts_tensormap_blocks_matching`.
+///
+/// When calling this function, `*count` should contain the number of entries in
+/// `block_indexes`, which must be the number of keys. When the function returns
+/// successfully, `*count` will contain the number of blocks matching the
+/// selection, i.e. how many values were written to `block_indexes`.
+///
+/// @param reader pointer to an existing tensor map reader
+/// @param block_indexes array to be filled with indexes of blocks in the tensor
+///                      map matching the `selection`
+/// @param count number of entries in `block_indexes`
+/// @param selection labels with a single entry describing which blocks are requested
+///
+/// @returns The status code of this operation. If the status is not
+///          `MTS_SUCCESS`, you can use `mts_last_error()` to get the full
+///          error message.
+#[no_mangle]
+pub unsafe extern fn mts_tensormap_reader_blocks_matching(
+    reader: *const mts_tensormap_reader_t,
+    block_indexes: *mut usize,
+    count: *mut usize,
+    selection: mts_labels_t,
+) -> mts_status_t {
+    catch_unwind(|| {
+        check_pointers_non_null!(reader, count);
+
+        let keys = (*reader).0.keys();
+        if *count != keys.count() {
+            return Err(Error::InvalidParameter(format!(
+                "expected space for {} indices as input to mts_tensormap_reader_blocks_matching, got space for {}",
+                keys.count(), *count
+            )));
+        }
+
+        let selection = mts_labels_to_rust(&selection)?;
+        let rust_blocks = (*reader).0.blocks_matching(&selection)?;
+        *count = rust_blocks.len();
+
+        if keys.is_empty() {
+            return Ok(());
+        }
+
+        check_pointers_non_null!(block_indexes);
+        let block_indexes = std::slice::from_raw_parts_mut(block_indexes, *count);
+        for (idx, block) in rust_blocks.into_iter().enumerate() {
+            block_indexes[idx] = block;
+        }
+
+        Ok(())
+    })
+}
+
+/// Read and decode the `index`-th block of the tensor map being read by this
+/// `reader`.
+///
+/// Arrays for the values and gradient data will be created with the given
+/// `create_array` callback, and filled by this function with the corresponding
+/// data.
+///
+/// The returned block is independent from the `reader`, and the memory
+/// allocated by this function should be released using `mts_block_free`.
+///
+/// @param reader pointer to an existing tensor map reader
+/// @param index index of the block to load
+/// @param create_array callback function that will be used to create data
+///                     arrays inside the block
+///
+/// @returns A pointer to the newly allocated block, or a `NULL` pointer in
+///          case of error. In case of error, you can use `mts_last_error()`
+///          to get the error message.
+#[no_mangle]
+pub unsafe extern fn mts_tensormap_reader_block(
+    reader: *const mts_tensormap_reader_t,
+    index: usize,
+    create_array: mts_create_array_callback_t,
+) -> *mut mts_block_t {
+    let mut result = std::ptr::null_mut();
+    let unwind_wrapper = std::panic::AssertUnwindSafe(&mut result);
+    let status = catch_unwind(move || {
+        check_pointers_non_null!(reader);
+
+        let create_array = wrap_create_array(&create_array);
+        let block = (*reader).0.block(index, create_array)?;
+
+        // force the closure to capture the full unwind_wrapper, not just
+        // unwind_wrapper.0
+        let _ = &unwind_wrapper;
+        *(unwind_wrapper.0) = mts_block_t::into_boxed_raw(block);
+        Ok(())
+    });
+
+    if !status.is_success() {
+        return std::ptr::null_mut();
+    }
+
+    return result;
+}
+
+fn wrap_create_array(create_array: &mts_create_array_callback_t) -> impl Fn(Vec<usize>) -> Result<mts_array_t, Error> + '_ {
+    |shape: Vec<usize>| {
+        let mut array = mts_array_t::null();
+        let status = unsafe {
+            create_array(
+                shape.as_ptr(),
+                shape.len(),
+                &mut array
+            )
+        };
+
+        if status.is_success() {
+            return Ok(array);
+        } else {
+            return Err(Error::External {
+                status: status,
+                context: "failed to create a new array in mts_tensormap_reader_block".into()
+            });
+        }
+    }
+}
@@ -2,15 +2,19 @@ use std::os::raw::{c_char, c_void};
 use std::ffi::CStr;
 use std::fs::File;
 use std::io::{BufReader, BufWriter};
+use std::sync::Arc;
 
 use crate::Error;
+use crate::profiling::Operation;
+use crate::io::MmapFile;
 use crate::data::mts_array_t;
 
-use super::{ExternalBuffer, mts_realloc_buffer_t};
+use super::{ExternalBuffer, FixedBuffer, SizeCounter, mts_realloc_buffer_t, mts_save_options_t, mts_load_options_t};
 
 use super::super::status::{mts_status_t, catch_unwind};
 use super::super::tensor::mts_tensormap_t;
 use super::mts_create_array_callback_t;
+use super::mmap::{mts_create_mmap_array_callback_t, wrap_create_mmap_array};
 
 /// Load a tensor map from the file at the given path.
 ///
@@ -64,17 +68,50 @@ use super::mts_create_array_callback_t;
 pub unsafe extern fn mts_tensormap_load(
     path: *const c_char,
     create_array: mts_create_array_callback_t,
+) -> *mut mts_tensormap_t {
+    mts_tensormap_load_with_options(
+        path,
+        create_array,
+        mts_load_options_t::default(),
+    )
+}
+
+/// Load a tensor map from the file at the given path.
+///
+/// This is the same as `mts_tensormap_load`, using the given `options` to
+/// control how the data is loaded. In particular, `options.threads` can be
+/// used to decode the blocks in parallel, in which case `create_array` will be
+/// called concurrently from multiple threads (see
+/// `mts_create_array_callback_t` for more information).
+///
+/// The memory allocated by this function should be released using
+/// `mts_tensormap_free`.
+///
+/// @param path path to the file as a NULL-terminated UTF-8 string
+/// @param create_array callback function that will be used to create data
+///                     arrays inside each block
+/// @param options options controlling how the data is loaded
+///
+/// @returns A pointer to the newly allocated tensor map, or a `NULL` pointer in
+///          case of error. In case of error, you can use `mts_last_error()`
+///          to get the error message.
+#[no_mangle]
+pub unsafe extern fn mts_tensormap_load_with_options(
+    path: *const c_char,
+    create_array: mts_create_array_callback_t,
+    options: mts_load_options_t,
 ) -> *mut mts_tensormap_t {
     let mut result = std::ptr::null_mut();
     let unwind_wrapper = std::panic::AssertUnwindSafe(&mut result);
     let status = catch_unwind(move || {
+        let _profiling = crate::profiling::scope(Operation::TensorMapLoad);
         check_pointers_non_null!(path);
 
         let create_array = wrap_create_array(&create_array);
 
         let path = CStr::from_ptr(path).to_str().expect("use UTF-8 for path");
-        let file = BufReader::new(File::open(path)?);
-        let tensor = crate::io::load(file, create_array)
+        let open = || Ok(BufReader::new(File::open(path)?));
+        let tensor = crate::io::load_with_options(open, create_array, options.to_rust())
             .map_err(|err| match err {
                 Error::Serialization(message) => {
                     if crate::io::looks_like_labels_data(crate::io::PathOrBuffer::Path(path)) {
@@ -98,6 +135,7 @@ pub unsafe extern fn mts_tensormap_load(
         // unwind_wrapper.0
         let _ = &unwind_wrapper;
         *(unwind_wrapper.0) = mts_tensormap_t::into_boxed_raw(tensor);
+        crate::profiling::add_file_bytes(Operation::TensorMapLoad, path);
         Ok(())
     });
 
@@ -130,19 +168,55 @@ pub unsafe extern fn mts_tensormap_load_buffer(
     buffer: *const u8,
     buffer_count: usize,
     create_array: mts_create_array_callback_t,
+) -> *mut mts_tensormap_t {
+    mts_tensormap_load_buffer_with_options(
+        buffer,
+        buffer_count,
+        create_array,
+        mts_load_options_t::default(),
+    )
+}
+
+/// Load a tensor map from the given in-memory buffer.
+///
+/// This is the same as `mts_tensormap_load_buffer`, using the given `options`
+/// to control how the data is loaded. In particular, `options.threads` can be
+/// used to decode the blocks in parallel, in which case `create_array` will be
+/// called concurrently from multiple threads (see
+/// `mts_create_array_callback_t` for more information).
+///
+/// The memory allocated by this function should be released using
+/// `mts_tensormap_free`.
+///
+/// @param buffer buffer containing a previously serialized `mts_tensormap_t`
+/// @param buffer_count number of elements in the buffer
+/// @param create_array callback function that will be used to create data
+///                     arrays inside each block
+/// @param options options controlling how the data is loaded
+///
+/// @returns A pointer to the newly allocated tensor map, or a `NULL` pointer in
+///          case of error. In case of error, you can use `mts_last_error()`
+///          to get the error message.
+#[no_mangle]
+pub unsafe extern fn mts_tensormap_load_buffer_with_options(
+    buffer: *const u8,
+    buffer_count: usize,
+    create_array: mts_create_array_callback_t,
+    options: mts_load_options_t,
 ) -> *mut mts_tensormap_t {
     let mut result = std::ptr::null_mut();
     let unwind_wrapper = std::panic::AssertUnwindSafe(&mut result);
     let status = catch_unwind(move || {
+        let _profiling = crate::profiling::scope(Operation::TensorMapLoad);
         check_pointers_non_null!(buffer);
         assert!(buffer_count > 0);
 
         let create_array = wrap_create_array(&create_array);
 
         let slice = std::slice::from_raw_parts(buffer.cast::<u8>(), buffer_count);
-        let cursor = std::io::Cursor::new(slice);
+        let open = || Ok(std::io::Cursor::new(slice));
 
-        let tensor = crate::io::load(cursor, create_array)
+        let tensor = crate::io::load_with_options(open, create_array, options.to_rust())
             .map_err(|err| match err {
                 Error::Serialization(message) => {
                     let slice = std::slice::from_raw_parts(buffer.cast::<u8>(), buffer_count);
@@ -168,6 +242,73 @@ pub unsafe extern fn mts_tensormap_load_buffer(
         // unwind_wrapper.0
         let _ = &unwind_wrapper;
         *(unwind_wrapper.0) = mts_tensormap_t::into_boxed_raw(tensor);
+        crate::profiling::add_bytes(Operation::TensorMapLoad, buffer_count);
+        Ok(())
+    });
+
+    if !status.is_success() {
+        return std::ptr::null_mut();
+    }
+
+    return result;
+}
+
+/// Load a tensor map from the file at the given path, using a memory map to
+/// access the file content.
+///
+/// Whenever possible, the arrays will directly use the memory of the mapped
+/// file, without copying the data. This requires the data to be stored without
+/// compression, with the native endianness, and properly aligned in the file;
+/// which is the case for files created by `mts_tensormap_save` and
+/// `mts_tensormap_save_buffer`. Otherwise the data is copied to newly created
+/// arrays. When loading the same file from multiple processes, the memory
+/// pages containing the data are shared between all of them.
+///
+/// Arrays for the values and gradient data will be created with the given
+/// `create_array` callback, see `mts_create_mmap_array_callback_t` for more
+/// information.
+///
+/// The memory allocated by this function should be released using
+/// `mts_tensormap_free`.
+///
+/// See `mts_tensormap_load` for more information about the format used to
+/// serialize the data.
+///
+/// @param path path to the file as a NULL-terminated UTF-8 string
+/// @param create_array callback function that will be used to create data
+///                     arrays inside each block
+///
+/// @returns A pointer to the newly allocated tensor map, or a `NULL` pointer in
+///          case of error. In case of error, you can use `mts_last_error()`
+///          to get the error message.
+#[no_mangle]
+pub unsafe extern fn mts_tensormap_load_mmap(
+    path: *const c_char,
+    create_array: mts_create_mmap_array_callback_t,
+) -> *mut mts_tensormap_t {
+    let mut result = std::ptr::null_mut();
+    let unwind_wrapper = std::panic::AssertUnwindSafe(&mut result);
+    let status = catch_unwind(move || {
+        let _profiling = crate::profiling::scope(Operation::TensorMapLoad);
+        check_pointers_non_null!(path);
+
+        let create_array = wrap_create_mmap_array(&create_array);
+
+        let path = CStr::from_ptr(path).to_str().expect("use UTF-8 for path");
+        let mmap = Arc::new(MmapFile::open(path)?);
+        let tensor = crate::io::load_mmap(&mmap, create_array)
+            .map_err(|err| match err {
+                Error::Serialization(message) => Error::Serialization(format!(
+                    "unable to load a TensorMap from '{}': {}", path, message
+                )),
+                err => return err,
+            })?;
+
+        // force the closure to capture the full unwind_wrapper, not just
+        // unwind_wrapper.0
+        let _ = &unwind_wrapper;
+        *(unwind_wrapper.0) = mts_tensormap_t::into_boxed_raw(tensor);
+        crate::profiling::add_bytes(Operation::TensorMapLoad, mmap.as_slice().len());
         Ok(())
     });
 
@@ -215,13 +356,46 @@ fn wrap_create_array(create_array: &mts_create_array_callback_t) -> impl Fn(Vec<
 pub unsafe extern fn mts_tensormap_save(
     path: *const c_char,
     tensor: *const mts_tensormap_t,
+) -> mts_status_t {
+    mts_tensormap_save_with_options(
+        path,
+        tensor,
+        mts_save_options_t::default(),
+    )
+}
+
+
+/// Save a tensor map to the file at the given path.
+///
+/// This is the same as `mts_tensormap_save`, using the given `options` to
+/// control the compression of the file and the floating point type used to
+/// store data.
+///
+/// If the file already exists, it is overwritten.
+///
+/// @param path path to the file as a NULL-terminated UTF-8 string
+/// @param tensor tensor map to save to the file
+/// @param options options controlling the compression and floating point
+///                type used to store the data
+///
+/// @returns The status code of this operation. If the status is not
+///          `MTS_SUCCESS`, you can use `mts_last_error()` to get the full
+///          error message.
+#[no_mangle]
+pub unsafe extern fn mts_tensormap_save_with_options(
+    path: *const c_char,
+    tensor: *const mts_tensormap_t,
+    options: mts_save_options_t,
 ) -> mts_status_t {
     catch_unwind(|| {
+        let _profiling = crate::profiling::scope(Operation::TensorMapSave);
         check_pointers_non_null!(path, tensor);
 
         let path = CStr::from_ptr(path).to_str().expect("use UTF-8 for path");
         let file = BufWriter::new(File::create(path)?);
-        crate::io::save(file, &*tensor)?;
+        crate::io::save(file, &*tensor, options.to_rust()?)?;
+
+        crate::profiling::add_file_bytes(Operation::TensorMapSave, path);
 
         Ok(())
     })
@@ -253,15 +427,66 @@ pub unsafe extern fn mts_tensormap_save(
 ///          `MTS_SUCCESS`, you can use `mts_last_error()` to get the full error
 ///          message.
 #[no_mangle]
-#[allow(clippy::cast_possible_truncation)]
 pub unsafe extern fn mts_tensormap_save_buffer(
     buffer: *mut *mut u8,
     buffer_count: *mut usize,
     realloc_user_data: *mut c_void,
     realloc: mts_realloc_buffer_t,
     tensor: *const mts_tensormap_t,
+) -> mts_status_t {
+    mts_tensormap_save_buffer_with_options(
+        buffer,
+        buffer_count,
+        realloc_user_data,
+        realloc,
+        tensor,
+        mts_save_options_t::default(),
+    )
+}
+
+
+/// Save a tensor map to an in-memory buffer.
+///
+/// This is the same as `mts_tensormap_save_buffer`, using the given `options`
+/// to control the compression of the data and the floating point type used to
+/// store it.
+///
+/// On input, `*buffer` should contain the address of a starting buffer (which
+/// can be NULL) and `*buffer_count` should contain the size of the allocation.
+///
+/// On output, `*buffer` will contain the serialized data, and `*buffer_count`
+/// the total number of written bytes (which might be less than the allocation
+/// size).
+///
+/// Users of this function are responsible for freeing the `*buffer` when they
+/// are done with it, using the function matching the `realloc` callback.
+///
+/// @param buffer pointer to the buffer the tensor will be stored to, which can
+///        change due to reallocations.
+/// @param buffer_count pointer to the buffer size on input, number of written
+///        bytes on output
+/// @param realloc_user_data custom data for the `realloc` callback. This will
+///        be passed as the first argument to `realloc` as-is.
+/// @param realloc function that allows to grow the buffer allocation
+/// @param tensor tensor map that will saved to the buffer
+/// @param options options controlling the compression and floating point
+///                type used to store the data
+///
+/// @returns The status code of this operation. If the status is not
+///          `MTS_SUCCESS`, you can use `mts_last_error()` to get the full error
+///          message.
+#[no_mangle]
+#[allow(clippy::cast_possible_truncation)]
+pub unsafe extern fn mts_tensormap_save_buffer_with_options(
+    buffer: *mut *mut u8,
+    buffer_count: *mut usize,
+    realloc_user_data: *mut c_void,
+    realloc: mts_realloc_buffer_t,
+    tensor: *const mts_tensormap_t,
+    options: mts_save_options_t,
 ) -> mts_status_t {
     catch_unwind(|| {
+        let _profiling = crate::profiling::scope(Operation::TensorMapSave);
         check_pointers_non_null!(tensor, buffer_count, buffer);
 
         if realloc.is_none() {
@@ -282,10 +507,96 @@ pub unsafe extern fn mts_tensormap_save_buffer(
             current: 0,
         };
 
-        crate::io::save(&mut external_buffer, &*tensor)?;
+        crate::io::save(&mut external_buffer, &*tensor, options.to_rust()?)?;
 
         *buffer_count = external_buffer.current as usize;
 
+        crate::profiling::add_bytes(Operation::TensorMapSave, *buffer_count);
+
+        Ok(())
+    })
+}
+
+
+/// Get the exact number of bytes needed to save this tensor map with the given
+/// `options`, i.e. the size of the buffer for `mts_tensormap_save_into_buffer`
+/// or the number of bytes written by `mts_tensormap_save_buffer_with_options`.
+///
+/// This goes through all the serialization steps without storing the data, so
+/// it costs about as much as saving the tensor map itself.
+///
+/// @param tensor tensor map that will be saved
+/// @param options options controlling the compression and floating point
+///                type used to store the data
+/// @param size on output, will contain the size of the serialized data in
+///             bytes
+///
+/// @returns The status code of this operation. If the status is not
+///          `MTS_SUCCESS`, you can use `mts_last_error()` to get the full error
+///          message.
+#[no_mangle]
+#[allow(clippy::cast_possible_truncation)]
+pub unsafe extern fn mts_tensormap_serialized_size(
+    tensor: *const mts_tensormap_t,
+    options: mts_save_options_t,
+    size: *mut usize,
+) -> mts_status_t {
+    catch_unwind(move || {
+        check_pointers_non_null!(tensor, size);
+
+        let mut counter = SizeCounter::default();
+        crate::io::save(&mut counter, &*tensor, options.to_rust()?)?;
+        *size = counter.end as usize;
+
+        Ok(())
+    })
+}
+
+
+/// Save this tensor map to an existing in-memory buffer with the given
+/// `options`, without any reallocation.
+///
+/// The buffer must be large enough to contain the whole serialized data, which
+/// size can be obtained with `mts_tensormap_serialized_size`. The data written
+/// to the buffer is the same as the one produced by
+/// `mts_tensormap_save_buffer_with_options`.
+///
+/// @param buffer pointer to the start of the buffer
+/// @param buffer_count size of the buffer, in bytes
+/// @param written on output, will contain the number of bytes written to the
+///                buffer
+/// @param tensor tensor map that will be saved to the buffer
+/// @param options options controlling the compression and floating point
+///                type used to store the data
+///
+/// @returns The status code of this operation. If the status is not
+///          `MTS_SUCCESS`, you can use `mts_last_error()` to get the full error
+///          message.
+#[no_mangle]
+#[allow(clippy::cast_possible_truncation)]
+pub unsafe extern fn mts_tensormap_save_into_buffer(
+    buffer: *mut u8,
+    buffer_count: usize,
+    written: *mut usize,
+    tensor: *const mts_tensormap_t,
+    options: mts_save_options_t,
+) -> mts_status_t {
+    catch_unwind(move || {
+        let _profiling = crate::profiling::scope(Operation::TensorMapSave);
+        check_pointers_non_null!(buffer, written, tensor);
+
+        let options = options.to_rust()?;
+        let mut fixed = FixedBuffer::new(buffer, buffer_count);
+        let result = crate::io::save(&mut fixed, &*tensor, options);
+        if fixed.overflow {
+            return Err(fixed.overflow_error("tensor map"));
+        }
+        result?;
+
+        *written = fixed.end as usize;
+
+        crate::profiling::add_bytes(Operation::TensorMapSave, *written);
+
         Ok(())
     })
 }
@@ -0,0 +1,195 @@
+use std::os::raw::c_char;
+use std::ffi::CStr;
+use std::fs::File;
+use std::io::BufWriter;
+
+use crate::Error;
+use crate::io::TensorMapWriter;
+
+use super::super::status::{mts_status_t, catch_unwind};
+use super::super::blocks::mts_block_t;
+use super::mts_save_options_t;
+
+/// Opaque type representing an incremental writer for a tensor map, created
+/// with `mts_tensormap_writer_open`.
+///
+/// Blocks are written to the file one at a time with
+/// `mts_tensormap_writer_append`, and the file is completed with
+/// `mts_tensormap_writer_finish`. This allows to save tensor maps that do not
+/// fit in memory, the writer only keeps the blocks appended for the current key
+/// in memory, until a block with a different key is appended.
+#[allow(non_camel_case_types)]
+pub struct mts_tensormap_writer_t(Option<TensorMapWriter<BufWriter<File>>>);
+
+// The writer contains a `Cell` used to track the position in the file, which
+// is only ever accessed from the functions below. If a panic happens while
+// writing, the file will be invalid anyway.
+impl std::panic::RefUnwindSafe for mts_tensormap_writer_t {}
+
+impl mts_tensormap_writer_t {
+    fn writer(&mut self) -> Result<&mut TensorMapWriter<BufWriter<File>>, Error> {
+        return self.0.as_mut().ok_or_else(|| Error::InvalidParameter(
+            "this tensor map writer has already been finished".into()
+        ));
+    }
+}
+
+/// Create a new incremental writer for a tensor map with keys containing the
+/// given `key_names` dimensions, writing to the file at the given `path`.
+///
+/// The file is created if it does not exist, and overwritten otherwise. The
+/// data is written with the same format as `mts_tensormap_save`, and can be
+/// loaded with `mts_tensormap_load` once `mts_tensormap_writer_finish` has been
+/// called.
+///
+/// `key_names` must be an array of `key_names_count` NULL-terminated strings,
+/// encoded as UTF-8. The `options` control the compression of the file and the
+/// floating point type used to store the data, see `mts_save_options_t`.
+///
+/// The memory allocated by this function should be released using
+/// `mts_tensormap_writer_free`.
+///
+/// @param path path to the file as a NULL-terminated UTF-8 string
+/// @param key_names names of the dimensions of the keys
+/// @param key_names_count number of entries in the `key_names` array
+/// @param options options controlling the compression and floating point
+///                type used to store the data
+///
+/// @returns A pointer to the newly allocated writer, or a `NULL` pointer in
+///          case of error. In case of error, you can use `mts_last_error()`
+///          to get the error message.
+#[no_mangle]
+pub unsafe extern fn mts_tensormap_writer_open(
+    path: *const c_char,
+    key_names: *const *const c_char,
+    key_names_count: usize,
+    options: mts_save_options_t,
+) -> *mut mts_tensormap_writer_t {
+    let mut result = std::ptr::null_mut();
+    let unwind_wrapper = std::panic::AssertUnwindSafe(&mut result);
+    let status = catch_unwind(move || {
+        check_pointers_non_null!(path);
+
+        let mut rust_names = Vec::new();
+        if key_names_count != 0 {
+            check_pointers_non_null!(key_names);
+            for &name in std::slice::from_raw_parts(key_names, key_names_count) {
+                check_pointers_non_null!(name);
+                let name = CStr::from_ptr(name).to_str().expect("invalid utf8");
+                rust_names.push(name);
+            }
+        }
+
+        let path = CStr::from_ptr(path).to_str().expect("use UTF-8 for path");
+        let file = BufWriter::new(File::create(path)?);
+        let writer = TensorMapWriter::new(file, &rust_names, options.to_rust()?)?;
+
+        // force the closure to capture the full unwind_wrapper, not just
+        // unwind_wrapper.0
+        let _ = &unwind_wrapper;
+        *(unwind_wrapper.0) = Box::into_raw(Box::new(mts_tensormap_writer_t(Some(writer))));
+        Ok(())
+    });
+
+    if !status.is_success() {
+        return std::ptr::null_mut();
+    }
+
+    return result;
+}
+
+/// Free the memory associated with a `writer` previously created with
+/// `mts_tensormap_writer_open`, and close the corresponding file.
+///
+/// If `mts_tensormap_writer_finish` was not called on this writer before, the
+/// file will be incomplete and can not be loaded.
+///
+/// If `writer` is `NULL`, this function does nothing.
+///
+/// @param writer pointer to an existing tensor map writer, or `NULL`
+///
+/// @returns The status code of this operation. If the status is not
+///          `MTS_SUCCESS`, you can use `mts_last_error()` to get the full
+///          error message.
+#[no_mangle]
+pub unsafe extern fn mts_tensormap_writer_free(writer: *mut mts_tensormap_writer_t) -> mts_status_t {
+    catch_unwind(|| {
+        if !writer.is_null() {
+            std::mem::drop(Box::from_raw(writer));
+        }
+
+        Ok(())
+    })
+}
+
+/// Append a `block` with the given `key` to the tensor map being written by
+/// this `writer`.
+///
+/// If `key` is the same as the key of the previously appended block, the
+/// samples of `block` are added to the samples of this previous block
+/// instead, and the components, properties and gradients of both blocks must
+/// match. Otherwise, `key` must not have been used before: all the samples
+/// for a given key must be appended one after the other.
+///
+/// The writer takes ownership of the block, which should not be released
+/// separately, even if this function returns an error.
+///
+/// @param writer pointer to an existing tensor map writer
+/// @param key values of the key associated with the block
+/// @param key_count number of entries in `key`, this must match the number of
+///                  names given to `mts_tensormap_writer_open`
+/// @param block block to write to the file
+///
+/// @returns The status code of this operation. If the status is not
+///          `MTS_SUCCESS`, you can use `mts_last_error()` to get the full
+///          error message.
+#[no_mangle]
+pub unsafe extern fn mts_tensormap_writer_append(
+    writer: *mut mts_tensormap_writer_t,
+    key: *const i32,
+    key_count: usize,
+    block: *mut mts_block_t,
+) -> mts_status_t {
+    catch_unwind(|| {
+        check_pointers_non_null!(block);
+        // move the block out of the pointer
+        let block = mts_block_t::from_boxed_raw(block);
+
+        check_pointers_non_null!(writer);
+        let key = if key_count == 0 {
+            &[]
+        } else {
+            check_pointers_non_null!(key);
+            std::slice::from_raw_parts(key, key_count)
+        };
+
+        (*writer).writer()?.append(key, block)?;
+
+        Ok(())
+    })
+}
+
+/// Finish writing the tensor map, writing the last block, the keys of the
+/// tensor map and the ZIP central directory to the file, and flushing all data
+/// to disk.
+///
+/// After this function returns, no more blocks can be appended to the writer,
+/// which must still be released with `mts_tensormap_writer_free`.
+///
+/// @param writer pointer to an existing tensor map writer
+///
+/// @returns The status code of this operation. If the status is not
+///          `MTS_SUCCESS`, you can use `mts_last_error()` to get the full
+///          error message.
+#[no_mangle]
+pub unsafe extern fn mts_tensormap_writer_finish(writer: *mut mts_tensormap_writer_t) -> mts_status_t {
+    catch_unwind(|| {
+        check_pointers_non_null!(writer);
+
+        (*writer).writer()?;
+        let rust_writer = (*writer).0.take().expect("writer should not be finished");
+        rust_writer.finish()?;
+
+        Ok(())
+    })
+}
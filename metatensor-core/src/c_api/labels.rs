@@ -3,6 +3,7 @@ use std::ffi::CStr;
 use std::sync::Arc;
 
 use crate::{LabelValue, Labels, Error};
+use crate::profiling::Operation;
 use super::status::{mts_status_t, catch_unwind};
 
 /// A set of labels used to carry metadata associated with a tensor map.
@@ -91,23 +92,12 @@ pub unsafe fn mts_labels_to_rust(labels: &mts_labels_t) -> Result<Arc<Labels>, E
     }
 
     // otherwise, create new labels from the data
-    return create_rust_labels(labels);
+    return create_rust_labels(labels, false);
 }
 
-/// Create a new set of rust Labels from `mts_labels_t`, copying the data into
-/// Rust managed memory.
-unsafe fn create_rust_labels(labels: &mts_labels_t) -> Result<Arc<Labels>, Error> {
-    assert!(!labels.is_rust());
-
-    if labels.size == 0 {
-        if labels.count > 0 {
-            return Err(Error::InvalidParameter("can not have labels.count > 0 if labels.size is 0".into()));
-        }
-
-        let labels = Labels::new(&[], Vec::<i32>::new()).expect("invalid empty labels");
-        return Ok(Arc::new(labels));
-    }
-
+/// Check the names and values pointers in `labels`, and get the names as Rust
+/// strings
+unsafe fn check_labels_names(labels: &mts_labels_t) -> Result<Vec<&str>, Error> {
     if labels.names.is_null() {
         return Err(Error::InvalidParameter("labels.names can not be NULL in mts_labels_t".into()))
     }
@@ -128,6 +118,25 @@ unsafe fn create_rust_labels(labels: &mts_labels_t) -> Result<Arc<Labels>, Error
         names.push(name);
     }
 
+    return Ok(names);
+}
+
+/// Create a new set of rust Labels from `mts_labels_t`, copying the data into
+/// Rust managed memory.
+unsafe fn create_rust_labels(labels: &mts_labels_t, assume_unique: bool) -> Result<Arc<Labels>, Error> {
+    assert!(!labels.is_rust());
+
+    if labels.size == 0 {
+        if labels.count > 0 {
+            return Err(Error::InvalidParameter("can not have labels.count > 0 if labels.size is 0".into()));
+        }
+
+        let labels = Labels::new(&[], Vec::<i32>::new()).expect("invalid empty labels");
+        return Ok(Arc::new(labels));
+    }
+
+    let names = check_labels_names(labels)?;
+
     let values = if labels.count != 0 && labels.size != 0 {
         assert!(!labels.values.is_null());
         let slice = std::slice::from_raw_parts(labels.values.cast::<LabelValue>(), labels.count * labels.size);
@@ -136,7 +145,11 @@ unsafe fn create_rust_labels(labels: &mts_labels_t) -> Result<Arc<Labels>, Error
         vec![]
     };
 
-    let labels = Labels::new(&names, values)?;
+    let labels = if assume_unique {
+        Labels::new_unchecked_uniqueness(&names, values)?
+    } else {
+        Labels::new(&names, values)?
+    };
     return Ok(Arc::new(labels));
 }
 
@@ -187,6 +200,127 @@ pub unsafe extern fn mts_labels_position(
     })
 }
 
+/// Get the positions of multiple entries in the given set of `labels`, in a
+/// single call. This operation is only available if the labels correspond to a
+/// set of Rust Labels (i.e. `labels.internal_ptr_` is not NULL).
+///
+/// `values` should point to a 2D row-major array of shape `(count, size)`,
+/// where `size` must match the size of `labels`. On output, `result` (which
+/// must contain space for `count` elements) contains the position of each entry
+/// in the labels, or -1 for entries which are not part of the labels.
+///
+/// @param labels set of labels with an associated Rust data structure
+/// @param values array containing the entries to lookup
+/// @param count number of entries to lookup
+/// @param size size of each entry, this should be the same as `labels.size`
+/// @param result positions of the entries in the labels or -1 if the
+///               corresponding entry was not found
+///
+/// @returns The status code of this operation. If the status is not
+///          `MTS_SUCCESS`, you can use `mts_last_error()` to get the full
+///          error message.
+#[no_mangle]
+#[allow(clippy::cast_possible_wrap)]
+pub unsafe extern fn mts_labels_positions(
+    labels: mts_labels_t,
+    values: *const i32,
+    count: usize,
+    size: usize,
+    result: *mut i64,
+) -> mts_status_t {
+    catch_unwind(|| {
+        if !labels.is_rust() {
+            return Err(Error::InvalidParameter(
+                "these labels do not support calling mts_labels_positions, \
+                call mts_labels_create first".into()
+            ));
+        }
+
+        let labels = &(*labels.internal_ptr_.cast::<Labels>());
+        if size != labels.size() {
+            return Err(Error::InvalidParameter(format!(
+                "expected entries of size {} in mts_labels_positions, got size {}",
+                labels.size(), size
+            )));
+        }
+
+        if count == 0 {
+            return Ok(());
+        }
+
+        check_pointers_non_null!(result);
+        let result = std::slice::from_raw_parts_mut(result, count);
+        if size == 0 {
+            // labels without dimensions are always empty
+            result.fill(-1);
+            return Ok(());
+        }
+
+        check_pointers_non_null!(values);
+        let values = std::slice::from_raw_parts(values.cast::<LabelValue>(), count * size);
+        for (entry, position) in values.chunks_exact(size).zip(result) {
+            *position = labels.position(entry).map_or(-1, |p| p as i64);
+        }
+
+        Ok(())
+    })
+}
+
+/// Get the range of rows `[start, end)` in the given set of `labels` containing
+/// all the entries starting with the values in `prefix`, i.e. all the entries
+/// where the first `prefix_count` dimensions match `prefix`. This operation is
+/// only available if the labels correspond to a set of Rust Labels (i.e.
+/// `labels.internal_ptr_` is not NULL).
+///
+/// If the labels are sorted in lexicographic order, this uses a binary search
+/// and an empty range (`start == end`) indicates where entries with this
+/// prefix would be inserted. Otherwise, all the entries are checked, and this
+/// function returns an error if the matching entries are not contiguous. An
+/// empty range with `start == end == 0` is returned if no entry matches.
+///
+/// @param labels set of labels with an associated Rust data structure
+/// @param prefix array containing the values of the first dimensions to match
+/// @param prefix_count size of the `prefix` array, this should be smaller or
+///                     equal to `labels.size`
+/// @param start on output, the index of the first matching entry
+/// @param end on output, one past the index of the last matching entry
+///
+/// @returns The status code of this operation. If the status is not
+///          `MTS_SUCCESS`, you can use `mts_last_error()` to get the full
+///          error message.
+#[no_mangle]
+pub unsafe extern fn mts_labels_range_of(
+    labels: mts_labels_t,
+    prefix: *const i32,
+    prefix_count: usize,
+    start: *mut usize,
+    end: *mut usize,
+) -> mts_status_t {
+    catch_unwind(|| {
+        check_pointers_non_null!(start, end);
+        if !labels.is_rust() {
+            return Err(Error::InvalidParameter(
+                "these labels do not support calling mts_labels_range_of, \
+                call mts_labels_create first".into()
+            ));
+        }
+
+        let labels = &(*labels.internal_ptr_.cast::<Labels>());
+        let prefix: &[LabelValue] = if prefix_count == 0 {
+            &[]
+        } else {
+            check_pointers_non_null!(prefix);
+            std::slice::from_raw_parts(prefix.cast::<LabelValue>(), prefix_count)
+        };
+
+        let range = labels.range_of(prefix)?;
+        *start = range.start;
+        *end = range.end;
+
+        Ok(())
+    })
+}
+
 
 /// Finish the creation of `mts_labels_t` by associating it to Rust-owned
 /// labels.
@@ -207,6 +341,47 @@ pub unsafe extern fn mts_labels_create(
     labels: *mut mts_labels_t,
 ) -> mts_status_t {
     catch_unwind(|| {
+        let _profiling = crate::profiling::scope(Operation::LabelsCreate);
+        check_pointers_non_null!(labels);
+
+        if (*labels).is_rust() {
+            return Err(Error::InvalidParameter(
+                "these labels already correspond to rust labels".into()
+            ));
+        }
+
+        let rust_labels = create_rust_labels(&*labels, false)?;
+        *labels = rust_to_mts_labels(rust_labels);
+
+        crate::profiling::add_bytes(Operation::LabelsCreate, (*labels).count * (*labels).size * std::mem::size_of::<i32>());
+
+        Ok(())
+    })
+}
+
+/// Finish the creation of `mts_labels_t` by associating it to Rust-owned
+/// labels, assuming that all the entries in `labels` are already unique.
+///
+/// This is identical to `mts_labels_create`, but does not check that the
+/// entries are unique (this check is still done when metatensor is built in
+/// debug mode). This is faster when the labels are known to be unique by
+/// construction. Creating labels with duplicated entries with this function
+/// will result in unspecified behavior in other functions using these labels.
+///
+/// This function allocates memory which must be released `mts_labels_free` when
+/// you don't need it anymore.
+///
+/// @param labels new set of labels containing pointers to user-managed memory
+///        on input, and pointers to Rust-managed memory on output.
+/// @returns The status code of this operation. If the status is not
+///          `MTS_SUCCESS`, you can use `mts_last_error()` to get the full
+///          error message.
+#[no_mangle]
+pub unsafe extern fn mts_labels_create_assume_unique(
+    labels: *mut mts_labels_t,
+) -> mts_status_t {
+    catch_unwind(|| {
+        let _profiling = crate::profiling::scope(Operation::LabelsCreate);
         check_pointers_non_null!(labels);
 
         if (*labels).is_rust() {
@@ -215,9 +390,82 @@ pub unsafe extern fn mts_labels_create(
             ));
         }
 
-        let rust_labels = create_rust_labels(&*labels)?;
+        let rust_labels = create_rust_labels(&*labels, true)?;
         *labels = rust_to_mts_labels(rust_labels);
 
+        crate::profiling::add_bytes(Operation::LabelsCreate, (*labels).count * (*labels).size * std::mem::size_of::<i32>());
+
+        Ok(())
+    })
+}
+
+/// Finish the creation of `mts_labels_t` by associating it to Rust-owned
+/// labels, without copying the values.
+///
+/// This is identical to `mts_labels_create` (or to
+/// `mts_labels_create_assume_unique` if `assume_unique` is true), except that
+/// the Rust labels directly use the memory pointed to by `labels->values`
+/// instead of a copy. This memory must stay alive and must not be modified
+/// until `values_owner_delete` is called with `values_owner`, which happens
+/// when the last reference to the Rust labels is released.
+///
+/// If this function fails, `values_owner_delete` is not called and the caller
+/// is still responsible for releasing `values_owner`.
+///
+/// This function allocates memory which must be released `mts_labels_free` when
+/// you don't need it anymore.
+///
+/// @param labels new set of labels containing pointers to user-managed memory
+///        on input, and pointers to Rust-managed memory on output (with
+///        `labels->values` unchanged).
+/// @param assume_unique should we skip the check that all entries are unique?
+/// @param values_owner pointer to the data owning the memory of
+///        `labels->values`
+/// @param values_owner_delete function pointer that will be used (if not NULL)
+///        to release `values_owner` when the labels are freed.
+/// @returns The status code of this operation. If the status is not
+///          `MTS_SUCCESS`, you can use `mts_last_error()` to get the full
+///          error message.
+#[no_mangle]
+pub unsafe extern fn mts_labels_create_borrowed(
+    labels: *mut mts_labels_t,
+    assume_unique: bool,
+    values_owner: *mut c_void,
+    values_owner_delete: Option<unsafe extern fn(*mut c_void)>,
+) -> mts_status_t {
+    catch_unwind(|| {
+        let _profiling = crate::profiling::scope(Operation::LabelsCreate);
+        check_pointers_non_null!(labels);
+
+        if (*labels).is_rust() {
+            return Err(Error::InvalidParameter(
+                "these labels already correspond to rust labels".into()
+            ));
+        }
+
+        if (*labels).size == 0 && (*labels).count > 0 {
+            return Err(Error::InvalidParameter("can not have labels.count > 0 if labels.size is 0".into()));
+        }
+
+        let names = if (*labels).size == 0 {
+            Vec::new()
+        } else {
+            check_labels_names(&*labels)?
+        };
+
+        let rust_labels = Labels::new_borrowed(
+            &names,
+            (*labels).values.cast(),
+            (*labels).count * (*labels).size,
+            values_owner,
+            values_owner_delete,
+            !assume_unique,
+        )?;
+
+        *labels = rust_to_mts_labels(Arc::new(rust_labels));
+
+        crate::profiling::add_bytes(Operation::LabelsCreate, (*labels).count * (*labels).size * std::mem::size_of::<i32>());
+
         Ok(())
     })
 }
@@ -431,6 +679,7 @@ pub unsafe extern fn mts_labels_union(
 ) -> mts_status_t {
     let unwind_wrapper = std::panic::AssertUnwindSafe(result);
     catch_unwind(|| {
+        let _profiling = crate::profiling::scope(Operation::LabelsUnion);
         let (first_mapping, second_mapping) = labels_set_common(
             "union",
             &first,
@@ -498,6 +747,7 @@ pub unsafe extern fn mts_labels_intersection(
 ) -> mts_status_t {
     let unwind_wrapper = std::panic::AssertUnwindSafe(result);
     catch_unwind(|| {
+        let _profiling = crate::profiling::scope(Operation::LabelsIntersection);
         let (first_mapping, second_mapping) = labels_set_common(
             "intersection",
             &first,
@@ -553,6 +803,7 @@ pub unsafe extern fn mts_labels_select(
     selected_count: *mut usize,
 ) -> mts_status_t {
     catch_unwind(|| {
+        let _profiling = crate::profiling::scope(Operation::LabelsSelect);
         check_pointers_non_null!(selected, selected_count);
 
         if !labels.is_rust() {
@@ -16,6 +16,7 @@ mod data;
 mod blocks;
 mod tensor;
 mod io;
+mod profiling;
 
 mod utils;
 
@@ -53,3 +54,28 @@ static VERSION: Lazy<CString> = Lazy::new(|| {
 pub extern fn mts_version() -> *const c_char {
     return VERSION.as_ptr();
 }
+
+/// Set the number of threads used by metatensor for operations on multiple
+/// blocks, such as `mts_tensormap_keys_to_properties` and
+/// `mts_tensormap_keys_to_samples`.
+///
+/// With more than one thread, the blocks of the output are created in
+/// parallel, and the `mts_array_t` functions of the input arrays (`create`,
+/// `move_samples_from`, ...) can be called concurrently from multiple
+/// threads, each call acting on a different array. The results do not depend
+/// on the number of threads. The default is to use a single thread. Using `0`
+/// sets the number of threads to the number of CPU cores available to the
+/// current process.
+///
+/// @param threads number of threads to use
+#[no_mangle]
+pub extern fn mts_set_num_threads(threads: usize) {
+    crate::tensor::set_num_threads(threads);
+}
+
+/// Get the number of threads used by metatensor for operations on multiple
+/// blocks, as set by `mts_set_num_threads`.
+#[no_mangle]
+pub extern fn mts_get_num_threads() -> usize {
+    return crate::tensor::num_threads();
+}
@@ -0,0 +1,95 @@
+use std::os::raw::c_char;
+
+use crate::Error;
+use crate::profiling::Operation;
+
+use super::status::{mts_status_t, catch_unwind};
+
+/// Counters collected for a single operation in metatensor, see
+/// `mts_profiling_get`.
+#[repr(C)]
+#[derive(Debug, Clone, Copy)]
+#[allow(non_camel_case_types)]
+pub struct mts_profiling_entry_t {
+    /// name of the operation, as a NULL-terminated string. This points to
+    /// static memory, and is valid until the end of the program.
+    pub name: *const c_char,
+    /// number of calls to this operation
+    pub calls: u64,
+    /// cumulative wall-clock time spent in this operation, in nanoseconds
+    pub time_ns: u64,
+    /// cumulative number of bytes moved by this operation. This is the size of
+    /// the labels values for `labels_create`, and the size of the serialized
+    /// data for the `*_load` and `*_save` operations; and zero for all other
+    /// operations.
+    pub bytes: u64,
+}
+
+/// Get the profiling counters for the main operations in metatensor: how
+/// many times they were called, the cumulative time spent in them and the
+/// number of bytes they moved.
+///
+/// The counters are only collected if metatensor was compiled with profiling
+/// enabled (using the `profiling` cargo feature, or the
+/// `METATENSOR_ENABLE_PROFILING` CMake option). Otherwise, there are no
+/// entries and `count` is always set to 0.
+///
+/// If `entries` is `NULL`, this function only sets `count` to the number of
+/// available entries. Otherwise, `count` should contain the number of
+/// entries that fit in `entries`, and this function will set it to the
+/// number of entries written. Operations called from inside other operations
+/// (for example from the `mts_array_t` callbacks) are counted for both.
+///
+/// @param entries array of entries to fill, or `NULL`
+/// @param count pointer to the size of `entries` on input, set to the number
+///              of entries on output
+///
+/// @returns The status code of this operation. If the status is not
+///          `MTS_SUCCESS`, you can use `mts_last_error()` to get the full
+///          error message.
+#[no_mangle]
+pub unsafe extern fn mts_profiling_get(
+    entries: *mut mts_profiling_entry_t,
+    count: *mut usize,
+) -> mts_status_t {
+    catch_unwind(|| {
+        check_pointers_non_null!(count);
+
+        let n_entries = if crate::profiling::ENABLED {
+            Operation::ALL.len()
+        } else {
+            0
+        };
+
+        if entries.is_null() {
+            *count = n_entries;
+            return Ok(());
+        }
+
+        if *count < n_entries {
+            return Err(Error::BufferSize(format!(
+                "got space for {} profiling entries, but we need {}",
+                *count, n_entries
+            )));
+        }
+
+        for (i, &operation) in Operation::ALL.iter().take(n_entries).enumerate() {
+            let counters = crate::profiling::get(operation);
+            entries.add(i).write(mts_profiling_entry_t {
+                name: operation.name().as_ptr(),
+                calls: counters.calls,
+                time_ns: counters.time_ns,
+                bytes: counters.bytes,
+            });
+        }
+        *count = n_entries;
+
+        Ok(())
+    })
+}
+
+/// Reset all the profiling counters to zero.
+#[no_mangle]
+pub extern fn mts_profiling_reset() {
+    crate::profiling::reset();
+}
@@ -68,6 +68,7 @@ pub unsafe extern fn mts_tensormap(
     let unwind_wrapper = std::panic::AssertUnwindSafe(&mut result);
 
     let status = catch_unwind(move || {
+        let _profiling = crate::profiling::scope(Operation::TensorMapCreate);
         let mut blocks_vec = Vec::new();
         if blocks_count != 0 {
             check_pointers_non_null!(blocks);
@@ -338,6 +339,7 @@ pub unsafe extern fn mts_tensormap_keys_to_properties(
     let unwind_wrapper = std::panic::AssertUnwindSafe(&mut result);
 
     let status = catch_unwind(move || {
+        let _profiling = crate::profiling::scope(Operation::KeysToProperties);
         check_pointers_non_null!(tensor);
 
         let keys_to_move = mts_labels_to_rust(&keys_to_move)?;
@@ -381,6 +383,7 @@ pub unsafe extern fn mts_tensormap_components_to_properties(
     let unwind_wrapper = std::panic::AssertUnwindSafe(&mut result);
 
     let status = catch_unwind(move || {
+        let _profiling = crate::profiling::scope(Operation::ComponentsToProperties);
         check_pointers_non_null!(tensor, dimensions);
 
         assert!(dimensions_count != 0);
@@ -446,6 +449,7 @@ pub unsafe extern fn mts_tensormap_keys_to_samples(
     let unwind_wrapper = std::panic::AssertUnwindSafe(&mut result);
 
     let status = catch_unwind(move || {
+        let _profiling = crate::profiling::scope(Operation::KeysToSamples);
         check_pointers_non_null!(tensor);
 
         let keys_to_move = mts_labels_to_rust(&keys_to_move)?;
@@ -464,3 +468,127 @@ pub unsafe extern fn mts_tensormap_keys_to_samples(
 
     return result;
 }
+
+
+/// Split the samples of all the blocks in a tensor map into `output_count`
+/// new tensor maps, in a single pass over the data.
+///
+/// The shard of each sample is determined by the value `v` of the `dimension`
+/// samples dimension: the sample goes to the tensor map `output[shards[v]]`.
+/// All the values of this dimension must be between 0 (included) and
+/// `shards_count` (excluded), and all the entries in `shards` must be smaller
+/// than `output_count`.
+///
+/// All the new tensor maps have the same keys as `tensor`, and blocks with the
+/// same components and properties. Blocks without any sample in a given shard
+/// are kept as empty blocks. The samples are kept in the same order as in the
+/// original blocks, and gradients are split along with their samples.
+/// Gradients of gradients are not supported.
+///
+/// The tensor maps stored in `output` must be freed with `mts_tensormap_free`
+/// when they are no longer needed. They can be merged back together with
+/// `mts_tensormap_merge_samples`.
+///
+/// @param tensor pointer to an existing tensor map
+/// @param dimension name of the samples dimension used to find the shard of
+///                  each sample, as a NULL-terminated UTF-8 string
+/// @param shards shard for each value of `dimension`
+/// @param shards_count number of entries in the `shards` array
+/// @param output array of `output_count` pointers, which will be set to the
+///               newly allocated tensor maps
+/// @param output_count number of shards to create
+///
+/// @returns The status code of this operation. If the status is not
+///          `MTS_SUCCESS`, you can use `mts_last_error()` to get the full
+///          error message.
+#[no_mangle]
+pub unsafe extern fn mts_tensormap_split_samples(
+    tensor: *const mts_tensormap_t,
+    dimension: *const c_char,
+    shards: *const usize,
+    shards_count: usize,
+    output: *mut *mut mts_tensormap_t,
+    output_count: usize,
+) -> mts_status_t {
+    catch_unwind(move || {
+        let _profiling = crate::profiling::scope(Operation::SplitSamples);
+        check_pointers_non_null!(tensor, dimension);
+
+        let dimension = CStr::from_ptr(dimension).to_str().expect("invalid utf8");
+        let shards: &[usize] = if shards_count == 0 {
+            &[]
+        } else {
+            check_pointers_non_null!(shards);
+            std::slice::from_raw_parts(shards, shards_count)
+        };
+
+        if output_count == 0 {
+            return Err(Error::InvalidParameter(
+                "there must be at least one shard in split_samples".into()
+            ));
+        }
+        check_pointers_non_null!(output);
+
+        let split = (*tensor).split_samples(dimension, shards, output_count)?;
+
+        let output = std::slice::from_raw_parts_mut(output, output_count);
+        for (output, tensor) in output.iter_mut().zip(split) {
+            *output = mts_tensormap_t::into_boxed_raw(tensor);
+        }
+
+        Ok(())
+    })
+}
+
+
+/// Merge tensor maps created by `mts_tensormap_split_samples` back into a
+/// single tensor map.
+///
+/// All the `tensors` must have the same keys, and the blocks with the same key
+/// must have the same samples names, components, properties and gradients.
+/// The samples of the merged blocks contain all the samples from the first
+/// tensor map, followed by all the samples from the second tensor map, etc.
+/// The samples must all be different from one another.
+///
+/// The memory allocated by this function should be released using
+/// `mts_tensormap_free`.
+///
+/// @param tensors array of pointers to the tensor maps to merge
+/// @param tensors_count number of entries in the `tensors` array
+///
+/// @returns A pointer to the newly allocated tensor map, or a `NULL` pointer
+///          in case of error. In case of error, you can use `mts_last_error()`
+///          to get the error message.
+#[no_mangle]
+pub unsafe extern fn mts_tensormap_merge_samples(
+    tensors: *const *const mts_tensormap_t,
+    tensors_count: usize,
+) -> *mut mts_tensormap_t {
+    let mut result = std::ptr::null_mut();
+    let unwind_wrapper = std::panic::AssertUnwindSafe(&mut result);
+
+    let status = catch_unwind(move || {
+        let _profiling = crate::profiling::scope(Operation::MergeSamples);
+        check_pointers_non_null!(tensors);
+
+        let mut rust_tensors = Vec::new();
+        for &tensor in std::slice::from_raw_parts(tensors, tensors_count) {
+            check_pointers_non_null!(tensor);
+            rust_tensors.push(&**tensor);
+        }
+
+        let merged = TensorMap::merge_samples(&rust_tensors)?;
+
+        // force the closure to capture the full unwind_wrapper, not just
+        // unwind_wrapper.0
+        let _ = &unwind_wrapper;
+        *unwind_wrapper.0 = mts_tensormap_t::into_boxed_raw(merged);
+        Ok(())
+    });
+
+    if !status.is_success() {
+        return std::ptr::null_mut();
+    }
+
+    return result;
+}
@@ -1,6 +1,6 @@
 use std::ops::Range;
 use std::os::raw::c_void;
-use std::sync::Mutex;
+use std::sync::RwLock;
 
 use once_cell::sync::Lazy;
 
@@ -14,23 +14,39 @@ use crate::Error;
 #[derive(Debug, Clone, Copy, PartialEq, Eq)]
 pub struct mts_data_origin_t(pub u64);
 
-static REGISTERED_DATA_ORIGIN: Lazy<Mutex<Vec<String>>> = Lazy::new(|| {
+// Origins are registered once and then mostly read (when creating error
+// messages), so we use a `RwLock` to allow concurrent readers.
+static REGISTERED_DATA_ORIGIN: Lazy<RwLock<Vec<String>>> = Lazy::new(|| {
     // start the registered origins at 1, this allow using 0 as a marker for
     // "unknown data origin"
-    Mutex::new(vec!["unregistered origin".into()])
+    RwLock::new(vec!["unregistered origin".into()])
 });
 
+fn find_data_origin(registered_origins: &[String], name: &str) -> Option<mts_data_origin_t> {
+    for (i, registered) in registered_origins.iter().enumerate() {
+        if registered == name {
+            return Some(mts_data_origin_t(i as u64));
+        }
+    }
+    return None;
+}
+
 /// Register a new data origin with the given `name`, or get the
 /// `DataOrigin` corresponding to this name if it was already registered.
 pub fn register_data_origin(name: String) -> mts_data_origin_t {
-    let mut registered_origins = REGISTERED_DATA_ORIGIN.lock().expect("mutex got poisoned");
-
-    for (i, registered) in registered_origins.iter().enumerate() {
-        if registered == &name {
-            return mts_data_origin_t(i as u64);
+    {
+        let registered_origins = REGISTERED_DATA_ORIGIN.read().expect("lock got poisoned");
+        if let Some(origin) = find_data_origin(&registered_origins, &name) {
+            return origin;
         }
     }
 
+    let mut registered_origins = REGISTERED_DATA_ORIGIN.write().expect("lock got poisoned");
+    // another thread might have registered the same origin in the meantime
+    if let Some(origin) = find_data_origin(&registered_origins, &name) {
+        return origin;
+    }
+
     // could not find the origin, register a new one
     registered_origins.push(name);
 
@@ -40,7 +56,7 @@ pub fn register_data_origin(name: String) -> mts_data_origin_t {
 /// Get the name of the given (pre-registered) origin
 #[allow(clippy::cast_possible_truncation)]
 pub fn get_data_origin(origin: mts_data_origin_t) -> String {
-    let registered_origins = REGISTERED_DATA_ORIGIN.lock().expect("mutex got poisoned");
+    let registered_origins = REGISTERED_DATA_ORIGIN.read().expect("lock got poisoned");
     let id = origin.0 as usize;
 
     if id < registered_origins.len() {
@@ -50,6 +66,20 @@ pub fn get_data_origin(origin: mts_data_origin_t) -> String {
     }
 }
 
+/// The type of the elements in an array is not known, or not one of the
+/// other `MTS_DTYPE_*` values
+pub const MTS_DTYPE_UNKNOWN: i32 = 0;
+/// The array contains 64-bit floating point numbers
+pub const MTS_DTYPE_FLOAT64: i32 = 1;
+/// The array contains 32-bit floating point numbers
+pub const MTS_DTYPE_FLOAT32: i32 = 2;
+/// The array contains 16-bit (IEEE 754 half precision) floating point numbers
+pub const MTS_DTYPE_FLOAT16: i32 = 3;
+/// The array contains 32-bit signed integers
+pub const MTS_DTYPE_INT32: i32 = 4;
+/// The array contains 64-bit signed integers
+pub const MTS_DTYPE_INT64: i32 = 5;
+
 // SAFETY: this should be checked by the user/implementor of `mts_array_t`.
 unsafe impl Sync for mts_array_t {}
 unsafe impl Send for mts_array_t {}
@@ -163,6 +193,60 @@ pub struct mts_array_t {
         property_start: usize,
         property_end: usize,
     ) -> mts_status_t>,
+
+    /// Get the type of the elements in this array in `dtype`, as one of the
+    /// `MTS_DTYPE_*` constants.
+    ///
+    /// This function can be set to `NULL`, in which case the array is assumed
+    /// to contain 64-bit floating point values.
+    dtype: Option<unsafe extern fn(
+        array: *const c_void,
+        dtype: *mut i32,
+    ) -> mts_status_t>,
+
+    /// Get a pointer to the underlying data storage in `data`, checking that
+    /// the elements in the array have the given `dtype` (one of the
+    /// `MTS_DTYPE_*` constants).
+    ///
+    /// This function should fail if `dtype` is not the type of the elements
+    /// in this array, or if the data is not accessible in RAM or not stored as
+    /// a C-contiguous array. It can be set to `NULL`, in which case only
+    /// `mts_array_t::data` is used to access the data.
+    typed_data: Option<unsafe extern fn(
+        array: *mut c_void,
+        dtype: i32,
+        data: *mut *mut c_void,
+    ) -> mts_status_t>,
+}
+
+/// Data of an `mts_array_t`, using the type of elements of the array
+#[derive(Debug, Clone, Copy)]
+pub enum ArrayData<'a> {
+    /// 64-bit floating point data
+    Float64(&'a [f64]),
+    /// 32-bit floating point data
+    Float32(&'a [f32]),
+    /// 16-bit floating point data, as the raw IEEE 754 bits
+    Float16(&'a [u16]),
+    /// 32-bit integer data
+    Int32(&'a [i32]),
+    /// 64-bit integer data
+    Int64(&'a [i64]),
+}
+
+/// Mutable data of an `mts_array_t`, using the type of elements of the array
+#[derive(Debug)]
+pub enum ArrayDataMut<'a> {
+    /// 64-bit floating point data
+    Float64(&'a mut [f64]),
+    /// 32-bit floating point data
+    Float32(&'a mut [f32]),
+    /// 16-bit floating point data, as the raw IEEE 754 bits
+    Float16(&'a mut [u16]),
+    /// 32-bit integer data
+    Int32(&'a mut [i32]),
+    /// 64-bit integer data
+    Int64(&'a mut [i64]),
 }
 
 /// Representation of a single sample moved from an array to another one
@@ -218,6 +302,8 @@ impl mts_array_t {
             // do not copy destroy, the user should never call it
             destroy: None,
             move_samples_from: self.move_samples_from,
+            dtype: self.dtype,
+            typed_data: self.typed_data,
         }
     }
 
@@ -234,6 +320,8 @@ impl mts_array_t {
             copy: None,
             destroy: None,
             move_samples_from: None,
+            dtype: None,
+            typed_data: None,
         }
     }
 
@@ -331,6 +419,127 @@ impl mts_array_t {
         return Ok(data);
     }
 
+    /// Get the type of the elements in this array, as one of the
+    /// `MTS_DTYPE_*` constants
+    pub fn dtype(&self) -> Result<i32, Error> {
+        let function = match self.dtype {
+            Some(function) => function,
+            None => return Ok(MTS_DTYPE_FLOAT64),
+        };
+
+        let mut dtype = MTS_DTYPE_UNKNOWN;
+        let status = unsafe {
+            function(self.ptr, &mut dtype)
+        };
+
+        if !status.is_success() {
+            return Err(Error::External {
+                status, context: "calling mts_array_t.dtype failed".into()
+            });
+        }
+
+        return Ok(dtype);
+    }
+
+    /// Get the underlying data for this array, with the type of elements used
+    /// by the array itself.
+    pub fn typed_data(&self) -> Result<ArrayData<'_>, Error> {
+        let (dtype, data_ptr, len) = match self.typed_data_ptr()? {
+            Some(typed) => typed,
+            None => return Ok(ArrayData::Float64(self.data()?)),
+        };
+
+        unsafe fn slice<'a, T>(ptr: *mut c_void, len: usize) -> &'a [T] {
+            if len == 0 {
+                return &[];
+            }
+            assert!(!ptr.is_null());
+            return std::slice::from_raw_parts(ptr.cast(), len);
+        }
+
+        let data = unsafe {
+            match dtype {
+                MTS_DTYPE_FLOAT64 => ArrayData::Float64(slice(data_ptr, len)),
+                MTS_DTYPE_FLOAT32 => ArrayData::Float32(slice(data_ptr, len)),
+                MTS_DTYPE_FLOAT16 => ArrayData::Float16(slice(data_ptr, len)),
+                MTS_DTYPE_INT32 => ArrayData::Int32(slice(data_ptr, len)),
+                MTS_DTYPE_INT64 => ArrayData::Int64(slice(data_ptr, len)),
+                _ => unreachable!("dtype was checked in typed_data_ptr"),
+            }
+        };
+
+        return Ok(data);
+    }
+
+    /// Get the underlying data for this array as a mutable slice, with the
+    /// type of elements used by the array itself.
+    pub fn typed_data_mut(&mut self) -> Result<ArrayDataMut<'_>, Error> {
+        let (dtype, data_ptr, len) = match self.typed_data_ptr()? {
+            Some(typed) => typed,
+            None => return Ok(ArrayDataMut::Float64(self.data_mut()?)),
+        };
+
+        unsafe fn slice<'a, T>(ptr: *mut c_void, len: usize) -> &'a mut [T] {
+            if len == 0 {
+                return &mut [];
+            }
+            assert!(!ptr.is_null());
+            return std::slice::from_raw_parts_mut(ptr.cast(), len);
+        }
+
+        let data = unsafe {
+            match dtype {
+                MTS_DTYPE_FLOAT64 => ArrayDataMut::Float64(slice(data_ptr, len)),
+                MTS_DTYPE_FLOAT32 => ArrayDataMut::Float32(slice(data_ptr, len)),
+                MTS_DTYPE_FLOAT16 => ArrayDataMut::Float16(slice(data_ptr, len)),
+                MTS_DTYPE_INT32 => ArrayDataMut::Int32(slice(data_ptr, len)),
+                MTS_DTYPE_INT64 => ArrayDataMut::Int64(slice(data_ptr, len)),
+                _ => unreachable!("dtype was checked in typed_data_ptr"),
+            }
+        };
+
+        return Ok(data);
+    }
+
+    /// Get the dtype, pointer to the data and number of elements of this array
+    /// through `mts_array_t.typed_data`, or `None` if this function is not set
+    fn typed_data_ptr(&self) -> Result<Option<(i32, *mut c_void, usize)>, Error> {
+        let function = match self.typed_data {
+            Some(function) => function,
+            None => return Ok(None),
+        };
+
+        let dtype = self.dtype()?;
+        match dtype {
+            MTS_DTYPE_FLOAT64 | MTS_DTYPE_FLOAT32 | MTS_DTYPE_FLOAT16 |
+            MTS_DTYPE_INT32 | MTS_DTYPE_INT64 => {},
+            MTS_DTYPE_UNKNOWN => {
+                return Err(Error::InvalidParameter(
+                    "can not access the data of an array with unknown dtype".into()
+                ));
+            }
+            _ => {
+                return Err(Error::InvalidParameter(format!(
+                    "got an invalid dtype ({}) from mts_array_t.dtype", dtype
+                )));
+            }
+        }
+
+        let len = self.shape()?.iter().product::<usize>();
+        let mut data_ptr = std::ptr::null_mut();
+        let status = unsafe {
+            function(self.ptr, dtype, &mut data_ptr)
+        };
+
+        if !status.is_success() {
+            return Err(Error::External {
+                status, context: "calling mts_array_t.typed_data failed".into()
+            });
+        }
+
+        return Ok(Some((dtype, data_ptr, len)));
+    }
+
     /// Get the shape of this array
     #[allow(clippy::cast_possible_truncation)]
     pub fn shape(&self) -> Result<&[usize], Error> {
@@ -515,6 +724,8 @@ mod tests {
                 copy: None,
                 destroy: Some(TestArray::destroy),
                 move_samples_from: None,
+                dtype: None,
+                typed_data: None,
             }
         }
 
@@ -569,6 +780,17 @@ mod tests {
 
         let origin = register_data_origin("test origin".into());
         assert_eq!(get_data_origin(origin), "test origin");
+
+        // registering the same origin from multiple threads gives the same id
+        let threads = (0..8).map(|_| {
+            std::thread::spawn(|| register_data_origin("threaded origin".into()))
+        }).collect::<Vec<_>>();
+
+        let origins = threads.into_iter().map(|t| t.join().unwrap()).collect::<Vec<_>>();
+        for other in &origins {
+            assert_eq!(*other, origins[0]);
+        }
+        assert_eq!(get_data_origin(origins[0]), "threaded origin");
     }
 
     #[test]
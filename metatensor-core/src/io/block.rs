@@ -1,15 +1,19 @@
 use std::io::BufReader;
+use std::cell::Cell;
 use std::collections::HashSet;
 use std::sync::Arc;
 
 use byteorder::{LittleEndian, ReadBytesExt, BigEndian, WriteBytesExt, NativeEndian};
 use zip::{ZipArchive, ZipWriter};
+use zip::read::ZipFile;
 
 use super::npy_header::{Header, DataType};
-use super::{check_for_extra_bytes, PathOrBuffer};
+use super::{check_for_extra_bytes, PathOrBuffer, PositionTracker};
+use super::{MmapFile, MappedData, SaveOptions, StorageType};
 use super::labels::{load_labels, save_labels};
 
 use crate::{TensorBlock, Labels, Error, mts_array_t};
+use crate::data::{ArrayData, ArrayDataMut};
 
 
 /// Check if the file/buffer in `data` looks like it could contain serialized
@@ -50,16 +54,37 @@ pub fn load_block<R, F>(reader: R, create_array: F) -> Result<TensorBlock, Error
 {
     let mut archive = ZipArchive::new(reader).map_err(|e| ("<root>".into(), e))?;
 
-    return read_single_block(&mut archive, "", None, &create_array);
+    return read_single_block(&mut archive, "", None, &|file| read_data(file, &create_array));
+}
+
+/// Load a serialized tensor block from a memory-mapped file.
+///
+/// Whenever possible, the arrays for values and gradients data will directly
+/// use the memory in `mmap`. The `create_array` callback is called with the
+/// shape of the array and `Some(MappedData)` in this case. If the data can not
+/// be used in-place (because it is not aligned, stored with a different
+/// endianness or compressed), `create_array` will be called with `None`
+/// instead, and the corresponding array will be filled by this function.
+pub fn load_block_mmap<F>(mmap: &Arc<MmapFile>, create_array: F) -> Result<TensorBlock, Error>
+    where F: Fn(Vec<usize>, Option<MappedData>) -> Result<mts_array_t, Error>
+{
+    let reader = std::io::Cursor::new(mmap.as_slice());
+    let mut archive = ZipArchive::new(reader).map_err(|e| ("<root>".into(), e))?;
+
+    return read_single_block(&mut archive, "", None, &|file| read_data_mmap(file, mmap, &create_array));
 }
 
 /// Save the given block to a file (or any other writer).
 ///
 /// The format used is documented in the [`load`] function, and is based on
 /// numpy's NPZ format (i.e. zip archive containing NPY files).
-pub fn save_block<W: std::io::Write + std::io::Seek>(writer: W, block: &TensorBlock) -> Result<(), Error> {
+///
+/// The `options` control the compression of the archive and the floating point
+/// type used to store the data, see [`SaveOptions`].
+pub fn save_block<W: std::io::Write + std::io::Seek>(writer: W, block: &TensorBlock, options: SaveOptions) -> Result<(), Error> {
+    let (writer, position) = PositionTracker::new(writer)?;
     let mut archive = ZipWriter::new(writer);
-    write_single_block(&mut archive, "", true, block)?;
+    write_single_block(&mut archive, "", true, block, &position, options)?;
     archive.finish().map_err(|e| ("<root>".into(), e))?;
 
     return Ok(());
@@ -73,14 +98,14 @@ pub(super) fn read_single_block<R, F>(
     archive: &mut ZipArchive<R>,
     prefix: &str,
     properties: Option<Arc<Labels>>,
-    create_array: &F,
+    read_values: &F,
 ) -> Result<TensorBlock, Error>
     where R: std::io::Read + std::io::Seek,
-          F: Fn(Vec<usize>) -> Result<mts_array_t, Error>
+          F: Fn(ZipFile<'_>) -> Result<(mts_array_t, Vec<usize>), Error>
 {
     let path = format!("{}values.npy", prefix);
     let data_file = archive.by_name(&path).map_err(|e| (path, e))?;
-    let (data, shape) = read_data(data_file, &create_array)?;
+    let (data, shape) = read_values(data_file)?;
 
     let path = format!("{}samples.npy", prefix);
     let samples_file = archive.by_name(&path).map_err(|e| (path, e))?;
@@ -118,7 +143,7 @@ pub(super) fn read_single_block<R, F>(
             archive,
             &format!("{}gradients/{}/", prefix, parameter),
             Some(properties.clone()),
-            create_array
+            read_values
         )?;
 
         block.add_gradient(parameter, gradient)?;
@@ -127,8 +152,13 @@ pub(super) fn read_single_block<R, F>(
     return Ok(block);
 }
 
-// Read a data array from the given reader, using numpy's NPY format
-fn read_data<R, F>(mut reader: R, create_array: &F) -> Result<(mts_array_t, Vec<usize>), Error>
+// Read a data array from the given reader, using numpy's NPY format.
+//
+// The data is decoded directly in the type of the array returned by
+// `create_array` (see `mts_array_t::typed_data_mut`), without going through an
+// intermediary 64-bit floating point array.
+#[allow(clippy::cast_possible_truncation)]
+pub(super) fn read_data<R, F>(mut reader: R, create_array: &F) -> Result<(mts_array_t, Vec<usize>), Error>
     where R: std::io::Read, F: Fn(Vec<usize>) -> Result<mts_array_t, Error>
 {
     let header = Header::from_reader(&mut reader)?;
@@ -136,22 +166,33 @@ fn read_data<R, F>(mut reader: R, create_array: &F) -> Result<(mts_array_t, Vec<
         return Err(Error::Serialization("data can not be loaded from fortran-order arrays".into()));
     }
 
-    let shape = header.shape;
-    let mut array = create_array(shape.clone())?;
-
-    match header.type_descriptor {
-        DataType::Scalar(s) if s == "<f8" => {
-            reader.read_f64_into::<LittleEndian>(array.data_mut()?)?;
-        }
-        DataType::Scalar(s) if s == ">f8" => {
-            reader.read_f64_into::<BigEndian>(array.data_mut()?)?;
-        }
+    let descriptor = match header.type_descriptor {
+        DataType::Scalar(ref s) if ["<f8", ">f8", "<f4", ">f4", "<f2", ">f2"].contains(&&**s) => s.clone(),
         _ => {
             return Err(Error::Serialization(format!(
-                "unknown type for data array, expected 64-bit floating points, got {}",
+                "unknown type for data array, expected 16, 32 or 64-bit floating points, got {}",
                 header.type_descriptor
             )));
         }
+    };
+
+    let shape = header.shape;
+    let mut array = create_array(shape.clone())?;
+
+    match (array.typed_data_mut()?, &*descriptor) {
+        // fast path when the data is stored with the same type as the array
+        (ArrayDataMut::Float64(data), "<f8") => reader.read_f64_into::<LittleEndian>(data)?,
+        (ArrayDataMut::Float64(data), ">f8") => reader.read_f64_into::<BigEndian>(data)?,
+        (ArrayDataMut::Float32(data), "<f4") => reader.read_f32_into::<LittleEndian>(data)?,
+        (ArrayDataMut::Float32(data), ">f4") => reader.read_f32_into::<BigEndian>(data)?,
+        (ArrayDataMut::Float16(data), "<f2") => reader.read_u16_into::<LittleEndian>(data)?,
+        (ArrayDataMut::Float16(data), ">f2") => reader.read_u16_into::<BigEndian>(data)?,
+        // otherwise, convert the values through f64
+        (ArrayDataMut::Float64(data), _) => read_converted_values(&mut reader, &descriptor, data, |v| v)?,
+        (ArrayDataMut::Float32(data), _) => read_converted_values(&mut reader, &descriptor, data, |v| v as f32)?,
+        (ArrayDataMut::Float16(data), _) => read_converted_values(&mut reader, &descriptor, data, f64_to_f16_bits)?,
+        (ArrayDataMut::Int32(data), _) => read_converted_values(&mut reader, &descriptor, data, |v| v as i32)?,
+        (ArrayDataMut::Int64(data), _) => read_converted_values(&mut reader, &descriptor, data, |v| v as i64)?,
     }
 
     check_for_extra_bytes(&mut reader)?;
@@ -159,20 +200,130 @@ fn read_data<R, F>(mut reader: R, create_array: &F) -> Result<(mts_array_t, Vec<
     return Ok((array, shape));
 }
 
+/// Number of values to decode at once in `read_converted_values`
+const CONVERSION_CHUNK_SIZE: usize = 1024;
+
+/// Read `data.len()` values stored in NPY format with the given `descriptor`
+/// from `reader`, converting them to the type of `data` with `from_f64`.
+///
+/// The values are converted by chunks, to avoid allocating a full array of
+/// 64-bit floating point values.
+fn read_converted_values<R, T, F>(reader: &mut R, descriptor: &str, data: &mut [T], from_f64: F) -> Result<(), Error>
+    where R: std::io::Read,
+          F: Fn(f64) -> T,
+{
+    let mut buffer_f64 = [0.0_f64; CONVERSION_CHUNK_SIZE];
+    let mut buffer_f32 = [0.0_f32; CONVERSION_CHUNK_SIZE];
+    let mut buffer_u16 = [0_u16; CONVERSION_CHUNK_SIZE];
+
+    for chunk in data.chunks_mut(CONVERSION_CHUNK_SIZE) {
+        let buffer = &mut buffer_f64[..chunk.len()];
+        match descriptor {
+            "<f8" => reader.read_f64_into::<LittleEndian>(buffer)?,
+            ">f8" => reader.read_f64_into::<BigEndian>(buffer)?,
+            "<f4" | ">f4" => {
+                let stored = &mut buffer_f32[..chunk.len()];
+                if descriptor == "<f4" {
+                    reader.read_f32_into::<LittleEndian>(stored)?;
+                } else {
+                    reader.read_f32_into::<BigEndian>(stored)?;
+                }
+
+                for (value, &stored) in buffer.iter_mut().zip(stored.iter()) {
+                    *value = f64::from(stored);
+                }
+            }
+            "<f2" | ">f2" => {
+                let stored = &mut buffer_u16[..chunk.len()];
+                if descriptor == "<f2" {
+                    reader.read_u16_into::<LittleEndian>(stored)?;
+                } else {
+                    reader.read_u16_into::<BigEndian>(stored)?;
+                }
+
+                for (value, &stored) in buffer.iter_mut().zip(stored.iter()) {
+                    *value = f16_bits_to_f64(stored);
+                }
+            }
+            _ => unreachable!("the descriptor was checked in read_data"),
+        }
+
+        for (value, &stored) in chunk.iter_mut().zip(buffer.iter()) {
+            *value = from_f64(stored);
+        }
+    }
+
+    return Ok(());
+}
+
+// Read a data array from a file stored inside a memory-mapped ZIP archive,
+// re-using the memory of the mapping if possible.
+#[allow(clippy::cast_ptr_alignment, clippy::cast_possible_truncation)]
+pub(super) fn read_data_mmap<F>(file: ZipFile<'_>, mmap: &Arc<MmapFile>, create_array: &F) -> Result<(mts_array_t, Vec<usize>), Error>
+    where F: Fn(Vec<usize>, Option<MappedData>) -> Result<mts_array_t, Error>
+{
+    if file.compression() == zip::CompressionMethod::Stored {
+        let start = file.data_start() as usize;
+        let size = file.size() as usize;
+        let bytes = mmap.as_slice().get(start..(start + size)).ok_or_else(|| Error::Serialization(
+            format!("'{}' extends past the end of the file", file.name())
+        ))?;
+
+        let mut cursor = std::io::Cursor::new(bytes);
+        let header = Header::from_reader(&mut cursor)?;
+        let header_size = cursor.position() as usize;
+
+        let native_type = if cfg!(target_endian = "little") {
+            "<f8"
+        } else {
+            ">f8"
+        };
+
+        let data_start = start + header_size;
+        if !header.fortran_order
+            && header.type_descriptor == DataType::Scalar(native_type.into())
+            && data_start % std::mem::align_of::<f64>() == 0
+        {
+            let expected_size = header.shape.iter().product::<usize>() * std::mem::size_of::<f64>();
+            let actual_size = size - header_size;
+            if actual_size < expected_size {
+                return Err(Error::Serialization(format!(
+                    "expected {} bytes of data in '{}', got {}", expected_size, file.name(), actual_size
+                )));
+            } else if actual_size > expected_size {
+                return Err(Error::Serialization(format!(
+                    "found {} extra bytes after the expected end of data", actual_size - expected_size
+                )));
+            }
+
+            let mapped = MappedData {
+                data: mmap.ptr_at(data_start).cast::<f64>(),
+                mmap: Arc::clone(mmap),
+            };
+
+            let array = create_array(header.shape.clone(), Some(mapped))?;
+            return Ok((array, header.shape));
+        }
+    }
+
+    // the data can not be used in-place, read it into a new array instead
+    return read_data(file, &|shape| create_array(shape, None));
+}
+
 pub(super) fn write_single_block<W: std::io::Write + std::io::Seek>(
     archive: &mut ZipWriter<W>,
     prefix: &str,
     values: bool,
     block: &TensorBlock,
+    position: &Cell<u64>,
+    save_options: SaveOptions,
 ) -> Result<(), Error> {
-    let options = zip::write::FileOptions::default()
-        .compression_method(zip::CompressionMethod::Stored)
-        .large_file(true)
-        .last_modified_time(zip::DateTime::from_date_and_time(2000, 1, 1, 0, 0, 0).expect("invalid datetime"));
+    let options = save_options.zip_options();
 
     let path = format!("{}values.npy", prefix);
     archive.start_file(&path, options).map_err(|e| (path, e))?;
-    write_data(archive, &block.values)?;
+    // `position` now contains the offset of this file's data in the archive
+    write_data(archive, &block.values, position.get(), save_options.storage_type)?;
 
     let path = format!("{}samples.npy", prefix);
     archive.start_file(&path, options).map_err(|e| (path, e))?;
@@ -192,31 +343,182 @@ pub(super) fn write_single_block<W: std::io::Write + std::io::Seek>(
 
     for (parameter, gradient) in block.gradients() {
         let prefix = format!("{}gradients/{}/", prefix, parameter);
-        write_single_block(archive, &prefix, false, gradient)?;
+        write_single_block(archive, &prefix, false, gradient, position, save_options)?;
     }
 
     Ok(())
 }
 
-// Write an array to the given writer, using numpy's NPY format
-fn write_data<W: std::io::Write>(writer: &mut W, array: &mts_array_t) -> Result<(), Error> {
+// Write an array to the given writer, using numpy's NPY format. `offset` is
+// the position of the NPY data in the final file, which is used to align the
+// array data to 64 bytes. The data is converted to `storage_type` on the fly.
+#[allow(clippy::cast_possible_truncation)]
+fn write_data<W: std::io::Write>(writer: &mut W, array: &mts_array_t, offset: u64, storage_type: StorageType) -> Result<(), Error> {
+    let type_descriptor = match storage_type {
+        StorageType::Float64 => "f8",
+        StorageType::Float32 => "f4",
+        StorageType::Float16 => "f2",
+    };
+
     let type_descriptor = if cfg!(target_endian = "little") {
-        "<f8"
+        format!("<{}", type_descriptor)
     } else {
-        ">f8"
+        format!(">{}", type_descriptor)
     };
 
     let header = Header {
-        type_descriptor: DataType::Scalar(type_descriptor.into()),
+        type_descriptor: DataType::Scalar(type_descriptor),
         fortran_order: false,
         shape: array.shape()?.to_vec(),
     };
 
-    header.write(&mut *writer)?;
+    header.write_at(&mut *writer, offset)?;
+
+    // use the data with the type of the array, to avoid requiring a
+    // conversion to 64-bit floating point before saving
+    match array.typed_data()? {
+        ArrayData::Float64(data) => write_values(writer, data, storage_type, |v| v),
+        ArrayData::Float32(data) => write_values(writer, data, storage_type, f64::from),
+        ArrayData::Float16(data) => write_values(writer, data, storage_type, f16_bits_to_f64),
+        ArrayData::Int32(data) => write_values(writer, data, storage_type, f64::from),
+        #[allow(clippy::cast_precision_loss)]
+        ArrayData::Int64(data) => write_values(writer, data, storage_type, |v| v as f64),
+    }
+}
 
-    for &value in array.data()? {
-        writer.write_f64::<NativeEndian>(value)?;
+/// Write all the `values` to the `writer`, converting them to `storage_type`
+/// through `to_f64`.
+#[allow(clippy::cast_possible_truncation)]
+fn write_values<W, T, F>(writer: &mut W, values: &[T], storage_type: StorageType, to_f64: F) -> Result<(), Error>
+    where W: std::io::Write,
+          T: Copy,
+          F: Fn(T) -> f64,
+{
+    match storage_type {
+        StorageType::Float64 => {
+            for &value in values {
+                writer.write_f64::<NativeEndian>(to_f64(value))?;
+            }
+        }
+        StorageType::Float32 => {
+            for &value in values {
+                writer.write_f32::<NativeEndian>(to_f64(value) as f32)?;
+            }
+        }
+        StorageType::Float16 => {
+            for &value in values {
+                writer.write_u16::<NativeEndian>(f64_to_f16_bits(to_f64(value)))?;
+            }
+        }
     }
 
     return Ok(());
 }
+
+/// Convert a 64-bit floating point number to the bits of the closest IEEE 754
+/// half precision number, rounding ties to even.
+#[allow(clippy::cast_possible_truncation, clippy::cast_sign_loss)]
+fn f64_to_f16_bits(value: f64) -> u16 {
+    let bits = value.to_bits();
+    let sign = ((bits >> 48) & 0x8000) as u16;
+    let exponent = ((bits >> 52) & 0x7ff) as i32;
+    let mantissa = bits & 0x000f_ffff_ffff_ffff;
+
+    if exponent == 0x7ff {
+        if mantissa == 0 {
+            // infinity
+            return sign | 0x7c00;
+        } else {
+            // NaN
+            return sign | 0x7e00;
+        }
+    }
+
+    let exponent = exponent - 1023;
+    if exponent > 15 {
+        // overflow, round to infinity
+        return sign | 0x7c00;
+    }
+
+    let (mantissa, shift, half) = if exponent >= -14 {
+        // normal number, keep the top 10 bits of the mantissa
+        let half_exponent = ((exponent + 15) as u64) << 10;
+        (mantissa, 42, half_exponent)
+    } else if exponent >= -25 {
+        // subnormal number, add the implicit leading bit to the mantissa
+        let shift = (28 - exponent) as u32;
+        (mantissa | (1 << 52), shift, 0)
+    } else {
+        // underflow, round to zero
+        return sign;
+    };
+
+    let truncated = mantissa >> shift;
+    let remainder = mantissa & ((1 << shift) - 1);
+    let halfway = 1 << (shift - 1);
+
+    // a carry from the mantissa into the exponent gives the right result,
+    // including when rounding up to infinity
+    let mut result = half + truncated;
+    if remainder > halfway || (remainder == halfway && truncated & 1 == 1) {
+        result += 1;
+    }
+
+    return sign | (result as u16);
+}
+
+/// Convert the bits of an IEEE 754 half precision number to a 64-bit floating
+/// point number. This conversion is exact.
+fn f16_bits_to_f64(bits: u16) -> f64 {
+    let sign = if bits & 0x8000 == 0 { 1.0 } else { -1.0 };
+    let exponent = i32::from((bits >> 10) & 0x1f);
+    let mantissa = f64::from(bits & 0x3ff);
+
+    if exponent == 0 {
+        return sign * mantissa * f64::powi(2.0, -24);
+    } else if exponent == 0x1f {
+        if mantissa == 0.0 {
+            return sign * f64::INFINITY;
+        } else {
+            return f64::NAN;
+        }
+    } else {
+        return sign * (1.0 + mantissa / 1024.0) * f64::powi(2.0, exponent - 15);
+    }
+}
+
+
+#[cfg(test)]
+mod tests {
+    use super::{f64_to_f16_bits, f16_bits_to_f64};
+
+    #[test]
+    fn f16_conversion() {
+        assert_eq!(f64_to_f16_bits(0.0), 0x0000);
+        assert_eq!(f64_to_f16_bits(-0.0), 0x8000);
+        assert_eq!(f64_to_f16_bits(1.0), 0x3c00);
+        assert_eq!(f64_to_f16_bits(-2.0), 0xc000);
+        assert_eq!(f64_to_f16_bits(65504.0), 0x7bff);
+        assert_eq!(f64_to_f16_bits(1e6), 0x7c00);
+        assert_eq!(f64_to_f16_bits(f64::NEG_INFINITY), 0xfc00);
+        assert_eq!(f64_to_f16_bits(f64::NAN) & 0x7e00, 0x7e00);
+
+        // smallest subnormal and rounding to zero
+        assert_eq!(f64_to_f16_bits(f64::powi(2.0, -24)), 0x0001);
+        assert_eq!(f64_to_f16_bits(f64::powi(2.0, -25)), 0x0000);
+        assert_eq!(f64_to_f16_bits(1e-10), 0x0000);
+
+        // round to nearest, ties to even
+        assert_eq!(f64_to_f16_bits(1.0 + f64::powi(2.0, -11)), 0x3c00);
+        assert_eq!(f64_to_f16_bits(1.0 + 3.0 * f64::powi(2.0, -11)), 0x3c02);
+        assert_eq!(f64_to_f16_bits(0.1), 0x2e66);
+
+        for bits in 0..0x7c00 {
+            assert_eq!(f64_to_f16_bits(f16_bits_to_f64(bits)), bits);
+            assert_eq!(f64_to_f16_bits(f16_bits_to_f64(bits | 0x8000)), bits | 0x8000);
+        }
+
+        assert_eq!(f16_bits_to_f64(0x7c00), f64::INFINITY);
+        assert!(f16_bits_to_f64(0x7e00).is_nan());
+    }
+}
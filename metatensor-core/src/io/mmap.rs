@@ -0,0 +1,113 @@
+use std::sync::Arc;
+
+use crate::Error;
+
+/// A full file mapped in memory.
+///
+/// The mapping is private (copy-on-write): the pages are shared with the OS
+/// page cache and all other processes mapping the same file until they are
+/// written to, and modifications are never written back to the file.
+pub struct MmapFile {
+    ptr: *mut u8,
+    len: usize,
+}
+
+// SAFETY: the mapping is never re-mapped or resized after creation, and
+// synchronization of accesses to the data is left to the users of the mapped
+// arrays, as for any other `mts_array_t`.
+unsafe impl Send for MmapFile {}
+unsafe impl Sync for MmapFile {}
+
+#[cfg(unix)]
+mod sys {
+    use std::os::raw::{c_int, c_void};
+
+    pub const PROT_READ: c_int = 1;
+    pub const PROT_WRITE: c_int = 2;
+    // this is the same value on Linux, macOS and the BSDs
+    pub const MAP_PRIVATE: c_int = 2;
+
+    pub const MAP_FAILED: *mut c_void = !0 as *mut c_void;
+
+    extern "C" {
+        // `off_t` has the same size as `isize` on all the platforms we support
+        pub fn mmap(addr: *mut c_void, len: usize, prot: c_int, flags: c_int, fd: c_int, offset: isize) -> *mut c_void;
+        pub fn munmap(addr: *mut c_void, len: usize) -> c_int;
+    }
+}
+
+impl MmapFile {
+    /// Map the file at the given `path` in memory
+    #[cfg(unix)]
+    pub fn open(path: &str) -> Result<MmapFile, Error> {
+        use std::os::unix::io::AsRawFd;
+
+        let file = std::fs::File::open(path)?;
+        let len = usize::try_from(file.metadata()?.len()).map_err(|_| Error::Serialization(
+            format!("'{}' is too large to be mapped in memory", path)
+        ))?;
+
+        if len == 0 {
+            return Err(Error::Serialization(format!("'{}' is an empty file", path)));
+        }
+
+        let ptr = unsafe {
+            sys::mmap(
+                std::ptr::null_mut(),
+                len,
+                sys::PROT_READ | sys::PROT_WRITE,
+                sys::MAP_PRIVATE,
+                file.as_raw_fd(),
+                0,
+            )
+        };
+
+        if ptr == sys::MAP_FAILED {
+            return Err(Error::Io(std::io::Error::last_os_error()));
+        }
+
+        // the mapping stays valid after the file is closed
+        return Ok(MmapFile { ptr: ptr.cast(), len });
+    }
+
+    /// Map the file at the given `path` in memory
+    #[cfg(not(unix))]
+    pub fn open(path: &str) -> Result<MmapFile, Error> {
+        return Err(Error::Serialization(format!(
+            "can not memory-map '{}': memory-mapped loading is only supported on unix platforms", path
+        )));
+    }
+
+    /// Get the full content of the mapped file
+    pub fn as_slice(&self) -> &[u8] {
+        unsafe {
+            std::slice::from_raw_parts(self.ptr, self.len)
+        }
+    }
+
+    /// Get a pointer to the data at the given `offset` (in bytes) in the file
+    pub fn ptr_at(&self, offset: usize) -> *mut u8 {
+        assert!(offset <= self.len);
+        unsafe {
+            self.ptr.add(offset)
+        }
+    }
+}
+
+impl Drop for MmapFile {
+    fn drop(&mut self) {
+        #[cfg(unix)]
+        unsafe {
+            sys::munmap(self.ptr.cast(), self.len);
+        }
+    }
+}
+
+/// Data for a single array living inside a memory-mapped file
+pub struct MappedData {
+    /// Pointer to the first element of the array, properly aligned for `f64`
+    pub data: *mut f64,
+    /// The file containing this data, which must be kept alive as long as
+    /// `data` is used
+    pub mmap: Arc<MmapFile>,
+}
@@ -1,5 +1,14 @@
+use std::cell::Cell;
+use std::rc::Rc;
+
 mod npy_header;
 
+mod options;
+pub use self::options::{SaveOptions, Compression, StorageType, LoadOptions};
+
+mod mmap;
+pub use self::mmap::{MmapFile, MappedData};
+
 mod labels;
 pub use self::labels::load_labels;
 pub use self::labels::save_labels;
@@ -7,14 +16,23 @@ pub use self::labels::looks_like_labels_data;
 
 mod block;
 pub use self::block::load_block;
+pub use self::block::load_block_mmap;
 pub use self::block::save_block;
 pub use self::block::looks_like_block_data;
 
 mod tensor;
 pub use self::tensor::load;
+pub use self::tensor::load_with_options;
+pub use self::tensor::load_mmap;
 pub use self::tensor::save;
 pub use self::tensor::looks_like_tensormap_data;
 
+mod reader;
+pub use self::reader::TensorMapReader;
+
+mod writer;
+pub use self::writer::TensorMapWriter;
+
 
 use crate::Error;
 
@@ -35,3 +53,44 @@ fn check_for_extra_bytes<R: std::io::Read>(reader: &mut R) -> Result<(), Error>
         Err(Error::Serialization(format!("found {} extra bytes after the expected end of data", extra)))
     }
 }
+
+/// Wrapper around a writer keeping track of the current position in the
+/// stream. This is used to align the arrays data inside the ZIP archives, so
+/// that it can be used directly from a memory-mapped file.
+struct PositionTracker<W> {
+    writer: W,
+    position: Rc<Cell<u64>>,
+}
+
+impl<W: std::io::Seek> PositionTracker<W> {
+    /// Wrap the given `writer`, returning the wrapper and a handle to the
+    /// current position in the stream.
+    fn new(mut writer: W) -> Result<(PositionTracker<W>, Rc<Cell<u64>>), Error> {
+        let position = Rc::new(Cell::new(writer.stream_position()?));
+        let tracker = PositionTracker {
+            writer,
+            position: Rc::clone(&position),
+        };
+        return Ok((tracker, position));
+    }
+}
+
+impl<W: std::io::Write> std::io::Write for PositionTracker<W> {
+    fn write(&mut self, buf: &[u8]) -> std::io::Result<usize> {
+        let count = self.writer.write(buf)?;
+        self.position.set(self.position.get() + count as u64);
+        return Ok(count);
+    }
+
+    fn flush(&mut self) -> std::io::Result<()> {
+        self.writer.flush()
+    }
+}
+
+impl<W: std::io::Seek> std::io::Seek for PositionTracker<W> {
+    fn seek(&mut self, pos: std::io::SeekFrom) -> std::io::Result<u64> {
+        let position = self.writer.seek(pos)?;
+        self.position.set(position);
+        return Ok(position);
+    }
+}
@@ -193,11 +193,14 @@ impl Version {
     /// padding length for this .npy version.
     ///
     /// `unpadded_arr_format` is the Python literal describing the array
-    /// format, formatted as an ASCII string without any padding.
+    /// format, formatted as an ASCII string without any padding. `offset` is
+    /// the position at which the header will be written in the final file: the
+    /// padding is chosen such that the array data starts at a multiple of
+    /// `HEADER_DIVISOR` relative to the start of the file.
     ///
     /// Returns `None` if the total header length overflows `usize` or if the
     /// value of `HEADER_LEN` is too large for this .npy version.
-    fn compute_lengths(self, unpadded_arr_format: &[u8]) -> Option<HeaderLengthInfo> {
+    fn compute_lengths(self, unpadded_arr_format: &[u8], offset: u64) -> Option<HeaderLengthInfo> {
         /// Length of a '\n' char in bytes.
         const NEWLINE_LEN: usize = 1;
 
@@ -206,7 +209,9 @@ impl Version {
         let unpadded_total_len: usize = prefix_len
             .checked_add(unpadded_arr_format.len())?
             .checked_add(NEWLINE_LEN)?;
-        let padding_len: usize = HEADER_DIVISOR - unpadded_total_len % HEADER_DIVISOR;
+        #[allow(clippy::cast_possible_truncation)]
+        let offset = (offset % HEADER_DIVISOR as u64) as usize;
+        let padding_len: usize = HEADER_DIVISOR - (offset + unpadded_total_len) % HEADER_DIVISOR;
         let total_len: usize = unpadded_total_len.checked_add(padding_len)?;
         let header_len: usize = total_len - prefix_len;
         let formatted_header_len = self.format_header_len(header_len)?;
@@ -583,7 +588,10 @@ impl Header {
         return result;
     }
 
-    pub fn to_bytes(&self) -> Result<Vec<u8>, WriteHeaderError> {
+    /// Get the bytes for this header, padded such that the array data which
+    /// follows will be aligned to `HEADER_DIVISOR` bytes if the header is
+    /// written at the given `offset` in a file.
+    pub fn to_bytes(&self, offset: u64) -> Result<Vec<u8>, WriteHeaderError> {
         // Metadata describing array's format as ASCII string.
         let mut arr_format = Vec::new();
 
@@ -593,7 +601,7 @@ impl Header {
         // length information.
         let (version, length_info) = [Version::V1_0, Version::V2_0]
             .iter()
-            .find_map(|&version| Some((version, version.compute_lengths(&arr_format)?)))
+            .find_map(|&version| Some((version, version.compute_lengths(&arr_format, offset)?)))
             .ok_or_else(|| WriteHeaderError::Format("header too long".into()))?;
 
         // Write the header.
@@ -608,13 +616,19 @@ impl Header {
 
         // Verify the length of the header.
         debug_assert_eq!(out.len(), length_info.total_len);
-        debug_assert_eq!(out.len() % HEADER_DIVISOR, 0);
+        debug_assert_eq!((offset + out.len() as u64) % HEADER_DIVISOR as u64, 0);
 
         Ok(out)
     }
 
-    pub fn write<W: std::io::Write>(&self, mut writer: W) -> Result<(), WriteHeaderError> {
-        let bytes = self.to_bytes()?;
+    pub fn write<W: std::io::Write>(&self, writer: W) -> Result<(), WriteHeaderError> {
+        return self.write_at(writer, 0);
+    }
+
+    /// Write this header, knowing that it will end up at the given `offset` in
+    /// the final file. See [`Header::to_bytes`].
+    pub fn write_at<W: std::io::Write>(&self, mut writer: W, offset: u64) -> Result<(), WriteHeaderError> {
+        let bytes = self.to_bytes(offset)?;
         writer.write_all(&bytes)?;
         Ok(())
     }
@@ -0,0 +1,69 @@
+/// Compression method used for the files inside the ZIP archive
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Default)]
+pub enum Compression {
+    /// Store the data without compression, allowing to use the data in-place
+    /// when memory-mapping the file
+    #[default]
+    None,
+    /// Compress the data using the DEFLATE algorithm
+    Deflate,
+}
+
+/// Floating point type used to store the values and gradients arrays
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Default)]
+pub enum StorageType {
+    /// Store data as 64-bit floating point numbers, without loss of precision
+    #[default]
+    Float64,
+    /// Store data as 32-bit floating point numbers
+    Float32,
+    /// Store data as 16-bit (IEEE 754 half precision) floating point numbers
+    Float16,
+}
+
+/// Options controlling how data is saved by [`super::save`],
+/// [`super::save_block`] and [`super::TensorMapWriter`].
+///
+/// The default options produce files without compression, using 64-bit
+/// floating point numbers for all data. Data saved with any options can be
+/// loaded back with the same loading functions, and is always loaded as 64-bit
+/// floating point numbers.
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Default)]
+pub struct SaveOptions {
+    /// Compression method for all files in the archive
+    pub compression: Compression,
+    /// Floating point type used to store values and gradients. Using a smaller
+    /// type than `Float64` reduces the size of the file, but loses precision.
+    pub storage_type: StorageType,
+}
+
+impl SaveOptions {
+    /// Get the options to use when adding files to the ZIP archive
+    pub(super) fn zip_options(&self) -> zip::write::FileOptions {
+        let compression = match self.compression {
+            Compression::None => zip::CompressionMethod::Stored,
+            Compression::Deflate => zip::CompressionMethod::Deflated,
+        };
+
+        zip::write::FileOptions::default()
+            .compression_method(compression)
+            .large_file(true)
+            .last_modified_time(zip::DateTime::from_date_and_time(2000, 1, 1, 0, 0, 0).expect("invalid datetime"))
+    }
+}
+
+/// Options controlling how data is loaded by [`super::load_with_options`].
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub struct LoadOptions {
+    /// Number of threads to use when decoding blocks. With `0` or `1`, all
+    /// blocks are decoded sequentially on the calling thread. Otherwise, the
+    /// blocks are distributed over up to `threads` worker threads, and the
+    /// `create_array` callback can be called concurrently from all of them.
+    pub threads: usize,
+}
+
+impl Default for LoadOptions {
+    fn default() -> LoadOptions {
+        LoadOptions { threads: 1 }
+    }
+}
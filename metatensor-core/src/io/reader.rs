@@ -0,0 +1,87 @@
+use std::sync::{Arc, Mutex};
+
+use zip::ZipArchive;
+
+use crate::{Labels, TensorBlock, Error, mts_array_t};
+
+use super::labels::load_labels;
+use super::block::{read_single_block, read_data};
+
+/// Lazy reader for a serialized `TensorMap`, giving random access to the
+/// blocks.
+///
+/// Opening a reader only parses the ZIP central directory and the keys of the
+/// tensor map; the blocks are only read and decoded when requested with
+/// [`TensorMapReader::block`]. This makes it possible to load a few blocks
+/// from a large file without paying the cost of loading the full file. See
+/// [`super::load`] for more information about the format of the file.
+pub struct TensorMapReader<R> {
+    archive: Mutex<ZipArchive<R>>,
+    keys: Arc<Labels>,
+}
+
+impl<R: std::io::Read + std::io::Seek> TensorMapReader<R> {
+    /// Create a new reader for the tensor map serialized in `reader`
+    pub fn new(reader: R) -> Result<TensorMapReader<R>, Error> {
+        let mut archive = ZipArchive::new(reader).map_err(|e| ("<root>".into(), e))?;
+
+        let path = String::from("keys.npy");
+        let keys = load_labels(archive.by_name(&path).map_err(|e| (path, e))?)?;
+
+        if archive.by_name("blocks/0/values/data.npy").is_ok() {
+            return Err(Error::Serialization(
+                "trying to load a file in the old metatensor format, please convert \
+                it to the new format first using the script at \
+                https://github.com/metatensor/metatensor/blob/master/python/scripts/convert-metatensor-npz.py
+                ".into()
+            ));
+        }
+
+        // only check that all the blocks are present, without reading them.
+        // This only uses the central directory of the archive.
+        for block_i in 0..keys.count() {
+            let path = format!("blocks/{}/values.npy", block_i);
+            archive.by_name(&path).map_err(|e| (path, e))?;
+        }
+
+        return Ok(TensorMapReader {
+            archive: Mutex::new(archive),
+            keys: Arc::new(keys),
+        });
+    }
+
+    /// Get the keys of the tensor map
+    pub fn keys(&self) -> &Arc<Labels> {
+        &self.keys
+    }
+
+    /// Get the index of blocks matching the given selection, see
+    /// `TensorMap::blocks_matching` for more information.
+    pub fn blocks_matching(&self, selection: &Labels) -> Result<Vec<usize>, Error> {
+        return crate::tensor::keys_matching(&self.keys, selection);
+    }
+
+    /// Read and decode the block at the given `index` in the tensor map.
+    ///
+    /// Arrays for the values and gradient data will be created with the given
+    /// `create_array` callback, and filled by this function with the
+    /// corresponding data.
+    pub fn block<F>(&self, index: usize, create_array: F) -> Result<TensorBlock, Error>
+        where F: Fn(Vec<usize>) -> Result<mts_array_t, Error>
+    {
+        if index >= self.keys.count() {
+            return Err(Error::InvalidParameter(format!(
+                "block index out of bounds: we have {} blocks but the index is {}",
+                self.keys.count(), index
+            )));
+        }
+
+        let mut archive = self.archive.lock().expect("mutex got poisoned");
+        return read_single_block(
+            &mut *archive,
+            &format!("blocks/{}/", index),
+            None,
+            &|file| read_data(file, &create_array),
+        );
+    }
+}
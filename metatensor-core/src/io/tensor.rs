@@ -1,13 +1,16 @@
 use std::io::BufReader;
 use std::sync::Arc;
+use std::sync::atomic::{AtomicUsize, Ordering};
 
 use zip::{ZipArchive, ZipWriter};
+use zip::read::ZipFile;
 
-use crate::{TensorMap, Error, mts_array_t};
+use crate::{TensorMap, TensorBlock, Labels, Error, mts_array_t};
 
-use super::PathOrBuffer;
+use super::{PathOrBuffer, PositionTracker};
+use super::{MmapFile, MappedData, SaveOptions, LoadOptions};
 use super::labels::{load_labels, save_labels};
-use super::block::{read_single_block, write_single_block};
+use super::block::{read_single_block, write_single_block, read_data, read_data_mmap};
 
 
 /// Check if the file/buffer in `data` looks like it could contain a serialized
@@ -53,7 +56,10 @@ pub fn looks_like_tensormap_data(mut data: PathOrBuffer) -> bool {
 /// We add other restriction on top of these formats when saving/loading data.
 /// First, `Labels` instances are saved as structured array, see the `labels`
 /// module for more information. Only 32-bit integers are supported for Labels,
-/// and only 64-bit floats are supported for data (values and gradients).
+/// and only 64-bit floats are supported for data (values and gradients). When
+/// saving, the header of the NPY files containing data is padded such that the
+/// data starts at a multiple of 64 bytes from the beginning of the file,
+/// allowing [`load_mmap`] to use it in-place.
 ///
 /// Second, the path of the files in the archive also carry meaning. The keys of
 /// the `TensorMap` are stored in `/keys.npy`, and then different blocks are
@@ -79,7 +85,124 @@ pub fn load<R, F>(reader: R, create_array: F) -> Result<TensorMap, Error>
           F: Fn(Vec<usize>) -> Result<mts_array_t, Error>
 {
     let mut archive = ZipArchive::new(reader).map_err(|e| ("<root>".into(), e))?;
+    return read_tensor(&mut archive, &|file| read_data(file, &create_array));
+}
+
+/// Load a serialized tensor map, using the given `options`.
+///
+/// The `open` callback should return a new reader for the serialized data
+/// every time it is called. When decoding blocks in parallel, it is called
+/// once on the calling thread to read the keys, and then once by each worker
+/// thread, which all read different blocks from their own reader.
+///
+/// The `create_array` callback can be called concurrently from all the worker
+/// threads, and the arrays it returns are filled on the worker thread before
+/// being moved back to the calling thread.
+///
+/// See [`load`] for more information about the format used to serialize
+/// `TensorMap`.
+pub fn load_with_options<R, O, F>(open: O, create_array: F, options: LoadOptions) -> Result<TensorMap, Error>
+    where R: std::io::Read + std::io::Seek,
+          O: Fn() -> Result<R, Error> + Sync,
+          F: Fn(Vec<usize>) -> Result<mts_array_t, Error> + Sync
+{
+    if options.threads <= 1 {
+        return load(open()?, &create_array);
+    }
+
+    let read_values = |file: ZipFile<'_>| read_data(file, &create_array);
+
+    let mut archive = ZipArchive::new(open()?).map_err(|e| ("<root>".into(), e))?;
+    let keys = read_keys(&mut archive)?;
+
+    let threads = options.threads.min(keys.count());
+    if threads <= 1 {
+        let blocks = read_blocks(&mut archive, &keys, &read_values)?;
+        return TensorMap::new(Arc::new(keys), blocks);
+    }
+    // the archive of the calling thread is not used to read blocks
+    std::mem::drop(archive);
+
+    let n_blocks = keys.count();
+    // index of the next block to decode, shared between all the workers
+    let next_block = AtomicUsize::new(0);
+    let worker = || -> Result<Vec<(usize, TensorBlock)>, Error> {
+        let mut archive = ZipArchive::new(open()?).map_err(|e| ("<root>".into(), e))?;
+
+        let mut blocks = Vec::new();
+        loop {
+            let block_i = next_block.fetch_add(1, Ordering::Relaxed);
+            if block_i >= n_blocks {
+                return Ok(blocks);
+            }
+
+            let block = read_single_block(&mut archive, &format!("blocks/{}/", block_i), None, &read_values);
+            match block {
+                Ok(block) => blocks.push((block_i, block)),
+                Err(error) => {
+                    // stop the other workers early
+                    next_block.store(n_blocks, Ordering::Relaxed);
+                    return Err(error);
+                }
+            }
+        }
+    };
+
+    let results = std::thread::scope(|scope| {
+        let handles = (0..threads).map(|_| scope.spawn(worker)).collect::<Vec<_>>();
+        handles.into_iter()
+            .map(|handle| handle.join().unwrap_or_else(|panic| std::panic::resume_unwind(panic)))
+            .collect::<Vec<_>>()
+    });
+
+    let mut blocks = Vec::new();
+    blocks.resize_with(n_blocks, || None);
+    for result in results {
+        for (block_i, block) in result? {
+            blocks[block_i] = Some(block);
+        }
+    }
+
+    let blocks = blocks.into_iter()
+        .map(|block| block.expect("all blocks should have been decoded"))
+        .collect();
 
+    return TensorMap::new(Arc::new(keys), blocks);
+}
+
+/// Load a serialized tensor map from a memory-mapped file.
+///
+/// Whenever possible, the arrays for values and gradients data will directly
+/// use the memory in `mmap`. The `create_array` callback is called with the
+/// shape of the array and `Some(MappedData)` in this case. If the data can not
+/// be used in-place (because it is not aligned, stored with a different
+/// endianness or compressed), `create_array` will be called with `None`
+/// instead, and the corresponding array will be filled by this function.
+///
+/// See [`load`] for more information about the format used to serialize
+/// `TensorMap`.
+pub fn load_mmap<F>(mmap: &Arc<MmapFile>, create_array: F) -> Result<TensorMap, Error>
+    where F: Fn(Vec<usize>, Option<MappedData>) -> Result<mts_array_t, Error>
+{
+    let reader = std::io::Cursor::new(mmap.as_slice());
+    let mut archive = ZipArchive::new(reader).map_err(|e| ("<root>".into(), e))?;
+    return read_tensor(&mut archive, &|file| read_data_mmap(file, mmap, &create_array));
+}
+
+fn read_tensor<R, F>(archive: &mut ZipArchive<R>, read_values: &F) -> Result<TensorMap, Error>
+    where R: std::io::Read + std::io::Seek,
+          F: Fn(ZipFile<'_>) -> Result<(mts_array_t, Vec<usize>), Error>
+{
+    let keys = read_keys(archive)?;
+    let blocks = read_blocks(archive, &keys, read_values)?;
+    return TensorMap::new(Arc::new(keys), blocks);
+}
+
+/// Read the keys of a serialized tensor map, checking that the file does not
+/// use the old format
+fn read_keys<R>(archive: &mut ZipArchive<R>) -> Result<Labels, Error>
+    where R: std::io::Read + std::io::Seek,
+{
     let path = String::from("keys.npy");
     let keys = load_labels(archive.by_name(&path).map_err(|e| (path, e))?)?;
 
@@ -92,17 +215,25 @@ pub fn load<R, F>(reader: R, create_array: F) -> Result<TensorMap, Error>
         ));
     }
 
+    return Ok(keys);
+}
+
+/// Sequentially read all the blocks corresponding to `keys`
+fn read_blocks<R, F>(archive: &mut ZipArchive<R>, keys: &Labels, read_values: &F) -> Result<Vec<TensorBlock>, Error>
+    where R: std::io::Read + std::io::Seek,
+          F: Fn(ZipFile<'_>) -> Result<(mts_array_t, Vec<usize>), Error>
+{
     let mut blocks = Vec::new();
     for block_i in 0..keys.count() {
         blocks.push(read_single_block(
-            &mut archive,
+            archive,
             &format!("blocks/{}/", block_i),
             None,
-            &create_array,
+            read_values,
         )?,);
     }
 
-    return TensorMap::new(Arc::new(keys), blocks);
+    return Ok(blocks);
 }
 
 
@@ -110,20 +241,19 @@ pub fn load<R, F>(reader: R, create_array: F) -> Result<TensorMap, Error>
 ///
 /// The format used is documented in the [`load`] function, and is based on
 /// numpy's NPZ format (i.e. zip archive containing NPY files).
-pub fn save<W: std::io::Write + std::io::Seek>(writer: W, tensor: &TensorMap) -> Result<(), Error> {
+///
+/// The `options` control the compression of the archive and the floating point
+/// type used to store the data, see [`SaveOptions`].
+pub fn save<W: std::io::Write + std::io::Seek>(writer: W, tensor: &TensorMap, options: SaveOptions) -> Result<(), Error> {
+    let (writer, position) = PositionTracker::new(writer)?;
     let mut archive = ZipWriter::new(writer);
 
-    let options = zip::write::FileOptions::default()
-        .compression_method(zip::CompressionMethod::Stored)
-        .large_file(true)
-        .last_modified_time(zip::DateTime::from_date_and_time(2000, 1, 1, 0, 0, 0).expect("invalid datetime"));
-
     let path = String::from("keys.npy");
-    archive.start_file(&path, options).map_err(|e| (path, e))?;
+    archive.start_file(&path, options.zip_options()).map_err(|e| (path, e))?;
     save_labels(&mut archive, tensor.keys())?;
 
     for (block_i, block) in tensor.blocks().iter().enumerate() {
-        write_single_block(&mut archive, &format!("blocks/{}/", block_i), true, block)?;
+        write_single_block(&mut archive, &format!("blocks/{}/", block_i), true, block, &position, options)?;
     }
 
     archive.finish().map_err(|e| ("<root>".into(), e))?;
@@ -0,0 +1,209 @@
+use std::cell::Cell;
+use std::collections::{BTreeMap, HashSet};
+use std::rc::Rc;
+
+use zip::ZipWriter;
+
+use crate::{Labels, LabelValue, TensorBlock, Error};
+use crate::tensor::{KeyAndBlock, merge_blocks_along_samples};
+
+use super::{PositionTracker, SaveOptions};
+use super::labels::save_labels;
+use super::block::write_single_block;
+
+/// Owned version of the names of all the labels in a block, used to check that
+/// all the blocks written to a file are compatible with each other.
+#[derive(Debug, Clone, PartialEq)]
+struct BlockNames {
+    samples: Vec<String>,
+    components: Vec<Vec<String>>,
+    properties: Vec<String>,
+    gradients: BTreeMap<String, BlockNames>,
+}
+
+impl BlockNames {
+    fn new(block: &TensorBlock) -> BlockNames {
+        let to_owned = |names: Vec<&str>| names.into_iter().map(String::from).collect::<Vec<_>>();
+        BlockNames {
+            samples: to_owned(block.samples.names()),
+            components: block.components.iter().map(|c| to_owned(c.names())).collect(),
+            properties: to_owned(block.properties.names()),
+            gradients: block.gradients().iter()
+                .map(|(parameter, gradient)| (parameter.clone(), BlockNames::new(gradient)))
+                .collect(),
+        }
+    }
+}
+
+/// Incremental writer for a `TensorMap`, writing blocks to the file one at a
+/// time instead of requiring the full `TensorMap` to be in memory.
+///
+/// Blocks are added with [`TensorMapWriter::append`], and the file is completed
+/// by [`TensorMapWriter::finish`], which writes the keys and the ZIP central
+/// directory. The data is written in the same format as [`super::save`].
+///
+/// Appending a block with the same key as the previous call to `append` adds
+/// the corresponding samples to the existing block. To allow this, the writer
+/// keeps the blocks appended for the current key in memory, and merges them
+/// once when a block with a different key is appended, or the writer is
+/// finished. All the samples for a given key must be appended consecutively.
+pub struct TensorMapWriter<W: std::io::Write + std::io::Seek> {
+    archive: ZipWriter<PositionTracker<W>>,
+    position: Rc<Cell<u64>>,
+    key_names: Vec<String>,
+    keys: Vec<LabelValue>,
+    written_keys: HashSet<Vec<LabelValue>>,
+    block_names: Option<BlockNames>,
+    /// Key of the block currently being appended, and all the blocks
+    /// appended for this key so far, in order
+    pending: Option<(Vec<LabelValue>, Vec<TensorBlock>)>,
+    options: SaveOptions,
+}
+
+impl<W: std::io::Write + std::io::Seek> TensorMapWriter<W> {
+    /// Create a new writer outputting data to `writer`, for a `TensorMap` with
+    /// keys with the given `key_names`. The data will be saved according to
+    /// the given `options`.
+    pub fn new(writer: W, key_names: &[&str], options: SaveOptions) -> Result<TensorMapWriter<W>, Error> {
+        // check that the names are valid, and can be used to create Labels
+        Labels::new(key_names, Vec::<i32>::new())?;
+
+        let (writer, position) = PositionTracker::new(writer)?;
+        return Ok(TensorMapWriter {
+            archive: ZipWriter::new(writer),
+            position: position,
+            key_names: key_names.iter().map(|&n| n.to_string()).collect(),
+            keys: Vec::new(),
+            written_keys: HashSet::new(),
+            block_names: None,
+            pending: None,
+            options: options,
+        });
+    }
+
+    /// Append a `block` associated with the given `key` to the file.
+    ///
+    /// If the key is the same as the key of the previously appended block, the
+    /// samples of `block` are added to the samples of the previous block
+    /// instead, and the components and properties of both blocks must match.
+    /// Otherwise, the key must not have been used before.
+    pub fn append(&mut self, key: &[i32], block: TensorBlock) -> Result<(), Error> {
+        if key.len() != self.key_names.len() {
+            return Err(Error::InvalidParameter(format!(
+                "invalid key: expected {} values, got {}",
+                self.key_names.len(), key.len()
+            )));
+        }
+        let key = key.iter().copied().map(LabelValue::new).collect::<Vec<_>>();
+
+        let block_names = BlockNames::new(&block);
+        if let Some(ref expected) = self.block_names {
+            if &block_names != expected {
+                return Err(Error::InvalidParameter(
+                    "all blocks must have the same set of gradients, with \
+                    the same sample, property and component names, \
+                    and the same must be true for gradients of gradients".into(),
+                ));
+            }
+        } else {
+            self.block_names = Some(block_names);
+        }
+
+        if let Some((pending_key, chunks)) = &mut self.pending {
+            if *pending_key == key {
+                check_can_append_samples(&chunks[0], &block)?;
+                chunks.push(block);
+                return Ok(());
+            }
+        }
+
+        if self.written_keys.contains(&key) {
+            return Err(Error::InvalidParameter(format!(
+                "a block for the key ({}) was already written, all samples for \
+                a given key must be appended one after the other",
+                key.iter().map(|v| v.to_string()).collect::<Vec<_>>().join(", ")
+            )));
+        }
+
+        self.write_pending()?;
+        self.pending = Some((key, vec![block]));
+        return Ok(());
+    }
+
+    /// Write any remaining block, the keys and the ZIP central directory, and
+    /// flush the underlying writer.
+    pub fn finish(mut self) -> Result<(), Error> {
+        self.write_pending()?;
+
+        let key_names = self.key_names.iter().map(|n| &**n).collect::<Vec<_>>();
+        let keys = unsafe {
+            // SAFETY: we checked that all keys are unique in `append`
+            Labels::new_unchecked_uniqueness(&key_names, std::mem::take(&mut self.keys))?
+        };
+
+        let path = String::from("keys.npy");
+        self.archive.start_file(&path, self.options.zip_options()).map_err(|e| (path, e))?;
+        save_labels(&mut self.archive, &keys)?;
+
+        let mut writer = self.archive.finish().map_err(|e| ("<root>".into(), e))?;
+        std::io::Write::flush(&mut writer)?;
+
+        return Ok(());
+    }
+
+    /// Merge the samples of all the blocks appended for the current key, and
+    /// write the resulting block to the file
+    fn write_pending(&mut self) -> Result<(), Error> {
+        if let Some((key, chunks)) = self.pending.take() {
+            let block = merge_samples_of_blocks(&key, chunks)?;
+
+            let prefix = format!("blocks/{}/", self.written_keys.len());
+            write_single_block(&mut self.archive, &prefix, true, &block, &self.position, self.options)?;
+
+            self.keys.extend_from_slice(&key);
+            self.written_keys.insert(key);
+        }
+
+        return Ok(());
+    }
+}
+
+/// Check that the samples in `new` can be added to the samples of `existing`
+fn check_can_append_samples(existing: &TensorBlock, new: &TensorBlock) -> Result<(), Error> {
+    if existing.components != new.components {
+        return Err(Error::InvalidParameter(
+            "can not append samples to an existing block with different components".into()
+        ));
+    }
+
+    if existing.properties != new.properties {
+        return Err(Error::InvalidParameter(
+            "can not append samples to an existing block with different properties".into()
+        ));
+    }
+
+    return Ok(());
+}
+
+/// Create a single block containing the samples of all the `chunks`, in order
+fn merge_samples_of_blocks(key: &[LabelValue], mut chunks: Vec<TensorBlock>) -> Result<TensorBlock, Error> {
+    if chunks.len() == 1 {
+        return Ok(chunks.remove(0));
+    }
+
+    let blocks = chunks.iter()
+        .map(|block| KeyAndBlock { key: key.to_vec(), block })
+        .collect::<Vec<_>>();
+    let merged = merge_blocks_along_samples(&blocks, &[], false)?;
+
+    let n_samples = chunks.iter().map(|block| block.samples.count()).sum::<usize>();
+    if merged.samples.count() != n_samples {
+        return Err(Error::InvalidParameter(format!(
+            "can not append samples to the block for key ({}): some of the \
+            samples were appended multiple times",
+            key.iter().map(|v| v.to_string()).collect::<Vec<_>>().join(", ")
+        )));
+    }
+
+    return Ok(merged);
+}
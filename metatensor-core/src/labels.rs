@@ -156,6 +156,42 @@ impl Drop for UserData {
 unsafe impl Sync for UserData {}
 unsafe impl Send for UserData {}
 
+/// Storage for the values of a set of `Labels`. The values are either owned by
+/// Rust, or borrowed from memory owned by someone else, which is kept alive by
+/// `owner` until the `Labels` are dropped.
+enum LabelsValues {
+    Owned(Vec<LabelValue>),
+    Borrowed {
+        ptr: *const LabelValue,
+        len: usize,
+        owner: UserData,
+    },
+}
+
+impl std::ops::Deref for LabelsValues {
+    type Target = [LabelValue];
+
+    fn deref(&self) -> &[LabelValue] {
+        match self {
+            LabelsValues::Owned(values) => values,
+            LabelsValues::Borrowed { ptr, len, .. } => {
+                if *len == 0 {
+                    &[]
+                } else {
+                    // SAFETY: `ptr` and `len` are checked when creating the
+                    // labels, and `owner` keeps the memory alive
+                    unsafe { std::slice::from_raw_parts(*ptr, *len) }
+                }
+            }
+        }
+    }
+}
+
+// The borrowed memory is never modified through the `Labels`, and the code
+// giving us this memory must ensure that it is not modified elsewhere.
+unsafe impl Sync for LabelsValues {}
+unsafe impl Send for LabelsValues {}
+
 /// A set of labels used to carry metadata associated with a tensor map.
 ///
 /// This is similar to a list of named tuples, but stored as a 2D array of shape
@@ -169,12 +205,16 @@ pub struct Labels {
     /// with the C API
     names: Vec<ConstCString>,
     /// Values of the labels, as a linearized 2D array in row-major order
-    values: Vec<LabelValue>,
+    values: LabelsValues,
     /// Store the position of all the known labels, for faster access later.
     /// This is lazily initialized whenever a function requires access to the
     /// positions of different entries, allowing to skip the construction of the
     /// `HashMap` when Labels are only used as data storage.
     positions: OnceCell<HashMap<LabelsEntry, usize, AHashHasher>>,
+    /// Are the entries of these labels sorted in lexicographic order? This is
+    /// lazily initialized by [`Labels::is_sorted`], and allows to find ranges
+    /// of entries sharing a prefix with a binary search.
+    sorted: OnceCell<bool>,
     /// Some data provided by the user that we should keep around (this is
     /// used to store a pointer to the on-GPU tensor in metatensor-torch).
     user_data: RwLock<UserData>,
@@ -182,7 +222,7 @@ pub struct Labels {
 
 impl PartialEq for Labels {
     fn eq(&self, other: &Self) -> bool {
-        self.names == other.names && self.values == other.values
+        self.names == other.names && *self.values == *other.values
     }
 }
 
@@ -243,9 +283,77 @@ impl Labels {
         }
     }
 
+    /// Create new labels with the given names, borrowing the values from
+    /// memory owned by someone else instead of copying them.
+    ///
+    /// `values` must point to `len` elements (it can be NULL if `len` is 0),
+    /// and this memory must stay alive and unmodified until `owner_delete` is
+    /// called with `owner`, which happens when the labels are dropped. If this
+    /// function returns an error, `owner_delete` is not called, and the caller
+    /// is still responsible for `owner`.
+    ///
+    /// If `check_unique` is `false`, the caller must ensure that the entries
+    /// are unique (this is still checked in debug mode).
+    pub unsafe fn new_borrowed(
+        names: &[&str],
+        values: *const LabelValue,
+        len: usize,
+        owner: *mut c_void,
+        owner_delete: Option<unsafe extern fn(*mut c_void)>,
+        check_unique: bool,
+    ) -> Result<Labels, Error> {
+        let slice: &[LabelValue] = if len == 0 {
+            &[]
+        } else {
+            assert!(!values.is_null());
+            std::slice::from_raw_parts(values, len)
+        };
+
+        let check_unique = check_unique || cfg!(debug_assertions);
+        let names = Labels::check_new(names, slice, check_unique)?;
+
+        let values = LabelsValues::Borrowed {
+            ptr: values,
+            len: len,
+            owner: UserData { ptr: owner, delete: owner_delete },
+        };
+
+        Ok(Labels {
+            sorted: if names.is_empty() { OnceCell::with_value(true) } else { OnceCell::new() },
+            names: names,
+            values: values,
+            positions: OnceCell::new(),
+            user_data: RwLock::new(UserData::null()),
+        })
+    }
+
     /// Actual implementation of both [`Labels::new`] and
     /// [`Labels::new_unchecked_uniqueness`]
     fn new_impl(names: &[&str], values: Vec<LabelValue>, check_unique: bool) -> Result<Labels, Error> {
+        let names = Labels::check_new(names, &values, check_unique)?;
+
+        if names.is_empty() {
+            return Ok(Labels {
+                names: Vec::new(),
+                values: LabelsValues::Owned(Vec::new()),
+                positions: Default::default(),
+                sorted: OnceCell::with_value(true),
+                user_data: RwLock::new(UserData::null()),
+            });
+        }
+
+        Ok(Labels {
+            names: names,
+            values: LabelsValues::Owned(values),
+            positions: OnceCell::new(),
+            sorted: OnceCell::new(),
+            user_data: RwLock::new(UserData::null()),
+        })
+    }
+
+    /// Check the names and values used to create new labels, and convert the
+    /// names to C strings
+    fn check_new(names: &[&str], values: &[LabelValue], check_unique: bool) -> Result<Vec<ConstCString>, Error> {
         for name in names {
             if !is_valid_label_name(name) {
                 return Err(Error::InvalidParameter(format!(
@@ -269,12 +377,7 @@ impl Labels {
 
         if names.is_empty() {
             assert!(values.is_empty());
-            return Ok(Labels {
-                names: Vec::new(),
-                values: Vec::new(),
-                positions: Default::default(),
-                user_data: RwLock::new(UserData::null()),
-            });
+            return Ok(names);
         }
 
         let size = names.len();
@@ -293,12 +396,7 @@ impl Labels {
             }
         }
 
-        Ok(Labels {
-            names: names,
-            values: values,
-            positions: OnceCell::new(),
-            user_data: RwLock::new(UserData::null()),
-        })
+        Ok(names)
     }
 
     /// Get the number of entries/named values in a single label
@@ -375,6 +473,98 @@ impl Labels {
         return self.positions.get_or_init(|| init_positions(&self.values, self.size()));
     }
 
+    /// Check if the entries in these Labels are sorted in lexicographic order.
+    ///
+    /// This is computed the first time this function is called, and cached
+    /// for later calls.
+    pub fn is_sorted(&self) -> bool {
+        return *self.sorted.get_or_init(|| {
+            if self.size() == 0 {
+                return true;
+            }
+
+            let mut entries = self.values.chunks_exact(self.size());
+            let mut previous = match entries.next() {
+                Some(entry) => entry,
+                None => return true,
+            };
+
+            for entry in entries {
+                if entry < previous {
+                    return false;
+                }
+                previous = entry;
+            }
+            return true;
+        });
+    }
+
+    /// Get the range `start..end` of rows containing all the entries starting
+    /// with the given `prefix`, i.e. all entries where the first
+    /// `prefix.len()` dimensions match `prefix`.
+    ///
+    /// If the labels are sorted (see [`Labels::is_sorted`]), this uses a binary
+    /// search, and an empty range indicates the position where entries with
+    /// this prefix would be inserted. Otherwise, this checks all the entries,
+    /// and returns an error if the matching entries are not contiguous. An
+    /// empty range is returned if no entry matches the prefix.
+    pub fn range_of(&self, prefix: &[LabelValue]) -> Result<std::ops::Range<usize>, Error> {
+        if prefix.len() > self.size() {
+            return Err(Error::InvalidParameter(format!(
+                "prefix contains {} values, but these labels only have {} dimensions",
+                prefix.len(), self.size()
+            )));
+        }
+
+        let n_prefix = prefix.len();
+        if n_prefix == 0 {
+            return Ok(0..self.count());
+        }
+
+        if self.is_sorted() {
+            let start = self.partition_point(|entry| &entry[..n_prefix] < prefix);
+            let end = self.partition_point(|entry| &entry[..n_prefix] <= prefix);
+            return Ok(start..end);
+        }
+
+        let mut start = None;
+        let mut end = 0;
+        for (i, entry) in self.iter().enumerate() {
+            if &entry[..n_prefix] != prefix {
+                continue;
+            }
+
+            if start.is_none() {
+                start = Some(i);
+            } else if end != i {
+                return Err(Error::InvalidParameter(
+                    "the entries matching this prefix are not contiguous \
+                    in these Labels".into()
+                ));
+            }
+            end = i + 1;
+        }
+
+        return Ok(start.map_or(0..0, |start| start..end));
+    }
+
+    /// Get the index of the first entry for which `predicate` returns false,
+    /// assuming that the entries are partitioned according to `predicate`
+    /// (all the entries for which `predicate` returns true come first).
+    fn partition_point(&self, predicate: impl Fn(&[LabelValue]) -> bool) -> usize {
+        let mut low = 0;
+        let mut high = self.count();
+        while low < high {
+            let middle = low + (high - low) / 2;
+            if predicate(&self[middle]) {
+                low = middle + 1;
+            } else {
+                high = middle;
+            }
+        }
+        return low;
+    }
+
     /// Iterate over the entries in these Labels
     pub fn iter(&self) -> Iter {
         debug_assert!(self.values.len() % self.names.len() == 0);
@@ -396,7 +586,7 @@ impl Labels {
         }
 
         let mut positions = self.get_or_init_positions().clone();
-        let mut values = self.values.clone();
+        let mut values = self.values.to_vec();
 
         if !first_mapping.is_empty() {
             assert!(first_mapping.len() == self.count());
@@ -427,8 +617,9 @@ impl Labels {
 
         return Ok(Labels {
             names: self.names.clone(),
-            values,
+            values: LabelsValues::Owned(values),
             positions: OnceCell::with_value(positions),
+            sorted: OnceCell::new(),
             user_data: RwLock::new(UserData::null()),
         });
     }
@@ -482,8 +673,9 @@ impl Labels {
 
         return Ok(Labels {
             names: self.names.clone(),
-            values,
+            values: LabelsValues::Owned(values),
             positions: OnceCell::new(),
+            sorted: OnceCell::new(),
             user_data: RwLock::new(UserData::null()),
         });
     }
@@ -614,7 +806,7 @@ mod tests {
 
         let union = first.union(&second, first_mapping, second_mapping).unwrap();
         assert_eq!(union.names(), ["aa", "bb"]);
-        assert_eq!(union.values, &[0, 1, 1, 2, 2, 3, 4, 5]);
+        assert_eq!(&*union.values, &[0, 1, 1, 2, 2, 3, 4, 5]);
         assert_eq!(first_mapping, &[0, 1]);
         assert_eq!(second_mapping, &[2, 1, 3]);
 
@@ -623,7 +815,7 @@ mod tests {
 
         let union = second.union(&first, first_mapping, second_mapping).unwrap();
         assert_eq!(union.names(), ["aa", "bb"]);
-        assert_eq!(union.values, &[2, 3, 1, 2, 4, 5, 0, 1]);
+        assert_eq!(&*union.values, &[2, 3, 1, 2, 4, 5, 0, 1]);
         assert_eq!(first_mapping, &[0, 1, 2]);
         assert_eq!(second_mapping, &[3, 1]);
 
@@ -641,7 +833,7 @@ mod tests {
 
         let union = first.union(&empty, first_mapping, second_mapping).unwrap();
         assert_eq!(union.names(), ["aa", "bb"]);
-        assert_eq!(union.values, &[0, 1, 1, 2]);
+        assert_eq!(&*union.values, &[0, 1, 1, 2]);
         assert_eq!(first_mapping, &[0, 1]);
         assert_eq!(second_mapping, &[]);
     }
@@ -663,7 +855,7 @@ mod tests {
 
         let intersection = first.intersection(&second, first_mapping, second_mapping).unwrap();
         assert_eq!(intersection.names(), ["aa", "bb"]);
-        assert_eq!(intersection.values, &[1, 2]);
+        assert_eq!(&*intersection.values, &[1, 2]);
         assert_eq!(first_mapping, &[-1, 0]);
         assert_eq!(second_mapping, &[-1, 0, -1]);
 
@@ -672,7 +864,7 @@ mod tests {
 
         let intersection = second.intersection(&first, first_mapping, second_mapping).unwrap();
         assert_eq!(intersection.names(), ["aa", "bb"]);
-        assert_eq!(intersection.values, &[1, 2]);
+        assert_eq!(&*intersection.values, &[1, 2]);
         assert_eq!(first_mapping, &[-1, 0, -1]);
         assert_eq!(second_mapping, &[-1, 0]);
 
@@ -695,6 +887,85 @@ mod tests {
         assert_eq!(second_mapping, &[]);
     }
 
+    #[test]
+    fn range_of() {
+        let labels = Labels::new(
+            &["aa", "bb"],
+            vec![0, 1, /**/ 0, 2, /**/ 1, 0, /**/ 1, 3, /**/ 1, 4, /**/ 3, 0]
+        ).unwrap();
+        assert!(labels.is_sorted());
+
+        let to_values = |values: &[i32]| values.iter().copied().map(LabelValue::from).collect::<Vec<_>>();
+
+        assert_eq!(labels.range_of(&to_values(&[0])).unwrap(), 0..2);
+        assert_eq!(labels.range_of(&to_values(&[1])).unwrap(), 2..5);
+        assert_eq!(labels.range_of(&to_values(&[3])).unwrap(), 5..6);
+        assert_eq!(labels.range_of(&to_values(&[2])).unwrap(), 5..5);
+        assert_eq!(labels.range_of(&to_values(&[1, 3])).unwrap(), 3..4);
+        assert_eq!(labels.range_of(&to_values(&[])).unwrap(), 0..6);
+
+        let err = labels.range_of(&to_values(&[1, 3, 4])).unwrap_err();
+        assert_eq!(
+            err.to_string(),
+            "invalid parameter: prefix contains 3 values, but these labels only have 2 dimensions"
+        );
+
+        let labels = Labels::new(
+            &["aa", "bb"],
+            vec![1, 1, /**/ 1, 0, /**/ 0, 2, /**/ 2, 0, /**/ 0, 3]
+        ).unwrap();
+        assert!(!labels.is_sorted());
+
+        assert_eq!(labels.range_of(&to_values(&[1])).unwrap(), 0..2);
+        assert_eq!(labels.range_of(&to_values(&[2])).unwrap(), 3..4);
+        assert_eq!(labels.range_of(&to_values(&[5])).unwrap(), 0..0);
+
+        let err = labels.range_of(&to_values(&[0])).unwrap_err();
+        assert_eq!(
+            err.to_string(),
+            "invalid parameter: the entries matching this prefix are not contiguous in these Labels"
+        );
+    }
+
+    #[test]
+    fn borrowed() {
+        use std::sync::atomic::{AtomicUsize, Ordering};
+
+        static DELETED: AtomicUsize = AtomicUsize::new(0);
+        unsafe extern fn delete_owner(owner: *mut c_void) {
+            drop(Box::from_raw(owner.cast::<Vec<LabelValue>>()));
+            DELETED.fetch_add(1, Ordering::SeqCst);
+        }
+
+        let values = Box::new([0, 1, /**/ 1, 2, /**/ 2, 3].map(LabelValue::new).to_vec());
+        let ptr = values.as_ptr();
+        let owner = Box::into_raw(values).cast::<c_void>();
+
+        let labels = unsafe {
+            Labels::new_borrowed(&["aa", "bb"], ptr, 6, owner, Some(delete_owner), true).unwrap()
+        };
+        assert_eq!(labels.count(), 3);
+        // the values are not copied
+        assert_eq!(&labels[1][0] as *const LabelValue, unsafe { ptr.add(2) });
+        assert_eq!(labels.position(&[LabelValue::new(2), LabelValue::new(3)]), Some(2));
+        assert_eq!(labels, Labels::new(&["aa", "bb"], vec![0, 1, 1, 2, 2, 3]).unwrap());
+
+        assert_eq!(DELETED.load(Ordering::SeqCst), 0);
+        drop(labels);
+        assert_eq!(DELETED.load(Ordering::SeqCst), 1);
+
+        // errors do not release the owner
+        let values = [0, 1, /**/ 0, 1].map(LabelValue::new);
+        let err = unsafe {
+            Labels::new_borrowed(&["aa", "bb"], values.as_ptr(), 4, std::ptr::null_mut(), Some(delete_owner), true)
+        }.err().unwrap();
+        assert_eq!(
+            err.to_string(),
+            "invalid parameter: can not have the same label entry multiple time: [0, 1] is already present"
+        );
+        assert_eq!(DELETED.load(Ordering::SeqCst), 1);
+    }
+
     #[test]
     fn marker_traits() {
         // ensure Arc<Labels> is Send and Sync, assuming the user data is
@@ -30,6 +30,8 @@ use c_api::mts_status_t;
 
 mod io;
 
+mod profiling;
+
 /// The possible sources of error in metatensor
 #[derive(Debug)]
 pub enum Error {
@@ -0,0 +1,236 @@
+//! Lightweight counters recording how many times the main operations in
+//! metatensor are called, how much time is spent in them, and how many bytes
+//! they move around.
+//!
+//! The counters are only collected when the `profiling` cargo feature is
+//! enabled. Otherwise, all the functions in this module do nothing and are
+//! removed by the compiler.
+
+/// Operations for which we track calls, time and bytes
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum Operation {
+    LabelsCreate,
+    LabelsUnion,
+    LabelsIntersection,
+    LabelsSelect,
+    TensorMapCreate,
+    KeysToProperties,
+    KeysToSamples,
+    ComponentsToProperties,
+    SplitSamples,
+    MergeSamples,
+    LabelsLoad,
+    LabelsSave,
+    BlockLoad,
+    BlockSave,
+    TensorMapLoad,
+    TensorMapSave,
+}
+
+impl Operation {
+    /// All the operations, in the order used by `mts_profiling_get`
+    pub const ALL: [Operation; 16] = [
+        Operation::LabelsCreate,
+        Operation::LabelsUnion,
+        Operation::LabelsIntersection,
+        Operation::LabelsSelect,
+        Operation::TensorMapCreate,
+        Operation::KeysToProperties,
+        Operation::KeysToSamples,
+        Operation::ComponentsToProperties,
+        Operation::SplitSamples,
+        Operation::MergeSamples,
+        Operation::LabelsLoad,
+        Operation::LabelsSave,
+        Operation::BlockLoad,
+        Operation::BlockSave,
+        Operation::TensorMapLoad,
+        Operation::TensorMapSave,
+    ];
+
+    /// Get the name of this operation, as a NULL-terminated string
+    pub fn name(self) -> &'static std::ffi::CStr {
+        let name: &[u8] = match self {
+            Operation::LabelsCreate => b"labels_create\0",
+            Operation::LabelsUnion => b"labels_union\0",
+            Operation::LabelsIntersection => b"labels_intersection\0",
+            Operation::LabelsSelect => b"labels_select\0",
+            Operation::TensorMapCreate => b"tensormap_create\0",
+            Operation::KeysToProperties => b"keys_to_properties\0",
+            Operation::KeysToSamples => b"keys_to_samples\0",
+            Operation::ComponentsToProperties => b"components_to_properties\0",
+            Operation::SplitSamples => b"split_samples\0",
+            Operation::MergeSamples => b"merge_samples\0",
+            Operation::LabelsLoad => b"labels_load\0",
+            Operation::LabelsSave => b"labels_save\0",
+            Operation::BlockLoad => b"block_load\0",
+            Operation::BlockSave => b"block_save\0",
+            Operation::TensorMapLoad => b"tensormap_load\0",
+            Operation::TensorMapSave => b"tensormap_save\0",
+        };
+
+        return std::ffi::CStr::from_bytes_with_nul(name).expect("invalid operation name");
+    }
+}
+
+/// Counters accumulated for a single operation
+#[derive(Debug, Clone, Copy, Default, PartialEq, Eq)]
+pub struct Counters {
+    /// number of calls to the operation
+    pub calls: u64,
+    /// cumulative wall-clock time spent in this operation, in nanoseconds
+    pub time_ns: u64,
+    /// cumulative number of bytes created, read or written by the operation
+    pub bytes: u64,
+}
+
+#[cfg(feature = "profiling")]
+mod enabled {
+    use std::sync::atomic::{AtomicU64, Ordering};
+    use std::time::Instant;
+
+    use super::{Counters, Operation};
+
+    struct AtomicCounters {
+        calls: AtomicU64,
+        time_ns: AtomicU64,
+        bytes: AtomicU64,
+    }
+
+    impl AtomicCounters {
+        #[allow(clippy::declare_interior_mutable_const)]
+        const NEW: AtomicCounters = AtomicCounters {
+            calls: AtomicU64::new(0),
+            time_ns: AtomicU64::new(0),
+            bytes: AtomicU64::new(0),
+        };
+    }
+
+    static COUNTERS: [AtomicCounters; Operation::ALL.len()] = [AtomicCounters::NEW; Operation::ALL.len()];
+
+    fn counters(operation: Operation) -> &'static AtomicCounters {
+        return &COUNTERS[operation as usize];
+    }
+
+    /// Guard recording the time spent in an operation when dropped
+    pub struct Scope {
+        operation: Operation,
+        start: Instant,
+    }
+
+    impl Drop for Scope {
+        fn drop(&mut self) {
+            let elapsed = u64::try_from(self.start.elapsed().as_nanos()).unwrap_or(u64::MAX);
+            let counters = counters(self.operation);
+            counters.calls.fetch_add(1, Ordering::Relaxed);
+            counters.time_ns.fetch_add(elapsed, Ordering::Relaxed);
+        }
+    }
+
+    /// Start recording a call to `operation`, until the returned guard is
+    /// dropped.
+    #[inline]
+    pub fn scope(operation: Operation) -> Scope {
+        Scope { operation, start: Instant::now() }
+    }
+
+    /// Record that `operation` moved `bytes` bytes
+    #[inline]
+    pub fn add_bytes(operation: Operation, bytes: usize) {
+        let bytes = u64::try_from(bytes).unwrap_or(u64::MAX);
+        counters(operation).bytes.fetch_add(bytes, Ordering::Relaxed);
+    }
+
+    /// Record that `operation` read or wrote the whole file at `path`
+    pub fn add_file_bytes(operation: Operation, path: &str) {
+        if let Ok(metadata) = std::fs::metadata(path) {
+            let bytes = usize::try_from(metadata.len()).unwrap_or(usize::MAX);
+            add_bytes(operation, bytes);
+        }
+    }
+
+    /// Get the current value of the counters for a given `operation`
+    pub fn get(operation: Operation) -> Counters {
+        let counters = counters(operation);
+        return Counters {
+            calls: counters.calls.load(Ordering::Relaxed),
+            time_ns: counters.time_ns.load(Ordering::Relaxed),
+            bytes: counters.bytes.load(Ordering::Relaxed),
+        };
+    }
+
+    /// Reset all counters to zero
+    pub fn reset() {
+        for counters in &COUNTERS {
+            counters.calls.store(0, Ordering::Relaxed);
+            counters.time_ns.store(0, Ordering::Relaxed);
+            counters.bytes.store(0, Ordering::Relaxed);
+        }
+    }
+
+    pub const ENABLED: bool = true;
+}
+
+#[cfg(not(feature = "profiling"))]
+mod disabled {
+    use super::{Counters, Operation};
+
+    /// Guard recording the time spent in an operation when dropped. This does
+    /// nothing since profiling is disabled.
+    pub struct Scope;
+
+    #[inline(always)]
+    pub fn scope(_: Operation) -> Scope {
+        Scope
+    }
+
+    #[inline(always)]
+    pub fn add_bytes(_: Operation, _: usize) {}
+
+    #[inline(always)]
+    pub fn add_file_bytes(_: Operation, _: &str) {}
+
+    pub fn get(_: Operation) -> Counters {
+        Counters::default()
+    }
+
+    pub fn reset() {}
+
+    pub const ENABLED: bool = false;
+}
+
+#[cfg(feature = "profiling")]
+pub use self::enabled::{scope, add_bytes, add_file_bytes, get, reset, ENABLED};
+
+#[cfg(not(feature = "profiling"))]
+pub use self::disabled::{scope, add_bytes, add_file_bytes, get, reset, ENABLED};
+
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn names() {
+        for (i, operation) in Operation::ALL.iter().enumerate() {
+            assert_eq!(*operation as usize, i);
+            assert!(!operation.name().to_bytes().is_empty());
+        }
+    }
+
+    #[test]
+    #[cfg(feature = "profiling")]
+    fn counters() {
+        // use an operation which is not used by other tests in this crate
+        let before = get(Operation::ComponentsToProperties);
+        {
+            let _scope = scope(Operation::ComponentsToProperties);
+            add_bytes(Operation::ComponentsToProperties, 42);
+        }
+
+        let after = get(Operation::ComponentsToProperties);
+        assert!(after.calls >= before.calls + 1);
+        assert!(after.bytes >= before.bytes + 42);
+        assert!(after.time_ns >= before.time_ns);
+    }
+}
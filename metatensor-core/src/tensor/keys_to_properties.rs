@@ -8,7 +8,7 @@ use crate::{Error, TensorBlock};
 use crate::data::mts_sample_mapping_t;
 
 use super::TensorMap;
-use super::utils::{KeyAndBlock, remove_dimensions_from_keys, merge_samples, merge_gradient_samples};
+use super::utils::{KeyAndBlock, parallel_map, remove_dimensions_from_keys, merge_samples, merge_gradient_samples};
 
 
 impl TensorMap {
@@ -81,6 +81,8 @@ impl TensorMap {
             new_blocks.push(block);
         } else {
             assert!(splitted_keys.new_keys.count() > 1);
+            // find all the blocks to merge for each new key
+            let mut blocks_to_merge = Vec::new();
             for entry in &splitted_keys.new_keys {
                 let selection = Labels::new(
                     &splitted_keys.new_keys.names(),
@@ -88,7 +90,7 @@ impl TensorMap {
                 ).expect("invalid labels");
 
                 let matching = self.blocks_matching(&selection)?;
-                let blocks_to_merge = matching.iter()
+                blocks_to_merge.push(matching.iter()
                     .map(|&i| {
                         let block = &self.blocks[i];
                         let key = &self.keys[i];
@@ -102,16 +104,18 @@ impl TensorMap {
                             block
                         }
                     })
-                    .collect::<Vec<_>>();
-
-                let block = merge_blocks_along_properties(
-                    &blocks_to_merge,
-                    keys_to_move,
-                    &names_to_move,
-                    sort_samples,
-                )?;
-                new_blocks.push(block);
+                    .collect::<Vec<_>>()
+                );
             }
+
+            // the merged blocks are independent of each other, and can be
+            // created in parallel
+            new_blocks = parallel_map(blocks_to_merge.len(), |i| merge_blocks_along_properties(
+                &blocks_to_merge[i],
+                keys_to_move,
+                &names_to_move,
+                sort_samples,
+            ))?;
         }
 
         return TensorMap::new(Arc::new(splitted_keys.new_keys), new_blocks);
@@ -6,7 +6,7 @@ use crate::{Error, TensorBlock};
 use crate::data::mts_sample_mapping_t;
 
 use super::TensorMap;
-use super::utils::{KeyAndBlock, remove_dimensions_from_keys, merge_samples, merge_gradient_samples};
+use super::utils::{KeyAndBlock, parallel_map, remove_dimensions_from_keys, merge_samples, merge_gradient_samples};
 
 impl TensorMap {
     /// Merge blocks with the same value for selected keys dimensions along the
@@ -70,6 +70,8 @@ impl TensorMap {
             )?;
             new_blocks.push(block);
         } else {
+            // find all the blocks to merge for each new key
+            let mut blocks_to_merge = Vec::new();
             for entry in &splitted_keys.new_keys {
                 let selection = Labels::new(
                     &splitted_keys.new_keys.names(),
@@ -77,7 +79,7 @@ impl TensorMap {
                 ).expect("invalid labels");
 
                 let matching = self.blocks_matching(&selection)?;
-                let blocks_to_merge = matching.iter()
+                blocks_to_merge.push(matching.iter()
                     .map(|&i| {
                         let block = &self.blocks[i];
                         let key = &self.keys[i];
@@ -91,14 +93,17 @@ impl TensorMap {
                             block
                         }
                     })
-                    .collect::<Vec<_>>();
-
-                new_blocks.push(merge_blocks_along_samples(
-                    &blocks_to_merge,
-                    &names_to_move,
-                    sort_samples,
-                )?);
+                    .collect::<Vec<_>>()
+                );
             }
+
+            // the merged blocks are independent of each other, and can be
+            // created in parallel
+            new_blocks = parallel_map(blocks_to_merge.len(), |i| merge_blocks_along_samples(
+                &blocks_to_merge[i],
+                &names_to_move,
+                sort_samples,
+            ))?;
         }
 
         return TensorMap::new(Arc::new(splitted_keys.new_keys), new_blocks);
@@ -106,7 +111,7 @@ impl TensorMap {
 }
 
 /// Merge the given `blocks` along the sample axis.
-fn merge_blocks_along_samples(
+pub(crate) fn merge_blocks_along_samples(
     blocks_to_merge: &[KeyAndBlock],
     extracted_names: &[&str],
     sort_samples: bool,
@@ -6,9 +6,12 @@ use crate::{Labels, Error};
 use crate::get_data_origin;
 
 mod utils;
+pub(crate) use self::utils::{KeyAndBlock, set_num_threads, num_threads};
 
 mod keys_to_samples;
+pub(crate) use self::keys_to_samples::merge_blocks_along_samples;
 mod keys_to_properties;
+mod split;
 
 
 /// A tensor map is the main user-facing struct of this library, and can store
@@ -116,6 +119,57 @@ impl GradientMap<'_> {
     }
 }
 
+/// Get the index of the entries in `keys` matching the given `selection`.
+///
+/// This is the implementation of `TensorMap::blocks_matching`, also used when
+/// only the keys of a tensor map are available.
+pub(crate) fn keys_matching(keys: &Labels, selection: &Labels) -> Result<Vec<usize>, Error> {
+    if selection.size() == 0 {
+        return Ok((0..keys.count()).collect());
+    }
+
+    if selection.count() != 1 {
+        return Err(Error::InvalidParameter(format!(
+            "block selection must contain exactly one entry, got {}",
+            selection.count()
+        )));
+    }
+
+    let mut dimensions = Vec::new();
+    'outer: for requested in selection.names() {
+        for (i, &name) in keys.names().iter().enumerate() {
+            if requested == name {
+                dimensions.push(i);
+                continue 'outer;
+            }
+        }
+
+        return Err(Error::InvalidParameter(format!(
+            "'{}' is not part of the keys for this tensor",
+            requested
+        )));
+    }
+
+    let mut matching = Vec::new();
+    let selection = selection.iter().next().expect("empty selection");
+
+    for (block_i, labels) in keys.iter().enumerate() {
+        let mut selected = true;
+        for (&requested_i, &value) in dimensions.iter().zip(selection) {
+            if labels[requested_i] != value {
+                selected = false;
+                break;
+            }
+        }
+
+        if selected {
+            matching.push(block_i);
+        }
+    }
+
+    return Ok(matching);
+}
+
 impl TensorMap {
     /// Create a new `TensorMap` with the given keys and blocks.
     ///
@@ -209,50 +263,7 @@ impl TensorMap {
     /// or keys. If the selection contains only a subset of the dimensions of the
     /// keys, there can be multiple matching blocks.
     pub fn blocks_matching(&self, selection: &Labels) -> Result<Vec<usize>, Error> {
-        if selection.size() == 0 {
-            return Ok((0..self.blocks().len()).collect());
-        }
-
-        if selection.count() != 1 {
-            return Err(Error::InvalidParameter(format!(
-                "block selection must contain exactly one entry, got {}",
-                selection.count()
-            )));
-        }
-
-        let mut dimensions = Vec::new();
-        'outer: for requested in selection.names() {
-            for (i, &name) in self.keys.names().iter().enumerate() {
-                if requested == name {
-                    dimensions.push(i);
-                    continue 'outer;
-                }
-            }
-
-            return Err(Error::InvalidParameter(format!(
-                "'{}' is not part of the keys for this tensor",
-                requested
-            )));
-        }
-
-        let mut matching = Vec::new();
-        let selection = selection.iter().next().expect("empty selection");
-
-        for (block_i, labels) in self.keys.iter().enumerate() {
-            let mut selected = true;
-            for (&requested_i, &value) in dimensions.iter().zip(selection) {
-                if labels[requested_i] != value {
-                    selected = false;
-                    break;
-                }
-            }
-
-            if selected {
-                matching.push(block_i);
-            }
-        }
-
-        return Ok(matching);
+        return keys_matching(&self.keys, selection);
     }
 
     /// Move the given dimensions from the component labels to the property labels
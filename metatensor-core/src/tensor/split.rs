@@ -0,0 +1,397 @@
+use std::sync::Arc;
+
+use crate::labels::{Labels, LabelValue};
+use crate::{Error, TensorBlock};
+
+use crate::data::{mts_array_t, mts_sample_mapping_t};
+
+use super::TensorMap;
+use super::utils::parallel_map;
+
+impl TensorMap {
+    /// Split the samples of all the blocks in this tensor map into `n_shards`
+    /// new tensor maps, using the value of the `dimension` samples dimension
+    /// to find the shard of each sample: a sample with value `v` for this
+    /// dimension goes to the shard `shards[v]`.
+    ///
+    /// All the new tensor maps have the same keys as this one, and blocks with
+    /// the same components and properties. Blocks without any sample in a
+    /// given shard are kept as empty blocks. The samples of each block are
+    /// kept in the same order as in the original block, and the gradients are
+    /// split along with the corresponding samples.
+    ///
+    /// All the data is moved a single time, so the cost of this function does
+    /// not depend on the number of shards.
+    pub fn split_samples(&self, dimension: &str, shards: &[usize], n_shards: usize) -> Result<Vec<TensorMap>, Error> {
+        for (value, &shard) in shards.iter().enumerate() {
+            if shard >= n_shards {
+                return Err(Error::InvalidParameter(format!(
+                    "the shard for value {} of '{}' is {}, but there are only {} shards",
+                    value, dimension, shard, n_shards
+                )));
+            }
+        }
+
+        // the blocks are independent of each other, and can be split in parallel
+        let split_blocks = parallel_map(self.blocks.len(), |block_i| {
+            split_block_samples(&self.blocks[block_i], dimension, shards, n_shards)
+        })?;
+
+        let mut blocks_per_shard = (0..n_shards).map(|_| Vec::with_capacity(self.blocks.len())).collect::<Vec<_>>();
+        for blocks in split_blocks {
+            for (shard, block) in blocks.into_iter().enumerate() {
+                blocks_per_shard[shard].push(block);
+            }
+        }
+
+        return blocks_per_shard.into_iter()
+            .map(|blocks| TensorMap::new(Arc::clone(&self.keys), blocks))
+            .collect();
+    }
+
+    /// Merge multiple tensor maps created by `split_samples` back into a
+    /// single one, concatenating the samples (and gradients) of all the blocks
+    /// with the same key.
+    ///
+    /// All the `tensors` must have the same keys, and the blocks with the same
+    /// key must have the same components, properties and gradients. The
+    /// merged samples contain all the samples from the first tensor, followed
+    /// by all the samples from the second tensor, etc. The samples must be
+    /// different in all tensors.
+    pub fn merge_samples(tensors: &[&TensorMap]) -> Result<TensorMap, Error> {
+        if tensors.is_empty() {
+            return Err(Error::InvalidParameter(
+                "provide at least one tensor map to merge".into()
+            ));
+        }
+
+        let first = tensors[0];
+        for tensor in tensors {
+            if tensor.keys != first.keys {
+                return Err(Error::InvalidParameter(
+                    "can not merge tensor maps with different keys".into()
+                ));
+            }
+        }
+
+        let blocks = parallel_map(first.blocks.len(), |block_i| {
+            let blocks = tensors.iter()
+                .map(|tensor| &tensor.blocks[block_i])
+                .collect::<Vec<_>>();
+            merge_block_samples(&blocks)
+        })?;
+
+        return TensorMap::new(Arc::clone(&first.keys), blocks);
+    }
+}
+
+/// Split the samples of a single block (and its gradients) in `n_shards`
+/// blocks, see `TensorMap::split_samples`.
+fn split_block_samples(
+    block: &TensorBlock,
+    dimension: &str,
+    shards: &[usize],
+    n_shards: usize,
+) -> Result<Vec<TensorBlock>, Error> {
+    let sample_names = block.samples.names();
+    let dimension_i = sample_names.iter().position(|&name| name == dimension).ok_or_else(|| {
+        Error::InvalidParameter(format!(
+            "'{}' is not part of the samples dimensions [{}]",
+            dimension, sample_names.join(", ")
+        ))
+    })?;
+
+    for gradient in block.gradients().values() {
+        if !gradient.gradients().is_empty() {
+            return Err(Error::InvalidParameter(
+                "gradient of gradients are not supported yet in split_samples".into()
+            ));
+        }
+    }
+
+    // find the shard and position inside the shard of all samples
+    let mut sample_values = vec![Vec::<LabelValue>::new(); n_shards];
+    let mut sample_mappings = vec![Vec::new(); n_shards];
+    let mut new_positions = Vec::with_capacity(block.samples.count());
+    for (sample_i, sample) in block.samples.iter().enumerate() {
+        let value = sample[dimension_i].i32();
+        let shard = usize::try_from(value).ok()
+            .and_then(|value| shards.get(value))
+            .copied()
+            .ok_or_else(|| Error::InvalidParameter(format!(
+                "sample {} has value {} for '{}', but the shards are only defined \
+                for values between 0 and {} (exclusive)",
+                sample_i, value, dimension, shards.len()
+            )))?;
+
+        let position = sample_mappings[shard].len();
+        sample_mappings[shard].push(mts_sample_mapping_t {
+            input: sample_i,
+            output: position,
+        });
+        sample_values[shard].extend_from_slice(sample);
+        new_positions.push((shard, position));
+    }
+
+    let mut new_blocks = Vec::with_capacity(n_shards);
+    for (values, mapping) in sample_values.into_iter().zip(&sample_mappings) {
+        let samples = unsafe {
+            // SAFETY: this is a subset of the samples of the block, which are
+            // unique
+            Labels::new_unchecked_uniqueness(&sample_names, values).expect("invalid labels")
+        };
+        let data = moved_samples(&block.values, mapping, block.properties.count())?;
+
+        new_blocks.push(TensorBlock::new(
+            data,
+            Arc::new(samples),
+            block.components.to_vec(),
+            Arc::clone(&block.properties),
+        ).expect("invalid block"));
+    }
+
+    for (parameter, gradient) in block.gradients() {
+        let gradient_sample_names = gradient.samples.names();
+
+        let mut gradient_values = vec![Vec::<LabelValue>::new(); n_shards];
+        let mut gradient_mappings = vec![Vec::new(); n_shards];
+        for (gradient_sample_i, gradient_sample) in gradient.samples.iter().enumerate() {
+            let (shard, position) = new_positions[gradient_sample[0].usize()];
+
+            let output = gradient_mappings[shard].len();
+            gradient_mappings[shard].push(mts_sample_mapping_t {
+                input: gradient_sample_i,
+                output,
+            });
+            gradient_values[shard].push(LabelValue::from(position));
+            gradient_values[shard].extend_from_slice(&gradient_sample[1..]);
+        }
+
+        for (shard, (values, mapping)) in gradient_values.into_iter().zip(&gradient_mappings).enumerate() {
+            let samples = unsafe {
+                // SAFETY: the samples are unique in the original gradient, and
+                // we only renumber the "sample" dimension with a bijection
+                Labels::new_unchecked_uniqueness(&gradient_sample_names, values).expect("invalid labels")
+            };
+            let data = moved_samples(&gradient.values, mapping, gradient.properties.count())?;
+
+            let new_gradient = TensorBlock::new(
+                data,
+                Arc::new(samples),
+                gradient.components.to_vec(),
+                Arc::clone(&new_blocks[shard].properties),
+            ).expect("invalid gradient");
+
+            new_blocks[shard].add_gradient(parameter, new_gradient).expect("could not add gradient");
+        }
+    }
+
+    return Ok(new_blocks);
+}
+
+/// Merge the samples of multiple blocks (and their gradients) in a single
+/// block, see `TensorMap::merge_samples`.
+fn merge_block_samples(blocks: &[&TensorBlock]) -> Result<TensorBlock, Error> {
+    let first = blocks[0];
+    for block in blocks {
+        if block.samples.names() != first.samples.names() {
+            return Err(Error::InvalidParameter(
+                "can not merge blocks with different samples names".into()
+            ));
+        }
+
+        if block.components != first.components {
+            return Err(Error::InvalidParameter(
+                "can not merge blocks with different components".into()
+            ));
+        }
+
+        if block.properties != first.properties {
+            return Err(Error::InvalidParameter(
+                "can not merge blocks with different properties".into()
+            ));
+        }
+
+        if block.gradients().len() != first.gradients().len() {
+            return Err(Error::InvalidParameter(
+                "can not merge blocks with different gradients".into()
+            ));
+        }
+
+        for (parameter, gradient) in block.gradients() {
+            if !gradient.gradients().is_empty() {
+                return Err(Error::InvalidParameter(
+                    "gradient of gradients are not supported yet in merge_samples".into()
+                ));
+            }
+
+            if first.gradient(parameter).is_none() {
+                return Err(Error::InvalidParameter(format!(
+                    "can not merge blocks with different gradients: '{}' is \
+                    missing in some of the blocks", parameter
+                )));
+            }
+        }
+    }
+
+    // the first sample of each block in the merged block
+    let mut offsets = Vec::with_capacity(blocks.len());
+    let mut n_samples = 0;
+    for block in blocks {
+        offsets.push(n_samples);
+        n_samples += block.samples.count();
+    }
+
+    let mut values = Vec::with_capacity(n_samples * first.samples.size());
+    for block in blocks {
+        for sample in &*block.samples {
+            values.extend_from_slice(sample);
+        }
+    }
+    // this checks that the samples are different in all blocks
+    let samples = Labels::new(&first.samples.names(), values)?;
+
+    let mut shape = first.values.shape()?.to_vec();
+    shape[0] = n_samples;
+    let mut data = first.values.create(&shape)?;
+
+    let properties = 0..first.properties.count();
+    for (block, &offset) in blocks.iter().zip(&offsets) {
+        let mapping = (0..block.samples.count()).map(|sample_i| mts_sample_mapping_t {
+            input: sample_i,
+            output: offset + sample_i,
+        }).collect::<Vec<_>>();
+
+        if !mapping.is_empty() {
+            data.move_samples_from(&block.values, &mapping, properties.clone())?;
+        }
+    }
+
+    let mut new_block = TensorBlock::new(
+        data,
+        Arc::new(samples),
+        first.components.to_vec(),
+        Arc::clone(&first.properties),
+    ).expect("invalid block");
+
+    for (parameter, first_gradient) in first.gradients() {
+        let gradients = blocks.iter()
+            .map(|block| block.gradient(parameter).expect("missing gradient"))
+            .collect::<Vec<_>>();
+
+        let n_gradient_samples = gradients.iter().map(|gradient| gradient.samples.count()).sum();
+        let mut values = Vec::with_capacity(n_gradient_samples * first_gradient.samples.size());
+        for (gradient, &offset) in gradients.iter().zip(&offsets) {
+            for gradient_sample in &*gradient.samples {
+                values.push(LabelValue::from(gradient_sample[0].usize() + offset));
+                values.extend_from_slice(&gradient_sample[1..]);
+            }
+        }
+
+        let samples = unsafe {
+            // SAFETY: the samples are unique inside each gradient, and refer
+            // to different samples in different gradients
+            Labels::new_unchecked_uniqueness(&first_gradient.samples.names(), values).expect("invalid labels")
+        };
+
+        let mut shape = first_gradient.values.shape()?.to_vec();
+        shape[0] = n_gradient_samples;
+        let mut data = first_gradient.values.create(&shape)?;
+
+        let properties = 0..first_gradient.properties.count();
+        let mut output = 0;
+        for gradient in &gradients {
+            let mapping = (0..gradient.samples.count()).map(|sample_i| mts_sample_mapping_t {
+                input: sample_i,
+                output: output + sample_i,
+            }).collect::<Vec<_>>();
+            output += mapping.len();
+
+            if !mapping.is_empty() {
+                data.move_samples_from(&gradient.values, &mapping, properties.clone())?;
+            }
+        }
+
+        let new_gradient = TensorBlock::new(
+            data,
+            Arc::new(samples),
+            first_gradient.components.to_vec(),
+            Arc::clone(&new_block.properties),
+        ).expect("invalid gradient");
+
+        new_block.add_gradient(parameter, new_gradient).expect("could not add gradient");
+    }
+
+    return Ok(new_block);
+}
+
+/// Create a new array with the samples of `array` selected by `mapping`
+fn moved_samples(
+    array: &mts_array_t,
+    mapping: &[mts_sample_mapping_t],
+    n_properties: usize,
+) -> Result<mts_array_t, Error> {
+    let mut shape = array.shape()?.to_vec();
+    shape[0] = mapping.len();
+    let mut data = array.create(&shape)?;
+
+    if !mapping.is_empty() {
+        data.move_samples_from(array, mapping, 0..n_properties)?;
+    }
+
+    return Ok(data);
+}
+
+#[cfg(test)]
+mod tests {
+    use crate::data::TestArray;
+
+    use super::*;
+    use super::super::utils::example_labels;
+
+    fn example_tensor() -> TensorMap {
+        let mut block = TensorBlock::new(
+            TestArray::new(vec![4, 1]),
+            Arc::new(Labels::new(&["system", "atom"], vec![0, 0, 0, 1, 1, 0, 2, 0]).unwrap()),
+            vec![],
+            example_labels(&["properties"], &[0]),
+        ).unwrap();
+
+        let gradient = TensorBlock::new(
+            TestArray::new(vec![3, 1]),
+            Arc::new(Labels::new(&["sample", "parameter"], vec![0, 1, 2, 3, 3, 5]).unwrap()),
+            vec![],
+            example_labels(&["properties"], &[0]),
+        ).unwrap();
+        block.add_gradient("g", gradient).unwrap();
+
+        return TensorMap::new(example_labels(&["keys"], &[0]), vec![block]).unwrap();
+    }
+
+    #[test]
+    fn errors() {
+        let tensor = example_tensor();
+
+        let error = tensor.split_samples("system", &[0, 2], 2).unwrap_err();
+        assert_eq!(
+            error.to_string(),
+            "invalid parameter: the shard for value 1 of 'system' is 2, but there are only 2 shards"
+        );
+
+        let error = tensor.split_samples("system", &[0, 1], 2).unwrap_err();
+        assert_eq!(
+            error.to_string(),
+            "invalid parameter: sample 3 has value 2 for 'system', but the \
+            shards are only defined for values between 0 and 2 (exclusive)"
+        );
+
+        let error = tensor.split_samples("structure", &[0, 1, 1], 2).unwrap_err();
+        assert_eq!(
+            error.to_string(),
+            "invalid parameter: 'structure' is not part of the samples dimensions [system, atom]"
+        );
+
+        let error = TensorMap::merge_samples(&[&tensor, &tensor]).unwrap_err();
+        assert!(error.to_string().contains("can not have the same label entry multiple time"));
+    }
+}
@@ -1,5 +1,6 @@
 use std::collections::BTreeSet;
 use std::sync::Arc;
+use std::sync::atomic::{AtomicUsize, Ordering};
 
 use indexmap::IndexSet;
 
@@ -13,6 +14,80 @@ pub struct KeyAndBlock<'a> {
     pub block: &'a TensorBlock,
 }
 
+/// Number of threads used to merge blocks in the `keys_to_xxx` functions
+static NUM_THREADS: AtomicUsize = AtomicUsize::new(1);
+
+/// Set the number of threads used by operations on `TensorMap` which can
+/// process multiple blocks in parallel. With `0`, the number of threads is
+/// set to the number of CPU cores available to the current process.
+pub fn set_num_threads(threads: usize) {
+    let threads = if threads == 0 {
+        std::thread::available_parallelism().map_or(1, |n| n.get())
+    } else {
+        threads
+    };
+    NUM_THREADS.store(threads, Ordering::Relaxed);
+}
+
+/// Get the number of threads used by operations on `TensorMap` which can
+/// process multiple blocks in parallel.
+pub fn num_threads() -> usize {
+    NUM_THREADS.load(Ordering::Relaxed)
+}
+
+/// Call `function` for all indexes in `0..count`, distributing the calls over
+/// up to [`num_threads`] threads, and collect the results in order.
+///
+/// If any call returns an error, the remaining indexes are not processed and
+/// the first error (in index order) is returned.
+pub fn parallel_map<T, F>(count: usize, function: F) -> Result<Vec<T>, Error>
+    where T: Send,
+          F: Fn(usize) -> Result<T, Error> + Sync,
+{
+    let threads = num_threads().min(count);
+    if threads <= 1 {
+        return (0..count).map(function).collect();
+    }
+
+    // next index to process, shared between all the workers
+    let next = AtomicUsize::new(0);
+    let worker = || {
+        let mut results = Vec::new();
+        loop {
+            let i = next.fetch_add(1, Ordering::Relaxed);
+            if i >= count {
+                return results;
+            }
+
+            let result = function(i);
+            if result.is_err() {
+                // stop the other workers early
+                next.store(count, Ordering::Relaxed);
+            }
+            results.push((i, result));
+        }
+    };
+
+    let results = std::thread::scope(|scope| {
+        let handles = (0..threads).map(|_| scope.spawn(worker)).collect::<Vec<_>>();
+        handles.into_iter()
+            .map(|handle| handle.join().unwrap_or_else(|panic| std::panic::resume_unwind(panic)))
+            .collect::<Vec<_>>()
+    });
+
+    let mut ordered = Vec::new();
+    ordered.resize_with(count, || None);
+    for (i, result) in results.into_iter().flatten() {
+        ordered[i] = Some(result);
+    }
+
+    // all indexes before the first error have been processed, so we will
+    // find this error before any missing result
+    return ordered.into_iter()
+        .map(|result| result.expect("missing result in parallel_map"))
+        .collect();
+}
+
 /// Result of the `remove_dimensions_from_keys` function
 #[derive(Debug)]
 pub struct RemovedDimensionsKeys {
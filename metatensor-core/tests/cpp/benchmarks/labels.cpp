@@ -0,0 +1,98 @@
+#include <catch.hpp>
+
+#include <metatensor.hpp>
+
+#include "utils.hpp"
+
+using namespace metatensor;
+
+TEST_CASE("Labels creation", "[labels]") {
+    for (auto size: benchmark_sizes()) {
+        auto values = labels_values(size);
+
+        BENCHMARK(benchmark_name("Labels creation", size)) {
+            return Labels({"first", "second"}, values.data(), size);
+        };
+
+        BENCHMARK(benchmark_name("Labels creation with assume_unique", size)) {
+            return Labels({"first", "second"}, values.data(), size, assume_unique{});
+        };
+    }
+}
+
+TEST_CASE("Labels position", "[labels]") {
+    for (auto size: benchmark_sizes()) {
+        auto labels = create_labels(size);
+
+        // look for 1000 entries, spread over the labels
+        auto entries = std::vector<std::vector<int32_t>>();
+        for (size_t i = 0; i < 1000; i++) {
+            auto entry = labels_values(1, (i * 7919) % size);
+            entries.emplace_back(std::move(entry));
+        }
+
+        BENCHMARK(benchmark_name("Labels::position x1000", size)) {
+            int64_t sum = 0;
+            for (const auto& entry: entries) {
+                sum += labels.position(entry);
+            }
+            return sum;
+        };
+    }
+}
+
+TEST_CASE("Labels set operations", "[labels]") {
+    for (auto size: benchmark_sizes()) {
+        // `second` overlaps with half of `first`
+        auto first = create_labels(size);
+        auto second = create_labels(size, size / 2);
+
+        BENCHMARK(benchmark_name("Labels::set_union", size)) {
+            return first.set_union(second);
+        };
+
+        auto first_mapping = std::vector<int64_t>(size);
+        auto second_mapping = std::vector<int64_t>(size);
+        BENCHMARK(benchmark_name("Labels::set_union with mapping", size)) {
+            return first.set_union(
+                second,
+                first_mapping.data(),
+                first_mapping.size(),
+                second_mapping.data(),
+                second_mapping.size()
+            );
+        };
+
+        BENCHMARK(benchmark_name("Labels::set_intersection", size)) {
+            return first.set_intersection(second);
+        };
+
+        BENCHMARK(benchmark_name("Labels::set_intersection with mapping", size)) {
+            return first.set_intersection(
+                second,
+                first_mapping.data(),
+                first_mapping.size(),
+                second_mapping.data(),
+                second_mapping.size()
+            );
+        };
+    }
+}
+
+TEST_CASE("Labels select", "[labels]") {
+    for (auto size: benchmark_sizes()) {
+        auto labels = create_labels(size);
+
+        // selection with all the dimensions
+        auto selection = create_labels(size / 10, size / 2);
+        BENCHMARK(benchmark_name("Labels::select all dimensions", size)) {
+            return labels.select(selection);
+        };
+
+        // selection with a subset of the dimensions
+        auto subset = Labels({"second"}, {{0}, {10}, {20}, {30}, {40}});
+        BENCHMARK(benchmark_name("Labels::select subset of dimensions", size)) {
+            return labels.select(subset);
+        };
+    }
+}
@@ -0,0 +1,65 @@
+#include <catch.hpp>
+
+#include <metatensor.hpp>
+
+#include "utils.hpp"
+
+using namespace metatensor;
+
+TEST_CASE("TensorMap blocks_matching", "[tensor]") {
+    for (size_t n_keys: {100, 1000, 10000}) {
+        auto tensor = create_tensor(n_keys, 1);
+
+        auto selection = Labels({"center"}, {{3}});
+        BENCHMARK(benchmark_name("TensorMap::blocks_matching one dimension", n_keys)) {
+            return tensor.blocks_matching(selection);
+        };
+
+        selection = Labels({"center", "neighbor"}, {{3, 4}});
+        BENCHMARK(benchmark_name("TensorMap::blocks_matching all dimensions", n_keys)) {
+            return tensor.blocks_matching(selection);
+        };
+    }
+}
+
+TEST_CASE("TensorMap keys_to_*", "[tensor]") {
+    for (auto size: benchmark_sizes()) {
+        // 100 blocks, the total size corresponds to the number of samples
+        auto tensor = create_tensor(100, size / 100);
+
+        BENCHMARK(benchmark_name("TensorMap::keys_to_properties", size)) {
+            return tensor.keys_to_properties("neighbor");
+        };
+
+        BENCHMARK(benchmark_name("TensorMap::keys_to_samples", size)) {
+            return tensor.keys_to_samples("neighbor");
+        };
+    }
+}
+
+TEST_CASE("TensorMap serialization", "[tensor][io]") {
+    for (auto size: benchmark_sizes()) {
+        auto tensor = create_tensor(100, size / 100);
+
+        BENCHMARK(benchmark_name("io::save_buffer", size)) {
+            return io::save_buffer(tensor);
+        };
+
+        auto options = io::SaveOptions();
+        options.compression = io::Compression::Deflate;
+        BENCHMARK(benchmark_name("io::save_buffer with compression", size)) {
+            return io::save_buffer(tensor, options);
+        };
+
+        auto buffer = io::save_buffer(tensor);
+        BENCHMARK(benchmark_name("io::load_buffer", size)) {
+            return io::load_buffer(buffer);
+        };
+
+        auto load_options = io::LoadOptions();
+        load_options.threads = 4;
+        BENCHMARK(benchmark_name("io::load_buffer with 4 threads", size)) {
+            return io::load_buffer(buffer, details::default_create_array, load_options);
+        };
+    }
+}
@@ -0,0 +1,104 @@
+#ifndef METATENSOR_BENCHMARKS_UTILS_HPP
+#define METATENSOR_BENCHMARKS_UTILS_HPP
+
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include <metatensor.hpp>
+
+/// Get the sizes (number of entries) to use in the benchmarks, as powers of
+/// ten from 10^3 up to the value of the `METATENSOR_BENCHMARKS_MAX_SIZE`
+/// environment variable (defaults to 10^6).
+inline std::vector<size_t> benchmark_sizes() {
+    size_t max_size = 1000000;
+    auto* env = std::getenv("METATENSOR_BENCHMARKS_MAX_SIZE");
+    if (env != nullptr) {
+        max_size = static_cast<size_t>(std::strtoull(env, nullptr, 10));
+    }
+
+    auto sizes = std::vector<size_t>();
+    for (size_t size = 1000; size <= max_size; size *= 10) {
+        sizes.push_back(size);
+    }
+    return sizes;
+}
+
+/// Get the name of a benchmark running with the given `size`
+inline std::string benchmark_name(const std::string& name, size_t size) {
+    return name + " (" + std::to_string(size) + ")";
+}
+
+/// Get the values for `count` unique entries with two dimensions, starting
+/// at the entry number `start`. The second dimension takes values between 0
+/// and 99.
+inline std::vector<int32_t> labels_values(size_t count, size_t start = 0) {
+    auto values = std::vector<int32_t>();
+    values.reserve(2 * count);
+    for (size_t i = start; i < start + count; i++) {
+        values.push_back(static_cast<int32_t>(i / 100));
+        values.push_back(static_cast<int32_t>(i % 100));
+    }
+    return values;
+}
+
+/// Create `Labels` with the names "first" and "second", containing the entries
+/// from `labels_values(count, start)`
+inline metatensor::Labels create_labels(size_t count, size_t start = 0) {
+    auto values = labels_values(count, start);
+    return metatensor::Labels({"first", "second"}, values.data(), count);
+}
+
+/// Create a `TensorMap` with `n_keys` blocks. The keys have two dimensions:
+/// "center" takes values between 0 and 9, and "neighbor" takes values between 0
+/// and `n_keys / 10`. Each block contains `n_samples` samples, no components
+/// and 4 properties, and a gradient with respect to "positions" with one
+/// gradient sample per sample.
+inline metatensor::TensorMap create_tensor(size_t n_keys, size_t n_samples) {
+    auto keys_values = std::vector<int32_t>();
+    auto blocks = std::vector<metatensor::TensorBlock>();
+
+    auto samples = create_labels(n_samples);
+    auto properties = metatensor::Labels({"properties"}, {{0}, {1}, {2}, {3}});
+
+    auto gradient_samples_values = std::vector<int32_t>();
+    for (size_t i = 0; i < n_samples; i++) {
+        gradient_samples_values.push_back(static_cast<int32_t>(i));
+        gradient_samples_values.push_back(0);
+    }
+    auto gradient_samples = metatensor::Labels(
+        {"sample", "atom"}, gradient_samples_values.data(), n_samples
+    );
+    auto xyz = metatensor::Labels({"xyz"}, {{0}, {1}, {2}});
+
+    for (size_t i = 0; i < n_keys; i++) {
+        keys_values.push_back(static_cast<int32_t>(i % 10));
+        keys_values.push_back(static_cast<int32_t>(i / 10));
+
+        auto block = metatensor::TensorBlock(
+            std::unique_ptr<metatensor::SimpleDataArray>(new metatensor::SimpleDataArray(
+                {n_samples, 4}, static_cast<double>(i)
+            )),
+            samples,
+            {},
+            properties
+        );
+
+        auto gradient = metatensor::TensorBlock(
+            std::unique_ptr<metatensor::SimpleDataArray>(new metatensor::SimpleDataArray(
+                {n_samples, 3, 4}, static_cast<double>(i)
+            )),
+            gradient_samples,
+            {xyz},
+            properties
+        );
+        block.add_gradient("positions", std::move(gradient));
+
+        blocks.emplace_back(std::move(block));
+    }
+
+    auto keys = metatensor::Labels({"center", "neighbor"}, keys_values.data(), n_keys);
+    return metatensor::TensorMap(std::move(keys), std::move(blocks));
+}
+
+#endif
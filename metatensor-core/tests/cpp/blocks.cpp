@@ -7,6 +7,9 @@
 using namespace metatensor;
 
 static void check_loaded_block(metatensor::TensorBlock& block);
+static mts_status_t custom_create_mmap_array(const uintptr_t* shape_ptr, uintptr_t shape_count, double* data, mts_mmap_t* mmap, mts_array_t *array);
+
+static int CUSTOM_CREATE_MMAP_ARRAY_CALL_COUNT = 0;
 
 TEST_CASE("Blocks") {
     SECTION("no components") {
@@ -187,6 +190,35 @@ TEST_CASE("Serialization") {
 
         block = metatensor::io::load_block(TEST_BLOCK_NPZ_PATH);
         check_loaded_block(block);
+
+        // files written before the data was aligned can still be loaded
+        block = TensorBlock::load(TEST_BLOCK_UNALIGNED_NPZ_PATH);
+        check_loaded_block(block);
+    }
+
+    SECTION("loading file with mmap") {
+        CUSTOM_CREATE_MMAP_ARRAY_CALL_COUNT = 0;
+        auto block = TensorBlock::load_mmap(TEST_BLOCK_NPZ_PATH, custom_create_mmap_array);
+        check_loaded_block(block);
+        // values and gradient are aligned in the file, and can be used in-place
+        CHECK(CUSTOM_CREATE_MMAP_ARRAY_CALL_COUNT == 2);
+
+        CUSTOM_CREATE_MMAP_ARRAY_CALL_COUNT = 0;
+        block = metatensor::io::load_block_mmap(TEST_BLOCK_NPZ_PATH, custom_create_mmap_array);
+        check_loaded_block(block);
+        CHECK(CUSTOM_CREATE_MMAP_ARRAY_CALL_COUNT == 2);
+
+        // in files written before the data was aligned, the arrays are copied
+        // instead of used in-place
+        CUSTOM_CREATE_MMAP_ARRAY_CALL_COUNT = 0;
+        auto unaligned = TensorBlock::load_mmap(TEST_BLOCK_UNALIGNED_NPZ_PATH, custom_create_mmap_array);
+        check_loaded_block(unaligned);
+        CHECK(CUSTOM_CREATE_MMAP_ARRAY_CALL_COUNT == 0);
+
+        CHECK(unaligned.values() == block.values());
+        auto unaligned_gradient = unaligned.gradient("positions");
+        auto gradient = block.gradient("positions");
+        CHECK(unaligned_gradient.values() == gradient.values());
     }
 
     SECTION("Load/Save with buffers") {
@@ -249,3 +281,29 @@ void check_loaded_block(metatensor::TensorBlock& block) {
     values = gradient.values();
     CHECK(values.shape() == std::vector<size_t>{59, 3, 5, 3});
 }
+
+mts_status_t custom_create_mmap_array(const uintptr_t* shape_ptr, uintptr_t shape_count, double* data, mts_mmap_t* mmap, mts_array_t *array) {
+    auto shape = std::vector<size_t>();
+    for (size_t i=0; i<shape_count; i++) {
+        shape.push_back(static_cast<size_t>(shape_ptr[i]));
+    }
+
+    auto cxx_array = std::unique_ptr<DataArrayBase>(nullptr);
+    if (data != nullptr) {
+        CUSTOM_CREATE_MMAP_ARRAY_CALL_COUNT += 1;
+
+        auto size = details::product(shape);
+        cxx_array.reset(new SimpleDataArray(shape, std::vector<double>(data, data + size)));
+
+        auto status = mts_mmap_free(mmap);
+        if (status != MTS_SUCCESS) {
+            return status;
+        }
+    } else {
+        cxx_array.reset(new SimpleDataArray(shape));
+    }
+
+    *array = DataArrayBase::to_mts_array_t(std::move(cxx_array));
+
+    return MTS_SUCCESS;
+}
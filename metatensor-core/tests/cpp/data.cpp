@@ -31,6 +31,69 @@ TEST_CASE("Data Array") {
         CHECK(data_ptr[16] == 3);
     }
 
+    SECTION("fixed-rank views") {
+        auto array_view = static_cast<SimpleDataArray*>(array.ptr)->view();
+        auto view = array_view.view<3>();
+        CHECK(view.shape() == std::array<size_t, 3>{2, 3, 4});
+        CHECK(view.strides() == std::array<size_t, 3>{12, 4, 1});
+        CHECK(view.size() == 24);
+
+        view(1, 2, 3) = 4;
+        view(std::array<size_t, 3>{0, 1, 2}) = 5;
+        CHECK(array_view(1, 2, 3) == 4);
+        CHECK(array_view(0, 1, 2) == 5);
+        CHECK(view.data()[23] == 4);
+        CHECK(view.data()[6] == 5);
+
+        const auto& const_array_view = array_view;
+        auto const_view = const_array_view.view<3>();
+        CHECK(const_view(1, 2, 3) == 4);
+        CHECK_THROWS_WITH(
+            const_view(1, 2, 3) = 3,
+            "This NDArray is const, can not get non const access to it"
+        );
+
+        CHECK_THROWS_WITH(
+            array_view.view<2>(),
+            "can not create a view with 2 dimensions of an NDArray with 3 dimensions"
+        );
+
+        auto raw = std::vector<int32_t>{1, 2, 3, 4, 5, 6};
+        auto raw_view = NDArray<int32_t, 2>(raw.data(), {3, 2});
+        CHECK(raw_view(2, 0) == 5);
+        CHECK(details::cartesian_index(raw_view.shape(), 5) == std::array<size_t, 2>{2, 1});
+    }
+
+    SECTION("typed data") {
+        int32_t dtype = MTS_DTYPE_UNKNOWN;
+        auto status = array.dtype(array.ptr, &dtype);
+        CHECK(status == MTS_SUCCESS);
+        CHECK(dtype == MTS_DTYPE_FLOAT64);
+
+        void* data_ptr = nullptr;
+        status = array.typed_data(array.ptr, MTS_DTYPE_FLOAT64, &data_ptr);
+        CHECK(status == MTS_SUCCESS);
+        CHECK(data_ptr == static_cast<SimpleDataArray*>(array.ptr)->data());
+
+        status = array.typed_data(array.ptr, MTS_DTYPE_FLOAT32, &data_ptr);
+        CHECK(status != MTS_SUCCESS);
+
+        auto block = TensorBlock(
+            std::unique_ptr<SimpleDataArray>(new SimpleDataArray({2, 1}, 4.0)),
+            Labels({"s"}, {{0}, {1}}),
+            {},
+            Labels({"p"}, {{0}})
+        );
+
+        auto values = block.values<double>();
+        CHECK(values(1, 0) == 4.0);
+
+        CHECK_THROWS_WITH(
+            block.values<float>(),
+            "error in C++ callback: this array only contains 64-bit floating point data"
+        );
+    }
+
     SECTION("shape") {
         const uintptr_t* shape = nullptr;
         uintptr_t shape_count = 0;
@@ -67,6 +130,23 @@ TEST_CASE("Data Array") {
         CHECK(shape[1] == 3);
         CHECK(shape[2] == 2);
         CHECK(shape[3] == 4);
+
+        auto view = static_cast<SimpleDataArray*>(array.ptr)->view();
+        CHECK(view.shape() == std::vector<size_t>{1, 3, 2, 4});
+    }
+
+    SECTION("swap axes values") {
+        auto view = static_cast<SimpleDataArray*>(array.ptr)->view();
+        view(1, 2, 3) = 7;
+        view(0, 1, 2) = 3;
+
+        auto status = array.swap_axes(array.ptr, 0, 2);
+        CHECK(status == MTS_SUCCESS);
+
+        view = static_cast<SimpleDataArray*>(array.ptr)->view();
+        CHECK(view.shape() == std::vector<size_t>{4, 3, 2});
+        CHECK(view(3, 2, 1) == 7);
+        CHECK(view(2, 1, 0) == 3);
     }
 
     SECTION("new arrays") {
@@ -105,3 +185,79 @@ TEST_CASE("Data Array") {
 
     array.destroy(array.ptr);
 }
+
+TEST_CASE("Array pool") {
+    auto pool = std::make_shared<ArrayPool>();
+
+    SECTION("re-use memory") {
+        auto array = std::unique_ptr<SimpleDataArray>(new SimpleDataArray({3, 4}, pool));
+        CHECK(array->pool() == pool);
+        CHECK(pool->available() == 0);
+
+        auto view = array->view();
+        view(2, 3) = 42;
+        const double* data_ptr = view.data();
+
+        array.reset();
+        CHECK(pool->available() == 1);
+
+        // zero-initialized arrays re-use the memory
+        array = std::unique_ptr<SimpleDataArray>(new SimpleDataArray({2, 3}, pool));
+        CHECK(pool->available() == 0);
+        view = array->view();
+        CHECK(view.data() == data_ptr);
+        CHECK(view(1, 2) == 0);
+
+        array.reset();
+
+        // uninitialized arrays keep the previous values
+        array = std::unique_ptr<SimpleDataArray>(new SimpleDataArray({2, 3}, pool, false));
+        view = array->view();
+        CHECK(view.data() == data_ptr);
+        array.reset();
+
+        // arrays which don't fit in any buffer get new memory
+        array = std::unique_ptr<SimpleDataArray>(new SimpleDataArray({4, 4}, pool));
+        CHECK(pool->available() == 1);
+        array.reset();
+        CHECK(pool->available() == 2);
+
+        pool->clear();
+        CHECK(pool->available() == 0);
+    }
+
+    SECTION("created arrays") {
+        auto array = std::unique_ptr<SimpleDataArray>(new SimpleDataArray({3, 4}, pool));
+        auto view = array->view();
+        view(1, 2) = 3;
+
+        auto copy = array->copy();
+        auto& copy_array = dynamic_cast<SimpleDataArray&>(*copy);
+        CHECK(copy_array.pool() == pool);
+        view = copy_array.view();
+        CHECK(view(1, 2) == 3);
+
+        auto created = array->create({5, 2});
+        CHECK(dynamic_cast<SimpleDataArray&>(*created).pool() == pool);
+
+        array->swap_axes(0, 1);
+        view = array->view();
+        CHECK(view(2, 1) == 3);
+        CHECK(pool->available() == 1);
+
+        copy.reset();
+        created.reset();
+        array.reset();
+        CHECK(pool->available() == 4);
+    }
+
+    SECTION("maximal size") {
+        pool = std::make_shared<ArrayPool>(1);
+        auto array_1 = std::unique_ptr<SimpleDataArray>(new SimpleDataArray({3, 4}, pool));
+        auto array_2 = std::unique_ptr<SimpleDataArray>(new SimpleDataArray({3, 4}, pool));
+
+        array_1.reset();
+        array_2.reset();
+        CHECK(pool->available() == 1);
+    }
+}
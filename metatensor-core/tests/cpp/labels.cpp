@@ -42,6 +42,18 @@ TEST_CASE("Labels") {
         "invalid parameter: expected label of size 2 in mts_labels_position, got size 3"
     );
 
+    auto entries = Labels({"foo", "bar"}, {{5, 6}, {1, 4}, {1, 2}});
+    CHECK(labels.positions(entries.values()) == std::vector<int64_t>{2, -1, 0});
+
+    auto raw_entries = std::vector<int32_t>{3, 4, 3, 4};
+    CHECK(labels.positions(raw_entries.data(), 2, 2) == std::vector<int64_t>{1, 1});
+    CHECK(labels.positions(nullptr, 0, 2).empty());
+
+    CHECK_THROWS_WITH(
+        labels.positions(raw_entries.data(), 1, 4),
+        "invalid parameter: expected entries of size 2 in mts_labels_positions, got size 4"
+    );
+
     CHECK_THROWS_WITH(Labels({"foo"}, {{1}, {3, 4}}), "invalid size for row: expected 1 got 2");
 
     CHECK_THROWS_WITH(
@@ -57,6 +69,95 @@ TEST_CASE("Labels") {
 }
 
 
+TEST_CASE("Labels entry") {
+    auto labels = Labels({"foo", "bar"}, {{1, 2}, {3, 4}, {5, 6}});
+    auto other = Labels({"foo", "bar"}, {{5, 6}, {1, 4}});
+
+    auto entry = labels.entry(1);
+    CHECK(entry.shape()[0] == 2);
+    CHECK(entry(0) == 3);
+    CHECK(entry(1) == 4);
+
+    CHECK(labels.position(other.entry(0)) == 2);
+    CHECK(labels.position(other.entry(1)) == -1);
+
+    CHECK_THROWS_WITH(
+        labels.entry(3),
+        "out of bounds entry in Labels::entry: the index is 3 but there are 3 entries"
+    );
+}
+
+TEST_CASE("Labels range_of") {
+    auto labels = Labels({"system", "atom"}, {{0, 0}, {0, 1}, {1, 0}, {1, 1}, {1, 2}, {3, 0}});
+    CHECK(labels.range_of({0}) == std::make_pair<size_t, size_t>(0, 2));
+    CHECK(labels.range_of({1}) == std::make_pair<size_t, size_t>(2, 5));
+    CHECK(labels.range_of({3}) == std::make_pair<size_t, size_t>(5, 6));
+    CHECK(labels.range_of({1, 1}) == std::make_pair<size_t, size_t>(3, 4));
+    CHECK(labels.range_of(std::vector<int32_t>{}) == std::make_pair<size_t, size_t>(0, 6));
+
+    // missing prefix in sorted labels
+    CHECK(labels.range_of({2}) == std::make_pair<size_t, size_t>(5, 5));
+
+    CHECK_THROWS_WITH(
+        labels.range_of({1, 1, 1}),
+        "invalid parameter: prefix contains 3 values, but these labels only have 2 dimensions"
+    );
+
+    auto unsorted = Labels({"system", "atom"}, {{1, 0}, {1, 1}, {0, 0}, {2, 0}, {0, 1}});
+    CHECK(unsorted.range_of({1}) == std::make_pair<size_t, size_t>(0, 2));
+    CHECK(unsorted.range_of({2}) == std::make_pair<size_t, size_t>(3, 4));
+    CHECK(unsorted.range_of({5}) == std::make_pair<size_t, size_t>(0, 0));
+
+    CHECK_THROWS_WITH(
+        unsorted.range_of({0}),
+        "invalid parameter: the entries matching this prefix are not contiguous in these Labels"
+    );
+}
+
+TEST_CASE("Labels assuming unique entries") {
+    auto labels = Labels({"foo", "bar"}, {{1, 2}, {3, 4}, {5, 6}}, assume_unique{});
+    CHECK(labels == Labels({"foo", "bar"}, {{1, 2}, {3, 4}, {5, 6}}));
+    CHECK(labels.position({3, 4}) == 1);
+
+    auto values = std::vector<int32_t>{1, 2, 3, 4};
+    labels = Labels({"foo", "bar"}, values.data(), 2, assume_unique{});
+    CHECK(labels == Labels({"foo", "bar"}, {{1, 2}, {3, 4}}));
+
+    CHECK_THROWS_WITH(
+        Labels({"not an ident"}, {{0}}, assume_unique{}),
+        "invalid parameter: 'not an ident' is not a valid label name"
+    );
+}
+
+TEST_CASE("Labels borrowing values") {
+    static int DELETED = 0;
+    auto* values = new std::vector<int32_t>{1, 2, 3, 4, 5, 6};
+    auto delete_values = [](void* ptr) {
+        DELETED += 1;
+        delete static_cast<std::vector<int32_t>*>(ptr);
+    };
+
+    {
+        auto labels = Labels::borrowed({"foo", "bar"}, values->data(), 3, values, delete_values);
+        CHECK(labels == Labels({"foo", "bar"}, {{1, 2}, {3, 4}, {5, 6}}));
+        CHECK(labels.position({3, 4}) == 1);
+        // the values are not copied
+        CHECK(labels.values().data() == values->data());
+
+        auto copy = labels;
+        labels = Labels({"foo"});
+        CHECK(DELETED == 0);
+    }
+    CHECK(DELETED == 1);
+
+    auto duplicated = std::vector<int32_t>{1, 2, 1, 2};
+    CHECK_THROWS_WITH(
+        Labels::borrowed({"foo", "bar"}, duplicated.data(), 2, nullptr, delete_values),
+        "invalid parameter: can not have the same label entry multiple time: [1, 2] is already present"
+    );
+    CHECK(DELETED == 1);
+}
+
 TEST_CASE("Set operations") {
     SECTION("union") {
         auto first = Labels({"aa", "bb"}, {{0, 1}, {1, 2}});
@@ -282,4 +383,24 @@ TEST_CASE("Serialization") {
 
         std::free(raw_buffer);
     }
+
+    SECTION("Save into an existing buffer") {
+        auto labels = Labels({"a", "b"}, {{0, 1}, {3, 4}, {5, 6}});
+        auto reference = labels.save_buffer();
+
+        auto size = metatensor::io::serialized_size(labels);
+        CHECK(size == reference.size());
+
+        auto buffer = std::vector<uint8_t>(size, 0);
+        auto written = metatensor::io::save_into_buffer(labels, buffer.data(), buffer.size());
+        REQUIRE(written == size);
+        CHECK(buffer == reference);
+
+        CHECK_THROWS_WITH(
+            metatensor::io::save_into_buffer(labels, buffer.data(), 10),
+            "buffer is not big enough: the buffer of 10 bytes is too small to "
+            "contain the serialized labels, use the corresponding "
+            "`*_serialized_size` function to get the required size"
+        );
+    }
 }
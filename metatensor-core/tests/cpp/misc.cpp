@@ -1,3 +1,5 @@
+#include <vector>
+
 #include <catch.hpp>
 
 #include "metatensor.h"
@@ -13,3 +15,27 @@ TEST_CASE("Version macros") {
     // METATENSOR_VERSION should start with `x.y.z`
     CHECK(std::string(METATENSOR_VERSION).find(version) == 0);
 }
+
+TEST_CASE("Profiling counters") {
+    uintptr_t count = 0;
+    CHECK(mts_profiling_get(nullptr, &count) == MTS_SUCCESS);
+
+    mts_profiling_reset();
+
+    auto entries = std::vector<mts_profiling_entry_t>(count);
+    CHECK(mts_profiling_get(entries.data(), &count) == MTS_SUCCESS);
+    CHECK(count == entries.size());
+
+    for (const auto& entry: entries) {
+        CHECK(std::string(entry.name) != "");
+        CHECK(entry.calls == 0);
+        CHECK(entry.time_ns == 0);
+        CHECK(entry.bytes == 0);
+    }
+
+    if (count != 0) {
+        // the buffer is too small
+        count -= 1;
+        CHECK(mts_profiling_get(entries.data(), &count) == MTS_BUFFER_SIZE_ERROR);
+    }
+}
@@ -1,6 +1,9 @@
 #include <fstream>
 #include <sstream>
+#include <cstdio>
 #include <cstdlib>
+#include <numeric>
+#include <cmath>
 
 #include <catch.hpp>
 
@@ -9,9 +12,11 @@ using namespace metatensor;
 
 static TensorMap test_tensor_map();
 static mts_status_t custom_create_array(const uintptr_t* shape_ptr, uintptr_t shape_count, mts_array_t *array);
+static mts_status_t custom_create_mmap_array(const uintptr_t* shape_ptr, uintptr_t shape_count, double* data, mts_mmap_t* mmap, mts_array_t *array);
 static void check_loaded_tensor(metatensor::TensorMap& tensor);
 
 static int CUSTOM_CREATE_ARRAY_CALL_COUNT = 0;
+static int CUSTOM_CREATE_MMAP_ARRAY_CALL_COUNT = 0;
 
 TEST_CASE("TensorMap") {
     SECTION("keys") {
@@ -157,6 +162,37 @@ TEST_CASE("TensorMap") {
         CHECK(values_3 == SimpleDataArray({4, 3, 1}, 4.0));
     }
 
+    SECTION("keys_to_properties and keys_to_samples with multiple threads") {
+        auto reference_properties = test_tensor_map().keys_to_properties("key_1");
+        auto reference_samples = test_tensor_map().keys_to_samples("key_2");
+
+        CHECK(metatensor::get_num_threads() == 1);
+        metatensor::set_num_threads(4);
+        CHECK(metatensor::get_num_threads() == 4);
+
+        auto check_same = [](TensorMap& actual, TensorMap& expected) {
+            CHECK(actual.keys() == expected.keys());
+            for (size_t i=0; i<expected.keys().count(); i++) {
+                auto actual_block = actual.block_by_id(i);
+                auto expected_block = expected.block_by_id(i);
+                CHECK(actual_block.samples() == expected_block.samples());
+                CHECK(actual_block.properties() == expected_block.properties());
+
+                const auto& actual_values = SimpleDataArray::from_mts_array(actual_block.mts_array());
+                const auto& expected_values = SimpleDataArray::from_mts_array(expected_block.mts_array());
+                CHECK(actual_values == expected_values);
+            }
+        };
+
+        auto properties = test_tensor_map().keys_to_properties("key_1");
+        check_same(properties, reference_properties);
+
+        auto samples = test_tensor_map().keys_to_samples("key_2");
+        check_same(samples, reference_samples);
+
+        metatensor::set_num_threads(1);
+    }
+
     SECTION("component_to_properties") {
         auto tensor = test_tensor_map().components_to_properties("component");
 
@@ -170,6 +206,49 @@ TEST_CASE("TensorMap") {
         CHECK(block.properties() == Labels({"component", "properties"}, {{0, 0}}));
     }
 
+    SECTION("split_samples and merge_samples") {
+        auto tensor = test_tensor_map();
+
+        // even samples go to the first shard, odd samples to the second one
+        auto shards = tensor.split_samples("samples", {0, 1, 0, 1, 0, 1, 0, 1, 0}, 2);
+        REQUIRE(shards.size() == 2);
+
+        CHECK(shards[0].keys() == tensor.keys());
+        CHECK(shards[1].keys() == tensor.keys());
+
+        auto block = shards[0].block_by_id(0);
+        CHECK(block.samples() == Labels({"samples"}, {{0}, {2}, {4}}));
+        CHECK(shards[1].block_by_id(0).samples().count() == 0);
+
+        block = shards[0].block_by_id(1);
+        CHECK(block.samples() == Labels({"samples"}, {{0}}));
+        CHECK(block.gradient("parameter").samples() == Labels({"sample", "parameter"}, {{0, -2}, {0, 3}}));
+
+        block = shards[1].block_by_id(1);
+        CHECK(block.samples() == Labels({"samples"}, {{1}, {3}}));
+        CHECK(SimpleDataArray::from_mts_array(block.mts_array()) == SimpleDataArray({2, 1, 3}, 2.0));
+
+        auto gradient = block.gradient("parameter");
+        CHECK(gradient.samples() == Labels({"sample", "parameter"}, {{1, -2}}));
+        CHECK(SimpleDataArray::from_mts_array(gradient.mts_array()) == SimpleDataArray({1, 1, 3}, 12.0));
+
+        auto merged = TensorMap::merge_samples(shards);
+        CHECK(merged.keys() == tensor.keys());
+
+        block = merged.block_by_id(1);
+        CHECK(block.samples() == Labels({"samples"}, {{0}, {1}, {3}}));
+        CHECK(block.gradient("parameter").samples() == Labels({"sample", "parameter"}, {{0, -2}, {0, 3}, {2, -2}}));
+
+        block = merged.block_by_id(3);
+        CHECK(block.samples() == Labels({"samples"}, {{0}, {2}, {1}, {5}}));
+        CHECK(block.gradient("parameter").samples() == Labels({"sample", "parameter"}, {{0, 1}, {3, 3}}));
+
+        CHECK_THROWS_WITH(
+            tensor.split_samples("samples", {0, 2}, 2),
+            "invalid parameter: the shard for value 1 of 'samples' is 2, but there are only 2 shards"
+        );
+    }
+
     SECTION("clone") {
         auto blocks = std::vector<TensorBlock>();
         blocks.push_back(TensorBlock(
@@ -225,6 +304,10 @@ TEST_CASE("TensorMap serialization") {
 
         tensor = metatensor::io::load(TEST_DATA_NPZ_PATH);
         check_loaded_tensor(tensor);
+
+        // files written before the data was aligned can still be loaded
+        tensor = TensorMap::load(TEST_DATA_UNALIGNED_NPZ_PATH);
+        check_loaded_tensor(tensor);
     }
 
     SECTION("loading file with custom array creation") {
@@ -238,6 +321,237 @@ TEST_CASE("TensorMap serialization") {
         CHECK(CUSTOM_CREATE_ARRAY_CALL_COUNT == 27 * 2);
     }
 
+    SECTION("loading file with multiple threads") {
+        auto reference = TensorMap::load(TEST_DATA_NPZ_PATH);
+
+        auto options = metatensor::io::LoadOptions();
+        options.threads = 4;
+        auto tensor = TensorMap::load(TEST_DATA_NPZ_PATH, details::default_create_array, options);
+        check_loaded_tensor(tensor);
+
+        // blocks are in the same order as when loading sequentially
+        REQUIRE(tensor.keys() == reference.keys());
+        for (size_t i = 0; i < reference.keys().count(); i++) {
+            auto block = tensor.block_by_id(i);
+            auto expected = reference.block_by_id(i);
+            CHECK(block.samples() == expected.samples());
+            CHECK(block.properties() == expected.properties());
+            CHECK(block.values() == expected.values());
+            CHECK(block.gradients_list() == expected.gradients_list());
+        }
+
+        auto buffer = metatensor::io::save_buffer(reference);
+        tensor = metatensor::io::load_buffer(buffer, details::default_create_array, options);
+        check_loaded_tensor(tensor);
+
+        // more threads than blocks
+        options.threads = 100;
+        tensor = metatensor::io::load_buffer(buffer, details::default_create_array, options);
+        check_loaded_tensor(tensor);
+    }
+
+    SECTION("loading file with mmap") {
+        CHECK(CUSTOM_CREATE_MMAP_ARRAY_CALL_COUNT == 0);
+        auto tensor = TensorMap::load_mmap(TEST_DATA_NPZ_PATH, custom_create_mmap_array);
+        check_loaded_tensor(tensor);
+        // all the arrays are aligned in the file, and can be used in-place
+        CHECK(CUSTOM_CREATE_MMAP_ARRAY_CALL_COUNT == 27 * 2);
+
+        CUSTOM_CREATE_MMAP_ARRAY_CALL_COUNT = 0;
+        tensor = metatensor::io::load_mmap(TEST_DATA_NPZ_PATH, custom_create_mmap_array);
+        check_loaded_tensor(tensor);
+        CHECK(CUSTOM_CREATE_MMAP_ARRAY_CALL_COUNT == 27 * 2);
+
+        // in files written before the data was aligned, most arrays are not
+        // aligned and are copied instead of used in-place
+        CUSTOM_CREATE_MMAP_ARRAY_CALL_COUNT = 0;
+        tensor = TensorMap::load_mmap(TEST_DATA_UNALIGNED_NPZ_PATH, custom_create_mmap_array);
+        check_loaded_tensor(tensor);
+        CHECK(CUSTOM_CREATE_MMAP_ARRAY_CALL_COUNT < 27 * 2);
+
+        auto reference = TensorMap::load(TEST_DATA_NPZ_PATH);
+        REQUIRE(tensor.keys() == reference.keys());
+        for (size_t i = 0; i < reference.keys().count(); i++) {
+            auto block = tensor.block_by_id(i);
+            auto expected = reference.block_by_id(i);
+            CHECK(block.values() == expected.values());
+
+            auto gradient = block.gradient("positions");
+            auto expected_gradient = expected.gradient("positions");
+            CHECK(gradient.values() == expected_gradient.values());
+        }
+    }
+
+    SECTION("lazy loading with TensorMapReader") {
+        CUSTOM_CREATE_ARRAY_CALL_COUNT = 0;
+        auto reader = metatensor::TensorMapReader(TEST_DATA_NPZ_PATH, custom_create_array);
+        // opening the reader does not load any block
+        CHECK(CUSTOM_CREATE_ARRAY_CALL_COUNT == 0);
+
+        auto keys = reader.keys();
+        CHECK(keys.count() == 27);
+
+        auto block = reader.block(21);
+        auto values = block.values();
+        CHECK(values.shape() == std::vector<size_t>{9, 5, 3});
+        auto gradient = block.gradient("positions");
+        values = gradient.values();
+        CHECK(values.shape() == std::vector<size_t>{59, 3, 5, 3});
+        // values and positions gradients for a single block
+        CHECK(CUSTOM_CREATE_ARRAY_CALL_COUNT == 2);
+
+        const auto& key_values = keys.values();
+        auto selection = Labels(
+            {"o3_lambda", "o3_sigma", "center_type", "neighbor_type"},
+            {{key_values(21, 0), key_values(21, 1), key_values(21, 2), key_values(21, 3)}}
+        );
+        block = reader.block(selection);
+        values = block.values();
+        CHECK(values.shape() == std::vector<size_t>{9, 5, 3});
+
+        auto tensor = TensorMap::load(TEST_DATA_NPZ_PATH);
+        selection = Labels({"center_type"}, {{key_values(21, 2)}});
+        auto matching = reader.blocks_matching(selection);
+        CHECK(matching == tensor.blocks_matching(selection));
+
+        auto partial = reader.load(selection);
+        CHECK(partial.keys().count() == matching.size());
+        for (size_t i=0; i<matching.size(); i++) {
+            auto expected_block = tensor.block_by_id(matching[i]);
+            auto expected = expected_block.values();
+            block = partial.block_by_id(i);
+            values = block.values();
+            CHECK(values.shape() == expected.shape());
+        }
+
+        CHECK_THROWS_WITH(
+            reader.block(27),
+            "invalid parameter: block index out of bounds: we have 27 blocks but the index is 27"
+        );
+    }
+
+    SECTION("streaming save with TensorMapWriter") {
+        const auto* path = "test-tensor-map-writer.npz";
+
+        auto tensor = TensorMap::load(TEST_DATA_NPZ_PATH);
+        auto keys = tensor.keys();
+        const auto& key_values = keys.values();
+        auto key_names = std::vector<std::string>(keys.names().begin(), keys.names().end());
+
+        auto writer = TensorMapWriter(path, key_names);
+        for (size_t i=0; i<keys.count(); i++) {
+            auto key = std::vector<int32_t>();
+            for (size_t j=0; j<keys.size(); j++) {
+                key.push_back(key_values(i, j));
+            }
+            writer.append(key, tensor.block_by_id(i).clone());
+        }
+        writer.finish();
+
+        auto loaded = TensorMap::load(path);
+        check_loaded_tensor(loaded);
+
+        // appending samples to the last block
+        auto create_block = [](std::vector<int32_t> samples, double value) {
+            auto n_samples = samples.size();
+            return TensorBlock(
+                std::unique_ptr<SimpleDataArray>(new SimpleDataArray({n_samples, 2}, value)),
+                Labels({"samples"}, samples.data(), n_samples),
+                {},
+                Labels({"properties"}, {{0}, {1}})
+            );
+        };
+
+        writer = TensorMapWriter(path, {"key"});
+        writer.append({0}, create_block({0, 1}, 1.0));
+        writer.append({0}, create_block({2}, 2.0));
+        writer.append({0}, create_block({3}, 5.0));
+
+        CHECK_THROWS_WITH(
+            writer.append({0}, TensorBlock(
+                std::unique_ptr<SimpleDataArray>(new SimpleDataArray({1, 3})),
+                Labels({"samples"}, {{6}}),
+                {},
+                Labels({"properties"}, {{0}, {1}, {2}})
+            )),
+            "invalid parameter: can not append samples to an existing block with different properties"
+        );
+
+        writer.append({1}, create_block({0}, 3.0));
+        CHECK_THROWS_WITH(
+            writer.append({0}, create_block({4}, 4.0)),
+            "invalid parameter: a block for the key (0) was already written, "
+            "all samples for a given key must be appended one after the other"
+        );
+        writer.append({1}, create_block({4, 5}, 4.0));
+
+        writer.finish();
+        CHECK_THROWS_WITH(
+            writer.finish(),
+            "invalid parameter: this tensor map writer has already been finished"
+        );
+
+        loaded = TensorMap::load(path);
+        CHECK(loaded.keys() == Labels({"key"}, {{0}, {1}}));
+
+        auto block = loaded.block_by_id(0);
+        CHECK(block.samples() == Labels({"samples"}, {{0}, {1}, {2}, {3}}));
+        auto values = block.values();
+        CHECK(values(0, 0) == 1.0);
+        CHECK(values(1, 1) == 1.0);
+        CHECK(values(2, 0) == 2.0);
+        CHECK(values(3, 1) == 5.0);
+
+        block = loaded.block_by_id(1);
+        CHECK(block.samples() == Labels({"samples"}, {{0}, {4}, {5}}));
+        values = block.values();
+        CHECK(values(0, 0) == 3.0);
+        CHECK(values(1, 0) == 4.0);
+        CHECK(values(2, 1) == 4.0);
+
+        // the same sample can not be appended twice for a given key, this is
+        // reported when the block is written
+        writer = TensorMapWriter(path, {"key"});
+        writer.append({0}, create_block({0, 1}, 1.0));
+        writer.append({0}, create_block({1}, 2.0));
+        CHECK_THROWS_WITH(
+            writer.append({1}, create_block({0}, 3.0)),
+            "invalid parameter: can not append samples to the block for key (0): "
+            "some of the samples were appended multiple times"
+        );
+
+        // blocks are written to the file as soon as a block with a different
+        // key is appended, instead of being kept in memory until `finish()`
+        auto file_size = [](const char* file_path) {
+            auto file = std::ifstream(file_path, std::ios::binary | std::ios::ate);
+            return static_cast<size_t>(file.tellg());
+        };
+
+        auto large_samples = std::vector<int32_t>(5000);
+        std::iota(large_samples.begin(), large_samples.end(), 0);
+        // size of the values of a single large block, in bytes
+        auto large_block_size = large_samples.size() * 2 * sizeof(double);
+
+        writer = TensorMapWriter(path, {"key"});
+        writer.append({0}, create_block(large_samples, 1.0));
+        writer.append({0}, create_block({6000}, 1.0));
+        CHECK(file_size(path) < large_block_size);
+
+        writer.append({1}, create_block(large_samples, 2.0));
+        CHECK(file_size(path) > large_block_size);
+        CHECK(file_size(path) < 2 * large_block_size);
+
+        writer.append({2}, create_block(large_samples, 3.0));
+        CHECK(file_size(path) > 2 * large_block_size);
+
+        writer.finish();
+        loaded = TensorMap::load(path);
+        CHECK(loaded.keys() == Labels({"key"}, {{0}, {1}, {2}}));
+        CHECK(loaded.block_by_id(0).samples().count() == large_samples.size() + 1);
+
+        std::remove(path);
+    }
+
     SECTION("Load/Save with buffers") {
         // read the whole file into a buffer
         std::ifstream file(TEST_DATA_NPZ_PATH, std::ios::binary);
@@ -275,6 +589,113 @@ TEST_CASE("TensorMap serialization") {
 
         std::free(raw_buffer);
     }
+
+    SECTION("Save into an existing buffer") {
+        auto tensor = TensorMap::load(TEST_DATA_NPZ_PATH);
+        auto reference = tensor.save_buffer();
+
+        auto size = metatensor::io::serialized_size(tensor);
+        CHECK(size == reference.size());
+
+        auto buffer = std::vector<uint8_t>(size + 10, 0);
+        auto written = metatensor::io::save_into_buffer(tensor, buffer.data(), buffer.size());
+        REQUIRE(written == size);
+        buffer.resize(written);
+        CHECK(buffer == reference);
+
+        auto options = io::SaveOptions();
+        options.compression = io::Compression::Deflate;
+        reference = tensor.save_buffer(options);
+        size = metatensor::io::serialized_size(tensor, options);
+        CHECK(size == reference.size());
+
+        buffer = std::vector<uint8_t>(size, 0);
+        written = metatensor::io::save_into_buffer(tensor, buffer.data(), buffer.size(), options);
+        REQUIRE(written == size);
+        CHECK(buffer == reference);
+
+        auto block = tensor.block_by_id(0);
+        size = metatensor::io::serialized_size(block);
+        CHECK(size == block.save_buffer().size());
+
+        buffer = std::vector<uint8_t>(size, 0);
+        written = metatensor::io::save_into_buffer(block, buffer.data(), buffer.size());
+        CHECK(written == size);
+
+        buffer = std::vector<uint8_t>(100, 0);
+        CHECK_THROWS_WITH(
+            metatensor::io::save_into_buffer(tensor, buffer.data(), buffer.size()),
+            "buffer is not big enough: the buffer of 100 bytes is too small to "
+            "contain the serialized tensor map, use the corresponding "
+            "`*_serialized_size` function to get the required size"
+        );
+    }
+
+    SECTION("Save with compression and reduced precision") {
+        auto tensor = TensorMap::load(TEST_DATA_NPZ_PATH);
+        auto reference = tensor.save_buffer();
+
+        auto check_values = [&](TensorMap& loaded, double tolerance) {
+            for (size_t block_i=0; block_i<tensor.keys().count(); block_i++) {
+                auto expected_block = tensor.block_by_id(block_i);
+                auto expected = expected_block.values();
+                auto block = loaded.block_by_id(block_i);
+                auto values = block.values();
+
+                REQUIRE(values.shape() == expected.shape());
+                size_t size = 1;
+                for (auto dim: values.shape()) {
+                    size *= dim;
+                }
+
+                for (size_t i=0; i<size; i++) {
+                    auto diff = std::abs(values.data()[i] - expected.data()[i]);
+                    // the absolute tolerance accounts for subnormal float16
+                    CHECK(diff <= tolerance * std::abs(expected.data()[i]) + 1e-7);
+                }
+            }
+        };
+
+        auto options = io::SaveOptions();
+        options.compression = io::Compression::Deflate;
+        auto buffer = tensor.save_buffer(options);
+        CHECK(buffer.size() < reference.size());
+
+        auto loaded = TensorMap::load_buffer(buffer);
+        check_loaded_tensor(loaded);
+        check_values(loaded, 0.0);
+
+        options.storage_type = io::StorageType::Float32;
+        buffer = tensor.save_buffer(options);
+        loaded = TensorMap::load_buffer(buffer);
+        check_loaded_tensor(loaded);
+        check_values(loaded, 1e-7);
+
+        options.compression = io::Compression::None;
+        options.storage_type = io::StorageType::Float16;
+        buffer = tensor.save_buffer(options);
+        loaded = TensorMap::load_buffer(buffer);
+        check_loaded_tensor(loaded);
+        check_values(loaded, 1e-3);
+
+        // data stored with reduced precision can not be used in-place, but
+        // should still load with mmap
+        const auto* path = "test-tensor-map-float16.npz";
+        tensor.save(path, options);
+        CUSTOM_CREATE_MMAP_ARRAY_CALL_COUNT = 0;
+        loaded = TensorMap::load_mmap(path, custom_create_mmap_array);
+        CHECK(CUSTOM_CREATE_MMAP_ARRAY_CALL_COUNT == 0);
+        check_values(loaded, 1e-3);
+
+        std::remove(path);
+
+        // invalid options are rejected by the C API
+        auto c_options = mts_save_options_t();
+        c_options.compression = 42;
+        c_options.storage_type = MTS_STORAGE_FLOAT64;
+        auto status = mts_tensormap_save_with_options(path, tensor.as_mts_tensormap_t(), c_options);
+        CHECK(status == MTS_INVALID_PARAMETER_ERROR);
+    }
 }
 
 
@@ -373,6 +794,34 @@ mts_status_t custom_create_array(const uintptr_t* shape_ptr, uintptr_t shape_cou
     return MTS_SUCCESS;
 }
 
+mts_status_t custom_create_mmap_array(const uintptr_t* shape_ptr, uintptr_t shape_count, double* data, mts_mmap_t* mmap, mts_array_t *array) {
+    auto shape = std::vector<size_t>();
+    for (size_t i=0; i<shape_count; i++) {
+        shape.push_back(static_cast<size_t>(shape_ptr[i]));
+    }
+
+    auto cxx_array = std::unique_ptr<DataArrayBase>(nullptr);
+    if (data != nullptr) {
+        CUSTOM_CREATE_MMAP_ARRAY_CALL_COUNT += 1;
+
+        // copy the data, this is enough to check that the mapped data is
+        // correct
+        auto size = details::product(shape);
+        cxx_array.reset(new SimpleDataArray(shape, std::vector<double>(data, data + size)));
+
+        auto status = mts_mmap_free(mmap);
+        if (status != MTS_SUCCESS) {
+            return status;
+        }
+    } else {
+        cxx_array.reset(new SimpleDataArray(shape));
+    }
+
+    *array = DataArrayBase::to_mts_array_t(std::move(cxx_array));
+
+    return MTS_SUCCESS;
+}
+
 void check_loaded_tensor(metatensor::TensorMap& tensor) {
     auto keys = tensor.keys();
     CHECK(keys.names().size() == 4);
@@ -5,4 +5,7 @@
 #include "metatensor/torch/labels.hpp"  // IWYU pragma: export
 #include "metatensor/torch/block.hpp"   // IWYU pragma: export
 #include "metatensor/torch/tensor.hpp"  // IWYU pragma: export
+#include "metatensor/torch/reader.hpp"  // IWYU pragma: export
+#include "metatensor/torch/loader.hpp"  // IWYU pragma: export
 #include "metatensor/torch/misc.hpp"    // IWYU pragma: export
+#include "metatensor/torch/operations.hpp"  // IWYU pragma: export
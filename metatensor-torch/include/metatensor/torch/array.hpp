@@ -1,6 +1,10 @@
 #ifndef METATENSOR_TORCH_ARRAY_HPP
 #define METATENSOR_TORCH_ARRAY_HPP
 
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <tuple>
 #include <vector>
 
 #include <torch/script.h>
@@ -15,7 +19,16 @@ namespace metatensor_torch {
 extern mts_data_origin_t TORCH_DATA_ORIGIN;
 
 /// An `metatensor::DataArrayBase` implementation using `torch::Tensor` to store
-/// the data
+/// the data.
+///
+/// The tensor can either be a dense (strided) tensor, or a sparse COO tensor
+/// without dense dimensions. Sparse tensors stay sparse when creating new
+/// arrays, moving samples between arrays (in `keys_to_properties` and
+/// `keys_to_samples`), reshaping and swapping axes; and only the non-zero
+/// entries are stored and moved around. Raw access to the data (`data()` and
+/// `typed_data()`) is not available for sparse tensors: the serialization
+/// functions of metatensor-torch give a dense copy of these arrays to
+/// metatensor-core instead, so sparse values are saved as dense arrays.
 class METATENSOR_TORCH_EXPORT TorchDataArray: public metatensor::DataArrayBase {
 public:
     /// Create a `TorchDataArray` containing the given `tensor`
@@ -42,6 +55,14 @@ public:
         return tensor_;
     }
 
+    /// Get the index from the samples of a parent block to the rows of this
+    /// array (when this array contains gradients), calling `compute` to create
+    /// it the first time this function is called. The index is cached inside
+    /// the array, and this function can be called from multiple threads.
+    std::tuple<torch::Tensor, torch::Tensor> sample_index(
+        const std::function<std::tuple<torch::Tensor, torch::Tensor>()>& compute
+    );
+
     /*========================================================================*/
     /*          Functions to implement metatensor::DataArrayBase               */
     /*========================================================================*/
@@ -52,12 +73,25 @@ public:
 
     std::unique_ptr<metatensor::DataArrayBase> create(std::vector<uintptr_t> shape) const override;
 
+    /// Get a pointer to the data of the tensor. This throws an error for
+    /// sparse tensors and for non-contiguous tensors (for example after
+    /// `swap_axes()`), the tensor is never modified by this function.
     double* data() & override;
 
+    int32_t dtype() const override;
+
+    /// Get a pointer to the data of the tensor, as elements of type `dtype`.
+    /// This throws an error for sparse and non-contiguous tensors.
+    void* typed_data(int32_t dtype) & override;
+
     const std::vector<uintptr_t>& shape() const & override;
 
+    bool is_contiguous() const override;
+
+    /// Reshape the tensor, returning a view of the data when possible
     void reshape(std::vector<uintptr_t> shape) override;
 
+    /// Swap two axes of the tensor, keeping a (non-contiguous) view of the data
     void swap_axes(uintptr_t axis_1, uintptr_t axis_2) override;
 
     void move_samples_from(
@@ -73,8 +107,26 @@ private:
     std::vector<uintptr_t> shape_;
     void update_shape();
 
+    /// Implementation of `move_samples_from` for a sparse `tensor_`, adding
+    /// the non-zero entries of `input` to the ones already there.
+    void move_sparse_samples_from(
+        const torch::Tensor& input,
+        const torch::Tensor& input_samples,
+        const torch::Tensor& output_samples,
+        uintptr_t property_start
+    );
+
     // the actual data
     torch::Tensor tensor_;
+
+    struct SampleIndexCache {
+        std::once_flag once;
+        std::tuple<torch::Tensor, torch::Tensor> index;
+    };
+    // cached result of `sample_index`. The index only depends on the samples
+    // of the block containing this array, which can not change once the
+    // block is created.
+    std::shared_ptr<SampleIndexCache> sample_index_;
 };
 
 }
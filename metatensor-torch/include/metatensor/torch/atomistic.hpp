@@ -1,2 +1,3 @@
 #include "metatensor/torch/atomistic/system.hpp"   // IWYU pragma: export
 #include "metatensor/torch/atomistic/model.hpp"    // IWYU pragma: export
+#include "metatensor/torch/atomistic/runner.hpp"   // IWYU pragma: export
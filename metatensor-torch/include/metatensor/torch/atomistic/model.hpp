@@ -222,6 +222,19 @@ public:
     /// Setter for `selected_atoms`
     void set_selected_atoms(torch::optional<TorchLabels> selected_atoms);
 
+    /// dtype of the distance vectors in the neighbor lists given to the model,
+    /// for mixed-precision calculations. If this is an empty string, the
+    /// neighbor lists use the same dtype as the systems. Otherwise, this must
+    /// be one of `"float16"`, `"bfloat16"` or `"float32"`, with lower precision
+    /// than the systems; while positions, cell and outputs keep the dtype of
+    /// the systems.
+    const std::string& neighbors_dtype() const {
+        return neighbors_dtype_;
+    }
+
+    /// Setter for `neighbors_dtype`
+    void set_neighbors_dtype(std::string dtype);
+
     /// Serialize a `ModelEvaluationOptions` to a JSON string.
     std::string to_json() const;
     /// Load a serialized `ModelEvaluationOptions` from a JSON string.
@@ -230,6 +243,7 @@ public:
 private:
     std::string length_unit_;
     torch::optional<TorchLabels> selected_atoms_ = torch::nullopt;
+    std::string neighbors_dtype_;
 };
 
 
@@ -314,9 +328,9 @@ METATENSOR_TORCH_EXPORT void load_model_extensions(
 
 /// Check and then load the metatensor atomistic model at the given `path`.
 ///
-/// This function calls `check_atomistic_model(path)` and
-/// `load_model_extensions(path, extension_directory)` before attempting to load
-/// the model.
+/// This function does the same as `load_model_extensions(path,
+/// extension_directory)` and `check_atomistic_model(path)` before loading the
+/// model, but only opens the file once for all these steps.
 METATENSOR_TORCH_EXPORT torch::jit::Module load_atomistic_model(
     std::string path,
     c10::optional<std::string> extensions_directory = c10::nullopt
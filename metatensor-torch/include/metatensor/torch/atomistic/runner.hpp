@@ -0,0 +1,198 @@
+#ifndef METATENSOR_TORCH_ATOMISTIC_RUNNER_HPP
+#define METATENSOR_TORCH_ATOMISTIC_RUNNER_HPP
+
+#include <string>
+#include <vector>
+
+#include <torch/script.h>
+
+#include "metatensor/torch/exports.h"
+#include "metatensor/torch/atomistic/system.hpp"
+#include "metatensor/torch/atomistic/model.hpp"
+
+namespace metatensor_torch {
+
+/// Options used to create a `ModelRunner`
+struct METATENSOR_TORCH_EXPORT ModelRunnerOptions {
+    /// Directory containing the extensions used by the model, see
+    /// `load_atomistic_model`
+    torch::optional<std::string> extensions_directory = torch::nullopt;
+    /// Device to use for the calculations. If this is not set, the first
+    /// device in the model's `supported_devices` which is available is used.
+    torch::optional<torch::Device> device = torch::nullopt;
+    /// Unit of length used by the engine for positions and cell
+    std::string length_unit = "angstrom";
+    /// Unit of energy used by the engine
+    std::string energy_unit = "eV";
+    /// Skin used by the neighbor lists caches (in `length_unit`). The neighbor
+    /// lists are re-computed from scratch at every step if this is 0.
+    double neighbor_skin = 0.0;
+    /// Should we run additional checks on the inputs and outputs of the model?
+    bool check_consistency = false;
+    /// Use static shapes for the calculation, to allow capturing it in a CUDA
+    /// graph. In this mode, the inputs are only validated when the number of
+    /// atoms changes or after `ModelRunner::reset`, `check_consistency` only
+    /// applies to these steps, and the neighbor lists are computed with
+    /// `NeighborListCacheHolder::update_static`. The engine is then
+    /// responsible for calling `ModelRunner::reset` when
+    /// `ModelRunner::needs_rebuild` is true.
+    bool static_shapes = false;
+    /// dtype of the distance vectors in the neighbor lists, for mixed-precision
+    /// calculations (see `ModelEvaluationOptionsHolder::neighbors_dtype`).
+    /// This must be an empty string, or a floating point dtype with lower
+    /// precision than the model dtype.
+    std::string neighbors_dtype = "";
+};
+
+/// Results of a single `ModelRunner::compute` call. All tensors are on the
+/// device and have the dtype used by the model.
+struct METATENSOR_TORCH_EXPORT ModelRunnerResults {
+    /// Total energy of the system, as a 0-dimensional tensor. Use
+    /// `energy.item<double>()` to get the corresponding value on the host.
+    torch::Tensor energy;
+    /// Forces acting on all atoms, as a `(n_atoms, 3)` tensor. This is
+    /// undefined if forces were not requested.
+    torch::Tensor forces;
+    /// Virial of the system, as a `(3, 3)` tensor. This is undefined if the
+    /// virial was not requested.
+    torch::Tensor virial;
+};
+
+/// Run an exported atomistic model to compute the energy, forces and virial
+/// of a single system, for use in simulation engines.
+///
+/// All the data which is constant from one step to the next is prepared once
+/// when creating the runner: the model is loaded and moved to the right
+/// device, its capabilities, requested neighbor lists and interaction range
+/// are stored, and the `ModelEvaluationOptions` for the energy output are
+/// created. The neighbor lists are computed with `NeighborListCacheHolder`,
+/// and the device buffers for positions and cell are re-used between calls
+/// to `compute` when the number of atoms does not change.
+///
+/// With `ModelRunnerOptions::static_shapes`, the steps where the number of
+/// atoms does not change do not synchronize with the device in this class,
+/// allowing to capture `compute` in a CUDA graph if the model itself does not
+/// synchronize.
+///
+/// This class is not thread-safe, but multiple instances can be used from
+/// different threads. These instances can share a single copy of the model
+/// weights by creating them from the same model, for example with
+/// `ModelRunner(other.model(), options)`.
+class METATENSOR_TORCH_EXPORT ModelRunner {
+public:
+    /// Load the atomistic model at `path`, and prepare to run it with the
+    /// given `options`
+    explicit ModelRunner(const std::string& path, ModelRunnerOptions options = {});
+
+    /// Prepare to run an already loaded atomistic `model` (see
+    /// `load_atomistic_model`) with the given `options`. The model is not
+    /// copied, and is shared with all the other users of the same
+    /// `torch::jit::Module`.
+    ///
+    /// The model is only moved to the selected device if some of its
+    /// parameters or buffers are not already there. All the runners sharing
+    /// a model should be created before any of them starts running
+    /// `compute`, and should use the same device.
+    /// `ModelRunnerOptions::extensions_directory` is ignored.
+    explicit ModelRunner(torch::jit::Module model, ModelRunnerOptions options = {});
+
+    ~ModelRunner() = default;
+
+    /// ModelRunner can not be copy-constructed
+    ModelRunner(const ModelRunner&) = delete;
+    /// ModelRunner can not be copy-assigned
+    ModelRunner& operator=(const ModelRunner&) = delete;
+    /// ModelRunner can be move-constructed
+    ModelRunner(ModelRunner&&) = default;
+    /// ModelRunner can be move-assigned
+    ModelRunner& operator=(ModelRunner&&) = default;
+
+    /// Get the capabilities of the model
+    ModelCapabilities capabilities() const {
+        return capabilities_;
+    }
+
+    /// Get the neighbor lists requested by the model
+    const std::vector<NeighborListOptions>& requested_neighbor_lists() const {
+        return requested_neighbor_lists_;
+    }
+
+    /// Get the interaction range of the model, in the length unit of the
+    /// engine
+    double interaction_range() const {
+        return interaction_range_;
+    }
+
+    /// Get the device used to run the model
+    torch::Device device() const {
+        return device_;
+    }
+
+    /// Get the dtype used by the model
+    torch::Dtype dtype() const {
+        return dtype_;
+    }
+
+    /// Get the underlying TorchScript model
+    const torch::jit::Module& model() const {
+        return model_;
+    }
+
+    /// Compute the energy of the system defined by the atomic `types`,
+    /// `positions`, `cell` and periodic boundary conditions `pbc` (see
+    /// `SystemHolder` for the expected shapes), and optionally the
+    /// corresponding `forces` and `virial`.
+    ///
+    /// The inputs can be on any device and have any dtype, they are converted
+    /// to the device and dtype of the model.
+    ModelRunnerResults compute(
+        torch::Tensor types,
+        torch::Tensor positions,
+        torch::Tensor cell,
+        torch::Tensor pbc,
+        bool forces = true,
+        bool virial = false
+    );
+
+    /// Forget the neighbor lists from previous calls to `compute`, for
+    /// example when the engine re-orders or replaces the atoms. With static
+    /// shapes, this also makes the next call to `compute` validate its inputs.
+    void reset();
+
+    /// Check if any of the neighbor lists needs to be re-computed for the
+    /// positions and cell used in the last call to `compute`, see
+    /// `NeighborListCacheHolder::needs_rebuild`. This returns a 0-dimensional
+    /// boolean tensor on `device()`.
+    torch::Tensor needs_rebuild() const;
+
+private:
+    /// Copy `input` inside `buffer`, re-allocating the buffer if the shape
+    /// changed. This returns `true` if the buffer was re-allocated.
+    bool update_buffer(torch::Tensor& buffer, const torch::Tensor& input, torch::Dtype dtype);
+
+    torch::jit::Module model_;
+    ModelCapabilities capabilities_;
+    std::vector<NeighborListOptions> requested_neighbor_lists_;
+    std::vector<NeighborListCache> neighbors_caches_;
+    ModelEvaluationOptions evaluation_options_;
+    double interaction_range_;
+    bool check_consistency_;
+    bool static_shapes_;
+    /// Were the inputs validated since the last re-allocation of the buffers?
+    bool validated_ = false;
+    /// System used in the last call to `compute`
+    System last_system_;
+
+    torch::Device device_ = torch::kCPU;
+    torch::Dtype dtype_ = torch::kFloat64;
+
+    /// Buffers for the inputs, on `device_`
+    torch::Tensor types_;
+    torch::Tensor positions_;
+    torch::Tensor cell_;
+    torch::Tensor pbc_;
+};
+
+}
+
+#endif
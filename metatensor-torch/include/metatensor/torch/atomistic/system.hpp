@@ -1,6 +1,7 @@
 #ifndef METATENSOR_TORCH_ATOMISTIC_SYSTEM_HPP
 #define METATENSOR_TORCH_ATOMISTIC_SYSTEM_HPP
 
+#include <mutex>
 #include <vector>
 #include <string>
 
@@ -21,6 +22,14 @@ class SystemHolder;
 /// TorchScript will always manipulate `SystemHolder` through a `torch::intrusive_ptr`
 using System = torch::intrusive_ptr<SystemHolder>;
 
+class SystemBatchHolder;
+/// TorchScript will always manipulate `SystemBatchHolder` through a `torch::intrusive_ptr`
+using SystemBatch = torch::intrusive_ptr<SystemBatchHolder>;
+
+class NeighborListCacheHolder;
+/// TorchScript will always manipulate `NeighborListCacheHolder` through a `torch::intrusive_ptr`
+using NeighborListCache = torch::intrusive_ptr<NeighborListCacheHolder>;
+
 /// Options for the calculation of a neighbor list
 class METATENSOR_TORCH_EXPORT NeighborListOptionsHolder final: public torch::CustomClassHolder {
 public:
@@ -113,7 +122,41 @@ public:
         bool check_consistency
     );
 
-    /// Compute the gradient of the output w.r.t. positions/cell
+    /// Compute the gradient of the output w.r.t. positions/cell, using
+    /// `NeighborsAutogradBackward` to make this differentiable
+    static std::vector<torch::Tensor> backward(
+        torch::autograd::AutogradContext* ctx,
+        std::vector<torch::Tensor> outputs_grad
+    );
+};
+
+/// Custom autograd node implementing the backward pass of `NeighborsAutograd`,
+/// i.e. going from the gradient w.r.t. the neighbor list distances to the
+/// gradients w.r.t. positions and cell.
+///
+/// The forward pass accumulates the gradients w.r.t. positions and cell in a
+/// single pass over the pairs. Since this operation is linear, its own backward
+/// pass (i.e. the double backward of `NeighborsAutograd`) applies the same
+/// transformation as the distance vectors computation to the gradients of
+/// positions and cell, allowing to train models on forces and virial.
+class METATENSOR_TORCH_EXPORT NeighborsAutogradBackward: public torch::autograd::Function<NeighborsAutogradBackward> {
+public:
+    /// Compute the gradients w.r.t. `positions` and `cell` from
+    /// `distances_grad`, the gradients w.r.t. the distances of the pairs
+    /// described by `samples`. Only the gradients for which
+    /// `positions_requires_grad`/`cell_requires_grad` is `true` are computed,
+    /// the others are returned as undefined tensors.
+    static std::vector<torch::Tensor> forward(
+        torch::autograd::AutogradContext* ctx,
+        torch::Tensor distances_grad,
+        torch::Tensor samples,
+        torch::Tensor positions,
+        torch::Tensor cell,
+        bool positions_requires_grad,
+        bool cell_requires_grad
+    );
+
+    /// Compute the gradient of the output w.r.t. `distances_grad`
     static std::vector<torch::Tensor> backward(
         torch::autograd::AutogradContext* ctx,
         std::vector<torch::Tensor> outputs_grad
@@ -136,6 +179,48 @@ METATENSOR_TORCH_EXPORT void register_autograd_neighbors(
     bool check_consistency
 );
 
+/// Compute the neighbor list for the given `system` according to `options`,
+/// using a cell list.
+///
+/// The cutoff is taken from `options`, converted to `length_unit`, which
+/// should be the unit of `system.positions` and `system.cell` (no conversion
+/// happens if either unit is empty). The search runs on CPU (in parallel
+/// over atoms), and the distance vectors are computed from `system.positions`
+/// and `system.cell` on the system device, with full autograd integration.
+/// The returned block follows the format used by
+/// `SystemHolder::add_neighbor_list`.
+///
+/// If `dtype` is given, the distance vectors are converted to this dtype after
+/// being computed with the dtype of the system. This must be a floating point
+/// type with lower precision than the system dtype, and is used for
+/// mixed-precision calculations.
+METATENSOR_TORCH_EXPORT TorchTensorBlock compute_neighbors(
+    System system,
+    NeighborListOptions options,
+    std::string length_unit = "",
+    torch::optional<torch::Dtype> dtype = torch::nullopt
+);
+
+namespace details {
+    /// Ordering of `NeighborListOptions`, used to store neighbor lists in a map
+    struct nl_options_compare {
+        bool operator()(const NeighborListOptions& a, const NeighborListOptions& b) const {
+            assert(a->length_unit() == b->length_unit());
+            if (a->full_list() == b->full_list()) {
+                return a->cutoff() < b->cutoff();
+            } else {
+                return static_cast<int>(a->full_list()) < static_cast<int>(b->full_list());
+            }
+        }
+    };
+}
+
+/// Marker type used to create a `SystemHolder` without checking the values
+/// inside the `cell` and `pbc` tensors, since this requires a synchronization
+/// with the device. The shape, dtype and device of all tensors are still
+/// checked.
+struct skip_value_checks {};
+
 /// A System contains all the information about an atomistic system; and should
 /// be used as the input of metatensor atomistic models.
 class METATENSOR_TORCH_EXPORT SystemHolder final: public torch::CustomClassHolder {
@@ -154,6 +239,14 @@ public:
     /// @param pbc 1D tensor of 3 boolean values, indicating if the system is
     ///        periodic along the directions defined by cell axes `a`, `b` and `c`, respectively.
     SystemHolder(torch::Tensor types, torch::Tensor positions, torch::Tensor cell, torch::Tensor pbc);
+
+    /// Create a `SystemHolder` in the same way as the main constructor, but
+    /// without checking that the cell vectors are zero along non-periodic
+    /// directions. This does not synchronize with the device, and should only
+    /// be used when the `cell` and `pbc` are known to be valid (for example
+    /// because they did not change since the last time they were checked).
+    SystemHolder(torch::Tensor types, torch::Tensor positions, torch::Tensor cell, torch::Tensor pbc, skip_value_checks);
+
     ~SystemHolder() override = default;
 
     /// Get the particle types for all particles in the system.
@@ -199,9 +292,12 @@ public:
     }
 
     /// Move all the data in this `System` to the given `dtype` and `device`.
+    /// If `non_blocking` is `true`, copies to a device other than the CPU are
+    /// done asynchronously when possible (i.e. from pinned memory).
     System to(
         torch::optional<torch::Dtype> dtype = torch::nullopt,
-        torch::optional<torch::Device> device = torch::nullopt
+        torch::optional<torch::Device> device = torch::nullopt,
+        bool non_blocking = false
     ) const;
 
     /// Wrapper of the `to` function to enable using it with positional
@@ -212,9 +308,16 @@ public:
         torch::IValue positional_1,
         torch::IValue positional_2,
         torch::optional<torch::Dtype> dtype,
-        torch::optional<torch::Device> device
+        torch::optional<torch::Device> device,
+        bool non_blocking
     ) const;
 
+    /// Copy all the data in this `System` (including neighbor lists and
+    /// custom data) to page-locked (pinned) CPU memory, making later transfers
+    /// to GPU faster and allowing them to be asynchronous. The system must be
+    /// on CPU.
+    System pin_memory() const;
+
     /// Get the number of particles in this system
     int64_t size() const {
         return this->types_.size(0);
@@ -238,9 +341,27 @@ public:
 
     /// Retrieve a previously stored neighbor list with the given options, or
     /// throw an error if no such neighbor list exists.
+    ///
+    /// If there is no stored neighbor list with exactly these `options`, the
+    /// neighbor list is derived from a stored one with a larger or equal
+    /// cutoff: pairs above the requested cutoff are removed, full lists are
+    /// created from half lists by adding the reversed pairs (with negated
+    /// cell shifts), and half lists are created from full lists by keeping one
+    /// of the two pairs. The derived list is computed with differentiable
+    /// operations on the stored one, and cached until the next call to
+    /// `add_neighbor_list`.
+    ///
+    /// The distances of the stored neighbor list must be in the same unit as
+    /// the cutoff of the `options` for the derivation to remove the right
+    /// pairs, which is the case in the systems given to the models.
     TorchTensorBlock get_neighbor_list(NeighborListOptions options) const;
 
-    /// Get the options for all neighbor lists registered with this `System`
+    /// Check if a neighbor list with the given options is stored in this
+    /// system, or can be derived from a stored one by `get_neighbor_list`.
+    bool has_neighbor_list(NeighborListOptions options) const;
+
+    /// Get the options for all neighbor lists registered with this `System`.
+    /// This does not include the neighbor lists derived from them.
     std::vector<NeighborListOptions> known_neighbor_lists() const;
 
     /// Add custom data to this system, stored as `TensorBlock`.
@@ -264,24 +385,256 @@ public:
     std::string str() const;
 
 private:
-    struct nl_options_compare {
-        bool operator()(const NeighborListOptions& a, const NeighborListOptions& b) const {
-            assert(a->length_unit() == b->length_unit());
-            if (a->full_list() == b->full_list()) {
-                return a->cutoff() < b->cutoff();
-            } else {
-                return static_cast<int>(a->full_list()) < static_cast<int>(b->full_list());
-            }
-        }
-    };
-
     torch::Tensor types_;
     torch::Tensor positions_;
     torch::Tensor cell_;
     torch::Tensor pbc_;
 
-    std::map<NeighborListOptions, TorchTensorBlock, nl_options_compare> neighbors_;
+    std::map<NeighborListOptions, TorchTensorBlock, details::nl_options_compare> neighbors_;
+    /// Neighbor lists derived from the ones in `neighbors_` by
+    /// `get_neighbor_list`
+    mutable std::map<NeighborListOptions, TorchTensorBlock, details::nl_options_compare> derived_neighbors_;
+    /// Mutex protecting `derived_neighbors_`, since `get_neighbor_list` can
+    /// be called from multiple threads for the same system
+    mutable std::mutex derived_neighbors_mutex_;
     std::unordered_map<std::string, TorchTensorBlock> data_;
+
+    /// Find the best stored neighbor list to derive a neighbor list with the
+    /// given `options`, returning `neighbors_.end()` if there is none
+    std::map<NeighborListOptions, TorchTensorBlock, details::nl_options_compare>::const_iterator
+    find_neighbors_source(const NeighborListOptions& options) const;
+};
+
+
+/// A batch of multiple systems, with the data of all the systems packed
+/// together. This should be created once by the engine, allowing models to
+/// evaluate all the systems at once without concatenating the data themselves.
+///
+/// The `types` and `positions` of all the systems are concatenated, and the
+/// atoms of the system `i` are stored in the rows `offsets[i]` to
+/// `offsets[i + 1]` of these tensors. The neighbor lists of all the systems are
+/// also concatenated, and the "first_atom" and "second_atom" samples refer to
+/// the atoms in the packed `types` and `positions`.
+///
+/// The packed data is created with differentiable operations, so gradients
+/// with respect to the positions and cell of the individual systems can be
+/// computed through the packed tensors.
+class METATENSOR_TORCH_EXPORT SystemBatchHolder final: public torch::CustomClassHolder {
+public:
+    /// Pack multiple `systems` in a single batch. All the systems must have
+    /// the same dtype and device, and contain the same set of neighbor lists.
+    explicit SystemBatchHolder(std::vector<System> systems);
+    ~SystemBatchHolder() override = default;
+
+    /// Get the number of systems in this batch
+    int64_t size() const {
+        return static_cast<int64_t>(systems_.size());
+    }
+
+    /// Get the individual systems in this batch
+    std::vector<System> systems() const {
+        return systems_;
+    }
+
+    /// Get the particle types for all the atoms in all the systems, as a 1D
+    /// tensor
+    torch::Tensor types() const {
+        return types_;
+    }
+
+    /// Get the positions for all the atoms in all the systems, as a 2D tensor
+    /// of shape `(n_atoms, 3)`
+    torch::Tensor positions() const {
+        return positions_;
+    }
+
+    /// Get the cells of all the systems, as a 3D tensor of shape
+    /// `(n_systems, 3, 3)`
+    torch::Tensor cells() const {
+        return cells_;
+    }
+
+    /// Get the periodic boundary conditions of all the systems, as a 2D tensor
+    /// of shape `(n_systems, 3)`
+    torch::Tensor pbcs() const {
+        return pbcs_;
+    }
+
+    /// Get the offsets of the systems in the packed `types` and `positions`,
+    /// as a 1D tensor of 64-bit integers with `n_systems + 1` entries. The
+    /// atoms of the system `i` are in the range `offsets[i]:offsets[i + 1]`.
+    torch::Tensor offsets() const {
+        return offsets_;
+    }
+
+    /// Get the index of the system containing each atom in the packed `types`
+    /// and `positions`, as a 1D tensor of 32-bit integers
+    torch::Tensor system_indices() const {
+        return system_indices_;
+    }
+
+    /// Get the device used by all the data in this `SystemBatch`
+    torch::Device device() const {
+        return this->types_.device();
+    }
+
+    /// Get the dtype used by all the floating point data in this `SystemBatch`
+    torch::Dtype scalar_type() const {
+        return positions_.scalar_type();
+    }
+
+    /// Move all the systems in this batch to the given `dtype` and `device`,
+    /// and pack them again in a new `SystemBatch`. See `SystemHolder::to` for
+    /// the meaning of `non_blocking`.
+    SystemBatch to(
+        torch::optional<torch::Dtype> dtype = torch::nullopt,
+        torch::optional<torch::Device> device = torch::nullopt,
+        bool non_blocking = false
+    ) const;
+
+    /// Wrapper of the `to` function to enable using it with positional
+    /// parameters from Python; for example `to(dtype)`, `to(device)`,
+    /// `to(dtype, device=device)`, `to(dtype, device)`, `to(device, dtype)`,
+    /// etc.
+    SystemBatch to_positional(
+        torch::IValue positional_1,
+        torch::IValue positional_2,
+        torch::optional<torch::Dtype> dtype,
+        torch::optional<torch::Device> device,
+        bool non_blocking
+    ) const;
+
+    /// Retrieve the concatenated neighbor list for all the systems with the
+    /// given options, or throw an error if no such neighbor list exists.
+    TorchTensorBlock get_neighbor_list(NeighborListOptions options) const;
+
+    /// Get the options for all neighbor lists available in this `SystemBatch`
+    std::vector<NeighborListOptions> known_neighbor_lists() const;
+
+    /// Implementation of `__str__` and `__repr__` for Python
+    std::string str() const;
+
+private:
+    std::vector<System> systems_;
+
+    torch::Tensor types_;
+    torch::Tensor positions_;
+    torch::Tensor cells_;
+    torch::Tensor pbcs_;
+    torch::Tensor offsets_;
+    torch::Tensor system_indices_;
+
+    std::map<NeighborListOptions, TorchTensorBlock, details::nl_options_compare> neighbors_;
+};
+
+/// Cache for a single neighbor list, re-using the pairs found at a previous
+/// step as long as the atoms did not move too much (Verlet list).
+///
+/// The pairs are searched with `compute_neighbors` using a cutoff of
+/// `options.cutoff + skin`. On later calls to `update`, the distances are
+/// re-computed for these pairs only, and the pairs further than the actual
+/// cutoff are filtered out. A new search is done when any atom moved by more
+/// than `skin / 2` since the last search, or when the number of atoms, the
+/// cell, the periodic boundary conditions, the dtype or the device of the
+/// system changed.
+class METATENSOR_TORCH_EXPORT NeighborListCacheHolder final: public torch::CustomClassHolder {
+public:
+    /// Create a new cache for the neighbor list described by `options`.
+    /// `skin` and the positions of the systems are expressed in
+    /// `length_unit`, which is also used to convert the cutoff in `options`.
+    /// If `dtype` is given, the distance vectors are converted to this dtype,
+    /// see `compute_neighbors`.
+    NeighborListCacheHolder(
+        NeighborListOptions options,
+        double skin,
+        std::string length_unit = "",
+        torch::optional<torch::Dtype> dtype = torch::nullopt
+    );
+    ~NeighborListCacheHolder() override = default;
+
+    /// Get the options of the neighbor list managed by this cache
+    NeighborListOptions options() const {
+        return options_;
+    }
+
+    /// Get the skin used by this cache
+    double skin() const {
+        return skin_;
+    }
+
+    /// Compute the neighbor list for `system`, re-using the pairs from the
+    /// previous search when possible, and add it to the system with
+    /// `SystemHolder::add_neighbor_list`. The neighbor list is also returned.
+    TorchTensorBlock update(System system);
+
+    /// Compute the neighbor list for `system` with fixed samples: the pairs
+    /// from the previous search are always re-used, and all pairs within
+    /// `cutoff + skin` are kept instead of being filtered with the actual
+    /// cutoff. A new search only happens if there was no previous search,
+    /// or if the number of atoms, the dtype or the device of the system
+    /// changed.
+    ///
+    /// This means that the returned neighbor list has the same shape and
+    /// samples between two calls to `reset`, and that this function does not
+    /// synchronize with the device outside of searches, making it usable with
+    /// static-shape execution such as CUDA graphs. The models using this list
+    /// must handle pairs beyond their cutoff (which is the case for models
+    /// using a smooth cutoff function), and the caller is responsible for
+    /// calling `reset` when `needs_rebuild` is true.
+    ///
+    /// The neighbor list is added to the system with
+    /// `SystemHolder::add_neighbor_list` and returned.
+    TorchTensorBlock update_static(System system);
+
+    /// Check if the pairs from the previous search are still valid for
+    /// `system`, i.e. if any atom moved by more than `skin / 2` or if the cell
+    /// changed, without synchronizing with the device. This returns a
+    /// 0-dimensional boolean tensor on the system device, which is `true` if
+    /// there was no previous search.
+    torch::Tensor needs_rebuild(System system) const;
+
+    /// Forget the pairs from the previous search, forcing the next call to
+    /// `update` to start from scratch
+    void reset();
+
+    /// Get the number of times the pairs were searched from scratch since
+    /// this cache was created
+    int64_t rebuilds() const {
+        return rebuilds_;
+    }
+
+private:
+    /// Check if the pairs from the previous search can be used for `system`
+    bool can_reuse(const System& system) const;
+    /// Check if the metadata (number of atoms, dtype and device) of `system`
+    /// matches the last search
+    bool same_metadata(const System& system) const;
+    /// Search all pairs within `cutoff + skin` for `system`
+    void search(const System& system, double cutoff);
+
+    NeighborListOptions options_;
+    double skin_;
+    std::string length_unit_;
+    torch::optional<torch::Dtype> dtype_;
+    int64_t rebuilds_ = 0;
+
+    /// samples for all the pairs within `cutoff + skin` at the last search
+    torch::Tensor samples_;
+    /// `first_atom`, `second_atom` and cell shifts from `samples_`, on the
+    /// system device
+    torch::Tensor first_atom_;
+    torch::Tensor second_atom_;
+    torch::Tensor cell_shifts_;
+    /// positions, cell and periodic boundary conditions at the last search
+    torch::Tensor reference_positions_;
+    torch::Tensor reference_cell_;
+    torch::Tensor reference_pbc_;
+    /// samples, components and properties of the neighbor lists created by
+    /// `update_static`, on the system device. These are only set after the
+    /// first call to `update_static` following a search.
+    TorchLabels static_samples_;
+    TorchLabels static_components_;
+    TorchLabels static_properties_;
 };
 
 }
@@ -43,6 +43,14 @@ public:
     /// contained inside
     TorchTensorBlock copy() const;
 
+    /// Make a shallow copy of this `TensorBlockHolder`, sharing the values,
+    /// gradients and metadata with this block instead of copying them.
+    ///
+    /// Adding gradients to the new block does not change the current one, but
+    /// in-place modifications of the values are visible in both blocks. Use
+    /// `copy()` if the values could be modified in-place.
+    TorchTensorBlock shallow_copy() const;
+
     /// Get a view in the values in this block
     torch::Tensor values() const;
 
@@ -124,6 +132,22 @@ public:
     /// Get a all gradients and associated parameters in this block
     static std::vector<std::tuple<std::string, TorchTensorBlock>> gradients(TorchTensorBlock self);
 
+    /// Get the index from the samples of this block to the rows of the
+    /// gradient with respect to `parameter`, in a compressed sparse row (CSR)
+    /// format.
+    ///
+    /// This returns a tuple `(offsets, rows)`: the rows of the gradient
+    /// associated with the sample `i` of this block are
+    /// `rows[offsets[i]:offsets[i + 1]]`. `rows` orders the gradient rows by
+    /// their `"sample"` dimension (keeping the existing order for rows
+    /// associated with the same sample), and is `0, 1, 2, ...` if the gradient
+    /// samples are already sorted in this way. Both tensors are on the same
+    /// device as this block.
+    ///
+    /// The index is computed the first time this function is called, and then
+    /// cached alongside the gradient data.
+    std::tuple<torch::Tensor, torch::Tensor> gradient_sample_index(const std::string& parameter) const;
+
     /// Get the device for the values stored in this `TensorBlock`
     torch::Device device() const {
         return this->values().device();
@@ -134,10 +158,13 @@ public:
         return this->values().scalar_type();
     }
 
-    /// Move all arrays in this block to the given `dtype` and `device`.
+    /// Move all arrays in this block to the given `dtype` and `device`. If
+    /// `non_blocking` is `true`, copies to a device other than the CPU are
+    /// done asynchronously when possible (i.e. from pinned memory).
     TorchTensorBlock to(
         torch::optional<torch::Dtype> dtype = torch::nullopt,
-        torch::optional<torch::Device> device = torch::nullopt
+        torch::optional<torch::Device> device = torch::nullopt,
+        bool non_blocking = false
     ) const;
 
     /// Wrapper of the `to` function to enable using it with positional
@@ -153,9 +180,15 @@ public:
         torch::IValue positional_2,
         torch::optional<torch::Dtype> dtype,
         torch::optional<torch::Device> device,
-        torch::optional<std::string> arrays
+        torch::optional<std::string> arrays,
+        bool non_blocking
     ) const;
 
+    /// Copy all the data in this block (values, gradients and metadata) to
+    /// page-locked (pinned) CPU memory, making later transfers to GPU faster
+    /// and allowing them to be asynchronous. The block must be on CPU.
+    TorchTensorBlock pin_memory() const;
+
     /// Implementation of __repr__/__str__ for Python
     std::string repr() const;
 
@@ -164,12 +197,26 @@ public:
         return block_;
     }
 
-    /// Load a serialized TensorBlock from the given path
-    static TorchTensorBlock load(const std::string& path);
+    /// Load a serialized TensorBlock from the given path, optionally converting
+    /// the data to the given `dtype` and `device`.
+    static TorchTensorBlock load(
+        const std::string& path,
+        torch::optional<torch::Dtype> dtype = torch::nullopt,
+        torch::optional<torch::Device> device = torch::nullopt
+    );
 
     /// Load a serialized TensorBlock from an in-memory buffer (represented as a
-    /// `torch::Tensor` of bytes)
-    static TorchTensorBlock load_buffer(torch::Tensor buffer);
+    /// `torch::Tensor` of bytes), optionally converting the data to the given
+    /// `dtype` and `device`.
+    static TorchTensorBlock load_buffer(
+        torch::Tensor buffer,
+        torch::optional<torch::Dtype> dtype = torch::nullopt,
+        torch::optional<torch::Device> device = torch::nullopt
+    );
+
+    /// Load a serialized TensorBlock from the given path, mapping the file in
+    /// memory and using the mapped data directly when possible.
+    static TorchTensorBlock load_mmap(const std::string& path);
 
     /// Serialize and save a TensorBlock to the given path
     void save(const std::string& path) const;
@@ -183,6 +230,19 @@ private:
     /// `parameter`
     TensorBlockHolder(metatensor::TensorBlock block, std::string parameter, torch::IValue parent);
     friend class torch::intrusive_ptr<TensorBlockHolder>;
+    friend class TensorMapHolder;
+
+    /// Create a `TorchTensorBlock` from a `block` that was just loaded,
+    /// converting it to the given `dtype` and `device`. When moving to a
+    /// device other than the CPU, the values of the labels are directly
+    /// created on the device (see `LabelsHolder::from_metatensor`), and the
+    /// values are copied asynchronously to CUDA devices (the data should have
+    /// been loaded in pinned memory).
+    static TorchTensorBlock from_loaded(
+        metatensor::TensorBlock block,
+        torch::optional<torch::Dtype> dtype,
+        torch::optional<torch::Device> device
+    );
 
     /// Underlying metatensor TensorBlock
     metatensor::TensorBlock block_;
@@ -3,6 +3,8 @@
 
 #include <string>
 #include <vector>
+#include <memory>
+#include <mutex>
 
 #include <torch/script.h>
 
@@ -43,7 +45,12 @@ public:
     ///
     /// The names should be either a single string or a list/tuple of strings;
     /// and the values should be a 2D tensor of integers.
-    LabelsHolder(torch::IValue names, torch::Tensor values);
+    ///
+    /// If `assume_unique` is `true`, the entries in `values` are assumed to be
+    /// unique, and this is not checked (except when metatensor-core is built in
+    /// debug mode). This makes the construction faster when the entries are
+    /// known to be unique by construction.
+    LabelsHolder(torch::IValue names, torch::Tensor values, bool assume_unique = false);
 
     /// Convenience constructor for building `LabelsHolder` in C++, similar to
     /// `metatensor::Labels`.
@@ -63,8 +70,23 @@ public:
 
     /// Create Labels with a single dimension with the given name and values in
     /// the [0, stop) range
+    ///
+    /// The resulting labels are range-encoded, see `range_product` for more
+    /// information.
     static TorchLabels range(std::string name, int64_t end);
 
+    /// Create Labels containing the cartesian product of the [0, ends[i])
+    /// ranges for each dimension in `names`, in row-major order (i.e. the last
+    /// dimension changes the fastest).
+    ///
+    /// The resulting labels are range-encoded: `position`, `positions`,
+    /// `range_of`, `select` (when all dimensions are selected) and comparison
+    /// with other range-encoded labels are computed arithmetically, and the
+    /// corresponding `metatensor::Labels` (with the hash table used to look up
+    /// entries) is only created when it is actually needed. The `values` tensor
+    /// is still created right away, with one entry per element of the product.
+    static TorchLabels range_product(torch::IValue names, std::vector<int64_t> ends);
+
     /// Create a `LabelsHolder` from a pre-existing `metatensor::Labels`
     explicit LabelsHolder(metatensor::Labels labels);
 
@@ -101,11 +123,20 @@ public:
         return values_.device();
     }
 
-    /// Move the values for these Labels to the given `device`
-    TorchLabels to(torch::IValue device) const;
+    /// Move the values for these Labels to the given `device`. If
+    /// `non_blocking` is `true`, the copy from CPU to another device is done
+    /// asynchronously when possible.
+    TorchLabels to(torch::IValue device, bool non_blocking = false) const;
+
+    /// Move the values for these Labels to the given `device`. If
+    /// `non_blocking` is `true`, the copy from CPU to another device is done
+    /// asynchronously when possible.
+    TorchLabels to(torch::Device device, bool non_blocking = false) const;
 
-    /// Move the values for these Labels to the given `device`
-    TorchLabels to(torch::Device device) const;
+    /// Copy the values for these Labels to page-locked (pinned) CPU memory,
+    /// making later transfers to GPU faster and allowing them to be
+    /// asynchronous. The Labels must be on CPU.
+    TorchLabels pin_memory() const;
 
     /// Get the values associated with a single dimension (i.e. a single column
     /// of `values()`) in these labels.
@@ -135,6 +166,26 @@ public:
     ///    - a tuple of integers;
     torch::optional<int64_t> position(torch::IValue entry) const;
 
+    /// Get the positions of multiple entries in this set of Labels at once.
+    ///
+    /// `entries` must be a 2-D tensor of integers, with one entry per row and
+    /// `size()` columns. The entries are copied to CPU once, and looked up in a
+    /// single call to metatensor-core. The result is a 1-D tensor of 64-bit
+    /// integers on the same device as `entries`, containing the position of
+    /// each entry or -1 for entries which are not part of these Labels.
+    torch::Tensor positions(torch::Tensor entries) const;
+
+    /// Get the range `(start, end)` of rows in these Labels containing all the
+    /// entries starting with `prefix`, i.e. where the first dimensions match
+    /// the values in `prefix`. For sorted Labels, this uses a binary search.
+    /// The result can be used to slice the values of a block.
+    ///
+    /// @param prefix one of:
+    ///    - a 1-D torch::Tensor containing integers;
+    ///    - a list of integers;
+    ///    - a tuple of integers;
+    std::tuple<int64_t, int64_t> range_of(torch::IValue prefix) const;
+
     /// Print the names and values of these Labels to a string, including at
     /// most `max_entries` entries (set this to -1 to print all entries), and
     /// indenting all lines after the first with `indent` spaces.
@@ -151,7 +202,7 @@ public:
 
     /// Is this a view inside existing Labels or an owned Labels?
     bool is_view() const {
-        return !labels_.has_value();
+        return !labels_.has_value() && lazy_labels_ == nullptr;
     }
 
     /// Transform a view of Labels into owned Labels, which can be further given
@@ -163,7 +214,12 @@ public:
     // `nullopt`)
     TorchLabels to_owned() const;
 
-    /// Get the union of `this` and `other`
+    /// Get the union of `this` and `other`.
+    ///
+    /// For Labels stored on a device other than the CPU, the union is computed
+    /// directly on this device, and the corresponding `metatensor::Labels` is
+    /// only created when needed. This is also the case for all the other set
+    /// operations below.
     TorchLabels set_union(const TorchLabels& other) const;
 
     /// Get the union of `this` and `other`, as well as the mapping from
@@ -188,12 +244,29 @@ public:
     /// in the `selection` but not in these `Labels` will be ignored.
     torch::Tensor select(const TorchLabels& selection) const;
 
-    /// Load serialized Labels from the given path
-    static TorchLabels load(const std::string& path);
+    /// Load serialized Labels from the given path, optionally moving the
+    /// values to the given `device`
+    static TorchLabels load(
+        const std::string& path,
+        torch::optional<torch::Device> device = torch::nullopt
+    );
 
     /// Load serialized Labels from an in-memory buffer (represented as a
-    /// `torch::Tensor` of bytes)
-    static TorchLabels load_buffer(torch::Tensor buffer);
+    /// `torch::Tensor` of bytes), optionally moving the values to the given
+    /// `device`
+    static TorchLabels load_buffer(
+        torch::Tensor buffer,
+        torch::optional<torch::Device> device = torch::nullopt
+    );
+
+    /// Create `LabelsHolder` for freshly created `labels` (for example just
+    /// loaded from a file), with values on the given `device`.
+    ///
+    /// Contrary to `to()`, this does not re-create the `metatensor::Labels`,
+    /// but registers the values on `device` as the user data of `labels`
+    /// instead. This must only be used if `labels` are not shared with other
+    /// `LabelsHolder` on a different device.
+    static TorchLabels from_metatensor(metatensor::Labels labels, torch::Device device);
 
     /// Serialize and save Labels to the given path
     void save(const std::string& path) const;
@@ -207,6 +280,12 @@ private:
     /// `values` as user data for the `labels`.
     LabelsHolder(std::vector<std::string> names, torch::Tensor values, metatensor::Labels labels);
 
+    /// Create new Labels with the same names and entries as these ones, using
+    /// `new_values` (which might live on a different device) as values. The
+    /// underlying metatensor Labels are re-created, since they can only be
+    /// associated with a single tensor.
+    TorchLabels with_new_values(torch::Tensor new_values) const;
+
     /// marker type to differentiate the private constructor below from the main
     /// one
     struct CreateView {};
@@ -214,7 +293,18 @@ private:
     /// Create a view for an existing `LabelsHolder`
     LabelsHolder(std::vector<std::string> names, torch::Tensor values, CreateView);
 
+    /// marker type to differentiate the private constructor below from the
+    /// other ones
+    struct CreateLazy {};
+
+    /// Create `LabelsHolder` from `values` which are known to only contain
+    /// unique entries, delaying the creation of the `metatensor::Labels` until
+    /// they are needed. This allows to keep the results of set operations on
+    /// the device without copying them back to the CPU.
+    LabelsHolder(std::vector<std::string> names, torch::Tensor values, CreateLazy);
+
     friend class torch::intrusive_ptr<LabelsHolder>;
+    friend bool operator==(const LabelsHolder& lhs, const LabelsHolder& rhs);
 
     /// names of the Labels, stored here for easier retrieval from Python
     std::vector<std::string> names_;
@@ -223,12 +313,35 @@ private:
     torch::Tensor values_;
 
     /// Underlying metatensor labels, this is undefined when the Labels is
-    /// actually a view (with selected columns) into another Labels
+    /// actually a view (with selected columns) into another Labels, or when
+    /// the Labels are created lazily
     torch::optional<metatensor::Labels> labels_;
+
+    /// Storage for lazily created `metatensor::Labels`, shared between all the
+    /// copies of this `LabelsHolder`. The labels are created at most once,
+    /// even when multiple threads use them at the same time.
+    struct LazyLabels {
+        std::once_flag once;
+        torch::optional<metatensor::Labels> labels;
+    };
+
+    /// This is only set for Labels created with `CreateLazy`, and `nullptr`
+    /// otherwise
+    std::shared_ptr<LazyLabels> lazy_labels_;
+
+    /// If these labels were created by `range_product`, this contains the end
+    /// of the range for each dimension. This is empty for all other labels.
+    std::vector<int64_t> range_ends_;
 };
 
 /// Check two `LabelsHolder` for equality
 inline bool operator==(const LabelsHolder& lhs, const LabelsHolder& rhs) {
+    if (!lhs.range_ends_.empty() && !rhs.range_ends_.empty()) {
+        // compare range-encoded labels without creating the metatensor::Labels
+        return lhs.names_ == rhs.names_ && (
+            lhs.range_ends_ == rhs.range_ends_ || (lhs.count() == 0 && rhs.count() == 0)
+        );
+    }
     return lhs.as_metatensor() == rhs.as_metatensor();
 }
 
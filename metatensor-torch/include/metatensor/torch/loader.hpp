@@ -0,0 +1,137 @@
+#ifndef METATENSOR_TORCH_LOADER_HPP
+#define METATENSOR_TORCH_LOADER_HPP
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <exception>
+#include <condition_variable>
+
+#include <torch/script.h>
+
+#include "metatensor/torch/exports.h"
+#include "metatensor/torch/tensor.hpp"
+
+namespace metatensor_torch {
+
+class TensorMapLoaderHolder;
+/// TorchScript will always manipulate `TensorMapLoaderHolder` through a
+/// `torch::intrusive_ptr`
+using TorchTensorMapLoader = torch::intrusive_ptr<TensorMapLoaderHolder>;
+
+/// Load batches of `TensorMap` from a list of files, using background threads
+/// to read the files while the previous batches are being used.
+///
+/// The files in each batch are loaded with `metatensor_torch::load` and
+/// collated with `metatensor_torch::join` along the samples, using the union
+/// of all keys. A `"tensor"` dimension is always added to the samples, even
+/// for batches containing a single file. Loading happens in `num_workers`
+/// threads, with at most `prefetch` batches loaded in advance. When the
+/// `device` is not the CPU, batches are packed (see `TensorMapHolder::pack`)
+/// and stored in pinned memory for CUDA devices by the worker threads. The
+/// next batch is then sent to the device asynchronously when returning the
+/// current one, overlapping the copy with the calculations on the current
+/// batch.
+///
+/// Batches are always returned in order, even when they are loaded by
+/// different threads.
+class METATENSOR_TORCH_EXPORT TensorMapLoaderHolder: public torch::CustomClassHolder {
+public:
+    /// Prepare to load the files at `paths` in batches of `batch_size`, and
+    /// start loading the first batches. If `shuffle` is `true`, the order of
+    /// the files is randomized (using torch's global random number generator)
+    /// at the start of each epoch. The data is converted to the given `dtype`
+    /// and moved to the given `device`, if any.
+    TensorMapLoaderHolder(
+        std::vector<std::string> paths,
+        int64_t batch_size,
+        bool shuffle = false,
+        torch::optional<torch::Dtype> dtype = torch::nullopt,
+        torch::optional<torch::Device> device = torch::nullopt,
+        int64_t num_workers = 2,
+        int64_t prefetch = 2
+    );
+
+    /// Stop the worker threads and release all the prefetched batches
+    ~TensorMapLoaderHolder() override;
+
+    /// TensorMapLoaderHolder can not be copy-constructed
+    TensorMapLoaderHolder(const TensorMapLoaderHolder&) = delete;
+    /// TensorMapLoaderHolder can not be copy-assigned
+    TensorMapLoaderHolder& operator=(const TensorMapLoaderHolder&) = delete;
+    /// TensorMapLoaderHolder can not be move-constructed
+    TensorMapLoaderHolder(TensorMapLoaderHolder&&) = delete;
+    /// TensorMapLoaderHolder can not be move-assigned
+    TensorMapLoaderHolder& operator=(TensorMapLoaderHolder&&) = delete;
+
+    /// Get the number of batches in one epoch. The last batch can contain
+    /// fewer than `batch_size` files.
+    int64_t size() const;
+
+    /// Get the next batch in the current epoch, or `torch::nullopt` if all
+    /// the batches in this epoch have already been returned. Errors that
+    /// happened when loading this batch are re-thrown here.
+    torch::optional<TorchTensorMap> next();
+
+    /// Start a new epoch, re-shuffling the files if needed. Batches which were
+    /// prefetched and not yet returned by `next()` are discarded.
+    void reset();
+
+private:
+    /// Result of loading a single batch in a worker thread
+    struct LoadedBatch {
+        TorchTensorMap tensor;
+        std::exception_ptr error;
+    };
+
+    /// Start the worker threads for the current epoch
+    void start();
+    /// Stop and join all the worker threads
+    void stop();
+    /// Main loop of the worker threads
+    void worker();
+    /// Load, collate and prepare the batch with the given index
+    TorchTensorMap load_batch(int64_t batch) const;
+    /// Wait until the batch with the given index is loaded and take it,
+    /// sending it to `device_` asynchronously
+    LoadedBatch take_batch(int64_t batch);
+    /// Check if the batch with the given index is already loaded
+    bool is_loaded(int64_t batch);
+
+    std::vector<std::string> paths_;
+    int64_t batch_size_;
+    bool shuffle_;
+    torch::optional<torch::Dtype> dtype_;
+    torch::optional<torch::Device> device_;
+    int64_t num_workers_;
+    int64_t prefetch_;
+
+    /// Order of the files in the current epoch
+    std::vector<int64_t> order_;
+
+    /// Mutex protecting all the data below
+    std::mutex mutex_;
+    /// Used both by the workers waiting for space in the queue, and by
+    /// `next()` waiting for a batch to be loaded
+    std::condition_variable condition_;
+    /// Should the workers stop?
+    bool stopping_ = false;
+    /// Index of the next batch to be loaded by a worker
+    int64_t next_to_load_ = 0;
+    /// Index of the next batch to be taken from `loaded_`
+    int64_t next_to_take_ = 0;
+    /// Batches loaded by the workers and not yet taken
+    std::map<int64_t, LoadedBatch> loaded_;
+
+    /// Batch already taken from `loaded_` and sent to the device, to be
+    /// returned by the next call to `next()`
+    torch::optional<LoadedBatch> in_flight_;
+
+    std::vector<std::thread> workers_;
+};
+
+}
+
+#endif
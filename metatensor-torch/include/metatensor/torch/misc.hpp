@@ -21,14 +21,66 @@ namespace details {
         uintptr_t shape_count,
         mts_array_t* array
     );
+
+    /// Function to be used as `mts_create_array_callback_t` to load data in
+    /// torch Tensor allocated in page-locked (pinned) memory, which can then
+    /// be copied asynchronously to a CUDA device.
+    METATENSOR_TORCH_EXPORT mts_status_t create_torch_pinned_array(
+        const uintptr_t* shape_ptr,
+        uintptr_t shape_count,
+        mts_array_t* array
+    );
+
+    /// Get the `mts_create_array_callback_t` to use when loading data that
+    /// will be converted to `dtype` and moved to `device` right after. The
+    /// arrays are created directly with `dtype` when metatensor can decode
+    /// data in this type (float32 and float16), and as float64 otherwise. They
+    /// are allocated in pinned memory for CUDA devices.
+    METATENSOR_TORCH_EXPORT mts_create_array_callback_t create_array_for(
+        torch::optional<torch::Dtype> dtype,
+        torch::optional<torch::Device> device
+    );
+
+    /// Function to be used as `mts_create_mmap_array_callback_t` to load data
+    /// in torch Tensor, directly using the memory-mapped data when possible.
+    METATENSOR_TORCH_EXPORT mts_status_t create_torch_mmap_array(
+        const uintptr_t* shape_ptr,
+        uintptr_t shape_count,
+        double* data,
+        mts_mmap_t* mmap,
+        mts_array_t* array
+    );
 }
 
 /// Load a previously saved `TensorMap` from the given path.
-METATENSOR_TORCH_EXPORT TorchTensorMap load(const std::string& path);
+///
+/// If `dtype` or `device` are given, the data will be converted to this
+/// `dtype` and moved to this `device`. For float32 and float16, the data is
+/// decoded directly in the requested `dtype`, other dtypes are converted after
+/// loading. When loading on a CUDA device, the data is first decoded in pinned
+/// memory and then copied asynchronously to the device. The values of the `Labels` are created
+/// directly on the device, without re-creating the corresponding
+/// `metatensor::Labels`.
+METATENSOR_TORCH_EXPORT TorchTensorMap load(
+    const std::string& path,
+    torch::optional<torch::Dtype> dtype = torch::nullopt,
+    torch::optional<torch::Device> device = torch::nullopt
+);
 
 /// Load a previously saved `TensorMap` from the given in-memory buffer
-/// (represented as a `torch::Tensor` of bytes)
-METATENSOR_TORCH_EXPORT TorchTensorMap load_buffer(torch::Tensor buffer);
+/// (represented as a `torch::Tensor` of bytes), optionally converting it to the
+/// given `dtype` and `device`.
+METATENSOR_TORCH_EXPORT TorchTensorMap load_buffer(
+    torch::Tensor buffer,
+    torch::optional<torch::Dtype> dtype = torch::nullopt,
+    torch::optional<torch::Device> device = torch::nullopt
+);
+
+/// Load a previously saved `TensorMap` from the given path, mapping the file
+/// in memory and using the mapped data directly for the values of the blocks
+/// when possible, instead of copying it. The data is always loaded on CPU, as
+/// 64-bit floating point values.
+METATENSOR_TORCH_EXPORT TorchTensorMap load_mmap(const std::string& path);
 
 /// Save the given `TensorMap` to a file at `path`
 METATENSOR_TORCH_EXPORT void save(const std::string& path, TorchTensorMap tensor);
@@ -37,14 +89,42 @@ METATENSOR_TORCH_EXPORT void save(const std::string& path, TorchTensorMap tensor
 /// `torch::Tensor` of bytes)
 METATENSOR_TORCH_EXPORT torch::Tensor save_buffer(TorchTensorMap tensor);
 
+/// Get the exact number of bytes needed to save the given `TensorMap`, i.e. the
+/// size of the buffer returned by `save_buffer`
+METATENSOR_TORCH_EXPORT int64_t serialized_size(TorchTensorMap tensor);
+
+/// Save the given `TensorMap` into the existing `buffer` (a contiguous CPU
+/// `torch::Tensor` of bytes) without allocating new memory, and return the
+/// number of bytes written. The buffer must contain at least
+/// `serialized_size(tensor)` bytes.
+METATENSOR_TORCH_EXPORT int64_t save_into_buffer(TorchTensorMap tensor, torch::Tensor buffer);
+
 /******************************************************************************/
 
 /// Load a previously saved `TensorBlock` from the given path.
-METATENSOR_TORCH_EXPORT TorchTensorBlock load_block(const std::string& path);
+///
+/// If `dtype` or `device` are given, the data will be converted to this
+/// `dtype` and moved to this `device`, in the same way as `load`.
+METATENSOR_TORCH_EXPORT TorchTensorBlock load_block(
+    const std::string& path,
+    torch::optional<torch::Dtype> dtype = torch::nullopt,
+    torch::optional<torch::Device> device = torch::nullopt
+);
 
 /// Load a previously saved `TensorBlock` from the given in-memory buffer
-/// (represented as a `torch::Tensor` of bytes)
-METATENSOR_TORCH_EXPORT TorchTensorBlock load_block_buffer(torch::Tensor buffer);
+/// (represented as a `torch::Tensor` of bytes), optionally converting it to the
+/// given `dtype` and `device`.
+METATENSOR_TORCH_EXPORT TorchTensorBlock load_block_buffer(
+    torch::Tensor buffer,
+    torch::optional<torch::Dtype> dtype = torch::nullopt,
+    torch::optional<torch::Device> device = torch::nullopt
+);
+
+/// Load a previously saved `TensorBlock` from the given path, mapping the
+/// file in memory and using the mapped data directly for the values when
+/// possible, instead of copying it. The data is always loaded on CPU, as 64-bit
+/// floating point values.
+METATENSOR_TORCH_EXPORT TorchTensorBlock load_block_mmap(const std::string& path);
 
 /// Save the given `TensorBlock` to a file at `path`
 METATENSOR_TORCH_EXPORT void save(const std::string& path, TorchTensorBlock block);
@@ -53,14 +133,33 @@ METATENSOR_TORCH_EXPORT void save(const std::string& path, TorchTensorBlock bloc
 /// `torch::Tensor` of bytes)
 METATENSOR_TORCH_EXPORT torch::Tensor save_buffer(TorchTensorBlock block);
 
+/// Get the exact number of bytes needed to save the given `TensorBlock`, i.e. the
+/// size of the buffer returned by `save_buffer`
+METATENSOR_TORCH_EXPORT int64_t serialized_size(TorchTensorBlock block);
+
+/// Save the given `TensorBlock` into the existing `buffer` (a contiguous CPU
+/// `torch::Tensor` of bytes) without allocating new memory, and return the
+/// number of bytes written. The buffer must contain at least
+/// `serialized_size(block)` bytes.
+METATENSOR_TORCH_EXPORT int64_t save_into_buffer(TorchTensorBlock block, torch::Tensor buffer);
+
 /******************************************************************************/
 
 /// Load previously saved `Labels` from the given path.
-METATENSOR_TORCH_EXPORT TorchLabels load_labels(const std::string& path);
+///
+/// If `device` is given, the values of the labels are moved to this device
+/// after loading, while the corresponding `metatensor::Labels` stay on CPU.
+METATENSOR_TORCH_EXPORT TorchLabels load_labels(
+    const std::string& path,
+    torch::optional<torch::Device> device = torch::nullopt
+);
 
 /// Load previously saved `Labels` from the given in-memory buffer
 /// (represented as a `torch::Tensor` of bytes)
-METATENSOR_TORCH_EXPORT TorchLabels load_labels_buffer(torch::Tensor buffer);
+METATENSOR_TORCH_EXPORT TorchLabels load_labels_buffer(
+    torch::Tensor buffer,
+    torch::optional<torch::Device> device = torch::nullopt
+);
 
 /// Save the given `Labels` to a file at `path`
 METATENSOR_TORCH_EXPORT void save(const std::string& path, TorchLabels labels);
@@ -69,6 +168,16 @@ METATENSOR_TORCH_EXPORT void save(const std::string& path, TorchLabels labels);
 /// `torch::Tensor` of bytes)
 METATENSOR_TORCH_EXPORT torch::Tensor save_buffer(TorchLabels labels);
 
+/// Get the exact number of bytes needed to save the given `Labels`, i.e. the
+/// size of the buffer returned by `save_buffer`
+METATENSOR_TORCH_EXPORT int64_t serialized_size(TorchLabels labels);
+
+/// Save the given `Labels` into the existing `buffer` (a contiguous CPU
+/// `torch::Tensor` of bytes) without allocating new memory, and return the
+/// number of bytes written. The buffer must contain at least
+/// `serialized_size(labels)` bytes.
+METATENSOR_TORCH_EXPORT int64_t save_into_buffer(TorchLabels labels, torch::Tensor buffer);
+
 }
 
 #endif
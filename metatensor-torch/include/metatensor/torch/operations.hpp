@@ -0,0 +1,73 @@
+#ifndef METATENSOR_TORCH_OPERATIONS_HPP
+#define METATENSOR_TORCH_OPERATIONS_HPP
+
+#include <string>
+#include <vector>
+
+#include <torch/script.h>
+
+#include "metatensor/torch/exports.h"
+#include "metatensor/torch/labels.hpp"
+#include "metatensor/torch/block.hpp"
+#include "metatensor/torch/tensor.hpp"
+
+namespace metatensor_torch {
+
+/// Reduce the values and gradients of `block` over the samples dimensions in
+/// `sample_names`, combining all the samples that only differ by the values of
+/// these dimensions.
+///
+/// `reduction` must be one of `"sum"`, `"mean"`, `"var"` or `"std"`. This is a
+/// native implementation of `metatensor.torch.sum_over_samples_block` and
+/// related functions, with all the operations on the values and gradients
+/// done with vectorized torch operations.
+METATENSOR_TORCH_EXPORT TorchTensorBlock reduce_over_samples_block(
+    TorchTensorBlock block,
+    const std::vector<std::string>& sample_names,
+    const std::string& reduction
+);
+
+/// Reduce all the blocks in `tensor` over the samples dimensions in
+/// `sample_names`, see `reduce_over_samples_block` for more information.
+METATENSOR_TORCH_EXPORT TorchTensorMap reduce_over_samples(
+    TorchTensorMap tensor,
+    const std::vector<std::string>& sample_names,
+    const std::string& reduction
+);
+
+/// Get a new block containing only the entries of `block` along the given
+/// `axis` (either `"samples"` or `"properties"`) matching the `selection`.
+/// The selected entries are kept in the same order as in `block`.
+METATENSOR_TORCH_EXPORT TorchTensorBlock slice_block(
+    TorchTensorBlock block,
+    const std::string& axis,
+    const TorchLabels& selection
+);
+
+/// Slice all the blocks in `tensor` along the given `axis`, see `slice_block`
+/// for more information.
+METATENSOR_TORCH_EXPORT TorchTensorMap slice(
+    TorchTensorMap tensor,
+    const std::string& axis,
+    const TorchLabels& selection
+);
+
+/// Join multiple `tensors` along the given `axis` (either `"samples"` or
+/// `"properties"`), in the same way as `metatensor.torch.join`.
+///
+/// `different_keys` controls what happens if the tensors do not have the same
+/// keys: `"error"` throws an error, `"intersection"` only keeps the blocks
+/// present in all tensors, and `"union"` uses empty blocks for missing keys.
+/// If `remove_tensor_name` is `true`, the `"tensor"` dimension added to the
+/// labels is removed when the entries from the different tensors are disjoint.
+METATENSOR_TORCH_EXPORT TorchTensorMap join(
+    const std::vector<TorchTensorMap>& tensors,
+    const std::string& axis,
+    const std::string& different_keys = "error",
+    bool sort_samples = false,
+    bool remove_tensor_name = false
+);
+
+}
+
+#endif
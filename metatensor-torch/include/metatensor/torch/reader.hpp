@@ -0,0 +1,61 @@
+#ifndef METATENSOR_TORCH_READER_HPP
+#define METATENSOR_TORCH_READER_HPP
+
+#include <vector>
+
+#include <torch/script.h>
+
+#include <metatensor.hpp>
+
+#include "metatensor/torch/exports.h"
+#include "metatensor/torch/labels.hpp"
+#include "metatensor/torch/block.hpp"
+#include "metatensor/torch/tensor.hpp"
+
+namespace metatensor_torch {
+
+class TensorMapReaderHolder;
+/// TorchScript will always manipulate `TensorMapReaderHolder` through a
+/// `torch::intrusive_ptr`
+using TorchTensorMapReader = torch::intrusive_ptr<TensorMapReaderHolder>;
+
+/// Wrapper around `metatensor::TensorMapReader` for integration with
+/// TorchScript, giving lazy access to the blocks of a serialized `TensorMap`.
+class METATENSOR_TORCH_EXPORT TensorMapReaderHolder: public torch::CustomClassHolder {
+public:
+    /// Open the file at `path` for lazy reading. This only reads the keys of
+    /// the `TensorMap`.
+    explicit TensorMapReaderHolder(const std::string& path);
+
+    /// Get the keys of the `TensorMap` in the file
+    TorchLabels keys() const {
+        return keys_;
+    }
+
+    /// Get a (possibly empty) list of block indexes matching the `selection`,
+    /// without loading any block
+    std::vector<int64_t> blocks_matching(const TorchLabels& selection) const;
+
+    /// Load the block at the given `index` from the file
+    TorchTensorBlock block_by_id(int64_t index) const;
+
+    /// Load the block with the key matching the `selection` from the file.
+    /// `selection` can be an int, a `Dict[str, int]`, `Labels` with a single
+    /// entry or a `LabelsEntry`.
+    TorchTensorBlock block_torch(torch::IValue selection) const;
+
+    /// Load all the blocks matching the `selection` from the file, and
+    /// assemble them in a new `TensorMap`
+    TorchTensorMap load(const TorchLabels& selection) const;
+
+private:
+    /// Load the single block matching `selection`
+    TorchTensorBlock block(const TorchLabelsEntry& selection) const;
+
+    metatensor::TensorMapReader reader_;
+    TorchLabels keys_;
+};
+
+}
+
+#endif
@@ -1,7 +1,12 @@
 #ifndef METATENSOR_TORCH_TENSOR_HPP
 #define METATENSOR_TORCH_TENSOR_HPP
 
+#include <map>
+#include <mutex>
+#include <memory>
 #include <vector>
+#include <shared_mutex>
+#include <functional>
 
 #include <torch/script.h>
 
@@ -17,6 +22,8 @@ class TensorMapHolder;
 /// TorchScript will always manipulate `TensorMapHolder` through a `torch::intrusive_ptr`
 using TorchTensorMap = torch::intrusive_ptr<TensorMapHolder>;
 
+class TensorMapReaderHolder;
+
 /// Wrapper around `metatensor::TensorMap` for integration with TorchScript
 ///
 /// Python/TorchScript code will typically manipulate
@@ -37,6 +44,15 @@ public:
     /// Make a copy of this `TensorMap`, including all the data contained inside
     TorchTensorMap copy() const;
 
+    /// Make a shallow copy of this `TensorMap`, sharing the keys and the
+    /// values, gradients and metadata of all blocks with this `TensorMap`
+    /// instead of copying them.
+    ///
+    /// Adding gradients to the blocks of the new `TensorMap` does not change
+    /// the current one, but in-place modifications of the values are visible
+    /// in both. A packed `TensorMap` stays packed, sharing the same buffer.
+    TorchTensorMap shallow_copy() const;
+
     /// Get the keys for this `TensorMap`
     TorchLabels keys() const;
 
@@ -85,6 +101,12 @@ public:
     /// functions above.
     static std::vector<TorchTensorBlock> blocks_torch(TorchTensorMap self, torch::IValue index);
 
+    /// Get one block for each entry in `selection`, where each entry must
+    /// match exactly one key in this `TensorMap`. This is equivalent to
+    /// calling `block` with each entry of `selection`, but only moves the
+    /// selection values to CPU once.
+    static std::vector<TorchTensorBlock> blocks_for(TorchTensorMap self, TorchLabels selection);
+
     /// Merge blocks with the same value for selected keys dimensions along the
     /// property axis.
     ///
@@ -115,6 +137,26 @@ public:
     /// strings.
     TorchTensorMap components_to_properties(torch::IValue dimensions) const;
 
+    /// Split the samples of all blocks in this `TensorMap` into `n_shards`
+    /// new `TensorMap`, in a single pass over the data. A sample with value
+    /// `v` for the `dimension` samples dimension goes to the shard
+    /// `shards[v]`.
+    ///
+    /// See `metatensor::TensorMap::split_samples` for more information on
+    /// this function.
+    std::vector<TorchTensorMap> split_samples(
+        const std::string& dimension,
+        torch::Tensor shards,
+        int64_t n_shards
+    ) const;
+
+    /// Merge `TensorMap` created by `split_samples` back into a single
+    /// `TensorMap`.
+    ///
+    /// See `metatensor::TensorMap::merge_samples` for more information on
+    /// this function.
+    static TorchTensorMap merge_samples(const std::vector<TorchTensorMap>& tensors);
+
     /// Get the names of the samples dimensions for all blocks in this
     /// `TensorMap`
     std::vector<std::string> sample_names();
@@ -140,10 +182,13 @@ public:
     /// Get the dtype for the values stored in this `TensorMap`
     torch::Dtype scalar_type() const;
 
-    /// Move this `TensorMap` to the given `dtype` and `device`.
+    /// Move this `TensorMap` to the given `dtype` and `device`. If
+    /// `non_blocking` is `true`, copies to a device other than the CPU are
+    /// done asynchronously when possible (i.e. from pinned memory).
     TorchTensorMap to(
         torch::optional<torch::Dtype> dtype = torch::nullopt,
-        torch::optional<torch::Device> device = torch::nullopt
+        torch::optional<torch::Device> device = torch::nullopt,
+        bool non_blocking = false
     ) const;
 
     /// Wrapper of the `to` function to enable using it with positional
@@ -159,20 +204,63 @@ public:
         torch::IValue positional_2,
         torch::optional<torch::Dtype> dtype,
         torch::optional<torch::Device> device,
-        torch::optional<std::string> arrays
+        torch::optional<std::string> arrays,
+        bool non_blocking
     ) const;
 
+    /// Copy all the data in this `TensorMap` (values, gradients and metadata)
+    /// to page-locked (pinned) CPU memory, making later transfers to GPU
+    /// faster and allowing them to be asynchronous. The data must be on CPU.
+    /// A packed `TensorMap` stays packed.
+    TorchTensorMap pin_memory() const;
+
+    /// Get a new `TensorMap` with the same data as this one, where the values
+    /// of all blocks (and of their gradients if `gradients` is `true`) are
+    /// views inside a single contiguous 1-dimensional buffer.
+    ///
+    /// All the arrays must have the same dtype and device. The buffer is
+    /// available with `packed_buffer()`, and can be used to move all the data
+    /// at once, or to run a single reduction over all the blocks. Calling `to`
+    /// on a packed `TensorMap` moves the whole buffer with a single copy, and
+    /// returns another packed `TensorMap`. Sparse values are converted to dense
+    /// values inside the buffer.
+    TorchTensorMap pack(bool gradients = true) const;
+
+    /// Check if the values of all blocks in this `TensorMap` are views inside
+    /// a single buffer, i.e. if it was created by `pack()`.
+    bool is_packed() const {
+        return packed_.defined();
+    }
+
+    /// Get the buffer containing the values of all blocks for a packed
+    /// `TensorMap`, or throw an error if this `TensorMap` is not packed.
+    torch::Tensor packed_buffer() const;
+
     /// Get the underlying metatensor TensorMap
     const metatensor::TensorMap& as_metatensor() const {
         return tensor_;
     }
 
-    /// Load a serialized TensorMap from the given path
-    static TorchTensorMap load(const std::string& path);
+    /// Load a serialized TensorMap from the given path, optionally converting
+    /// the data to the given `dtype` and `device`.
+    static TorchTensorMap load(
+        const std::string& path,
+        torch::optional<torch::Dtype> dtype = torch::nullopt,
+        torch::optional<torch::Device> device = torch::nullopt
+    );
 
     /// Load a serialized TensorMap from an in-memory buffer (represented as a
-    /// `torch::Tensor` of bytes)
-    static TorchTensorMap load_buffer(torch::Tensor buffer);
+    /// `torch::Tensor` of bytes), optionally converting the data to the given
+    /// `dtype` and `device`.
+    static TorchTensorMap load_buffer(
+        torch::Tensor buffer,
+        torch::optional<torch::Dtype> dtype = torch::nullopt,
+        torch::optional<torch::Device> device = torch::nullopt
+    );
+
+    /// Load a serialized TensorMap from the given path, mapping the file in
+    /// memory and using the mapped data directly when possible.
+    static TorchTensorMap load_mmap(const std::string& path);
 
     /// Serialize and save a TensorMap to the given path
     void save(const std::string& path) const;
@@ -182,11 +270,66 @@ public:
     torch::Tensor save_buffer() const;
 
 private:
+    friend class TensorMapReaderHolder;
+
     /// Underlying metatensor TensorMap
     metatensor::TensorMap tensor_;
 
+    /// Buffer containing the values of all blocks, if this `TensorMap` was
+    /// created by `pack()`
+    torch::Tensor packed_;
+    /// Are the gradients values also stored in `packed_`?
+    bool packed_gradients_ = false;
+
+    /// Index from the values of the keys for a subset of the key dimensions
+    /// to the corresponding blocks, defined in `tensor.cpp`
+    struct BlockIndex;
+    /// Cache of `BlockIndex` for all the sets of dimensions used in `block()`
+    /// and `blocks()` so far. The keys of a `TensorMap` never change, so these
+    /// are never invalidated.
+    struct BlockIndexCache {
+        /// Cached indexes, for each set of dimensions
+        std::map<std::vector<std::string>, std::shared_ptr<const BlockIndex>> indexes;
+        /// Mutex protecting `indexes`, since the same `TensorMap` can be used
+        /// from multiple threads. Lookups only take a shared lock, the
+        /// exclusive lock is only used to add a new `BlockIndex`.
+        std::shared_mutex mutex;
+    };
+    /// The cache is stored behind a pointer to keep `TensorMapHolder`
+    /// movable, since `std::shared_mutex` can not be moved.
+    std::unique_ptr<BlockIndexCache> block_index_cache_ = std::make_unique<BlockIndexCache>();
+
+    /// Get the indexes of the blocks with keys matching `values` for the
+    /// dimensions in `names`, using the cached `BlockIndex` for these
+    /// dimensions. This returns `nullptr` if `names` is empty or contains
+    /// dimensions which are not part of the keys.
+    const std::vector<int64_t>* cached_blocks_matching(
+        const std::vector<std::string>& names,
+        const int32_t* values
+    ) const;
+
+    /// Create a new packed `TensorMap` with the same metadata as this one,
+    /// taking the values of all blocks from `buffer` in the order used by
+    /// `pack()`. The metadata is transformed with `convert_labels`, and the
+    /// gradients not stored in `buffer` with `convert_gradient`.
+    TorchTensorMap from_packed_buffer(
+        torch::Tensor buffer,
+        bool gradients,
+        const std::function<TorchLabels(const TorchLabels&)>& convert_labels,
+        const std::function<TorchTensorBlock(const TorchTensorBlock&)>& convert_gradient
+    ) const;
+
     /// Wrap an existing `metatensor::TensorMap` into a `TensorMapHolder`
     explicit TensorMapHolder(metatensor::TensorMap tensor): tensor_(std::move(tensor)) {}
+
+    /// Create a `TorchTensorMap` from a `tensor` that was just loaded,
+    /// converting it to the given `dtype` and `device`. See
+    /// `TensorBlockHolder::from_loaded` for more information.
+    static TorchTensorMap from_loaded(
+        metatensor::TensorMap tensor,
+        torch::optional<torch::Dtype> dtype,
+        torch::optional<torch::Device> device
+    );
 };
 
 
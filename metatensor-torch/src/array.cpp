@@ -1,5 +1,6 @@
 #include <vector>
 #include <cstdint>
+#include <string>
 
 #include <torch/script.h>
 
@@ -25,7 +26,27 @@ struct MetatensorOriginRegistration {
 };
 
 
-TorchDataArray::TorchDataArray(torch::Tensor tensor): tensor_(std::move(tensor)) {
+TorchDataArray::TorchDataArray(torch::Tensor tensor):
+    tensor_(std::move(tensor)),
+    sample_index_(std::make_shared<SampleIndexCache>())
+{
+    if (tensor_.layout() != torch::kStrided) {
+        if (tensor_.layout() != torch::kSparse) {
+            C10_THROW_ERROR(ValueError,
+                "only strided and sparse COO tensors can be used as metatensor "
+                "arrays, convert other sparse layouts with `to_sparse()`"
+            );
+        }
+
+        if (tensor_.dense_dim() != 0) {
+            C10_THROW_ERROR(ValueError,
+                "sparse COO tensors with dense dimensions can not be used as "
+                "metatensor arrays, got a tensor with " +
+                std::to_string(tensor_.dense_dim()) + " dense dimensions"
+            );
+        }
+    }
+
     this->update_shape();
 }
 
@@ -36,6 +57,15 @@ mts_data_origin_t TorchDataArray::origin() const {
     return TORCH_DATA_ORIGIN;
 }
 
+std::tuple<torch::Tensor, torch::Tensor> TorchDataArray::sample_index(
+    const std::function<std::tuple<torch::Tensor, torch::Tensor>()>& compute
+) {
+    std::call_once(sample_index_->once, [&](){
+        sample_index_->index = compute();
+    });
+    return sample_index_->index;
+}
+
 std::unique_ptr<metatensor::DataArrayBase> TorchDataArray::copy() const {
     return std::unique_ptr<DataArrayBase>(new TorchDataArray(this->tensor().clone()));
 }
@@ -46,55 +76,174 @@ std::unique_ptr<metatensor::DataArrayBase> TorchDataArray::create(std::vector<ui
         sizes.push_back(static_cast<int64_t>(size));
     }
 
+    auto options = torch::TensorOptions()
+        .dtype(this->tensor().dtype())
+        .device(this->tensor().device());
+
+    if (this->tensor_.is_sparse()) {
+        // an empty sparse tensor, without any non-zero entries
+        options = options.layout(torch::kSparse);
+    }
+
     return std::unique_ptr<DataArrayBase>(new TorchDataArray(
-        torch::zeros(
-            sizes,
-            torch::TensorOptions()
-                .dtype(this->tensor().dtype())
-                .device(this->tensor().device())
-        )
+        torch::zeros(sizes, options)
     ));
 }
 
 double* TorchDataArray::data() & {
+    return static_cast<double*>(this->typed_data(MTS_DTYPE_FLOAT64));
+}
+
+/// Get the torch scalar type corresponding to one of the `MTS_DTYPE_*` values
+static torch::optional<torch::ScalarType> scalar_type_from_mts_dtype(int32_t dtype) {
+    switch (dtype) {
+    case MTS_DTYPE_FLOAT64:
+        return torch::kFloat64;
+    case MTS_DTYPE_FLOAT32:
+        return torch::kFloat32;
+    case MTS_DTYPE_FLOAT16:
+        return torch::kFloat16;
+    case MTS_DTYPE_INT32:
+        return torch::kInt32;
+    case MTS_DTYPE_INT64:
+        return torch::kInt64;
+    default:
+        return torch::nullopt;
+    }
+}
+
+/// Get the name of one of the `MTS_DTYPE_*` values
+static std::string mts_dtype_name(int32_t dtype) {
+    switch (dtype) {
+    case MTS_DTYPE_FLOAT64:
+        return "float64";
+    case MTS_DTYPE_FLOAT32:
+        return "float32";
+    case MTS_DTYPE_FLOAT16:
+        return "float16";
+    case MTS_DTYPE_INT32:
+        return "int32";
+    case MTS_DTYPE_INT64:
+        return "int64";
+    default:
+        return "unknown (" + std::to_string(dtype) + ")";
+    }
+}
+
+int32_t TorchDataArray::dtype() const {
+    switch (this->tensor_.scalar_type()) {
+    case torch::kFloat64:
+        return MTS_DTYPE_FLOAT64;
+    case torch::kFloat32:
+        return MTS_DTYPE_FLOAT32;
+    case torch::kFloat16:
+        return MTS_DTYPE_FLOAT16;
+    case torch::kInt32:
+        return MTS_DTYPE_INT32;
+    case torch::kInt64:
+        return MTS_DTYPE_INT64;
+    default:
+        return MTS_DTYPE_UNKNOWN;
+    }
+}
+
+void* TorchDataArray::typed_data(int32_t dtype) & {
     if (!this->tensor_.device().is_cpu()) {
         C10_THROW_ERROR(ValueError, "can not access the data of a torch::Tensor not on CPU");
     }
 
-    if (this->tensor_.dtype() != torch::kF64) {
+    auto scalar_type = scalar_type_from_mts_dtype(dtype);
+    if (!scalar_type.has_value() || this->tensor_.scalar_type() != scalar_type.value()) {
         C10_THROW_ERROR(ValueError,
             "can not access the data of this torch::Tensor: expected a dtype "
-            "of float64, got " + std::string(this->tensor_.dtype().name())
+            "of " + mts_dtype_name(dtype) + ", got " + std::string(this->tensor_.dtype().name())
+        );
+    }
+
+    if (this->tensor_.is_sparse()) {
+        // a dense copy would silently drop any modification made through the
+        // returned pointer, so we refuse to give raw access to sparse data
+        C10_THROW_ERROR(ValueError,
+            "can not access the raw data of a sparse torch::Tensor, convert "
+            "the values to a dense tensor with `to_dense()` first"
         );
     }
 
     if (!this->tensor_.is_contiguous()) {
-        C10_THROW_ERROR(ValueError, "can not access the data of a non contiguous torch::Tensor");
+        // `reshape` and `swap_axes` keep views of the data. We can not replace
+        // `tensor_` with a contiguous copy here, since this would break the
+        // aliasing with the tensor given by the user, and race with other
+        // threads reading `tensor_`. Callers needing raw access (such as the
+        // serialization code) must make the contiguous copy themselves.
+        C10_THROW_ERROR(ValueError,
+            "can not access the raw data of a non-contiguous torch::Tensor, "
+            "make it contiguous with `contiguous()` first"
+        );
     }
 
-    return static_cast<double*>(this->tensor_.data_ptr());
+    return this->tensor_.data_ptr();
 }
 
 const std::vector<uintptr_t>& TorchDataArray::shape() const & {
     return shape_;
 }
 
+bool TorchDataArray::is_contiguous() const {
+    if (this->tensor_.is_sparse()) {
+        // sparse tensors need to be converted to dense before accessing the data
+        return false;
+    }
+    return this->tensor_.is_contiguous();
+}
+
+/// Reshape a sparse COO `tensor` to the given `sizes`, by converting the
+/// indices of the non-zero entries to linear indices and back.
+static torch::Tensor sparse_reshape(const torch::Tensor& tensor, const std::vector<int64_t>& sizes) {
+    auto coalesced = tensor.coalesce();
+    auto indices = coalesced.indices();
+
+    auto linear = torch::zeros({indices.size(1)}, indices.options());
+    for (int64_t dim=0; dim<tensor.dim(); dim++) {
+        linear = linear * tensor.size(dim) + indices[dim];
+    }
+
+    auto new_indices = torch::empty({static_cast<int64_t>(sizes.size()), indices.size(1)}, indices.options());
+    for (auto dim=static_cast<int64_t>(sizes.size()) - 1; dim>=0; dim--) {
+        auto size = sizes[static_cast<size_t>(dim)];
+        new_indices[dim].copy_(linear.remainder(size));
+        linear = linear.div(size, /*rounding_mode=*/"floor");
+    }
+
+    return torch::sparse_coo_tensor(new_indices, coalesced.values(), sizes, tensor.options());
+}
+
 void TorchDataArray::reshape(std::vector<uintptr_t> shape) {
     auto sizes = std::vector<int64_t>();
     for (auto size: shape) {
         sizes.push_back(static_cast<int64_t>(size));
     }
 
-    this->tensor_ = this->tensor().reshape(sizes).contiguous();
+    if (this->tensor_.is_sparse()) {
+        this->tensor_ = sparse_reshape(this->tensor_, sizes);
+    } else {
+        this->tensor_ = this->tensor().reshape(sizes);
+    }
 
     this->update_shape();
 }
 
 void TorchDataArray::swap_axes(uintptr_t axis_1, uintptr_t axis_2) {
-    this->tensor_ = this->tensor().swapaxes(
-        static_cast<int64_t>(axis_1),
-        static_cast<int64_t>(axis_2)
-    ).contiguous();
+    if (this->tensor_.is_sparse()) {
+        this->tensor_ = this->tensor_.transpose(
+            static_cast<int64_t>(axis_1),
+            static_cast<int64_t>(axis_2)
+        );
+    } else {
+        this->tensor_ = this->tensor().swapaxes(
+            static_cast<int64_t>(axis_1),
+            static_cast<int64_t>(axis_2)
+        );
+    }
 
     this->update_shape();
 }
@@ -107,18 +256,6 @@ void TorchDataArray::move_samples_from(
 ) {
     const auto& input = dynamic_cast<const TorchDataArray&>(raw_input);
     auto input_tensor = input.tensor();
-
-    auto options = torch::TensorOptions().device(input_tensor.device()).dtype(torch::kInt64);
-    auto input_samples = torch::zeros({static_cast<int64_t>(samples.size())}, options);
-    auto output_samples = torch::zeros({static_cast<int64_t>(samples.size())}, options);
-
-    for (int64_t i=0; i<samples.size(); i++) {
-        input_samples[i] = static_cast<int64_t>(samples[i].input);
-        output_samples[i] = static_cast<int64_t>(samples[i].output);
-    }
-
-    using torch::indexing::Slice;
-    using torch::indexing::Ellipsis;
     auto output_tensor = this->tensor();
 
     assert(input_tensor.dtype() == output_tensor.dtype());
@@ -130,6 +267,31 @@ void TorchDataArray::move_samples_from(
         return;
     }
 
+    // fill the sample mapping on the host, and then send it to the device
+    // with a single copy, instead of writing each entry separately (which
+    // would launch a separate kernel for each sample on GPU)
+    auto n_samples = static_cast<int64_t>(samples.size());
+    auto mapping = torch::empty({2, n_samples}, torch::TensorOptions().dtype(torch::kInt64));
+    auto* mapping_ptr = mapping.data_ptr<int64_t>();
+    for (int64_t i=0; i<n_samples; i++) {
+        mapping_ptr[i] = static_cast<int64_t>(samples[i].input);
+        mapping_ptr[n_samples + i] = static_cast<int64_t>(samples[i].output);
+    }
+    mapping = mapping.to(input_tensor.device());
+
+    auto input_samples = mapping[0];
+    auto output_samples = mapping[1];
+
+    if (output_tensor.is_sparse()) {
+        this->move_sparse_samples_from(input_tensor, input_samples, output_samples, property_start);
+        return;
+    } else if (input_tensor.is_sparse()) {
+        input_tensor = input_tensor.to_dense();
+    }
+
+    using torch::indexing::Slice;
+    using torch::indexing::Ellipsis;
+
     // output[output_samples, ..., properties] = input[input_samples, ..., :]
     output_tensor.index_put_(
         {output_samples, Ellipsis, Slice(property_start, property_end)},
@@ -137,6 +299,37 @@ void TorchDataArray::move_samples_from(
     );
 }
 
+void TorchDataArray::move_sparse_samples_from(
+    const torch::Tensor& input,
+    const torch::Tensor& input_samples,
+    const torch::Tensor& output_samples,
+    uintptr_t property_start
+) {
+    auto sparse_input = (input.is_sparse() ? input : input.to_sparse()).coalesce();
+    auto indices = sparse_input.indices();
+
+    // position of the output sample for each input sample, or -1 if the input
+    // sample is not moved
+    auto lookup = torch::full({sparse_input.size(0)}, -1, indices.options());
+    lookup.index_put_({input_samples}, output_samples);
+
+    auto moved_samples = lookup.index_select(0, indices[0]);
+    auto moved = torch::nonzero(moved_samples >= 0).reshape({-1});
+
+    auto new_indices = indices.index_select(1, moved);
+    new_indices[0].copy_(moved_samples.index_select(0, moved));
+    new_indices[new_indices.size(0) - 1].add_(static_cast<int64_t>(property_start));
+
+    // each entry in the output is only set once, so we do not need to coalesce
+    // the new tensor here
+    this->tensor_ = torch::sparse_coo_tensor(
+        torch::cat({this->tensor_._indices(), new_indices}, 1),
+        torch::cat({this->tensor_._values(), sparse_input.values().index_select(0, moved)}),
+        this->tensor_.sizes(),
+        this->tensor_.options()
+    );
+}
+
 void TorchDataArray::update_shape() {
     shape_.clear();
     for (auto size: this->tensor_.sizes()) {
@@ -7,6 +7,7 @@
 #include <filesystem>
 
 #include <torch/torch.h>
+#include <caffe2/serialize/file_adapter.h>
 #include <nlohmann/json.hpp>
 
 #include <metatensor.hpp>
@@ -324,6 +325,17 @@ void ModelEvaluationOptionsHolder::set_selected_atoms(torch::optional<TorchLabel
     selected_atoms_ = std::move(selected_atoms);
 }
 
+void ModelEvaluationOptionsHolder::set_neighbors_dtype(std::string dtype) {
+    if (dtype.empty() || dtype == "float16" || dtype == "bfloat16" || dtype == "float32") {
+        neighbors_dtype_ = std::move(dtype);
+    } else {
+        C10_THROW_ERROR(ValueError,
+            "`neighbors_dtype` can be one of ['', 'float16', 'bfloat16', 'float32'], "
+            "got '" + dtype + "'"
+        );
+    }
+}
+
 
 std::string ModelEvaluationOptionsHolder::to_json() const {
     nlohmann::json result;
@@ -354,6 +366,10 @@ std::string ModelEvaluationOptionsHolder::to_json() const {
     }
     result["outputs"] = outputs;
 
+    if (!this->neighbors_dtype_.empty()) {
+        result["neighbors_dtype"] = this->neighbors_dtype_;
+    }
+
     return result.dump(/*indent*/4, /*indent_char*/' ', /*ensure_ascii*/ true);
 }
 
@@ -428,6 +444,13 @@ ModelEvaluationOptions ModelEvaluationOptionsHolder::from_json(std::string_view
         }
     }
 
+    if (data.contains("neighbors_dtype")) {
+        if (!data["neighbors_dtype"].is_string()) {
+            throw std::runtime_error("'neighbors_dtype' in JSON for ModelEvaluationOptions must be a string");
+        }
+        result->set_neighbors_dtype(data["neighbors_dtype"]);
+    }
+
     return result;
 }
 
@@ -817,20 +840,30 @@ static void load_library(
     }
 }
 
-void metatensor_torch::load_model_extensions(
-    std::string path,
-    c10::optional<std::string> extensions_directory
+/// Check that the archive opened in `reader` contains a metatensor atomistic
+/// model
+static void check_is_atomistic_model(
+    caffe2::serialize::PyTorchStreamReader& reader,
+    const std::string& path
 ) {
-    auto reader = caffe2::serialize::PyTorchStreamReader(path);
-
     if (!reader.hasRecord("extra/metatensor-version")) {
         C10_THROW_ERROR(ValueError,
             "file at '" + path + "' does not contain a metatensor atomistic model"
         );
     }
+}
 
+/// Implementation of `load_model_extensions` using an already opened
+/// `reader`. `loaded_libraries` should contain the output of
+/// `get_loaded_libraries()`. This returns `true` if we tried to load any new
+/// library.
+static bool load_model_extensions_impl(
+    caffe2::serialize::PyTorchStreamReader& reader,
+    const std::vector<std::string>& loaded_libraries,
+    c10::optional<std::string> extensions_directory
+) {
     auto debug = getenv("METATENSOR_DEBUG_EXTENSIONS_LOADING") != nullptr;
-    auto loaded_libraries = metatensor_torch::details::get_loaded_libraries();
+    auto loaded_any = false;
 
     std::vector<Library> dependencies = nlohmann::json::parse(record_to_string(
         reader.getRecord("extra/extensions-deps")
@@ -838,6 +871,7 @@ void metatensor_torch::load_model_extensions(
     for (const auto& dep: dependencies) {
         if (!library_already_loaded(loaded_libraries, dep.name)) {
             load_library(dep, extensions_directory, /*is_dependency=*/true);
+            loaded_any = true;
         } else if (debug) {
             std::cerr << dep.name << " dependency was already loaded" << std::endl;
         }
@@ -853,35 +887,23 @@ void metatensor_torch::load_model_extensions(
 
         if (!library_already_loaded(loaded_libraries, ext.name)) {
             load_library(ext, extensions_directory, /*is_dependency=*/false);
+            loaded_any = true;
         } else if (debug) {
             std::cerr << ext.name << " extension was already loaded" << std::endl;
         }
     }
-}
 
-ModelMetadata metatensor_torch::read_model_metadata(std::string path) {
-    auto reader = caffe2::serialize::PyTorchStreamReader(path);
-    if (!reader.hasRecord("extra/model-metadata")) {
-        C10_THROW_ERROR(ValueError,
-            "could not find model metadata in file at '" + path +
-            "', did you export your model with metatensor-torch >=0.5.4?"
-        );
-    }
-
-    return ModelMetadataHolder::from_json(
-        record_to_string(reader.getRecord("extra/model-metadata"))
-    );
+    return loaded_any;
 }
 
-void metatensor_torch::check_atomistic_model(std::string path) {
-    auto reader = caffe2::serialize::PyTorchStreamReader(path);
-
-    if (!reader.hasRecord("extra/metatensor-version")) {
-        C10_THROW_ERROR(ValueError,
-            "file at '" + path + "' does not contain a metatensor atomistic model"
-        );
-    }
-
+/// Implementation of `check_atomistic_model` using an already opened
+/// `reader`. `loaded_libraries` should contain the output of
+/// `get_loaded_libraries()`.
+static void check_atomistic_model_impl(
+    caffe2::serialize::PyTorchStreamReader& reader,
+    const std::vector<std::string>& loaded_libraries,
+    const std::string& path
+) {
     auto recorded_mts_version = Version(record_to_string(
         reader.getRecord("extra/metatensor-version")
     ));
@@ -915,8 +937,6 @@ void metatensor_torch::check_atomistic_model(std::string path) {
         reader.getRecord("extra/extensions")
     ));
 
-    auto loaded_libraries = metatensor_torch::details::get_loaded_libraries();
-
     for (const auto& extension: extensions) {
         if (!library_already_loaded(loaded_libraries, extension.name)) {
             TORCH_WARN(
@@ -928,13 +948,63 @@ void metatensor_torch::check_atomistic_model(std::string path) {
     }
 }
 
+void metatensor_torch::load_model_extensions(
+    std::string path,
+    c10::optional<std::string> extensions_directory
+) {
+    auto reader = caffe2::serialize::PyTorchStreamReader(path);
+    check_is_atomistic_model(reader, path);
+
+    auto loaded_libraries = metatensor_torch::details::get_loaded_libraries();
+    load_model_extensions_impl(reader, loaded_libraries, std::move(extensions_directory));
+}
+
+ModelMetadata metatensor_torch::read_model_metadata(std::string path) {
+    auto reader = caffe2::serialize::PyTorchStreamReader(path);
+    if (!reader.hasRecord("extra/model-metadata")) {
+        C10_THROW_ERROR(ValueError,
+            "could not find model metadata in file at '" + path +
+            "', did you export your model with metatensor-torch >=0.5.4?"
+        );
+    }
+
+    return ModelMetadataHolder::from_json(
+        record_to_string(reader.getRecord("extra/model-metadata"))
+    );
+}
+
+void metatensor_torch::check_atomistic_model(std::string path) {
+    auto reader = caffe2::serialize::PyTorchStreamReader(path);
+    check_is_atomistic_model(reader, path);
+
+    auto loaded_libraries = metatensor_torch::details::get_loaded_libraries();
+    check_atomistic_model_impl(reader, loaded_libraries, path);
+}
+
 torch::jit::Module metatensor_torch::load_atomistic_model(
     std::string path,
     c10::optional<std::string> extensions_directory
 ) {
-    load_model_extensions(path, extensions_directory);
-    check_atomistic_model(path);
-    return torch::jit::load(path);
+    // open the file only once, and share it between the reader used for the
+    // checks and the TorchScript deserialization
+    auto file = std::shared_ptr<caffe2::serialize::ReadAdapterInterface>(
+        std::make_shared<caffe2::serialize::FileAdapter>(path)
+    );
+    auto reader = caffe2::serialize::PyTorchStreamReader(file);
+    check_is_atomistic_model(reader, path);
+
+    auto loaded_libraries = metatensor_torch::details::get_loaded_libraries();
+    auto loaded_any = load_model_extensions_impl(
+        reader, loaded_libraries, std::move(extensions_directory)
+    );
+    if (loaded_any) {
+        // only look for loaded libraries again if we loaded new ones
+        loaded_libraries = metatensor_torch::details::get_loaded_libraries();
+    }
+
+    check_atomistic_model_impl(reader, loaded_libraries, path);
+
+    return torch::jit::load(file);
 }
 
 /******************************************************************************/
@@ -998,7 +1068,7 @@ struct Quantity {
     std::unordered_map<LowercaseString, double> conversions;
     std::unordered_map<LowercaseString, std::string> alternatives;
 
-    std::string normalize_unit(const std::string& original_unit) {
+    std::string normalize_unit(const std::string& original_unit) const {
         if (original_unit.empty()) {
             return original_unit;
         }
@@ -1024,7 +1094,7 @@ struct Quantity {
         return unit;
     }
 
-    double conversion(const std::string& from_unit, const std::string& to_unit) {
+    double conversion(const std::string& from_unit, const std::string& to_unit) const {
         auto from = this->normalize_unit(from_unit);
         auto to = this->normalize_unit(to_unit);
 
@@ -1036,7 +1106,8 @@ struct Quantity {
     }
 };
 
-static std::unordered_map<std::string, Quantity> KNOWN_QUANTITIES = {
+// this is never modified, allowing to use it from multiple threads
+static const std::unordered_map<std::string, Quantity> KNOWN_QUANTITIES = {
     {"length", Quantity{/* name */ "length", /* baseline */ "Angstrom", {
         {"Angstrom", 1.0},
         {"Bohr", 1.8897261258369282},
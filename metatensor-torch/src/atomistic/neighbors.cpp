@@ -0,0 +1,668 @@
+#include <cmath>
+
+#include <array>
+#include <vector>
+#include <algorithm>
+
+#include <torch/torch.h>
+#include <ATen/Parallel.h>
+
+#include "metatensor/torch/atomistic/system.hpp"
+
+#include "../internal/profiling.hpp"
+#include "../internal/utils.hpp"
+
+using namespace metatensor_torch;
+
+namespace {
+
+using Vector3D = std::array<double, 3>;
+
+Vector3D cross(const Vector3D& a, const Vector3D& b) {
+    return Vector3D{
+        a[1] * b[2] - a[2] * b[1],
+        a[2] * b[0] - a[0] * b[2],
+        a[0] * b[1] - a[1] * b[0],
+    };
+}
+
+double dot(const Vector3D& a, const Vector3D& b) {
+    return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+double norm(const Vector3D& a) {
+    return std::sqrt(dot(a, a));
+}
+
+/// Integer division rounding towards negative infinity
+int64_t floor_div(int64_t a, int64_t b) {
+    auto result = a / b;
+    if ((a % b != 0) && ((a < 0) != (b < 0))) {
+        result -= 1;
+    }
+    return result;
+}
+
+/// A single pair found by the cell list
+struct Pair {
+    int32_t first;
+    int32_t second;
+    std::array<int32_t, 3> shift;
+};
+
+/// Cell list used to find all pairs within a spherical cutoff. The bounding
+/// box follows the cell vectors along periodic directions, and is built from
+/// the atomic positions along non-periodic directions.
+class CellList {
+public:
+    CellList(
+        const double* positions,
+        int64_t n_atoms,
+        const double* cell,
+        const bool* pbc,
+        double cutoff
+    ):
+        positions_(positions),
+        n_atoms_(n_atoms),
+        cutoff_(cutoff)
+    {
+        for (size_t k=0; k<3; k++) {
+            periodic_[k] = pbc[k];
+            box_[k] = Vector3D{cell[3 * k + 0], cell[3 * k + 1], cell[3 * k + 2]};
+        }
+
+        this->setup_box();
+        this->setup_bins();
+    }
+
+    /// Find all the pairs involving atoms with index in `[begin, end)` as the
+    /// first atom, and add them to `pairs`
+    void pairs_for(int64_t begin, int64_t end, bool full_list, std::vector<Pair>& pairs) const {
+        const auto cutoff2 = cutoff_ * cutoff_;
+
+        for (auto i=begin; i<end; i++) {
+            const auto& bin_i = atom_bin_[i];
+            const auto& shift_i = atom_shift_[i];
+
+            for (auto da=-search_[0]; da<=search_[0]; da++) {
+            for (auto db=-search_[1]; db<=search_[1]; db++) {
+            for (auto dc=-search_[2]; dc<=search_[2]; dc++) {
+                auto bin = std::array<int64_t, 3>{bin_i[0] + da, bin_i[1] + db, bin_i[2] + dc};
+                auto image = std::array<int64_t, 3>{0, 0, 0};
+
+                auto outside = false;
+                for (size_t k=0; k<3; k++) {
+                    if (periodic_[k]) {
+                        image[k] = floor_div(bin[k], n_bins_[k]);
+                        bin[k] -= image[k] * n_bins_[k];
+                    } else if (bin[k] < 0 || bin[k] >= n_bins_[k]) {
+                        outside = true;
+                    }
+                }
+
+                if (outside) {
+                    continue;
+                }
+
+                auto linear = (bin[0] * n_bins_[1] + bin[1]) * n_bins_[2] + bin[2];
+                for (auto index=bin_start_[linear]; index<bin_start_[linear + 1]; index++) {
+                    auto j = sorted_atoms_[index];
+                    const auto& shift_j = atom_shift_[j];
+
+                    auto shift = std::array<int32_t, 3>{
+                        static_cast<int32_t>(image[0] - shift_j[0] + shift_i[0]),
+                        static_cast<int32_t>(image[1] - shift_j[1] + shift_i[1]),
+                        static_cast<int32_t>(image[2] - shift_j[2] + shift_i[2]),
+                    };
+
+                    auto self_pair = (i == j && shift[0] == 0 && shift[1] == 0 && shift[2] == 0);
+                    if (self_pair) {
+                        continue;
+                    }
+
+                    if (!full_list) {
+                        // only keep one of (i, j, S) and (j, i, -S)
+                        if (i > j) {
+                            continue;
+                        }
+
+                        if (i == j && std::lexicographical_compare(
+                            shift.begin(), shift.end(),
+                            ZERO_SHIFT.begin(), ZERO_SHIFT.end()
+                        )) {
+                            continue;
+                        }
+                    }
+
+                    auto distance2 = 0.0;
+                    for (size_t k=0; k<3; k++) {
+                        auto vector = positions_[3 * j + k] - positions_[3 * i + k];
+                        for (size_t m=0; m<3; m++) {
+                            // `shift` is always zero along non-periodic directions
+                            vector += shift[m] * box_[m][k];
+                        }
+                        distance2 += vector * vector;
+                    }
+
+                    if (distance2 < cutoff2) {
+                        pairs.push_back(Pair{
+                            static_cast<int32_t>(i),
+                            static_cast<int32_t>(j),
+                            shift
+                        });
+                    }
+                }
+            }
+            }
+            }
+        }
+    }
+
+private:
+    /// Replace the cell vectors along non-periodic directions by vectors
+    /// orthogonal to all the others, spanning the extent of the positions.
+    void setup_box() {
+        auto candidates = std::array<Vector3D, 3>{
+            Vector3D{1.0, 0.0, 0.0},
+            Vector3D{0.0, 1.0, 0.0},
+            Vector3D{0.0, 0.0, 1.0},
+        };
+
+        // orthonormal basis of the space spanned by the periodic directions
+        auto basis = std::vector<Vector3D>();
+        auto orthogonalize = [&](Vector3D direction) {
+            for (const auto& vector: basis) {
+                auto projection = dot(direction, vector);
+                for (size_t m=0; m<3; m++) {
+                    direction[m] -= projection * vector[m];
+                }
+            }
+            return direction;
+        };
+
+        for (size_t k=0; k<3; k++) {
+            if (periodic_[k]) {
+                auto direction = orthogonalize(box_[k]);
+                auto length = norm(direction);
+                if (length > 0.0) {
+                    for (size_t m=0; m<3; m++) {
+                        direction[m] /= length;
+                    }
+                    basis.push_back(direction);
+                }
+            }
+        }
+
+        origin_ = Vector3D{0.0, 0.0, 0.0};
+        for (size_t k=0; k<3; k++) {
+            if (periodic_[k]) {
+                continue;
+            }
+
+            // Gram-Schmidt orthogonalization of the candidate directions
+            // against the existing basis, keeping the most orthogonal one
+            auto best = Vector3D{0.0, 0.0, 0.0};
+            auto best_norm = 0.0;
+            for (const auto& candidate: candidates) {
+                auto direction = orthogonalize(candidate);
+                auto direction_norm = norm(direction);
+                if (direction_norm > best_norm) {
+                    best = direction;
+                    best_norm = direction_norm;
+                }
+            }
+
+            for (size_t m=0; m<3; m++) {
+                best[m] /= best_norm;
+            }
+            basis.push_back(best);
+
+            auto min = 0.0;
+            auto max = 0.0;
+            for (int64_t i=0; i<n_atoms_; i++) {
+                auto projection = dot(best, Vector3D{
+                    positions_[3 * i + 0], positions_[3 * i + 1], positions_[3 * i + 2]
+                });
+
+                if (i == 0 || projection < min) {
+                    min = projection;
+                }
+
+                if (i == 0 || projection > max) {
+                    max = projection;
+                }
+            }
+
+            // make sure the box is never flat
+            auto length = std::max(max - min, cutoff_);
+            for (size_t m=0; m<3; m++) {
+                box_[k][m] = length * best[m];
+                origin_[m] += min * best[m];
+            }
+        }
+
+        auto volume = std::abs(dot(box_[0], cross(box_[1], box_[2])));
+        if (volume <= 0.0 || !std::isfinite(volume)) {
+            C10_THROW_ERROR(ValueError,
+                "invalid cell in `system`: the periodic cell vectors are "
+                "linearly dependent"
+            );
+        }
+
+        for (size_t k=0; k<3; k++) {
+            // distance between the two faces of the box perpendicular
+            // to the other two vectors
+            auto face = cross(box_[(k + 1) % 3], box_[(k + 2) % 3]);
+            face_distance_[k] = volume / norm(face);
+
+            // column `k` of the inverse of the box matrix is used to compute the
+            // k-th fractional coordinate
+            for (size_t m=0; m<3; m++) {
+                inverse_[m][k] = face[m] / (volume * (dot(box_[k], face) > 0 ? 1.0 : -1.0));
+            }
+        }
+    }
+
+    /// Assign all atoms to bins, and sort them by bin
+    void setup_bins() {
+        auto n_bins_total = 1.0;
+        for (size_t k=0; k<3; k++) {
+            n_bins_[k] = std::max<int64_t>(1, static_cast<int64_t>(std::floor(face_distance_[k] / cutoff_)));
+            n_bins_total *= static_cast<double>(n_bins_[k]);
+        }
+
+        // don't use more bins than atoms, to limit memory usage for sparse
+        // systems or very small cutoffs
+        auto max_bins = static_cast<double>(std::max<int64_t>(n_atoms_, 1));
+        if (n_bins_total > max_bins) {
+            auto ratio = std::cbrt(n_bins_total / max_bins);
+            for (size_t k=0; k<3; k++) {
+                n_bins_[k] = std::max<int64_t>(1, static_cast<int64_t>(std::floor(static_cast<double>(n_bins_[k]) / ratio)));
+            }
+        }
+
+        for (size_t k=0; k<3; k++) {
+            search_[k] = static_cast<int64_t>(std::ceil(cutoff_ * static_cast<double>(n_bins_[k]) / face_distance_[k]));
+            if (!periodic_[k]) {
+                search_[k] = std::min(search_[k], n_bins_[k] - 1);
+            }
+        }
+
+        atom_bin_.resize(static_cast<size_t>(n_atoms_));
+        atom_shift_.resize(static_cast<size_t>(n_atoms_));
+        auto bin_count = std::vector<int64_t>(static_cast<size_t>(n_bins_[0] * n_bins_[1] * n_bins_[2] + 1), 0);
+        auto atom_linear_bin = std::vector<int64_t>(static_cast<size_t>(n_atoms_));
+
+        for (int64_t i=0; i<n_atoms_; i++) {
+            auto position = Vector3D{
+                positions_[3 * i + 0] - origin_[0],
+                positions_[3 * i + 1] - origin_[1],
+                positions_[3 * i + 2] - origin_[2],
+            };
+
+            auto& bin = atom_bin_[i];
+            auto& shift = atom_shift_[i];
+            for (size_t k=0; k<3; k++) {
+                auto fractional = dot(position, Vector3D{inverse_[0][k], inverse_[1][k], inverse_[2][k]});
+
+                shift[k] = 0;
+                if (periodic_[k]) {
+                    auto floor = std::floor(fractional);
+                    shift[k] = static_cast<int64_t>(floor);
+                    fractional -= floor;
+                }
+
+                bin[k] = static_cast<int64_t>(std::floor(fractional * static_cast<double>(n_bins_[k])));
+                bin[k] = std::min(std::max<int64_t>(bin[k], 0), n_bins_[k] - 1);
+            }
+
+            auto linear = (bin[0] * n_bins_[1] + bin[1]) * n_bins_[2] + bin[2];
+            atom_linear_bin[i] = linear;
+            bin_count[linear + 1] += 1;
+        }
+
+        // counting sort of the atoms by bin
+        for (size_t b=1; b<bin_count.size(); b++) {
+            bin_count[b] += bin_count[b - 1];
+        }
+        bin_start_ = bin_count;
+
+        sorted_atoms_.resize(static_cast<size_t>(n_atoms_));
+        for (int64_t i=0; i<n_atoms_; i++) {
+            auto& position = bin_count[atom_linear_bin[i]];
+            sorted_atoms_[position] = i;
+            position += 1;
+        }
+    }
+
+    static constexpr std::array<int32_t, 3> ZERO_SHIFT = {0, 0, 0};
+
+    const double* positions_;
+    int64_t n_atoms_;
+    double cutoff_;
+
+    std::array<bool, 3> periodic_;
+    std::array<Vector3D, 3> box_;
+    std::array<Vector3D, 3> inverse_;
+    Vector3D origin_;
+    Vector3D face_distance_;
+
+    std::array<int64_t, 3> n_bins_;
+    std::array<int64_t, 3> search_;
+
+    std::vector<std::array<int64_t, 3>> atom_bin_;
+    std::vector<std::array<int64_t, 3>> atom_shift_;
+    std::vector<int64_t> bin_start_;
+    std::vector<int64_t> sorted_atoms_;
+};
+
+constexpr std::array<int32_t, 3> CellList::ZERO_SHIFT;
+
+/// Number of atoms handled together by a single task when running the cell
+/// list in parallel. Using fixed-size chunks makes the output independent of
+/// the number of threads.
+constexpr int64_t ATOMS_PER_CHUNK = 256;
+
+/// Compute the distance vectors between pairs of atoms with torch operations
+/// on the system device, to integrate with autograd w.r.t. positions and cell
+torch::Tensor distance_vectors(
+    const System& system,
+    const torch::Tensor& first_atom,
+    const torch::Tensor& second_atom,
+    const torch::Tensor& cell_shifts
+) {
+    const auto& positions = system->positions();
+    return positions.index_select(0, second_atom)
+        - positions.index_select(0, first_atom)
+        + cell_shifts.to(positions.scalar_type()).matmul(system->cell());
+}
+
+/// Create a `TensorBlock` containing a neighbor list from the samples values
+/// (on CPU) and the corresponding distance `vectors`
+TorchTensorBlock neighbors_block(torch::Tensor samples_values, torch::Tensor vectors, torch::Device device) {
+    auto n_pairs = samples_values.size(0);
+
+    // all pairs are unique by construction
+    auto samples = torch::make_intrusive<LabelsHolder>(
+        std::vector<std::string>{
+            "first_atom", "second_atom", "cell_shift_a", "cell_shift_b", "cell_shift_c"
+        },
+        std::move(samples_values),
+        /*assume_unique=*/true
+    )->to(device);
+
+    auto components = std::vector<TorchLabels>{LabelsHolder::range("xyz", 3)->to(device)};
+    auto properties = LabelsHolder::range("distance", 1)->to(device);
+
+    return torch::make_intrusive<TensorBlockHolder>(
+        vectors.reshape({n_pairs, 3, 1}),
+        std::move(samples),
+        std::move(components),
+        std::move(properties)
+    );
+}
+
+/// Find all pairs of atoms in `system` within the given `cutoff`, returning
+/// the corresponding samples values on CPU
+torch::Tensor search_pairs(const System& system, double cutoff, bool full_list) {
+    if (!(cutoff > 0.0) || !std::isfinite(cutoff)) {
+        C10_THROW_ERROR(ValueError,
+            "the cutoff must be a positive finite number, got " + std::to_string(cutoff)
+        );
+    }
+
+    if (system->device().is_meta()) {
+        C10_THROW_ERROR(ValueError,
+            "can not compute neighbors for a system on the meta device"
+        );
+    }
+
+    // the search itself always runs on CPU, in float64
+    auto cpu_positions = system->positions().detach().to(torch::kCPU, torch::kFloat64).contiguous();
+    auto cpu_cell = system->cell().detach().to(torch::kCPU, torch::kFloat64).contiguous();
+    auto cpu_pbc = system->pbc().to(torch::kCPU).contiguous();
+
+    auto n_atoms = cpu_positions.size(0);
+    auto cell_list = CellList(
+        cpu_positions.data_ptr<double>(),
+        n_atoms,
+        cpu_cell.data_ptr<double>(),
+        cpu_pbc.data_ptr<bool>(),
+        cutoff
+    );
+
+    auto n_chunks = (n_atoms + ATOMS_PER_CHUNK - 1) / ATOMS_PER_CHUNK;
+    auto chunks = std::vector<std::vector<Pair>>(static_cast<size_t>(n_chunks));
+    at::parallel_for(0, n_chunks, 1, [&](int64_t begin, int64_t end) {
+        for (auto chunk=begin; chunk<end; chunk++) {
+            cell_list.pairs_for(
+                chunk * ATOMS_PER_CHUNK,
+                std::min((chunk + 1) * ATOMS_PER_CHUNK, n_atoms),
+                full_list,
+                chunks[chunk]
+            );
+        }
+    });
+
+    int64_t n_pairs = 0;
+    for (const auto& pairs: chunks) {
+        n_pairs += static_cast<int64_t>(pairs.size());
+    }
+
+    auto samples_values = torch::empty({n_pairs, 5}, torch::TensorOptions().dtype(torch::kInt32));
+    auto* samples_ptr = samples_values.data_ptr<int32_t>();
+    for (const auto& pairs: chunks) {
+        for (const auto& pair: pairs) {
+            samples_ptr[0] = pair.first;
+            samples_ptr[1] = pair.second;
+            samples_ptr[2] = pair.shift[0];
+            samples_ptr[3] = pair.shift[1];
+            samples_ptr[4] = pair.shift[2];
+            samples_ptr += 5;
+        }
+    }
+
+    return samples_values;
+}
+
+}
+
+/// Check that `dtype` is valid for the distances in the neighbor lists of
+/// `system`
+static void check_neighbors_dtype(const System& system, torch::optional<torch::Dtype> dtype) {
+    if (dtype.has_value() && !valid_neighbors_dtype(dtype.value(), system->scalar_type())) {
+        C10_THROW_ERROR(ValueError,
+            "the dtype of the neighbor list (" + scalar_type_name(dtype.value()) +
+            ") must be a floating point type with lower precision than the "
+            "system dtype (" + scalar_type_name(system->scalar_type()) + ")"
+        );
+    }
+}
+
+TorchTensorBlock metatensor_torch::compute_neighbors(
+    System system,
+    NeighborListOptions options,
+    std::string length_unit,
+    torch::optional<torch::Dtype> dtype
+) {
+    METATENSOR_TORCH_RECORD_FUNCTION("metatensor::compute_neighbors");
+    check_neighbors_dtype(system, dtype);
+
+    auto cutoff = options->engine_cutoff(length_unit);
+    auto samples_values = search_pairs(system, cutoff, options->full_list());
+
+    auto device = system->device();
+    auto device_samples = samples_values.to(device);
+    auto first_atom = device_samples.index({torch::indexing::Slice(), 0}).to(torch::kInt64);
+    auto second_atom = device_samples.index({torch::indexing::Slice(), 1}).to(torch::kInt64);
+    auto cell_shifts = device_samples.index({torch::indexing::Slice(), torch::indexing::Slice(2, 5)});
+
+    auto vectors = distance_vectors(system, first_atom, second_atom, cell_shifts);
+    if (dtype.has_value()) {
+        vectors = vectors.to(dtype.value());
+    }
+    return neighbors_block(std::move(samples_values), std::move(vectors), device);
+}
+
+/******************************************************************************/
+
+NeighborListCacheHolder::NeighborListCacheHolder(
+    NeighborListOptions options,
+    double skin,
+    std::string length_unit,
+    torch::optional<torch::Dtype> dtype
+):
+    options_(std::move(options)),
+    skin_(skin),
+    length_unit_(std::move(length_unit)),
+    dtype_(dtype)
+{
+    if (!(skin_ >= 0.0) || !std::isfinite(skin_)) {
+        C10_THROW_ERROR(ValueError,
+            "`skin` must be a positive finite number, got " + std::to_string(skin_)
+        );
+    }
+}
+
+void NeighborListCacheHolder::reset() {
+    samples_ = torch::Tensor();
+    first_atom_ = torch::Tensor();
+    second_atom_ = torch::Tensor();
+    cell_shifts_ = torch::Tensor();
+    reference_positions_ = torch::Tensor();
+    reference_cell_ = torch::Tensor();
+    reference_pbc_ = torch::Tensor();
+    static_samples_ = TorchLabels();
+    static_components_ = TorchLabels();
+    static_properties_ = TorchLabels();
+}
+
+bool NeighborListCacheHolder::same_metadata(const System& system) const {
+    if (!reference_positions_.defined()) {
+        return false;
+    }
+
+    const auto& positions = system->positions();
+    return positions.device() == reference_positions_.device() &&
+        positions.scalar_type() == reference_positions_.scalar_type() &&
+        positions.size(0) == reference_positions_.size(0);
+}
+
+bool NeighborListCacheHolder::can_reuse(const System& system) const {
+    if (!this->same_metadata(system)) {
+        return false;
+    }
+
+    const auto& positions = system->positions();
+
+    if (!torch::equal(system->pbc(), reference_pbc_) ||
+        !torch::equal(system->cell().detach(), reference_cell_)
+    ) {
+        return false;
+    }
+
+    if (positions.size(0) == 0) {
+        return true;
+    }
+
+    // single synchronization with the device to check the displacements
+    auto max_displacement2 = (positions.detach() - reference_positions_).square().sum(1).max();
+    return max_displacement2.item<double>() <= 0.25 * skin_ * skin_;
+}
+
+void NeighborListCacheHolder::search(const System& system, double cutoff) {
+    samples_ = search_pairs(system, cutoff + skin_, options_->full_list());
+
+    auto device_samples = samples_.to(system->device());
+    first_atom_ = device_samples.index({torch::indexing::Slice(), 0}).to(torch::kInt64);
+    second_atom_ = device_samples.index({torch::indexing::Slice(), 1}).to(torch::kInt64);
+    cell_shifts_ = device_samples.index({torch::indexing::Slice(), torch::indexing::Slice(2, 5)});
+
+    reference_positions_ = system->positions().detach().clone();
+    reference_cell_ = system->cell().detach().clone();
+    reference_pbc_ = system->pbc().clone();
+
+    static_samples_ = TorchLabels();
+    static_components_ = TorchLabels();
+    static_properties_ = TorchLabels();
+
+    rebuilds_ += 1;
+}
+
+TorchTensorBlock NeighborListCacheHolder::update(System system) {
+    METATENSOR_TORCH_RECORD_FUNCTION("metatensor::NeighborListCache::update");
+    check_neighbors_dtype(system, dtype_);
+
+    auto cutoff = options_->engine_cutoff(length_unit_);
+    auto device = system->device();
+
+    if (!this->can_reuse(system)) {
+        this->search(system, cutoff);
+    }
+
+    // only keep the pairs within the actual cutoff
+    auto vectors = distance_vectors(system, first_atom_, second_atom_, cell_shifts_);
+    auto selected = torch::nonzero(vectors.detach().square().sum(1) < cutoff * cutoff).reshape({-1});
+    if (dtype_.has_value()) {
+        vectors = vectors.to(dtype_.value());
+    }
+
+    auto samples_values = samples_.index_select(0, selected.to(torch::kCPU));
+    auto neighbors = neighbors_block(
+        std::move(samples_values),
+        vectors.index_select(0, selected),
+        device
+    );
+
+    system->add_neighbor_list(options_, neighbors);
+    return neighbors;
+}
+
+TorchTensorBlock NeighborListCacheHolder::update_static(System system) {
+    METATENSOR_TORCH_RECORD_FUNCTION("metatensor::NeighborListCache::update_static");
+    check_neighbors_dtype(system, dtype_);
+
+    if (!this->same_metadata(system)) {
+        this->search(system, options_->engine_cutoff(length_unit_));
+    }
+
+    auto device = system->device();
+    if (!static_samples_.defined()) {
+        // create the metadata once, and re-use it until the next search
+        auto block = neighbors_block(samples_, torch::empty({samples_.size(0), 3}), device);
+        static_samples_ = block->samples();
+        static_components_ = block->components()[0];
+        static_properties_ = block->properties();
+    }
+
+    auto vectors = distance_vectors(system, first_atom_, second_atom_, cell_shifts_);
+    if (dtype_.has_value()) {
+        vectors = vectors.to(dtype_.value());
+    }
+    auto neighbors = torch::make_intrusive<TensorBlockHolder>(
+        vectors.reshape({samples_.size(0), 3, 1}),
+        static_samples_,
+        std::vector<TorchLabels>{static_components_},
+        static_properties_
+    );
+
+    system->add_neighbor_list(options_, neighbors);
+    return neighbors;
+}
+
+torch::Tensor NeighborListCacheHolder::needs_rebuild(System system) const {
+    auto options = torch::TensorOptions().dtype(torch::kBool).device(system->device());
+    if (!this->same_metadata(system)) {
+        return torch::ones({}, options);
+    }
+
+    const auto& positions = system->positions().detach();
+    auto result = torch::any(system->cell().detach() != reference_cell_);
+    result = torch::logical_or(result, torch::any(system->pbc() != reference_pbc_));
+    if (positions.size(0) != 0) {
+        auto max_displacement2 = (positions - reference_positions_).square().sum(1).max();
+        result = torch::logical_or(result, max_displacement2 > 0.25 * skin_ * skin_);
+    }
+
+    return result;
+}
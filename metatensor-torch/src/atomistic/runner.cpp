@@ -0,0 +1,276 @@
+#include <torch/torch.h>
+#include <ATen/Context.h>
+
+#include "metatensor/torch/atomistic/runner.hpp"
+#include "metatensor/torch/block.hpp"
+#include "metatensor/torch/tensor.hpp"
+
+#include "../internal/utils.hpp"
+
+using namespace metatensor_torch;
+
+static torch::Device pick_device(const std::vector<std::string>& supported_devices) {
+    for (const auto& device: supported_devices) {
+        if (device == "cpu") {
+            return torch::kCPU;
+        } else if (device == "cuda" && torch::cuda::is_available()) {
+            return torch::kCUDA;
+        } else if (device == "mps" && at::hasMPS()) {
+            return torch::kMPS;
+        }
+    }
+
+    C10_THROW_ERROR(ValueError,
+        "failed to find a valid device for this model: none of the "
+        "supported_devices are available on this machine"
+    );
+}
+
+static void check_options(const ModelRunnerOptions& options) {
+    if (options.neighbor_skin < 0.0) {
+        C10_THROW_ERROR(ValueError,
+            "neighbor_skin must be positive or zero, got " +
+            std::to_string(options.neighbor_skin)
+        );
+    }
+
+    // check that the units are valid
+    unit_conversion_factor("length", options.length_unit, options.length_unit);
+    unit_conversion_factor("energy", options.energy_unit, options.energy_unit);
+
+    // check that the neighbors dtype is valid
+    ModelEvaluationOptionsHolder().set_neighbors_dtype(options.neighbors_dtype);
+}
+
+/// Check the options before doing the (expensive) loading of the model
+static torch::jit::Module load_model(const std::string& path, const ModelRunnerOptions& options) {
+    check_options(options);
+    return load_atomistic_model(path, options.extensions_directory);
+}
+
+/// Check the options for a model which is already loaded
+static torch::jit::Module checked_model(torch::jit::Module model, const ModelRunnerOptions& options) {
+    check_options(options);
+    return model;
+}
+
+ModelRunner::ModelRunner(const std::string& path, ModelRunnerOptions options):
+    ModelRunner(load_model(path, options), options)
+{}
+
+ModelRunner::ModelRunner(torch::jit::Module model, ModelRunnerOptions options):
+    model_(checked_model(std::move(model), options)),
+    interaction_range_(-1.0),
+    check_consistency_(options.check_consistency),
+    static_shapes_(options.static_shapes)
+{
+    if (model_.is_training()) {
+        model_.eval();
+    }
+
+    capabilities_ = model_.run_method("capabilities").toCustomClass<ModelCapabilitiesHolder>();
+
+    if (!capabilities_->outputs().contains("energy")) {
+        C10_THROW_ERROR(ValueError,
+            "this model can not compute 'energy', which is required by ModelRunner"
+        );
+    }
+
+    if (capabilities_->dtype() == "float64") {
+        dtype_ = torch::kFloat64;
+    } else if (capabilities_->dtype() == "float32") {
+        dtype_ = torch::kFloat32;
+    } else {
+        C10_THROW_ERROR(ValueError,
+            "unsupported dtype '" + capabilities_->dtype() + "' for this model"
+        );
+    }
+
+    if (options.device.has_value()) {
+        device_ = options.device.value();
+    } else {
+        device_ = pick_device(capabilities_->supported_devices);
+    }
+
+    // the model can be shared with other runners, which might be running in
+    // other threads. Only move it when it is not already on the right device
+    // to avoid modifying the parameters while they are used.
+    auto on_device = true;
+    for (const auto& parameter: model_.parameters()) {
+        on_device = on_device && parameter.device() == device_;
+    }
+    for (const auto& buffer: model_.buffers()) {
+        on_device = on_device && buffer.device() == device_;
+    }
+
+    if (!on_device) {
+        model_.to(device_);
+    }
+
+    interaction_range_ = capabilities_->engine_interaction_range(options.length_unit);
+
+    auto neighbors_dtype = torch::optional<torch::Dtype>();
+    if (options.neighbors_dtype == "float16") {
+        neighbors_dtype = torch::kFloat16;
+    } else if (options.neighbors_dtype == "bfloat16") {
+        neighbors_dtype = torch::kBFloat16;
+    } else if (options.neighbors_dtype == "float32") {
+        neighbors_dtype = torch::kFloat32;
+    }
+
+    if (neighbors_dtype.has_value() && !valid_neighbors_dtype(neighbors_dtype.value(), dtype_)) {
+        C10_THROW_ERROR(ValueError,
+            "neighbors_dtype must have a lower precision than the model dtype, got '" +
+            options.neighbors_dtype + "' for a model using '" + capabilities_->dtype() + "'"
+        );
+    }
+
+    auto requested = model_.run_method("requested_neighbor_lists").toList();
+    for (const auto& ivalue: requested) {
+        auto nl_options = ivalue.get().toCustomClass<NeighborListOptionsHolder>();
+        requested_neighbor_lists_.push_back(nl_options);
+        neighbors_caches_.push_back(torch::make_intrusive<NeighborListCacheHolder>(
+            nl_options, options.neighbor_skin, options.length_unit, neighbors_dtype
+        ));
+    }
+
+    auto energy = torch::make_intrusive<ModelOutputHolder>(
+        /*quantity=*/ "energy",
+        /*unit=*/ options.energy_unit,
+        /*per_atom=*/ false,
+        /*explicit_gradients=*/ std::vector<std::string>()
+    );
+    auto outputs = torch::Dict<std::string, ModelOutput>();
+    outputs.insert("energy", energy);
+
+    evaluation_options_ = torch::make_intrusive<ModelEvaluationOptionsHolder>(
+        options.length_unit,
+        outputs,
+        torch::nullopt
+    );
+    evaluation_options_->set_neighbors_dtype(options.neighbors_dtype);
+}
+
+bool ModelRunner::update_buffer(torch::Tensor& buffer, const torch::Tensor& input, torch::Dtype dtype) {
+    auto reallocated = false;
+    if (!buffer.defined() || buffer.sizes() != input.sizes()) {
+        buffer = torch::empty(input.sizes(), torch::TensorOptions().dtype(dtype).device(device_));
+        reallocated = true;
+    }
+    buffer.copy_(input, /*non_blocking=*/ device_.is_cuda());
+    return reallocated;
+}
+
+ModelRunnerResults ModelRunner::compute(
+    torch::Tensor types,
+    torch::Tensor positions,
+    torch::Tensor cell,
+    torch::Tensor pbc,
+    bool forces,
+    bool virial
+) {
+    {
+        auto guard = torch::NoGradGuard();
+        auto reallocated = this->update_buffer(types_, types, torch::kInt32);
+        reallocated |= this->update_buffer(cell_, cell, dtype_);
+        reallocated |= this->update_buffer(pbc_, pbc, torch::kBool);
+
+        // the positions buffer is used as a leaf in the autograd graph, so
+        // we need to detach it from the graph of the previous step
+        if (positions_.defined()) {
+            positions_ = positions_.detach();
+        }
+        reallocated |= this->update_buffer(positions_, positions, dtype_);
+
+        if (reallocated) {
+            validated_ = false;
+        }
+    }
+
+    // with static shapes, only validate the inputs on the first step after
+    // the buffers changed
+    auto skip_checks = static_shapes_ && validated_;
+
+    auto system_positions = positions_;
+    auto system_cell = cell_;
+    auto strain = torch::Tensor();
+    if (forces) {
+        positions_.requires_grad_(true);
+    }
+
+    if (virial) {
+        strain = torch::eye(3, torch::TensorOptions().dtype(dtype_).device(device_));
+        strain.requires_grad_(true);
+        system_positions = torch::matmul(system_positions, strain);
+        system_cell = torch::matmul(system_cell, strain);
+    }
+
+    auto system = System();
+    if (skip_checks) {
+        system = torch::make_intrusive<SystemHolder>(
+            types_, system_positions, system_cell, pbc_, skip_value_checks{}
+        );
+    } else {
+        system = torch::make_intrusive<SystemHolder>(
+            types_, system_positions, system_cell, pbc_
+        );
+    }
+
+    for (auto& cache: neighbors_caches_) {
+        if (static_shapes_) {
+            cache->update_static(system);
+        } else {
+            cache->update(system);
+        }
+    }
+
+    auto systems = torch::List<System>();
+    systems.push_back(system);
+
+    auto ivalue_output = model_.forward({
+        systems, evaluation_options_, check_consistency_ && !skip_checks
+    });
+    validated_ = true;
+    last_system_ = system;
+
+    auto outputs = ivalue_output.toGenericDict();
+    auto energy_tensor = outputs.at("energy").toCustomClass<TensorMapHolder>();
+    auto energy = TensorMapHolder::block_by_id(energy_tensor, 0)->values().sum();
+
+    if (forces || virial) {
+        energy.backward();
+    }
+
+    auto results = ModelRunnerResults();
+    results.energy = energy.detach();
+
+    if (forces) {
+        results.forces = -positions_.grad();
+    }
+
+    if (virial) {
+        // the virial is defined as -dE/dε, where ε is the strain
+        results.virial = -strain.grad();
+    }
+
+    return results;
+}
+
+void ModelRunner::reset() {
+    for (auto& cache: neighbors_caches_) {
+        cache->reset();
+    }
+    validated_ = false;
+}
+
+torch::Tensor ModelRunner::needs_rebuild() const {
+    auto result = torch::zeros({}, torch::TensorOptions().dtype(torch::kBool).device(device_));
+    if (!last_system_.defined()) {
+        return result;
+    }
+
+    for (const auto& cache: neighbors_caches_) {
+        result = torch::logical_or(result, cache->needs_rebuild(last_system_));
+    }
+    return result;
+}
@@ -12,6 +12,7 @@
 #include "metatensor/torch/atomistic/system.hpp"
 #include "metatensor/torch/atomistic/model.hpp"
 
+#include "../internal/profiling.hpp"
 #include "../internal/utils.hpp"
 
 
@@ -142,73 +143,112 @@ torch::Tensor NeighborsAutograd::forward(
     TorchTensorBlock neighbors,
     bool check_consistency
 ) {
+    METATENSOR_TORCH_RECORD_FUNCTION("metatensor::NeighborsAutograd::forward");
     auto distances = neighbors->values();
 
     if (check_consistency) {
         auto n_atoms = positions.size(0);
         auto epsilon = 1e-6;
-        if (distances.scalar_type() != torch::kFloat64) {
+        if (distances.scalar_type() == torch::kFloat32) {
             epsilon = 1e-4;
+        } else if (distances.scalar_type() != torch::kFloat64) {
+            // half precision types, used in mixed-precision calculations
+            epsilon = 5e-2;
         }
 
         auto samples = neighbors->samples()->values();
-        for (int64_t sample_i=0; sample_i<samples.size(0); sample_i++) {
-            auto atom_i = samples[sample_i][0];
-            auto atom_j = samples[sample_i][1];
+        auto first_atom = samples.index({torch::indexing::Slice(), 0});
+        auto second_atom = samples.index({torch::indexing::Slice(), 1});
+        auto cell_shifts = samples.index({torch::indexing::Slice(), torch::indexing::Slice(2, 5)});
+
+        auto first_out_of_bounds = torch::logical_or(first_atom < 0, first_atom >= n_atoms);
+        auto second_out_of_bounds = torch::logical_or(second_atom < 0, second_atom >= n_atoms);
+
+        // Check all pairs at once, and only synchronize with the device a
+        // single time to get the results of all the checks. The indexes are
+        // clamped to make sure we can compute the expected distances even if
+        // some pairs are out of bounds.
+        auto mismatch = torch::zeros_like(first_out_of_bounds);
+        auto diff_norm = torch::Tensor();
+        if (n_atoms != 0) {
+            auto expected_distances = positions.index_select(0, second_atom.clamp(0, n_atoms - 1))
+                - positions.index_select(0, first_atom.clamp(0, n_atoms - 1))
+                + cell_shifts.to(positions.scalar_type()).matmul(cell);
+
+            auto diff = distances.reshape({-1, 3}) - expected_distances;
+            diff_norm = torch::sqrt(torch::sum(diff * diff, /*dim=*/1));
+            mismatch = diff_norm > epsilon;
+        }
+
+        auto status = torch::stack({
+            torch::any(first_out_of_bounds),
+            torch::any(second_out_of_bounds),
+            torch::any(mismatch),
+        }).to(torch::kCPU);
+        auto status_accessor = status.accessor<bool, 1>();
+
+        if (status_accessor[0] || status_accessor[1] || status_accessor[2]) {
+            // something is wrong, extract the first problematic pair to
+            // create the error message. Errors about out of bounds atoms take
+            // precedence over errors about the distances, since the expected
+            // distances of out of bounds pairs do not mean anything.
+            auto errors = mismatch;
+            if (status_accessor[0] || status_accessor[1]) {
+                errors = torch::logical_or(first_out_of_bounds, second_out_of_bounds);
+            }
+            auto sample_i = torch::nonzero(errors).index({0, 0}).item<int64_t>();
+            auto pair = samples[sample_i].to(torch::kCPU);
 
-            auto atom_i_cpu = atom_i.to(torch::kCPU).item<int32_t>();
-            auto atom_j_cpu = atom_j.to(torch::kCPU).item<int32_t>();
-            if (atom_i_cpu < 0 || atom_i_cpu >= n_atoms) {
+            auto atom_i = pair[0].item<int32_t>();
+            auto atom_j = pair[1].item<int32_t>();
+            if (atom_i < 0 || atom_i >= n_atoms) {
                 C10_THROW_ERROR(ValueError,
                     "checking internal consistency: 'first_atom' in neighbor list (" +
-                    std::to_string(atom_i_cpu) + ") is out of bounds (we have " +
+                    std::to_string(atom_i) + ") is out of bounds (we have " +
                     std::to_string(n_atoms) + " atoms in the system)"
                 );
             }
 
-            if (atom_j_cpu < 0 || atom_j_cpu >= n_atoms) {
+            if (atom_j < 0 || atom_j >= n_atoms) {
                 C10_THROW_ERROR(ValueError,
                     "checking internal consistency: 'second_atom' in neighbor list (" +
-                    std::to_string(atom_j_cpu) + ") is out of bounds (we have " +
+                    std::to_string(atom_j) + ") is out of bounds (we have " +
                     std::to_string(n_atoms) + " atoms in the system)"
                 );
             }
 
-            auto cell_shift = samples.index({sample_i, torch::indexing::Slice(2, 5)}).to(positions.scalar_type());
-
+            auto cell_shift = pair.index({torch::indexing::Slice(2, 5)});
             auto actual_distance = distances[sample_i].reshape({3});
-            auto expected_distance = positions[atom_j] - positions[atom_i] + cell_shift.matmul(cell);
+            auto expected_distance = positions[atom_j] - positions[atom_i] + cell_shift.to(
+                positions.device(), positions.scalar_type()
+            ).matmul(cell);
 
-            auto diff_norm = (actual_distance - expected_distance).norm().to(torch::kCPU).to(torch::kF64);
-            if (diff_norm.item<double>() > epsilon) {
-                std::ostringstream oss;
+            std::ostringstream oss;
 
-                oss << "checking internal consistency: one neighbor pair does not match its metadata: ";
-                oss << "the pair between atom " << atom_i.item<int32_t>();
-                oss << " and atom " << atom_j.item<int32_t>() << " for the ";
+            oss << "checking internal consistency: one neighbor pair does not match its metadata: ";
+            oss << "the pair between atom " << atom_i;
+            oss << " and atom " << atom_j << " for the ";
 
-                auto cell_shift_i32 = samples.index({sample_i, torch::indexing::Slice(2, 5)});
-                oss << "[" << cell_shift_i32[0].item<int32_t>() << ", ";
-                oss << cell_shift_i32[1].item<int32_t>() << ", ";
-                oss << cell_shift_i32[2].item<int32_t>() << "] cell shift ";
+            oss << "[" << cell_shift[0].item<int32_t>() << ", ";
+            oss << cell_shift[1].item<int32_t>() << ", ";
+            oss << cell_shift[2].item<int32_t>() << "] cell shift ";
 
-                auto expected_f64 = expected_distance.to(torch::kCPU).to(torch::kF64);
-                oss << "should have a distance vector of ";
-                oss << "[" << expected_f64[0].item<double>() << ", ";
-                oss << expected_f64[1].item<double>() << ", ";
-                oss << expected_f64[2].item<double>() << "] ";
+            auto expected_f64 = expected_distance.to(torch::kCPU).to(torch::kF64);
+            oss << "should have a distance vector of ";
+            oss << "[" << expected_f64[0].item<double>() << ", ";
+            oss << expected_f64[1].item<double>() << ", ";
+            oss << expected_f64[2].item<double>() << "] ";
 
+            auto actual_f64 = actual_distance.to(torch::kCPU).to(torch::kF64);
+            oss << "but has a distance vector of ";
+            oss << "[" << actual_f64[0].item<double>() << ", ";
+            oss << actual_f64[1].item<double>() << ", ";
+            oss << actual_f64[2].item<double>() << "] ";
 
-                auto actual_f64 = actual_distance.to(torch::kCPU).to(torch::kF64);
-                oss << "but has a distance vector of ";
-                oss << "[" << actual_f64[0].item<double>() << ", ";
-                oss << actual_f64[1].item<double>() << ", ";
-                oss << actual_f64[2].item<double>() << "] ";
+            auto pair_diff_norm = diff_norm[sample_i].to(torch::kCPU).to(torch::kF64);
+            oss << "norm difference is " << pair_diff_norm.item<double>();
 
-                oss << "norm difference is " << diff_norm.item<double>();
-
-                C10_THROW_ERROR(ValueError, oss.str());
-            }
+            C10_THROW_ERROR(ValueError, oss.str());
         }
     }
 
@@ -222,44 +262,183 @@ std::vector<torch::Tensor> NeighborsAutograd::backward(
     torch::autograd::AutogradContext* ctx,
     std::vector<torch::Tensor> outputs_grad
 ) {
+    METATENSOR_TORCH_RECORD_FUNCTION("metatensor::NeighborsAutograd::backward");
     auto distances_grad = outputs_grad[0];
 
     auto saved_variables = ctx->get_saved_variables();
     auto positions = saved_variables[0];
     auto cell = saved_variables[1];
-
-    auto distances = saved_variables[2];
     auto samples = saved_variables[3];
 
+    auto gradients = NeighborsAutogradBackward::apply(
+        distances_grad,
+        samples,
+        positions.detach(),
+        cell.detach(),
+        positions.requires_grad(),
+        cell.requires_grad()
+    );
+
+    return {gradients[0], gradients[1], torch::Tensor(), torch::Tensor()};
+}
+
+/// Accumulate the gradients w.r.t. positions and cell in a single pass over
+/// all the pairs, for data on CPU
+template <typename scalar_t>
+static void neighbors_backward_cpu(
+    const torch::Tensor& distances_grad,
+    const torch::Tensor& samples,
+    torch::Tensor& positions_grad,
+    torch::Tensor& cell_grad
+) {
+    auto n_pairs = samples.size(0);
+    const auto* grad = distances_grad.data_ptr<scalar_t>();
+    const auto* pairs = samples.data_ptr<int32_t>();
+
+    scalar_t* positions_grad_ptr = positions_grad.defined() ? positions_grad.data_ptr<scalar_t>() : nullptr;
+    scalar_t* cell_grad_ptr = cell_grad.defined() ? cell_grad.data_ptr<scalar_t>() : nullptr;
+
+    for (int64_t pair_i=0; pair_i<n_pairs; pair_i++) {
+        const auto* pair = pairs + 5 * pair_i;
+        const auto* pair_grad = grad + 3 * pair_i;
+
+        if (positions_grad_ptr != nullptr) {
+            auto* first = positions_grad_ptr + 3 * static_cast<int64_t>(pair[0]);
+            auto* second = positions_grad_ptr + 3 * static_cast<int64_t>(pair[1]);
+            for (int64_t xyz=0; xyz<3; xyz++) {
+                second[xyz] += pair_grad[xyz];
+                first[xyz] -= pair_grad[xyz];
+            }
+        }
+
+        if (cell_grad_ptr != nullptr) {
+            for (int64_t abc=0; abc<3; abc++) {
+                auto shift = static_cast<scalar_t>(pair[2 + abc]);
+                if (shift != 0) {
+                    for (int64_t xyz=0; xyz<3; xyz++) {
+                        cell_grad_ptr[3 * abc + xyz] += shift * pair_grad[xyz];
+                    }
+                }
+            }
+        }
+    }
+}
+
+std::vector<torch::Tensor> NeighborsAutogradBackward::forward(
+    torch::autograd::AutogradContext* ctx,
+    torch::Tensor distances_grad,
+    torch::Tensor samples,
+    torch::Tensor positions,
+    torch::Tensor cell,
+    bool positions_requires_grad,
+    bool cell_requires_grad
+) {
+    METATENSOR_TORCH_RECORD_FUNCTION("metatensor::NeighborsAutogradBackward::forward");
+
+    // with mixed precision, the distances can have a lower precision than
+    // the positions and cell. The gradients are accumulated with the
+    // precision of the positions and cell.
+    auto grad = distances_grad.reshape({-1, 3}).to(positions.scalar_type());
+
     auto positions_grad = torch::Tensor();
-    if (positions.requires_grad()) {
+    if (positions_requires_grad) {
         positions_grad = torch::zeros_like(positions);
-        positions_grad = torch::index_add(
-            positions_grad,
-            /*dim=*/0,
-            /*index=*/samples.index({torch::indexing::Slice(), 1}),
-            /*source=*/distances_grad.squeeze(-1),
-            /*alpha=*/1.0
-        );
-        positions_grad = torch::index_add(
-            positions_grad,
-            /*dim=*/0,
-            /*index=*/samples.index({torch::indexing::Slice(), 0}),
-            /*source=*/distances_grad.squeeze(-1),
-            /*alpha=*/-1.0
-        );
     }
 
     auto cell_grad = torch::Tensor();
-    if (cell.requires_grad()) {
+    if (cell_requires_grad) {
+        cell_grad = torch::zeros_like(cell);
+    }
+
+    auto fused_cpu = positions.device().is_cpu() && (
+        positions.scalar_type() == torch::kFloat64 ||
+        positions.scalar_type() == torch::kFloat32
+    ) && cell.scalar_type() == positions.scalar_type();
+
+    if (positions_requires_grad || cell_requires_grad) {
+        if (fused_cpu) {
+            auto contiguous_grad = grad.contiguous();
+            auto contiguous_samples = samples.contiguous();
+            if (positions.scalar_type() == torch::kFloat64) {
+                neighbors_backward_cpu<double>(contiguous_grad, contiguous_samples, positions_grad, cell_grad);
+            } else {
+                neighbors_backward_cpu<float>(contiguous_grad, contiguous_samples, positions_grad, cell_grad);
+            }
+        } else {
+            if (positions_requires_grad) {
+                // a single scatter for both atoms in the pairs
+                auto index = torch::cat({
+                    samples.index({torch::indexing::Slice(), 1}),
+                    samples.index({torch::indexing::Slice(), 0}),
+                });
+                positions_grad.index_add_(/*dim=*/0, index, torch::cat({grad, -grad}));
+            }
+
+            if (cell_requires_grad) {
+                auto cell_shifts = samples.index({
+                    torch::indexing::Slice(),
+                    torch::indexing::Slice(2, 5)
+                }).to(cell.scalar_type());
+                cell_grad = cell_shifts.t().matmul(grad.to(cell.scalar_type()));
+            }
+        }
+    }
+
+    ctx->save_for_backward({samples});
+    ctx->saved_data["distances_dtype"] = distances_grad.scalar_type();
+    ctx->saved_data["distances_shape"] = distances_grad.sizes();
+
+    return {positions_grad, cell_grad};
+}
+
+std::vector<torch::Tensor> NeighborsAutogradBackward::backward(
+    torch::autograd::AutogradContext* ctx,
+    std::vector<torch::Tensor> outputs_grad
+) {
+    METATENSOR_TORCH_RECORD_FUNCTION("metatensor::NeighborsAutogradBackward::backward");
+    auto positions_grad_grad = outputs_grad[0];
+    auto cell_grad_grad = outputs_grad[1];
+
+    auto samples = ctx->get_saved_variables()[0];
+    auto distances_dtype = ctx->saved_data["distances_dtype"].toScalarType();
+    auto distances_shape = ctx->saved_data["distances_shape"].toIntVector();
+
+    // this is the same transformation as the one going from positions/cell
+    // to the distance vectors
+    auto distances_grad_grad = torch::Tensor();
+    if (positions_grad_grad.defined()) {
+        auto first_atom = samples.index({torch::indexing::Slice(), 0}).to(torch::kInt64);
+        auto second_atom = samples.index({torch::indexing::Slice(), 1}).to(torch::kInt64);
+        distances_grad_grad = positions_grad_grad.index_select(0, second_atom)
+            - positions_grad_grad.index_select(0, first_atom);
+    }
+
+    if (cell_grad_grad.defined()) {
         auto cell_shifts = samples.index({
             torch::indexing::Slice(),
             torch::indexing::Slice(2, 5)
-        }).to(cell.scalar_type());
-        cell_grad = cell_shifts.t().matmul(distances_grad.squeeze(-1));
+        }).to(cell_grad_grad.scalar_type());
+
+        auto cell_contribution = cell_shifts.matmul(cell_grad_grad);
+        if (distances_grad_grad.defined()) {
+            distances_grad_grad = distances_grad_grad + cell_contribution;
+        } else {
+            distances_grad_grad = cell_contribution;
+        }
     }
 
-    return {positions_grad, cell_grad, torch::Tensor(), torch::Tensor()};
+    if (distances_grad_grad.defined()) {
+        distances_grad_grad = distances_grad_grad.to(distances_dtype).reshape(distances_shape);
+    }
+
+    return {
+        distances_grad_grad,
+        torch::Tensor(),
+        torch::Tensor(),
+        torch::Tensor(),
+        torch::Tensor(),
+        torch::Tensor(),
+    };
 }
 
 void metatensor_torch::register_autograd_neighbors(
@@ -267,6 +446,7 @@ void metatensor_torch::register_autograd_neighbors(
     TorchTensorBlock neighbors,
     bool check_consistency
 ) {
+    METATENSOR_TORCH_RECORD_FUNCTION("metatensor::register_autograd_neighbors");
     auto distances = neighbors->values();
     if (distances.requires_grad()) {
         C10_THROW_ERROR(ValueError,
@@ -287,11 +467,12 @@ void metatensor_torch::register_autograd_neighbors(
             );
         }
 
-        if (system->positions().scalar_type() != distances.scalar_type()) {
+        if (!valid_neighbors_dtype(distances.scalar_type(), system->positions().scalar_type())) {
             C10_THROW_ERROR(ValueError,
-                "`system` and `neighbors` must have the same dtype, "
-                "got " + scalar_type_name(system->positions().scalar_type()) +
-                " and " + scalar_type_name(distances.scalar_type())
+                "`neighbors` must have the same dtype as `system`, or a floating "
+                "point dtype with lower precision, got " +
+                scalar_type_name(system->positions().scalar_type()) + " for `system` and " +
+                scalar_type_name(distances.scalar_type()) + " for `neighbors`"
             );
         }
 
@@ -339,6 +520,21 @@ static bool is_floating_point(torch::Dtype dtype) {
 }
 
 SystemHolder::SystemHolder(torch::Tensor types, torch::Tensor positions, torch::Tensor cell, torch::Tensor pbc):
+    SystemHolder(std::move(types), std::move(positions), std::move(cell), std::move(pbc), skip_value_checks{})
+{
+    // if the PBC are False along any directions, we check that the
+    // corresponding cell vectors are zero
+    if (!pbc_.device().is_meta()) {
+        auto cell_where_pbc_is_false = cell_.index({pbc_ == false});
+        if (!torch::all(cell_where_pbc_is_false == 0.0).item<bool>()) {
+            C10_THROW_ERROR(ValueError,
+                "if `pbc` is False along any direction, the corresponding cell vector must be zero"
+            );
+        }
+    }
+}
+
+SystemHolder::SystemHolder(torch::Tensor types, torch::Tensor positions, torch::Tensor cell, torch::Tensor pbc, skip_value_checks):
     types_(std::move(types)),
     positions_(std::move(positions)),
     cell_(std::move(cell)),
@@ -432,17 +628,6 @@ SystemHolder::SystemHolder(torch::Tensor types, torch::Tensor positions, torch::
             scalar_type_name(pbc_.scalar_type()) + " instead"
         );
     }
-
-    // if the PBC are False along any directions, we check that the
-    // corresponding cell vectors are zero
-    if (!pbc_.device().is_meta()) {
-        auto cell_where_pbc_is_false = cell_.index({pbc_ == false});
-        if (!torch::all(cell_where_pbc_is_false == 0.0).item<bool>()) {
-            C10_THROW_ERROR(ValueError,
-                "if `pbc` is False along any direction, the corresponding cell vector must be zero"
-            );
-        }
-    }
 }
 
 
@@ -592,15 +777,18 @@ void SystemHolder::set_pbc(torch::Tensor pbc) {
 
 System SystemHolder::to(
     torch::optional<torch::Dtype> dtype,
-    torch::optional<torch::Device> device
+    torch::optional<torch::Device> device,
+    bool non_blocking
 ) const {
+    non_blocking = non_blocking_transfer(non_blocking, device);
+
     auto system = torch::make_intrusive<SystemHolder>(
         this->types().to(
             /*dtype*/ torch::nullopt,
             /*layout*/ torch::nullopt,
             device,
             /*pin_memory*/ torch::nullopt,
-            /*non_blocking*/ false,
+            non_blocking,
             /*copy*/ false,
             /*memory_format*/ torch::MemoryFormat::Preserve
         ),
@@ -609,7 +797,7 @@ System SystemHolder::to(
             /*layout*/ torch::nullopt,
             device,
             /*pin_memory*/ torch::nullopt,
-            /*non_blocking*/ false,
+            non_blocking,
             /*copy*/ false,
             /*memory_format*/ torch::MemoryFormat::Preserve
         ),
@@ -618,7 +806,7 @@ System SystemHolder::to(
             /*layout*/ torch::nullopt,
             device,
             /*pin_memory*/ torch::nullopt,
-            /*non_blocking*/ false,
+            non_blocking,
             /*copy*/ false,
             /*memory_format*/ torch::MemoryFormat::Preserve
         ),
@@ -627,29 +815,59 @@ System SystemHolder::to(
             /*layout*/ torch::nullopt,
             device,
             /*pin_memory*/ torch::nullopt,
-            /*non_blocking*/ false,
+            non_blocking,
             /*copy*/ false,
             /*memory_format*/ torch::MemoryFormat::Preserve
         )
     );
 
     for (const auto& it: this->neighbors_) {
-        system->add_neighbor_list(it.first, it.second->to(dtype, device));
+        system->add_neighbor_list(it.first, it.second->to(dtype, device, non_blocking));
     }
 
     for (const auto& it: this->data_) {
-        system->add_data(it.first, it.second->to(dtype, device));
+        system->add_data(it.first, it.second->to(dtype, device, non_blocking));
     }
 
     return system;
 }
 
 
+System SystemHolder::pin_memory() const {
+    if (!this->device().is_cpu()) {
+        C10_THROW_ERROR(ValueError,
+            "only systems on CPU can be pinned, this system is on " + this->device().str()
+        );
+    }
+
+    auto pin = [](const torch::Tensor& tensor) {
+        return tensor.is_pinned() ? tensor : tensor.pin_memory();
+    };
+
+    auto system = torch::make_intrusive<SystemHolder>(
+        pin(this->types()),
+        pin(this->positions()),
+        pin(this->cell()),
+        pin(this->pbc())
+    );
+
+    for (const auto& it: this->neighbors_) {
+        system->add_neighbor_list(it.first, it.second->pin_memory());
+    }
+
+    for (const auto& it: this->data_) {
+        system->add_data(it.first, it.second->pin_memory());
+    }
+
+    return system;
+}
+
 System SystemHolder::to_positional(
     torch::IValue positional_1,
     torch::IValue positional_2,
     torch::optional<torch::Dtype> dtype,
-    torch::optional<torch::Device> device
+    torch::optional<torch::Device> device,
+    bool non_blocking
 ) const {
     auto [parsed_dtype, parsed_device] = to_arguments_parse(
         positional_1,
@@ -659,7 +877,7 @@ System SystemHolder::to_positional(
         "`System.to`"
     );
 
-    return this->to(parsed_dtype, parsed_device);
+    return this->to(parsed_dtype, parsed_device, non_blocking);
 }
 
 
@@ -704,7 +922,7 @@ void SystemHolder::add_neighbor_list(NeighborListOptions options, TorchTensorBlo
         );
     }
 
-    if (values.scalar_type() != this->scalar_type()) {
+    if (!valid_neighbors_dtype(values.scalar_type(), this->scalar_type())) {
         C10_THROW_ERROR(ValueError,
             "`neighbors` dtype (" + scalar_type_name(neighbors->values().scalar_type()) +
             ") does not match this system's dtype (" + scalar_type_name(this->scalar_type()) +")"
@@ -729,17 +947,146 @@ void SystemHolder::add_neighbor_list(NeighborListOptions options, TorchTensorBlo
     }
 
     neighbors_.emplace(std::move(options), std::move(neighbors));
+    // the new list might be a better source for the derived ones
+    auto lock = std::lock_guard<std::mutex>(derived_neighbors_mutex_);
+    derived_neighbors_.clear();
+}
+
+std::map<NeighborListOptions, TorchTensorBlock, details::nl_options_compare>::const_iterator
+SystemHolder::find_neighbors_source(const NeighborListOptions& options) const {
+    auto source = neighbors_.end();
+    for (auto it = neighbors_.begin(); it != neighbors_.end(); it++) {
+        const auto& known = it->first;
+        if (known->cutoff() < options->cutoff()) {
+            continue;
+        }
+
+        if (source == neighbors_.end()) {
+            source = it;
+            continue;
+        }
+
+        // prefer lists which only need to be filtered, and then lists with
+        // the smallest cutoff (i.e. the smallest number of pairs)
+        auto same_kind = known->full_list() == options->full_list();
+        auto source_same_kind = source->first->full_list() == options->full_list();
+        if (same_kind != source_same_kind) {
+            if (same_kind) {
+                source = it;
+            }
+        } else if (known->cutoff() < source->first->cutoff()) {
+            source = it;
+        }
+    }
+
+    return source;
+}
+
+/// Derive a neighbor list for `options` from the `neighbors` computed with
+/// `source` options. This only uses differentiable operations on the values,
+/// so gradients flow back to the `neighbors` values.
+static TorchTensorBlock derive_neighbor_list(
+    const TorchTensorBlock& neighbors,
+    const NeighborListOptions& source,
+    const NeighborListOptions& options
+) {
+    METATENSOR_TORCH_RECORD_FUNCTION("metatensor::System::derive_neighbor_list");
+    using torch::indexing::Slice;
+
+    auto samples = neighbors->samples()->values();
+    auto values = neighbors->values();
+
+    if (source->cutoff() > options->cutoff()) {
+        // only keep the pairs within the requested cutoff, computing the
+        // distances in at least single precision
+        auto vectors = values.detach();
+        if (vectors.element_size() < 4) {
+            vectors = vectors.to(torch::kFloat32);
+        }
+        auto cutoff2 = options->cutoff() * options->cutoff();
+        auto selected = torch::nonzero(vectors.square().sum({1, 2}) < cutoff2).reshape({-1});
+
+        samples = samples.index_select(0, selected);
+        values = values.index_select(0, selected);
+    }
+
+    if (source->full_list() && !options->full_list()) {
+        // keep i->j for i < j, and i->i only for the cell shifts where the
+        // first non-zero shift is positive
+        auto first = samples.index({Slice(), 0});
+        auto second = samples.index({Slice(), 1});
+        auto shift_a = samples.index({Slice(), 2});
+        auto shift_b = samples.index({Slice(), 3});
+        auto shift_c = samples.index({Slice(), 4});
+
+        auto positive_shift = (shift_a > 0)
+            .logical_or(shift_a.eq(0).logical_and(shift_b > 0))
+            .logical_or(shift_a.eq(0).logical_and(shift_b.eq(0)).logical_and(shift_c > 0));
+        auto keep = (first < second).logical_or(first.eq(second).logical_and(positive_shift));
+        auto selected = torch::nonzero(keep).reshape({-1});
+
+        samples = samples.index_select(0, selected);
+        values = values.index_select(0, selected);
+    } else if (!source->full_list() && options->full_list()) {
+        // add the j->i pairs, with opposite cell shifts and vectors
+        auto reversed = torch::stack({
+            samples.index({Slice(), 1}),
+            samples.index({Slice(), 0}),
+            -samples.index({Slice(), 2}),
+            -samples.index({Slice(), 3}),
+            -samples.index({Slice(), 4}),
+        }, 1);
+
+        samples = torch::cat({samples, reversed});
+        values = torch::cat({values, -values});
+    }
+
+    // the pairs are unique since they are unique in the original list
+    auto new_samples = torch::make_intrusive<LabelsHolder>(
+        neighbors->samples()->names(), samples, /*assume_unique=*/true
+    );
+
+    return torch::make_intrusive<TensorBlockHolder>(
+        values,
+        std::move(new_samples),
+        neighbors->components(),
+        neighbors->properties()
+    );
 }
 
 TorchTensorBlock SystemHolder::get_neighbor_list(NeighborListOptions options) const {
     auto it = neighbors_.find(options);
-    if (it == neighbors_.end()) {
+    if (it != neighbors_.end()) {
+        return it->second;
+    }
+
+    {
+        auto lock = std::lock_guard<std::mutex>(derived_neighbors_mutex_);
+        auto derived = derived_neighbors_.find(options);
+        if (derived != derived_neighbors_.end()) {
+            return derived->second;
+        }
+    }
+
+    auto source = this->find_neighbors_source(options);
+    if (source == neighbors_.end()) {
         C10_THROW_ERROR(ValueError,
             "No neighbor list for " + options->str() + " was found.\n"
             "Is it part of the `requested_neighbor_lists` for this model?"
         );
     }
-    return it->second;
+
+    auto neighbors = derive_neighbor_list(source->second, source->first, options);
+
+    // if another thread derived the same list in the meantime, use the
+    // first one to always return the same block
+    auto lock = std::lock_guard<std::mutex>(derived_neighbors_mutex_);
+    return derived_neighbors_.emplace(std::move(options), neighbors).first->second;
+}
+
+bool SystemHolder::has_neighbor_list(NeighborListOptions options) const {
+    return neighbors_.find(options) != neighbors_.end() ||
+        this->find_neighbors_source(options) != neighbors_.end();
 }
 
 std::vector<NeighborListOptions> SystemHolder::known_neighbor_lists() const {
@@ -874,3 +1221,183 @@ std::string SystemHolder::str() const {
 
     return result.str();
 }
+
+/******************************************************************************/
+
+SystemBatchHolder::SystemBatchHolder(std::vector<System> systems):
+    systems_(std::move(systems))
+{
+    if (systems_.empty()) {
+        C10_THROW_ERROR(ValueError, "a `SystemBatch` must contain at least one system");
+    }
+
+    const auto& first = systems_[0];
+    auto device = first->device();
+    auto dtype = first->scalar_type();
+    auto neighbor_lists = first->known_neighbor_lists();
+
+    auto all_types = std::vector<torch::Tensor>();
+    auto all_positions = std::vector<torch::Tensor>();
+    auto all_cells = std::vector<torch::Tensor>();
+    auto all_pbcs = std::vector<torch::Tensor>();
+
+    // the offsets are computed on CPU, and sent to the device once at the end
+    auto offsets = std::vector<int64_t>{0};
+    offsets.reserve(systems_.size() + 1);
+
+    for (size_t i=0; i<systems_.size(); i++) {
+        const auto& system = systems_[i];
+        if (system->device() != device) {
+            C10_THROW_ERROR(ValueError,
+                "all systems in a `SystemBatch` must be on the same device, got " +
+                device.str() + " and " + system->device().str()
+            );
+        }
+
+        if (system->scalar_type() != dtype) {
+            C10_THROW_ERROR(ValueError,
+                "all systems in a `SystemBatch` must have the same dtype, got " +
+                scalar_type_name(dtype) + " and " + scalar_type_name(system->scalar_type())
+            );
+        }
+
+        auto system_neighbor_lists = system->known_neighbor_lists();
+        auto same_neighbor_lists = system_neighbor_lists.size() == neighbor_lists.size();
+        for (size_t j=0; same_neighbor_lists && j<neighbor_lists.size(); j++) {
+            same_neighbor_lists = (system_neighbor_lists[j] == neighbor_lists[j]);
+        }
+
+        if (!same_neighbor_lists) {
+            C10_THROW_ERROR(ValueError,
+                "all systems in a `SystemBatch` must contain the same neighbor "
+                "lists, but system " + std::to_string(i) + " has different "
+                "neighbor lists than system 0"
+            );
+        }
+
+        all_types.push_back(system->types());
+        all_positions.push_back(system->positions());
+        all_cells.push_back(system->cell());
+        all_pbcs.push_back(system->pbc());
+        offsets.push_back(offsets.back() + system->size());
+    }
+
+    types_ = torch::cat(all_types);
+    positions_ = torch::cat(all_positions);
+    cells_ = torch::stack(all_cells);
+    pbcs_ = torch::stack(all_pbcs);
+
+    auto cpu_offsets = torch::tensor(offsets, torch::TensorOptions().dtype(torch::kInt64));
+    auto cpu_system_indices = torch::repeat_interleave(
+        torch::arange(this->size(), torch::TensorOptions().dtype(torch::kInt32)),
+        cpu_offsets.slice(0, 1) - cpu_offsets.slice(0, 0, -1)
+    );
+    offsets_ = cpu_offsets.to(device);
+    system_indices_ = cpu_system_indices.to(device);
+
+    for (const auto& options: neighbor_lists) {
+        auto all_neighbors = std::vector<TorchTensorBlock>();
+        auto all_samples = std::vector<torch::Tensor>();
+        auto all_values = std::vector<torch::Tensor>();
+        for (const auto& system: systems_) {
+            auto neighbors = system->get_neighbor_list(options);
+
+            // the samples are concatenated on CPU, using the values stored
+            // in metatensor-core labels (which are always on CPU)
+            const auto& labels = neighbors->samples()->as_metatensor();
+            all_samples.push_back(torch::from_blob(
+                const_cast<int32_t*>(labels.values().data()),
+                {static_cast<int64_t>(labels.count()), static_cast<int64_t>(labels.size())},
+                torch::TensorOptions().dtype(torch::kInt32)
+            ));
+            all_values.push_back(neighbors->values());
+            all_neighbors.emplace_back(std::move(neighbors));
+        }
+
+        // shift the atom indexes to refer to the packed arrays
+        auto packed_samples = torch::cat(all_samples);
+        int64_t start = 0;
+        for (size_t i=0; i<systems_.size(); i++) {
+            auto n_pairs = all_samples[i].size(0);
+            packed_samples.narrow(0, start, n_pairs).narrow(1, 0, 2).add_(offsets[i]);
+            start += n_pairs;
+        }
+
+        const auto& first_neighbors = all_neighbors[0];
+
+        // all pairs are unique, since the atoms from different systems have
+        // different indexes in the packed arrays
+        auto samples = torch::make_intrusive<LabelsHolder>(
+            first_neighbors->samples()->names(),
+            std::move(packed_samples),
+            /*assume_unique=*/true
+        )->to(device);
+
+        auto neighbors = torch::make_intrusive<TensorBlockHolder>(
+            torch::cat(all_values),
+            std::move(samples),
+            first_neighbors->components(),
+            first_neighbors->properties()
+        );
+
+        neighbors_.emplace(options, std::move(neighbors));
+    }
+}
+
+SystemBatch SystemBatchHolder::to(
+    torch::optional<torch::Dtype> dtype,
+    torch::optional<torch::Device> device,
+    bool non_blocking
+) const {
+    auto systems = std::vector<System>();
+    systems.reserve(systems_.size());
+    for (const auto& system: systems_) {
+        systems.push_back(system->to(dtype, device, non_blocking));
+    }
+
+    return torch::make_intrusive<SystemBatchHolder>(std::move(systems));
+}
+
+SystemBatch SystemBatchHolder::to_positional(
+    torch::IValue positional_1,
+    torch::IValue positional_2,
+    torch::optional<torch::Dtype> dtype,
+    torch::optional<torch::Device> device,
+    bool non_blocking
+) const {
+    auto [parsed_dtype, parsed_device] = to_arguments_parse(
+        positional_1,
+        positional_2,
+        dtype,
+        device,
+        "`SystemBatch.to`"
+    );
+
+    return this->to(parsed_dtype, parsed_device, non_blocking);
+}
+
+TorchTensorBlock SystemBatchHolder::get_neighbor_list(NeighborListOptions options) const {
+    auto it = neighbors_.find(options);
+    if (it == neighbors_.end()) {
+        C10_THROW_ERROR(ValueError,
+            "No neighbor list for " + options->str() + " was found in this batch.\n"
+            "Is it part of the `requested_neighbor_lists` for this model?"
+        );
+    }
+    return it->second;
+}
+
+std::vector<NeighborListOptions> SystemBatchHolder::known_neighbor_lists() const {
+    auto result = std::vector<NeighborListOptions>();
+    for (const auto& it: neighbors_) {
+        result.emplace_back(it.first);
+    }
+    return result;
+}
+
+std::string SystemBatchHolder::str() const {
+    auto result = std::ostringstream();
+    result << "SystemBatch with " << this->size() << " systems and ";
+    result << this->positions_.size(0) << " atoms";
+    return result.str();
+}
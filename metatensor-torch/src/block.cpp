@@ -7,6 +7,7 @@
 #include "metatensor/torch/block.hpp"
 #include "metatensor/torch/misc.hpp"
 
+#include "internal/serialization.hpp"
 #include "internal/utils.hpp"
 
 using namespace metatensor_torch;
@@ -76,26 +77,48 @@ TorchTensorBlock TensorBlockHolder::copy() const {
     return torch::make_intrusive<TensorBlockHolder>(this->block_.clone(), torch::IValue());
 }
 
+TorchTensorBlock TensorBlockHolder::shallow_copy() const {
+    auto block = torch::make_intrusive<TensorBlockHolder>(
+        this->values(),
+        this->samples(),
+        this->components(),
+        this->properties()
+    );
+
+    for (const auto& parameter : this->gradients_list()) {
+        auto gradient = TensorBlockHolder(
+            this->block_.gradient(parameter),
+            torch::IValue()
+        );
+
+        block->add_gradient(parameter, gradient.shallow_copy());
+    }
+    return block;
+}
+
 TorchTensorBlock TensorBlockHolder::to(
     torch::optional<torch::Dtype> dtype,
-    torch::optional<torch::Device> device
+    torch::optional<torch::Device> device,
+    bool non_blocking
 ) const {
+    non_blocking = non_blocking_transfer(non_blocking, device);
+
     auto values = this->values().to(
         dtype,
         /*layout*/ torch::nullopt,
         device,
         /*pin_memory*/ torch::nullopt,
-        /*non_blocking*/ false,
+        non_blocking,
         /*copy*/ false,
         /*memory_format*/ torch::MemoryFormat::Preserve
     );
 
-    auto samples = this->samples()->to(device);
+    auto samples = this->samples()->to(device, non_blocking);
     auto components = std::vector<torch::intrusive_ptr<LabelsHolder>>();
     for (const auto& component : this->components()) {
-        components.push_back(component->to(device));
+        components.push_back(component->to(device, non_blocking));
     }
-    auto properties = this->properties()->to(device);
+    auto properties = this->properties()->to(device, non_blocking);
 
     auto block = torch::make_intrusive<TensorBlockHolder>(values, samples, components, properties);
     for (const auto& parameter : this->gradients_list()) {
@@ -104,7 +127,38 @@ TorchTensorBlock TensorBlockHolder::to(
             torch::IValue()
         );
 
-        block->add_gradient(parameter, gradient.to(dtype, device));
+        block->add_gradient(parameter, gradient.to(dtype, device, non_blocking));
+    }
+    return block;
+}
+
+TorchTensorBlock TensorBlockHolder::pin_memory() const {
+    auto values = this->values();
+    if (!values.device().is_cpu()) {
+        C10_THROW_ERROR(ValueError,
+            "only blocks on CPU can be pinned, this block is on " + values.device().str()
+        );
+    }
+
+    auto components = std::vector<torch::intrusive_ptr<LabelsHolder>>();
+    for (const auto& component : this->components()) {
+        components.push_back(component->pin_memory());
+    }
+
+    auto block = torch::make_intrusive<TensorBlockHolder>(
+        values.is_pinned() ? values : values.pin_memory(),
+        this->samples()->pin_memory(),
+        std::move(components),
+        this->properties()->pin_memory()
+    );
+
+    for (const auto& parameter : this->gradients_list()) {
+        auto gradient = TensorBlockHolder(
+            this->block_.gradient(parameter),
+            torch::IValue()
+        );
+
+        block->add_gradient(parameter, gradient.pin_memory());
     }
     return block;
 }
@@ -114,7 +168,8 @@ TorchTensorBlock TensorBlockHolder::to_positional(
     torch::IValue positional_2,
     torch::optional<torch::Dtype> dtype,
     torch::optional<torch::Device> device,
-    torch::optional<std::string> arrays
+    torch::optional<std::string> arrays,
+    bool non_blocking
 ) const {
     if (arrays.value_or("torch") != "torch") {
         C10_THROW_ERROR(ValueError,
@@ -130,15 +185,10 @@ TorchTensorBlock TensorBlockHolder::to_positional(
         "`TensorBlock.to`"
     );
 
-    return this->to(parsed_dtype, parsed_device);
+    return this->to(parsed_dtype, parsed_device, non_blocking);
 }
 
-torch::Tensor TensorBlockHolder::values() const {
-    // const_cast is fine here, because the returned torch::Tensor does not
-    // allow modifications to the underlying mts_array (only to the values
-    // inside the tensor).
-    auto array = const_cast<metatensor::TensorBlock&>(block_).mts_array();
-
+static TorchDataArray& torch_data_array(mts_array_t array) {
     mts_data_origin_t origin = 0;
     metatensor::details::check_status(array.origin(array.ptr, &origin));
     if (origin != TORCH_DATA_ORIGIN) {
@@ -155,7 +205,54 @@ torch::Tensor TensorBlockHolder::values() const {
         );
     }
 
-    return wrapper->tensor();
+    return *wrapper;
+}
+
+bool metatensor_torch::details::is_serializable(const metatensor::TensorBlock& block) {
+    auto array = const_cast<metatensor::TensorBlock&>(block).mts_array();
+    // this is `false` for sparse tensors
+    if (!torch_data_array(array).is_contiguous()) {
+        return false;
+    }
+
+    for (const auto& parameter: block.gradients_list()) {
+        if (!details::is_serializable(block.gradient(parameter))) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+metatensor::TensorBlock metatensor_torch::details::serializable_copy(const metatensor::TensorBlock& block) {
+    auto array = const_cast<metatensor::TensorBlock&>(block).mts_array();
+    auto tensor = torch_data_array(array).tensor();
+    if (tensor.is_sparse()) {
+        tensor = tensor.to_dense();
+    } else {
+        tensor = tensor.contiguous();
+    }
+
+    auto result = metatensor::TensorBlock(
+        std::make_unique<TorchDataArray>(std::move(tensor)),
+        block.samples(),
+        block.components(),
+        block.properties()
+    );
+
+    for (const auto& parameter: block.gradients_list()) {
+        result.add_gradient(parameter, details::serializable_copy(block.gradient(parameter)));
+    }
+
+    return result;
+}
+
+torch::Tensor TensorBlockHolder::values() const {
+    // const_cast is fine here, because the returned torch::Tensor does not
+    // allow modifications to the underlying mts_array (only to the values
+    // inside the tensor).
+    auto array = const_cast<metatensor::TensorBlock&>(block_).mts_array();
+    return torch_data_array(array).tensor();
 }
 
 TorchLabels TensorBlockHolder::labels(uintptr_t axis) const {
@@ -218,6 +315,30 @@ std::vector<std::tuple<std::string, TorchTensorBlock>> TensorBlockHolder::gradie
     return result;
 }
 
+std::tuple<torch::Tensor, torch::Tensor> TensorBlockHolder::gradient_sample_index(const std::string& parameter) const {
+    // const_cast is fine here, the gradient is only used to read its samples
+    // and to store the cached index in the corresponding array
+    auto gradient = const_cast<metatensor::TensorBlock&>(block_).gradient(parameter);
+    auto& array = torch_data_array(gradient.mts_array());
+
+    return array.sample_index([&]() {
+        auto n_samples = this->len();
+        auto gradient_samples = torch::make_intrusive<LabelsHolder>(gradient.samples());
+        auto sample = gradient_samples->values().select(1, 0).to(
+            torch::TensorOptions().dtype(torch::kInt64).device(this->device())
+        );
+
+        auto counts = torch::bincount(sample, /*weights=*/{}, n_samples);
+        auto offsets = torch::cat({
+            torch::zeros({1}, counts.options()),
+            torch::cumsum(counts, 0),
+        });
+
+        auto rows = std::get<1>(torch::sort(sample, /*stable=*/c10::optional<bool>(true), /*dim=*/0, /*descending=*/false));
+        return std::make_tuple(std::move(offsets), std::move(rows));
+    });
+}
+
 static void print_labels(std::ostringstream& output, const metatensor::Labels& labels, const char* labels_kind) {
     output << "    " << labels_kind << " (" << labels.count() << "): ";
     output << "[";
@@ -288,16 +409,23 @@ std::string TensorBlockHolder::repr() const {
     return output.str();
 }
 
-TorchTensorBlock TensorBlockHolder::load(const std::string& path) {
-    return torch::make_intrusive<TensorBlockHolder>(
-        TensorBlockHolder(
-            metatensor::io::load_block(path, details::create_torch_array),
-            /*parent=*/torch::IValue()
-        )
+TorchTensorBlock TensorBlockHolder::load(
+    const std::string& path,
+    torch::optional<torch::Dtype> dtype,
+    torch::optional<torch::Device> device
+) {
+    return TensorBlockHolder::from_loaded(
+        metatensor::io::load_block(path, details::create_array_for(dtype, device)),
+        dtype,
+        device
     );
 }
 
-TorchTensorBlock TensorBlockHolder::load_buffer(torch::Tensor buffer) {
+TorchTensorBlock TensorBlockHolder::load_buffer(
+    torch::Tensor buffer,
+    torch::optional<torch::Dtype> dtype,
+    torch::optional<torch::Device> device
+) {
     if (buffer.scalar_type() != torch::kUInt8) {
         C10_THROW_ERROR(ValueError,
             "`buffer` must be a tensor of uint8, not " +
@@ -314,21 +442,80 @@ TorchTensorBlock TensorBlockHolder::load_buffer(torch::Tensor buffer) {
     auto block = metatensor::io::load_block_buffer(
         buffer.data_ptr<uint8_t>(),
         static_cast<size_t>(buffer.size(0)),
-        details::create_torch_array
+        details::create_array_for(dtype, device)
+    );
+
+    return TensorBlockHolder::from_loaded(std::move(block), dtype, device);
+}
+
+TorchTensorBlock TensorBlockHolder::from_loaded(
+    metatensor::TensorBlock block,
+    torch::optional<torch::Dtype> dtype,
+    torch::optional<torch::Device> device
+) {
+    if (!device.has_value() || device->is_cpu()) {
+        auto torch_block = torch::make_intrusive<TensorBlockHolder>(
+            TensorBlockHolder(std::move(block), /*parent=*/torch::IValue())
+        );
+
+        if (dtype.has_value() || device.has_value()) {
+            return torch_block->to(dtype, device);
+        }
+        return torch_block;
+    }
+
+    auto values = torch_data_array(block.mts_array()).tensor().to(
+        dtype,
+        /*layout*/ torch::nullopt,
+        device,
+        /*pin_memory*/ torch::nullopt,
+        /*non_blocking*/ device->is_cuda(),
+        /*copy*/ false,
+        /*memory_format*/ torch::MemoryFormat::Preserve
     );
 
+    auto components = std::vector<TorchLabels>();
+    for (auto& component: block.components()) {
+        components.push_back(LabelsHolder::from_metatensor(std::move(component), device.value()));
+    }
+
+    auto torch_block = torch::make_intrusive<TensorBlockHolder>(
+        std::move(values),
+        LabelsHolder::from_metatensor(block.samples(), device.value()),
+        std::move(components),
+        LabelsHolder::from_metatensor(block.properties(), device.value())
+    );
+
+    for (const auto& parameter: block.gradients_list()) {
+        torch_block->add_gradient(
+            parameter,
+            TensorBlockHolder::from_loaded(block.gradient(parameter), dtype, device)
+        );
+    }
+
+    return torch_block;
+}
+
+TorchTensorBlock TensorBlockHolder::load_mmap(const std::string& path) {
     return torch::make_intrusive<TensorBlockHolder>(
-        TensorBlockHolder(std::move(block), /*parent=*/torch::IValue())
+        TensorBlockHolder(
+            metatensor::io::load_block_mmap(path, details::create_torch_mmap_array),
+            /*parent=*/torch::IValue()
+        )
     );
 }
 
 
 void TensorBlockHolder::save(const std::string& path) const {
-    return metatensor::io::save(path, this->as_metatensor());
+    details::with_serializable(this->as_metatensor(), [&](const metatensor::TensorBlock& block) {
+        metatensor::io::save(path, block);
+    });
 }
 
 torch::Tensor TensorBlockHolder::save_buffer() const {
-    auto buffer = metatensor::io::save_buffer(this->as_metatensor());
+    auto buffer = details::with_serializable(this->as_metatensor(), [](const metatensor::TensorBlock& block) {
+        return metatensor::io::save_buffer(block);
+    });
     // move the buffer to the heap so it can escape this function
     // `torch::from_blob` does not take ownership of the data,
     // so we need to register a custom deleter to clean up when
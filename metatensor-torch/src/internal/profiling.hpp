@@ -0,0 +1,14 @@
+#ifndef METATENSOR_TORCH_PROFILING_HPP
+#define METATENSOR_TORCH_PROFILING_HPP
+
+// Record the current scope as `name` in torch profiler traces. This has a very
+// low overhead when the profiler is not running, and can be removed entirely
+// by configuring with `-DMETATENSOR_TORCH_PROFILING=OFF`.
+#ifdef METATENSOR_TORCH_DISABLE_PROFILING
+    #define METATENSOR_TORCH_RECORD_FUNCTION(name) do {} while (false)
+#else
+    #include <ATen/record_function.h>
+    #define METATENSOR_TORCH_RECORD_FUNCTION(name) RECORD_FUNCTION(name, std::vector<c10::IValue>())
+#endif
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef METATENSOR_TORCH_INTERNAL_SERIALIZATION_HPP
+#define METATENSOR_TORCH_INTERNAL_SERIALIZATION_HPP
+
+#include <metatensor.hpp>
+
+namespace metatensor_torch {
+namespace details {
+    /// Check if all the arrays in `block` (including gradients) can be given
+    /// as-is to metatensor-core for serialization, i.e. if they are dense and
+    /// contiguous.
+    bool is_serializable(const metatensor::TensorBlock& block);
+
+    /// Check if all the arrays in all the blocks of `tensor` can be given
+    /// as-is to metatensor-core for serialization.
+    bool is_serializable(const metatensor::TensorMap& tensor);
+
+    /// Create a new block with the same metadata as `block`, where all the
+    /// arrays are dense and contiguous.
+    ///
+    /// Arrays which are already dense and contiguous are shared with `block`,
+    /// the others (sparse tensors and non-contiguous views) are copied. The
+    /// copies are owned by the new block, and `block` is not modified.
+    metatensor::TensorBlock serializable_copy(const metatensor::TensorBlock& block);
+
+    /// Create a new tensor map with the same keys as `tensor`, containing the
+    /// `serializable_copy` of each block in `tensor`.
+    metatensor::TensorMap serializable_copy(const metatensor::TensorMap& tensor);
+
+    /// Call `function` with a version of `data` (either a
+    /// `metatensor::TensorBlock` or a `metatensor::TensorMap`) which can be
+    /// serialized by metatensor-core. If `data` is not serializable as-is, the
+    /// dense and contiguous copies only live for the duration of the call.
+    template <typename T, typename Function>
+    auto with_serializable(const T& data, Function function) -> decltype(function(data)) {
+        if (is_serializable(data)) {
+            return function(data);
+        }
+
+        auto copy = serializable_copy(data);
+        return function(static_cast<const T&>(copy));
+    }
+}
+}
+
+#endif
@@ -1,7 +1,10 @@
 #ifndef METATENSOR_TORCH_UTILS_HPP
 #define METATENSOR_TORCH_UTILS_HPP
 
+#include <cassert>
+
 #include <torch/types.h>
+#include <torch/custom_class.h>
 
 namespace metatensor_torch {
 namespace {
@@ -39,6 +42,37 @@ inline std::string scalar_type_name(torch::ScalarType scalar_type) {
     }
 }
 
+/// Check if `ivalue` (which must contain a custom class) contains an instance
+/// of the custom class `T`
+template <typename T>
+inline bool custom_class_is(const torch::IValue& ivalue) {
+    assert(ivalue.isCustomClass());
+
+    // this is inspired by the code inside `torch::IValue.toCustomClass<T>()`
+    auto* expected_type = torch::getCustomClassType<torch::intrusive_ptr<T>>().get();
+    return ivalue.type().get() == expected_type;
+}
+
+/// Check if `dtype` can be used for the distances in neighbor lists of a
+/// system using `system_dtype`: either both are the same, or `dtype` is a
+/// floating point type with lower precision (for mixed-precision calculations)
+inline bool valid_neighbors_dtype(torch::Dtype dtype, torch::Dtype system_dtype) {
+    if (dtype == system_dtype) {
+        return true;
+    }
+
+    return torch::isFloatingType(dtype) && torch::isFloatingType(system_dtype) &&
+        c10::elementSize(dtype) < c10::elementSize(system_dtype);
+}
+
+/// Get the `non_blocking` flag to use when moving data to `device` inside the
+/// `to` functions. Transfers to the CPU are always blocking, since the data
+/// could be read from the CPU right away (for example to create metatensor
+/// Labels) without any synchronization with the device.
+inline bool non_blocking_transfer(bool non_blocking, torch::optional<torch::Device> device) {
+    return non_blocking && device.has_value() && !device->is_cpu();
+}
+
 /// Parse the arguments to the `to` function
 inline std::tuple<torch::optional<torch::Dtype>, torch::optional<torch::Device>>
 to_arguments_parse(
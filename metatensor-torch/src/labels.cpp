@@ -1,4 +1,6 @@
 #include <cassert>
+#include <algorithm>
+#include <limits>
 
 #include <torch/version.h>
 #include <torch/torch.h>
@@ -6,6 +8,7 @@
 #include <metatensor.hpp>
 
 #include "metatensor/torch/labels.hpp"
+#include "internal/profiling.hpp"
 #include "internal/utils.hpp"
 
 using namespace metatensor_torch;
@@ -28,6 +31,45 @@ static torch::Tensor normalize_int32_tensor(torch::Tensor values, size_t shape_l
     return values.to(torch::kI32);
 }
 
+/// Register `values` as the user data of `labels`, allowing to get the
+/// tensor back when retrieving Labels from metatensor-core
+static void register_values_user_data(metatensor::Labels& labels, const torch::Tensor& values) {
+    auto user_data = metatensor::LabelsUserData(
+        new torch::Tensor(values),
+        [](void* tensor) { delete static_cast<torch::Tensor*>(tensor); }
+    );
+    labels.set_user_data(std::move(user_data));
+}
+
+/// Create metatensor-core labels with the given `names` and `values`. The
+/// core labels directly use the memory of a contiguous CPU version of `values`
+/// (which is `values` itself if it is already contiguous and on CPU) instead of
+/// making a copy, and keep a reference to the tensor alive.
+///
+/// The memory borrowed by the core labels must never be modified, so `values`
+/// must not be shared with data visible to users, other than the values of the
+/// `LabelsHolder` using these core labels.
+static metatensor::Labels create_metatensor_labels(
+    const std::vector<std::string>& names,
+    const torch::Tensor& values,
+    bool assume_unique
+) {
+    auto* cpu_values = new torch::Tensor(values.to(torch::kCPU).contiguous());
+    try {
+        return metatensor::Labels::borrowed(
+            names,
+            cpu_values->data_ptr<int32_t>(),
+            static_cast<size_t>(cpu_values->size(0)),
+            cpu_values,
+            [](void* tensor) { delete static_cast<torch::Tensor*>(tensor); },
+            assume_unique
+        );
+    } catch (...) {
+        delete cpu_values;
+        throw;
+    }
+}
+
 static torch::Tensor initializer_list_to_tensor(
     const std::vector<std::initializer_list<int32_t>>& values,
     size_t size
@@ -107,36 +149,38 @@ LabelsHolder::LabelsHolder(
     assert(values_.scalar_type() == torch::kInt32);
 
     // register the torch tensor as a custom user data stored inside the labels
-    auto user_data = metatensor::LabelsUserData(
-        new torch::Tensor(values_),
-        [](void* tensor) { delete static_cast<torch::Tensor*>(tensor); }
-    );
-    labels_->set_user_data(std::move(user_data));
+    register_values_user_data(labels_.value(), values_);
 }
 
-LabelsHolder::LabelsHolder(torch::IValue names, torch::Tensor values):
+LabelsHolder::LabelsHolder(torch::IValue names, torch::Tensor values, bool assume_unique):
     names_(details::normalize_names(names, "names")),
     values_(normalize_int32_tensor(values, 2, "Labels values")),
     labels_(torch::nullopt)
 {
+    METATENSOR_TORCH_RECORD_FUNCTION("metatensor::Labels::Labels");
     if (values_.sizes()[1] != names_.size()) {
         C10_THROW_ERROR(ValueError,
             "invalid Labels: the names must have an entry for each column of the array"
         );
     }
 
-    labels_ = metatensor::Labels(
-        names_,
-        values_.to(torch::kCPU).contiguous().data_ptr<int32_t>(),
-        values_.sizes()[0]
-    );
+    if (values_.device().is_cpu() && (values_.is_alias_of(values) || !values_.is_contiguous())) {
+        // make a single private contiguous copy of the values on CPU, used
+        // both as `values_` and as the memory of the core labels. This
+        // prevents in-place modifications of the input tensor from changing
+        // the core labels.
+        values_ = values_.to(
+            torch::kInt32,
+            /*non_blocking=*/false,
+            /*copy=*/true,
+            torch::MemoryFormat::Contiguous
+        );
+    }
+
+    labels_ = create_metatensor_labels(names_, values_, assume_unique);
 
     // register the torch tensor as a custom user data stored inside the labels
-    auto user_data = metatensor::LabelsUserData(
-        new torch::Tensor(values_),
-        [](void* tensor) { delete static_cast<torch::Tensor*>(tensor); }
-    );
-    labels_->set_user_data(std::move(user_data));
+    register_values_user_data(labels_.value(), values_);
 }
 
 TorchLabels LabelsHolder::create(
@@ -154,6 +198,17 @@ LabelsHolder::LabelsHolder(std::vector<std::string> names, torch::Tensor values,
     labels_(torch::nullopt)
 {}
 
+LabelsHolder::LabelsHolder(std::vector<std::string> names, torch::Tensor values, CreateLazy):
+    names_(std::move(names)),
+    values_(std::move(values)),
+    labels_(torch::nullopt),
+    lazy_labels_(std::make_shared<LazyLabels>())
+{
+    assert(values_.sizes().size() == 2);
+    assert(values_.size(1) == names_.size());
+    assert(values_.scalar_type() == torch::kInt32);
+}
+
 TorchLabels LabelsHolder::view(const TorchLabels& labels, std::vector<std::string> names) {
     if (names.empty()) {
         C10_THROW_ERROR(ValueError,
@@ -222,9 +277,7 @@ LabelsHolder::LabelsHolder(metatensor::Labels labels): labels_(std::move(labels)
 
 
 TorchLabels LabelsHolder::single() {
-    auto options = torch::TensorOptions().dtype(torch::kInt32).device(torch::kCPU);
-    auto values = torch::tensor({0}, options).reshape({1, 1});
-    return torch::make_intrusive<LabelsHolder>("_", std::move(values));
+    return LabelsHolder::range_product("_", {1});
 }
 
 
@@ -237,9 +290,73 @@ TorchLabels LabelsHolder::empty(torch::IValue names_ivalue) {
 
 
 TorchLabels LabelsHolder::range(std::string name, int64_t end) {
-    auto options = torch::TensorOptions().dtype(torch::kInt32).device(torch::kCPU);
-    auto values = torch::arange(end, options).reshape({end, 1});
-    return torch::make_intrusive<LabelsHolder>(name, std::move(values));
+    return LabelsHolder::range_product(std::move(name), {end});
+}
+
+TorchLabels LabelsHolder::range_product(torch::IValue names_ivalue, std::vector<int64_t> ends) {
+    auto names = details::normalize_names(names_ivalue, "names");
+    if (names.size() != ends.size()) {
+        C10_THROW_ERROR(ValueError,
+            "invalid Labels: expected the same number of names and range ends, "
+            "got " + std::to_string(names.size()) + " names and " +
+            std::to_string(ends.size()) + " ends"
+        );
+    }
+
+    if (names.empty()) {
+        C10_THROW_ERROR(ValueError,
+            "invalid Labels: range_product needs at least one dimension"
+        );
+    }
+
+    for (auto end: ends) {
+        if (end < 0 || end > std::numeric_limits<int32_t>::max()) {
+            C10_THROW_ERROR(ValueError,
+                "invalid Labels: the end of the range must be between 0 and "
+                "2^31 - 1, got " + std::to_string(end)
+            );
+        }
+    }
+
+    int64_t count = 1;
+    if (std::find(ends.begin(), ends.end(), 0) != ends.end()) {
+        count = 0;
+    } else {
+        for (auto end: ends) {
+            if (count > std::numeric_limits<int64_t>::max() / end) {
+                C10_THROW_ERROR(ValueError,
+                    "invalid Labels: the product of the range ends is too "
+                    "large, the number of entries does not fit in a 64-bit integer"
+                );
+            }
+            count *= end;
+        }
+    }
+
+    // the metatensor::Labels are created lazily, but we still want to check
+    // the names right away
+    static_cast<void>(metatensor::Labels(names, nullptr, 0));
+
+    auto linear = torch::arange(count, torch::TensorOptions().dtype(torch::kInt64));
+    auto values = torch::empty(
+        {count, static_cast<int64_t>(names.size())},
+        torch::TensorOptions().dtype(torch::kInt32)
+    );
+
+    if (count != 0) {
+        // stride of the dimension `i` in the linear index of the entries
+        int64_t stride = count;
+        for (size_t i=0; i<ends.size(); i++) {
+            stride /= ends[i];
+            values.select(1, static_cast<int64_t>(i)).copy_(
+                linear.div(stride, "floor").remainder(ends[i])
+            );
+        }
+    }
+
+    auto labels = torch::make_intrusive<LabelsHolder>(std::move(names), std::move(values), CreateLazy{});
+    labels->range_ends_ = std::move(ends);
+    return labels;
 }
 
 torch::Tensor LabelsHolder::column(std::string dimension) {
@@ -256,6 +373,18 @@ torch::Tensor LabelsHolder::column(std::string dimension) {
 }
 
 const metatensor::Labels& LabelsHolder::as_metatensor() const {
+    if (lazy_labels_ != nullptr) {
+        // `std::call_once` only synchronizes the threads while the labels are
+        // being created, later calls only check an atomic flag
+        std::call_once(lazy_labels_->once, [&]() {
+            auto labels = create_metatensor_labels(names_, values_, /*assume_unique=*/ true);
+            register_values_user_data(labels, values_);
+            lazy_labels_->labels = std::move(labels);
+        });
+
+        return lazy_labels_->labels.value();
+    }
+
     if (!labels_.has_value()) {
         C10_THROW_ERROR(ValueError,
             "can not call this function on Labels view, call to_owned first"
@@ -266,7 +395,7 @@ const metatensor::Labels& LabelsHolder::as_metatensor() const {
 }
 
 TorchLabels LabelsHolder::to_owned() const {
-    if (labels_.has_value()) {
+    if (!this->is_view()) {
         return torch::make_intrusive<LabelsHolder>(*this);
     } else {
         return torch::make_intrusive<LabelsHolder>(this->names_, values_);
@@ -378,10 +507,17 @@ TorchLabels LabelsHolder::rename(std::string old_name, std::string new_name) con
     auto column_index = it - std::begin(new_names);
 
     new_names[column_index] = std::move(new_name);
+    if (!range_ends_.empty()) {
+        static_cast<void>(metatensor::Labels(new_names, nullptr, 0));
+        auto labels = torch::make_intrusive<LabelsHolder>(std::move(new_names), values_, CreateLazy{});
+        labels->range_ends_ = range_ends_;
+        return labels;
+    }
+
     return torch::make_intrusive<LabelsHolder>(std::move(new_names), this->values());
 }
 
-TorchLabels LabelsHolder::to(torch::IValue device_ivalue) const {
+TorchLabels LabelsHolder::to(torch::IValue device_ivalue, bool non_blocking) const {
     auto device = this->device();
     if (device_ivalue.isNone()) {
         // nothing to do
@@ -394,53 +530,146 @@ TorchLabels LabelsHolder::to(torch::IValue device_ivalue) const {
             "'device' must be a string or a torch.device, got '" + device_ivalue.type()->str() + "' instead"
         );
     }
-    return this->to(device);
+    return this->to(device, non_blocking);
 }
 
-TorchLabels LabelsHolder::to(torch::Device device) const {
+TorchLabels LabelsHolder::to(torch::Device device, bool non_blocking) const {
+    non_blocking = non_blocking_transfer(non_blocking, device);
+
     if (device == values_.device()) {
         // return the same object
         return torch::make_intrusive<LabelsHolder>(*this);
+    } else if (lazy_labels_ != nullptr && (!range_ends_.empty() || (device != torch::kCPU && device != torch::kMeta))) {
+        // keep the labels lazy when moving between devices
+        auto labels = torch::make_intrusive<LabelsHolder>(names_, values_.to(device, non_blocking), CreateLazy{});
+        labels->range_ends_ = range_ends_;
+        return labels;
     } else {
-        auto new_values = values_.to(device);
+        return this->with_new_values(values_.to(device, non_blocking));
+    }
+}
 
-        // re-create new mts_labels_t and from them new metatensor::Labels with
-        // the same names & values, but no user data. The user data will be
-        // re-added in the constructor below to point to `new_values`.
-        //
-        // Doing this here allow to minimize the number of copies of the values
-        // when moving from CPU to GPU.
-        auto raw_labels = this->as_metatensor().as_mts_labels_t();
-        // reset the internal rust pointer, this allows `mts_labels_create` to
-        // create a new rust pointer corresponding to a different object instead
-        // of incrementing the reference count of the existing labels.
-        raw_labels.internal_ptr_ = nullptr;
-        metatensor::details::check_status(mts_labels_create(&raw_labels));
-        auto new_labels = metatensor::Labels(raw_labels);
+TorchLabels LabelsHolder::pin_memory() const {
+    if (!values_.device().is_cpu()) {
+        C10_THROW_ERROR(ValueError,
+            "only Labels on CPU can be pinned, these Labels are on " + values_.device().str()
+        );
+    }
+
+    if (values_.is_pinned()) {
+        return torch::make_intrusive<LabelsHolder>(*this);
+    }
 
+    if (!range_ends_.empty()) {
+        auto labels = torch::make_intrusive<LabelsHolder>(names_, values_.pin_memory(), CreateLazy{});
+        labels->range_ends_ = range_ends_;
+        return labels;
+    }
+
+    return this->with_new_values(values_.pin_memory());
+}
+
+TorchLabels LabelsHolder::with_new_values(torch::Tensor new_values) const {
+    if (new_values.device().is_cpu()) {
+        // `new_values` was just created by moving or pinning `values_`, so the
+        // core labels can directly use its memory instead of another copy
+        new_values = new_values.contiguous();
+        auto new_labels = create_metatensor_labels(names_, new_values, /*assume_unique=*/ true);
         return torch::make_intrusive<LabelsHolder>(
             this->names(),
             std::move(new_values),
             std::move(new_labels)
         );
     }
+
+    // re-create new mts_labels_t and from them new metatensor::Labels with
+    // the same names & values, but no user data. The user data will be
+    // re-added in the constructor below to point to `new_values`.
+    //
+    // Doing this here allow to minimize the number of copies of the values
+    // when moving from CPU to GPU.
+    auto raw_labels = this->as_metatensor().as_mts_labels_t();
+    // reset the internal rust pointer, this allows `mts_labels_create` to
+    // create a new rust pointer corresponding to a different object instead
+    // of incrementing the reference count of the existing labels. The
+    // entries are already known to be unique.
+    raw_labels.internal_ptr_ = nullptr;
+    metatensor::details::check_status(mts_labels_create_assume_unique(&raw_labels));
+    auto new_labels = metatensor::Labels(raw_labels);
+
+    return torch::make_intrusive<LabelsHolder>(
+        this->names(),
+        std::move(new_values),
+        std::move(new_labels)
+    );
+}
+
+/// Get the position of `entry` in the cartesian product of the [0, ends[i])
+/// ranges, or -1 if the entry is not part of it. `entry` must contain
+/// `ends.size()` values.
+static int64_t range_product_position(const std::vector<int64_t>& ends, const int32_t* entry) {
+    int64_t position = 0;
+    for (size_t i=0; i<ends.size(); i++) {
+        if (entry[i] < 0 || entry[i] >= ends[i]) {
+            return -1;
+        }
+        position = position * ends[i] + entry[i];
+    }
+    return position;
+}
+
+/// Get the range of entries starting with `prefix` in the cartesian product of
+/// the [0, ends[i]) ranges. This gives the same result as a binary search in
+/// the (sorted) entries of the product.
+static std::tuple<int64_t, int64_t> range_product_range_of(
+    const std::vector<int64_t>& ends,
+    const std::vector<int32_t>& prefix
+) {
+    int64_t inner = 1;
+    for (size_t i=prefix.size(); i<ends.size(); i++) {
+        inner *= ends[i];
+    }
+
+    // number of prefixes in the product smaller than `prefix`, and number of
+    // prefixes equal to `prefix` (0 or 1)
+    int64_t smaller = 0;
+    int64_t equal = 1;
+    for (size_t i=0; i<prefix.size(); i++) {
+        auto value = static_cast<int64_t>(prefix[i]);
+        if (value < 0 || value >= ends[i]) {
+            smaller = smaller * ends[i] + std::clamp<int64_t>(value, 0, ends[i]);
+            for (size_t j=i + 1; j<prefix.size(); j++) {
+                smaller *= ends[j];
+            }
+            equal = 0;
+            break;
+        }
+        smaller = smaller * ends[i] + value;
+    }
+
+    return std::make_tuple(smaller * inner, (smaller + equal) * inner);
 }
 
 torch::optional<int64_t> LabelsHolder::position(torch::IValue entry) const {
-    const auto& labels = this->as_metatensor();
+    auto find_position = [&](const int32_t* values, size_t size) -> int64_t {
+        if (!range_ends_.empty() && size == range_ends_.size()) {
+            return range_product_position(range_ends_, values);
+        }
+        return this->as_metatensor().position(values, size);
+    };
 
     int64_t position = -1;
     if (entry.isCustomClass()) {
         const auto& labels_entry = entry.toCustomClass<LabelsEntryHolder>();
         auto values = labels_entry->values().to(torch::kCPU).contiguous();
-        position = labels.position(
+        position = find_position(
             static_cast<const int32_t*>(values.data_ptr()),
             values.size(0)
         );
     } else if (entry.isTensor()) {
         auto tensor = normalize_int32_tensor(entry.toTensor(), 1, "entry passed to Labels::position");
         tensor = tensor.to(torch::kCPU).contiguous();
-        position = labels.position(
+        position = find_position(
             static_cast<const int32_t*>(tensor.data_ptr()),
             tensor.size(0)
         );
@@ -449,7 +678,7 @@ torch::optional<int64_t> LabelsHolder::position(torch::IValue entry) const {
         for (const auto& value: entry.toIntList()) {
             int32_values.push_back(static_cast<int32_t>(value));
         }
-        position = labels.position(int32_values);
+        position = find_position(int32_values.data(), int32_values.size());
     } else if (entry.isList()) {
         auto int32_values = std::vector<int32_t>();
         for (const auto& value: entry.toListRef()) {
@@ -462,7 +691,7 @@ torch::optional<int64_t> LabelsHolder::position(torch::IValue entry) const {
                 );
             }
         }
-        position = labels.position(int32_values);
+        position = find_position(int32_values.data(), int32_values.size());
     } else if (entry.isTuple()) {
         auto int32_values = std::vector<int32_t>();
         for (const auto& value: entry.toTupleRef().elements()) {
@@ -475,7 +704,7 @@ torch::optional<int64_t> LabelsHolder::position(torch::IValue entry) const {
                 );
             }
         }
-        position = labels.position(int32_values);
+        position = find_position(int32_values.data(), int32_values.size());
     } else {
         C10_THROW_ERROR(TypeError,
             "parameter to Labels::positions must be a LabelsEntry, tensor, or list/tuple of integers, "
@@ -490,27 +719,207 @@ torch::optional<int64_t> LabelsHolder::position(torch::IValue entry) const {
     }
 }
 
-TorchLabels LabelsHolder::set_union(const TorchLabels& other) const {
-    if (!labels_.has_value() || !other->labels_.has_value()) {
-        C10_THROW_ERROR(ValueError,
-            "can not call this function on Labels view, call to_owned first"
+torch::Tensor LabelsHolder::positions(torch::Tensor entries) const {
+    auto device = entries.device();
+    entries = normalize_int32_tensor(std::move(entries), 2, "entries passed to Labels::positions");
+
+    if (!range_ends_.empty() && entries.size(1) == static_cast<int64_t>(range_ends_.size())) {
+        // compute the positions directly on the device of the entries
+        auto options = torch::TensorOptions().dtype(torch::kInt64).device(device);
+        auto result = torch::zeros({entries.size(0)}, options);
+        auto valid = torch::ones({entries.size(0)}, options.dtype(torch::kBool));
+        for (size_t i=0; i<range_ends_.size(); i++) {
+            auto column = entries.select(1, static_cast<int64_t>(i)).to(torch::kInt64);
+            valid.logical_and_(column >= 0).logical_and_(column < range_ends_[i]);
+            result.mul_(range_ends_[i]).add_(column);
+        }
+        return result.masked_fill_(valid.logical_not(), -1);
+    }
+
+    const auto& labels = this->as_metatensor();
+    entries = entries.to(torch::kCPU).contiguous();
+
+    auto count = static_cast<size_t>(entries.size(0));
+    auto result = torch::empty({entries.size(0)}, torch::TensorOptions().dtype(torch::kInt64));
+    metatensor::details::check_status(mts_labels_positions(
+        labels.as_mts_labels_t(),
+        entries.data_ptr<int32_t>(),
+        count,
+        static_cast<size_t>(entries.size(1)),
+        result.data_ptr<int64_t>()
+    ));
+
+    return result.to(device);
+}
+
+std::tuple<int64_t, int64_t> LabelsHolder::range_of(torch::IValue prefix) const {
+    auto int32_values = std::vector<int32_t>();
+    if (prefix.isTensor()) {
+        auto tensor = normalize_int32_tensor(prefix.toTensor(), 1, "prefix passed to Labels::range_of");
+        tensor = tensor.to(torch::kCPU).contiguous();
+        const auto* data = tensor.data_ptr<int32_t>();
+        int32_values.assign(data, data + tensor.size(0));
+    } else if (prefix.isIntList()) {
+        for (const auto& value: prefix.toIntList()) {
+            int32_values.push_back(static_cast<int32_t>(value));
+        }
+    } else if (prefix.isList()) {
+        for (const auto& value: prefix.toListRef()) {
+            if (value.isInt()) {
+                int32_values.push_back(static_cast<int32_t>(value.toInt()));
+            } else {
+                C10_THROW_ERROR(TypeError,
+                    "list parameter to Labels::range_of must be list of integers, "
+                    "got element with type '" + value.type()->str() + "'"
+                );
+            }
+        }
+    } else if (prefix.isTuple()) {
+        for (const auto& value: prefix.toTupleRef().elements()) {
+            if (value.isInt()) {
+                int32_values.push_back(static_cast<int32_t>(value.toInt()));
+            } else {
+                C10_THROW_ERROR(TypeError,
+                    "tuple parameter to Labels::range_of must be a tuple of integers, "
+                    "got element with type '" + value.type()->str() + "'"
+                );
+            }
+        }
+    } else {
+        C10_THROW_ERROR(TypeError,
+            "prefix passed to Labels::range_of must be a tensor, or list/tuple of integers, "
+            "got '" + prefix.type()->str() + "' instead"
         );
     }
 
-    auto device = this->values_.device();
-    if (device != other->values_.device()) {
+    if (!range_ends_.empty() && int32_values.size() <= range_ends_.size()) {
+        return range_product_range_of(range_ends_, int32_values);
+    }
+
+    auto range = this->as_metatensor().range_of(int32_values);
+    return std::make_tuple(
+        static_cast<int64_t>(range.first),
+        static_cast<int64_t>(range.second)
+    );
+}
+
+/// Give the same integer id to identical entries in `first` and `second`,
+/// using only operations on the device where these tensors live. This returns
+/// the ids of the entries in `first`, the ids of the entries in `second` and
+/// the total number of different ids.
+static std::tuple<torch::Tensor, torch::Tensor, int64_t> device_entries_ids(
+    const torch::Tensor& first,
+    const torch::Tensor& second
+) {
+    auto all_entries = torch::cat({first, second});
+    auto unique = torch::unique_dim(
+        all_entries,
+        /*dim=*/0,
+        /*sorted=*/false,
+        /*return_inverse=*/true
+    );
+
+    auto n_unique = std::get<0>(unique).size(0);
+    const auto& inverse = std::get<1>(unique);
+    return std::make_tuple(
+        inverse.slice(0, 0, first.size(0)),
+        inverse.slice(0, first.size(0)),
+        n_unique
+    );
+}
+
+/// Compute the union of two sets of unique entries using device operations.
+/// The entries and mapping are in the same order as `metatensor::Labels::set_union`.
+static std::tuple<torch::Tensor, torch::Tensor, torch::Tensor> device_union(
+    const torch::Tensor& first,
+    const torch::Tensor& second
+) {
+    auto ids = device_entries_ids(first, second);
+    const auto& first_ids = std::get<0>(ids);
+    const auto& second_ids = std::get<1>(ids);
+
+    auto options = torch::TensorOptions().dtype(torch::kInt64).device(first.device());
+    auto first_mapping = torch::arange(first.size(0), options);
+
+    // position in the union of each entry id coming from `first`
+    auto positions = torch::full({std::get<2>(ids)}, -1, options);
+    positions.index_put_({first_ids}, first_mapping);
+
+    // new entries from `second` are added after all the entries of `first`
+    auto second_positions = positions.index({second_ids});
+    auto is_new = second_positions < 0;
+    auto new_positions = torch::cumsum(is_new, 0) + (first.size(0) - 1);
+    auto second_mapping = torch::where(is_new, new_positions, second_positions);
+
+    auto values = torch::cat({first, second.index({is_new})});
+    return std::make_tuple(values, first_mapping, second_mapping);
+}
+
+/// Compute the intersection of two sets of unique entries using device
+/// operations. The entries and mapping are in the same order as
+/// `metatensor::Labels::set_intersection`.
+static std::tuple<torch::Tensor, torch::Tensor, torch::Tensor> device_intersection(
+    const torch::Tensor& first,
+    const torch::Tensor& second
+) {
+    // metatensor-core uses the order of the entries with fewest entries
+    auto swap = first.size(0) > second.size(0);
+    const auto& smallest = swap ? second : first;
+    const auto& largest = swap ? first : second;
+
+    auto ids = device_entries_ids(smallest, largest);
+    const auto& smallest_ids = std::get<0>(ids);
+    const auto& largest_ids = std::get<1>(ids);
+    auto n_unique = std::get<2>(ids);
+
+    auto device = first.device();
+    auto in_largest = torch::zeros({n_unique}, torch::TensorOptions().dtype(torch::kBool).device(device));
+    in_largest.index_fill_(0, largest_ids, true);
+
+    auto keep = in_largest.index({smallest_ids});
+    auto smallest_mapping = torch::where(keep, torch::cumsum(keep, 0) - 1, -1);
+
+    auto options = torch::TensorOptions().dtype(torch::kInt64).device(device);
+    auto positions = torch::full({n_unique}, -1, options);
+    positions.index_put_({smallest_ids}, smallest_mapping);
+    auto largest_mapping = positions.index({largest_ids});
+
+    auto values = smallest.index({keep});
+    if (swap) {
+        return std::make_tuple(values, largest_mapping, smallest_mapping);
+    } else {
+        return std::make_tuple(values, smallest_mapping, largest_mapping);
+    }
+}
+
+/// Should the set operations between `first` and `second` be executed on the
+/// device with torch operations or on CPU with metatensor-core?
+static bool use_device_operations(const torch::Tensor& first, const torch::Tensor& second) {
+    // metatensor-core is faster for data already on CPU, and we fallback to it
+    // for the edge cases of empty labels. Tensors on the meta device don't
+    // contain any data, so we also need to use metatensor-core for them.
+    auto device = first.device();
+    if (device == torch::kCPU || device == torch::kMeta) {
+        return false;
+    }
+
+    return first.size(0) != 0 && second.size(0) != 0 && first.size(1) != 0;
+}
+
+TorchLabels LabelsHolder::set_union(const TorchLabels& other) const {
+    if (this->values_.device() != other->values_.device()) {
         C10_THROW_ERROR(ValueError,
-            "device mismatch in `Labels.union`: got '" + device.str() +
+            "device mismatch in `Labels.union`: got '" + this->values_.device().str() +
             "' and '" + other->values_.device().str() + "'"
         );
     }
 
-    auto result = LabelsHolder(labels_->set_union(other->labels_.value()));
-    return result.to(device);
+    return std::get<0>(this->union_and_mapping(other));
 }
 
 std::tuple<TorchLabels, torch::Tensor, torch::Tensor> LabelsHolder::union_and_mapping(const TorchLabels& other) const {
-    if (!labels_.has_value() || !other->labels_.has_value()) {
+    METATENSOR_TORCH_RECORD_FUNCTION("metatensor::Labels::union");
+    if (this->is_view() || other->is_view()) {
         C10_THROW_ERROR(ValueError,
             "can not call this function on Labels view, call to_owned first"
         );
@@ -524,12 +933,27 @@ std::tuple<TorchLabels, torch::Tensor, torch::Tensor> LabelsHolder::union_and_ma
         );
     }
 
+    if (use_device_operations(values_, other->values_)) {
+        if (names_ != other->names_) {
+            throw metatensor::Error(
+                "invalid parameter: can not take the union of these Labels, they have different names"
+            );
+        }
+
+        auto result = device_union(values_, other->values_);
+        return std::make_tuple(
+            torch::make_intrusive<LabelsHolder>(names_, std::move(std::get<0>(result)), CreateLazy{}),
+            std::move(std::get<1>(result)),
+            std::move(std::get<2>(result))
+        );
+    }
+
     auto options = torch::TensorOptions().dtype(torch::kInt64).device(torch::kCPU);
     auto first_mapping = torch::zeros({this->count()}, options);
     auto second_mapping = torch::zeros({other->count()}, options);
 
-    auto result = LabelsHolder(labels_->set_union(
-        other->labels_.value(),
+    auto result = LabelsHolder(this->as_metatensor().set_union(
+        other->as_metatensor(),
         first_mapping.data_ptr<int64_t>(),
         first_mapping.size(0),
         second_mapping.data_ptr<int64_t>(),
@@ -544,26 +968,19 @@ std::tuple<TorchLabels, torch::Tensor, torch::Tensor> LabelsHolder::union_and_ma
 }
 
 TorchLabels LabelsHolder::set_intersection(const TorchLabels& other) const {
-    if (!labels_.has_value() || !other->labels_.has_value()) {
-        C10_THROW_ERROR(ValueError,
-            "can not call this function on Labels view, call to_owned first"
-        );
-    }
-
-    auto device = this->values_.device();
-    if (device != other->values_.device()) {
+    if (this->values_.device() != other->values_.device()) {
         C10_THROW_ERROR(ValueError,
-            "device mismatch in `Labels.intersection`: got '" + device.str() +
+            "device mismatch in `Labels.intersection`: got '" + this->values_.device().str() +
             "' and '" + other->values_.device().str() + "'"
         );
     }
 
-    auto result = LabelsHolder(labels_->set_intersection(other->labels_.value()));
-    return result.to(device);
+    return std::get<0>(this->intersection_and_mapping(other));
 }
 
 std::tuple<TorchLabels, torch::Tensor, torch::Tensor> LabelsHolder::intersection_and_mapping(const TorchLabels& other) const {
-    if (!labels_.has_value() || !other->labels_.has_value()) {
+    METATENSOR_TORCH_RECORD_FUNCTION("metatensor::Labels::intersection");
+    if (this->is_view() || other->is_view()) {
         C10_THROW_ERROR(ValueError,
             "can not call this function on Labels view, call to_owned first"
         );
@@ -577,12 +994,27 @@ std::tuple<TorchLabels, torch::Tensor, torch::Tensor> LabelsHolder::intersection
         );
     }
 
+    if (use_device_operations(values_, other->values_)) {
+        if (names_ != other->names_) {
+            throw metatensor::Error(
+                "invalid parameter: can not take the intersection of these Labels, they have different names"
+            );
+        }
+
+        auto result = device_intersection(values_, other->values_);
+        return std::make_tuple(
+            torch::make_intrusive<LabelsHolder>(names_, std::move(std::get<0>(result)), CreateLazy{}),
+            std::move(std::get<1>(result)),
+            std::move(std::get<2>(result))
+        );
+    }
+
     auto options = torch::TensorOptions().dtype(torch::kInt64).device(torch::kCPU);
     auto first_mapping = torch::zeros({this->count()}, options);
     auto second_mapping = torch::zeros({other->count()}, options);
 
-    auto result = LabelsHolder(labels_->set_intersection(
-        other->labels_.value(),
+    auto result = LabelsHolder(this->as_metatensor().set_intersection(
+        other->as_metatensor(),
         first_mapping.data_ptr<int64_t>(),
         first_mapping.size(0),
         second_mapping.data_ptr<int64_t>(),
@@ -597,7 +1029,8 @@ std::tuple<TorchLabels, torch::Tensor, torch::Tensor> LabelsHolder::intersection
 }
 
 torch::Tensor LabelsHolder::select(const TorchLabels& selection) const {
-    if (!labels_.has_value() || !selection->labels_.has_value()) {
+    METATENSOR_TORCH_RECORD_FUNCTION("metatensor::Labels::select");
+    if (this->is_view() || selection->is_view()) {
         C10_THROW_ERROR(ValueError,
             "can not call this function on Labels view, call to_owned first"
         );
@@ -611,19 +1044,59 @@ torch::Tensor LabelsHolder::select(const TorchLabels& selection) const {
         );
     }
 
+    if (!range_ends_.empty() && selection->names_ == names_) {
+        // positions of the selected entries, in the order of the selection
+        auto positions = this->positions(selection->values_);
+        return positions.index({positions >= 0});
+    }
+
+    if (use_device_operations(values_, selection->values_)) {
+        if (selection->names_ == names_) {
+            // positions of the selected entries, in the order of the selection
+            auto ids = device_entries_ids(values_, selection->values_);
+            auto options = torch::TensorOptions().dtype(torch::kInt64).device(device);
+            auto positions = torch::full({std::get<2>(ids)}, -1, options);
+            positions.index_put_({std::get<0>(ids)}, torch::arange(this->count(), options));
+
+            auto selected = positions.index({std::get<1>(ids)});
+            return selected.index({selected >= 0});
+        }
+
+        auto dimensions = std::vector<int64_t>();
+        for (const auto& name: selection->names_) {
+            auto it = std::find(std::begin(names_), std::end(names_), name);
+            if (it == std::end(names_)) {
+                throw metatensor::Error(
+                    "invalid parameter: '" + name + "' in selection is not part of these Labels"
+                );
+            }
+            dimensions.push_back(static_cast<int64_t>(std::distance(std::begin(names_), it)));
+        }
+
+        auto dimensions_tensor = torch::tensor(dimensions, torch::TensorOptions().device(device));
+        auto candidates = values_.index({torch::indexing::Slice(), dimensions_tensor});
+
+        // entries matching the selection, in the order of these labels
+        auto ids = device_entries_ids(candidates, selection->values_);
+        auto in_selection = torch::zeros({std::get<2>(ids)}, torch::TensorOptions().dtype(torch::kBool).device(device));
+        in_selection.index_fill_(0, std::get<1>(ids), true);
+
+        return torch::nonzero(in_selection.index({std::get<0>(ids)})).reshape({-1});
+    }
+
     auto options = torch::TensorOptions().dtype(torch::kInt64).device(torch::kCPU);
     auto selected = torch::zeros({this->count()}, options);
     auto selected_count = static_cast<size_t>(selected.size(0));
 
-    labels_->select(
-        selection->labels_.value(),
+    this->as_metatensor().select(
+        selection->as_metatensor(),
         selected.data_ptr<int64_t>(),
         &selected_count
     );
 
     selected.resize_({static_cast<int64_t>(selected_count)});
 
-    return selected;
+    return selected.to(device);
 }
 
 struct LabelsPrintData {
@@ -772,7 +1245,7 @@ std::string LabelsHolder::print(int64_t max_entries, int64_t indent) const {
 
 std::string LabelsHolder::str() const {
     auto output = std::ostringstream();
-    if (labels_.has_value()) {
+    if (!this->is_view()) {
         output << "Labels(\n   ";
     } else {
         output << "LabelsView(\n   ";
@@ -784,7 +1257,7 @@ std::string LabelsHolder::str() const {
 
 std::string LabelsHolder::repr() const {
     auto output = std::ostringstream();
-    if (labels_.has_value()) {
+    if (!this->is_view()) {
         output << "Labels(\n   ";
     } else {
         output << "LabelsView(\n   ";
@@ -795,14 +1268,54 @@ std::string LabelsHolder::repr() const {
 }
 
 
-TorchLabels LabelsHolder::load(const std::string& path) {
-    return torch::make_intrusive<LabelsHolder>(
-        LabelsHolder(metatensor::io::load_labels(path))
+TorchLabels LabelsHolder::from_metatensor(metatensor::Labels labels, torch::Device device) {
+    if (device.is_cpu()) {
+        return torch::make_intrusive<LabelsHolder>(std::move(labels));
+    }
+
+    auto* user_data = labels.user_data();
+    if (user_data != nullptr && static_cast<torch::Tensor*>(user_data)->device() == device) {
+        // these labels are shared with another LabelsHolder on the same
+        // device, re-use the existing values
+        return torch::make_intrusive<LabelsHolder>(std::move(labels));
+    }
+
+    auto names = std::vector<std::string>();
+    for (const auto* name: labels.names()) {
+        names.emplace_back(name);
+    }
+
+    auto sizes = std::vector<int64_t>{
+        static_cast<int64_t>(labels.count()),
+        static_cast<int64_t>(labels.size()),
+    };
+    auto options = torch::TensorOptions().dtype(torch::kInt32).device(torch::kCPU);
+
+    // this copy is blocking, since the memory is owned by metatensor-core and
+    // not pinned
+    auto values = torch::Tensor();
+    if (labels.count() == 0) {
+        values = torch::empty(sizes, options.device(device));
+    } else {
+        values = torch::from_blob(
+            const_cast<int32_t*>(labels.as_mts_labels_t().values),
+            sizes,
+            options
+        ).to(device);
+    }
+
+    return torch::make_intrusive<LabelsHolder>(std::move(names), std::move(values), std::move(labels));
+}
+
+TorchLabels LabelsHolder::load(const std::string& path, torch::optional<torch::Device> device) {
+    return LabelsHolder::from_metatensor(
+        metatensor::io::load_labels(path),
+        device.value_or(torch::kCPU)
     );
 }
 
 
-TorchLabels LabelsHolder::load_buffer(torch::Tensor buffer) {
+TorchLabels LabelsHolder::load_buffer(torch::Tensor buffer, torch::optional<torch::Device> device) {
     if (buffer.scalar_type() != torch::kUInt8) {
         C10_THROW_ERROR(ValueError,
             "`buffer` must be a tensor of uint8, not " +
@@ -816,11 +1329,12 @@ TorchLabels LabelsHolder::load_buffer(torch::Tensor buffer) {
         );
     }
 
-    return torch::make_intrusive<LabelsHolder>(
-        LabelsHolder(metatensor::io::load_labels_buffer(
+    return LabelsHolder::from_metatensor(
+        metatensor::io::load_labels_buffer(
             buffer.data_ptr<uint8_t>(),
             static_cast<size_t>(buffer.size(0))
-        ))
+        ),
+        device.value_or(torch::kCPU)
     );
 }
 
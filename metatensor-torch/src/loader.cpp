@@ -0,0 +1,262 @@
+#include <algorithm>
+
+#include <torch/torch.h>
+
+#include "metatensor/torch/loader.hpp"
+#include "metatensor/torch/misc.hpp"
+#include "metatensor/torch/operations.hpp"
+
+#include "internal/profiling.hpp"
+
+using namespace metatensor_torch;
+
+/// Add a `"tensor"` dimension (with value 0) at the end of the samples of all
+/// the blocks in `tensor`, as done by `join` when joining multiple tensors
+static TorchTensorMap add_tensor_dimension(const TorchTensorMap& tensor) {
+    auto blocks = std::vector<TorchTensorBlock>();
+    for (const auto& block: TensorMapHolder::blocks(tensor)) {
+        auto samples = block->samples();
+        samples = samples->append("tensor", torch::zeros(
+            {samples->count()},
+            torch::TensorOptions().dtype(torch::kInt32).device(samples->values().device())
+        ));
+
+        auto new_block = torch::make_intrusive<TensorBlockHolder>(
+            block->values(),
+            samples,
+            block->components(),
+            block->properties()
+        );
+
+        for (const auto& [parameter, gradient]: TensorBlockHolder::gradients(block)) {
+            new_block->add_gradient(parameter, gradient);
+        }
+        blocks.emplace_back(std::move(new_block));
+    }
+
+    return torch::make_intrusive<TensorMapHolder>(tensor->keys(), blocks);
+}
+
+TensorMapLoaderHolder::TensorMapLoaderHolder(
+    std::vector<std::string> paths,
+    int64_t batch_size,
+    bool shuffle,
+    torch::optional<torch::Dtype> dtype,
+    torch::optional<torch::Device> device,
+    int64_t num_workers,
+    int64_t prefetch
+):
+    paths_(std::move(paths)),
+    batch_size_(batch_size),
+    shuffle_(shuffle),
+    dtype_(dtype),
+    device_(device),
+    num_workers_(num_workers),
+    prefetch_(prefetch)
+{
+    if (batch_size_ <= 0) {
+        C10_THROW_ERROR(ValueError,
+            "batch_size must be positive, got " + std::to_string(batch_size_)
+        );
+    }
+
+    if (num_workers_ <= 0) {
+        C10_THROW_ERROR(ValueError,
+            "num_workers must be positive, got " + std::to_string(num_workers_)
+        );
+    }
+
+    if (prefetch_ <= 0) {
+        C10_THROW_ERROR(ValueError,
+            "prefetch must be positive, got " + std::to_string(prefetch_)
+        );
+    }
+
+    this->start();
+}
+
+TensorMapLoaderHolder::~TensorMapLoaderHolder() {
+    this->stop();
+}
+
+int64_t TensorMapLoaderHolder::size() const {
+    auto n_files = static_cast<int64_t>(paths_.size());
+    return (n_files + batch_size_ - 1) / batch_size_;
+}
+
+void TensorMapLoaderHolder::start() {
+    auto n_files = static_cast<int64_t>(paths_.size());
+    order_.resize(paths_.size());
+    if (shuffle_) {
+        auto permutation = torch::randperm(n_files, torch::TensorOptions().dtype(torch::kInt64));
+        std::copy_n(permutation.data_ptr<int64_t>(), n_files, order_.begin());
+    } else {
+        for (int64_t i=0; i<n_files; i++) {
+            order_[static_cast<size_t>(i)] = i;
+        }
+    }
+
+    {
+        auto lock = std::lock_guard<std::mutex>(mutex_);
+        stopping_ = false;
+        next_to_load_ = 0;
+        next_to_take_ = 0;
+        loaded_.clear();
+    }
+    in_flight_ = torch::nullopt;
+
+    // there is no need for more workers than batches
+    auto n_workers = std::min(num_workers_, this->size());
+    for (int64_t i=0; i<n_workers; i++) {
+        workers_.emplace_back([this]() { this->worker(); });
+    }
+}
+
+void TensorMapLoaderHolder::stop() {
+    {
+        auto lock = std::lock_guard<std::mutex>(mutex_);
+        stopping_ = true;
+    }
+    condition_.notify_all();
+
+    for (auto& worker: workers_) {
+        worker.join();
+    }
+    workers_.clear();
+}
+
+void TensorMapLoaderHolder::reset() {
+    this->stop();
+    this->start();
+}
+
+void TensorMapLoaderHolder::worker() {
+    auto n_batches = this->size();
+    while (true) {
+        auto batch = int64_t(-1);
+        {
+            auto lock = std::unique_lock<std::mutex>(mutex_);
+            // wait until there is space for a new batch in the queue
+            condition_.wait(lock, [&]() {
+                return stopping_ || next_to_load_ >= n_batches || next_to_load_ < next_to_take_ + prefetch_;
+            });
+
+            if (stopping_ || next_to_load_ >= n_batches) {
+                return;
+            }
+
+            batch = next_to_load_;
+            next_to_load_ += 1;
+        }
+
+        auto loaded = LoadedBatch();
+        try {
+            loaded.tensor = this->load_batch(batch);
+        } catch (...) {
+            loaded.error = std::current_exception();
+        }
+
+        {
+            auto lock = std::lock_guard<std::mutex>(mutex_);
+            loaded_.emplace(batch, std::move(loaded));
+        }
+        condition_.notify_all();
+    }
+}
+
+TorchTensorMap TensorMapLoaderHolder::load_batch(int64_t batch) const {
+    METATENSOR_TORCH_RECORD_FUNCTION("metatensor::TensorMapLoader::load_batch");
+
+    auto n_files = static_cast<int64_t>(paths_.size());
+    auto start = batch * batch_size_;
+    auto end = std::min(start + batch_size_, n_files);
+
+    auto tensors = std::vector<TorchTensorMap>();
+    tensors.reserve(static_cast<size_t>(end - start));
+    for (auto i=start; i<end; i++) {
+        const auto& path = paths_[static_cast<size_t>(order_[static_cast<size_t>(i)])];
+        tensors.emplace_back(metatensor_torch::load(path, dtype_, torch::nullopt));
+    }
+
+    auto tensor = TorchTensorMap();
+    if (tensors.size() == 1) {
+        // `join` returns a single tensor unchanged, we add the "tensor"
+        // dimension manually to get the same samples names for all batches
+        tensor = add_tensor_dimension(tensors[0]);
+    } else {
+        tensor = metatensor_torch::join(tensors, "samples", /*different_keys=*/"union");
+    }
+
+    if (device_.has_value() && !device_->is_cpu()) {
+        // a packed TensorMap is sent to the device with a single copy, which
+        // can be asynchronous if the data is in pinned memory
+        tensor = tensor->pack(/*gradients=*/true);
+        if (device_->is_cuda()) {
+            tensor = tensor->pin_memory();
+        }
+    }
+
+    return tensor;
+}
+
+TensorMapLoaderHolder::LoadedBatch TensorMapLoaderHolder::take_batch(int64_t batch) {
+    auto loaded = LoadedBatch();
+    {
+        auto lock = std::unique_lock<std::mutex>(mutex_);
+        condition_.wait(lock, [&]() {
+            return loaded_.find(batch) != loaded_.end();
+        });
+
+        auto it = loaded_.find(batch);
+        loaded = std::move(it->second);
+        loaded_.erase(it);
+        next_to_take_ += 1;
+    }
+    // there is space for another batch in the queue
+    condition_.notify_all();
+
+    if (!loaded.error && device_.has_value() && !device_->is_cpu()) {
+        try {
+            loaded.tensor = loaded.tensor->to(torch::nullopt, device_, /*non_blocking=*/true);
+        } catch (...) {
+            loaded.error = std::current_exception();
+        }
+    }
+
+    return loaded;
+}
+
+bool TensorMapLoaderHolder::is_loaded(int64_t batch) {
+    auto lock = std::lock_guard<std::mutex>(mutex_);
+    return loaded_.find(batch) != loaded_.end();
+}
+
+torch::optional<TorchTensorMap> TensorMapLoaderHolder::next() {
+    METATENSOR_TORCH_RECORD_FUNCTION("metatensor::TensorMapLoader::next");
+
+    // `next_to_take_` is only modified by the thread calling this function,
+    // so we can read it without locking the mutex
+    auto n_batches = this->size();
+    if (!in_flight_.has_value()) {
+        if (next_to_take_ >= n_batches) {
+            return torch::nullopt;
+        }
+        in_flight_ = this->take_batch(next_to_take_);
+    }
+
+    auto current = std::move(in_flight_.value());
+    in_flight_ = torch::nullopt;
+
+    // start sending the next batch to the device if it is already loaded,
+    // overlapping the copy with the calculations on the current batch
+    auto on_device = device_.has_value() && !device_->is_cpu();
+    if (on_device && next_to_take_ < n_batches && this->is_loaded(next_to_take_)) {
+        in_flight_ = this->take_batch(next_to_take_);
+    }
+
+    if (current.error) {
+        std::rethrow_exception(current.error);
+    }
+
+    return current.tensor;
+}
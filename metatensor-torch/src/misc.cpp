@@ -7,89 +7,314 @@
 #include "metatensor/torch/array.hpp"
 #include "metatensor/torch/misc.hpp"
 
+#include "internal/profiling.hpp"
+#include "internal/serialization.hpp"
+#include "internal/utils.hpp"
+
 using namespace metatensor_torch;
 
 std::string metatensor_torch::version() {
     return METATENSOR_TORCH_VERSION;
 }
 
+static mts_status_t create_torch_array_impl(
+    const uintptr_t* shape_ptr,
+    uintptr_t shape_count,
+    mts_array_t* array,
+    torch::Dtype dtype,
+    bool pinned
+) {
+    return metatensor::details::catch_exceptions([](
+        const uintptr_t* shape_ptr,
+        uintptr_t shape_count,
+        mts_array_t* array,
+        torch::Dtype dtype,
+        bool pinned
+    ) {
+        auto sizes = std::vector<int64_t>();
+        for (size_t i=0; i<shape_count; i++) {
+            sizes.push_back(static_cast<int64_t>(shape_ptr[i]));
+        }
+
+        // the data will be fully overwritten by metatensor when loading, so
+        // there is no need to initialize the memory here
+        auto options = torch::TensorOptions()
+            .device(torch::kCPU)
+            .dtype(dtype)
+            .pinned_memory(pinned);
+        auto tensor = torch::empty(sizes, options);
+
+        auto cxx_array = std::unique_ptr<metatensor::DataArrayBase>(new TorchDataArray(tensor));
+        *array = metatensor::DataArrayBase::to_mts_array_t(std::move(cxx_array));
+
+        return MTS_SUCCESS;
+    }, shape_ptr, shape_count, array, dtype, pinned);
+}
+
+/// `mts_create_array_callback_t` creating arrays with a fixed `dtype`, in
+/// pinned memory if `pinned` is true. metatensor decodes the data directly in
+/// the type of these arrays when loading.
+template <torch::Dtype dtype, bool pinned>
+static mts_status_t create_typed_torch_array(
+    const uintptr_t* shape_ptr,
+    uintptr_t shape_count,
+    mts_array_t* array
+) {
+    return create_torch_array_impl(shape_ptr, shape_count, array, dtype, pinned);
+}
+
 mts_status_t metatensor_torch::details::create_torch_array(
     const uintptr_t* shape_ptr,
     uintptr_t shape_count,
     mts_array_t* array
 ) {
+    return create_torch_array_impl(shape_ptr, shape_count, array, torch::kF64, /*pinned=*/false);
+}
+
+mts_status_t metatensor_torch::details::create_torch_pinned_array(
+    const uintptr_t* shape_ptr,
+    uintptr_t shape_count,
+    mts_array_t* array
+) {
+    return create_torch_array_impl(shape_ptr, shape_count, array, torch::kF64, /*pinned=*/true);
+}
+
+mts_create_array_callback_t metatensor_torch::details::create_array_for(
+    torch::optional<torch::Dtype> dtype,
+    torch::optional<torch::Device> device
+) {
+    auto pinned = device.has_value() && device->is_cuda();
+    auto scalar_type = dtype.value_or(torch::kF64);
+
+    if (scalar_type == torch::kF32) {
+        return pinned ? create_typed_torch_array<torch::kF32, true> : create_typed_torch_array<torch::kF32, false>;
+    } else if (scalar_type == torch::kF16) {
+        return pinned ? create_typed_torch_array<torch::kF16, true> : create_typed_torch_array<torch::kF16, false>;
+    }
+
+    // other dtypes (float64, and dtypes not supported by `mts_array_t`'s
+    // `typed_data`) are decoded as float64, and converted after loading
+    return pinned ? create_torch_pinned_array : create_torch_array;
+}
+
+mts_status_t metatensor_torch::details::create_torch_mmap_array(
+    const uintptr_t* shape_ptr,
+    uintptr_t shape_count,
+    double* data,
+    mts_mmap_t* mmap,
+    mts_array_t* array
+) {
+    if (data == nullptr) {
+        return create_torch_array(shape_ptr, shape_count, array);
+    }
+
     return metatensor::details::catch_exceptions([](
         const uintptr_t* shape_ptr,
         uintptr_t shape_count,
+        double* data,
+        mts_mmap_t* mmap,
         mts_array_t* array
     ) {
+        // make sure the reference to the mapping is released if anything
+        // below throws, before the tensor takes ownership of it
+        auto mmap_guard = std::unique_ptr<mts_mmap_t, mts_status_t(*)(mts_mmap_t*)>(
+            mmap, mts_mmap_free
+        );
+
         auto sizes = std::vector<int64_t>();
         for (size_t i=0; i<shape_count; i++) {
             sizes.push_back(static_cast<int64_t>(shape_ptr[i]));
         }
 
         auto options = torch::TensorOptions().device(torch::kCPU).dtype(torch::kF64);
-        auto tensor = torch::zeros(sizes, options);
+        auto deleter = [mmap](void*) {
+            mts_mmap_free(mmap);
+        };
+        auto tensor = torch::from_blob(data, sizes, deleter, options);
+        mmap_guard.release();
 
         auto cxx_array = std::unique_ptr<metatensor::DataArrayBase>(new TorchDataArray(tensor));
         *array = metatensor::DataArrayBase::to_mts_array_t(std::move(cxx_array));
 
         return MTS_SUCCESS;
-    }, shape_ptr, shape_count, array);
+    }, shape_ptr, shape_count, data, mmap, array);
 }
 
 /******************************************************************************/
 
-TorchTensorMap metatensor_torch::load(const std::string& path) {
-    return TensorMapHolder::load(path);
+TorchTensorMap metatensor_torch::load(
+    const std::string& path,
+    torch::optional<torch::Dtype> dtype,
+    torch::optional<torch::Device> device
+) {
+    METATENSOR_TORCH_RECORD_FUNCTION("metatensor::load");
+    return TensorMapHolder::load(path, dtype, device);
+}
+
+TorchTensorMap metatensor_torch::load_buffer(
+    torch::Tensor buffer,
+    torch::optional<torch::Dtype> dtype,
+    torch::optional<torch::Device> device
+) {
+    METATENSOR_TORCH_RECORD_FUNCTION("metatensor::load_buffer");
+    return TensorMapHolder::load_buffer(buffer, dtype, device);
 }
 
-TorchTensorMap metatensor_torch::load_buffer(torch::Tensor buffer) {
-    return TensorMapHolder::load_buffer(buffer);
+TorchTensorMap metatensor_torch::load_mmap(const std::string& path) {
+    METATENSOR_TORCH_RECORD_FUNCTION("metatensor::load_mmap");
+    return TensorMapHolder::load_mmap(path);
 }
 
+/// Check that `buffer` can be used as the output of `save_into_buffer`
+static void check_output_buffer(const torch::Tensor& buffer) {
+    if (buffer.scalar_type() != torch::kUInt8) {
+        C10_THROW_ERROR(ValueError,
+            "`buffer` must be a tensor of uint8, not " +
+            scalar_type_name(buffer.scalar_type())
+        );
+    }
+
+    if (buffer.sizes().size() != 1) {
+        C10_THROW_ERROR(ValueError,
+            "`buffer` must be a 1-dimensional tensor"
+        );
+    }
+
+    if (!buffer.device().is_cpu() || !buffer.is_contiguous()) {
+        C10_THROW_ERROR(ValueError,
+            "`buffer` must be a contiguous tensor on CPU"
+        );
+    }
+}
 
 void metatensor_torch::save(const std::string& path, TorchTensorMap tensor) {
+    METATENSOR_TORCH_RECORD_FUNCTION("metatensor::save");
     tensor->save(path);
 }
 
 torch::Tensor metatensor_torch::save_buffer(TorchTensorMap tensor) {
+    METATENSOR_TORCH_RECORD_FUNCTION("metatensor::save_buffer");
     return tensor->save_buffer();
 }
 
+int64_t metatensor_torch::serialized_size(TorchTensorMap tensor) {
+    METATENSOR_TORCH_RECORD_FUNCTION("metatensor::serialized_size");
+    auto size = details::with_serializable(tensor->as_metatensor(), [](const metatensor::TensorMap& serializable) {
+        return metatensor::io::serialized_size(serializable);
+    });
+    return static_cast<int64_t>(size);
+}
+
+int64_t metatensor_torch::save_into_buffer(TorchTensorMap tensor, torch::Tensor buffer) {
+    METATENSOR_TORCH_RECORD_FUNCTION("metatensor::save_into_buffer");
+    check_output_buffer(buffer);
+    auto written = details::with_serializable(tensor->as_metatensor(), [&](const metatensor::TensorMap& serializable) {
+        return metatensor::io::save_into_buffer(
+            serializable,
+            buffer.data_ptr<uint8_t>(),
+            static_cast<size_t>(buffer.size(0))
+        );
+    });
+    return static_cast<int64_t>(written);
+}
+
 /******************************************************************************/
 
-TorchTensorBlock metatensor_torch::load_block(const std::string& path) {
-    return TensorBlockHolder::load(path);
+TorchTensorBlock metatensor_torch::load_block(
+    const std::string& path,
+    torch::optional<torch::Dtype> dtype,
+    torch::optional<torch::Device> device
+) {
+    METATENSOR_TORCH_RECORD_FUNCTION("metatensor::load_block");
+    return TensorBlockHolder::load(path, dtype, device);
 }
 
-TorchTensorBlock metatensor_torch::load_block_buffer(torch::Tensor buffer) {
-    return TensorBlockHolder::load_buffer(buffer);
+TorchTensorBlock metatensor_torch::load_block_buffer(
+    torch::Tensor buffer,
+    torch::optional<torch::Dtype> dtype,
+    torch::optional<torch::Device> device
+) {
+    METATENSOR_TORCH_RECORD_FUNCTION("metatensor::load_block_buffer");
+    return TensorBlockHolder::load_buffer(buffer, dtype, device);
 }
 
+TorchTensorBlock metatensor_torch::load_block_mmap(const std::string& path) {
+    METATENSOR_TORCH_RECORD_FUNCTION("metatensor::load_block_mmap");
+    return TensorBlockHolder::load_mmap(path);
+}
 
 void metatensor_torch::save(const std::string& path, TorchTensorBlock block) {
+    METATENSOR_TORCH_RECORD_FUNCTION("metatensor::save");
     block->save(path);
 }
 
 torch::Tensor metatensor_torch::save_buffer(TorchTensorBlock block) {
+    METATENSOR_TORCH_RECORD_FUNCTION("metatensor::save_buffer");
     return block->save_buffer();
 }
 
+int64_t metatensor_torch::serialized_size(TorchTensorBlock block) {
+    METATENSOR_TORCH_RECORD_FUNCTION("metatensor::serialized_size");
+    auto size = details::with_serializable(block->as_metatensor(), [](const metatensor::TensorBlock& serializable) {
+        return metatensor::io::serialized_size(serializable);
+    });
+    return static_cast<int64_t>(size);
+}
+
+int64_t metatensor_torch::save_into_buffer(TorchTensorBlock block, torch::Tensor buffer) {
+    METATENSOR_TORCH_RECORD_FUNCTION("metatensor::save_into_buffer");
+    check_output_buffer(buffer);
+    auto written = details::with_serializable(block->as_metatensor(), [&](const metatensor::TensorBlock& serializable) {
+        return metatensor::io::save_into_buffer(
+            serializable,
+            buffer.data_ptr<uint8_t>(),
+            static_cast<size_t>(buffer.size(0))
+        );
+    });
+    return static_cast<int64_t>(written);
+}
+
 /******************************************************************************/
 
-TorchLabels metatensor_torch::load_labels(const std::string& path) {
-    return LabelsHolder::load(path);
+TorchLabels metatensor_torch::load_labels(
+    const std::string& path,
+    torch::optional<torch::Device> device
+) {
+    METATENSOR_TORCH_RECORD_FUNCTION("metatensor::load_labels");
+    return LabelsHolder::load(path, device);
 }
 
-TorchLabels metatensor_torch::load_labels_buffer(torch::Tensor buffer) {
-    return LabelsHolder::load_buffer(buffer);
+TorchLabels metatensor_torch::load_labels_buffer(
+    torch::Tensor buffer,
+    torch::optional<torch::Device> device
+) {
+    METATENSOR_TORCH_RECORD_FUNCTION("metatensor::load_labels_buffer");
+    return LabelsHolder::load_buffer(buffer, device);
 }
 
 void metatensor_torch::save(const std::string& path, TorchLabels labels) {
+    METATENSOR_TORCH_RECORD_FUNCTION("metatensor::save");
     labels->save(path);
 }
 
 torch::Tensor metatensor_torch::save_buffer(TorchLabels labels) {
+    METATENSOR_TORCH_RECORD_FUNCTION("metatensor::save_buffer");
     return labels->save_buffer();
 }
+
+int64_t metatensor_torch::serialized_size(TorchLabels labels) {
+    METATENSOR_TORCH_RECORD_FUNCTION("metatensor::serialized_size");
+    auto size = metatensor::io::serialized_size(labels->as_metatensor());
+    return static_cast<int64_t>(size);
+}
+
+int64_t metatensor_torch::save_into_buffer(TorchLabels labels, torch::Tensor buffer) {
+    METATENSOR_TORCH_RECORD_FUNCTION("metatensor::save_into_buffer");
+    check_output_buffer(buffer);
+    auto written = metatensor::io::save_into_buffer(
+        labels->as_metatensor(),
+        buffer.data_ptr<uint8_t>(),
+        static_cast<size_t>(buffer.size(0))
+    );
+    return static_cast<int64_t>(written);
+}
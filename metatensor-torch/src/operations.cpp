@@ -0,0 +1,709 @@
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <torch/torch.h>
+
+#include "metatensor/torch/operations.hpp"
+
+using namespace metatensor_torch;
+
+static void check_no_gradients_of_gradients(const TorchTensorBlock& gradient) {
+    if (!gradient->gradients_list().empty()) {
+        C10_THROW_ERROR(NotImplementedError,
+            "gradients of gradients are not supported"
+        );
+    }
+}
+
+static bool contains(const std::vector<std::string>& names, const std::string& name) {
+    return std::find(std::begin(names), std::end(names), name) != std::end(names);
+}
+
+/// Reshape a 1-dimensional `array` containing one entry per sample to make it
+/// broadcast against an array with `n_dimensions` dimensions
+static torch::Tensor per_sample(const torch::Tensor& array, int64_t n_dimensions) {
+    auto shape = std::vector<int64_t>(static_cast<size_t>(n_dimensions), 1);
+    shape[0] = -1;
+    return array.reshape(shape);
+}
+
+/// Take the entries of `array` at `index` along the first dimension, and add
+/// new dimensions after the first one to make the result broadcast against
+/// gradients with `n_dimensions` dimensions.
+static torch::Tensor gather_for_gradients(const torch::Tensor& array, const torch::Tensor& index, int64_t n_dimensions) {
+    auto gathered = array.index_select(0, index);
+
+    auto shape = gathered.sizes().vec();
+    shape.insert(std::begin(shape) + 1, static_cast<size_t>(n_dimensions - array.dim()), 1);
+    return gathered.reshape(shape);
+}
+
+/// Sum the entries of `array` sharing the same `index` along the first
+/// dimension, creating an array with `count` entries along this dimension.
+static torch::Tensor index_sum(const torch::Tensor& array, const torch::Tensor& index, int64_t count) {
+    auto shape = array.sizes().vec();
+    shape[0] = count;
+    return torch::zeros(shape, array.options()).index_add(0, index, array);
+}
+
+TorchTensorBlock metatensor_torch::reduce_over_samples_block(
+    TorchTensorBlock block,
+    const std::vector<std::string>& sample_names,
+    const std::string& reduction
+) {
+    if (reduction != "sum" && reduction != "mean" && reduction != "var" && reduction != "std") {
+        C10_THROW_ERROR(ValueError,
+            "invalid reduction '" + reduction + "', expected one of 'sum', "
+            "'mean', 'var' or 'std'"
+        );
+    }
+
+    auto samples = block->samples();
+    auto samples_values = samples->values();
+    auto all_names = samples->names();
+    for (const auto& name: sample_names) {
+        if (!contains(all_names, name)) {
+            C10_THROW_ERROR(ValueError,
+                "one of the requested sample name (" + name + ") is not part "
+                "of this TensorBlock"
+            );
+        }
+    }
+
+    auto remaining_names = std::vector<std::string>();
+    auto remaining_columns = std::vector<int64_t>();
+    for (size_t i=0; i<all_names.size(); i++) {
+        if (!contains(sample_names, all_names[i])) {
+            remaining_names.push_back(all_names[i]);
+            remaining_columns.push_back(static_cast<int64_t>(i));
+        }
+    }
+
+    auto values = block->values();
+    if (samples->count() == 0) {
+        // nothing to reduce, the values and gradients stay the same
+        auto n_remaining = static_cast<int64_t>(remaining_names.size());
+        auto result = torch::make_intrusive<TensorBlockHolder>(
+            values,
+            torch::make_intrusive<LabelsHolder>(
+                remaining_names,
+                torch::zeros({0, n_remaining}, samples_values.options())
+            ),
+            block->components(),
+            block->properties()
+        );
+
+        for (const auto& [parameter, gradient]: TensorBlockHolder::gradients(block)) {
+            check_no_gradients_of_gradients(gradient);
+            result->add_gradient(parameter, gradient->shallow_copy());
+        }
+        return result;
+    }
+
+    auto index_options = torch::TensorOptions().dtype(torch::kInt64).device(values.device());
+
+    // `index` contains the position of the new sample for each existing sample
+    auto new_samples_values = torch::Tensor();
+    auto index = torch::Tensor();
+    if (remaining_names.empty()) {
+        new_samples_values = torch::zeros({1, 1}, samples_values.options());
+        index = torch::zeros({samples->count()}, index_options);
+        remaining_names = {"_"};
+    } else {
+        auto columns = torch::tensor(remaining_columns, index_options);
+        auto unique = torch::unique_dim(
+            samples_values.index_select(1, columns),
+            /*dim=*/0,
+            /*sorted=*/true,
+            /*return_inverse=*/true,
+            /*return_counts=*/false
+        );
+        new_samples_values = std::get<0>(unique);
+        index = std::get<1>(unique).reshape({-1});
+    }
+
+    auto n_new_samples = new_samples_values.size(0);
+    auto counts = torch::bincount(index, /*weights=*/{}, n_new_samples).to(values.scalar_type());
+
+    auto sum = index_sum(values, index, n_new_samples);
+    auto mean = torch::Tensor();
+    auto result_values = sum;
+    if (reduction != "sum") {
+        mean = sum / per_sample(counts, values.dim());
+        result_values = mean;
+
+        if (reduction == "var" || reduction == "std") {
+            auto mean_of_squares = index_sum(values * values, index, n_new_samples) / per_sample(counts, values.dim());
+            result_values = mean_of_squares - mean * mean;
+            if (reduction == "std") {
+                result_values = torch::sqrt(result_values);
+            }
+        }
+    }
+
+    // the new samples are unique by construction
+    auto result = torch::make_intrusive<TensorBlockHolder>(
+        result_values,
+        torch::make_intrusive<LabelsHolder>(remaining_names, new_samples_values, /*assume_unique=*/true),
+        block->components(),
+        block->properties()
+    );
+
+    for (const auto& [parameter, gradient]: TensorBlockHolder::gradients(block)) {
+        check_no_gradients_of_gradients(gradient);
+
+        auto gradient_samples = gradient->samples();
+        if (gradient_samples->count() == 0) {
+            // all gradients are zero, and stay zero after the reduction
+            result->add_gradient(parameter, gradient->shallow_copy());
+            continue;
+        }
+
+        auto gradient_values = gradient->values();
+        auto n_dimensions = gradient_values.dim();
+
+        // update the "sample" dimension to refer to the new samples, and merge
+        // the gradient samples which are now the same
+        auto sample_column = gradient_samples->values().select(1, 0).to(torch::kInt64);
+        auto updated_samples = gradient_samples->values().clone();
+        updated_samples.select(1, 0).copy_(index.index_select(0, sample_column));
+
+        auto unique = torch::unique_dim(
+            updated_samples,
+            /*dim=*/0,
+            /*sorted=*/true,
+            /*return_inverse=*/true,
+            /*return_counts=*/false
+        );
+        auto new_gradient_samples = std::get<0>(unique);
+        auto gradient_index = std::get<1>(unique).reshape({-1});
+        auto n_new_gradient_samples = new_gradient_samples.size(0);
+
+        auto gradient_result = index_sum(gradient_values, gradient_index, n_new_gradient_samples);
+        if (reduction != "sum") {
+            // number of gradient samples merged together for each new gradient
+            // sample, matching the Python implementation
+            auto new_sample = new_gradient_samples.select(1, 0).to(torch::kInt64);
+            auto gradient_counts = per_sample(
+                torch::bincount(gradient_index, /*weights=*/{}, n_new_gradient_samples).to(gradient_values.scalar_type()),
+                n_dimensions
+            );
+            gradient_result = gradient_result / gradient_counts;
+
+            if (reduction == "var" || reduction == "std") {
+                // gradient of the mean of squares: 2 <x dx>, the gradient of
+                // the square of the mean being 2 <x> <dx>
+                auto values_times_gradients = gradient_values * gather_for_gradients(values, sample_column, n_dimensions);
+                auto mean_values_gradients = index_sum(
+                    values_times_gradients, gradient_index, n_new_gradient_samples
+                ) / gradient_counts;
+
+                auto mean_times_gradients = gradient_result * gather_for_gradients(mean, new_sample, n_dimensions);
+                if (reduction == "var") {
+                    gradient_result = 2 * (mean_values_gradients - mean_times_gradients);
+                } else {
+                    gradient_result = (mean_values_gradients - mean_times_gradients) / gather_for_gradients(
+                        result_values, new_sample, n_dimensions
+                    );
+                    // the gradient of the standard deviation is not defined
+                    // where it is zero, we follow the Python implementation
+                    // and set it to zero there.
+                    gradient_result = torch::nan_to_num(gradient_result, 0.0, 0.0, 0.0);
+                }
+            }
+        }
+
+        result->add_gradient(parameter, torch::make_intrusive<TensorBlockHolder>(
+            gradient_result,
+            torch::make_intrusive<LabelsHolder>(
+                gradient_samples->names(), new_gradient_samples, /*assume_unique=*/true
+            ),
+            gradient->components(),
+            result->properties()
+        ));
+    }
+
+    return result;
+}
+
+TorchTensorMap metatensor_torch::reduce_over_samples(
+    TorchTensorMap tensor,
+    const std::vector<std::string>& sample_names,
+    const std::string& reduction
+) {
+    auto tensor_sample_names = tensor->sample_names();
+    for (const auto& name: sample_names) {
+        if (!contains(tensor_sample_names, name)) {
+            C10_THROW_ERROR(ValueError,
+                "one of the requested sample name (" + name + ") is not part "
+                "of this TensorMap"
+            );
+        }
+    }
+
+    auto blocks = std::vector<TorchTensorBlock>();
+    for (const auto& block: TensorMapHolder::blocks(tensor)) {
+        blocks.emplace_back(reduce_over_samples_block(block, sample_names, reduction));
+    }
+
+    return torch::make_intrusive<TensorMapHolder>(tensor->keys(), blocks);
+}
+
+/******************************************************************************/
+
+static void check_slice_arguments(
+    const TorchTensorBlock& block,
+    const std::string& axis,
+    const TorchLabels& selection
+) {
+    if (axis != "samples" && axis != "properties") {
+        C10_THROW_ERROR(ValueError,
+            "'" + axis + "' is not known as a slicing axis, please use "
+            "'samples' or 'properties'"
+        );
+    }
+
+    auto names = axis == "samples" ? block->samples()->names() : block->properties()->names();
+    for (const auto& name: selection->names()) {
+        if (!contains(names, name)) {
+            auto kind = axis == "samples" ? std::string("sample") : std::string("property");
+            C10_THROW_ERROR(ValueError,
+                "invalid " + kind + " name '" + name + "' which is not part of the input"
+            );
+        }
+    }
+}
+
+/// Get the positions of the entries in `labels` matching `selection`, in the
+/// same order as `labels`, as well as the corresponding boolean mask.
+static std::tuple<torch::Tensor, torch::Tensor> selected_entries(
+    const TorchLabels& labels,
+    const TorchLabels& selection
+) {
+    auto selected = labels->select(selection);
+
+    auto mask = torch::zeros(
+        {labels->count()},
+        torch::TensorOptions().dtype(torch::kBool).device(selected.device())
+    );
+    mask.index_fill_(0, selected, true);
+
+    auto positions = torch::nonzero(mask).reshape({-1});
+    return std::make_tuple(std::move(positions), std::move(mask));
+}
+
+static TorchTensorBlock slice_block_impl(
+    const TorchTensorBlock& block,
+    const std::string& axis,
+    const TorchLabels& selection
+) {
+    auto values = block->values();
+
+    if (axis == "samples") {
+        auto samples = block->samples();
+        auto [kept, mask] = selected_entries(samples, selection);
+
+        // every entry in the selected samples is still unique
+        auto new_block = torch::make_intrusive<TensorBlockHolder>(
+            values.index_select(0, kept),
+            torch::make_intrusive<LabelsHolder>(
+                samples->names(),
+                samples->values().index_select(0, kept),
+                /*assume_unique=*/true
+            ),
+            block->components(),
+            block->properties()
+        );
+
+        // position of the new sample for each of the kept samples, used to
+        // update the "sample" dimension of the gradients
+        auto samples_options = samples->values().options();
+        auto sample_map = torch::full({samples->count()}, -1, samples_options);
+        sample_map.index_put_({kept}, torch::arange(kept.size(0), samples_options));
+
+        for (const auto& [parameter, gradient]: TensorBlockHolder::gradients(block)) {
+            check_no_gradients_of_gradients(gradient);
+
+            auto gradient_samples = gradient->samples();
+            auto sample_column = gradient_samples->values().select(1, 0).to(torch::kInt64);
+            auto gradient_kept = torch::nonzero(mask.index_select(0, sample_column)).reshape({-1});
+
+            auto new_gradient_samples = gradient_samples->values().index_select(0, gradient_kept);
+            auto old_sample = new_gradient_samples.select(1, 0).to(torch::kInt64);
+            new_gradient_samples.select(1, 0).copy_(sample_map.index_select(0, old_sample));
+
+            new_block->add_gradient(parameter, torch::make_intrusive<TensorBlockHolder>(
+                gradient->values().index_select(0, gradient_kept),
+                torch::make_intrusive<LabelsHolder>(
+                    gradient_samples->names(),
+                    std::move(new_gradient_samples),
+                    /*assume_unique=*/true
+                ),
+                gradient->components(),
+                new_block->properties()
+            ));
+        }
+
+        return new_block;
+    } else {
+        auto properties = block->properties();
+        auto kept = std::get<0>(selected_entries(properties, selection));
+
+        auto new_properties = torch::make_intrusive<LabelsHolder>(
+            properties->names(),
+            properties->values().index_select(0, kept),
+            /*assume_unique=*/true
+        );
+
+        auto new_block = torch::make_intrusive<TensorBlockHolder>(
+            values.index_select(values.dim() - 1, kept),
+            block->samples(),
+            block->components(),
+            new_properties
+        );
+
+        for (const auto& [parameter, gradient]: TensorBlockHolder::gradients(block)) {
+            check_no_gradients_of_gradients(gradient);
+
+            auto gradient_values = gradient->values();
+            new_block->add_gradient(parameter, torch::make_intrusive<TensorBlockHolder>(
+                gradient_values.index_select(gradient_values.dim() - 1, kept),
+                gradient->samples(),
+                gradient->components(),
+                new_properties
+            ));
+        }
+
+        return new_block;
+    }
+}
+
+TorchTensorBlock metatensor_torch::slice_block(
+    TorchTensorBlock block,
+    const std::string& axis,
+    const TorchLabels& selection
+) {
+    check_slice_arguments(block, axis, selection);
+    return slice_block_impl(block, axis, selection);
+}
+
+TorchTensorMap metatensor_torch::slice(
+    TorchTensorMap tensor,
+    const std::string& axis,
+    const TorchLabels& selection
+) {
+    auto blocks = TensorMapHolder::blocks(tensor);
+    if (!blocks.empty()) {
+        check_slice_arguments(blocks[0], axis, selection);
+    }
+
+    auto new_blocks = std::vector<TorchTensorBlock>();
+    new_blocks.reserve(blocks.size());
+    for (const auto& block: blocks) {
+        new_blocks.emplace_back(slice_block_impl(block, axis, selection));
+    }
+
+    return torch::make_intrusive<TensorMapHolder>(tensor->keys(), new_blocks);
+}
+
+/******************************************************************************/
+
+static void check_same_keys(const TorchTensorMap& first, const TorchTensorMap& second) {
+    auto first_keys = first->keys();
+    auto second_keys = second->keys();
+
+    if (first_keys->names() != second_keys->names()) {
+        C10_THROW_ERROR(ValueError,
+            "inputs to 'join' should have the same keys names"
+        );
+    }
+
+    if (first_keys->count() != second_keys->count()) {
+        C10_THROW_ERROR(ValueError,
+            "inputs to 'join' should have the same number of blocks, got " +
+            std::to_string(first_keys->count()) + " and " + std::to_string(second_keys->count())
+        );
+    }
+
+    if (first_keys->set_intersection(second_keys)->count() != first_keys->count()) {
+        C10_THROW_ERROR(ValueError, "inputs to 'join' should have the same keys");
+    }
+}
+
+static TorchLabels empty_labels_like(const TorchLabels& labels) {
+    auto values = labels->values();
+    return torch::make_intrusive<LabelsHolder>(
+        labels->names(),
+        torch::zeros({0, values.size(1)}, values.options())
+    );
+}
+
+/// Create a block with the same metadata as `reference`, but no entries along
+/// the given `axis`
+static TorchTensorBlock empty_block_like(const TorchTensorBlock& reference, const std::string& axis) {
+    auto values = reference->values();
+    auto shape = values.sizes().vec();
+
+    auto samples = reference->samples();
+    auto properties = reference->properties();
+    if (axis == "samples") {
+        shape[0] = 0;
+        samples = empty_labels_like(samples);
+    } else {
+        shape.back() = 0;
+        properties = empty_labels_like(properties);
+    }
+
+    auto block = torch::make_intrusive<TensorBlockHolder>(
+        torch::empty(shape, values.options()),
+        samples,
+        reference->components(),
+        properties
+    );
+
+    for (const auto& [parameter, gradient]: TensorBlockHolder::gradients(reference)) {
+        check_no_gradients_of_gradients(gradient);
+
+        auto gradient_values = gradient->values();
+        auto gradient_shape = gradient_values.sizes().vec();
+        auto gradient_samples = gradient->samples();
+        if (axis == "samples") {
+            gradient_shape[0] = 0;
+            gradient_samples = empty_labels_like(gradient_samples);
+        } else {
+            gradient_shape.back() = 0;
+        }
+
+        block->add_gradient(parameter, torch::make_intrusive<TensorBlockHolder>(
+            torch::empty(gradient_shape, gradient_values.options()),
+            gradient_samples,
+            gradient->components(),
+            properties
+        ));
+    }
+
+    return block;
+}
+
+/// Get new tensors with keys given by `all_keys`, which must be either the
+/// union or the intersection of the keys of all `tensors`. Missing blocks are
+/// replaced by empty blocks along `axis`.
+static std::vector<TorchTensorMap> tensors_with_keys(
+    const std::vector<TorchTensorMap>& tensors,
+    const TorchLabels& all_keys,
+    const std::string& axis
+) {
+    auto n_keys = static_cast<size_t>(all_keys->count());
+
+    auto all_blocks = std::vector<std::vector<TorchTensorBlock>>();
+    auto references = std::vector<TorchTensorBlock>(n_keys);
+    for (const auto& tensor: tensors) {
+        // `mapping[i]` is the position in `all_keys` of the i-th key of this
+        // tensor, or -1 if this key is not part of `all_keys`
+        auto mapping = std::get<2>(all_keys->intersection_and_mapping(tensor->keys())).to(torch::kCPU);
+        auto mapping_data = mapping.accessor<int64_t, 1>();
+
+        auto blocks = std::vector<TorchTensorBlock>(n_keys);
+        auto tensor_blocks = TensorMapHolder::blocks(tensor);
+        for (size_t i=0; i<tensor_blocks.size(); i++) {
+            auto position = mapping_data[static_cast<int64_t>(i)];
+            if (position >= 0) {
+                blocks[static_cast<size_t>(position)] = tensor_blocks[i];
+                if (!references[static_cast<size_t>(position)]) {
+                    references[static_cast<size_t>(position)] = tensor_blocks[i];
+                }
+            }
+        }
+        all_blocks.emplace_back(std::move(blocks));
+    }
+
+    auto results = std::vector<TorchTensorMap>();
+    for (auto& blocks: all_blocks) {
+        for (size_t i=0; i<n_keys; i++) {
+            if (!blocks[i]) {
+                blocks[i] = empty_block_like(references[i], axis);
+            }
+        }
+        results.emplace_back(torch::make_intrusive<TensorMapHolder>(all_keys, blocks));
+    }
+
+    return results;
+}
+
+/// Check if the labels along `axis` in all the blocks of `tensors` are
+/// disjoint from each other
+static bool disjoint_labels(const std::vector<TorchTensorMap>& tensors, const std::string& axis) {
+    for (size_t first=0; first<tensors.size(); first++) {
+        auto keys = tensors[first]->keys();
+        for (size_t second=first+1; second<tensors.size(); second++) {
+            for (int64_t i=0; i<keys->count(); i++) {
+                auto entry = torch::make_intrusive<LabelsEntryHolder>(keys, i);
+                auto first_block = TensorMapHolder::block_by_id(tensors[first], i);
+                auto second_block = TensorMapHolder::block(tensors[second], entry);
+
+                auto first_labels = axis == "samples" ? first_block->samples() : first_block->properties();
+                auto second_labels = axis == "samples" ? second_block->samples() : second_block->properties();
+                if (first_labels->set_intersection(second_labels)->count() != 0) {
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+TorchTensorMap metatensor_torch::join(
+    const std::vector<TorchTensorMap>& tensors,
+    const std::string& axis,
+    const std::string& different_keys,
+    bool sort_samples,
+    bool remove_tensor_name
+) {
+    if (tensors.empty()) {
+        C10_THROW_ERROR(ValueError, "provide at least one `TensorMap` for joining");
+    }
+
+    if (axis != "samples" && axis != "properties") {
+        C10_THROW_ERROR(ValueError,
+            "Only `'properties'` or `'samples'` are valid values for the `axis` parameter."
+        );
+    }
+
+    if (tensors.size() == 1) {
+        return tensors[0];
+    }
+
+    auto inputs = tensors;
+    if (different_keys == "error") {
+        for (const auto& tensor: tensors) {
+            check_same_keys(tensors[0], tensor);
+        }
+    } else if (different_keys == "intersection") {
+        auto all_keys = tensors[0]->keys();
+        for (const auto& tensor: tensors) {
+            all_keys = all_keys->set_intersection(tensor->keys());
+        }
+        inputs = tensors_with_keys(tensors, all_keys, axis);
+    } else if (different_keys == "union") {
+        auto all_keys = tensors[0]->keys();
+        for (const auto& tensor: tensors) {
+            all_keys = all_keys->set_union(tensor->keys());
+        }
+        inputs = tensors_with_keys(tensors, all_keys, axis);
+    } else {
+        C10_THROW_ERROR(ValueError,
+            "'" + different_keys + "' is not a valid option for `different_keys`. "
+            "Choose either 'error', 'intersection' or 'union'."
+        );
+    }
+
+    // check if the names of the labels along `axis` are the same in all tensors
+    auto reference_names = axis == "samples" ? inputs[0]->sample_names() : inputs[0]->property_names();
+    auto names_are_same = true;
+    for (const auto& tensor: inputs) {
+        auto names = axis == "samples" ? tensor->sample_names() : tensor->property_names();
+        auto all_found = names.size() == reference_names.size() && std::all_of(
+            std::begin(names), std::end(names),
+            [&](const std::string& name) { return contains(reference_names, name); }
+        );
+        if (!all_found) {
+            names_are_same = false;
+        }
+    }
+
+    if (axis == "samples" && !names_are_same) {
+        C10_THROW_ERROR(ValueError,
+            "Sample names are not the same! Joining along samples with different "
+            "sample names will loose information and is not supported."
+        );
+    }
+
+    // add a "tensor" dimension to the keys, containing the index of the
+    // tensor each block comes from
+    auto keys_names = std::vector<std::string>{"tensor"};
+    for (const auto& name: inputs[0]->keys()->names()) {
+        keys_names.push_back(name);
+    }
+
+    auto keys_values = std::vector<torch::Tensor>();
+    auto blocks = std::vector<TorchTensorBlock>();
+    for (size_t tensor_i=0; tensor_i<inputs.size(); tensor_i++) {
+        const auto& tensor = inputs[tensor_i];
+        auto values = tensor->keys()->values();
+        keys_values.emplace_back(torch::hstack({
+            torch::full({values.size(0), 1}, static_cast<int64_t>(tensor_i), values.options()),
+            values,
+        }));
+
+        for (const auto& block: TensorMapHolder::blocks(tensor)) {
+            if (names_are_same) {
+                blocks.push_back(block);
+                continue;
+            }
+
+            auto properties = LabelsHolder::range("property", block->properties()->count())->to(block->device());
+            auto new_block = torch::make_intrusive<TensorBlockHolder>(
+                block->values(),
+                block->samples(),
+                block->components(),
+                properties
+            );
+
+            for (const auto& [parameter, gradient]: TensorBlockHolder::gradients(block)) {
+                check_no_gradients_of_gradients(gradient);
+                new_block->add_gradient(parameter, torch::make_intrusive<TensorBlockHolder>(
+                    gradient->values(),
+                    gradient->samples(),
+                    gradient->components(),
+                    properties
+                ));
+            }
+            blocks.emplace_back(std::move(new_block));
+        }
+    }
+
+    auto keys = torch::make_intrusive<LabelsHolder>(keys_names, torch::vstack(keys_values), /*assume_unique=*/true);
+    auto merged = torch::make_intrusive<TensorMapHolder>(keys, blocks);
+
+    auto joined = TorchTensorMap();
+    if (axis == "samples") {
+        joined = merged->keys_to_samples(std::string("tensor"), sort_samples);
+    } else {
+        joined = merged->keys_to_properties(std::string("tensor"), sort_samples);
+    }
+
+    if (!remove_tensor_name || !disjoint_labels(inputs, axis)) {
+        return joined;
+    }
+
+    auto new_blocks = std::vector<TorchTensorBlock>();
+    for (const auto& block: TensorMapHolder::blocks(joined)) {
+        auto samples = block->samples();
+        auto properties = block->properties();
+        if (axis == "samples") {
+            samples = samples->remove("tensor");
+        } else {
+            properties = properties->remove("tensor");
+        }
+
+        auto new_block = torch::make_intrusive<TensorBlockHolder>(
+            block->values(),
+            samples,
+            block->components(),
+            properties
+        );
+
+        for (const auto& [parameter, gradient]: TensorBlockHolder::gradients(block)) {
+            new_block->add_gradient(parameter, torch::make_intrusive<TensorBlockHolder>(
+                gradient->values(),
+                gradient->samples(),
+                gradient->components(),
+                properties
+            ));
+        }
+        new_blocks.emplace_back(std::move(new_block));
+    }
+
+    return torch::make_intrusive<TensorMapHolder>(joined->keys(), new_blocks);
+}
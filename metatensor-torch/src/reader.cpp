@@ -0,0 +1,116 @@
+#include <metatensor.hpp>
+#include <string>
+
+#include "metatensor/torch/reader.hpp"
+#include "metatensor/torch/misc.hpp"
+
+#include "internal/utils.hpp"
+
+using namespace metatensor_torch;
+
+TensorMapReaderHolder::TensorMapReaderHolder(const std::string& path):
+    reader_(path, details::create_torch_array),
+    keys_(torch::make_intrusive<LabelsHolder>(reader_.keys()))
+{}
+
+std::vector<int64_t> TensorMapReaderHolder::blocks_matching(const TorchLabels& selection) const {
+    auto results = reader_.blocks_matching(selection->as_metatensor());
+
+    auto results_int64 = std::vector<int64_t>();
+    results_int64.reserve(results.size());
+    for (auto matching: results) {
+        results_int64.push_back(static_cast<int64_t>(matching));
+    }
+
+    return results_int64;
+}
+
+TorchTensorBlock TensorMapReaderHolder::block_by_id(int64_t index) const {
+    if (index < 0 || index >= keys_->count()) {
+        C10_THROW_ERROR(IndexError,
+            "block index out of bounds: we have " + std::to_string(keys_->count())
+            + " blocks but the index is " + std::to_string(index)
+        );
+    }
+
+    return torch::make_intrusive<TensorBlockHolder>(
+        reader_.block(static_cast<uintptr_t>(index)),
+        /*parent=*/torch::IValue()
+    );
+}
+
+TorchTensorBlock TensorMapReaderHolder::block(const TorchLabelsEntry& torch_selection) const {
+    auto cpu_values = torch_selection->values().to(torch::kCPU);
+    auto selection = metatensor::Labels(
+        torch_selection->names(), cpu_values.data_ptr<int32_t>(), 1
+    );
+
+    auto matching = reader_.blocks_matching(selection);
+    if (matching.empty()) {
+        C10_THROW_ERROR(ValueError,
+            "could not find blocks matching the selection " + torch_selection->print()
+        );
+    } else if (matching.size() != 1) {
+        C10_THROW_ERROR(ValueError,
+            "got more than one matching block for " + torch_selection->print() +
+            ", use the `load` function to select more than one block"
+        );
+    }
+
+    return this->block_by_id(static_cast<int64_t>(matching[0]));
+}
+
+TorchTensorBlock TensorMapReaderHolder::block_torch(torch::IValue selection) const {
+    if (selection.isInt()) {
+        return this->block_by_id(selection.toInt());
+    } else if (selection.isGenericDict()) {
+        auto names = std::vector<std::string>();
+        auto values = std::vector<int32_t>();
+        for (const auto& it: selection.toGenericDict()) {
+            const auto& key = it.key();
+            const auto& value = it.value();
+            if (key.isString() && value.isInt()) {
+                names.push_back(key.toString()->string());
+                values.push_back(static_cast<int32_t>(value.toInt()));
+            } else {
+                C10_THROW_ERROR(TypeError,
+                    "expected argument to be Dict[str, int], got Dict["
+                    + key.type()->str() + ", " + value.type()->str() + "]"
+                );
+            }
+        }
+
+        auto labels = torch::make_intrusive<LabelsHolder>(
+            metatensor::Labels(names, values.data(), 1)
+        );
+        return this->block(torch::make_intrusive<LabelsEntryHolder>(labels, 0));
+    } else if (selection.isCustomClass()) {
+        if (custom_class_is<LabelsHolder>(selection)) {
+            auto labels = selection.toCustomClass<LabelsHolder>();
+            if (labels->count() != 1) {
+                C10_THROW_ERROR(ValueError,
+                    "block selection must contain exactly one entry, got " + std::to_string(labels->count())
+                );
+            }
+            return this->block(torch::make_intrusive<LabelsEntryHolder>(labels, 0));
+        } else if (custom_class_is<LabelsEntryHolder>(selection)) {
+            return this->block(selection.toCustomClass<LabelsEntryHolder>());
+        } else {
+            C10_THROW_ERROR(TypeError,
+                "expected argument to be Labels or LabelsEntry, got"
+                + selection.type()->str()
+            );
+        }
+    } else {
+        C10_THROW_ERROR(TypeError,
+            "expected argument to be int, Dict[str, int], Labels, or LabelsEntry, got "
+            + selection.type()->str()
+        );
+    }
+}
+
+TorchTensorMap TensorMapReaderHolder::load(const TorchLabels& selection) const {
+    return torch::make_intrusive<TensorMapHolder>(
+        TensorMapHolder(reader_.load(selection->as_metatensor()))
+    );
+}
@@ -1,9 +1,13 @@
 #include <torch/script.h>
+#include <torch/version.h>
 
 #include "metatensor/torch/labels.hpp"
 #include "metatensor/torch/block.hpp"
 #include "metatensor/torch/tensor.hpp"
+#include "metatensor/torch/reader.hpp"
+#include "metatensor/torch/loader.hpp"
 #include "metatensor/torch/misc.hpp"
+#include "metatensor/torch/operations.hpp"
 #include "metatensor/torch/atomistic.hpp"
 
 #include "internal/utils.hpp"
@@ -30,14 +34,68 @@ static torch::IValue labels_getitem(const TorchLabels& self, torch::IValue index
     }
 }
 
-template <typename T>
-bool custom_class_is(torch::IValue ivalue) {
-    assert(ivalue.isCustomClass());
-
-    // this is inspired by the code inside `torch::IValue.toCustomClass<T>()`
-    auto* expected_type = torch::getCustomClassType<torch::intrusive_ptr<T>>().get();
-    return ivalue.type().get() == expected_type;
+// `torch::class_<T>::def_static` does not support default values for the
+// arguments, and `def_static_with_defaults` below needs to use the same torch
+// internals as `def_static` to get them. These internals are unchanged in all
+// the versions of torch we support (1.12 to 2.x). For other versions, we only
+// use the public `def_static`, and the static `load`/`load_buffer` functions
+// only take the path or buffer. `dtype` and `device` are then only available
+// through the free functions (`metatensor.torch.load`, etc.).
+#if TORCH_VERSION_MAJOR == 1 || TORCH_VERSION_MAJOR == 2
+#define METATENSOR_TORCH_STATIC_DEFAULTS 1
+#else
+#define METATENSOR_TORCH_STATIC_DEFAULTS 0
+#endif
+
+#if METATENSOR_TORCH_STATIC_DEFAULTS
+/// Register a static method `name` for the custom class `T`, using `func` and
+/// the given arguments names and default values.
+///
+/// This does the same as `torch::class_<T>::def_static`, which does not
+/// support default values for the arguments. We need these default values to
+/// keep `TensorMap.load(path)` working while also accepting the optional
+/// `dtype` and `device`.
+template <typename T, typename Func>
+static void def_static_with_defaults(
+    const std::string& name,
+    Func func,
+    std::initializer_list<torch::arg> args
+) {
+    const auto& class_type = torch::getCustomClassType<torch::intrusive_ptr<T>>();
+
+    auto schema = c10::inferFunctionSchemaSingleReturn<Func>(std::string(name), "");
+    const auto& inferred = schema.arguments();
+    assert(inferred.size() == args.size());
+
+    auto arguments = std::vector<c10::Argument>();
+    auto inferred_it = inferred.begin();
+    for (const auto& arg: args) {
+        arguments.emplace_back(
+            arg.name_,
+            inferred_it->type(),
+            inferred_it->real_type(),
+            inferred_it->N(),
+            arg.value_
+        );
+        ++inferred_it;
+    }
+    schema = schema.cloneWithArguments(std::move(arguments));
+
+    auto wrapped = [func = std::move(func)](torch::jit::Stack& stack) mutable {
+        using ReturnType = typename c10::guts::infer_function_traits_t<Func>::return_type;
+        torch::detail::BoxedProxy<ReturnType, Func>()(stack, func);
+    };
+
+    auto method = std::make_unique<torch::jit::BuiltinOpFunction>(
+        class_type->name()->qualifiedName() + "." + name,
+        std::move(schema),
+        std::move(wrapped),
+        /*doc_string=*/""
+    );
+    class_type->addStaticMethod(method.get());
+    torch::registerCustomClassMethod(std::move(method));
 }
+#endif
 
 static void save_ivalue(const std::string& path, torch::IValue data) {
     if (data.isCustomClass()) {
@@ -79,6 +137,46 @@ static torch::Tensor save_ivalue_buffer(torch::IValue data) {
     );
 }
 
+static int64_t serialized_size_ivalue(torch::IValue data) {
+    if (data.isCustomClass()) {
+        if (custom_class_is<TensorMapHolder>(data)) {
+            auto tensor = data.toCustomClass<TensorMapHolder>();
+            return metatensor_torch::serialized_size(tensor);
+        } else if (custom_class_is<TensorBlockHolder>(data)) {
+            auto block = data.toCustomClass<TensorBlockHolder>();
+            return metatensor_torch::serialized_size(block);
+        } else if (custom_class_is<LabelsHolder>(data)) {
+            auto labels = data.toCustomClass<LabelsHolder>();
+            return metatensor_torch::serialized_size(labels);
+        }
+    }
+
+    C10_THROW_ERROR(TypeError,
+        "`data` must be one of 'Labels', 'TensorBlock' or 'TensorMap' in `serialized_size`, "
+        "not " + data.type()->str()
+    );
+}
+
+static int64_t save_ivalue_into_buffer(torch::IValue data, torch::Tensor buffer) {
+    if (data.isCustomClass()) {
+        if (custom_class_is<TensorMapHolder>(data)) {
+            auto tensor = data.toCustomClass<TensorMapHolder>();
+            return metatensor_torch::save_into_buffer(tensor, buffer);
+        } else if (custom_class_is<TensorBlockHolder>(data)) {
+            auto block = data.toCustomClass<TensorBlockHolder>();
+            return metatensor_torch::save_into_buffer(block, buffer);
+        } else if (custom_class_is<LabelsHolder>(data)) {
+            auto labels = data.toCustomClass<LabelsHolder>();
+            return metatensor_torch::save_into_buffer(labels, buffer);
+        }
+    }
+
+    C10_THROW_ERROR(TypeError,
+        "`data` must be one of 'Labels', 'TensorBlock' or 'TensorMap' in `save_into_buffer`, "
+        "not " + data.type()->str()
+    );
+}
+
 TORCH_LIBRARY(metatensor, m) {
     // There is no way to access the docstrings from Python, so we don't bother
     // setting them to something useful here.
@@ -112,8 +210,8 @@ TORCH_LIBRARY(metatensor, m) {
 
     m.class_<LabelsHolder>("Labels")
         .def(
-            torch::init<torch::IValue, torch::Tensor>(), DOCSTRING,
-            {torch::arg("names"), torch::arg("values")}
+            torch::init<torch::IValue, torch::Tensor, bool>(), DOCSTRING,
+            {torch::arg("names"), torch::arg("values"), torch::arg("assume_unique") = false}
         )
         .def("__str__", &LabelsHolder::str)
         .def("__repr__", &LabelsHolder::repr)
@@ -135,10 +233,13 @@ TORCH_LIBRARY(metatensor, m) {
         .def_static("single", &LabelsHolder::single)
         .def_static("empty", &LabelsHolder::empty)
         .def_static("range", &LabelsHolder::range)
+        .def_static("range_product", &LabelsHolder::range_product)
+#if !METATENSOR_TORCH_STATIC_DEFAULTS
+        .def_static("load", [](const std::string& path) { return LabelsHolder::load(path); })
+        .def_static("load_buffer", [](torch::Tensor buffer) { return LabelsHolder::load_buffer(std::move(buffer)); })
+#endif
         .def("save", &LabelsHolder::save, DOCSTRING, {torch::arg("file")})
         .def("save_buffer", &LabelsHolder::save_buffer)
-        .def_static("load", &LabelsHolder::load)
-        .def_static("load_buffer", &LabelsHolder::load_buffer)
         .def("entry", labels_entry, DOCSTRING, {torch::arg("index")})
         .def("column", &LabelsHolder::column, DOCSTRING, {torch::arg("dimension")})
         .def("view", [](const TorchLabels& self, torch::IValue names) {
@@ -153,13 +254,20 @@ TORCH_LIBRARY(metatensor, m) {
         .def("remove", &LabelsHolder::remove, DOCSTRING, {torch::arg("name")})
         .def("rename", &LabelsHolder::rename, DOCSTRING, {torch::arg("old"), torch::arg("new")})
         .def("to",
-            static_cast<TorchLabels (LabelsHolder::*)(torch::IValue) const>(&LabelsHolder::to),
-            DOCSTRING, {torch::arg("device")}
+            static_cast<TorchLabels (LabelsHolder::*)(torch::IValue, bool) const>(&LabelsHolder::to),
+            DOCSTRING, {torch::arg("device"), torch::arg("non_blocking") = false}
         )
+        .def("pin_memory", &LabelsHolder::pin_memory)
         .def_property("device", &LabelsHolder::device)
         .def("position", &LabelsHolder::position, DOCSTRING,
             {torch::arg("entry")}
         )
+        .def("positions", &LabelsHolder::positions, DOCSTRING,
+            {torch::arg("entries")}
+        )
+        .def("range_of", &LabelsHolder::range_of, DOCSTRING,
+            {torch::arg("prefix")}
+        )
         .def("print", &LabelsHolder::print, DOCSTRING,
             {torch::arg("max_entries"), torch::arg("indent") = 0}
         )
@@ -187,6 +295,7 @@ TORCH_LIBRARY(metatensor, m) {
         .def("__str__", &TensorBlockHolder::repr)
         .def("__len__", &TensorBlockHolder::len )
         .def("copy", &TensorBlockHolder::copy)
+        .def("shallow_copy", &TensorBlockHolder::shallow_copy)
         .def_property("values", &TensorBlockHolder::values)
         .def_property("samples", &TensorBlockHolder::samples)
         .def_property("components", &TensorBlockHolder::components)
@@ -203,6 +312,9 @@ TORCH_LIBRARY(metatensor, m) {
             {torch::arg("parameter")}
         )
         .def("gradients", &TensorBlockHolder::gradients)
+        .def("gradient_sample_index", &TensorBlockHolder::gradient_sample_index, DOCSTRING,
+            {torch::arg("parameter")}
+        )
         .def_property("device", &TensorBlockHolder::device)
         .def_property("dtype", &TensorBlockHolder::scalar_type)
         .def("to", &TensorBlockHolder::to_positional, DOCSTRING, {
@@ -210,12 +322,16 @@ TORCH_LIBRARY(metatensor, m) {
             torch::arg("_1") = torch::IValue(),
             torch::arg("dtype") = torch::nullopt,
             torch::arg("device") = torch::nullopt,
-            torch::arg("arrays") = torch::nullopt
+            torch::arg("arrays") = torch::nullopt,
+            torch::arg("non_blocking") = false
         })
+        .def("pin_memory", &TensorBlockHolder::pin_memory)
+#if !METATENSOR_TORCH_STATIC_DEFAULTS
+        .def_static("load", [](const std::string& path) { return TensorBlockHolder::load(path); })
+        .def_static("load_buffer", [](torch::Tensor buffer) { return TensorBlockHolder::load_buffer(std::move(buffer)); })
+#endif
         .def("save", &TensorBlockHolder::save, DOCSTRING, {torch::arg("file")})
         .def("save_buffer", &TensorBlockHolder::save_buffer)
-        .def_static("load", &TensorBlockHolder::load)
-        .def_static("load_buffer", &TensorBlockHolder::load_buffer)
         .def_pickle(
             // __getstate__
             [](const TorchTensorBlock& self){ return self->save_buffer(); },
@@ -235,10 +351,13 @@ TORCH_LIBRARY(metatensor, m) {
             {torch::arg("selection")}
         )
         .def("copy", &TensorMapHolder::copy)
+        .def("shallow_copy", &TensorMapHolder::shallow_copy)
+#if !METATENSOR_TORCH_STATIC_DEFAULTS
+        .def_static("load", [](const std::string& path) { return TensorMapHolder::load(path); })
+        .def_static("load_buffer", [](torch::Tensor buffer) { return TensorMapHolder::load_buffer(std::move(buffer)); })
+#endif
         .def("save", &TensorMapHolder::save, DOCSTRING, {torch::arg("file")})
         .def("save_buffer", &TensorMapHolder::save_buffer)
-        .def_static("load", &TensorMapHolder::load)
-        .def_static("load_buffer", &TensorMapHolder::load_buffer)
         .def("items", &TensorMapHolder::items)
         .def_property("keys", &TensorMapHolder::keys)
         .def("blocks_matching", &TensorMapHolder::blocks_matching, DOCSTRING,
@@ -256,6 +375,9 @@ TORCH_LIBRARY(metatensor, m) {
         .def("blocks", &TensorMapHolder::blocks_torch, DOCSTRING,
             {torch::arg("selection") = torch::IValue()}
         )
+        .def("blocks_for", &TensorMapHolder::blocks_for, DOCSTRING,
+            {torch::arg("selection")}
+        )
         .def("keys_to_samples", &TensorMapHolder::keys_to_samples, DOCSTRING,
             {torch::arg("keys_to_move"), torch::arg("sort_samples") = true}
         )
@@ -265,6 +387,10 @@ TORCH_LIBRARY(metatensor, m) {
         .def("components_to_properties", &TensorMapHolder::components_to_properties, DOCSTRING,
             {torch::arg("dimensions")}
         )
+        .def("split_samples", &TensorMapHolder::split_samples, DOCSTRING,
+            {torch::arg("dimension"), torch::arg("shards"), torch::arg("n_shards")}
+        )
+        .def_static("merge_samples", &TensorMapHolder::merge_samples)
         .def_property("sample_names", &TensorMapHolder::sample_names)
         .def_property("component_names", &TensorMapHolder::component_names)
         .def_property("property_names", &TensorMapHolder::property_names)
@@ -275,8 +401,15 @@ TORCH_LIBRARY(metatensor, m) {
             torch::arg("_1") = torch::IValue(),
             torch::arg("dtype") = torch::nullopt,
             torch::arg("device") = torch::nullopt,
-            torch::arg("arrays") = torch::nullopt
+            torch::arg("arrays") = torch::nullopt,
+            torch::arg("non_blocking") = false
         })
+        .def("pin_memory", &TensorMapHolder::pin_memory)
+        .def("pack", &TensorMapHolder::pack, DOCSTRING,
+            {torch::arg("gradients") = true}
+        )
+        .def("is_packed", &TensorMapHolder::is_packed)
+        .def("packed_buffer", &TensorMapHolder::packed_buffer)
         .def("print", &TensorMapHolder::print, DOCSTRING,
             {torch::arg("max_keys")}
         )
@@ -287,40 +420,169 @@ TORCH_LIBRARY(metatensor, m) {
             [](torch::Tensor buffer){ return metatensor_torch::load_buffer(buffer); }
         );
 
+    m.class_<TensorMapReaderHolder>("TensorMapReader")
+        .def(torch::init<std::string>(), DOCSTRING, {torch::arg("path")})
+        .def_property("keys", &TensorMapReaderHolder::keys)
+        .def("blocks_matching", &TensorMapReaderHolder::blocks_matching, DOCSTRING,
+            {torch::arg("selection")}
+        )
+        .def("block_by_id", &TensorMapReaderHolder::block_by_id, DOCSTRING,
+            {torch::arg("index")}
+        )
+        .def("block", &TensorMapReaderHolder::block_torch, DOCSTRING,
+            {torch::arg("selection")}
+        )
+        .def("load", &TensorMapReaderHolder::load, DOCSTRING,
+            {torch::arg("selection")}
+        );
+
+    m.class_<TensorMapLoaderHolder>("TensorMapLoader")
+        .def(
+            torch::init<std::vector<std::string>, int64_t, bool, torch::optional<torch::Dtype>, torch::optional<torch::Device>, int64_t, int64_t>(),
+            DOCSTRING, {
+                torch::arg("paths"),
+                torch::arg("batch_size"),
+                torch::arg("shuffle") = false,
+                torch::arg("dtype") = torch::IValue(),
+                torch::arg("device") = torch::IValue(),
+                torch::arg("num_workers") = 2,
+                torch::arg("prefetch") = 2,
+            }
+        )
+        .def("__len__", &TensorMapLoaderHolder::size)
+        .def("next", &TensorMapLoaderHolder::next)
+        .def("reset", &TensorMapLoaderHolder::reset);
+
+#if METATENSOR_TORCH_STATIC_DEFAULTS
+    // static functions with default arguments
+    def_static_with_defaults<LabelsHolder>("load",
+        [](const std::string& path, torch::optional<torch::Device> device) {
+            return LabelsHolder::load(path, device);
+        },
+        {torch::arg("path"), torch::arg("device") = torch::IValue()}
+    );
+    def_static_with_defaults<LabelsHolder>("load_buffer",
+        [](torch::Tensor buffer, torch::optional<torch::Device> device) {
+            return LabelsHolder::load_buffer(std::move(buffer), device);
+        },
+        {torch::arg("buffer"), torch::arg("device") = torch::IValue()}
+    );
+
+    def_static_with_defaults<TensorBlockHolder>("load",
+        [](const std::string& path, torch::optional<torch::Dtype> dtype, torch::optional<torch::Device> device) {
+            return TensorBlockHolder::load(path, dtype, device);
+        },
+        {torch::arg("path"), torch::arg("dtype") = torch::IValue(), torch::arg("device") = torch::IValue()}
+    );
+    def_static_with_defaults<TensorBlockHolder>("load_buffer",
+        [](torch::Tensor buffer, torch::optional<torch::Dtype> dtype, torch::optional<torch::Device> device) {
+            return TensorBlockHolder::load_buffer(std::move(buffer), dtype, device);
+        },
+        {torch::arg("buffer"), torch::arg("dtype") = torch::IValue(), torch::arg("device") = torch::IValue()}
+    );
+
+    def_static_with_defaults<TensorMapHolder>("load",
+        [](const std::string& path, torch::optional<torch::Dtype> dtype, torch::optional<torch::Device> device) {
+            return TensorMapHolder::load(path, dtype, device);
+        },
+        {torch::arg("path"), torch::arg("dtype") = torch::IValue(), torch::arg("device") = torch::IValue()}
+    );
+    def_static_with_defaults<TensorMapHolder>("load_buffer",
+        [](torch::Tensor buffer, torch::optional<torch::Dtype> dtype, torch::optional<torch::Device> device) {
+            return TensorMapHolder::load_buffer(std::move(buffer), dtype, device);
+        },
+        {torch::arg("buffer"), torch::arg("dtype") = torch::IValue(), torch::arg("device") = torch::IValue()}
+    );
+#endif
+
 
     // standalone functions
     m.def("version() -> str", metatensor_torch::version);
     m.def("dtype_name(ScalarType dtype) -> str", scalar_type_name);
 
     m.def(
-        "load(str path) -> __torch__.torch.classes.metatensor.TensorMap",
+        "load(str path, ScalarType? dtype=None, Device? device=None) -> __torch__.torch.classes.metatensor.TensorMap",
         metatensor_torch::load
     );
     m.def(
-        "load_buffer(Tensor buffer) -> __torch__.torch.classes.metatensor.TensorMap",
+        "load_buffer(Tensor buffer, ScalarType? dtype=None, Device? device=None) -> __torch__.torch.classes.metatensor.TensorMap",
         metatensor_torch::load_buffer
     );
+    m.def(
+        "load_mmap(str path) -> __torch__.torch.classes.metatensor.TensorMap",
+        metatensor_torch::load_mmap
+    );
 
     m.def(
-        "load_block(str path) -> __torch__.torch.classes.metatensor.TensorBlock",
+        "load_block(str path, ScalarType? dtype=None, Device? device=None) -> __torch__.torch.classes.metatensor.TensorBlock",
         metatensor_torch::load_block
     );
     m.def(
-        "load_block_buffer(Tensor buffer) -> __torch__.torch.classes.metatensor.TensorBlock",
+        "load_block_buffer(Tensor buffer, ScalarType? dtype=None, Device? device=None) -> __torch__.torch.classes.metatensor.TensorBlock",
         metatensor_torch::load_block_buffer
     );
+    m.def(
+        "load_block_mmap(str path) -> __torch__.torch.classes.metatensor.TensorBlock",
+        metatensor_torch::load_block_mmap
+    );
 
     m.def(
-        "load_labels(str path) -> __torch__.torch.classes.metatensor.Labels",
+        "load_labels(str path, Device? device=None) -> __torch__.torch.classes.metatensor.Labels",
         metatensor_torch::load_labels
     );
     m.def(
-        "load_labels_buffer(Tensor buffer) -> __torch__.torch.classes.metatensor.Labels",
+        "load_labels_buffer(Tensor buffer, Device? device=None) -> __torch__.torch.classes.metatensor.Labels",
         metatensor_torch::load_labels_buffer
     );
 
     m.def("save(str path, Any data) -> ()", save_ivalue);
     m.def("save_buffer(Any data) -> Tensor", save_ivalue_buffer);
+    m.def("serialized_size(Any data) -> int", serialized_size_ivalue);
+    m.def("save_into_buffer(Any data, Tensor buffer) -> int", save_ivalue_into_buffer);
+
+    // native implementations of some operations from metatensor-operations
+    m.def(
+        "reduce_over_samples_block("
+            "__torch__.torch.classes.metatensor.TensorBlock block, "
+            "str[] sample_names, "
+            "str reduction"
+        ") -> __torch__.torch.classes.metatensor.TensorBlock",
+        metatensor_torch::reduce_over_samples_block
+    );
+    m.def(
+        "reduce_over_samples("
+            "__torch__.torch.classes.metatensor.TensorMap tensor, "
+            "str[] sample_names, "
+            "str reduction"
+        ") -> __torch__.torch.classes.metatensor.TensorMap",
+        metatensor_torch::reduce_over_samples
+    );
+    m.def(
+        "slice_block("
+            "__torch__.torch.classes.metatensor.TensorBlock block, "
+            "str axis, "
+            "__torch__.torch.classes.metatensor.Labels selection"
+        ") -> __torch__.torch.classes.metatensor.TensorBlock",
+        metatensor_torch::slice_block
+    );
+    m.def(
+        "slice("
+            "__torch__.torch.classes.metatensor.TensorMap tensor, "
+            "str axis, "
+            "__torch__.torch.classes.metatensor.Labels selection"
+        ") -> __torch__.torch.classes.metatensor.TensorMap",
+        metatensor_torch::slice
+    );
+    m.def(
+        "join("
+            "__torch__.torch.classes.metatensor.TensorMap[] tensors, "
+            "str axis, "
+            "str different_keys = \"error\", "
+            "bool sort_samples = False, "
+            "bool remove_tensor_name = False"
+        ") -> __torch__.torch.classes.metatensor.TensorMap",
+        metatensor_torch::join
+    );
 
     // ====================================================================== //
     //               code specific to atomistic simulations                   //
@@ -372,14 +634,19 @@ TORCH_LIBRARY(metatensor, m) {
             torch::arg("_0") = torch::IValue(),
             torch::arg("_1") = torch::IValue(),
             torch::arg("dtype") = torch::nullopt,
-            torch::arg("device") = torch::nullopt
+            torch::arg("device") = torch::nullopt,
+            torch::arg("non_blocking") = false
         })
+        .def("pin_memory", &SystemHolder::pin_memory)
         .def("add_neighbor_list", &SystemHolder::add_neighbor_list, DOCSTRING,
             {torch::arg("options"), torch::arg("neighbors")}
         )
         .def("get_neighbor_list", &SystemHolder::get_neighbor_list, DOCSTRING,
             {torch::arg("options")}
         )
+        .def("has_neighbor_list", &SystemHolder::has_neighbor_list, DOCSTRING,
+            {torch::arg("options")}
+        )
         .def("known_neighbor_lists", &SystemHolder::known_neighbor_lists)
         .def("add_data", &SystemHolder::add_data, DOCSTRING,
             {torch::arg("name"), torch::arg("data"), torch::arg("override") = false}
@@ -390,6 +657,56 @@ TORCH_LIBRARY(metatensor, m) {
         .def("known_data", &SystemHolder::known_data)
         ;
 
+    m.class_<SystemBatchHolder>("SystemBatch")
+        .def(
+            torch::init<std::vector<System>>(), DOCSTRING,
+            {torch::arg("systems")}
+        )
+        .def_property("systems", &SystemBatchHolder::systems)
+        .def_property("types", &SystemBatchHolder::types)
+        .def_property("positions", &SystemBatchHolder::positions)
+        .def_property("cells", &SystemBatchHolder::cells)
+        .def_property("pbcs", &SystemBatchHolder::pbcs)
+        .def_property("offsets", &SystemBatchHolder::offsets)
+        .def_property("system_indices", &SystemBatchHolder::system_indices)
+        .def("__len__", &SystemBatchHolder::size)
+        .def("__str__", &SystemBatchHolder::str)
+        .def("__repr__", &SystemBatchHolder::str)
+        .def_property("device", &SystemBatchHolder::device)
+        .def_property("dtype", &SystemBatchHolder::scalar_type)
+        .def("to", &SystemBatchHolder::to_positional, DOCSTRING, {
+            torch::arg("_0") = torch::IValue(),
+            torch::arg("_1") = torch::IValue(),
+            torch::arg("dtype") = torch::nullopt,
+            torch::arg("device") = torch::nullopt,
+            torch::arg("non_blocking") = false
+        })
+        .def("get_neighbor_list", &SystemBatchHolder::get_neighbor_list, DOCSTRING,
+            {torch::arg("options")}
+        )
+        .def("known_neighbor_lists", &SystemBatchHolder::known_neighbor_lists)
+        ;
+
+    m.class_<NeighborListCacheHolder>("NeighborListCache")
+        .def(
+            torch::init<NeighborListOptions, double, std::string, torch::optional<torch::Dtype>>(), DOCSTRING,
+            {torch::arg("options"), torch::arg("skin"), torch::arg("length_unit") = "", torch::arg("dtype") = torch::nullopt}
+        )
+        .def_property("options", &NeighborListCacheHolder::options)
+        .def_property("skin", &NeighborListCacheHolder::skin)
+        .def_property("rebuilds", &NeighborListCacheHolder::rebuilds)
+        .def("update", &NeighborListCacheHolder::update, DOCSTRING,
+            {torch::arg("system")}
+        )
+        .def("update_static", &NeighborListCacheHolder::update_static, DOCSTRING,
+            {torch::arg("system")}
+        )
+        .def("needs_rebuild", &NeighborListCacheHolder::needs_rebuild, DOCSTRING,
+            {torch::arg("system")}
+        )
+        .def("reset", &NeighborListCacheHolder::reset)
+        ;
+
 
     m.class_<ModelMetadataHolder>("ModelMetadata")
         .def(
@@ -504,6 +821,10 @@ TORCH_LIBRARY(metatensor, m) {
             &ModelEvaluationOptionsHolder::get_selected_atoms,
             &ModelEvaluationOptionsHolder::set_selected_atoms
         )
+        .def_property("neighbors_dtype",
+            &ModelEvaluationOptionsHolder::neighbors_dtype,
+            &ModelEvaluationOptionsHolder::set_neighbors_dtype
+        )
         .def_pickle(
             [](const ModelEvaluationOptions& self) -> std::string {
                 return self->to_json();
@@ -526,4 +847,14 @@ TORCH_LIBRARY(metatensor, m) {
         ") -> ()",
         register_autograd_neighbors
     );
+
+    m.def(
+        "compute_neighbors("
+            "__torch__.torch.classes.metatensor.System system, "
+            "__torch__.torch.classes.metatensor.NeighborListOptions options, "
+            "str length_unit = \"\", "
+            "ScalarType? dtype = None"
+        ") -> __torch__.torch.classes.metatensor.TensorBlock",
+        compute_neighbors
+    );
 }
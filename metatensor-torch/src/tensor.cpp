@@ -1,24 +1,19 @@
 #include <metatensor.hpp>
+#include <algorithm>
 #include <string>
+#include <unordered_map>
 
 #include "metatensor/torch/tensor.hpp"
 #include "metatensor/torch/array.hpp"
 #include "metatensor/torch/block.hpp"
 #include "metatensor/torch/misc.hpp"
 
+#include "internal/profiling.hpp"
+#include "internal/serialization.hpp"
 #include "internal/utils.hpp"
 
 using namespace metatensor_torch;
 
-template <typename T>
-bool custom_class_is(torch::IValue ivalue) {
-    assert(ivalue.isCustomClass());
-
-    // this is inspired by the code inside `torch::IValue.toCustomClass<T>()`
-    auto* expected_type = torch::getCustomClassType<torch::intrusive_ptr<T>>().get();
-    return ivalue.type().get() == expected_type;
-}
-
 static metatensor::TensorBlock block_from_torch(const TorchTensorBlock& block) {
     auto components = std::vector<metatensor::Labels>();
     for (const auto& component: block->components()) {
@@ -51,9 +46,14 @@ static std::vector<metatensor::TensorBlock> blocks_from_torch(const std::vector<
     return results;
 }
 
+static metatensor::TensorMap create_metatensor_tensor(const TorchLabels& keys, const std::vector<TorchTensorBlock>& blocks) {
+    METATENSOR_TORCH_RECORD_FUNCTION("metatensor::TensorMap::TensorMap");
+    return metatensor::TensorMap(keys->as_metatensor(), blocks_from_torch(blocks));
+}
+
 
 TensorMapHolder::TensorMapHolder(TorchLabels keys, const std::vector<TorchTensorBlock>& blocks):
-    tensor_(keys->as_metatensor(), blocks_from_torch(blocks))
+    tensor_(create_metatensor_tensor(keys, blocks))
 {
     if (blocks.empty()) {
         // nothing to check
@@ -84,6 +84,26 @@ TorchTensorMap TensorMapHolder::copy() const {
     return torch::make_intrusive<TensorMapHolder>(TensorMapHolder(this->tensor_.clone()));
 }
 
+TorchTensorMap TensorMapHolder::shallow_copy() const {
+    if (this->is_packed()) {
+        return this->from_packed_buffer(
+            packed_,
+            packed_gradients_,
+            [](const TorchLabels& labels) { return labels; },
+            [](const TorchTensorBlock& gradient) { return gradient->shallow_copy(); }
+        );
+    }
+
+    auto new_blocks = std::vector<TorchTensorBlock>();
+    for (int64_t block_i=0; block_i<this->keys()->count(); block_i++) {
+        // const_cast is fine here since the new blocks only share the data
+        auto block = const_cast<metatensor::TensorMap&>(this->tensor_).block_by_id(block_i);
+        auto torch_block = torch::make_intrusive<TensorBlockHolder>(std::move(block), torch::IValue());
+        new_blocks.emplace_back(torch_block->shallow_copy());
+    }
+    return torch::make_intrusive<TensorMapHolder>(this->keys(), new_blocks);
+}
+
 TorchLabels TensorMapHolder::keys() const {
     return torch::make_intrusive<LabelsHolder>(this->tensor_.keys());
 }
@@ -114,16 +134,185 @@ TorchTensorBlock TensorMapHolder::block_by_id(TorchTensorMap self, int64_t index
 }
 
 
+struct TensorMapHolder::BlockIndex {
+    /// Entry in the index, for a single set of values of the keys
+    struct Entry {
+        std::vector<int32_t> values;
+        std::vector<int64_t> blocks;
+    };
+
+    /// Hash the `values[size]` of some keys, using FNV-1a
+    static size_t hash(const int32_t* values, size_t size) {
+        uint64_t hash = 14695981039346656037ULL;
+        for (size_t i=0; i<size; i++) {
+            hash ^= static_cast<uint32_t>(values[i]);
+            hash *= 1099511628211ULL;
+        }
+        return static_cast<size_t>(hash);
+    }
+
+    /// Number of key dimensions used by this index
+    size_t size = 0;
+    /// Entries in this index, grouped by the hash of their values. This allows
+    /// lookups without allocating memory for the values.
+    std::unordered_map<size_t, std::vector<Entry>> entries;
+
+    const std::vector<int64_t>& find(const int32_t* values) const {
+        static const auto NO_BLOCKS = std::vector<int64_t>();
+
+        auto it = entries.find(BlockIndex::hash(values, size));
+        if (it != entries.end()) {
+            for (const auto& entry: it->second) {
+                if (std::equal(entry.values.begin(), entry.values.end(), values)) {
+                    return entry.blocks;
+                }
+            }
+        }
+
+        return NO_BLOCKS;
+    }
+
+    /// Create a new index for the key dimensions in `names`, returning
+    /// `nullptr` if some of the names are not part of the `keys`.
+    static std::shared_ptr<const BlockIndex> create(
+        const metatensor::Labels& keys,
+        const std::vector<std::string>& names
+    ) {
+        auto dimensions = std::vector<size_t>();
+        const auto& keys_names = keys.names();
+        for (const auto& name: names) {
+            auto it = std::find(keys_names.begin(), keys_names.end(), name);
+            if (it == keys_names.end()) {
+                return nullptr;
+            }
+            dimensions.push_back(static_cast<size_t>(std::distance(keys_names.begin(), it)));
+        }
+
+        auto index = std::make_shared<BlockIndex>();
+        index->size = dimensions.size();
+
+        const auto& keys_values = keys.values();
+        auto values = std::vector<int32_t>(dimensions.size());
+        for (size_t block_i=0; block_i<keys.count(); block_i++) {
+            for (size_t i=0; i<dimensions.size(); i++) {
+                values[i] = keys_values(block_i, dimensions[i]);
+            }
+
+            auto& bucket = index->entries[BlockIndex::hash(values.data(), values.size())];
+            auto entry = std::find_if(bucket.begin(), bucket.end(), [&](const BlockIndex::Entry& e) {
+                return e.values == values;
+            });
+
+            if (entry == bucket.end()) {
+                bucket.push_back({values, {static_cast<int64_t>(block_i)}});
+            } else {
+                entry->blocks.push_back(static_cast<int64_t>(block_i));
+            }
+        }
+
+        return index;
+    }
+};
+
+const std::vector<int64_t>* TensorMapHolder::cached_blocks_matching(
+    const std::vector<std::string>& names,
+    const int32_t* values
+) const {
+    if (names.empty()) {
+        return nullptr;
+    }
+
+    auto index = std::shared_ptr<const BlockIndex>();
+    {
+        auto lock = std::shared_lock<std::shared_mutex>(block_index_cache_->mutex);
+        auto it = block_index_cache_->indexes.find(names);
+        if (it != block_index_cache_->indexes.end()) {
+            index = it->second;
+        }
+    }
+
+    if (index == nullptr) {
+        METATENSOR_TORCH_RECORD_FUNCTION("metatensor::TensorMap::create_block_index");
+        index = BlockIndex::create(tensor_.keys(), names);
+        if (index == nullptr) {
+            return nullptr;
+        }
+
+        auto lock = std::unique_lock<std::shared_mutex>(block_index_cache_->mutex);
+        index = block_index_cache_->indexes.emplace(names, index).first->second;
+    }
+
+    // the index is kept alive by `block_index_cache_` for as long as this
+    // TensorMap, so it is fine to return a pointer inside it
+    return &index->find(values);
+}
+
+/// Get the blocks matching a selection without going through the cache. This
+/// is used to get the right error message for invalid selections.
+static std::vector<int64_t> uncached_blocks_matching(
+    const metatensor::TensorMap& tensor,
+    const std::vector<std::string>& names,
+    const int32_t* values
+) {
+    auto selection = metatensor::Labels(names, values, 1);
+
+    auto matching = std::vector<int64_t>();
+    for (auto m: tensor.blocks_matching(selection)) {
+        matching.push_back(static_cast<int64_t>(m));
+    }
+    return matching;
+}
+
+static std::string print_selection(const std::vector<std::string>& names, const int32_t* values) {
+    auto output = std::string("(");
+    for (size_t i=0; i<names.size(); i++) {
+        output += names[i] + "=" + std::to_string(values[i]);
+        if (i < names.size() - 1) {
+            output += ", ";
+        }
+    }
+    output += ")";
+    return output;
+}
+
+static int64_t single_matching_block(
+    const std::vector<int64_t>& matching,
+    const std::vector<std::string>& names,
+    const int32_t* values
+) {
+    if (matching.empty()) {
+        C10_THROW_ERROR(ValueError,
+            "could not find blocks matching the selection " + print_selection(names, values)
+        );
+    } else if (matching.size() != 1) {
+        C10_THROW_ERROR(ValueError,
+            "got more than one matching block for " + print_selection(names, values) +
+            ", use the `blocks` function to select more than one block"
+        );
+    }
+
+    return matching[0];
+}
+
 TorchTensorBlock TensorMapHolder::block(TorchTensorMap self, const std::map<std::string, int32_t>& selection_dict) {
     auto names = std::vector<std::string>();
     auto values = std::vector<int32_t>();
+    names.reserve(selection_dict.size());
+    values.reserve(selection_dict.size());
     for (const auto& it: selection_dict) {
         names.push_back(it.first);
         values.push_back(static_cast<int32_t>(it.second));
     }
 
-    auto selection = metatensor::Labels(names, values.data(), 1);
-    return TensorMapHolder::block(std::move(self), torch::make_intrusive<LabelsHolder>(std::move(selection)));
+    const auto* matching = self->cached_blocks_matching(names, values.data());
+    auto fallback = std::vector<int64_t>();
+    if (matching == nullptr) {
+        fallback = uncached_blocks_matching(self->tensor_, names, values.data());
+        matching = &fallback;
+    }
+
+    auto block_id = single_matching_block(*matching, names, values.data());
+    return TensorMapHolder::block_by_id(std::move(self), block_id);
 }
 
 TorchTensorBlock TensorMapHolder::block(TorchTensorMap self, TorchLabels selection) {
@@ -138,23 +327,18 @@ TorchTensorBlock TensorMapHolder::block(TorchTensorMap self, TorchLabels selecti
 
 TorchTensorBlock TensorMapHolder::block(TorchTensorMap self, TorchLabelsEntry torch_selection) {
     auto cpu_values = torch_selection->values().to(torch::kCPU);
-    auto selection = metatensor::Labels(
-        torch_selection->names(), cpu_values.data_ptr<int32_t>(), 1
-    );
-
-    auto matching = self->tensor_.blocks_matching(selection);
-    if (matching.empty()) {
-        C10_THROW_ERROR(ValueError,
-            "could not find blocks matching the selection " + torch_selection->print()
-        );
-    } else if (matching.size() != 1) {
-        C10_THROW_ERROR(ValueError,
-            "got more than one matching block for " + torch_selection->print() +
-            ", use the `blocks` function to select more than one block"
-        );
+    const auto& names = torch_selection->names();
+    const auto* values = cpu_values.data_ptr<int32_t>();
+
+    const auto* matching = self->cached_blocks_matching(names, values);
+    auto fallback = std::vector<int64_t>();
+    if (matching == nullptr) {
+        fallback = uncached_blocks_matching(self->tensor_, names, values);
+        matching = &fallback;
     }
 
-    return TensorMapHolder::block_by_id(self, static_cast<int64_t>(matching[0]));
+    auto block_id = single_matching_block(*matching, names, values);
+    return TensorMapHolder::block_by_id(std::move(self), block_id);
 }
 
 TorchTensorBlock TensorMapHolder::block_torch(TorchTensorMap self, torch::IValue index) {
@@ -228,13 +412,20 @@ std::vector<TorchTensorBlock> TensorMapHolder::blocks(TorchTensorMap self) {
 std::vector<TorchTensorBlock> TensorMapHolder::blocks(TorchTensorMap self, const std::map<std::string, int32_t>& selection_dict) {
     auto names = std::vector<std::string>();
     auto values = std::vector<int32_t>();
+    names.reserve(selection_dict.size());
+    values.reserve(selection_dict.size());
     for (const auto& it: selection_dict) {
         names.push_back(it.first);
         values.push_back(static_cast<int32_t>(it.second));
     }
 
-    auto selection = metatensor::Labels(names, values.data(), 1);
-    return TensorMapHolder::blocks(std::move(self), torch::make_intrusive<LabelsHolder>(std::move(selection)));
+    const auto* matching = self->cached_blocks_matching(names, values.data());
+    if (matching == nullptr) {
+        auto fallback = uncached_blocks_matching(self->tensor_, names, values.data());
+        return TensorMapHolder::blocks_by_id(std::move(self), fallback);
+    }
+
+    return TensorMapHolder::blocks_by_id(std::move(self), *matching);
 }
 
 
@@ -251,16 +442,40 @@ std::vector<TorchTensorBlock> TensorMapHolder::blocks(TorchTensorMap self, Torch
 
 std::vector<TorchTensorBlock> TensorMapHolder::blocks(TorchTensorMap self, TorchLabelsEntry torch_selection) {
     auto cpu_values = torch_selection->values().to(torch::kCPU);
-    auto selection = metatensor::Labels(
-        torch_selection->names(), cpu_values.data_ptr<int32_t>(), 1
-    );
+    const auto& names = torch_selection->names();
+    const auto* values = cpu_values.data_ptr<int32_t>();
 
-    auto matching = std::vector<int64_t>();
-    for (auto m: self->tensor_.blocks_matching(selection)) {
-        matching.push_back(static_cast<int64_t>(m));
+    const auto* matching = self->cached_blocks_matching(names, values);
+    if (matching == nullptr) {
+        auto fallback = uncached_blocks_matching(self->tensor_, names, values);
+        return TensorMapHolder::blocks_by_id(std::move(self), fallback);
     }
 
-    return TensorMapHolder::blocks_by_id(self, matching);
+    return TensorMapHolder::blocks_by_id(std::move(self), *matching);
+}
+
+std::vector<TorchTensorBlock> TensorMapHolder::blocks_for(TorchTensorMap self, TorchLabels selection) {
+    auto cpu_values = selection->values().to(torch::kCPU).contiguous();
+    const auto& names = selection->names();
+    const auto size = names.size();
+
+    auto result = std::vector<TorchTensorBlock>();
+    result.reserve(static_cast<size_t>(selection->count()));
+    for (int64_t entry_i=0; entry_i<selection->count(); entry_i++) {
+        const auto* values = cpu_values.data_ptr<int32_t>() + static_cast<size_t>(entry_i) * size;
+
+        const auto* matching = self->cached_blocks_matching(names, values);
+        auto fallback = std::vector<int64_t>();
+        if (matching == nullptr) {
+            fallback = uncached_blocks_matching(self->tensor_, names, values);
+            matching = &fallback;
+        }
+
+        auto block_id = single_matching_block(*matching, names, values);
+        result.emplace_back(TensorMapHolder::block_by_id(self, block_id));
+    }
+
+    return result;
 }
 
 
@@ -344,6 +559,7 @@ static std::vector<std::string> extract_list_str(const torch::IValue& keys_to_mo
 }
 
 TorchTensorMap TensorMapHolder::keys_to_properties(torch::IValue keys_to_move, bool sort_samples) const {
+    METATENSOR_TORCH_RECORD_FUNCTION("metatensor::TensorMap::keys_to_properties");
     auto device = this->keys()->values().device();
     if (keys_to_move.isString() || keys_to_move.isList() || keys_to_move.isTuple()) {
         auto selection = extract_list_str(keys_to_move, "TensorMap::keys_to_properties first argument");
@@ -363,6 +579,7 @@ TorchTensorMap TensorMapHolder::keys_to_properties(torch::IValue keys_to_move, b
 }
 
 TorchTensorMap TensorMapHolder::keys_to_samples(torch::IValue keys_to_move, bool sort_samples) const {
+    METATENSOR_TORCH_RECORD_FUNCTION("metatensor::TensorMap::keys_to_samples");
     auto device = this->keys()->values().device();
     if (keys_to_move.isString() || keys_to_move.isList() || keys_to_move.isTuple()) {
         auto selection = extract_list_str(keys_to_move, "TensorMap::keys_to_samples first argument");
@@ -382,6 +599,7 @@ TorchTensorMap TensorMapHolder::keys_to_samples(torch::IValue keys_to_move, bool
 }
 
 TorchTensorMap TensorMapHolder::components_to_properties(torch::IValue dimensions) const {
+    METATENSOR_TORCH_RECORD_FUNCTION("metatensor::TensorMap::components_to_properties");
     auto device = this->keys()->values().device();
     auto selection = extract_list_str(dimensions, "TensorMap::components_to_properties argument");
     auto tensor = this->tensor_.components_to_properties(selection);
@@ -389,6 +607,88 @@ TorchTensorMap TensorMapHolder::components_to_properties(torch::IValue dimension
     return result->to(torch::nullopt, device);
 }
 
+std::vector<TorchTensorMap> TensorMapHolder::split_samples(
+    const std::string& dimension,
+    torch::Tensor shards,
+    int64_t n_shards
+) const {
+    METATENSOR_TORCH_RECORD_FUNCTION("metatensor::TensorMap::split_samples");
+
+    if (shards.dim() != 1) {
+        C10_THROW_ERROR(ValueError,
+            "`shards` must be a 1-dimensional tensor in TensorMap::split_samples, "
+            "got a tensor with " + std::to_string(shards.dim()) + " dimensions"
+        );
+    }
+
+    if (shards.is_floating_point() || shards.is_complex() || shards.scalar_type() == torch::kBool) {
+        C10_THROW_ERROR(ValueError,
+            "`shards` must be a tensor of integers in TensorMap::split_samples"
+        );
+    }
+
+    if (n_shards <= 0) {
+        C10_THROW_ERROR(ValueError,
+            "`n_shards` must be positive in TensorMap::split_samples, got " + std::to_string(n_shards)
+        );
+    }
+
+    shards = shards.to(torch::kCPU, torch::kInt64).contiguous();
+    if (shards.numel() != 0 && shards.min().item<int64_t>() < 0) {
+        C10_THROW_ERROR(ValueError,
+            "`shards` must not contain negative values in TensorMap::split_samples"
+        );
+    }
+
+    const auto* shards_ptr = shards.data_ptr<int64_t>();
+    auto c_shards = std::vector<uintptr_t>(shards_ptr, shards_ptr + shards.numel());
+
+    auto device = this->keys()->values().device();
+    auto split = tensor_.split_samples(dimension, c_shards, static_cast<uintptr_t>(n_shards));
+
+    auto results = std::vector<TorchTensorMap>();
+    results.reserve(split.size());
+    for (auto& tensor: split) {
+        auto result = torch::make_intrusive<TensorMapHolder>(TensorMapHolder(std::move(tensor)));
+        results.emplace_back(result->to(torch::nullopt, device));
+    }
+
+    return results;
+}
+
+TorchTensorMap TensorMapHolder::merge_samples(const std::vector<TorchTensorMap>& tensors) {
+    METATENSOR_TORCH_RECORD_FUNCTION("metatensor::TensorMap::merge_samples");
+
+    if (tensors.empty()) {
+        C10_THROW_ERROR(ValueError,
+            "provide at least one `TensorMap` for TensorMap::merge_samples"
+        );
+    }
+
+    auto device = tensors[0]->keys()->values().device();
+    for (const auto& tensor: tensors) {
+        if (tensor->keys()->values().device() != device) {
+            C10_THROW_ERROR(ValueError,
+                "all the `TensorMap` must be on the same device in TensorMap::merge_samples"
+            );
+        }
+    }
+
+    // use the C API directly to avoid copying the input tensors
+    auto ptrs = std::vector<const mts_tensormap_t*>();
+    ptrs.reserve(tensors.size());
+    for (const auto& tensor: tensors) {
+        ptrs.push_back(tensor->as_metatensor().as_mts_tensormap_t());
+    }
+
+    auto* ptr = mts_tensormap_merge_samples(ptrs.data(), ptrs.size());
+    metatensor::details::check_pointer(ptr);
+
+    auto tensor = metatensor::TensorMap(ptr);
+    auto result = torch::make_intrusive<TensorMapHolder>(TensorMapHolder(std::move(tensor)));
+    return result->to(torch::nullopt, device);
+}
+
 static std::vector<std::string> labels_names(const metatensor::TensorBlock& block, size_t dimension) {
     auto result = std::vector<std::string>();
 
@@ -467,17 +767,65 @@ torch::Dtype TensorMapHolder::scalar_type() const {
 
 TorchTensorMap TensorMapHolder::to(
     torch::optional<torch::Dtype> dtype,
-    torch::optional<torch::Device> device
+    torch::optional<torch::Device> device,
+    bool non_blocking
 ) const {
+    non_blocking = non_blocking_transfer(non_blocking, device);
+
+    if (this->is_packed()) {
+        // move all the values with a single copy
+        auto buffer = packed_.to(
+            dtype,
+            /*layout*/ torch::nullopt,
+            device,
+            /*pin_memory*/ torch::nullopt,
+            non_blocking,
+            /*copy*/ false,
+            /*memory_format*/ torch::MemoryFormat::Preserve
+        );
+        return this->from_packed_buffer(
+            std::move(buffer),
+            packed_gradients_,
+            [&](const TorchLabels& labels) { return labels->to(device, non_blocking); },
+            [&](const TorchTensorBlock& gradient) { return gradient->to(dtype, device, non_blocking); }
+        );
+    }
+
     auto new_blocks = std::vector<TorchTensorBlock>();
     for (int64_t block_i=0; block_i<this->keys()->count(); block_i++) {
         // const_cast is fine here since we will return a new copy of the data
         // with the different dtype/device
         auto block = const_cast<metatensor::TensorMap&>(this->tensor_).block_by_id(block_i);
         auto torch_block = torch::make_intrusive<TensorBlockHolder>(std::move(block), torch::IValue());
-        new_blocks.emplace_back(torch_block->to(dtype, device));
+        new_blocks.emplace_back(torch_block->to(dtype, device, non_blocking));
     }
-    return torch::make_intrusive<TensorMapHolder>(this->keys()->to(device), new_blocks);
+    return torch::make_intrusive<TensorMapHolder>(this->keys()->to(device, non_blocking), new_blocks);
+}
+
+TorchTensorMap TensorMapHolder::pin_memory() const {
+    if (!this->device().is_cpu()) {
+        C10_THROW_ERROR(ValueError,
+            "only TensorMap on CPU can be pinned, this TensorMap is on " + this->device().str()
+        );
+    }
+
+    if (this->is_packed()) {
+        return this->from_packed_buffer(
+            packed_.is_pinned() ? packed_ : packed_.pin_memory(),
+            packed_gradients_,
+            [](const TorchLabels& labels) { return labels->pin_memory(); },
+            [](const TorchTensorBlock& gradient) { return gradient->pin_memory(); }
+        );
+    }
+
+    auto new_blocks = std::vector<TorchTensorBlock>();
+    for (int64_t block_i=0; block_i<this->keys()->count(); block_i++) {
+        // const_cast is fine here since we will return a new copy of the data
+        auto block = const_cast<metatensor::TensorMap&>(this->tensor_).block_by_id(block_i);
+        auto torch_block = torch::make_intrusive<TensorBlockHolder>(std::move(block), torch::IValue());
+        new_blocks.emplace_back(torch_block->pin_memory());
+    }
+    return torch::make_intrusive<TensorMapHolder>(this->keys()->pin_memory(), new_blocks);
 }
 
 
@@ -486,7 +834,8 @@ TorchTensorMap TensorMapHolder::to_positional(
     torch::IValue positional_2,
     torch::optional<torch::Dtype> dtype,
     torch::optional<torch::Device> device,
-    torch::optional<std::string> arrays
+    torch::optional<std::string> arrays,
+    bool non_blocking
 ) const {
     if (arrays.value_or("torch") != "torch") {
         C10_THROW_ERROR(ValueError,
@@ -502,7 +851,137 @@ TorchTensorMap TensorMapHolder::to_positional(
         "`TensorMap.to`"
     );
 
-    return this->to(parsed_dtype, parsed_device);
+    return this->to(parsed_dtype, parsed_device, non_blocking);
+}
+
+
+TorchTensorMap TensorMapHolder::pack(bool gradients) const {
+    auto arrays = std::vector<torch::Tensor>();
+    for (int64_t block_i=0; block_i<this->keys()->count(); block_i++) {
+        // const_cast is fine here since we will only read the data
+        auto block = const_cast<metatensor::TensorMap&>(this->tensor_).block_by_id(block_i);
+        auto torch_block = torch::make_intrusive<TensorBlockHolder>(std::move(block), torch::IValue());
+
+        auto add_array = [&](const torch::Tensor& array) {
+            if (array.is_sparse()) {
+                // the packed blocks contain views inside a single dense
+                // buffer, so sparse values are converted to dense ones
+                arrays.push_back(array.to_dense().reshape({-1}));
+            } else {
+                arrays.push_back(array.reshape({-1}));
+            }
+        };
+
+        add_array(torch_block->values());
+        if (gradients) {
+            for (const auto& parameter: torch_block->gradients_list()) {
+                auto gradient = TensorBlockHolder::gradient(torch_block, parameter);
+                add_array(gradient->values());
+            }
+        }
+    }
+
+    for (const auto& array: arrays) {
+        if (array.device() != arrays[0].device()) {
+            C10_THROW_ERROR(ValueError,
+                "can not pack this TensorMap: all arrays must be on the same "
+                "device, got " + arrays[0].device().str() + " and " + array.device().str()
+            );
+        }
+
+        if (array.scalar_type() != arrays[0].scalar_type()) {
+            C10_THROW_ERROR(ValueError,
+                "can not pack this TensorMap: all arrays must have the same "
+                "dtype, got " + scalar_type_name(arrays[0].scalar_type()) +
+                " and " + scalar_type_name(array.scalar_type())
+            );
+        }
+    }
+
+    auto buffer = torch::Tensor();
+    if (arrays.empty()) {
+        buffer = torch::empty({0}, torch::TensorOptions().dtype(this->scalar_type()).device(this->device()));
+    } else {
+        // using `cat` keeps the buffer connected to the computational graph
+        buffer = torch::cat(arrays);
+    }
+
+    return this->from_packed_buffer(
+        std::move(buffer),
+        gradients,
+        [](const TorchLabels& labels) { return labels; },
+        [](const TorchTensorBlock& gradient) { return gradient; }
+    );
+}
+
+torch::Tensor TensorMapHolder::packed_buffer() const {
+    if (!this->is_packed()) {
+        C10_THROW_ERROR(ValueError,
+            "this TensorMap is not packed, call `pack()` first"
+        );
+    }
+    return packed_;
+}
+
+TorchTensorMap TensorMapHolder::from_packed_buffer(
+    torch::Tensor buffer,
+    bool gradients,
+    const std::function<TorchLabels(const TorchLabels&)>& convert_labels,
+    const std::function<TorchTensorBlock(const TorchTensorBlock&)>& convert_gradient
+) const {
+    int64_t offset = 0;
+    auto next_view = [&](const torch::Tensor& array) {
+        auto numel = array.numel();
+        auto view = buffer.narrow(0, offset, numel).view(array.sizes());
+        offset += numel;
+        return view;
+    };
+
+    auto new_blocks = std::vector<TorchTensorBlock>();
+    for (int64_t block_i=0; block_i<this->keys()->count(); block_i++) {
+        // const_cast is fine here since we will return a new TensorMap
+        auto block = const_cast<metatensor::TensorMap&>(this->tensor_).block_by_id(block_i);
+        auto torch_block = torch::make_intrusive<TensorBlockHolder>(std::move(block), torch::IValue());
+
+        auto components = std::vector<TorchLabels>();
+        for (const auto& component: torch_block->components()) {
+            components.push_back(convert_labels(component));
+        }
+
+        auto new_block = torch::make_intrusive<TensorBlockHolder>(
+            next_view(torch_block->values()),
+            convert_labels(torch_block->samples()),
+            std::move(components),
+            convert_labels(torch_block->properties())
+        );
+
+        for (const auto& parameter: torch_block->gradients_list()) {
+            auto gradient = TensorBlockHolder::gradient(torch_block, parameter);
+            if (!gradients) {
+                new_block->add_gradient(parameter, convert_gradient(gradient));
+                continue;
+            }
+
+            auto gradient_components = std::vector<TorchLabels>();
+            for (const auto& component: gradient->components()) {
+                gradient_components.push_back(convert_labels(component));
+            }
+
+            new_block->add_gradient(parameter, torch::make_intrusive<TensorBlockHolder>(
+                next_view(gradient->values()),
+                convert_labels(gradient->samples()),
+                std::move(gradient_components),
+                convert_labels(gradient->properties())
+            ));
+        }
+
+        new_blocks.emplace_back(std::move(new_block));
+    }
+
+    auto result = torch::make_intrusive<TensorMapHolder>(convert_labels(this->keys()), new_blocks);
+    result->packed_ = std::move(buffer);
+    result->packed_gradients_ = gradients;
+    return result;
 }
 
 
@@ -515,13 +994,23 @@ std::string TensorMapHolder::print(int64_t max_keys) const {
 }
 
 
-TorchTensorMap TensorMapHolder::load(const std::string& path) {
-    return torch::make_intrusive<TensorMapHolder>(
-        TensorMapHolder(metatensor::io::load(path, details::create_torch_array))
+TorchTensorMap TensorMapHolder::load(
+    const std::string& path,
+    torch::optional<torch::Dtype> dtype,
+    torch::optional<torch::Device> device
+) {
+    return TensorMapHolder::from_loaded(
+        metatensor::io::load(path, details::create_array_for(dtype, device)),
+        dtype,
+        device
     );
 }
 
-TorchTensorMap TensorMapHolder::load_buffer(torch::Tensor buffer) {
+TorchTensorMap TensorMapHolder::load_buffer(
+    torch::Tensor buffer,
+    torch::optional<torch::Dtype> dtype,
+    torch::optional<torch::Device> device
+) {
     if (buffer.scalar_type() != torch::kUInt8) {
         C10_THROW_ERROR(ValueError,
             "`buffer` must be a tensor of uint8, not " +
@@ -535,22 +1024,81 @@ TorchTensorMap TensorMapHolder::load_buffer(torch::Tensor buffer) {
         );
     }
 
+    auto tensor = metatensor::io::load_buffer(
+        buffer.data_ptr<uint8_t>(),
+        static_cast<size_t>(buffer.size(0)),
+        details::create_array_for(dtype, device)
+    );
+
+    return TensorMapHolder::from_loaded(std::move(tensor), dtype, device);
+}
+
+TorchTensorMap TensorMapHolder::from_loaded(
+    metatensor::TensorMap tensor,
+    torch::optional<torch::Dtype> dtype,
+    torch::optional<torch::Device> device
+) {
+    if (!device.has_value() || device->is_cpu()) {
+        auto torch_tensor = torch::make_intrusive<TensorMapHolder>(
+            TensorMapHolder(std::move(tensor))
+        );
+
+        if (dtype.has_value() || device.has_value()) {
+            return torch_tensor->to(dtype, device);
+        }
+        return torch_tensor;
+    }
+
+    auto blocks = std::vector<TorchTensorBlock>();
+    for (uintptr_t block_i=0; block_i<tensor.keys().count(); block_i++) {
+        blocks.emplace_back(TensorBlockHolder::from_loaded(
+            tensor.block_by_id(block_i), dtype, device
+        ));
+    }
+
+    auto keys = LabelsHolder::from_metatensor(tensor.keys(), device.value());
+    return torch::make_intrusive<TensorMapHolder>(std::move(keys), std::move(blocks));
+}
+
+TorchTensorMap TensorMapHolder::load_mmap(const std::string& path) {
     return torch::make_intrusive<TensorMapHolder>(
-        TensorMapHolder(metatensor::io::load_buffer(
-            buffer.data_ptr<uint8_t>(),
-            static_cast<size_t>(buffer.size(0)),
-            details::create_torch_array
-        ))
+        TensorMapHolder(metatensor::io::load_mmap(path, details::create_torch_mmap_array))
     );
 }
 
+bool metatensor_torch::details::is_serializable(const metatensor::TensorMap& tensor) {
+    auto& mutable_tensor = const_cast<metatensor::TensorMap&>(tensor);
+    for (uintptr_t block_i=0; block_i<tensor.keys().count(); block_i++) {
+        if (!details::is_serializable(mutable_tensor.block_by_id(block_i))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+metatensor::TensorMap metatensor_torch::details::serializable_copy(const metatensor::TensorMap& tensor) {
+    auto& mutable_tensor = const_cast<metatensor::TensorMap&>(tensor);
+    auto keys = tensor.keys();
+
+    auto blocks = std::vector<metatensor::TensorBlock>();
+    blocks.reserve(keys.count());
+    for (uintptr_t block_i=0; block_i<keys.count(); block_i++) {
+        blocks.push_back(details::serializable_copy(mutable_tensor.block_by_id(block_i)));
+    }
+
+    return metatensor::TensorMap(std::move(keys), std::move(blocks));
+}
 
 void TensorMapHolder::save(const std::string& path) const {
-    return metatensor::io::save(path, this->as_metatensor());
+    details::with_serializable(this->as_metatensor(), [&](const metatensor::TensorMap& tensor) {
+        metatensor::io::save(path, tensor);
+    });
 }
 
 torch::Tensor TensorMapHolder::save_buffer() const {
-    auto buffer = metatensor::io::save_buffer(this->as_metatensor());
+    auto buffer = details::with_serializable(this->as_metatensor(), [](const metatensor::TensorMap& tensor) {
+        return metatensor::io::save_buffer(tensor);
+    });
     // move the buffer to the heap so it can escape this function
     // `torch::from_blob` does not take ownership of the data,
     // so we need to register a custom deleter to clean up when
@@ -48,6 +48,29 @@ TEST_CASE("Arrays") {
         CHECK((array.tensor().sizes() == std::vector<int64_t>{1, 3, 2, 4}));
     }
 
+    SECTION("contiguity") {
+        auto* original_data = tensor.data_ptr();
+        CHECK(array.is_contiguous());
+
+        // reshape and swap_axes keep views of the data
+        array.reshape({1, 2, 3, 4});
+        CHECK(array.is_contiguous());
+        CHECK(array.tensor().data_ptr() == original_data);
+
+        array.swap_axes(1, 2);
+        CHECK_FALSE(array.is_contiguous());
+        CHECK(array.tensor().data_ptr() == original_data);
+
+        // raw access to the data of a non-contiguous array is an error, and
+        // does not modify the array
+        CHECK_THROWS_WITH(array.data(), Catch::Matchers::StartsWith(
+            "can not access the raw data of a non-contiguous torch::Tensor"
+        ));
+        CHECK_FALSE(array.is_contiguous());
+        CHECK(array.tensor().data_ptr() == original_data);
+        CHECK((array.tensor().sizes() == std::vector<int64_t>{1, 3, 2, 4}));
+    }
+
     SECTION("new arrays") {
         auto copy = array.copy();
         auto* copy_ptr = dynamic_cast<TorchDataArray*>(copy.get());
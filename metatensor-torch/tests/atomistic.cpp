@@ -7,6 +7,8 @@ using namespace metatensor_torch;
 #include <catch.hpp>
 using namespace Catch::Matchers;
 
+#include "model.hpp"
+
 TEST_CASE("Models metadata") {
     SECTION("NeighborListOptions") {
         // save to JSON
@@ -377,3 +379,147 @@ Please cite the following references when using this model:
         CHECK(metadata->print() == expected);
     }
 }
+
+TEST_CASE("Model runner") {
+    auto options = ModelRunnerOptions();
+    options.neighbor_skin = -1.0;
+    CHECK_THROWS_WITH(
+        ModelRunner("not-a-model.pt", options),
+        StartsWith("neighbor_skin must be positive or zero, got -1")
+    );
+
+    options = ModelRunnerOptions();
+    options.energy_unit = "unknown";
+    CHECK_THROWS_WITH(
+        ModelRunner("not-a-model.pt", options),
+        StartsWith("unknown unit 'unknown' for energy")
+    );
+
+    // the options are also checked for already loaded models
+    options = ModelRunnerOptions();
+    options.neighbor_skin = -1.0;
+    CHECK_THROWS_WITH(
+        ModelRunner(torch::jit::Module(c10::QualifiedName("empty")), options),
+        StartsWith("neighbor_skin must be positive or zero, got -1")
+    );
+
+    SECTION("metadata") {
+        auto runner = ModelRunner(test_model());
+        CHECK(runner.device() == torch::kCPU);
+        CHECK(runner.dtype() == torch::kFloat64);
+        CHECK(runner.interaction_range() == TEST_MODEL_CUTOFF);
+        CHECK(runner.capabilities()->outputs().contains("energy"));
+
+        REQUIRE(runner.requested_neighbor_lists().size() == 1);
+        CHECK(runner.requested_neighbor_lists()[0]->cutoff() == TEST_MODEL_CUTOFF);
+        CHECK(runner.requested_neighbor_lists()[0]->full_list() == false);
+
+        CHECK(ModelRunner(test_model("float32")).dtype() == torch::kFloat32);
+    }
+
+    SECTION("compute") {
+        auto runner = ModelRunner(test_model());
+
+        auto types = torch::tensor({1, 6, 1, 1}, torch::kInt32);
+        auto positions = torch::tensor({
+            0.0, 0.0, 0.0,
+            1.0, 0.0, 0.0,
+            0.0, 1.5, 0.0,
+            0.5, 0.5, 3.0,
+        }, torch::kFloat64).reshape({4, 3});
+        auto cell = torch::zeros({3, 3}, torch::kFloat64);
+        auto pbc = torch::zeros({3}, torch::kBool);
+
+        auto energy = 0.5 * torch::sum(positions * positions).item<double>();
+
+        auto results = runner.compute(types, positions, cell, pbc, /*forces=*/false);
+        CHECK(results.energy.sizes().size() == 0);
+        CHECK(results.energy.item<double>() == Approx(energy));
+        CHECK_FALSE(results.forces.defined());
+        CHECK_FALSE(results.virial.defined());
+
+        results = runner.compute(types, positions, cell, pbc, /*forces=*/true, /*virial=*/true);
+        CHECK(results.energy.item<double>() == Approx(energy));
+        CHECK((results.forces.sizes() == std::vector<int64_t>{4, 3}));
+        CHECK(torch::allclose(results.forces, -positions));
+        CHECK((results.virial.sizes() == std::vector<int64_t>{3, 3}));
+        CHECK(torch::allclose(results.virial, -torch::matmul(positions.t(), positions)));
+
+        // the results do not depend on the previous steps, even if the
+        // buffers are re-used
+        auto moved = positions + 0.1;
+        results = runner.compute(types, moved, cell, pbc);
+        CHECK(results.energy.item<double>() == Approx(0.5 * torch::sum(moved * moved).item<double>()));
+        CHECK(torch::allclose(results.forces, -moved));
+
+        // the inputs are converted to the dtype of the model
+        results = runner.compute(types, positions.to(torch::kFloat32), cell, pbc);
+        CHECK(results.energy.scalar_type() == torch::kFloat64);
+        CHECK(results.forces.scalar_type() == torch::kFloat64);
+        CHECK(torch::allclose(results.forces, -positions));
+
+        // changing the number of atoms re-allocates the buffers
+        results = runner.compute(types.slice(0, 0, 2), positions.slice(0, 0, 2), cell, pbc);
+        CHECK(results.energy.item<double>() == Approx(0.5));
+        CHECK((results.forces.sizes() == std::vector<int64_t>{2, 3}));
+        CHECK(torch::allclose(results.forces, -positions.slice(0, 0, 2)));
+    }
+
+    SECTION("errors") {
+        auto runner = ModelRunner(test_model());
+
+        auto types = torch::tensor({1, 1, 1}, torch::kInt32);
+        auto positions = torch::rand({3, 3}, torch::kFloat64);
+        auto cell = torch::zeros({3, 3}, torch::kFloat64);
+        auto pbc = torch::zeros({3}, torch::kBool);
+
+        // invalid inputs are rejected when creating the system
+        CHECK_THROWS_WITH(
+            runner.compute(types, torch::rand({2, 3}, torch::kFloat64), cell, pbc),
+            StartsWith("`positions` must be a (len(types) x 3) tensor, got a tensor with shape [2, 3]")
+        );
+        CHECK_THROWS_WITH(
+            runner.compute(types, positions, torch::eye(3, torch::kFloat64), pbc),
+            StartsWith("if `pbc` is False along any direction, the corresponding cell vector must be zero")
+        );
+
+        // errors from the model are propagated to the caller
+        CHECK_THROWS_WITH(
+            runner.compute(torch::tensor({1, -1, 1}, torch::kInt32), positions, cell, pbc),
+            Contains("atomic types must be positive")
+        );
+
+        // the runner can still be used after an error
+        auto results = runner.compute(types, positions, cell, pbc, /*forces=*/false);
+        CHECK(results.energy.item<double>() == Approx(0.5 * torch::sum(positions * positions).item<double>()));
+
+        // models must be able to compute the energy
+        auto model = test_model();
+        model.run_method("capabilities").toCustomClass<ModelCapabilitiesHolder>()->set_outputs({});
+        CHECK_THROWS_WITH(
+            ModelRunner(model),
+            StartsWith("this model can not compute 'energy', which is required by ModelRunner")
+        );
+    }
+}
+
+TEST_CASE("System without value checks") {
+    auto types = torch::zeros({2}, torch::kInt32);
+    auto positions = torch::zeros({2, 3}, torch::kFloat64);
+    auto cell = torch::eye(3, torch::kFloat64);
+    auto pbc = torch::zeros({3}, torch::kBool);
+
+    CHECK_THROWS_WITH(
+        SystemHolder(types, positions, cell, pbc),
+        StartsWith("if `pbc` is False along any direction, the corresponding cell vector must be zero")
+    );
+
+    auto system = SystemHolder(types, positions, cell, pbc, skip_value_checks{});
+    CHECK(system.size() == 2);
+
+    // the shapes are still checked
+    CHECK_THROWS_WITH(
+        SystemHolder(types, torch::zeros({3, 3}, torch::kFloat64), cell, pbc, skip_value_checks{}),
+        StartsWith("`positions` must be a (len(types) x 3) tensor, got a tensor with shape [3, 3]")
+    );
+}
@@ -0,0 +1,101 @@
+#include <memory>
+
+#include <torch/torch.h>
+
+#include <metatensor/torch.hpp>
+#include <metatensor/torch/atomistic.hpp>
+using namespace metatensor_torch;
+
+#include <catch.hpp>
+
+#include "utils.hpp"
+
+/// Get the path to the exported model to use in the benchmarks, from the
+/// `METATENSOR_TORCH_BENCHMARKS_MODEL` environment variable
+static torch::optional<std::string> model_path() {
+    auto* env = std::getenv("METATENSOR_TORCH_BENCHMARKS_MODEL");
+    if (env == nullptr) {
+        return torch::nullopt;
+    }
+    return std::string(env);
+}
+
+/// Get the directory containing the extensions of the model, from the
+/// `METATENSOR_TORCH_BENCHMARKS_EXTENSIONS` environment variable
+static torch::optional<std::string> extensions_directory() {
+    auto* env = std::getenv("METATENSOR_TORCH_BENCHMARKS_EXTENSIONS");
+    if (env == nullptr) {
+        return torch::nullopt;
+    }
+    return std::string(env);
+}
+
+TEST_CASE("Model loading", "[model]") {
+    auto path = model_path();
+    if (!path) {
+        WARN("METATENSOR_TORCH_BENCHMARKS_MODEL is not set, skipping model benchmarks");
+        return;
+    }
+
+    auto extensions = extensions_directory();
+    BENCHMARK("load_atomistic_model") {
+        return load_atomistic_model(path.value(), extensions);
+    };
+
+    BENCHMARK("ModelRunner construction") {
+        auto options = ModelRunnerOptions();
+        options.extensions_directory = extensions;
+        return ModelRunner(path.value(), options);
+    };
+}
+
+TEST_CASE("Model evaluation", "[model]") {
+    auto path = model_path();
+    if (!path) {
+        WARN("METATENSOR_TORCH_BENCHMARKS_MODEL is not set, skipping model benchmarks");
+        return;
+    }
+
+    auto model = load_atomistic_model(path.value(), extensions_directory());
+    for (auto device: benchmark_devices()) {
+        auto options = ModelRunnerOptions();
+        options.device = device;
+
+        for (auto check_consistency: {false, true}) {
+            options.check_consistency = check_consistency;
+
+            auto runner = std::unique_ptr<ModelRunner>();
+            try {
+                runner = std::unique_ptr<ModelRunner>(new ModelRunner(model, options));
+            } catch (const std::exception& e) {
+                WARN("can not run the model on " + device.str() + ": " + e.what());
+                break;
+            }
+
+            auto name = std::string("ModelRunner::compute");
+            if (check_consistency) {
+                name += " with check_consistency";
+            }
+
+            for (auto n_atoms: benchmark_sizes()) {
+                auto system = create_system(n_atoms, device);
+                auto types = system->types();
+                auto positions = system->positions();
+                auto cell = system->cell();
+                auto pbc = system->pbc();
+
+                BENCHMARK(benchmark_name(name + " energy", device, n_atoms)) {
+                    auto results = runner->compute(types, positions, cell, pbc, /*forces=*/false);
+                    synchronize(device);
+                    return results;
+                };
+
+                BENCHMARK(benchmark_name(name + " energy and forces", device, n_atoms)) {
+                    auto results = runner->compute(types, positions, cell, pbc, /*forces=*/true);
+                    synchronize(device);
+                    return results;
+                };
+            }
+        }
+    }
+}
@@ -0,0 +1,73 @@
+#include <torch/torch.h>
+
+#include <metatensor/torch.hpp>
+#include <metatensor/torch/atomistic.hpp>
+using namespace metatensor_torch;
+
+#include <catch.hpp>
+
+#include "utils.hpp"
+
+/// Get the values of per-atom samples ("system", "atom") for a single system
+/// containing `n_atoms` atoms
+static torch::Tensor per_atom_samples(int64_t n_atoms, torch::Device device) {
+    auto options = torch::TensorOptions().dtype(torch::kInt32).device(device);
+    return torch::stack({
+        torch::zeros({n_atoms}, options),
+        torch::arange(n_atoms, options),
+    }, 1);
+}
+
+TEST_CASE("Labels for model outputs", "[outputs][labels]") {
+    auto names = torch::IValue(std::vector<std::string>{"system", "atom"});
+
+    for (auto device: benchmark_devices()) {
+        for (auto n_atoms: benchmark_sizes()) {
+            auto values = per_atom_samples(n_atoms, device);
+
+            BENCHMARK(benchmark_name("LabelsHolder for per-atom samples", device, n_atoms)) {
+                return torch::make_intrusive<LabelsHolder>(names, values);
+            };
+
+            BENCHMARK(benchmark_name("LabelsHolder for per-atom samples with assume_unique", device, n_atoms)) {
+                return torch::make_intrusive<LabelsHolder>(names, values, /*assume_unique=*/true);
+            };
+        }
+    }
+}
+
+TEST_CASE("TensorMap for model outputs", "[outputs][tensor]") {
+    for (auto device: benchmark_devices()) {
+        auto options = torch::TensorOptions().device(device);
+        auto keys = LabelsHolder::single()->to(device);
+        auto properties = torch::make_intrusive<LabelsHolder>(
+            torch::IValue("energy"), torch::zeros({1, 1}, options.dtype(torch::kInt32))
+        );
+
+        auto system_samples = torch::make_intrusive<LabelsHolder>(
+            torch::IValue("system"), torch::zeros({1, 1}, options.dtype(torch::kInt32))
+        );
+        auto energy = torch::zeros({1, 1}, options.dtype(torch::kFloat64));
+
+        BENCHMARK("total energy TensorMap [" + device.str() + "]") {
+            auto block = torch::make_intrusive<TensorBlockHolder>(
+                energy, system_samples, std::vector<TorchLabels>(), properties
+            );
+            return torch::make_intrusive<TensorMapHolder>(keys, std::vector<TorchTensorBlock>{block});
+        };
+
+        for (auto n_atoms: benchmark_sizes()) {
+            auto names = torch::IValue(std::vector<std::string>{"system", "atom"});
+            auto samples = per_atom_samples(n_atoms, device);
+            auto atom_energies = torch::zeros({n_atoms, 1}, options.dtype(torch::kFloat64));
+
+            BENCHMARK(benchmark_name("per-atom energy TensorMap", device, n_atoms)) {
+                auto atom_samples = torch::make_intrusive<LabelsHolder>(names, samples, /*assume_unique=*/true);
+                auto block = torch::make_intrusive<TensorBlockHolder>(
+                    atom_energies, atom_samples, std::vector<TorchLabels>(), properties
+                );
+                return torch::make_intrusive<TensorMapHolder>(keys, std::vector<TorchTensorBlock>{block});
+            };
+        }
+    }
+}
@@ -0,0 +1,118 @@
+#include <torch/torch.h>
+
+#include <metatensor/torch.hpp>
+#include <metatensor/torch/atomistic.hpp>
+using namespace metatensor_torch;
+
+#include <catch.hpp>
+
+#include "utils.hpp"
+
+TEST_CASE("SystemHolder construction", "[system]") {
+    for (auto device: benchmark_devices()) {
+        for (auto n_atoms: benchmark_sizes()) {
+            auto reference = create_system(n_atoms, device);
+            auto types = reference->types();
+            auto positions = reference->positions();
+            auto cell = reference->cell();
+            auto pbc = reference->pbc();
+
+            BENCHMARK(benchmark_name("SystemHolder", device, n_atoms)) {
+                return torch::make_intrusive<SystemHolder>(types, positions, cell, pbc);
+            };
+
+            BENCHMARK(benchmark_name("SystemHolder with skip_value_checks", device, n_atoms)) {
+                return torch::make_intrusive<SystemHolder>(types, positions, cell, pbc, skip_value_checks{});
+            };
+        }
+    }
+}
+
+TEST_CASE("Neighbor lists", "[system][neighbors]") {
+    auto options = neighbors_options();
+
+    for (auto device: benchmark_devices()) {
+        for (auto n_atoms: benchmark_sizes()) {
+            auto system = create_system(n_atoms, device, /*positions_requires_grad=*/true);
+            auto neighbors = detached_neighbors(compute_neighbors(system, options));
+
+            BENCHMARK_ADVANCED(benchmark_name("SystemHolder::add_neighbor_list", device, n_atoms))(Catch::Benchmark::Chronometer meter) {
+                auto systems = std::vector<System>();
+                auto blocks = std::vector<TorchTensorBlock>();
+                for (int i = 0; i < meter.runs(); i++) {
+                    systems.push_back(shallow_copy_system(system));
+                    blocks.push_back(detached_neighbors(neighbors));
+                    register_autograd_neighbors(systems.back(), blocks.back(), false);
+                }
+
+                meter.measure([&](int i) {
+                    systems[i]->add_neighbor_list(options, blocks[i]);
+                });
+            };
+
+            for (auto check_consistency: {false, true}) {
+                auto name = std::string("register_autograd_neighbors + add_neighbor_list");
+                if (check_consistency) {
+                    name += " with check_consistency";
+                }
+
+                BENCHMARK_ADVANCED(benchmark_name(name, device, n_atoms))(Catch::Benchmark::Chronometer meter) {
+                    auto systems = std::vector<System>();
+                    auto blocks = std::vector<TorchTensorBlock>();
+                    for (int i = 0; i < meter.runs(); i++) {
+                        systems.push_back(shallow_copy_system(system));
+                        blocks.push_back(detached_neighbors(neighbors));
+                    }
+
+                    meter.measure([&](int i) {
+                        register_autograd_neighbors(systems[i], blocks[i], check_consistency);
+                        systems[i]->add_neighbor_list(options, blocks[i]);
+                        synchronize(device);
+                    });
+                };
+            }
+        }
+    }
+}
+
+TEST_CASE("NeighborsAutograd", "[system][neighbors][autograd]") {
+    auto options = neighbors_options();
+
+    for (auto device: benchmark_devices()) {
+        for (auto n_atoms: benchmark_sizes()) {
+            auto system = create_system(n_atoms, device, /*positions_requires_grad=*/true);
+            auto neighbors = detached_neighbors(compute_neighbors(system, options));
+            auto distances_grad = torch::ones_like(neighbors->values());
+
+            BENCHMARK_ADVANCED(benchmark_name("NeighborsAutograd::forward", device, n_atoms))(Catch::Benchmark::Chronometer meter) {
+                auto blocks = std::vector<TorchTensorBlock>();
+                for (int i = 0; i < meter.runs(); i++) {
+                    blocks.push_back(detached_neighbors(neighbors));
+                }
+
+                meter.measure([&](int i) {
+                    register_autograd_neighbors(system, blocks[i], false);
+                });
+            };
+
+            BENCHMARK_ADVANCED(benchmark_name("NeighborsAutograd::backward", device, n_atoms))(Catch::Benchmark::Chronometer meter) {
+                auto distances = std::vector<torch::Tensor>();
+                for (int i = 0; i < meter.runs(); i++) {
+                    auto block = detached_neighbors(neighbors);
+                    register_autograd_neighbors(system, block, false);
+                    distances.push_back(block->values());
+                }
+
+                meter.measure([&](int i) {
+                    auto gradients = torch::autograd::grad(
+                        {distances[i]},
+                        {system->positions()},
+                        {distances_grad}
+                    );
+                    synchronize(device);
+                    return gradients;
+                });
+            };
+        }
+    }
+}
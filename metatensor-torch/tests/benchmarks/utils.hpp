@@ -0,0 +1,128 @@
+#ifndef METATENSOR_TORCH_BENCHMARKS_UTILS_HPP
+#define METATENSOR_TORCH_BENCHMARKS_UTILS_HPP
+
+#include <cmath>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include <torch/torch.h>
+#include <torch/cuda.h>
+
+#include <metatensor/torch.hpp>
+#include <metatensor/torch/atomistic.hpp>
+
+/// Distance between neighboring atoms in the systems created by
+/// `create_system`
+constexpr double LATTICE_SPACING = 1.5;
+/// Cutoff for the neighbor lists, such that each atom has exactly 6 neighbors
+/// in the full list (3 in the half list)
+constexpr double NEIGHBORS_CUTOFF = 1.8;
+
+/// Get the number of atoms to use in the benchmarks, as powers of ten from 10
+/// up to the value of the `METATENSOR_TORCH_BENCHMARKS_MAX_ATOMS` environment
+/// variable (defaults to 10^6).
+inline std::vector<int64_t> benchmark_sizes() {
+    int64_t max_size = 1000000;
+    auto* env = std::getenv("METATENSOR_TORCH_BENCHMARKS_MAX_ATOMS");
+    if (env != nullptr) {
+        max_size = static_cast<int64_t>(std::strtoll(env, nullptr, 10));
+    }
+
+    auto sizes = std::vector<int64_t>();
+    for (int64_t size = 10; size <= max_size; size *= 10) {
+        sizes.push_back(size);
+    }
+    return sizes;
+}
+
+/// Get the devices to use in the benchmarks: the CPU, and the first CUDA
+/// device if it is available.
+inline std::vector<torch::Device> benchmark_devices() {
+    auto devices = std::vector<torch::Device>{torch::Device("cpu")};
+    if (torch::cuda::is_available()) {
+        devices.emplace_back("cuda");
+    }
+    return devices;
+}
+
+/// Get the name of a benchmark running on `device` with `n_atoms` atoms
+inline std::string benchmark_name(const std::string& name, torch::Device device, int64_t n_atoms) {
+    return name + " [" + device.str() + "] (" + std::to_string(n_atoms) + ")";
+}
+
+/// Wait for all the calculations on `device` to finish, to make sure the
+/// benchmarks of asynchronous devices measure the full calculation.
+inline void synchronize(torch::Device device) {
+    if (device.is_cuda()) {
+        #if TORCH_VERSION_MAJOR >= 2
+        torch::cuda::synchronize();
+        #else
+        // copying data to the host waits for all previous operations on the
+        // current stream
+        torch::zeros({1}, torch::TensorOptions().device(device)).to(torch::kCPU);
+        #endif
+    }
+}
+
+/// Create a periodic system with `n_atoms` atoms on `device`. The atoms are on
+/// a slightly perturbed simple cubic lattice (with `LATTICE_SPACING`), filling
+/// a cubic cell.
+inline metatensor_torch::System create_system(
+    int64_t n_atoms,
+    torch::Device device,
+    bool positions_requires_grad = false
+) {
+    auto n_cells = static_cast<int64_t>(std::ceil(std::cbrt(static_cast<double>(n_atoms))));
+
+    auto positions = torch::empty({n_atoms, 3}, torch::kFloat64);
+    auto accessor = positions.accessor<double, 2>();
+    for (int64_t i = 0; i < n_atoms; i++) {
+        accessor[i][0] = LATTICE_SPACING * static_cast<double>(i / (n_cells * n_cells));
+        accessor[i][1] = LATTICE_SPACING * static_cast<double>((i / n_cells) % n_cells);
+        accessor[i][2] = LATTICE_SPACING * static_cast<double>(i % n_cells);
+    }
+
+    torch::manual_seed(42);
+    positions += 0.1 * torch::rand({n_atoms, 3}, torch::kFloat64);
+
+    auto options = torch::TensorOptions().device(device);
+    positions = positions.to(device).requires_grad_(positions_requires_grad);
+    auto cell = LATTICE_SPACING * static_cast<double>(n_cells) * torch::eye(3, options.dtype(torch::kFloat64));
+    auto types = torch::ones({n_atoms}, options.dtype(torch::kInt32));
+    auto pbc = torch::ones({3}, options.dtype(torch::kBool));
+
+    return torch::make_intrusive<metatensor_torch::SystemHolder>(types, positions, cell, pbc);
+}
+
+/// Get the options for the half neighbor list used in the benchmarks
+inline metatensor_torch::NeighborListOptions neighbors_options() {
+    return torch::make_intrusive<metatensor_torch::NeighborListOptionsHolder>(
+        NEIGHBORS_CUTOFF, /*full_list=*/false
+    );
+}
+
+/// Create a new system sharing the data of `system`, without any neighbor
+/// list and without re-checking the cell
+inline metatensor_torch::System shallow_copy_system(const metatensor_torch::System& system) {
+    return torch::make_intrusive<metatensor_torch::SystemHolder>(
+        system->types(),
+        system->positions(),
+        system->cell(),
+        system->pbc(),
+        metatensor_torch::skip_value_checks{}
+    );
+}
+
+/// Create a new block sharing the data of `neighbors`, with values detached
+/// from any computational graph
+inline metatensor_torch::TorchTensorBlock detached_neighbors(const metatensor_torch::TorchTensorBlock& neighbors) {
+    return torch::make_intrusive<metatensor_torch::TensorBlockHolder>(
+        neighbors->values().detach(),
+        neighbors->samples(),
+        neighbors->components(),
+        neighbors->properties()
+    );
+}
+
+#endif
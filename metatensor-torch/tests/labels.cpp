@@ -145,7 +145,46 @@ TEST_CASE("Labels") {
         values = values.reshape({-1, 2}).to(torch::kInt32);
         auto labels = LabelsHolder(names, values);
 
-        CHECK(labels.values().data_ptr<int32_t>() == values.data_ptr<int32_t>());
+        // the labels use their own copy of the values, which stays valid
+        // after the input tensor is released
+        values = torch::Tensor();
+        auto labels_values = labels.values();
+        CHECK(labels_values.is_contiguous());
+        CHECK(labels_values[3][1].item<int32_t>() == -2);
+    }
+
+    SECTION("Labels share the values with metatensor-core") {
+        auto values = torch::tensor(std::vector<int32_t>{0, 0, 1, 0, 0, -1, 1, -2});
+        values = values.reshape({-1, 2}).to(torch::kInt32);
+        auto labels = torch::make_intrusive<LabelsHolder>(std::vector<std::string>{"a", "b"}, values);
+
+        const auto& core_labels = labels->as_metatensor();
+        CHECK(core_labels.position({1, -2}) == 3);
+
+        // the values are copied once: the labels and the core labels share
+        // the same private copy, and modifying the input in-place does not
+        // change them
+        CHECK(core_labels.values().data() == labels->values().data_ptr<int32_t>());
+        CHECK(core_labels.values().data() != values.data_ptr<int32_t>());
+        values[3][1] = 5;
+        CHECK(core_labels.position({1, -2}) == 3);
+        CHECK(core_labels.position({1, 5}) == -1);
+        CHECK(labels->values()[3][1].item<int32_t>() == -2);
+
+        // non-contiguous values are made contiguous in the same copy
+        auto transposed = torch::tensor(std::vector<int32_t>{0, 1, 0, 1, 0, 0, -1, -2});
+        transposed = transposed.reshape({2, -1}).to(torch::kInt32).t();
+        REQUIRE_FALSE(transposed.is_contiguous());
+        auto transposed_labels = torch::make_intrusive<LabelsHolder>(std::vector<std::string>{"a", "b"}, transposed);
+        const auto& transposed_core = transposed_labels->as_metatensor();
+        CHECK(transposed_core.values().data() == transposed_labels->values().data_ptr<int32_t>());
+        CHECK(transposed_core.position({1, -2}) == 3);
+
+        // the core labels keep the memory alive
+        auto core_copy = core_labels;
+        labels.reset();
+        values = torch::Tensor();
+        CHECK(core_copy.position({0, -1}) == 2);
     }
 }
 
@@ -0,0 +1,129 @@
+#ifndef METATENSOR_TORCH_TESTS_MODEL_HPP
+#define METATENSOR_TORCH_TESTS_MODEL_HPP
+
+#include <memory>
+#include <string>
+
+#include <torch/script.h>
+#include <torch/csrc/jit/frontend/resolver.h>
+#include <torch/csrc/jit/frontend/sugared_value.h>
+
+#include <metatensor/torch.hpp>
+#include <metatensor/torch/atomistic.hpp>
+
+/// Cutoff of the neighbor list requested by the model from `test_model`
+constexpr double TEST_MODEL_CUTOFF = 2.0;
+
+/// TorchScript resolver giving access to the metatensor classes (`Labels`,
+/// `TensorMap`, `System`, …) by their short name, since the default resolver
+/// used when compiling TorchScript from C++ does not know about them.
+class MetatensorResolver: public torch::jit::Resolver {
+public:
+    std::shared_ptr<torch::jit::SugaredValue> resolveValue(
+        const std::string& name,
+        torch::jit::GraphFunction& function,
+        const torch::jit::SourceRange& location
+    ) override {
+        auto class_type = torch::getCustomClass("__torch__.torch.classes.metatensor." + name);
+        if (class_type != nullptr) {
+            return std::make_shared<torch::jit::ClassValue>(class_type);
+        }
+        return torch::jit::nativeResolver()->resolveValue(name, function, location);
+    }
+
+    c10::TypePtr resolveType(const std::string& name, const torch::jit::SourceRange&) override {
+        return torch::getCustomClass("__torch__.torch.classes.metatensor." + name);
+    }
+};
+
+/// Create a simple atomistic model, computing the energy of each system as
+/// `0.5 * sum(positions ** 2)`. The forces are then `-positions`, and the
+/// virial is `-positions.T @ positions`.
+///
+/// The model requests a single half neighbor list with `TEST_MODEL_CUTOFF`,
+/// and checks that it was given this neighbor list, that only the energy was
+/// requested for all the atoms (i.e. without `selected_atoms`), and that all
+/// atomic types are positive.
+inline torch::jit::Module test_model(std::string dtype = "float64") {
+    auto model = torch::jit::Module(c10::QualifiedName("__torch__.TestModel"));
+    model.register_attribute("training", c10::BoolType::get(), false);
+
+    auto outputs = torch::Dict<std::string, metatensor_torch::ModelOutput>();
+    outputs.insert("energy", torch::make_intrusive<metatensor_torch::ModelOutputHolder>(
+        /*quantity=*/ "energy",
+        /*unit=*/ "eV",
+        /*per_atom=*/ false,
+        /*explicit_gradients=*/ std::vector<std::string>()
+    ));
+    auto capabilities = torch::make_intrusive<metatensor_torch::ModelCapabilitiesHolder>(
+        /*outputs=*/ outputs,
+        /*atomic_types=*/ std::vector<int64_t>{1, 6},
+        /*interaction_range=*/ TEST_MODEL_CUTOFF,
+        /*length_unit=*/ "angstrom",
+        /*supported_devices=*/ std::vector<std::string>{"cpu"},
+        /*dtype=*/ std::move(dtype)
+    );
+    model.register_attribute(
+        "capabilities_",
+        torch::getCustomClassType<metatensor_torch::ModelCapabilities>(),
+        capabilities
+    );
+
+    auto neighbors = torch::make_intrusive<metatensor_torch::NeighborListOptionsHolder>(
+        TEST_MODEL_CUTOFF, /*full_list=*/ false
+    );
+    neighbors->set_length_unit("angstrom");
+    model.register_attribute(
+        "neighbors_",
+        torch::getCustomClassType<metatensor_torch::NeighborListOptions>(),
+        neighbors
+    );
+
+    model.define(R"(
+def capabilities(self) -> ModelCapabilities:
+    return self.capabilities_
+
+def requested_neighbor_lists(self) -> List[NeighborListOptions]:
+    return [self.neighbors_]
+
+def forward(
+    self,
+    systems: List[System],
+    options: ModelEvaluationOptions,
+    check_consistency: bool,
+) -> Dict[str, TensorMap]:
+    if options.selected_atoms is not None:
+        raise Exception("expected the calculation to run on all atoms")
+
+    if len(options.outputs) != 1 or "energy" not in options.outputs:
+        raise Exception("expected only the energy to be requested")
+
+    energies: List[Tensor] = []
+    for system in systems:
+        if bool(torch.any(system.types <= 0)):
+            raise Exception("atomic types must be positive")
+
+        if not system.has_neighbor_list(self.neighbors_):
+            raise Exception("missing neighbor list")
+
+        energies.append(0.5 * torch.sum(system.positions ** 2))
+
+    types = systems[0].types
+    device = types.device
+    zero = torch.zeros((1, 1), dtype=types.dtype, device=device)
+
+    samples = Labels("system", torch.arange(len(systems), device=device).reshape(-1, 1))
+    components: List[Labels] = []
+    block = TensorBlock(
+        torch.stack(energies).reshape(-1, 1),
+        samples,
+        components,
+        Labels("energy", zero),
+    )
+    return {"energy": TensorMap(Labels("_", zero), [block])}
+)", std::make_shared<MetatensorResolver>());
+
+    return model;
+}
+
+#endif
@@ -35,6 +35,19 @@ TEST_CASE("TensorMap") {
         CHECK(matching.size() == 2);
         CHECK(matching[0] == 0);
         CHECK(matching[1] == 1);
+
+        // cached block lookup
+        block = TensorMapHolder::block(tensor, std::map<std::string, int32_t>{{"key_1", 2}, {"key_2", 3}});
+        CHECK(block->values()[0][0][0].item<double>() == 4);
+
+        auto blocks = TensorMapHolder::blocks(tensor, std::map<std::string, int32_t>{{"key_2", 0}});
+        CHECK(blocks.size() == 2);
+
+        selection = LabelsHolder::create({"key_2", "key_1"}, {{3, 2}, {0, 0}});
+        blocks = TensorMapHolder::blocks_for(tensor, selection);
+        CHECK(blocks.size() == 2);
+        CHECK(blocks[0]->values()[0][0][0].item<double>() == 4);
+        CHECK(blocks[1]->values()[0][0][0].item<double>() == 1);
     }
 
     SECTION("keys_to_samples") {
@@ -0,0 +1,175 @@
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <functional>
+
+#include <torch/torch.h>
+
+#include <metatensor.hpp>
+#include <metatensor/torch.hpp>
+#include <metatensor/torch/atomistic.hpp>
+using namespace metatensor_torch;
+
+#include <catch.hpp>
+
+#include "model.hpp"
+
+static constexpr size_t N_THREADS = 8;
+static constexpr size_t N_ITERATIONS = 200;
+
+/// Run `function(thread_id)` from `N_THREADS` threads at the same time, and
+/// return the number of calls that returned `false`. Catch assertions are not
+/// thread-safe, so they should only be used after this function returns.
+static size_t count_failures(const std::function<bool(size_t)>& function) {
+    auto failures = std::atomic<size_t>(0);
+    auto start = std::atomic<bool>(false);
+
+    auto threads = std::vector<std::thread>();
+    for (size_t thread_id=0; thread_id<N_THREADS; thread_id++) {
+        threads.emplace_back([&, thread_id]() {
+            while (!start.load()) {
+                std::this_thread::yield();
+            }
+
+            for (size_t i=0; i<N_ITERATIONS; i++) {
+                try {
+                    if (!function(thread_id)) {
+                        failures += 1;
+                    }
+                } catch (...) {
+                    failures += 1;
+                }
+            }
+        });
+    }
+
+    start.store(true);
+    for (auto& thread: threads) {
+        thread.join();
+    }
+
+    return failures.load();
+}
+
+TEST_CASE("Concurrent use of shared data") {
+    SECTION("lazy labels") {
+        for (size_t repeat=0; repeat<10; repeat++) {
+            auto labels = LabelsHolder::range_product(
+                torch::IValue(std::vector<std::string>{"a", "b"}), {5, 7}
+            );
+            auto expected = std::atomic<const metatensor::Labels*>(nullptr);
+
+            auto failures = count_failures([&](size_t) {
+                const auto& metatensor_labels = labels->as_metatensor();
+                const metatensor::Labels* previous = nullptr;
+                if (!expected.compare_exchange_strong(previous, &metatensor_labels)) {
+                    // all threads should see the same metatensor::Labels
+                    if (previous != &metatensor_labels) {
+                        return false;
+                    }
+                }
+                return metatensor_labels.count() == 35;
+            });
+            CHECK(failures == 0);
+        }
+    }
+
+    SECTION("block lookups") {
+        auto keys = std::vector<std::vector<int32_t>>();
+        auto blocks = std::vector<TorchTensorBlock>();
+        for (int32_t i=0; i<16; i++) {
+            keys.push_back({i, i % 2});
+            blocks.emplace_back(torch::make_intrusive<TensorBlockHolder>(
+                torch::full({1, 1}, static_cast<double>(i)),
+                LabelsHolder::create({"s"}, {{0}}),
+                std::vector<TorchLabels>{},
+                LabelsHolder::create({"p"}, {{0}})
+            ));
+        }
+        auto tensor = torch::make_intrusive<TensorMapHolder>(
+            LabelsHolder::create({"key", "parity"}, keys), blocks
+        );
+
+        auto failures = count_failures([&](size_t thread_id) {
+            auto key = static_cast<int32_t>(thread_id % 16);
+            auto block = TensorMapHolder::block(tensor, std::map<std::string, int32_t>{{"key", key}});
+            if (block->values().item<double>() != key) {
+                return false;
+            }
+
+            auto parity = TensorMapHolder::blocks(tensor, std::map<std::string, int32_t>{{"parity", key % 2}});
+            return parity.size() == 8;
+        });
+        CHECK(failures == 0);
+    }
+
+    SECTION("derived neighbor lists") {
+        int64_t n_atoms = 20;
+        auto system = torch::make_intrusive<SystemHolder>(
+            torch::ones({n_atoms}, torch::kInt32),
+            6.0 * torch::rand({n_atoms, 3}, torch::kFloat64),
+            6.0 * torch::eye(3, torch::kFloat64),
+            torch::ones({3}, torch::kBool)
+        );
+        auto source = torch::make_intrusive<NeighborListOptionsHolder>(3.0, false);
+        system->add_neighbor_list(source, compute_neighbors(system, source));
+
+        auto expected = std::atomic<const TensorBlockHolder*>(nullptr);
+        auto failures = count_failures([&](size_t) {
+            auto options = torch::make_intrusive<NeighborListOptionsHolder>(2.0, true);
+            auto neighbors = system->get_neighbor_list(options);
+
+            const TensorBlockHolder* previous = nullptr;
+            if (!expected.compare_exchange_strong(previous, neighbors.get())) {
+                // all threads should get the same derived neighbor list
+                return previous == neighbors.get();
+            }
+            return true;
+        });
+        CHECK(failures == 0);
+    }
+
+    SECTION("shared model") {
+        // one runner per thread, all sharing the same copy of the model
+        auto model = test_model();
+        auto runners = std::vector<ModelRunner>();
+        auto inputs = std::vector<torch::Tensor>();
+        for (size_t thread_id=0; thread_id<N_THREADS; thread_id++) {
+            runners.emplace_back(model);
+            // each thread uses a different system, to check that the results
+            // do not get mixed between threads
+            auto n_atoms = static_cast<int64_t>(thread_id + 2);
+            inputs.push_back(2.0 * torch::rand({n_atoms, 3}, torch::kFloat64));
+        }
+
+        auto cell = torch::zeros({3, 3}, torch::kFloat64);
+        auto pbc = torch::zeros({3}, torch::kBool);
+
+        auto failures = count_failures([&](size_t thread_id) {
+            const auto& positions = inputs[thread_id];
+            auto types = torch::ones({positions.size(0)}, torch::kInt32);
+
+            auto results = runners[thread_id].compute(types, positions, cell, pbc);
+
+            auto energy = 0.5 * torch::sum(positions * positions);
+            return torch::allclose(results.energy, energy) && torch::allclose(results.forces, -positions);
+        });
+        CHECK(failures == 0);
+    }
+
+    SECTION("error messages") {
+        // the last error is stored per-thread, so each thread should see the
+        // message corresponding to its own error
+        auto failures = count_failures([&](size_t thread_id) {
+            auto value = static_cast<int32_t>(thread_id);
+            try {
+                metatensor::Labels({"a"}, {{value}, {value}});
+            } catch (const metatensor::Error& e) {
+                auto expected = "[" + std::to_string(value) + "] is already present";
+                return std::string(e.what()).find(expected) != std::string::npos;
+            }
+            return false;
+        });
+        CHECK(failures == 0);
+    }
+}
@@ -26,6 +26,17 @@ MTS_IO_ERROR = 2
 MTS_SERIALIZATION_ERROR = 3
 MTS_BUFFER_SIZE_ERROR = 254
 MTS_INTERNAL_ERROR = 255
+MTS_DTYPE_UNKNOWN = 0
+MTS_DTYPE_FLOAT64 = 1
+MTS_DTYPE_FLOAT32 = 2
+MTS_DTYPE_FLOAT16 = 3
+MTS_DTYPE_INT32 = 4
+MTS_DTYPE_INT64 = 5
+MTS_COMPRESSION_NONE = 0
+MTS_COMPRESSION_DEFLATE = 1
+MTS_STORAGE_FLOAT64 = 0
+MTS_STORAGE_FLOAT32 = 1
+MTS_STORAGE_FLOAT16 = 2
 
 
 mts_status_t = ctypes.c_int32
@@ -41,6 +52,18 @@ class mts_tensormap_t(ctypes.Structure):
     pass
 
 
+class mts_mmap_t(ctypes.Structure):
+    pass
+
+
+class mts_tensormap_reader_t(ctypes.Structure):
+    pass
+
+
+class mts_tensormap_writer_t(ctypes.Structure):
+    pass
+
+
 class mts_labels_t(ctypes.Structure):
     pass
 
@@ -76,10 +99,41 @@ mts_array_t._fields_ = [
     ("copy", CFUNCTYPE(mts_status_t, ctypes.c_void_p, POINTER(mts_array_t))),
     ("destroy", CFUNCTYPE(None, ctypes.c_void_p)),
     ("move_samples_from", CFUNCTYPE(mts_status_t, ctypes.c_void_p, ctypes.c_void_p, POINTER(mts_sample_mapping_t), c_uintptr_t, c_uintptr_t, c_uintptr_t)),
+    ("dtype", CFUNCTYPE(mts_status_t, ctypes.c_void_p, POINTER(ctypes.c_int32))),
+    ("typed_data", CFUNCTYPE(mts_status_t, ctypes.c_void_p, ctypes.c_int32, POINTER(ctypes.c_void_p))),
+]
+
+
+class mts_save_options_t(ctypes.Structure):
+    pass
+
+mts_save_options_t._fields_ = [
+    ("compression", ctypes.c_int32),
+    ("storage_type", ctypes.c_int32),
+]
+
+
+class mts_load_options_t(ctypes.Structure):
+    pass
+
+mts_load_options_t._fields_ = [
+    ("threads", c_uintptr_t),
+]
+
+
+class mts_profiling_entry_t(ctypes.Structure):
+    pass
+
+mts_profiling_entry_t._fields_ = [
+    ("name", ctypes.c_char_p),
+    ("calls", ctypes.c_uint64),
+    ("time_ns", ctypes.c_uint64),
+    ("bytes", ctypes.c_uint64),
 ]
 
 
 mts_create_array_callback_t = CFUNCTYPE(mts_status_t, POINTER(c_uintptr_t), c_uintptr_t, POINTER(mts_array_t))
+mts_create_mmap_array_callback_t = CFUNCTYPE(mts_status_t, POINTER(c_uintptr_t), c_uintptr_t, POINTER(ctypes.c_double), POINTER(mts_mmap_t), POINTER(mts_array_t))
 
 
 def setup_functions(lib):
@@ -93,6 +147,25 @@ def setup_functions(lib):
     ]
     lib.mts_version.restype = ctypes.c_char_p
 
+    lib.mts_set_num_threads.argtypes = [
+        c_uintptr_t,
+    ]
+    lib.mts_set_num_threads.restype = None
+
+    lib.mts_get_num_threads.argtypes = [
+    ]
+    lib.mts_get_num_threads.restype = c_uintptr_t
+
+    lib.mts_profiling_get.argtypes = [
+        POINTER(mts_profiling_entry_t),
+        POINTER(c_uintptr_t),
+    ]
+    lib.mts_profiling_get.restype = _check_status
+
+    lib.mts_profiling_reset.argtypes = [
+    ]
+    lib.mts_profiling_reset.restype = None
+
     lib.mts_last_error.argtypes = [
     ]
     lib.mts_last_error.restype = ctypes.c_char_p
@@ -105,11 +178,42 @@ def setup_functions(lib):
     ]
     lib.mts_labels_position.restype = _check_status
 
+    lib.mts_labels_positions.argtypes = [
+        mts_labels_t,
+        POINTER(ctypes.c_int32),
+        c_uintptr_t,
+        c_uintptr_t,
+        POINTER(ctypes.c_int64),
+    ]
+    lib.mts_labels_positions.restype = _check_status
+
+    lib.mts_labels_range_of.argtypes = [
+        mts_labels_t,
+        POINTER(ctypes.c_int32),
+        c_uintptr_t,
+        POINTER(c_uintptr_t),
+        POINTER(c_uintptr_t),
+    ]
+    lib.mts_labels_range_of.restype = _check_status
+
     lib.mts_labels_create.argtypes = [
         POINTER(mts_labels_t),
     ]
     lib.mts_labels_create.restype = _check_status
 
+    lib.mts_labels_create_assume_unique.argtypes = [
+        POINTER(mts_labels_t),
+    ]
+    lib.mts_labels_create_assume_unique.restype = _check_status
+
+    lib.mts_labels_create_borrowed.argtypes = [
+        POINTER(mts_labels_t),
+        ctypes.c_bool,
+        ctypes.c_void_p,
+        CFUNCTYPE(None, ctypes.c_void_p),
+    ]
+    lib.mts_labels_create_borrowed.restype = _check_status
+
     lib.mts_labels_set_user_data.argtypes = [
         mts_labels_t,
         ctypes.c_void_p,
@@ -289,6 +393,22 @@ def setup_functions(lib):
     ]
     lib.mts_tensormap_keys_to_samples.restype = POINTER(mts_tensormap_t)
 
+    lib.mts_tensormap_split_samples.argtypes = [
+        POINTER(mts_tensormap_t),
+        ctypes.c_char_p,
+        POINTER(c_uintptr_t),
+        c_uintptr_t,
+        POINTER(POINTER(mts_tensormap_t)),
+        c_uintptr_t,
+    ]
+    lib.mts_tensormap_split_samples.restype = _check_status
+
+    lib.mts_tensormap_merge_samples.argtypes = [
+        POINTER(POINTER(mts_tensormap_t)),
+        c_uintptr_t,
+    ]
+    lib.mts_tensormap_merge_samples.restype = POINTER(mts_tensormap_t)
+
     lib.mts_labels_load.argtypes = [
         ctypes.c_char_p,
         POINTER(mts_labels_t),
@@ -317,6 +437,20 @@ def setup_functions(lib):
     ]
     lib.mts_labels_save_buffer.restype = _check_status
 
+    lib.mts_labels_serialized_size.argtypes = [
+        mts_labels_t,
+        POINTER(c_uintptr_t),
+    ]
+    lib.mts_labels_serialized_size.restype = _check_status
+
+    lib.mts_labels_save_into_buffer.argtypes = [
+        ctypes.c_char_p,
+        c_uintptr_t,
+        POINTER(c_uintptr_t),
+        mts_labels_t,
+    ]
+    lib.mts_labels_save_into_buffer.restype = _check_status
+
     lib.mts_block_load.argtypes = [
         ctypes.c_char_p,
         mts_create_array_callback_t,
@@ -330,12 +464,25 @@ def setup_functions(lib):
     ]
     lib.mts_block_load_buffer.restype = POINTER(mts_block_t)
 
+    lib.mts_block_load_mmap.argtypes = [
+        ctypes.c_char_p,
+        mts_create_mmap_array_callback_t,
+    ]
+    lib.mts_block_load_mmap.restype = POINTER(mts_block_t)
+
     lib.mts_block_save.argtypes = [
         ctypes.c_char_p,
         POINTER(mts_block_t),
     ]
     lib.mts_block_save.restype = _check_status
 
+    lib.mts_block_save_with_options.argtypes = [
+        ctypes.c_char_p,
+        POINTER(mts_block_t),
+        mts_save_options_t,
+    ]
+    lib.mts_block_save_with_options.restype = _check_status
+
     lib.mts_block_save_buffer.argtypes = [
         POINTER(ctypes.c_char_p),
         POINTER(c_uintptr_t),
@@ -345,12 +492,45 @@ def setup_functions(lib):
     ]
     lib.mts_block_save_buffer.restype = _check_status
 
+    lib.mts_block_save_buffer_with_options.argtypes = [
+        POINTER(ctypes.c_char_p),
+        POINTER(c_uintptr_t),
+        ctypes.c_void_p,
+        mts_realloc_buffer_t,
+        POINTER(mts_block_t),
+        mts_save_options_t,
+    ]
+    lib.mts_block_save_buffer_with_options.restype = _check_status
+
+    lib.mts_block_serialized_size.argtypes = [
+        POINTER(mts_block_t),
+        mts_save_options_t,
+        POINTER(c_uintptr_t),
+    ]
+    lib.mts_block_serialized_size.restype = _check_status
+
+    lib.mts_block_save_into_buffer.argtypes = [
+        ctypes.c_char_p,
+        c_uintptr_t,
+        POINTER(c_uintptr_t),
+        POINTER(mts_block_t),
+        mts_save_options_t,
+    ]
+    lib.mts_block_save_into_buffer.restype = _check_status
+
     lib.mts_tensormap_load.argtypes = [
         ctypes.c_char_p,
         mts_create_array_callback_t,
     ]
     lib.mts_tensormap_load.restype = POINTER(mts_tensormap_t)
 
+    lib.mts_tensormap_load_with_options.argtypes = [
+        ctypes.c_char_p,
+        mts_create_array_callback_t,
+        mts_load_options_t,
+    ]
+    lib.mts_tensormap_load_with_options.restype = POINTER(mts_tensormap_t)
+
     lib.mts_tensormap_load_buffer.argtypes = [
         ctypes.c_char_p,
         c_uintptr_t,
@@ -358,12 +538,33 @@ def setup_functions(lib):
     ]
     lib.mts_tensormap_load_buffer.restype = POINTER(mts_tensormap_t)
 
+    lib.mts_tensormap_load_buffer_with_options.argtypes = [
+        ctypes.c_char_p,
+        c_uintptr_t,
+        mts_create_array_callback_t,
+        mts_load_options_t,
+    ]
+    lib.mts_tensormap_load_buffer_with_options.restype = POINTER(mts_tensormap_t)
+
+    lib.mts_tensormap_load_mmap.argtypes = [
+        ctypes.c_char_p,
+        mts_create_mmap_array_callback_t,
+    ]
+    lib.mts_tensormap_load_mmap.restype = POINTER(mts_tensormap_t)
+
     lib.mts_tensormap_save.argtypes = [
         ctypes.c_char_p,
         POINTER(mts_tensormap_t),
     ]
     lib.mts_tensormap_save.restype = _check_status
 
+    lib.mts_tensormap_save_with_options.argtypes = [
+        ctypes.c_char_p,
+        POINTER(mts_tensormap_t),
+        mts_save_options_t,
+    ]
+    lib.mts_tensormap_save_with_options.restype = _check_status
+
     lib.mts_tensormap_save_buffer.argtypes = [
         POINTER(ctypes.c_char_p),
         POINTER(c_uintptr_t),
@@ -372,3 +573,91 @@ def setup_functions(lib):
         POINTER(mts_tensormap_t),
     ]
     lib.mts_tensormap_save_buffer.restype = _check_status
+
+    lib.mts_tensormap_save_buffer_with_options.argtypes = [
+        POINTER(ctypes.c_char_p),
+        POINTER(c_uintptr_t),
+        ctypes.c_void_p,
+        mts_realloc_buffer_t,
+        POINTER(mts_tensormap_t),
+        mts_save_options_t,
+    ]
+    lib.mts_tensormap_save_buffer_with_options.restype = _check_status
+
+    lib.mts_tensormap_serialized_size.argtypes = [
+        POINTER(mts_tensormap_t),
+        mts_save_options_t,
+        POINTER(c_uintptr_t),
+    ]
+    lib.mts_tensormap_serialized_size.restype = _check_status
+
+    lib.mts_tensormap_save_into_buffer.argtypes = [
+        ctypes.c_char_p,
+        c_uintptr_t,
+        POINTER(c_uintptr_t),
+        POINTER(mts_tensormap_t),
+        mts_save_options_t,
+    ]
+    lib.mts_tensormap_save_into_buffer.restype = _check_status
+
+    lib.mts_mmap_free.argtypes = [
+        POINTER(mts_mmap_t),
+    ]
+    lib.mts_mmap_free.restype = _check_status
+
+    lib.mts_tensormap_reader_open.argtypes = [
+        ctypes.c_char_p,
+    ]
+    lib.mts_tensormap_reader_open.restype = POINTER(mts_tensormap_reader_t)
+
+    lib.mts_tensormap_reader_free.argtypes = [
+        POINTER(mts_tensormap_reader_t),
+    ]
+    lib.mts_tensormap_reader_free.restype = _check_status
+
+    lib.mts_tensormap_reader_keys.argtypes = [
+        POINTER(mts_tensormap_reader_t),
+        POINTER(mts_labels_t),
+    ]
+    lib.mts_tensormap_reader_keys.restype = _check_status
+
+    lib.mts_tensormap_reader_blocks_matching.argtypes = [
+        POINTER(mts_tensormap_reader_t),
+        POINTER(c_uintptr_t),
+        POINTER(c_uintptr_t),
+        mts_labels_t,
+    ]
+    lib.mts_tensormap_reader_blocks_matching.restype = _check_status
+
+    lib.mts_tensormap_reader_block.argtypes = [
+        POINTER(mts_tensormap_reader_t),
+        c_uintptr_t,
+        mts_create_array_callback_t,
+    ]
+    lib.mts_tensormap_reader_block.restype = POINTER(mts_block_t)
+
+    lib.mts_tensormap_writer_open.argtypes = [
+        ctypes.c_char_p,
+        POINTER(ctypes.c_char_p),
+        c_uintptr_t,
+        mts_save_options_t,
+    ]
+    lib.mts_tensormap_writer_open.restype = POINTER(mts_tensormap_writer_t)
+
+    lib.mts_tensormap_writer_free.argtypes = [
+        POINTER(mts_tensormap_writer_t),
+    ]
+    lib.mts_tensormap_writer_free.restype = _check_status
+
+    lib.mts_tensormap_writer_append.argtypes = [
+        POINTER(mts_tensormap_writer_t),
+        POINTER(ctypes.c_int32),
+        c_uintptr_t,
+        POINTER(mts_block_t),
+    ]
+    lib.mts_tensormap_writer_append.restype = _check_status
+
+    lib.mts_tensormap_writer_finish.argtypes = [
+        POINTER(mts_tensormap_writer_t),
+    ]
+    lib.mts_tensormap_writer_finish.restype = _check_status
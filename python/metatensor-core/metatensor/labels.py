@@ -787,6 +787,53 @@ class Labels:
         else:
             return None
 
+    def positions(self, entries: np.ndarray) -> np.ndarray:
+        """
+        Get the positions of multiple ``entries`` in this set of
+        :py:class:`Labels` at once.
+
+        This is equivalent to calling :py:meth:`Labels.position` for each row of
+        ``entries``, but only crosses the boundary with the native library once.
+
+        >>> import numpy as np
+        >>> from metatensor import Labels
+        >>> labels = Labels(names=["a", "b"], values=np.array([[0, 1], [1, 2], [0, 3]]))
+        >>> print(labels.positions(np.array([[0, 3], [4, 4], [0, 1]])))
+        [ 2 -1  0]
+
+        :param entries: 2-dimensional array of integers, with one entry per row and
+            the same number of columns as the size of these :py:class:`Labels`
+        :return: 1-dimensional ndarray containing the position of each entry, or
+            ``-1`` for entries which are not part of these labels
+        """
+
+        if self.is_view():
+            raise ValueError(
+                "can not call `positions` on a Labels view, call `to_owned` before"
+            )
+
+        entries = np.asarray(entries)
+        if len(entries.shape) != 2:
+            raise ValueError("`entries` must be a 2D array")
+
+        try:
+            entries = np.ascontiguousarray(
+                entries.astype(np.int32, order="C", casting="same_kind", copy=False)
+            )
+        except TypeError as e:
+            raise TypeError("`entries` must be convertible to integers") from e
+
+        result = np.empty(entries.shape[0], dtype=np.int64)
+        self._lib.mts_labels_positions(
+            self._labels,
+            entries.ctypes.data_as(ctypes.POINTER(ctypes.c_int32)),
+            entries.shape[0],
+            entries.shape[1],
+            result.ctypes.data_as(ctypes.POINTER(ctypes.c_int64)),
+        )
+
+        return result
+
     def union(self, other: "Labels") -> "Labels":
         """
         Take the union of these :py:class:`Labels` with ``other``.
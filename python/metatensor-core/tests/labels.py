@@ -75,6 +75,19 @@ def test_position():
     assert (2, 3) in labels
     assert (2, -1) not in labels
 
+    positions = labels.positions(np.array([[2, 3], [2, -1], [0, 0]]))
+    np.testing.assert_equal(positions, [3, -1, 0])
+
+    positions = labels.positions(labels.values)
+    np.testing.assert_equal(positions, [0, 1, 2, 3])
+
+    positions = labels.positions(np.zeros((0, 2), dtype=np.int32))
+    assert positions.shape == (0,)
+
+    message = "expected entries of size 2 in mts_labels_positions, got size 3"
+    with pytest.raises(MetatensorError, match=message):
+        labels.positions(np.array([[0, 0, 0]]))
+
 
 def test_not_writeable():
     labels = Labels(
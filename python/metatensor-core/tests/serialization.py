@@ -37,7 +37,9 @@ def tensor_zero_len_block():
 @pytest.mark.parametrize("use_numpy", (True, False))
 @pytest.mark.parametrize("memory_buffer", (True, False))
 @pytest.mark.parametrize("standalone_fn", (True, False))
-def test_load(use_numpy, memory_buffer, standalone_fn):
+# data-unaligned.npz was saved before the values were aligned inside the file
+@pytest.mark.parametrize("filename", ("data.npz", "data-unaligned.npz"))
+def test_load(use_numpy, memory_buffer, standalone_fn, filename):
     path = os.path.join(
         os.path.dirname(__file__),
         "..",
@@ -45,7 +47,7 @@ def test_load(use_numpy, memory_buffer, standalone_fn):
         "..",
         "metatensor-core",
         "tests",
-        "data.npz",
+        filename,
     )
 
     if memory_buffer:
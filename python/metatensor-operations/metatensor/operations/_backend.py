@@ -8,7 +8,7 @@
 # See metatensor-torch/metatensor/torch/operations.py for more information.
 #
 # Any change to this file MUST be also be made to `metatensor/torch/operations.py`.
-from typing import Union
+from typing import List, Union
 
 import numpy as np
 
@@ -52,3 +52,38 @@ def torch_jit_annotate(type, value):
 
 
 check_isinstance = isinstance
+
+
+# metatensor-torch contains native implementations of some operations. When this is
+# `True`, the functions below are used instead of the Python implementation.
+HAS_NATIVE_OPERATIONS = False
+
+
+def native_reduce_over_samples(
+    tensor: TensorMap, sample_names: List[str], reduction: str
+) -> TensorMap:
+    raise NotImplementedError("native operations require metatensor-torch")
+
+
+def native_reduce_over_samples_block(
+    block: TensorBlock, sample_names: List[str], reduction: str
+) -> TensorBlock:
+    raise NotImplementedError("native operations require metatensor-torch")
+
+
+def native_slice(tensor: TensorMap, axis: str, labels: Labels) -> TensorMap:
+    raise NotImplementedError("native operations require metatensor-torch")
+
+
+def native_slice_block(block: TensorBlock, axis: str, labels: Labels) -> TensorBlock:
+    raise NotImplementedError("native operations require metatensor-torch")
+
+
+def native_join(
+    tensors: List[TensorMap],
+    axis: str,
+    different_keys: str,
+    sort_samples: bool,
+    remove_tensor_name: bool,
+) -> TensorMap:
+    raise NotImplementedError("native operations require metatensor-torch")
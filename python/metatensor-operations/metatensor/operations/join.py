@@ -2,10 +2,12 @@ from typing import List, Union
 
 from . import _dispatch
 from ._backend import (
+    HAS_NATIVE_OPERATIONS,
     Labels,
     TensorBlock,
     TensorMap,
     check_isinstance,
+    native_join,
     torch_jit_is_scripting,
     torch_jit_script,
 )
@@ -359,6 +361,11 @@ def join(
                     f"not {type(tensor)}"
                 )
 
+    if HAS_NATIVE_OPERATIONS:
+        return native_join(
+            list(tensors), axis, different_keys, sort_samples, remove_tensor_name
+        )
+
     if len(tensors) < 1:
         raise ValueError("provide at least one `TensorMap` for joining")
 
@@ -46,14 +46,28 @@ import numpy as np
 
 from . import _dispatch
 from ._backend import (
+    HAS_NATIVE_OPERATIONS,
     Labels,
     TensorBlock,
     TensorMap,
+    native_reduce_over_samples,
+    native_reduce_over_samples_block,
     torch_jit_is_scripting,
     torch_jit_script,
 )
 
 
+def _gather_for_gradients(array, index, gradient_shape: List[int]):
+    """
+    Get ``array[index]``, adding new dimensions after the first one to make the result
+    broadcast against gradients with the given ``gradient_shape``.
+    """
+    gathered = array[index]
+    n_extra = len(gradient_shape) - len(array.shape)
+    shape = [gathered.shape[0]] + [1] * n_extra + list(array.shape[1:])
+    return gathered.reshape(shape)
+
+
 def _reduce_over_samples_block(
     block: TensorBlock,
     sample_names: Union[List[str], str],
@@ -82,6 +96,9 @@ def _reduce_over_samples_block(
     else:
         sample_names_list = sample_names
 
+    if HAS_NATIVE_OPERATIONS:
+        return native_reduce_over_samples_block(block, sample_names_list, reduction)
+
     block_samples = block.samples
 
     if remaining_samples is None:
@@ -239,6 +256,7 @@ def _reduce_over_samples_block(
         gradient_samples = gradient.samples
         # here we need to copy because we want to modify the samples array
         samples = _dispatch.copy(gradient_samples.values)
+        original_samples = _dispatch.copy(samples[:, 0])
 
         # change the first columns of the samples array with the mapping
         # between samples and gradient.samples
@@ -263,13 +281,11 @@ def _reduce_over_samples_block(
                 (-1,) + (1,) * len(other_shape)
             )
             if reduction == "std" or reduction == "var":
-                values_times_gradient_values = _dispatch.zeros_like(gradient_values)
-
-                for i in range(gradient.samples.values.shape[0]):
-                    s = gradient.samples.entry(i)
-                    values_times_gradient_values[i] = (
-                        gradient_values[i] * block_values[int(s[0])]
-                    )
+                values_times_gradient_values = gradient_values * _gather_for_gradients(
+                    block_values,
+                    _dispatch.to_index_array(original_samples),
+                    gradient_values.shape,
+                )
 
                 values_grad_result = _dispatch.zeros_like(
                     gradient_values,
@@ -284,33 +300,35 @@ def _reduce_over_samples_block(
                 values_grad_result = values_grad_result / bincount.reshape(
                     (-1,) + (1,) * len(other_shape)
                 )
+
+                new_samples_index = _dispatch.to_index_array(new_gradient_samples[:, 0])
+                mean_times_gradient_values = gradient_values_result * (
+                    _gather_for_gradients(
+                        values_mean, new_samples_index, gradient_values.shape
+                    )
+                )
                 if reduction == "var":
-                    for i, s in enumerate(new_gradient_samples):
-                        gradient_values_result[i] = (
-                            gradient_values_result[i] * values_mean[int(s[0])]
-                        )
                     gradient_values_result = 2 * (
-                        values_grad_result - gradient_values_result
+                        values_grad_result - mean_times_gradient_values
                     )
                 else:  # std
-                    for i, s in enumerate(new_gradient_samples):
-                        sample = int(s[0])
-                        if torch_jit_is_scripting():
-                            gradient_values_result[i] = (
-                                values_grad_result[i]
-                                - (gradient_values_result[i] * values_mean[sample])
-                            ) / values_result[sample]
-                        else:
-                            # only numpy raise a warning for division by zero
-                            with np.errstate(divide="ignore", invalid="ignore"):
-                                gradient_values_result[i] = (
-                                    values_grad_result[i]
-                                    - (gradient_values_result[i] * values_mean[sample])
-                                ) / values_result[sample]
-
-                        gradient_values_result[i] = _dispatch.nan_to_num(
-                            gradient_values_result[i], nan=0.0, posinf=0.0, neginf=0.0
-                        )
+                    std_values = _gather_for_gradients(
+                        values_result, new_samples_index, gradient_values.shape
+                    )
+                    if torch_jit_is_scripting():
+                        gradient_values_result = (
+                            values_grad_result - mean_times_gradient_values
+                        ) / std_values
+                    else:
+                        # only numpy raise a warning for division by zero
+                        with np.errstate(divide="ignore", invalid="ignore"):
+                            gradient_values_result = (
+                                values_grad_result - mean_times_gradient_values
+                            ) / std_values
+
+                    gradient_values_result = _dispatch.nan_to_num(
+                        gradient_values_result, nan=0.0, posinf=0.0, neginf=0.0
+                    )
 
         # no check for the len of the gradient sample is needed because there
         # always will be at least one sample in the gradient
@@ -348,6 +366,9 @@ def _reduce_over_samples(
     else:
         sample_names_list = sample_names
 
+    if HAS_NATIVE_OPERATIONS:
+        return native_reduce_over_samples(tensor, sample_names_list, reduction)
+
     for sample in sample_names_list:
         if sample not in tensor.sample_names:
             raise ValueError(
@@ -536,7 +557,7 @@ def mean_over_samples_block(
     """
 
     return _reduce_over_samples_block(
-        block=block, sample_names=sample_names, reduction="sum"
+        block=block, sample_names=sample_names, reduction="mean"
     )
 
 
@@ -1,9 +1,12 @@
 from . import _dispatch
 from ._backend import (
+    HAS_NATIVE_OPERATIONS,
     Labels,
     TensorBlock,
     TensorMap,
     check_isinstance,
+    native_slice,
+    native_slice_block,
     torch_jit_is_scripting,
     torch_jit_script,
 )
@@ -203,6 +206,9 @@ def slice(tensor: TensorMap, axis: str, labels: Labels) -> TensorMap:
                 f"`tensor` must be a metatensor TensorMap, not {type(tensor)}"
             )
 
+    if HAS_NATIVE_OPERATIONS:
+        return native_slice(tensor, axis, labels)
+
     _check_args(tensor.block(0), axis=axis, labels=labels)
 
     return TensorMap(
@@ -241,6 +247,9 @@ def slice_block(block: TensorBlock, axis: str, labels: Labels) -> TensorBlock:
                 f"`block` must be a metatensor TensorBlock, not {type(block)}"
             )
 
+    if HAS_NATIVE_OPERATIONS:
+        return native_slice_block(block, axis, labels)
+
     _check_args(block, axis=axis, labels=labels)
 
     return _slice_block(
@@ -13,15 +13,21 @@ if os.environ.get("METATENSOR_IMPORT_FOR_SPHINX", "0") != "0":
         LabelsEntry,
         TensorBlock,
         TensorMap,
+        TensorMapLoader,
+        TensorMapReader,
         dtype_name,
         load,
         load_block,
         load_block_buffer,
+        load_block_mmap,
         load_buffer,
         load_labels,
         load_labels_buffer,
+        load_mmap,
         save,
         save_buffer,
+        save_into_buffer,
+        serialized_size,
         version,
     )
 else:
@@ -30,6 +36,8 @@ else:
     LabelsEntry = torch.classes.metatensor.LabelsEntry
     TensorBlock = torch.classes.metatensor.TensorBlock
     TensorMap = torch.classes.metatensor.TensorMap
+    TensorMapReader = torch.classes.metatensor.TensorMapReader
+    TensorMapLoader = torch.classes.metatensor.TensorMapLoader
 
     version = torch.ops.metatensor.version
     dtype_name = torch.ops.metatensor.dtype_name
@@ -38,10 +46,14 @@ else:
     load_buffer = torch.ops.metatensor.load_buffer
     load_block = torch.ops.metatensor.load_block
     load_block_buffer = torch.ops.metatensor.load_block_buffer
+    load_mmap = torch.ops.metatensor.load_mmap
+    load_block_mmap = torch.ops.metatensor.load_block_mmap
     load_labels = torch.ops.metatensor.load_labels
     load_labels_buffer = torch.ops.metatensor.load_labels_buffer
     save = torch.ops.metatensor.save
     save_buffer = torch.ops.metatensor.save_buffer
+    save_into_buffer = torch.ops.metatensor.save_into_buffer
+    serialized_size = torch.ops.metatensor.serialized_size
 
 try:
     import metatensor.operations  # noqa: F401
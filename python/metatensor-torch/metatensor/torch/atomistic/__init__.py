@@ -9,9 +9,12 @@ if os.environ.get("METATENSOR_IMPORT_FOR_SPHINX", "0") != "0":
         ModelEvaluationOptions,
         ModelMetadata,
         ModelOutput,
+        NeighborListCache,
         NeighborListOptions,
         System,
+        SystemBatch,
         check_atomistic_model,
+        compute_neighbors,
         load_model_extensions,
         read_model_metadata,
         register_autograd_neighbors,
@@ -20,7 +23,9 @@ if os.environ.get("METATENSOR_IMPORT_FOR_SPHINX", "0") != "0":
 
 else:
     System = torch.classes.metatensor.System
+    SystemBatch = torch.classes.metatensor.SystemBatch
     NeighborListOptions = torch.classes.metatensor.NeighborListOptions
+    NeighborListCache = torch.classes.metatensor.NeighborListCache
 
     ModelOutput = torch.classes.metatensor.ModelOutput
     ModelEvaluationOptions = torch.classes.metatensor.ModelEvaluationOptions
@@ -32,6 +37,7 @@ else:
     check_atomistic_model = torch.ops.metatensor.check_atomistic_model
 
     register_autograd_neighbors = torch.ops.metatensor.register_autograd_neighbors
+    compute_neighbors = torch.ops.metatensor.compute_neighbors
     unit_conversion_factor = torch.ops.metatensor.unit_conversion_factor
 
 from .model import (  # noqa: F401
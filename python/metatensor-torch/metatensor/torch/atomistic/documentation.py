@@ -85,6 +85,7 @@ class System:
         self,
         dtype: Optional[torch.dtype] = None,
         device: Optional[torch.device] = None,
+        non_blocking: bool = False,
     ) -> "System":
         """
         Move all the arrays in this system to the given ``dtype`` and ``device``.
@@ -93,6 +94,17 @@ class System:
             is set to ``None``.
         :param device: new device to use for all arrays. The device stays the same if
             this is set to ``None``.
+        :param non_blocking: if ``True``, copies to a device other than the CPU are
+            done asynchronously with respect to the host when possible, i.e. when the
+            data is in pinned memory (see :py:meth:`pin_memory`). Copies to the CPU
+            are always synchronous.
+        """
+
+    def pin_memory(self) -> "System":
+        """
+        Copy all the data in this system (including neighbors lists and custom data) to
+        page-locked (pinned) CPU memory, making later transfers to GPU faster and
+        allowing them to be asynchronous. The system must be on CPU.
         """
 
     def add_neighbor_list(
@@ -116,6 +128,10 @@ class System:
         second atom, i.e. ``positions[second_atom] - positions[first_atom] +
         cell_shift_a * cell_a + cell_shift_b * cell_b + cell_shift_c * cell_c``.
 
+        The neighbors values should have the same dtype as the system, or a floating
+        point dtype with lower precision for mixed-precision calculations (see
+        :py:attr:`ModelEvaluationOptions.neighbors_dtype`).
+
         :param options: options of the neighbors list
         :param neighbors: list of neighbors stored in a :py:class:`TensorBlock`
         """
@@ -128,12 +144,36 @@ class System:
         Retrieve a previously stored neighbors list with the given ``options``, or throw
         an error if no such neighbors list exists.
 
+        If there is no neighbors list stored with exactly these ``options``, the list is
+        derived from a stored one with a larger or equal cutoff, and cached until the
+        next call to :py:meth:`add_neighbor_list`. Pairs above the requested cutoff are
+        removed; full lists are created from half lists by adding the reversed pairs
+        (with opposite cell shifts and distance vectors); and half lists are created
+        from full lists by keeping only one of the two pairs. Gradients with respect to
+        the derived distance vectors flow back to the stored neighbors list.
+
+        This means engines only need to compute and store the neighbors list with the
+        largest cutoff, as a half list when possible. For the pairs to be removed
+        correctly, the distances must be in the same units as the ``options`` cutoff,
+        which is the case for the systems given to the models.
+
         :param options: options of the neighbors list to retrieve
         """
 
+    def has_neighbor_list(self, options: "NeighborListOptions") -> bool:
+        """
+        Check if a neighbors list with the given ``options`` is stored in this
+        :py:class:`System`, or can be derived from a stored one by
+        :py:meth:`get_neighbor_list`.
+
+        :param options: options of the neighbors list to check
+        """
+
     def known_neighbor_lists(self) -> List["NeighborListOptions"]:
         """
-        Get all the neighbors lists options registered with this :py:class:`System`
+        Get all the neighbors lists options registered with this :py:class:`System`.
+        This does not include the neighbors lists derived from them in
+        :py:meth:`get_neighbor_list`.
         """
 
     def add_data(self, name: str, data: TensorBlock, override: bool = False):
@@ -163,6 +203,138 @@ class System:
         """
 
 
+class SystemBatch:
+    """
+    A batch of multiple :py:class:`System`, with the data of all the systems packed
+    together. This allows models to evaluate all the systems at once, without having
+    to concatenate the positions and neighbor lists on every call.
+
+    The ``types`` and ``positions`` of all the systems are concatenated, and the atoms
+    of the system ``i`` are stored in the rows ``offsets[i]:offsets[i + 1]``. The
+    neighbor lists of all the systems are also concatenated, and their
+    ``"first_atom"`` and ``"second_atom"`` samples refer to the atoms in the packed
+    ``types`` and ``positions``.
+
+    >>> import torch
+    >>> from metatensor.torch.atomistic import System, SystemBatch
+    >>> systems = [
+    ...     System(
+    ...         types=torch.tensor([1, 8]),
+    ...         positions=torch.zeros((2, 3)),
+    ...         cell=torch.zeros((3, 3)),
+    ...         pbc=torch.tensor([False, False, False]),
+    ...     ),
+    ...     System(
+    ...         types=torch.tensor([6, 1, 1]),
+    ...         positions=torch.ones((3, 3)),
+    ...         cell=torch.zeros((3, 3)),
+    ...         pbc=torch.tensor([False, False, False]),
+    ...     ),
+    ... ]
+    >>> batch = SystemBatch(systems)
+    >>> len(batch)
+    2
+    >>> batch.types
+    tensor([1, 8, 6, 1, 1], dtype=torch.int32)
+    >>> batch.offsets
+    tensor([0, 2, 5])
+    >>> batch.system_indices
+    tensor([0, 0, 1, 1, 1], dtype=torch.int32)
+    """
+
+    def __init__(self, systems: List[System]):
+        """
+        :param systems: systems to pack in this batch. All the systems must have the
+            same dtype and device, and contain the same neighbor lists.
+        """
+
+    def __len__(self) -> int:
+        """number of systems in this batch"""
+
+    @property
+    def systems(self) -> List[System]:
+        """the individual systems in this batch"""
+
+    @property
+    def types(self) -> torch.Tensor:
+        """types of all the atoms in all the systems, concatenated"""
+
+    @property
+    def positions(self) -> torch.Tensor:
+        """positions of all the atoms in all the systems, concatenated"""
+
+    @property
+    def cells(self) -> torch.Tensor:
+        """cells of all the systems, as a tensor of shape ``(len(self), 3, 3)``"""
+
+    @property
+    def pbcs(self) -> torch.Tensor:
+        """
+        periodic boundary conditions of all the systems, as a tensor of shape
+        ``(len(self), 3)``
+        """
+
+    @property
+    def offsets(self) -> torch.Tensor:
+        """
+        offsets of each system in the packed ``types`` and ``positions``, as a tensor
+        of 64-bit integers with ``len(self) + 1`` entries
+        """
+
+    @property
+    def system_indices(self) -> torch.Tensor:
+        """index of the system containing each atom in the packed arrays"""
+
+    @property
+    def device(self) -> torch.device:
+        """get the device of all the arrays stored inside this batch"""
+
+    @property
+    def dtype(self) -> torch.dtype:
+        """
+        get the dtype of all the arrays stored inside this batch
+
+        .. warning::
+
+            Due to limitations in TorchScript C++ extensions, the dtype is returned as
+            an integer, which can not be compared with :py:class:`torch.dtype`
+            instances. See :py:attr:`TensorBlock.dtype
+            <metatensor.torch.TensorBlock.dtype>` for more information.
+        """
+
+    def to(
+        self,
+        dtype: Optional[torch.dtype] = None,
+        device: Optional[torch.device] = None,
+        non_blocking: bool = False,
+    ) -> "SystemBatch":
+        """
+        Move all the systems in this batch to the given ``dtype`` and ``device``, and
+        pack them again.
+
+        :param dtype: new dtype to use for all arrays. The dtype stays the same if this
+            is set to ``None``.
+        :param device: new device to use for all arrays. The device stays the same if
+            this is set to ``None``.
+        :param non_blocking: if ``True``, copies to a device other than the CPU are
+            done asynchronously with respect to the host when possible, i.e. when the
+            data is in pinned memory (see :py:meth:`System.pin_memory`).
+        """
+
+    def get_neighbor_list(self, options: "NeighborListOptions") -> TensorBlock:
+        """
+        Retrieve the neighbors list with the given ``options`` for all the systems
+        concatenated together, or throw an error if no such neighbors list exists.
+
+        :param options: options of the neighbors list to retrieve
+        """
+
+    def known_neighbor_lists(self) -> List["NeighborListOptions"]:
+        """
+        Get all the neighbors lists options available in this :py:class:`SystemBatch`
+        """
+
+
 class NeighborListOptions:
     """Options for the calculation of a neighbors list"""
 
@@ -384,6 +556,20 @@ class ModelEvaluationOptions:
         the selected subset.
         """
 
+    @property
+    def neighbors_dtype(self) -> str:
+        """
+        dtype of the distance vectors in the neighbors lists given to the model, for
+        mixed-precision calculations.
+
+        If this is an empty string (the default), the neighbors lists use the same dtype
+        as the systems. Otherwise, this can be one of ``"float16"``, ``"bfloat16"`` or
+        ``"float32"``, and the neighbors lists should be created with this dtype, for
+        example with the ``dtype`` parameter of :py:func:`compute_neighbors`. The
+        positions, cell and outputs keep the dtype of the systems, and the gradients
+        with respect to positions and cell are accumulated with the systems dtype.
+        """
+
 
 class ModelMetadata:
     """
@@ -494,6 +680,170 @@ def register_autograd_neighbors(
     """
 
 
+def compute_neighbors(
+    system: System,
+    options: NeighborListOptions,
+    length_unit: str = "",
+    dtype: Optional[torch.dtype] = None,
+) -> TensorBlock:
+    """
+    Compute the neighbors list of ``system`` corresponding to ``options``, using a
+    cell list.
+
+    The search for pairs runs on CPU, in parallel over atoms. The distance vectors are
+    then computed from ``system.positions`` and ``system.cell`` on the system device,
+    and can be used with torch's autograd.
+
+    >>> import torch
+    >>> from metatensor.torch.atomistic import (
+    ...     NeighborListOptions,
+    ...     System,
+    ...     compute_neighbors,
+    ... )
+    >>> system = System(
+    ...     types=torch.tensor([1, 1]),
+    ...     positions=torch.tensor([[0.0, 0.0, 0.0], [0.0, 0.0, 1.0]]),
+    ...     cell=torch.zeros((3, 3)),
+    ...     pbc=torch.tensor([False, False, False]),
+    ... )
+    >>> options = NeighborListOptions(cutoff=2.0, full_list=False)
+    >>> neighbors = compute_neighbors(system, options)
+    >>> neighbors.samples.values
+    tensor([[0, 1, 0, 0, 0]], dtype=torch.int32)
+    >>> system.add_neighbor_list(options, neighbors)
+
+    :param system: system for which to compute the neighbors list
+    :param options: options of the neighbors list, including the cutoff
+    :param length_unit: unit of ``system.positions`` and ``system.cell``. The cutoff in
+        ``options`` is converted to this unit before the search. No conversion happens
+        if this or ``options.length_unit`` is empty.
+    :param dtype: dtype of the distance vectors in the neighbors list, for
+        mixed-precision calculations. The vectors are computed with the dtype of the
+        system and then converted to ``dtype``, which must be a floating point type with
+        lower precision. If this is ``None``, the dtype of the system is used.
+
+    :return: the neighbors list, following the same format as
+        :py:meth:`System.add_neighbor_list`
+    """
+
+
+class NeighborListCache:
+    """
+    Cache for a single neighbors list, re-using the pairs found at a previous step as
+    long as the atoms did not move too much (also known as a Verlet list).
+
+    The pairs are searched with :py:func:`compute_neighbors` using a cutoff of
+    ``options.cutoff + skin``. On later calls to :py:meth:`update`, the distances are
+    only re-computed for these pairs, and the pairs further than the actual cutoff are
+    filtered out. A new search happens when any atom moved by more than ``skin / 2``
+    since the last search, or when the number of atoms, the cell, the periodic boundary
+    conditions, the dtype or the device of the system changed.
+
+    This is intended for simulation engines running molecular dynamics, where the same
+    neighbors list is requested for slightly different positions at every step.
+
+    >>> import torch
+    >>> from metatensor.torch.atomistic import (
+    ...     NeighborListCache,
+    ...     NeighborListOptions,
+    ...     System,
+    ... )
+    >>> options = NeighborListOptions(cutoff=2.0, full_list=False)
+    >>> cache = NeighborListCache(options, skin=0.5)
+    >>> positions = torch.tensor([[0.0, 0.0, 0.0], [0.0, 0.0, 1.9]])
+    >>> for step in range(3):
+    ...     system = System(
+    ...         types=torch.tensor([1, 1]),
+    ...         positions=positions + 0.05 * step,
+    ...         cell=torch.zeros((3, 3)),
+    ...         pbc=torch.tensor([False, False, False]),
+    ...     )
+    ...     neighbors = cache.update(system)
+    >>> cache.rebuilds
+    1
+    """
+
+    def __init__(
+        self,
+        options: NeighborListOptions,
+        skin: float,
+        length_unit: str = "",
+        dtype: Optional[torch.dtype] = None,
+    ):
+        """
+        :param options: options of the neighbors list managed by this cache
+        :param skin: additional distance used when searching for pairs. Larger values
+            lead to fewer searches, but more pairs to filter at every step.
+        :param length_unit: unit of ``skin`` and of the positions and cell of the
+            systems. The cutoff in ``options`` is converted to this unit.
+        :param dtype: dtype of the distance vectors in the neighbors lists, see
+            :py:func:`compute_neighbors`
+        """
+
+    @property
+    def options(self) -> NeighborListOptions:
+        """Options of the neighbors list managed by this cache"""
+
+    @property
+    def skin(self) -> float:
+        """Additional distance used when searching for pairs"""
+
+    @property
+    def rebuilds(self) -> int:
+        """Number of times the pairs were searched from scratch"""
+
+    def update(self, system: System) -> TensorBlock:
+        """
+        Compute the neighbors list for ``system``, re-using the pairs from the previous
+        search when possible, and add it to ``system`` with
+        :py:meth:`System.add_neighbor_list`.
+
+        :param system: system for which to compute the neighbors list
+
+        :return: the neighbors list, following the same format as
+            :py:func:`compute_neighbors`
+        """
+
+    def update_static(self, system: System) -> TensorBlock:
+        """
+        Compute the neighbors list for ``system`` with fixed samples, and add it to
+        ``system`` with :py:meth:`System.add_neighbor_list`.
+
+        Contrary to :py:meth:`update`, the pairs from the previous search are always
+        re-used, and all pairs within ``cutoff + skin`` are kept. A new search only
+        happens if there was no previous search, or if the number of atoms, the dtype or
+        the device of the system changed. The neighbors list then has the same shape
+        and samples between calls to :py:meth:`reset`, and this function does not
+        synchronize with the device outside of searches, which allows capturing the
+        calculation in a CUDA graph.
+
+        The model using this neighbors list must handle pairs beyond its cutoff (for
+        example with a smooth cutoff function), and the caller must call
+        :py:meth:`reset` when :py:meth:`needs_rebuild` is ``True``.
+
+        :param system: system for which to compute the neighbors list
+
+        :return: the neighbors list, following the same format as
+            :py:func:`compute_neighbors`
+        """
+
+    def needs_rebuild(self, system: System) -> torch.Tensor:
+        """
+        Check if the pairs from the previous search are no longer valid for ``system``,
+        because any atom moved by more than ``skin / 2`` or the cell changed. This does
+        not synchronize with the device, and returns a 0-dimensional boolean tensor on
+        the same device as ``system``.
+
+        :param system: system to check against the previous search
+        """
+
+    def reset(self):
+        """
+        Forget the pairs from the previous search, forcing the next call to
+        :py:meth:`update` to search all pairs again
+        """
+
+
 def unit_conversion_factor(quantity: str, from_unit: str, to_unit: str):
     """
     Get the multiplicative conversion factor from ``from_unit`` to ``to_unit``. Both
@@ -617,6 +617,14 @@ def _check_inputs(
             f"we got {dtype_name(global_dtype)}"
         )
 
+    neighbors_dtype = global_dtype
+    if options.neighbors_dtype == "float16":
+        neighbors_dtype = torch.float16
+    elif options.neighbors_dtype == "bfloat16":
+        neighbors_dtype = torch.bfloat16
+    elif options.neighbors_dtype == "float32":
+        neighbors_dtype = torch.float32
+
     # check that the requested outputs match what the model can do
     for name, requested in options.outputs.items():
         if name not in capabilities.outputs:
@@ -661,6 +669,7 @@ def _check_inputs(
         possible_atoms = Labels(
             ["system", "atom"],
             torch.tensor(possible_atoms_values, device=global_device),
+            assume_unique=True,
         )
 
         intersection = selected_atoms.intersection(possible_atoms)
@@ -691,13 +700,26 @@ def _check_inputs(
                 if request == known:
                     found = True
 
-            if not found:
+            if not found and not system.has_neighbor_list(request):
                 raise ValueError(
                     "missing neighbors list in the system: the model requested "
                     f"a list for {request}, but it was not computed and stored "
                     "in the system"
                 )
 
+            # lists derived by `get_neighbor_list` have the same dtype as the
+            # stored lists they are derived from, so we check the stored lists
+            # instead of deriving them here, before the conversion of units
+            for known in known_neighbor_lists:
+                if known == request or (not found and known.cutoff >= request.cutoff):
+                    neighbors = system.get_neighbor_list(known)
+                    if neighbors.values.dtype != neighbors_dtype:
+                        raise ValueError(
+                            f"wrong dtype for the neighbors list {known}: expected "
+                            f"{dtype_name(neighbors_dtype)} from the evaluation "
+                            f"options, got {dtype_name(neighbors.values.dtype)}"
+                        )
+
 
 def _convert_systems_units(
     systems: List[System],
@@ -187,7 +187,12 @@ class Labels:
     True
     """
 
-    def __init__(self, names: StrSequence, values: torch.Tensor):
+    def __init__(
+        self,
+        names: StrSequence,
+        values: torch.Tensor,
+        assume_unique: bool = False,
+    ):
         """
         :param names: names of the dimensions in the new labels. A single string
                       is transformed into a list with one element, i.e.
@@ -195,6 +200,13 @@ class Labels:
 
         :param values: values of the labels, this needs to be a 2-dimensional
                        array of integers.
+
+        :param assume_unique: if ``True``, assume that all the entries in
+            ``values`` are unique and skip the corresponding check. This makes
+            creating the labels faster, and should only be used when the entries
+            are known to be unique (for example because they are generated with
+            :py:func:`torch.arange`). Creating labels with duplicated entries
+            and ``assume_unique=True`` will lead to unspecified behavior.
         """
 
     @property
@@ -258,6 +270,9 @@ class Labels:
         :param name: name of the single dimension in the new labels.
         :param end: end of the range for labels
 
+        The new labels are range-encoded, see :py:meth:`Labels.range_product` for
+        more information.
+
         .. warning::
 
             PyTorch can execute ``static`` functions (like this one) coming from a
@@ -286,6 +301,40 @@ class Labels:
                 [6]], dtype=torch.int32)
         """
 
+    @staticmethod
+    def range_product(names: StrSequence, ends: List[int]) -> "Labels":
+        """
+        Create :py:class:`Labels` containing the cartesian product of the ``[0,
+        ends[i])`` ranges for each dimension in ``names``. The entries are in the
+        same order as :py:func:`itertools.product`, i.e. the last dimension
+        changes the fastest.
+
+        The new labels are range-encoded: :py:meth:`Labels.position`,
+        :py:meth:`Labels.positions`, :py:meth:`Labels.range_of`,
+        :py:meth:`Labels.select` (when selecting on all dimensions) and comparisons
+        with other range-encoded labels are computed arithmetically, without having
+        to build the hash table used to find entries in general labels. The
+        :py:attr:`Labels.values` are still created right away, and use memory for
+        every entry in the cartesian product.
+
+        :param names: names of the dimensions in the new labels. A single string
+                      is transformed into a list with one element, i.e.
+                      ``names="a"`` is the same as ``names=["a"]``.
+        :param ends: end of the range for each dimension
+
+        >>> from metatensor.torch import Labels
+        >>> labels = Labels.range_product(["direction", "property"], [2, 3])
+        >>> labels.values
+        tensor([[0, 0],
+                [0, 1],
+                [0, 2],
+                [1, 0],
+                [1, 1],
+                [1, 2]], dtype=torch.int32)
+        >>> labels.position([1, 1])
+        4
+        """
+
     def __len__(self) -> int:
         """number of entries in these labels"""
 
@@ -327,12 +376,13 @@ class Labels:
         """
 
     @staticmethod
-    def load(path: str) -> "Labels":
+    def load(path: str, device: Optional[torch.device] = None) -> "Labels":
         """
         Load a serialized :py:class:`Labels` from the file at ``path``, this is
         equivalent to :py:func:`metatensor.torch.load_labels`.
 
         :param path: Path of the file containing a saved :py:class:`TensorMap`
+        :param device: if given, create the values of the labels on this ``device``
 
         .. warning::
 
@@ -350,12 +400,15 @@ class Labels:
         """
 
     @staticmethod
-    def load_buffer(buffer: torch.Tensor) -> "Labels":
+    def load_buffer(
+        buffer: torch.Tensor, device: Optional[torch.device] = None
+    ) -> "Labels":
         """
         Load a serialized :py:class:`Labels` from an in-memory ``buffer``, this is
         equivalent to :py:func:`metatensor.torch.load_labels_buffer`.
 
         :param buffer: torch Tensor representing an in-memory buffer
+        :param device: if given, create the values of the labels on this ``device``
 
         .. warning::
 
@@ -516,8 +569,25 @@ class Labels:
         )
         """
 
-    def to(self, device: Union[str, torch.device]) -> "Labels":
-        """move the values for these Labels to the given ``device``"""
+    def to(
+        self, device: Union[str, torch.device], non_blocking: bool = False
+    ) -> "Labels":
+        """
+        move the values for these Labels to the given ``device``
+
+        :param device: new device to use for the values
+        :param non_blocking: if ``True``, copies to a device other than the CPU are
+            done asynchronously with respect to the host when possible, i.e. when the
+            data is in pinned memory (see :py:meth:`pin_memory`). Copies to the CPU
+            are always synchronous.
+        """
+
+    def pin_memory(self) -> "Labels":
+        """
+        Copy the values of these Labels to page-locked (pinned) CPU memory, making
+        later transfers to GPU faster and allowing them to be asynchronous. The Labels
+        must be on CPU.
+        """
 
     @property
     def device(self) -> torch.device:
@@ -532,6 +602,60 @@ class Labels:
         labels.
         """
 
+    def positions(self, entries: torch.Tensor) -> torch.Tensor:
+        """
+        Get the positions of multiple ``entries`` in this set of
+        :py:class:`Labels` at once.
+
+        ``entries`` are copied to the CPU a single time, and all the lookups
+        happen in one call to metatensor-core, which makes this a lot faster
+        than calling :py:meth:`Labels.position` for each entry.
+
+        >>> import torch
+        >>> from metatensor.torch import Labels
+        >>> labels = Labels(["a", "b"], torch.tensor([[0, 1], [1, 2], [0, 3]]))
+        >>> labels.positions(torch.tensor([[0, 3], [4, 4], [0, 1]]))
+        tensor([ 2, -1,  0])
+
+        :param entries: 2-dimensional tensor of integers, with one entry per row
+            and the same number of columns as the size of these
+            :py:class:`Labels`
+        :return: 1-dimensional tensor of 64-bit integers on the same device as
+            ``entries``, containing the position of each entry, or ``-1`` for
+            entries which are not part of these labels
+        """
+
+    def range_of(
+        self, prefix: Union[List[int], Tuple[int, ...], torch.Tensor]
+    ) -> Tuple[int, int]:
+        """
+        Get the range ``(start, end)`` of entries in these :py:class:`Labels`
+        starting with ``prefix``, i.e. the entries where the first
+        ``len(prefix)`` dimensions match the values in ``prefix``.
+
+        When the labels are sorted, this uses a binary search instead of
+        checking all the entries, and the range can be used to slice the values
+        of a block without copying them. For unsorted labels, this raises an
+        error if the matching entries are not contiguous.
+
+        >>> import torch
+        >>> from metatensor.torch import Labels
+        >>> labels = Labels(
+        ...     ["system", "atom"],
+        ...     torch.tensor([[0, 0], [0, 1], [1, 0], [1, 1], [1, 2]]),
+        ... )
+        >>> labels.range_of([1])
+        (2, 5)
+        >>> start, end = labels.range_of([0])
+        >>> labels.values[start:end]
+        tensor([[0, 0],
+                [0, 1]], dtype=torch.int32)
+
+        :param prefix: values of the first dimensions of the entries to find
+        :return: a tuple with the start and end (excluded) of the range of
+            matching entries
+        """
+
     def union(self, other: "Labels") -> "Labels":
         """
         Take the union of these :py:class:`Labels` with ``other``.
@@ -676,7 +800,13 @@ class TensorBlock:
         properties: Labels,
     ):
         """
-        :param values: tensor containing the values for this block
+        :param values: tensor containing the values for this block. This can be a
+            dense tensor, or a sparse COO tensor (see :py:meth:`torch.Tensor.to_sparse`)
+            without dense dimensions. Sparse values stay sparse in operations such as
+            :py:meth:`TensorMap.keys_to_properties`, only storing the non-zero entries.
+            Sparse values are converted to dense arrays when saving or packing (see
+            :py:meth:`TensorMap.pack`) them, and loading them gives back dense values:
+            use :py:meth:`torch.Tensor.to_sparse` to get sparse values again.
         :param samples: labels describing the samples (first dimension of the array)
         :param components: list of labels describing the components (intermediate
             dimensions of the array). This should be an empty list for scalar/invariant
@@ -744,6 +874,16 @@ class TensorBlock:
     def copy(self) -> "TensorBlock":
         """get a deep copy of this block, including all the data and metadata"""
 
+    def shallow_copy(self) -> "TensorBlock":
+        """
+        get a shallow copy of this block, sharing the values, gradients and
+        metadata with this block instead of copying them.
+
+        Adding gradients to the new block does not modify this block, but
+        in-place modifications of the values are visible in both blocks. Use
+        :py:meth:`TensorBlock.copy` if the values could be modified in-place.
+        """
+
     def add_gradient(self, parameter: str, gradient: "TensorBlock"):
         """
         Add gradient with respect to ``parameter`` in this block.
@@ -864,6 +1004,47 @@ class TensorBlock:
     def gradients(self) -> List[Tuple[str, "TensorBlock"]]:
         """Get a list of all (parameter, gradients) pairs defined in this block."""
 
+    def gradient_sample_index(
+        self, parameter: str
+    ) -> Tuple[torch.Tensor, torch.Tensor]:
+        """
+        Get the index from the samples of this block to the rows of the gradient
+        with respect to ``parameter``, in compressed sparse row (CSR) format.
+
+        This returns ``(offsets, rows)``, such that the gradient rows associated
+        with the sample ``i`` of this block are ``rows[offsets[i]:offsets[i + 1]]``.
+        ``rows`` sorts the gradient rows by their ``"sample"`` dimension, keeping the
+        existing order for rows associated with the same sample. This can be used to
+        do segment reductions (for example with :py:func:`torch.segment_reduce`) over
+        the gradients without re-computing the mapping every time.
+
+        The index is computed the first time this function is called, and cached
+        alongside the gradient data for later calls.
+
+        :param parameter: get the index for the gradients with respect to this
+            ``parameter``
+
+        >>> from metatensor.torch import TensorBlock, Labels
+        >>> block = TensorBlock(
+        ...     values=torch.full((3, 1), 1.0),
+        ...     samples=Labels.range("system", 3),
+        ...     components=[],
+        ...     properties=Labels.range("property", 1),
+        ... )
+        >>> gradient = TensorBlock(
+        ...     values=torch.full((4, 1), 11.0),
+        ...     samples=Labels(["sample"], torch.tensor([[2], [0], [2], [0]])),
+        ...     components=[],
+        ...     properties=Labels.range("property", 1),
+        ... )
+        >>> block.add_gradient("parameter", gradient)
+        >>> offsets, rows = block.gradient_sample_index("parameter")
+        >>> offsets
+        tensor([0, 2, 2, 4])
+        >>> rows
+        tensor([1, 3, 0, 2])
+        """
+
     @property
     def dtype(self) -> torch.dtype:
         """
@@ -926,6 +1107,7 @@ class TensorBlock:
         dtype: Optional[torch.dtype] = None,
         device: Optional[torch.device] = None,
         arrays: Optional[str] = None,
+        non_blocking: bool = False,
     ) -> "TensorBlock":
         """
         Move all the arrays in this block (values, gradients and labels) to the given
@@ -938,15 +1120,32 @@ class TensorBlock:
         :param arrays: new backend to use for the arrays. This parameter is here for
             compatibility with the pure Python API, can only be set  to ``"torch"`` or
             ``None`` and does nothing.
+        :param non_blocking: if ``True``, copies to a device other than the CPU are
+            done asynchronously with respect to the host when possible, i.e. when the
+            data is in pinned memory (see :py:meth:`pin_memory`). Copies to the CPU
+            are always synchronous.
+        """
+
+    def pin_memory(self) -> "TensorBlock":
+        """
+        Copy all the data in this block (values, gradients and labels) to page-locked
+        (pinned) CPU memory, making later transfers to GPU faster and allowing them to
+        be asynchronous. The block must be on CPU.
         """
 
     @staticmethod
-    def load(path: str) -> "TensorBlock":
+    def load(
+        path: str,
+        dtype: Optional[torch.dtype] = None,
+        device: Optional[torch.device] = None,
+    ) -> "TensorBlock":
         """
         Load a serialized :py:class:`TensorBlock` from the file at ``path``, this is
         equivalent to :py:func:`metatensor.torch.load_block`.
 
         :param path: Path of the file containing a saved :py:class:`TensorBlock`
+        :param dtype: if given, convert the data to this ``dtype`` after loading
+        :param device: if given, move the data to this ``device`` after loading
 
         .. warning::
 
@@ -964,12 +1163,18 @@ class TensorBlock:
         """
 
     @staticmethod
-    def load_buffer(buffer: torch.Tensor) -> "TensorBlock":
+    def load_buffer(
+        buffer: torch.Tensor,
+        dtype: Optional[torch.dtype] = None,
+        device: Optional[torch.device] = None,
+    ) -> "TensorBlock":
         """
         Load a serialized :py:class:`TensorBlock` from an in-memory ``buffer``, this is
         equivalent to :py:func:`metatensor.torch.load_block_buffer`.
 
         :param buffer: torch Tensor representing an in-memory buffer
+        :param dtype: if given, convert the data to this ``dtype`` after loading
+        :param device: if given, move the data to this ``device`` after loading
 
         .. warning::
 
@@ -1047,13 +1252,48 @@ class TensorMap:
         and metadata
         """
 
+    def shallow_copy(self) -> "TensorMap":
+        """
+        get a shallow copy of this :py:class:`TensorMap`, sharing the keys and
+        the values, gradients and metadata of all blocks instead of copying
+        them.
+
+        This is useful to change the metadata or gradients of some blocks
+        without duplicating all the data. Adding gradients to the blocks of the
+        new :py:class:`TensorMap` does not modify this one, but in-place
+        modifications of the values are visible in both. Use
+        :py:meth:`TensorMap.copy` if the values could be modified in-place. A
+        packed :py:class:`TensorMap` (see :py:meth:`TensorMap.pack`) stays
+        packed, sharing the same buffer.
+
+        >>> import torch
+        >>> from metatensor.torch import Labels, TensorBlock, TensorMap
+        >>> block = TensorBlock(
+        ...     values=torch.zeros(2, 1),
+        ...     samples=Labels.range("s", 2),
+        ...     components=[],
+        ...     properties=Labels.range("p", 1),
+        ... )
+        >>> tensor = TensorMap(Labels.range("k", 1), [block])
+        >>> copy = tensor.shallow_copy()
+        >>> values = tensor.block_by_id(0).values
+        >>> copy.block_by_id(0).values.data_ptr() == values.data_ptr()
+        True
+        """
+
     @staticmethod
-    def load(path: str) -> "TensorMap":
+    def load(
+        path: str,
+        dtype: Optional[torch.dtype] = None,
+        device: Optional[torch.device] = None,
+    ) -> "TensorMap":
         """
         Load a serialized :py:class:`TensorMap` from the file at ``path``, this is
         equivalent to :py:func:`metatensor.torch.load`.
 
         :param path: Path of the file containing a saved :py:class:`TensorMap`
+        :param dtype: if given, convert the data to this ``dtype`` after loading
+        :param device: if given, move the data to this ``device`` after loading
 
         .. warning::
 
@@ -1071,12 +1311,18 @@ class TensorMap:
         """
 
     @staticmethod
-    def load_buffer(buffer: torch.Tensor) -> "TensorMap":
+    def load_buffer(
+        buffer: torch.Tensor,
+        dtype: Optional[torch.dtype] = None,
+        device: Optional[torch.device] = None,
+    ) -> "TensorMap":
         """
         Load a serialized :py:class:`TensorMap` from an in-memory ``buffer``, this is
         equivalent to :py:func:`metatensor.torch.load_buffer`.
 
         :param buffer: torch Tensor representing an in-memory buffer
+        :param dtype: if given, convert the data to this ``dtype`` after loading
+        :param device: if given, move the data to this ``device`` after loading
 
         .. warning::
 
@@ -1202,6 +1448,58 @@ class TensorMap:
             properties
         """
 
+    def split_samples(
+        self, dimension: str, shards: torch.Tensor, n_shards: int
+    ) -> List["TensorMap"]:
+        """
+        Split the samples of all blocks in this :py:class:`TensorMap` into
+        ``n_shards`` new :py:class:`TensorMap`, in a single pass over the data.
+
+        A sample with value ``v`` for the ``dimension`` samples dimension goes to
+        the shard ``shards[v]``. All the shards have the same keys as this
+        :py:class:`TensorMap`, with empty blocks when a block has no sample in a
+        given shard. Gradients are split together with the corresponding samples.
+
+        >>> import torch
+        >>> from metatensor.torch import Labels, TensorBlock, TensorMap
+        >>> block = TensorBlock(
+        ...     values=torch.arange(4, dtype=torch.float64).reshape(4, 1),
+        ...     samples=Labels.range("system", 4),
+        ...     components=[],
+        ...     properties=Labels.range("property", 1),
+        ... )
+        >>> tensor = TensorMap(Labels.single(), [block])
+        >>> even, odd = tensor.split_samples(
+        ...     "system", shards=torch.tensor([0, 1, 0, 1]), n_shards=2
+        ... )
+        >>> odd.block().values
+        tensor([[1.],
+                [3.]], dtype=torch.float64)
+        >>> merged = TensorMap.merge_samples([even, odd])
+        >>> merged.block().samples.values.reshape(-1)
+        tensor([0, 2, 1, 3], dtype=torch.int32)
+
+        :param dimension: name of the samples dimension used to find the shard of
+            each sample
+        :param shards: 1-dimensional tensor of integers, containing the shard for
+            each value of ``dimension``
+        :param n_shards: number of shards to create
+        """
+
+    @staticmethod
+    def merge_samples(tensors: List["TensorMap"]) -> "TensorMap":
+        """
+        Merge :py:class:`TensorMap` created by :py:meth:`split_samples` back into
+        a single :py:class:`TensorMap`.
+
+        All the ``tensors`` must have the same keys, and the blocks with the same
+        key must have the same components, properties and gradients. The samples
+        of the merged blocks are the samples of the first :py:class:`TensorMap`,
+        followed by the samples of the second one, etc.
+
+        :param tensors: list of :py:class:`TensorMap` to merge
+        """
+
     def blocks_matching(self, selection: Labels) -> List[int]:
         """
         Get a (possibly empty) list of block indexes matching the ``selection``.
@@ -1284,6 +1582,25 @@ class TensorMap:
         :param selection: description of the blocks to extract
         """
 
+    def blocks_for(self, selection: Labels) -> List[TensorBlock]:
+        """
+        Get one block for each entry in ``selection``, in the same order.
+
+        Each entry is used like a :py:class:`LabelsEntry` in
+        :py:func:`TensorMap.block`, and must match exactly one key in this
+        :py:class:`TensorMap`. This is faster than calling
+        :py:func:`TensorMap.block` in a loop, especially if the ``selection`` is
+        on a GPU.
+
+        The blocks matching a given set of key values are found through a hash
+        table, created once for each set of dimensions/names used in the
+        selection, and kept for the lifetime of this :py:class:`TensorMap`. This
+        cache is also used by :py:func:`TensorMap.block` and
+        :py:func:`TensorMap.blocks`.
+
+        :param selection: keys of the blocks to extract
+        """
+
     @property
     def sample_names(self) -> List[str]:
         """names of the samples for all blocks in this tensor map"""
@@ -1326,6 +1643,7 @@ class TensorMap:
         dtype: Optional[torch.dtype] = None,
         device: Optional[torch.device] = None,
         arrays: Optional[str] = None,
+        non_blocking: bool = False,
     ) -> "TensorMap":
         """
         Move all the data (keys and blocks) in this :py:class:`TensorMap` to the given
@@ -1338,8 +1656,205 @@ class TensorMap:
         :param arrays: new backend to use for the arrays. This parameter is here for
             compatibility with the pure Python API, can only be set  to ``"torch"`` or
             ``None`` and does nothing.
+        :param non_blocking: if ``True``, copies to a device other than the CPU are
+            done asynchronously with respect to the host when possible, i.e. when the
+            data is in pinned memory (see :py:meth:`pin_memory`). Copies to the CPU
+            are always synchronous.
+
+        If this :py:class:`TensorMap` is packed (see :py:meth:`pack`), all the values
+        are moved with a single copy and the returned :py:class:`TensorMap` is also
+        packed.
+        """
+
+    def pin_memory(self) -> "TensorMap":
+        """
+        Copy all the data in this :py:class:`TensorMap` (keys, values, gradients and
+        labels) to page-locked (pinned) CPU memory, making later transfers to GPU
+        faster and allowing them to be asynchronous. The data must be on CPU.
+
+        This allows using :py:class:`TensorMap` with ``pin_memory=True`` in a
+        :py:class:`torch.utils.data.DataLoader`.
         """
 
+    def pack(self, gradients: bool = True) -> "TensorMap":
+        """
+        Get a new :py:class:`TensorMap` with the same data as this one, where the
+        values of all blocks (and of their gradients if ``gradients`` is ``True``) are
+        views inside a single contiguous 1-dimensional buffer.
+
+        All the arrays must have the same dtype and device. The buffer is available
+        with :py:meth:`packed_buffer`, and can be used to move all the data at once, to
+        run a single :py:func:`torch.distributed.all_reduce` over all the blocks, or to
+        modify all the values in-place at once. Sparse values are converted to dense
+        values inside the buffer.
+
+        >>> import torch
+        >>> from metatensor.torch import Labels, TensorBlock, TensorMap
+        >>> blocks = [
+        ...     TensorBlock(
+        ...         values=torch.full((2, 1), float(i)),
+        ...         samples=Labels.range("sample", 2),
+        ...         components=[],
+        ...         properties=Labels.range("property", 1),
+        ...     )
+        ...     for i in range(3)
+        ... ]
+        >>> tensor = TensorMap(Labels.range("key", 3), blocks).pack()
+        >>> tensor.is_packed()
+        True
+        >>> tensor.packed_buffer()
+        tensor([0., 0., 1., 1., 2., 2.])
+
+        :param gradients: should the values of the gradients also be stored in the
+            buffer?
+        """
+
+    def is_packed(self) -> bool:
+        """
+        Check if the values of all blocks in this :py:class:`TensorMap` are views
+        inside a single buffer, i.e. if it was created by :py:meth:`pack`.
+        """
+
+    def packed_buffer(self) -> torch.Tensor:
+        """
+        Get the 1-dimensional buffer containing the values of all blocks of a packed
+        :py:class:`TensorMap`. The values of the blocks are stored one after the other,
+        each followed by the values of its gradients (if they were packed).
+
+        This function raises an error if this :py:class:`TensorMap` is not packed.
+        """
+
+
+class TensorMapReader:
+    """
+    Lazy reader for a :py:class:`TensorMap` serialized to a file, giving random
+    access to the blocks.
+
+    Opening a reader only reads the keys of the :py:class:`TensorMap` and the list of
+    files in the archive. Blocks are only read and decoded from the file when
+    requested, making it cheap to load a few blocks out of a large file.
+
+    >>> import metatensor.torch
+    >>> reader = metatensor.torch.TensorMapReader("tensor.npz")  # doctest: +SKIP
+    >>> block = reader.block({"o3_lambda": 1, "center_type": 6})  # doctest: +SKIP
+    """
+
+    def __init__(self, path: str):
+        """
+        :param path: path of the file to read
+        """
+
+    @property
+    def keys(self) -> Labels:
+        """the keys of the :py:class:`TensorMap` in the file"""
+
+    def blocks_matching(self, selection: Labels) -> List[int]:
+        """
+        Get a (possibly empty) list of block indexes matching the ``selection``,
+        without loading any block. See :py:func:`TensorMap.blocks_matching` for more
+        information.
+
+        :param selection: description of the blocks to select
+        """
+
+    def block_by_id(self, index: int) -> TensorBlock:
+        """
+        Load the block at the given ``index`` from the file.
+
+        :param index: index of the block to load
+        """
+
+    def block(
+        self,
+        selection: Union[int, Labels, LabelsEntry, Dict[str, int]],
+    ) -> TensorBlock:
+        """
+        Load the single block matching the ``selection`` from the file. See
+        :py:func:`TensorMap.block` for the different kinds of selection.
+
+        :param selection: description of the block to load
+        """
+
+    def load(self, selection: Labels) -> TensorMap:
+        """
+        Load all the blocks matching the ``selection`` from the file, and assemble
+        them in a new :py:class:`TensorMap`.
+
+        :param selection: description of the blocks to load. Using ``Labels`` with
+            no dimensions (i.e. ``Labels.empty([])``) selects all the blocks.
+        """
+
+
+class TensorMapLoader:
+    """
+    Load batches of :py:class:`TensorMap` from a list of files, reading the files
+    in background threads while the previous batches are being used.
+
+    The files in each batch are loaded with :py:func:`load` and collated along the
+    samples in the same way as ``metatensor.torch.join(..., axis="samples",
+    different_keys="union")``. The ``"tensor"`` dimension is always added to the
+    samples, including for batches containing a single file. Batches are always
+    returned in order, and at most
+    ``prefetch`` batches are loaded in advance.
+
+    When ``device`` is not the CPU, each batch is packed (see
+    :py:meth:`TensorMap.pack`) and stored in pinned memory for CUDA devices by the
+    worker threads. The next batch is sent to the device asynchronously when
+    returning the current one, overlapping the copy with the calculations on the
+    current batch.
+
+    This avoids sending the data from ``DataLoader`` worker processes to the main
+    process, which requires pickling all the :py:class:`TensorMap`.
+
+    >>> import metatensor.torch
+    >>> loader = metatensor.torch.TensorMapLoader(
+    ...     paths, batch_size=16, shuffle=True, device="cuda"
+    ... )  # doctest: +SKIP
+    >>> for epoch in range(10):  # doctest: +SKIP
+    ...     batch = loader.next()
+    ...     while batch is not None:
+    ...         ...  # use the batch
+    ...         batch = loader.next()
+    ...     loader.reset()
+    """
+
+    def __init__(
+        self,
+        paths: List[str],
+        batch_size: int,
+        shuffle: bool = False,
+        dtype: Optional[torch.dtype] = None,
+        device: Optional[torch.device] = None,
+        num_workers: int = 2,
+        prefetch: int = 2,
+    ):
+        """
+        :param paths: paths of the files to load
+        :param batch_size: number of files in each batch. The last batch can
+            contain fewer files.
+        :param shuffle: should we randomize the order of the files at the start of
+            each epoch? This uses torch's global random number generator.
+        :param dtype: convert the data to this dtype after loading
+        :param device: move the batches to this device
+        :param num_workers: number of threads used to load the files
+        :param prefetch: maximal number of batches loaded in advance
+        """
+
+    def __len__(self) -> int:
+        """number of batches in one epoch"""
+
+    def next(self) -> Optional[TensorMap]:
+        """
+        Get the next batch in the current epoch, or ``None`` if all the batches in
+        this epoch have already been returned. Errors that happened when loading
+        this batch are raised here.
+        """
+
+    def reset(self):
+        """
+        Start a new epoch, re-shuffling the files if needed. Prefetched batches that
+        were not yet returned by :py:meth:`next` are discarded.
+        """
 
 def version() -> str:
     """Get the version of the underlying metatensor_torch library"""
@@ -1354,7 +1869,11 @@ def dtype_name(dtype: torch.dtype) -> str:
     """
 
 
-def load(path: str) -> TensorMap:
+def load(
+    path: str,
+    dtype: Optional[torch.dtype] = None,
+    device: Optional[torch.device] = None,
+) -> TensorMap:
     """
     Load a previously saved :py:class:`TensorMap` from the given path.
 
@@ -1363,23 +1882,62 @@ def load(path: str) -> TensorMap:
     is stored as a ``.npy`` array. See the C API documentation for more
     information on the format.
 
+    When loading on a CUDA device, the data is first decoded in pinned memory,
+    and then copied asynchronously to the device. The values of the
+    :py:class:`Labels` are directly created on the device.
+
     :param path: path of the file to load
+    :param dtype: if given, convert the data to this ``dtype`` after loading
+    :param device: if given, move the data to this ``device`` after loading
     """
 
 
-def load_block(path: str) -> TensorBlock:
+def load_block(
+    path: str,
+    dtype: Optional[torch.dtype] = None,
+    device: Optional[torch.device] = None,
+) -> TensorBlock:
     """
     Load previously saved :py:class:`TensorBlock` from the given file.
 
+    :param path: path of the file to load
+    :param dtype: if given, convert the data to this ``dtype`` after loading
+    :param device: if given, move the data to this ``device`` after loading
+    """
+
+
+def load_mmap(path: str) -> TensorMap:
+    """
+    Load a previously saved :py:class:`TensorMap` from the given path, mapping the
+    file in memory instead of reading it.
+
+    When the file was saved by metatensor without compression, the values of the
+    blocks directly use the mapped memory, without any copy. Other arrays, and
+    files that can not be used in-place, are copied as in :py:func:`load`. The
+    mapping is private: modifying the data does not change the file. The data is
+    always loaded on CPU, as ``torch.float64``.
+
     :param path: path of the file to load
     """
 
 
-def load_labels(path: str) -> Labels:
+def load_block_mmap(path: str) -> TensorBlock:
+    """
+    Load previously saved :py:class:`TensorBlock` from the given file, mapping the
+    file in memory instead of reading it. See :py:func:`load_mmap` for more
+    information.
+
+    :param path: path of the file to load
+    """
+
+
+def load_labels(path: str, device: Optional[torch.device] = None) -> Labels:
     """
     Load previously saved :py:class:`Labels` from the given file.
 
     :param path: path of the file to load
+    :param device: if given, move the values of the labels to this ``device``
+        after loading
     """
 
 
@@ -1397,30 +1955,47 @@ def save(path: str, data: Union[TensorMap, Labels]):
     """
 
 
-def load_buffer(buffer: torch.Tensor) -> TensorMap:
+def load_buffer(
+    buffer: torch.Tensor,
+    dtype: Optional[torch.dtype] = None,
+    device: Optional[torch.device] = None,
+) -> TensorMap:
     """
     Load a previously saved :py:class:`TensorMap` from an in-memory buffer, stored
     inside a 1-dimensional :py:class:`torch.Tensor` of ``uint8``.
 
     :param buffer: CPU tensor of ``uint8`` representing a in-memory buffer
+    :param dtype: if given, convert the data to this ``dtype`` after loading
+    :param device: if given, move the data to this ``device`` after loading
     """
 
 
-def load_block_buffer(buffer: torch.Tensor) -> TensorBlock:
+def load_block_buffer(
+    buffer: torch.Tensor,
+    dtype: Optional[torch.dtype] = None,
+    device: Optional[torch.device] = None,
+) -> TensorBlock:
     """
     Load a previously saved :py:class:`TensorBlock` from an in-memory buffer, stored
     inside a 1-dimensional :py:class:`torch.Tensor` of ``uint8``.
 
     :param buffer: CPU tensor of ``uint8`` representing a in-memory buffer
+    :param dtype: if given, convert the data to this ``dtype`` after loading
+    :param device: if given, move the data to this ``device`` after loading
     """
 
 
-def load_labels_buffer(buffer: torch.Tensor) -> Labels:
+def load_labels_buffer(
+    buffer: torch.Tensor,
+    device: Optional[torch.device] = None,
+) -> Labels:
     """
     Load a previously saved :py:class:`Labels` from an in-memory buffer, stored inside a
     1-dimensional :py:class:`torch.Tensor` of ``uint8``.
 
     :param buffer: CPU tensor of ``uint8`` representing a in-memory buffer
+    :param device: if given, move the values of the labels to this ``device``
+        after loading
     """
 
 
@@ -1432,3 +2007,45 @@ def save_buffer(data: Union[TensorMap, Labels]) -> torch.Tensor:
 
     :param data: data to serialize and save
     """
+
+
+def serialized_size(data: Union[TensorMap, TensorBlock, Labels]) -> int:
+    """
+    Get the exact number of bytes needed to save the given data (either
+    :py:class:`TensorMap`, :py:class:`TensorBlock` or :py:class:`Labels`), i.e. the
+    size of the buffer returned by :py:func:`save_buffer`.
+
+    This goes through all the serialization steps without storing the data, so it
+    costs about as much as saving the data itself.
+
+    :param data: data to serialize
+    """
+
+
+def save_into_buffer(
+    data: Union[TensorMap, TensorBlock, Labels], buffer: torch.Tensor
+) -> int:
+    """
+    Save the given data (either :py:class:`TensorMap`, :py:class:`TensorBlock` or
+    :py:class:`Labels`) into an existing ``buffer``, without allocating new memory.
+    This allows to re-use the same buffer to save multiple objects.
+
+    The number of bytes written to the buffer is returned, and an error is raised if
+    the buffer is too small to contain the serialized data. Use
+    :py:func:`serialized_size` to get the required size of the buffer.
+
+    >>> import torch
+    >>> import metatensor.torch
+    >>> from metatensor.torch import Labels
+    >>> labels = Labels("a", torch.tensor([[0], [1], [2]]))
+    >>> buffer = torch.zeros(1024, dtype=torch.uint8)
+    >>> written = metatensor.torch.save_into_buffer(labels, buffer)
+    >>> written == metatensor.torch.serialized_size(labels)
+    True
+    >>> loaded = metatensor.torch.load_labels_buffer(buffer[:written])
+    >>> loaded == labels
+    True
+
+    :param data: data to serialize and save
+    :param buffer: contiguous CPU tensor of ``uint8`` which will contain the data
+    """
@@ -1,6 +1,7 @@
 import importlib
 import os
 import sys
+from typing import List
 
 import metatensor.operations
 import torch
@@ -83,6 +84,56 @@ def check_isinstance(obj, ty):
 
 module.__dict__["check_isinstance"] = check_isinstance
 
+
+# use the native C++ implementation of some operations, registered as
+# `torch.ops.metatensor.*` by the metatensor-torch library
+def native_reduce_over_samples(
+    tensor: TensorMap, sample_names: List[str], reduction: str
+) -> TensorMap:
+    return torch.ops.metatensor.reduce_over_samples(tensor, sample_names, reduction)
+
+
+def native_reduce_over_samples_block(
+    block: TensorBlock, sample_names: List[str], reduction: str
+) -> TensorBlock:
+    return torch.ops.metatensor.reduce_over_samples_block(
+        block, sample_names, reduction
+    )
+
+
+def native_slice(tensor: TensorMap, axis: str, labels: Labels) -> TensorMap:
+    return torch.ops.metatensor.slice(tensor, axis, labels)
+
+
+def native_slice_block(block: TensorBlock, axis: str, labels: Labels) -> TensorBlock:
+    return torch.ops.metatensor.slice_block(block, axis, labels)
+
+
+def native_join(
+    tensors: List[TensorMap],
+    axis: str,
+    different_keys: str,
+    sort_samples: bool,
+    remove_tensor_name: bool,
+) -> TensorMap:
+    return torch.ops.metatensor.join(
+        tensors, axis, different_keys, sort_samples, remove_tensor_name
+    )
+
+
+# the native operations are not available when building the documentation
+module.__dict__["HAS_NATIVE_OPERATIONS"] = (
+    os.environ.get("METATENSOR_IMPORT_FOR_SPHINX", "0") == "0"
+)
+for function in [
+    native_reduce_over_samples,
+    native_reduce_over_samples_block,
+    native_slice,
+    native_slice_block,
+    native_join,
+]:
+    module.__dict__[function.__name__] = function
+
 # register the module in sys.modules, so future import find it directly
 sys.modules[spec.name] = module
 
@@ -2,6 +2,8 @@ import os
 
 import torch
 
+import metatensor
+import metatensor.torch
 from metatensor.torch import Labels, TensorBlock, TensorMap
 
 
@@ -150,3 +152,16 @@ def can_use_mps_backend():
         and torch.backends.mps.is_built()
         and torch.backends.mps.is_available()
     )
+
+
+def to_metatensor_core(tensor):
+    """Convert a metatensor-torch TensorMap to a metatensor-core TensorMap, to compare
+    against the pure Python implementation of the operations"""
+    buffer = metatensor.torch.save_buffer(tensor)
+    return metatensor.load_buffer(buffer.numpy().tobytes())
+
+
+def from_metatensor_core(tensor):
+    """Convert a metatensor-core TensorMap to a metatensor-torch TensorMap"""
+    buffer = bytearray(metatensor.save_buffer(tensor))
+    return metatensor.torch.load_buffer(torch.frombuffer(buffer, dtype=torch.uint8))
@@ -1,5 +1,7 @@
+import pickle
 from typing import Dict, List, Optional
 
+import pytest
 import torch
 from packaging import version
 
@@ -128,6 +130,12 @@ class ModelEvaluationOptionsWrap:
     def set_output(self, name: str, output: ModelOutput):
         self._c.outputs[name] = output
 
+    def get_neighbors_dtype(self) -> str:
+        return self._c.neighbors_dtype
+
+    def set_neighbors_dtype(self, dtype: str):
+        self._c.neighbors_dtype = dtype
+
 
 def test_run_options():
     class TestModule(torch.nn.Module):
@@ -138,6 +146,24 @@ def test_run_options():
     module = torch.jit.script(module)
 
 
+def test_run_options_neighbors_dtype():
+    options = ModelEvaluationOptions()
+    assert options.neighbors_dtype == ""
+
+    options.neighbors_dtype = "float32"
+    assert options.neighbors_dtype == "float32"
+
+    options = pickle.loads(pickle.dumps(options))
+    assert options.neighbors_dtype == "float32"
+
+    message = (
+        "`neighbors_dtype` can be one of \\['', 'float16', 'bfloat16', 'float32'\\], "
+        "got 'float64'"
+    )
+    with pytest.raises(ValueError, match=message):
+        options.neighbors_dtype = "float64"
+
+
 class ModelMetadataWrap:
     def __init__(self):
         self._c = ModelMetadata()
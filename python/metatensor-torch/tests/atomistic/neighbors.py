@@ -2,9 +2,12 @@ import pytest
 import torch
 from packaging import version
 
+from metatensor.torch import Labels, TensorBlock
 from metatensor.torch.atomistic import (
+    NeighborListCache,
     NeighborListOptions,
     System,
+    compute_neighbors,
     register_autograd_neighbors,
 )
 
@@ -147,12 +150,42 @@ def test_neighbor_autograd_errors():
     with pytest.raises(ValueError, match=message):
         register_autograd_neighbors(system, neighbors, check_consistency=True)
 
+    neighbors = _compute_ase_neighbors(
+        atoms, options, dtype=torch.float64, device="cpu"
+    )
+    samples = neighbors.samples.values.clone()
+    samples[3, 1] = n_atoms + 2
+    neighbors = TensorBlock(
+        values=neighbors.values,
+        samples=Labels(neighbors.samples.names, samples),
+        components=neighbors.components,
+        properties=neighbors.properties,
+    )
+    message = (
+        "checking internal consistency: 'second_atom' in neighbor list \\(22\\) is "
+        "out of bounds \\(we have 20 atoms in the system\\)"
+    )
+    with pytest.raises(ValueError, match=message):
+        register_autograd_neighbors(system, neighbors, check_consistency=True)
+
+    # out of bounds errors are reported before distance mismatches, even if the
+    # mismatch comes first in the neighbor list
+    neighbors = TensorBlock(
+        values=3 * neighbors.values,
+        samples=neighbors.samples,
+        components=neighbors.components,
+        properties=neighbors.properties,
+    )
+    with pytest.raises(ValueError, match=message):
+        register_autograd_neighbors(system, neighbors, check_consistency=True)
+
     neighbors = _compute_ase_neighbors(
         atoms, options, dtype=torch.float64, device="cpu"
     )
     message = (
-        "`system` and `neighbors` must have the same dtype, "
-        "got torch.float32 and torch.float64"
+        "`neighbors` must have the same dtype as `system`, or a floating point "
+        "dtype with lower precision, got torch.float32 for `system` and "
+        "torch.float64 for `neighbors`"
     )
     system = System(
         torch.from_numpy(atoms.numbers).to(torch.int32),
@@ -172,3 +205,452 @@ def test_neighbor_autograd_errors():
     )
     with pytest.raises(ValueError, match=message):
         register_autograd_neighbors(system, neighbors, check_consistency=True)
+
+
+def _brute_force_neighbors(system, cutoff, full_list, max_shift):
+    positions = system.positions.detach()
+    cell = system.cell.detach()
+    pbc = system.pbc
+
+    ranges = [range(-max_shift, max_shift + 1) if p else range(1) for p in pbc]
+    pairs = set()
+    for i in range(len(system)):
+        for j in range(len(system)):
+            for a in ranges[0]:
+                for b in ranges[1]:
+                    for c in ranges[2]:
+                        shift = (a, b, c)
+                        if i == j and shift == (0, 0, 0):
+                            continue
+
+                        if not full_list and (i > j or (i == j and shift < (0, 0, 0))):
+                            continue
+
+                        vector = (
+                            positions[j]
+                            - positions[i]
+                            + torch.tensor(shift, dtype=cell.dtype) @ cell
+                        )
+                        if torch.linalg.norm(vector) < cutoff:
+                            pairs.add((i, j, a, b, c))
+    return pairs
+
+
+@pytest.mark.parametrize("full_list", [True, False])
+@pytest.mark.parametrize(
+    "pbc", [[True, True, True], [True, False, True], [False, False, False]]
+)
+def test_compute_neighbors(full_list, pbc):
+    torch.manual_seed(0xDEADBEEF)
+    n_atoms = 12
+    positions = 4.0 * torch.rand(n_atoms, 3, dtype=torch.float64)
+    cell = 3.0 * (
+        torch.eye(3, dtype=torch.float64) + 0.2 * torch.rand(3, 3, dtype=torch.float64)
+    )
+    pbc = torch.tensor(pbc)
+    cell[~pbc] = 0.0
+
+    system = System(
+        types=torch.ones(n_atoms, dtype=torch.int32),
+        positions=positions,
+        cell=cell,
+        pbc=pbc,
+    )
+
+    options = NeighborListOptions(cutoff=3.5, full_list=full_list)
+    neighbors = compute_neighbors(system, options)
+
+    assert neighbors.samples.names == [
+        "first_atom",
+        "second_atom",
+        "cell_shift_a",
+        "cell_shift_b",
+        "cell_shift_c",
+    ]
+    assert neighbors.values.shape == (len(neighbors.samples), 3, 1)
+
+    actual = {tuple(s) for s in neighbors.samples.values.tolist()}
+    assert len(actual) == len(neighbors.samples)
+    assert actual == _brute_force_neighbors(system, 3.5, full_list, max_shift=4)
+
+    # the distance vectors match the metadata
+    system.add_neighbor_list(options, neighbors)
+    register_autograd_neighbors(system, neighbors.copy(), check_consistency=True)
+
+
+def test_compute_neighbors_units():
+    system = System(
+        types=torch.tensor([1, 1]),
+        positions=torch.tensor([[0.0, 0.0, 0.0], [0.0, 0.0, 3.0]]),
+        cell=torch.zeros((3, 3)),
+        pbc=torch.tensor([False, False, False]),
+    )
+
+    options = NeighborListOptions(cutoff=2.0, full_list=False)
+    assert len(compute_neighbors(system, options).samples) == 0
+
+    # 2 Angstrom is more than 3 Bohr
+    options = NeighborListOptions(cutoff=2.0, full_list=False)
+    options.length_unit = "Angstrom"
+    neighbors = compute_neighbors(system, options, length_unit="Bohr")
+    assert neighbors.samples.values.tolist() == [[0, 1, 0, 0, 0]]
+
+
+def test_compute_neighbors_autograd():
+    torch.manual_seed(0xDEADBEEF)
+    n_atoms = 20
+    positions = 6.0 * torch.rand(n_atoms, 3, dtype=torch.float64, requires_grad=True)
+    cell = 6.0 * (
+        torch.eye(3, dtype=torch.float64) + 0.1 * torch.rand(3, 3, dtype=torch.float64)
+    )
+    cell.requires_grad = True
+
+    def compute(positions, cell, options):
+        system = System(
+            types=torch.ones(n_atoms, dtype=torch.int32),
+            positions=positions,
+            cell=cell,
+            pbc=torch.tensor([True, True, True]),
+        )
+        return compute_neighbors(system, options).values.sum()
+
+    for full_list in [True, False]:
+        options = NeighborListOptions(cutoff=2.0, full_list=full_list)
+        torch.autograd.gradcheck(compute, (positions, cell, options), fast_mode=True)
+
+
+def test_compute_neighbors_double_backward():
+    torch.manual_seed(0xDEADBEEF)
+    n_atoms = 20
+    positions = 6.0 * torch.rand(n_atoms, 3, dtype=torch.float64, requires_grad=True)
+    cell = 6.0 * (
+        torch.eye(3, dtype=torch.float64) + 0.1 * torch.rand(3, 3, dtype=torch.float64)
+    )
+    cell.requires_grad = True
+
+    def compute(positions, cell, options):
+        system = System(
+            types=torch.ones(n_atoms, dtype=torch.int32),
+            positions=positions,
+            cell=cell,
+            pbc=torch.tensor([True, True, True]),
+        )
+        # use a non-linear function of the distances, otherwise the second
+        # derivatives are all zero
+        distances = compute_neighbors(system, options).values.reshape(-1, 3)
+        return torch.exp(-distances.square().sum(dim=1)).sum()
+
+    for full_list in [True, False]:
+        options = NeighborListOptions(cutoff=2.0, full_list=full_list)
+        torch.autograd.gradgradcheck(
+            compute, (positions, cell, options), fast_mode=True
+        )
+
+    # training on forces requires the gradient of the forces w.r.t. the
+    # parameters, here we use the positions themselves
+    options = NeighborListOptions(cutoff=2.0, full_list=True)
+    energy = compute(positions, cell, options)
+    forces = -torch.autograd.grad(energy, positions, create_graph=True)[0]
+    forces.square().sum().backward()
+    assert positions.grad is not None
+    assert torch.all(torch.isfinite(positions.grad))
+
+
+def test_register_autograd_neighbors():
+    # this does not require ASE, and goes through the fused CPU implementation
+    # of the backward pass of `register_autograd_neighbors`
+    torch.manual_seed(0xDEADBEEF)
+    n_atoms = 20
+    positions = 6.0 * torch.rand(n_atoms, 3, dtype=torch.float64, requires_grad=True)
+    cell = 6.0 * (
+        torch.eye(3, dtype=torch.float64) + 0.1 * torch.rand(3, 3, dtype=torch.float64)
+    )
+    cell.requires_grad = True
+
+    def compute(positions, cell, options):
+        types = torch.ones(n_atoms, dtype=torch.int32)
+        pbc = torch.tensor([True, True, True])
+
+        detached = System(types, positions.detach(), cell.detach(), pbc)
+        neighbors = compute_neighbors(detached, options)
+        neighbors = TensorBlock(
+            values=neighbors.values.detach(),
+            samples=neighbors.samples,
+            components=neighbors.components,
+            properties=neighbors.properties,
+        )
+
+        system = System(types, positions, cell, pbc)
+        register_autograd_neighbors(system, neighbors, check_consistency=True)
+
+        # use a non-linear function of the distances, otherwise the second
+        # derivatives are all zero
+        distances = neighbors.values.reshape(-1, 3)
+        return torch.exp(-distances.square().sum(dim=1)).sum()
+
+    for full_list in [True, False]:
+        options = NeighborListOptions(cutoff=2.0, full_list=full_list)
+        torch.autograd.gradcheck(compute, (positions, cell, options), fast_mode=True)
+        torch.autograd.gradgradcheck(
+            compute, (positions, cell, options), fast_mode=True
+        )
+
+    # only one of positions and cell requires gradients
+    options = NeighborListOptions(cutoff=2.0, full_list=True)
+    torch.autograd.gradcheck(
+        compute, (positions, cell.detach(), options), fast_mode=True
+    )
+    torch.autograd.gradcheck(
+        compute, (positions.detach(), cell, options), fast_mode=True
+    )
+
+
+@pytest.mark.parametrize("source_full_list", [True, False])
+@pytest.mark.parametrize("full_list", [True, False])
+def test_derived_neighbors(source_full_list, full_list):
+    torch.manual_seed(0xDEADBEEF)
+    n_atoms = 12
+    system = System(
+        types=torch.ones(n_atoms, dtype=torch.int32),
+        positions=4.0 * torch.rand(n_atoms, 3, dtype=torch.float64),
+        cell=3.0 * torch.eye(3, dtype=torch.float64),
+        pbc=torch.tensor([True, True, True]),
+    )
+
+    source = NeighborListOptions(cutoff=3.5, full_list=source_full_list)
+    system.add_neighbor_list(source, compute_neighbors(system, source))
+
+    for cutoff in [3.5, 2.5]:
+        options = NeighborListOptions(cutoff=cutoff, full_list=full_list)
+        assert system.has_neighbor_list(options)
+
+        derived = system.get_neighbor_list(options)
+        expected = compute_neighbors(system, options)
+        assert len(derived.samples) == len(expected.samples)
+
+        derived_samples = {tuple(s) for s in derived.samples.values.tolist()}
+        assert len(derived_samples) == len(derived.samples)
+        if full_list:
+            assert derived_samples == {
+                tuple(s) for s in expected.samples.values.tolist()
+            }
+
+        # the distance vectors match the metadata
+        register_autograd_neighbors(system, derived.copy(), check_consistency=True)
+
+        # the derived list is cached
+        cached = system.get_neighbor_list(options)
+        assert cached.values.data_ptr() == derived.values.data_ptr()
+
+    # only the stored list is known
+    assert system.known_neighbor_lists() == [source]
+
+
+def test_derived_neighbors_autograd():
+    torch.manual_seed(0xDEADBEEF)
+    n_atoms = 20
+    positions = 6.0 * torch.rand(n_atoms, 3, dtype=torch.float64, requires_grad=True)
+    cell = 6.0 * (
+        torch.eye(3, dtype=torch.float64) + 0.1 * torch.rand(3, 3, dtype=torch.float64)
+    )
+    cell.requires_grad = True
+
+    def compute(positions, cell):
+        system = System(
+            types=torch.ones(n_atoms, dtype=torch.int32),
+            positions=positions,
+            cell=cell,
+            pbc=torch.tensor([True, True, True]),
+        )
+        source = NeighborListOptions(cutoff=2.5, full_list=False)
+        system.add_neighbor_list(source, compute_neighbors(system, source))
+
+        # the vectors of a full list sum to zero, so we use their square
+        options = NeighborListOptions(cutoff=2.0, full_list=True)
+        return system.get_neighbor_list(options).values.square().sum()
+
+    torch.autograd.gradcheck(compute, (positions, cell), fast_mode=True)
+
+
+def test_compute_neighbors_mixed_precision():
+    torch.manual_seed(0xDEADBEEF)
+    n_atoms = 20
+    positions = 6.0 * torch.rand(n_atoms, 3, dtype=torch.float64, requires_grad=True)
+    cell = 6.0 * torch.eye(3, dtype=torch.float64, requires_grad=True)
+    system = System(
+        types=torch.ones(n_atoms, dtype=torch.int32),
+        positions=positions,
+        cell=cell,
+        pbc=torch.tensor([True, True, True]),
+    )
+
+    options = NeighborListOptions(cutoff=2.0, full_list=False)
+    expected = compute_neighbors(system, options)
+    neighbors = compute_neighbors(system, options, dtype=torch.float32)
+
+    assert neighbors.values.dtype == torch.float32
+    assert neighbors.samples == expected.samples
+    assert torch.allclose(neighbors.values.to(torch.float64), expected.values)
+
+    # neighbors with lower precision can be stored in the system
+    system.add_neighbor_list(options, neighbors)
+
+    # gradients are accumulated with the dtype of the system
+    neighbors.values.square().sum().backward()
+    assert positions.grad.dtype == torch.float64
+    assert cell.grad.dtype == torch.float64
+
+    cache = NeighborListCache(options, skin=0.5, dtype=torch.float32)
+    system = System(
+        types=system.types,
+        positions=positions.detach(),
+        cell=cell.detach(),
+        pbc=system.pbc,
+    )
+    assert cache.update(system).values.dtype == torch.float32
+
+    message = (
+        "the dtype of the neighbor list \\(torch.float64\\) must be a floating point "
+        "type with lower precision than the system dtype \\(torch.float32\\)"
+    )
+    with pytest.raises(ValueError, match=message):
+        compute_neighbors(
+            System(
+                types=system.types,
+                positions=positions.detach().to(torch.float32),
+                cell=cell.detach().to(torch.float32),
+                pbc=system.pbc,
+            ),
+            options,
+            dtype=torch.float64,
+        )
+
+
+def _pairs_to_vectors(neighbors):
+    return {
+        tuple(sample): vector
+        for sample, vector in zip(
+            neighbors.samples.values.tolist(), neighbors.values.reshape(-1, 3)
+        )
+    }
+
+
+def test_neighbor_list_cache():
+    torch.manual_seed(0xDEADBEEF)
+    n_atoms = 30
+    positions = 8.0 * torch.rand(n_atoms, 3, dtype=torch.float64)
+    cell = 8.0 * torch.eye(3, dtype=torch.float64)
+
+    def create_system(positions):
+        return System(
+            types=torch.ones(n_atoms, dtype=torch.int32),
+            positions=positions,
+            cell=cell,
+            pbc=torch.tensor([True, True, True]),
+        )
+
+    options = NeighborListOptions(cutoff=3.0, full_list=False)
+    cache = NeighborListCache(options, skin=0.6)
+    assert cache.skin == 0.6
+    assert cache.options == options
+    assert cache.rebuilds == 0
+
+    for step in range(6):
+        # small displacements, below skin / 2 in total
+        displacement = 0.01 * step * torch.rand(n_atoms, 3, dtype=torch.float64)
+        system = create_system(positions + displacement)
+
+        neighbors = cache.update(system)
+        expected = compute_neighbors(system, options)
+
+        assert system.get_neighbor_list(options).samples == neighbors.samples
+        actual = _pairs_to_vectors(neighbors)
+        expected = _pairs_to_vectors(expected)
+        assert actual.keys() == expected.keys()
+        for pair, vector in actual.items():
+            assert torch.allclose(vector, expected[pair])
+
+    assert cache.rebuilds == 1
+
+    # large displacements trigger a new search
+    system = create_system(positions + 0.5)
+    neighbors = cache.update(system)
+    assert cache.rebuilds == 2
+    expected = compute_neighbors(system, options)
+    assert _pairs_to_vectors(neighbors).keys() == _pairs_to_vectors(expected).keys()
+
+    # so does changing the cell
+    system = System(
+        types=torch.ones(n_atoms, dtype=torch.int32),
+        positions=positions + 0.5,
+        cell=1.1 * cell,
+        pbc=torch.tensor([True, True, True]),
+    )
+    cache.update(system)
+    assert cache.rebuilds == 3
+
+    cache.reset()
+    cache.update(create_system(positions + 0.5))
+    assert cache.rebuilds == 4
+
+    message = "`skin` must be a positive finite number, got -1.000000"
+    with pytest.raises(ValueError, match=message):
+        NeighborListCache(options, skin=-1.0)
+
+
+def test_neighbor_list_cache_static():
+    torch.manual_seed(0xDEADBEEF)
+    n_atoms = 30
+    positions = 8.0 * torch.rand(n_atoms, 3, dtype=torch.float64)
+    cell = 8.0 * torch.eye(3, dtype=torch.float64)
+
+    def create_system(positions):
+        return System(
+            types=torch.ones(n_atoms, dtype=torch.int32),
+            positions=positions,
+            cell=cell,
+            pbc=torch.tensor([True, True, True]),
+        )
+
+    options = NeighborListOptions(cutoff=3.0, full_list=False)
+    cache = NeighborListCache(options, skin=0.6)
+
+    first = cache.update_static(create_system(positions))
+    assert cache.rebuilds == 1
+
+    # the list contains all pairs within cutoff + skin
+    expected = compute_neighbors(
+        create_system(positions), NeighborListOptions(cutoff=3.6, full_list=False)
+    )
+    assert _pairs_to_vectors(first).keys() == _pairs_to_vectors(expected).keys()
+
+    for step in range(1, 4):
+        displacement = 0.01 * step * torch.rand(n_atoms, 3, dtype=torch.float64)
+        system = create_system(positions + displacement)
+        assert not cache.needs_rebuild(system)
+
+        neighbors = cache.update_static(system)
+        assert system.get_neighbor_list(options).samples == neighbors.samples
+
+        # the samples do not change between steps
+        assert neighbors.samples == first.samples
+        assert neighbors.values.shape == first.values.shape
+
+        actual = _pairs_to_vectors(neighbors)
+        vectors = _pairs_to_vectors(compute_neighbors(system, options))
+        for pair, vector in vectors.items():
+            assert torch.allclose(vector, actual[pair])
+
+    assert cache.rebuilds == 1
+
+    # large displacements are reported, but do not trigger a new search
+    system = create_system(positions + 0.5)
+    assert cache.needs_rebuild(system)
+    cache.update_static(system)
+    assert cache.rebuilds == 1
+
+    cache.reset()
+    assert cache.needs_rebuild(system)
+    cache.update_static(system)
+    assert cache.rebuilds == 2
+    assert not cache.needs_rebuild(system)
@@ -4,7 +4,7 @@ from packaging import version
 
 import metatensor.torch
 from metatensor.torch import Labels, TensorBlock
-from metatensor.torch.atomistic import NeighborListOptions, System
+from metatensor.torch.atomistic import NeighborListOptions, System, SystemBatch
 
 from .. import _tests_utils
 
@@ -89,13 +89,20 @@ def test_system(types, positions, cell, pbc, neighbors):
 
     assert metatensor.torch.equal_block(system.get_neighbor_list(options), neighbors)
 
+    # lists with a smaller or equal cutoff are derived from the stored one
+    assert system.has_neighbor_list(NeighborListOptions(cutoff=3.5, full_list=True))
+    assert system.has_neighbor_list(NeighborListOptions(cutoff=2.0, full_list=False))
+    assert not system.has_neighbor_list(
+        NeighborListOptions(cutoff=4.5, full_list=False)
+    )
+
     message = (
-        "No neighbor list for NeighborListOptions\\(cutoff=3.500000, "
+        "No neighbor list for NeighborListOptions\\(cutoff=4.500000, "
         "full_list=True\\) was found.\n"
         "Is it part of the `requested_neighbor_lists` for this model?"
     )
     with pytest.raises(ValueError, match=message):
-        system.get_neighbor_list(NeighborListOptions(cutoff=3.5, full_list=True))
+        system.get_neighbor_list(NeighborListOptions(cutoff=4.5, full_list=True))
 
     message = (
         "the neighbors list for NeighborListOptions\\(cutoff=3.500000, "
@@ -510,6 +517,20 @@ def test_to(system, neighbors):
     with pytest.raises(TypeError, match=message):
         moved = system.to(torch.tensor([0]))
 
+    moved = system.to(device="meta", non_blocking=True)
+    assert moved.device.type == "meta"
+    assert moved.get_neighbor_list(options).values.device.type == "meta"
+    assert moved.get_data("test-data").values.device.type == "meta"
+
+    if torch.cuda.is_available():
+        pinned = system.pin_memory()
+        assert pinned.positions.is_pinned()
+        assert pinned.get_neighbor_list(options).values.is_pinned()
+
+        moved = pinned.to(device="cuda", non_blocking=True)
+        torch.cuda.synchronize()
+        assert torch.all(moved.positions.cpu() == system.positions)
+
 
 # This function only works in script mode, because `block.dtype` is always an `int`, and
 # `torch.dtype` is only an int in script mode.
@@ -544,3 +565,75 @@ def test_partial_pbc():
         "the corresponding cell vector must be zero",
     ):
         system.pbc = torch.tensor([True, True, False])
+
+
+def test_system_batch(system, neighbors):
+    options = NeighborListOptions(cutoff=3.5, full_list=False)
+    system.add_neighbor_list(options, neighbors)
+
+    other = System(
+        types=torch.tensor([6, 1, 1]),
+        positions=torch.rand((3, 3)),
+        cell=torch.zeros((3, 3)),
+        pbc=torch.tensor([False, False, False]),
+    )
+    other.add_neighbor_list(options, neighbors)
+
+    batch = SystemBatch([system, other])
+    assert len(batch) == 2
+    assert len(batch.systems) == 2
+
+    assert torch.all(batch.types == torch.cat([system.types, other.types]))
+    assert torch.all(batch.positions == torch.cat([system.positions, other.positions]))
+    assert batch.cells.shape == (2, 3, 3)
+    assert torch.all(batch.cells[0] == system.cell)
+    assert batch.pbcs.shape == (2, 3)
+    assert torch.all(batch.pbcs[1] == other.pbc)
+
+    assert torch.all(batch.offsets == torch.tensor([0, 8, 11]))
+    expected = torch.tensor([0] * 8 + [1] * 3, dtype=torch.int32)
+    assert torch.all(batch.system_indices == expected)
+
+    assert str(batch) == "SystemBatch with 2 systems and 11 atoms"
+
+    # the atom indexes in the neighbor list are shifted by the system offsets
+    assert batch.known_neighbor_lists() == [options]
+    batch_neighbors = batch.get_neighbor_list(options)
+    assert batch_neighbors.values.shape == (4, 3, 1)
+    assert torch.all(
+        batch_neighbors.samples.values
+        == torch.tensor(
+            [
+                (0, 1, 0, 0, 0),
+                (0, 2, 1, 0, -1),
+                (8, 9, 0, 0, 0),
+                (8, 10, 1, 0, -1),
+            ],
+            dtype=torch.int32,
+        )
+    )
+
+    moved = batch.to(device="meta", dtype=torch.float64)
+    assert moved.device.type == "meta"
+    assert len(moved) == 2
+
+    message = "a `SystemBatch` must contain at least one system"
+    with pytest.raises(ValueError, match=message):
+        SystemBatch([])
+
+    message = "all systems in a `SystemBatch` must have the same dtype"
+    with pytest.raises(ValueError, match=message):
+        SystemBatch([system, other.to(dtype=torch.float64)])
+
+    without_neighbors = System(
+        types=torch.tensor([6]),
+        positions=torch.rand((1, 3)),
+        cell=torch.zeros((3, 3)),
+        pbc=torch.tensor([False, False, False]),
+    )
+    message = (
+        "all systems in a `SystemBatch` must contain the same neighbor lists, "
+        "but system 1 has different neighbor lists than system 0"
+    )
+    with pytest.raises(ValueError, match=message):
+        SystemBatch([system, without_neighbors])
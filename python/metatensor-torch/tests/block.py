@@ -5,7 +5,7 @@ import torch
 from packaging import version
 from torch import Tensor
 
-from metatensor.torch import Labels, TensorBlock
+from metatensor.torch import Labels, TensorBlock, TensorMap
 
 from . import _tests_utils
 
@@ -128,6 +128,10 @@ def test_copy():
 
     assert values.data_ptr() == block.values.data_ptr()
 
+    shallow = block.shallow_copy()
+    assert values.data_ptr() == shallow.values.data_ptr()
+    assert shallow.samples == block.samples
+
     clone = block.copy()
     del block
 
@@ -177,6 +181,53 @@ def test_gradients():
     assert gradients[0][0] == "g"
 
 
+def test_gradient_sample_index():
+    block = TensorBlock(
+        values=torch.full((4, 2), 1.0),
+        samples=Labels.range("s", 4),
+        components=[],
+        properties=Labels.range("p", 2),
+    )
+
+    block.add_gradient(
+        parameter="g",
+        gradient=TensorBlock(
+            values=torch.arange(10, dtype=torch.float64).reshape(5, 2),
+            samples=Labels(
+                names=["sample", "g"],
+                values=torch.tensor([[3, 0], [0, 1], [3, 2], [1, 0], [0, 0]]),
+            ),
+            components=[],
+            properties=block.properties,
+        ),
+    )
+
+    offsets, rows = block.gradient_sample_index("g")
+    assert torch.all(offsets == torch.tensor([0, 2, 3, 3, 5]))
+    assert torch.all(rows == torch.tensor([1, 4, 3, 0, 2]))
+
+    gradient = block.gradient("g")
+    sample = gradient.samples.column("sample")
+    for i in range(len(block)):
+        selected = rows[offsets[i] : offsets[i + 1]]
+        assert torch.all(sample[selected] == i)
+
+    # the index is cached, and the same tensors are returned by later calls
+    offsets_again, rows_again = block.gradient_sample_index(parameter="g")
+    assert offsets_again.data_ptr() == offsets.data_ptr()
+    assert rows_again.data_ptr() == rows.data_ptr()
+
+    # including when accessing the block multiple times through a TensorMap
+    tensor = TensorMap(Labels.range("key", 1), [block])
+    offsets, _ = tensor.block(0).gradient_sample_index("g")
+    offsets_again, _ = tensor.block(0).gradient_sample_index("g")
+    assert offsets_again.data_ptr() == offsets.data_ptr()
+
+    message = "can not find gradients with respect to 'not-there' in this block"
+    with pytest.raises(RuntimeError, match=message):
+        block.gradient_sample_index("not-there")
+
+
 def test_different_device():
     message = (
         "cannot create TensorBlock: values and samples must be on the same device, "
@@ -379,6 +430,9 @@ class TensorBlockWrap:
     def gradients(self) -> List[Tuple[str, TensorBlock]]:
         return self._c.gradients()
 
+    def gradient_sample_index(self, parameter: str) -> Tuple[Tensor, Tensor]:
+        return self._c.gradient_sample_index(parameter=parameter)
+
     def device(self) -> torch.device:
         return self._c.device
 
@@ -401,3 +455,60 @@ def test_script():
 
     module = TestModule()
     module = torch.jit.script(module)
+
+
+def test_sparse_values():
+    values = torch.zeros(4, 3)
+    values[0, 1] = 1.0
+    values[3, 2] = 2.0
+
+    block = TensorBlock(
+        values=values.to_sparse(),
+        samples=Labels.range("s", 4),
+        components=[],
+        properties=Labels.range("p", 3),
+    )
+    assert block.values.is_sparse
+    assert torch.equal(block.values.to_dense(), values)
+
+    copy = block.copy()
+    assert copy.values.is_sparse
+    assert torch.equal(copy.values.to_dense(), values)
+
+    # sparse values are saved as dense arrays
+    loaded = TensorBlock.load_buffer(block.save_buffer())
+    assert not loaded.values.is_sparse
+    assert torch.equal(loaded.values, values)
+    assert block.values.is_sparse
+
+    message = (
+        "only strided and sparse COO tensors can be used as metatensor arrays, "
+        "convert other sparse layouts with `to_sparse\\(\\)`"
+    )
+    with pytest.raises(ValueError, match=message):
+        TensorBlock(
+            values=values.to_sparse_csr(),
+            samples=Labels.range("s", 4),
+            components=[],
+            properties=Labels.range("p", 3),
+        )
+
+
+def test_save_non_contiguous():
+    values = torch.arange(12, dtype=torch.float64).reshape(3, 4).T
+    assert not values.is_contiguous()
+
+    block = TensorBlock(
+        values=values,
+        samples=Labels.range("s", 4),
+        components=[],
+        properties=Labels.range("p", 3),
+    )
+
+    # saving uses a temporary contiguous copy, and the values of the block are
+    # still a view of the original tensor afterwards
+    loaded = TensorBlock.load_buffer(block.save_buffer())
+    assert torch.equal(loaded.values, values)
+
+    assert block.values.data_ptr() == values.data_ptr()
+    assert not block.values.is_contiguous()
@@ -42,6 +42,75 @@ def test_constructor():
     assert labels.names == ["test"]
     assert torch.all(labels.values == torch.arange(33).reshape(-1, 1))
 
+    # skip the check for unique entries
+    labels = Labels(
+        names=["a", "b"],
+        values=torch.tensor([[0, 0], [0, 1]]),
+        assume_unique=True,
+    )
+    assert labels.names == ["a", "b"]
+    assert labels.position([0, 1]) == 1
+    assert labels == Labels(names=["a", "b"], values=torch.tensor([[0, 0], [0, 1]]))
+
+
+def test_range_product():
+    labels = Labels.range_product(["a", "b", "c"], [2, 3, 4])
+    assert labels.names == ["a", "b", "c"]
+    expected = torch.cartesian_prod(torch.arange(2), torch.arange(3), torch.arange(4))
+    assert torch.all(labels.values == expected)
+
+    general = Labels(["a", "b", "c"], expected)
+    assert labels == general
+    assert general == labels
+    assert labels == Labels.range_product(("a", "b", "c"), [2, 3, 4])
+    assert labels != Labels.range_product(["a", "b", "c"], [2, 3, 5])
+    assert labels != Labels.range_product(["a", "b", "d"], [2, 3, 4])
+    assert Labels.range("a", 0) == Labels(["a"], torch.zeros((0, 1)))
+
+    for i, entry in enumerate(general.values):
+        assert labels.position(entry) == i
+        assert labels.position(entry.tolist()) == i
+
+    assert labels.position([1, 2, 4]) is None
+    assert labels.position([-1, 0, 0]) is None
+    assert [0, 3, 4] not in labels
+
+    entries = torch.tensor([[1, 2, 3], [0, 0, 1], [2, 0, 0], [1, -1, 0]])
+    assert torch.all(labels.positions(entries) == general.positions(entries))
+
+    for prefix in [[], [1], [0, 2], [1, 2, 3], [2], [-1], [1, 5], [0, -3]]:
+        assert labels.range_of(prefix) == general.range_of(prefix)
+
+    selection = Labels(["a", "b", "c"], torch.tensor([[1, 0, 2], [5, 5, 5], [0, 1, 1]]))
+    assert torch.all(labels.select(selection) == general.select(selection))
+
+    selection = Labels(["c", "a"], torch.tensor([[1, 0], [2, 1]]))
+    assert torch.all(labels.select(selection) == general.select(selection))
+
+    renamed = labels.rename("b", "d")
+    assert renamed.names == ["a", "d", "c"]
+    assert renamed.position([1, 2, 3]) == 23
+
+    moved = labels.to("meta")
+    assert moved.device.type == "meta"
+    assert moved == Labels.range_product(["a", "b", "c"], [2, 3, 4]).to("meta")
+
+    message = "expected the same number of names and range ends, got 2 names and 1 ends"
+    with pytest.raises(ValueError, match=message):
+        Labels.range_product(["a", "b"], [3])
+
+    message = "the end of the range must be between 0 and 2\\^31 - 1, got -3"
+    with pytest.raises(ValueError, match=message):
+        Labels.range_product(["a"], [-3])
+
+    message = "the product of the range ends is too large"
+    with pytest.raises(ValueError, match=message):
+        Labels.range_product(["a", "b", "c"], [2**31 - 1, 2**31 - 1, 2**31 - 1])
+
+    message = "invalid parameter: 'not an ident' is not a valid label name"
+    with pytest.raises(RuntimeError, match=message):
+        Labels.range_product(["not an ident"], [3])
+
 
 def test_constructor_errors():
     message = (
@@ -346,6 +415,18 @@ def test_position():
     view = other_labels.view(["a", "a"])
     assert labels.position(view[0]) == 0
 
+    # multiple entries at once
+    positions = labels.positions(torch.tensor([[0, 1], [1, 0], [0, 0]]))
+    assert positions.dtype == torch.int64
+    assert torch.all(positions == torch.tensor([1, -1, 0]))
+
+    positions = labels.positions(torch.zeros((0, 2), dtype=torch.int32))
+    assert positions.shape == (0,)
+
+    message = "expected entries of size 2 in mts_labels_positions, got size 3"
+    with pytest.raises(RuntimeError, match=message):
+        labels.positions(torch.tensor([[0, 1, 2]]))
+
     message = (
         "parameter to Labels::positions must be a LabelsEntry, tensor, "
         "or list/tuple of integers"
@@ -354,6 +435,34 @@ def test_position():
         _ = labels.position(3)
 
 
+def test_range_of():
+    labels = Labels(
+        names=("system", "atom"),
+        values=torch.tensor([[0, 0], [0, 1], [1, 0], [1, 1], [1, 2], [3, 0]]),
+    )
+
+    assert labels.range_of([0]) == (0, 2)
+    assert labels.range_of((1,)) == (2, 5)
+    assert labels.range_of(torch.tensor([3])) == (5, 6)
+    assert labels.range_of([1, 1]) == (3, 4)
+    assert labels.range_of([2]) == (5, 5)
+    assert labels.range_of([]) == (0, 6)
+
+    unsorted = Labels(
+        names=("system", "atom"),
+        values=torch.tensor([[1, 0], [1, 1], [0, 0], [0, 1], [2, 0]]),
+    )
+    assert unsorted.range_of([0]) == (2, 4)
+
+    unsorted = Labels(
+        names=("system", "atom"),
+        values=torch.tensor([[1, 0], [0, 0], [1, 1]]),
+    )
+    message = "the entries matching this prefix are not contiguous in these Labels"
+    with pytest.raises(RuntimeError, match=message):
+        unsorted.range_of([1])
+
+
 def test_union():
     first = Labels(["aa", "bb"], torch.tensor([[0, 1], [1, 2]]))
     second = Labels(["aa", "bb"], torch.tensor([[2, 3], [1, 2], [4, 5]]))
@@ -503,6 +612,42 @@ def test_select():
         labels.select(selection)
 
 
+@pytest.mark.skipif(not torch.cuda.is_available(), reason="requires CUDA")
+def test_set_operations_on_device():
+    first = Labels(["aa", "bb"], torch.tensor([[0, 1], [1, 2], [3, 3], [5, 2]]))
+    second = Labels(["aa", "bb"], torch.tensor([[2, 3], [1, 2], [4, 5], [3, 3], [5, 5]]))
+    selection = Labels(["bb"], torch.tensor([[2], [7]]))
+
+    def check(cpu, device):
+        if isinstance(cpu, tuple):
+            for cpu_value, device_value in zip(cpu, device):
+                check(cpu_value, device_value)
+        elif isinstance(cpu, Labels):
+            assert device.values.device.type == "cuda"
+            assert cpu == device.to("cpu")
+        else:
+            assert device.device.type == "cuda"
+            assert torch.all(cpu == device.to("cpu"))
+
+    for a, b in [(first, second), (second, first)]:
+        a_cuda = a.to("cuda")
+        b_cuda = b.to("cuda")
+
+        check(a.union(b), a_cuda.union(b_cuda))
+        check(a.union_and_mapping(b), a_cuda.union_and_mapping(b_cuda))
+        check(a.intersection(b), a_cuda.intersection(b_cuda))
+        check(
+            a.intersection_and_mapping(b),
+            a_cuda.intersection_and_mapping(b_cuda),
+        )
+        check(a.select(b), a_cuda.select(b_cuda))
+        check(a.select(selection), a_cuda.select(selection.to("cuda")))
+
+    message = "invalid parameter: 'aaaa' in selection is not part of these Labels"
+    with pytest.raises(RuntimeError, match=message):
+        first.to("cuda").select(Labels(["aaaa"], torch.tensor([[1]])).to("cuda"))
+
+
 # define a wrapper class to make sure the types TorchScript uses for of all
 # C-defined functions matches what we expect
 class LabelsWrap:
@@ -547,6 +692,9 @@ class LabelsWrap:
     def position(self, entry: Union[List[int], LabelsEntry]) -> Optional[int]:
         return self._c.position(entry=entry)
 
+    def positions(self, entries: torch.Tensor) -> torch.Tensor:
+        return self._c.positions(entries=entries)
+
     def print_(self, max_entries: int, indent: int) -> str:
         return self._c.print(max_entries=max_entries, indent=indent)
 
@@ -571,6 +719,9 @@ class LabelsWrap:
     def range_(self, name: str, end: int) -> Labels:
         return Labels.range(name, end)
 
+    def range_product(self, names: List[str], ends: List[int]) -> Labels:
+        return Labels.range_product(names, ends)
+
     def union(self, other: Labels) -> Labels:
         return self._c.union(other=other)
 
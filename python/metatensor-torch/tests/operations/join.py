@@ -4,7 +4,11 @@ import os
 import torch
 from packaging import version
 
+import metatensor
 import metatensor.torch
+from metatensor.torch import Labels, TensorBlock, TensorMap
+
+from .. import _tests_utils
 
 
 def test_join():
@@ -47,3 +51,68 @@ def test_save_load():
         torch.jit.save(metatensor.torch.join, buffer)
         buffer.seek(0)
         torch.jit.load(buffer)
+
+
+def test_native_join():
+    tensor = metatensor.torch.load(
+        os.path.join(
+            os.path.dirname(__file__),
+            "..",
+            "..",
+            "..",
+            "metatensor-operations",
+            "tests",
+            "data",
+            "qm7-power-spectrum.npz",
+        )
+    )
+
+    # pure Python implementation, using metatensor-core
+    core_tensor = _tests_utils.to_metatensor_core(tensor)
+
+    for axis in ["samples", "properties"]:
+        reference = _tests_utils.from_metatensor_core(
+            metatensor.join([core_tensor, core_tensor], axis=axis)
+        )
+
+        native = torch.ops.metatensor.join([tensor, tensor], axis)
+        assert metatensor.torch.equal(native, reference)
+
+        # the Python function uses the native implementation
+        joined = metatensor.torch.join([tensor, tensor], axis=axis)
+        assert metatensor.torch.equal(joined, reference)
+
+    # disjoint properties, and different keys
+    def create_tensor(keys, properties):
+        blocks = []
+        for _ in range(len(keys)):
+            blocks.append(
+                TensorBlock(
+                    values=torch.rand(2, len(properties)),
+                    samples=Labels.range("s", 2),
+                    components=[],
+                    properties=Labels("p", torch.tensor(properties).reshape(-1, 1)),
+                )
+            )
+        return TensorMap(Labels("k", torch.tensor(keys).reshape(-1, 1)), blocks)
+
+    first = create_tensor([0, 1], [0, 1, 2])
+    second = create_tensor([1, 2], [3, 4])
+    core_first = _tests_utils.to_metatensor_core(first)
+    core_second = _tests_utils.to_metatensor_core(second)
+    for different_keys in ["intersection", "union"]:
+        native = torch.ops.metatensor.join(
+            [first, second], "properties", different_keys, False, True
+        )
+        reference = metatensor.join(
+            [core_first, core_second],
+            axis="properties",
+            different_keys=different_keys,
+            remove_tensor_name=True,
+        )
+        reference = _tests_utils.from_metatensor_core(reference)
+        assert native.keys == reference.keys
+        for key, block in reference.items():
+            native_block = native.block(key)
+            assert native_block.properties.names == ["p"]
+            assert metatensor.torch.equal_block(native_block, block)
@@ -6,9 +6,12 @@ import pytest
 import torch
 from packaging import version
 
+import metatensor
 import metatensor.torch
 from metatensor.torch import Labels, TensorBlock, TensorMap
 
+from .. import _tests_utils
+
 
 TORCH_VERSION = version.parse(torch.__version__)
 
@@ -103,3 +106,51 @@ def test_save():
         torch.jit.save(metatensor.torch.var_over_samples, buffer)
         buffer.seek(0)
         torch.jit.load(buffer)
+
+
+@pytest.mark.parametrize("reduction", ["sum", "mean", "var", "std"])
+def test_native_reduce_over_samples(reduction):
+    tensor = metatensor.torch.load(
+        os.path.join(
+            os.path.dirname(__file__),
+            "..",
+            "..",
+            "..",
+            "metatensor-operations",
+            "tests",
+            "data",
+            "qm7-power-spectrum.npz",
+        )
+    )
+    # pure Python implementation, using metatensor-core
+    core_tensor = _tests_utils.to_metatensor_core(tensor)
+    reference_function = getattr(metatensor, f"{reduction}_over_samples")
+
+    tensor_function = getattr(metatensor.torch, f"{reduction}_over_samples")
+    block_function = getattr(metatensor.torch, f"{reduction}_over_samples_block")
+
+    for sample_names in [["atom"], ["system", "atom"]]:
+        reference = _tests_utils.from_metatensor_core(
+            reference_function(core_tensor, sample_names=sample_names)
+        )
+
+        native = torch.ops.metatensor.reduce_over_samples(
+            tensor, sample_names, reduction
+        )
+        assert metatensor.torch.allclose(native, reference)
+
+        native = torch.ops.metatensor.reduce_over_samples_block(
+            tensor.block(0), sample_names, reduction
+        )
+        assert metatensor.torch.allclose_block(native, reference.block(0))
+
+        # the Python functions use the native implementation
+        reduced = tensor_function(tensor, sample_names)
+        assert metatensor.torch.allclose(reduced, reference)
+
+        reduced = block_function(tensor.block(0), sample_names)
+        assert metatensor.torch.allclose_block(reduced, reference.block(0))
+
+    message = "one of the requested sample name \\(foo\\) is not part of this TensorMap"
+    with pytest.raises(ValueError, match=message):
+        torch.ops.metatensor.reduce_over_samples(tensor, ["foo"], reduction)
@@ -3,9 +3,12 @@ import io
 import torch
 from packaging import version
 
+import metatensor
 import metatensor.torch
 from metatensor.torch import Labels, TensorMap
 
+from .. import _tests_utils
+
 
 def test_slice():
     tensor = TensorMap(
@@ -72,3 +75,46 @@ def test_save_load():
         torch.jit.save(metatensor.torch.slice_block, buffer)
         buffer.seek(0)
         torch.jit.load(buffer)
+
+
+def test_native_slice():
+    tensor = TensorMap(
+        keys=Labels.single(),
+        blocks=[
+            metatensor.torch.block_from_array(
+                torch.tensor([[0.0, 1.0, 2.0], [3.0, 4.0, 5.0], [6.0, 7.0, 8.0]])
+            )
+        ],
+    )
+    samples = Labels(names=["sample"], values=torch.tensor([[0], [2]]))
+    properties = Labels(names=["property"], values=torch.tensor([[1]]))
+
+    # pure Python implementation, using metatensor-core
+    core_tensor = _tests_utils.to_metatensor_core(tensor)
+
+    for axis, labels in [("samples", samples), ("properties", properties)]:
+        core_labels = metatensor.Labels(labels.names, labels.values.numpy())
+        reference = _tests_utils.from_metatensor_core(
+            metatensor.slice(core_tensor, axis=axis, labels=core_labels)
+        )
+
+        native = torch.ops.metatensor.slice(tensor, axis, labels)
+        assert metatensor.torch.equal(native, reference)
+
+        native = torch.ops.metatensor.slice_block(tensor.block(), axis, labels)
+        assert metatensor.torch.equal_block(native, reference.block())
+
+        # the Python functions use the native implementation
+        sliced = metatensor.torch.slice(tensor, axis=axis, labels=labels)
+        assert metatensor.torch.equal(sliced, reference)
+
+        sliced = metatensor.torch.slice_block(tensor.block(), axis=axis, labels=labels)
+        assert metatensor.torch.equal_block(sliced, reference.block())
+
+    @torch.jit.script
+    def slice_samples(tensor: TensorMap, samples: Labels) -> TensorMap:
+        return torch.ops.metatensor.slice(tensor, "samples", samples)
+
+    sliced = slice_samples(tensor, samples)
+    expected = torch.tensor([[0.0, 1.0, 2.0], [6.0, 7.0, 8.0]])
+    assert torch.equal(sliced.block().values, expected)
@@ -94,6 +94,254 @@ def test_load(tensor_path):
     check_tensor(loaded)
 
 
+@pytest.mark.parametrize(
+    "tensor_file, block_file",
+    [
+        ("data.npz", "block.npz"),
+        # saved before the values were aligned inside the file
+        ("data-unaligned.npz", "block-unaligned.npz"),
+    ],
+)
+def test_load_mmap(tensor_file, block_file):
+    root = os.path.join(
+        os.path.dirname(__file__), "..", "..", "..", "metatensor-core", "tests"
+    )
+
+    tensor_path = os.path.join(root, tensor_file)
+    loaded = metatensor.torch.load_mmap(tensor_path)
+    check_tensor(loaded)
+
+    reference = metatensor.torch.load(tensor_path)
+    assert loaded.keys == reference.keys
+    for block, expected in zip(loaded.blocks(), reference.blocks()):
+        assert torch.equal(block.values, expected.values)
+
+    block_path = os.path.join(root, block_file)
+    loaded = metatensor.torch.load_block_mmap(block_path)
+    check_block(loaded)
+
+    reference = metatensor.torch.load_block(block_path)
+    assert torch.equal(loaded.values, reference.values)
+    gradient = loaded.gradient("positions")
+    assert torch.equal(gradient.values, reference.gradient("positions").values)
+
+
+def test_load_dtype(tensor_path, block_path):
+    loaded = metatensor.torch.load(tensor_path, dtype=torch.float32)
+    check_tensor(loaded)
+    assert loaded.dtype == torch.float32
+    for block in loaded.blocks():
+        assert block.values.dtype == torch.float32
+        for _, gradient in block.gradients():
+            assert gradient.values.dtype == torch.float32
+
+    buffer = torch.tensor(np.fromfile(tensor_path, dtype="uint8"))
+    loaded = metatensor.torch.load_buffer(buffer, dtype=torch.float32, device="cpu")
+    check_tensor(loaded)
+    assert loaded.dtype == torch.float32
+
+    loaded = metatensor.torch.load_block(block_path, dtype=torch.float32)
+    check_block(loaded)
+    assert loaded.dtype == torch.float32
+
+    buffer = torch.tensor(np.fromfile(block_path, dtype="uint8"))
+    loaded = metatensor.torch.load_block_buffer(buffer, dtype=torch.float32)
+    check_block(loaded)
+    assert loaded.dtype == torch.float32
+
+    # the data is decoded directly in the requested dtype
+    reference = metatensor.torch.load(tensor_path)
+    loaded = metatensor.torch.load(tensor_path, dtype=torch.float32)
+    for key, block in reference.items():
+        assert torch.all(loaded.block(key).values == block.values.to(torch.float32))
+
+    loaded = metatensor.torch.load(tensor_path, dtype=torch.float16)
+    assert loaded.dtype == torch.float16
+    for key, block in reference.items():
+        values = loaded.block(key).values
+        assert values.dtype == torch.float16
+        assert torch.allclose(values.to(torch.float64), block.values, rtol=1e-3)
+
+
+def test_load_device(tensor_path, block_path, labels_path):
+    devices = ["meta"]
+    if torch.cuda.is_available():
+        devices.append("cuda")
+
+    for device in devices:
+        device = torch.device(device)
+
+        loaded = metatensor.torch.load(tensor_path, device=device)
+        assert loaded.device.type == device.type
+        assert loaded.keys.device.type == device.type
+        for block in loaded.blocks():
+            assert block.values.device.type == device.type
+            assert block.samples.device.type == device.type
+            assert block.properties.device.type == device.type
+            for _, gradient in block.gradients():
+                assert gradient.values.device.type == device.type
+                assert gradient.samples.device.type == device.type
+
+        buffer = torch.tensor(np.fromfile(tensor_path, dtype="uint8"))
+        loaded = metatensor.torch.load_buffer(
+            buffer, dtype=torch.float32, device=device
+        )
+        assert loaded.device.type == device.type
+        assert loaded.dtype == torch.float32
+
+        loaded = metatensor.torch.load_block(block_path, device=device)
+        assert loaded.values.device.type == device.type
+        assert loaded.samples.device.type == device.type
+
+        loaded = metatensor.torch.load_labels(labels_path, device=device)
+        assert loaded.device.type == device.type
+        assert loaded.values.device.type == device.type
+
+        buffer = torch.tensor(np.fromfile(labels_path, dtype="uint8"))
+        loaded = metatensor.torch.load_labels_buffer(buffer, device=device)
+        assert loaded.values.device.type == device.type
+
+        # the static functions on the classes accept the same arguments
+        loaded = TensorMap.load(tensor_path, dtype=torch.float32, device=device)
+        assert loaded.device.type == device.type
+        assert loaded.dtype == torch.float32
+
+        buffer = torch.tensor(np.fromfile(tensor_path, dtype="uint8"))
+        loaded = TensorMap.load_buffer(buffer, device=device)
+        assert loaded.device.type == device.type
+
+        loaded = TensorBlock.load(block_path, device=device)
+        assert loaded.values.device.type == device.type
+
+        buffer = torch.tensor(np.fromfile(block_path, dtype="uint8"))
+        loaded = TensorBlock.load_buffer(buffer, dtype=torch.float32, device=device)
+        assert loaded.values.device.type == device.type
+        assert loaded.dtype == torch.float32
+
+        loaded = Labels.load(labels_path, device=device)
+        assert loaded.values.device.type == device.type
+
+        buffer = torch.tensor(np.fromfile(labels_path, dtype="uint8"))
+        loaded = Labels.load_buffer(buffer, device=device)
+        assert loaded.values.device.type == device.type
+
+    if torch.cuda.is_available():
+        loaded = metatensor.torch.load(tensor_path, device="cuda")
+        reference = metatensor.torch.load(tensor_path).to("cuda")
+        for block, expected in zip(loaded.blocks(), reference.blocks()):
+            assert torch.all(block.values == expected.values)
+            assert block.samples == expected.samples
+            assert block.properties == expected.properties
+
+        labels = metatensor.torch.load_labels(labels_path, device="cuda")
+        check_labels(labels.to("cpu"))
+
+
+def test_save_non_float64(tensor_path):
+    tensor = metatensor.torch.load(tensor_path, dtype=torch.float32)
+
+    # float32 data is saved without first converting it to float64
+    buffer = metatensor.torch.save_buffer(tensor)
+    loaded = metatensor.torch.load_buffer(buffer, dtype=torch.float32)
+    assert loaded.keys == tensor.keys
+    for key, block in tensor.items():
+        loaded_block = loaded.block(key)
+        assert loaded_block.values.dtype == torch.float32
+        assert torch.all(loaded_block.values == block.values)
+
+
+def test_tensor_map_reader(tensor_path):
+    reader = metatensor.torch.TensorMapReader(tensor_path)
+    tensor = metatensor.torch.load(tensor_path)
+
+    assert reader.keys == tensor.keys
+
+    block = reader.block_by_id(21)
+    check_block(block)
+    assert torch.all(block.values == tensor.block_by_id(21).values)
+
+    key = tensor.keys[21]
+    assert torch.all(reader.block(key).values == block.values)
+
+    selection = Labels(["center_type"], key.values[2:3].reshape(1, 1))
+    matching = reader.blocks_matching(selection)
+    assert matching == tensor.blocks_matching(selection)
+
+    partial = reader.load(selection)
+    assert len(partial) == len(matching)
+    for i, block_i in enumerate(matching):
+        assert partial.keys[i] == tensor.keys[block_i]
+        assert torch.all(partial.block(i).values == tensor.block(block_i).values)
+
+    message = "block index out of bounds: we have 27 blocks but the index is 27"
+    with pytest.raises(IndexError, match=message):
+        reader.block_by_id(27)
+
+
+def test_tensor_map_loader(tmpdir):
+    tensor = _tests_utils.tensor(dtype=torch.float64)
+
+    paths = []
+    for i in range(5):
+        path = os.path.join(tmpdir, f"tensor-{i}.npz")
+        metatensor.torch.save(path, tensor)
+        paths.append(path)
+
+    loader = metatensor.torch.TensorMapLoader(paths, batch_size=2, num_workers=3)
+    assert len(loader) == 3
+
+    batches = []
+    batch = loader.next()
+    while batch is not None:
+        batches.append(batch)
+        batch = loader.next()
+
+    assert len(batches) == 3
+    for batch in batches[:2]:
+        assert batch.keys == tensor.keys
+        assert batch.sample_names == tensor.sample_names + ["tensor"]
+        for key, block in batch.items():
+            assert len(block.samples) == 2 * len(tensor.block(key).samples)
+
+    # the last batch contains a single file, and still gets the "tensor"
+    # dimension in the samples
+    assert batches[2].keys == tensor.keys
+    assert batches[2].sample_names == tensor.sample_names + ["tensor"]
+    for key, block in batches[2].items():
+        assert len(block.samples) == len(tensor.block(key).samples)
+        assert torch.all(block.samples.column("tensor") == 0)
+        for parameter, gradient in block.gradients():
+            expected = tensor.block(key).gradient(parameter)
+            assert gradient.samples == expected.samples
+    assert loader.next() is None
+
+    # start a new epoch
+    loader.reset()
+    batch = loader.next()
+    assert batch is not None
+    assert batch.sample_names == tensor.sample_names + ["tensor"]
+
+    loader = metatensor.torch.TensorMapLoader(
+        paths, batch_size=5, shuffle=True, dtype=torch.float32, prefetch=1
+    )
+    assert len(loader) == 1
+    batch = loader.next()
+    assert batch.block(0).values.dtype == torch.float32
+    assert len(batch.block(0).samples) == 5 * len(tensor.block(0).samples)
+    assert loader.next() is None
+
+    # errors are reported when getting the corresponding batch
+    missing = os.path.join(tmpdir, "missing.npz")
+    loader = metatensor.torch.TensorMapLoader([paths[0], missing], batch_size=1)
+    assert loader.next() is not None
+    with pytest.raises(RuntimeError):
+        loader.next()
+    assert loader.next() is None
+
+    message = "batch_size must be positive, got 0"
+    with pytest.raises(ValueError, match=message):
+        metatensor.torch.TensorMapLoader(paths, batch_size=0)
+
 def test_save(tmpdir, tensor_path):
     """Check that we can save and load a tensor to a file"""
     tmpfile = "serialize-test.npz"
@@ -265,6 +513,35 @@ def test_pickle_labels(tmpdir, labels_path):
     check_labels(loaded)
 
 
+def test_save_into_buffer(tensor_path):
+    tensor = metatensor.torch.load(tensor_path)
+    block = tensor.block(0)
+    labels = tensor.keys
+
+    for data in [tensor, block, labels]:
+        reference = metatensor.torch.save_buffer(data)
+        size = metatensor.torch.serialized_size(data)
+        assert size == len(reference)
+
+        buffer = torch.zeros(size + 10, dtype=torch.uint8)
+        written = metatensor.torch.save_into_buffer(data, buffer)
+        assert written == size
+        assert torch.all(buffer[:written] == reference)
+
+    message = "buffer is not big enough"
+    with pytest.raises(RuntimeError, match=message):
+        metatensor.torch.save_into_buffer(tensor, torch.zeros(10, dtype=torch.uint8))
+
+    message = "`buffer` must be a tensor of uint8, not torch.float32"
+    with pytest.raises(ValueError, match=message):
+        metatensor.torch.save_into_buffer(tensor, torch.zeros(10))
+
+    message = "`buffer` must be a contiguous tensor on CPU"
+    with pytest.raises(ValueError, match=message):
+        buffer = torch.zeros(20, dtype=torch.uint8)[::2]
+        metatensor.torch.save_into_buffer(tensor, buffer)
+
+
 class Serialization:
     def load(self, path: str) -> TensorMap:
         return metatensor.torch.load(path=path)
@@ -290,6 +567,14 @@ class Serialization:
     def save_buffer(self, data: Union[Labels, TensorBlock, TensorMap]) -> torch.Tensor:
         return metatensor.torch.save_buffer(data=data)
 
+    def serialized_size(self, data: Union[Labels, TensorBlock, TensorMap]) -> int:
+        return metatensor.torch.serialized_size(data=data)
+
+    def save_into_buffer(
+        self, data: Union[Labels, TensorBlock, TensorMap], buffer: torch.Tensor
+    ) -> int:
+        return metatensor.torch.save_into_buffer(data=data, buffer=buffer)
+
 
 def test_script():
     # check that the operators definition (in register.cpp) match what we expect
@@ -190,6 +190,38 @@ def test_blocks(tensor):
         tensor.blocks({"key_2": "0"})
 
 
+def test_blocks_for(tensor):
+    selection = Labels(["key_2", "key_1"], torch.tensor([[3, 2], [0, 0], [0, 1]]))
+    blocks = tensor.blocks_for(selection)
+    assert len(blocks) == 3
+    assert torch.all(blocks[0].values == torch.full((4, 3, 1), 4.0))
+    assert torch.all(blocks[1].values == torch.full((3, 1, 1), 1.0))
+    assert torch.all(blocks[2].values == torch.full((3, 1, 3), 2.0))
+
+    empty = Labels(["key_1"], torch.zeros((0, 1), dtype=torch.int32))
+    assert tensor.blocks_for(empty) == []
+
+    msg = "could not find blocks matching the selection \\(key_1=4\\)"
+    with pytest.raises(ValueError, match=msg):
+        tensor.blocks_for(Labels(["key_1"], torch.tensor([[0], [4]])))
+
+    msg = (
+        "got more than one matching block for \\(key_1=2\\), use the `blocks` "
+        "function to select more than one block"
+    )
+    with pytest.raises(ValueError, match=msg):
+        tensor.blocks_for(Labels(["key_1"], torch.tensor([[2]])))
+
+    msg = "'key_3' is not part of the keys for this tensor"
+    with pytest.raises(RuntimeError, match=msg):
+        tensor.blocks_for(Labels(["key_3"], torch.tensor([[2]])))
+
+    # repeated lookups use the same cached index
+    for _ in range(3):
+        assert torch.all(tensor.block({"key_1": 2, "key_2": 2}).values == 3.0)
+        assert len(tensor.blocks({"key_2": 0})) == 2
+
+
 def test_iter(tensor):
     expected = [
         ((0, 0), torch.full((3, 1, 1), 1.0)),
@@ -387,6 +419,52 @@ def test_components_to_properties(tensor):
     assert tuple(block.properties.values[2]) == (2, 0)
 
 
+def test_split_merge_samples(tensor):
+    # even samples go to the first shard, odd samples to the second one
+    shards = torch.tensor([0, 1, 0, 1, 0, 1, 0, 1, 0])
+    even, odd = tensor.split_samples("s", shards, n_shards=2)
+
+    assert even.keys == tensor.keys
+    assert odd.keys == tensor.keys
+
+    assert even.block_by_id(0).samples == tensor.block_by_id(0).samples
+    assert len(odd.block_by_id(0).samples) == 0
+    assert odd.block_by_id(0).values.shape == (0, 1, 1)
+
+    block = odd.block_by_id(1)
+    assert block.samples == Labels(["s"], torch.tensor([[1], [3]]))
+    assert torch.all(block.values == torch.full((2, 1, 3), 2.0))
+
+    gradient = block.gradient("g")
+    assert gradient.samples == Labels(["sample", "g"], torch.tensor([[1, -2]]))
+    assert torch.all(gradient.values == torch.full((1, 1, 3), 12.0))
+
+    merged = TensorMap.merge_samples([even, odd])
+    assert merged.keys == tensor.keys
+    for key, block in tensor.items():
+        merged_block = merged.block(key)
+        assert merged_block.samples.names == block.samples.names
+        assert len(merged_block.samples) == len(block.samples)
+
+        gradient = merged_block.gradient("g")
+        assert len(gradient.samples) == len(block.gradient("g").samples)
+
+    block = merged.block_by_id(3)
+    assert block.samples == Labels(["s"], torch.tensor([[0], [2], [1], [5]]))
+    assert block.gradient("g").samples == Labels(
+        ["sample", "g"], torch.tensor([[0, 1], [3, 3]])
+    )
+
+    message = "invalid parameter: the shard for value 1 of 's' is 2, but there "
+    message += "are only 2 shards"
+    with pytest.raises(RuntimeError, match=message):
+        tensor.split_samples("s", torch.tensor([0, 2]), n_shards=2)
+
+    message = "`shards` must be a tensor of integers"
+    with pytest.raises(ValueError, match=message):
+        tensor.split_samples("s", torch.tensor([0.0, 1.0]), n_shards=2)
+
+
 def test_empty_tensor():
     empty_tensor = TensorMap(keys=Labels.empty(["key"]), blocks=[])
 
@@ -714,3 +792,189 @@ def test_script_variable_scoping(tensor):
     # This segfaults
     scripted = torch.jit.script(problematic)
     assert scripted(tensor).item() == 42.0
+
+
+def test_pack(tensor):
+    assert not tensor.is_packed()
+    with pytest.raises(ValueError, match="this TensorMap is not packed"):
+        tensor.packed_buffer()
+
+    packed = tensor.pack()
+    assert packed.is_packed()
+    assert packed.keys == tensor.keys
+
+    buffer = packed.packed_buffer()
+    assert len(buffer.shape) == 1
+
+    n_values = 0
+    for block, packed_block in zip(tensor.blocks(), packed.blocks()):
+        assert torch.all(block.values == packed_block.values)
+        n_values += block.values.numel()
+        for parameter, gradient in block.gradients():
+            packed_gradient = packed_block.gradient(parameter)
+            assert torch.all(gradient.values == packed_gradient.values)
+            n_values += gradient.values.numel()
+    assert buffer.numel() == n_values
+
+    # the values of the blocks are views inside the buffer
+    buffer[:] = 42.0
+    for block in packed.blocks():
+        assert torch.all(block.values == 42.0)
+        for _, gradient in block.gradients():
+            assert torch.all(gradient.values == 42.0)
+
+    # moving a packed tensor gives a packed tensor
+    moved = packed.to(dtype=torch.float64)
+    assert moved.is_packed()
+    assert moved.packed_buffer().dtype == torch.float64
+    assert torch.all(moved.block(0).values == 42.0)
+
+    moved = packed.to(device="meta")
+    assert moved.is_packed()
+    assert moved.packed_buffer().device.type == "meta"
+    assert moved.block(0).values.device.type == "meta"
+
+    # only pack the values
+    packed = tensor.pack(gradients=False)
+    assert packed.packed_buffer().numel() == sum(
+        block.values.numel() for block in tensor.blocks()
+    )
+    for block, packed_block in zip(tensor.blocks(), packed.blocks()):
+        for parameter, gradient in block.gradients():
+            packed_gradient = packed_block.gradient(parameter)
+            assert torch.all(gradient.values == packed_gradient.values)
+
+    moved = packed.to(dtype=torch.float64)
+    for block in moved.blocks():
+        for _, gradient in block.gradients():
+            assert gradient.values.dtype == torch.float64
+
+
+def test_to_non_blocking(tensor):
+    moved = tensor.to(device="meta", non_blocking=True)
+    assert moved.device.type == "meta"
+    assert moved.keys.device.type == "meta"
+    for block in moved.blocks():
+        assert block.values.device.type == "meta"
+        assert block.samples.device.type == "meta"
+        for _, gradient in block.gradients():
+            assert gradient.values.device.type == "meta"
+
+    # copies to CPU are always blocking
+    moved = moved.to(dtype=torch.float64, non_blocking=True)
+    assert moved.dtype == torch.float64
+
+
+@pytest.mark.skipif(not torch.cuda.is_available(), reason="pinned memory needs CUDA")
+def test_pin_memory(tensor):
+    pinned = tensor.pin_memory()
+    assert pinned.keys.values.is_pinned()
+    for block, pinned_block in zip(tensor.blocks(), pinned.blocks()):
+        assert pinned_block.values.is_pinned()
+        assert pinned_block.samples.values.is_pinned()
+        assert torch.all(block.values == pinned_block.values)
+        for _, gradient in pinned_block.gradients():
+            assert gradient.values.is_pinned()
+
+    moved = pinned.to(device="cuda", non_blocking=True)
+    torch.cuda.synchronize()
+    assert torch.all(moved.block(0).values.cpu() == tensor.block(0).values)
+
+    packed = tensor.pack().pin_memory()
+    assert packed.is_packed()
+    assert packed.packed_buffer().is_pinned()
+
+    message = "only TensorMap on CPU can be pinned, this TensorMap is on meta"
+    with pytest.raises(ValueError, match=message):
+        tensor.to(device="meta").pin_memory()
+
+
+def test_shallow_copy(tensor):
+    copy = tensor.shallow_copy()
+    assert copy.keys == tensor.keys
+
+    for block, copy_block in zip(tensor.blocks(), copy.blocks()):
+        assert copy_block.values.data_ptr() == block.values.data_ptr()
+        assert copy_block.samples == block.samples
+        for parameter, gradient in block.gradients():
+            copy_gradient = copy_block.gradient(parameter)
+            assert copy_gradient.values.data_ptr() == gradient.values.data_ptr()
+
+    # adding a gradient to the copy does not change the original
+    block = copy.block(0)
+    block.add_gradient(
+        parameter="new",
+        gradient=TensorBlock(
+            values=torch.zeros((1, 1, 1)),
+            samples=Labels(["sample"], torch.tensor([[0]])),
+            components=block.components,
+            properties=block.properties,
+        ),
+    )
+    assert copy.block(0).gradients_list() == ["g", "new"]
+    assert tensor.block(0).gradients_list() == ["g"]
+
+    # in-place modifications of the values are shared
+    copy.block(1).values[:] = 42.0
+    assert torch.all(tensor.block(1).values == 42.0)
+
+    packed = tensor.pack()
+    copy = packed.shallow_copy()
+    assert copy.is_packed()
+    assert copy.packed_buffer().data_ptr() == packed.packed_buffer().data_ptr()
+
+
+def test_sparse_keys_to_properties():
+    sparse_blocks = []
+    dense_blocks = []
+    for i in range(2):
+        values = torch.zeros(3, 1, 2)
+        values[i, 0, 1] = i + 1.0
+
+        for blocks, block_values in [
+            (sparse_blocks, values.to_sparse()),
+            (dense_blocks, values),
+        ]:
+            blocks.append(
+                TensorBlock(
+                    values=block_values,
+                    samples=Labels.range("s", 3),
+                    components=[Labels.range("c", 1)],
+                    properties=Labels.range("p", 2),
+                )
+            )
+
+    sparse = TensorMap(Labels.range("key", 2), sparse_blocks)
+    dense = TensorMap(Labels.range("key", 2), dense_blocks)
+
+    moved = sparse.keys_to_properties("key")
+    values = moved.block(0).values
+    assert values.is_sparse
+    assert values.coalesce().values().shape == (2,)
+    assert torch.equal(values.to_dense(), dense.keys_to_properties("key")[0].values)
+
+    moved = sparse.keys_to_samples("key", sort_samples=True)
+    values = moved.block(0).values
+    assert values.is_sparse
+    expected = dense.keys_to_samples("key", sort_samples=True).block(0).values
+    assert torch.equal(values.to_dense(), expected)
+
+    moved = sparse.components_to_properties("c")
+    values = moved.block(0).values
+    assert values.is_sparse
+    expected = dense.components_to_properties("c").block(0).values
+    assert torch.equal(values.to_dense(), expected)
+
+    # sparse values are converted to dense arrays when packing and saving
+    packed = sparse.pack()
+    assert packed.is_packed()
+    assert torch.equal(packed.packed_buffer(), dense.pack().packed_buffer())
+    for block, expected in zip(packed.blocks(), dense.blocks()):
+        assert not block.values.is_sparse
+        assert torch.equal(block.values, expected.values)
+
+    loaded = TensorMap.load_buffer(sparse.save_buffer())
+    for block, expected in zip(loaded.blocks(), dense.blocks()):
+        assert not block.values.is_sparse
+        assert torch.equal(block.values, expected.values)
+    assert sparse.block(0).values.is_sparse
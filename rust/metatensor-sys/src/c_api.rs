@@ -15,6 +15,17 @@ pub const MTS_IO_ERROR: i32 = 2;
 pub const MTS_SERIALIZATION_ERROR: i32 = 3;
 pub const MTS_BUFFER_SIZE_ERROR: i32 = 254;
 pub const MTS_INTERNAL_ERROR: i32 = 255;
+pub const MTS_DTYPE_UNKNOWN: i32 = 0;
+pub const MTS_DTYPE_FLOAT64: i32 = 1;
+pub const MTS_DTYPE_FLOAT32: i32 = 2;
+pub const MTS_DTYPE_FLOAT16: i32 = 3;
+pub const MTS_DTYPE_INT32: i32 = 4;
+pub const MTS_DTYPE_INT64: i32 = 5;
+pub const MTS_COMPRESSION_NONE: i32 = 0;
+pub const MTS_COMPRESSION_DEFLATE: i32 = 1;
+pub const MTS_STORAGE_FLOAT64: i32 = 0;
+pub const MTS_STORAGE_FLOAT32: i32 = 1;
+pub const MTS_STORAGE_FLOAT16: i32 = 2;
 #[repr(C)]
 #[derive(Debug, Copy, Clone)]
 pub struct mts_block_t {
@@ -25,6 +36,21 @@ pub struct mts_block_t {
 pub struct mts_tensormap_t {
     _unused: [u8; 0],
 }
+#[repr(C)]
+#[derive(Debug, Copy, Clone)]
+pub struct mts_mmap_t {
+    _unused: [u8; 0],
+}
+#[repr(C)]
+#[derive(Debug, Copy, Clone)]
+pub struct mts_tensormap_reader_t {
+    _unused: [u8; 0],
+}
+#[repr(C)]
+#[derive(Debug, Copy, Clone)]
+pub struct mts_tensormap_writer_t {
+    _unused: [u8; 0],
+}
 pub type mts_status_t = i32;
 #[repr(C)]
 #[derive(Debug, Copy, Clone)]
@@ -204,6 +230,16 @@ pub struct mts_array_t {
             property_end: usize,
         ) -> mts_status_t,
     >,
+    pub dtype: ::std::option::Option<
+        unsafe extern "C" fn(array: *const ::std::os::raw::c_void, dtype: *mut i32) -> mts_status_t,
+    >,
+    pub typed_data: ::std::option::Option<
+        unsafe extern "C" fn(
+            array: *mut ::std::os::raw::c_void,
+            dtype: i32,
+            data: *mut *mut ::std::os::raw::c_void,
+        ) -> mts_status_t,
+    >,
 }
 #[test]
 fn bindgen_test_layout_mts_array_t() {
@@ -211,7 +247,7 @@ fn bindgen_test_layout_mts_array_t() {
     let ptr = UNINIT.as_ptr();
     assert_eq!(
         ::std::mem::size_of::<mts_array_t>(),
-        80usize,
+        96usize,
         concat!("Size of: ", stringify!(mts_array_t))
     );
     assert_eq!(
@@ -319,6 +355,97 @@ fn bindgen_test_layout_mts_array_t() {
             stringify!(move_samples_from)
         )
     );
+    assert_eq!(
+        unsafe { ::std::ptr::addr_of!((*ptr).dtype) as usize - ptr as usize },
+        80usize,
+        concat!(
+            "Offset of field: ",
+            stringify!(mts_array_t),
+            "::",
+            stringify!(dtype)
+        )
+    );
+    assert_eq!(
+        unsafe { ::std::ptr::addr_of!((*ptr).typed_data) as usize - ptr as usize },
+        88usize,
+        concat!(
+            "Offset of field: ",
+            stringify!(mts_array_t),
+            "::",
+            stringify!(typed_data)
+        )
+    );
+}
+#[repr(C)]
+#[derive(Debug, Copy, Clone)]
+pub struct mts_save_options_t {
+    pub compression: i32,
+    pub storage_type: i32,
+}
+#[test]
+fn bindgen_test_layout_mts_save_options_t() {
+    const UNINIT: ::std::mem::MaybeUninit<mts_save_options_t> = ::std::mem::MaybeUninit::uninit();
+    let ptr = UNINIT.as_ptr();
+    assert_eq!(
+        ::std::mem::size_of::<mts_save_options_t>(),
+        8usize,
+        concat!("Size of: ", stringify!(mts_save_options_t))
+    );
+    assert_eq!(
+        ::std::mem::align_of::<mts_save_options_t>(),
+        4usize,
+        concat!("Alignment of ", stringify!(mts_save_options_t))
+    );
+    assert_eq!(
+        unsafe { ::std::ptr::addr_of!((*ptr).compression) as usize - ptr as usize },
+        0usize,
+        concat!(
+            "Offset of field: ",
+            stringify!(mts_save_options_t),
+            "::",
+            stringify!(compression)
+        )
+    );
+    assert_eq!(
+        unsafe { ::std::ptr::addr_of!((*ptr).storage_type) as usize - ptr as usize },
+        4usize,
+        concat!(
+            "Offset of field: ",
+            stringify!(mts_save_options_t),
+            "::",
+            stringify!(storage_type)
+        )
+    );
+}
+#[repr(C)]
+#[derive(Debug, Copy, Clone)]
+pub struct mts_load_options_t {
+    pub threads: usize,
+}
+#[test]
+fn bindgen_test_layout_mts_load_options_t() {
+    const UNINIT: ::std::mem::MaybeUninit<mts_load_options_t> = ::std::mem::MaybeUninit::uninit();
+    let ptr = UNINIT.as_ptr();
+    assert_eq!(
+        ::std::mem::size_of::<mts_load_options_t>(),
+        8usize,
+        concat!("Size of: ", stringify!(mts_load_options_t))
+    );
+    assert_eq!(
+        ::std::mem::align_of::<mts_load_options_t>(),
+        8usize,
+        concat!("Alignment of ", stringify!(mts_load_options_t))
+    );
+    assert_eq!(
+        unsafe { ::std::ptr::addr_of!((*ptr).threads) as usize - ptr as usize },
+        0usize,
+        concat!(
+            "Offset of field: ",
+            stringify!(mts_load_options_t),
+            "::",
+            stringify!(threads)
+        )
+    );
 }
 pub type mts_realloc_buffer_t = ::std::option::Option<
     unsafe extern "C" fn(
@@ -334,9 +461,20 @@ pub type mts_create_array_callback_t = ::std::option::Option<
         array: *mut mts_array_t,
     ) -> mts_status_t,
 >;
+pub type mts_create_mmap_array_callback_t = ::std::option::Option<
+    unsafe extern "C" fn(
+        shape: *const usize,
+        shape_count: usize,
+        data: *mut f64,
+        mmap: *mut mts_mmap_t,
+        array: *mut mts_array_t,
+    ) -> mts_status_t,
+>;
 extern "C" {
     pub fn mts_disable_panic_printing();
     pub fn mts_version() -> *const ::std::os::raw::c_char;
+    pub fn mts_set_num_threads(threads: usize);
+    pub fn mts_get_num_threads() -> usize;
     pub fn mts_last_error() -> *const ::std::os::raw::c_char;
     #[must_use]
     pub fn mts_labels_position(
@@ -346,8 +484,26 @@ extern "C" {
         result: *mut i64,
     ) -> mts_status_t;
     #[must_use]
+    pub fn mts_labels_positions(
+        labels: mts_labels_t,
+        values: *const i32,
+        count: usize,
+        size: usize,
+        result: *mut i64,
+    ) -> mts_status_t;
+    #[must_use]
+    pub fn mts_labels_range_of(
+        labels: mts_labels_t,
+        prefix: *const i32,
+        prefix_count: usize,
+        start: *mut usize,
+        end: *mut usize,
+    ) -> mts_status_t;
+    #[must_use]
     pub fn mts_labels_create(labels: *mut mts_labels_t) -> mts_status_t;
     #[must_use]
+    pub fn mts_labels_create_assume_unique(labels: *mut mts_labels_t) -> mts_status_t;
+    #[must_use]
     pub fn mts_labels_set_user_data(
         labels: mts_labels_t,
         user_data: *mut ::std::os::raw::c_void,
@@ -512,12 +668,22 @@ extern "C" {
         buffer_count: usize,
         create_array: mts_create_array_callback_t,
     ) -> *mut mts_block_t;
+    pub fn mts_block_load_mmap(
+        path: *const ::std::os::raw::c_char,
+        create_array: mts_create_mmap_array_callback_t,
+    ) -> *mut mts_block_t;
     #[must_use]
     pub fn mts_block_save(
         path: *const ::std::os::raw::c_char,
         block: *const mts_block_t,
     ) -> mts_status_t;
     #[must_use]
+    pub fn mts_block_save_with_options(
+        path: *const ::std::os::raw::c_char,
+        block: *const mts_block_t,
+        options: mts_save_options_t,
+    ) -> mts_status_t;
+    #[must_use]
     pub fn mts_block_save_buffer(
         buffer: *mut *mut u8,
         buffer_count: *mut usize,
@@ -525,21 +691,51 @@ extern "C" {
         realloc: mts_realloc_buffer_t,
         block: *const mts_block_t,
     ) -> mts_status_t;
+    #[must_use]
+    pub fn mts_block_save_buffer_with_options(
+        buffer: *mut *mut u8,
+        buffer_count: *mut usize,
+        realloc_user_data: *mut ::std::os::raw::c_void,
+        realloc: mts_realloc_buffer_t,
+        block: *const mts_block_t,
+        options: mts_save_options_t,
+    ) -> mts_status_t;
     pub fn mts_tensormap_load(
         path: *const ::std::os::raw::c_char,
         create_array: mts_create_array_callback_t,
     ) -> *mut mts_tensormap_t;
+    pub fn mts_tensormap_load_with_options(
+        path: *const ::std::os::raw::c_char,
+        create_array: mts_create_array_callback_t,
+        options: mts_load_options_t,
+    ) -> *mut mts_tensormap_t;
     pub fn mts_tensormap_load_buffer(
         buffer: *const u8,
         buffer_count: usize,
         create_array: mts_create_array_callback_t,
     ) -> *mut mts_tensormap_t;
+    pub fn mts_tensormap_load_buffer_with_options(
+        buffer: *const u8,
+        buffer_count: usize,
+        create_array: mts_create_array_callback_t,
+        options: mts_load_options_t,
+    ) -> *mut mts_tensormap_t;
+    pub fn mts_tensormap_load_mmap(
+        path: *const ::std::os::raw::c_char,
+        create_array: mts_create_mmap_array_callback_t,
+    ) -> *mut mts_tensormap_t;
     #[must_use]
     pub fn mts_tensormap_save(
         path: *const ::std::os::raw::c_char,
         tensor: *const mts_tensormap_t,
     ) -> mts_status_t;
     #[must_use]
+    pub fn mts_tensormap_save_with_options(
+        path: *const ::std::os::raw::c_char,
+        tensor: *const mts_tensormap_t,
+        options: mts_save_options_t,
+    ) -> mts_status_t;
+    #[must_use]
     pub fn mts_tensormap_save_buffer(
         buffer: *mut *mut u8,
         buffer_count: *mut usize,
@@ -547,4 +743,54 @@ extern "C" {
         realloc: mts_realloc_buffer_t,
         tensor: *const mts_tensormap_t,
     ) -> mts_status_t;
+    #[must_use]
+    pub fn mts_tensormap_save_buffer_with_options(
+        buffer: *mut *mut u8,
+        buffer_count: *mut usize,
+        realloc_user_data: *mut ::std::os::raw::c_void,
+        realloc: mts_realloc_buffer_t,
+        tensor: *const mts_tensormap_t,
+        options: mts_save_options_t,
+    ) -> mts_status_t;
+    #[must_use]
+    pub fn mts_mmap_free(mmap: *mut mts_mmap_t) -> mts_status_t;
+    pub fn mts_tensormap_reader_open(
+        path: *const ::std::os::raw::c_char,
+    ) -> *mut mts_tensormap_reader_t;
+    #[must_use]
+    pub fn mts_tensormap_reader_free(reader: *mut mts_tensormap_reader_t) -> mts_status_t;
+    #[must_use]
+    pub fn mts_tensormap_reader_keys(
+        reader: *const mts_tensormap_reader_t,
+        keys: *mut mts_labels_t,
+    ) -> mts_status_t;
+    #[must_use]
+    pub fn mts_tensormap_reader_blocks_matching(
+        reader: *const mts_tensormap_reader_t,
+        block_indexes: *mut usize,
+        count: *mut usize,
+        selection: mts_labels_t,
+    ) -> mts_status_t;
+    pub fn mts_tensormap_reader_block(
+        reader: *const mts_tensormap_reader_t,
+        index: usize,
+        create_array: mts_create_array_callback_t,
+    ) -> *mut mts_block_t;
+    pub fn mts_tensormap_writer_open(
+        path: *const ::std::os::raw::c_char,
+        key_names: *const *const ::std::os::raw::c_char,
+        key_names_count: usize,
+        options: mts_save_options_t,
+    ) -> *mut mts_tensormap_writer_t;
+    #[must_use]
+    pub fn mts_tensormap_writer_free(writer: *mut mts_tensormap_writer_t) -> mts_status_t;
+    #[must_use]
+    pub fn mts_tensormap_writer_append(
+        writer: *mut mts_tensormap_writer_t,
+        key: *const i32,
+        key_count: usize,
+        block: *mut mts_block_t,
+    ) -> mts_status_t;
+    #[must_use]
+    pub fn mts_tensormap_writer_finish(writer: *mut mts_tensormap_writer_t) -> mts_status_t;
 }
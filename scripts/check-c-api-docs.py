@@ -45,6 +45,8 @@ def functions_in_outline():
         "mts_version",
         "mts_last_error",
         "mts_disable_panic_printing",
+        "mts_set_num_threads",
+        "mts_get_num_threads",
         "mts_get_data_origin",
         "mts_register_data_origin",
     ]